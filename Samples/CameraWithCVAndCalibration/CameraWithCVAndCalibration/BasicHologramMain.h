@@ -32,6 +32,9 @@
 #include "Content\SlateCameraRenderer.h"
 #include "Content\SpatialInputHandler.h"
 #include "Content\SlateFrameRendererWithCV.h"
+#include "Content\CameraUnitPlaneCache.h"
+#include "Content\MarkerPoseEstimator.h"
+#include "Content\StereoDepthProcessor.h"
 #include "Content\XAxisModel.h"
 #include "Content\YAxisModel.h"
 #include "Content\ZAxisModel.h"
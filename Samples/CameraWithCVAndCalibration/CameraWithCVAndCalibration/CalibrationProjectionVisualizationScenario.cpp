@@ -39,6 +39,10 @@ using namespace winrt::Windows::UI::Input::Spatial;
 static ResearchModeSensorConsent camAccessCheck;
 static HANDLE camConsentGiven;
 
+// VLC frames are 640x480, the unit plane caches are built before the first one arrives
+static const UINT kVLCWidth = 640;
+static const UINT kVLCHeight = 480;
+
 CalibrationProjectionVisualizationScenario::CalibrationProjectionVisualizationScenario(std::shared_ptr<DX::DeviceResources> const& deviceResources) :
     Scenario(deviceResources)
 {
@@ -108,6 +112,9 @@ void CalibrationProjectionVisualizationScenario::IntializeSensors()
 
             winrt::check_hresult(pCameraSensor->GetCameraExtrinsicsMatrix(&m_LFCameraPose));
 
+            m_LFUnitPlaneCache = std::make_shared<CameraUnitPlaneCache>();
+            m_LFUnitPlaneCache->Build(pCameraSensor, kVLCWidth, kVLCHeight);
+
             DirectX::XMFLOAT4 zeros = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
 
             DirectX::XMMATRIX cameraPose = XMLoadFloat4x4(&m_LFCameraPose);
@@ -127,6 +134,9 @@ void CalibrationProjectionVisualizationScenario::IntializeSensors()
 
             winrt::check_hresult(pCameraSensor->GetCameraExtrinsicsMatrix(&m_RFCameraPose));
 
+            m_RFUnitPlaneCache = std::make_shared<CameraUnitPlaneCache>();
+            m_RFUnitPlaneCache->Build(pCameraSensor, kVLCWidth, kVLCHeight);
+
             DirectX::XMFLOAT4 zeros = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
 
             DirectX::XMMATRIX cameraPose = XMLoadFloat4x4(&m_RFCameraPose);
@@ -138,6 +148,16 @@ void CalibrationProjectionVisualizationScenario::IntializeSensors()
             XMStoreFloat4(&m_RFRotDeterminant, det);
         }
     }
+
+    // Locates the rig, and with it the markers, in the stationary frame at the camera timestamps
+    IResearchModeSensorDevicePerception* pSensorDevicePerception = nullptr;
+    GUID rigNodeId;
+
+    winrt::check_hresult(m_pSensorDevice->QueryInterface(IID_PPV_ARGS(&pSensorDevicePerception)));
+    winrt::check_hresult(pSensorDevicePerception->GetRigNodeId(&rigNodeId));
+    pSensorDevicePerception->Release();
+
+    m_rigLocator = Preview::SpatialGraphInteropPreview::CreateLocatorForNode(rigNodeId);
 }
 
 void CalibrationProjectionVisualizationScenario::UpdateState()
@@ -288,11 +308,22 @@ void CalibrationProjectionVisualizationScenario::IntializeSensorFrameModelRender
     }
 }
 
+// Distance to the marker from the disparities of the LF/RF pair rather than from the shift of its pixel position
+static const bool kComputeStereoDepth = true;
+static const StereoOptions kStereoOptions;
+
+// Side of the black square of One-Arruco-markers-DICT_6X6_250.pdf printed at 100%, in meters
+static const float kArucoMarkerLength = 0.0889f;
+
+// Put the cube on the marker pose when the rig can be located, rather than along the LF ray
+static const bool kPlaceCubeOnMarkerPose = true;
+
 void CalibrationProjectionVisualizationScenario::InitializeArucoRendering()
 {
-    {
-        SlateCameraRenderer* pLFSlateCameraRenderer = nullptr;
+    SlateCameraRenderer* pLFSlateCameraRenderer = nullptr;
+    SlateCameraRenderer* pRFSlateCameraRenderer = nullptr;
 
+    {
         if (m_pLFCameraSensor)
         {
             // Initialize the sample hologram.
@@ -305,18 +336,21 @@ void CalibrationProjectionVisualizationScenario::InitializeArucoRendering()
         }
 
         auto slateTextureRenderer = std::make_shared<SlateFrameRendererWithCV>(m_deviceResources, ProcessRmFrameWithAruco);
-        slateTextureRenderer->StartCVProcessing(0xff);
+        std::shared_ptr<MarkerPoseEstimator> markerPoseEstimator;
+        if (m_LFUnitPlaneCache && m_LFUnitPlaneCache->IsBuilt())
+        {
+            markerPoseEstimator = std::make_shared<MarkerPoseEstimator>(m_LFUnitPlaneCache, m_LFCameraPose, kArucoMarkerLength);
+        }
+        slateTextureRenderer->StartCVProcessing(0xff, markerPoseEstimator);
 
         slateTextureRenderer->DisableRendering();
         m_modelRenderers.push_back(slateTextureRenderer);
         m_arucoDetectorLeft = slateTextureRenderer;
 
-        pLFSlateCameraRenderer->SetFrameCallBack(SlateFrameRendererWithCV::FrameReadyCallback, slateTextureRenderer.get());
+        pLFSlateCameraRenderer->AddFrameCallBack(SlateFrameRendererWithCV::FrameReadyCallback, slateTextureRenderer.get());
     }
 
     {
-        SlateCameraRenderer* pRFSlateCameraRenderer = nullptr;
-
         if (m_pLFCameraSensor)
         {
             // Initialize the sample hologram.
@@ -329,13 +363,26 @@ void CalibrationProjectionVisualizationScenario::InitializeArucoRendering()
         }
 
         auto slateTextureRenderer = std::make_shared<SlateFrameRendererWithCV>(m_deviceResources, ProcessRmFrameWithAruco);
-        slateTextureRenderer->StartCVProcessing(0xff);
+        std::shared_ptr<MarkerPoseEstimator> markerPoseEstimator;
+        if (m_RFUnitPlaneCache && m_RFUnitPlaneCache->IsBuilt())
+        {
+            markerPoseEstimator = std::make_shared<MarkerPoseEstimator>(m_RFUnitPlaneCache, m_RFCameraPose, kArucoMarkerLength);
+        }
+        slateTextureRenderer->StartCVProcessing(0xff, markerPoseEstimator);
 
         slateTextureRenderer->DisableRendering();
         m_modelRenderers.push_back(slateTextureRenderer);
         m_arucoDetectorRight = slateTextureRenderer;
 
-        pRFSlateCameraRenderer->SetFrameCallBack(SlateFrameRendererWithCV::FrameReadyCallback, slateTextureRenderer.get());
+        pRFSlateCameraRenderer->AddFrameCallBack(SlateFrameRendererWithCV::FrameReadyCallback, slateTextureRenderer.get());
+    }
+
+    if (kComputeStereoDepth && pLFSlateCameraRenderer && pRFSlateCameraRenderer)
+    {
+        m_stereoDepth = std::make_shared<StereoDepthProcessor>(m_pLFCameraSensor, m_pRFCameraSensor, kStereoOptions);
+
+        pLFSlateCameraRenderer->AddFrameCallBack(StereoDepthProcessor::LeftFrameCallback, m_stereoDepth.get());
+        pRFSlateCameraRenderer->AddFrameCallBack(StereoDepthProcessor::RightFrameCallback, m_stereoDepth.get());
     }
 }
 
@@ -395,6 +442,10 @@ void CalibrationProjectionVisualizationScenario::UpdateModels(DX::StepTimer &tim
         m_modelRenderers[i]->Update(timer);
     }
 
+    // The rays, the cube, the marker poses and the slates below all use these results
+    m_arucoDetectorLeft->FetchLatestResults();
+    m_arucoDetectorRight->FetchLatestResults();
+
     // for each of the two Aruco Detectors (TextureRenderers) rotates the ray in the respective
     // VectorModel renderer wrt the position of the Aruco marker in the camera frame.
     float x_l[2];
@@ -404,18 +455,11 @@ void CalibrationProjectionVisualizationScenario::UpdateModels(DX::StepTimer &tim
     ResearchModeSensorTimestamp timeStamp;
     bool double_detection = true;
 
-    if (m_arucoDetectorLeft->GetFirstCenter(uv_l, uv_l + 1, &timeStamp))
+    if (m_arucoDetectorLeft->GetFirstCenter(uv_l, uv_l + 1, &timeStamp) &&
+        m_LFUnitPlaneCache && SUCCEEDED(m_LFUnitPlaneCache->MapImagePointToCameraUnitPlane(uv_l, x_l)))
     {
-        HRESULT hr = S_OK;
-
-        IResearchModeCameraSensor* pCameraSensor = nullptr;
-        winrt::check_hresult(m_pLFCameraSensor->QueryInterface(IID_PPV_ARGS(&pCameraSensor)));
-        pCameraSensor->MapImagePointToCameraUnitPlane(uv_l, x_l);
-
         m_rayLeft->SetDirection(DirectX::XMFLOAT3(x_l[0], x_l[1], 1.0f));
         m_rayLeft->EnableRendering();
-
-        pCameraSensor->Release();
     }
     else
     {
@@ -423,21 +467,11 @@ void CalibrationProjectionVisualizationScenario::UpdateModels(DX::StepTimer &tim
         double_detection = false;
     }
 
-    if (m_arucoDetectorRight->GetFirstCenter(uv_r, uv_r + 1, &timeStamp))
+    if (m_arucoDetectorRight->GetFirstCenter(uv_r, uv_r + 1, &timeStamp) &&
+        m_RFUnitPlaneCache && SUCCEEDED(m_RFUnitPlaneCache->MapImagePointToCameraUnitPlane(uv_r, x_r)))
     {
-        HRESULT hr = S_OK;
-
-        if (m_stationaryReferenceFrame)
-            SpatialCoordinateSystem currentCoordinateSystem = m_stationaryReferenceFrame.CoordinateSystem();
-
-        IResearchModeCameraSensor* pCameraSensor = nullptr;
-        winrt::check_hresult(m_pRFCameraSensor->QueryInterface(IID_PPV_ARGS(&pCameraSensor)));
-        pCameraSensor->MapImagePointToCameraUnitPlane(uv_r, x_r);
-
         m_rayRight->SetDirection(DirectX::XMFLOAT3(x_r[0], x_r[1], 1.0f));
         m_rayRight->EnableRendering();
-
-        pCameraSensor->Release();
     }
     else
     {
@@ -449,12 +483,17 @@ void CalibrationProjectionVisualizationScenario::UpdateModels(DX::StepTimer &tim
     if (double_detection)
     {
         // compute the distance to target using stereoscopic vision:
-        float pixel_shift_x = uv_l[0] - 640.f + uv_r[0];
-        float pixel_shift_y = uv_l[1] - 480.f + uv_r[1];
-        float pixel_shift = sqrt(pixel_shift_x * pixel_shift_x + pixel_shift_y * pixel_shift_y);
-        if (pixel_shift < 19)
-            pixel_shift = 19.f;
-        float distance = 108.f * (1.f / pixel_shift) - .84f;
+        float distance;
+        if (!m_stereoDepth || !m_stereoDepth->GetDistance(uv_l[0], uv_l[1], &distance, nullptr))
+        {
+            // no disparity at the marker yet, estimate it from the pixel shift
+            float pixel_shift_x = uv_l[0] - 640.f + uv_r[0];
+            float pixel_shift_y = uv_l[1] - 480.f + uv_r[1];
+            float pixel_shift = sqrt(pixel_shift_x * pixel_shift_x + pixel_shift_y * pixel_shift_y);
+            if (pixel_shift < 19)
+                pixel_shift = 19.f;
+            distance = 108.f * (1.f / pixel_shift) - .84f;
+        }
         WriteToFile(uv_l[0], uv_l[1], uv_r[0], uv_r[1], x_l[0], x_l[1], x_r[0], x_r[1], distance);
         m_red_cube->SetPositionRelativeToHead(m_stationaryReferenceFrame.CoordinateSystem(), x_l[0], x_l[1], distance);
 
@@ -465,6 +504,65 @@ void CalibrationProjectionVisualizationScenario::UpdateModels(DX::StepTimer &tim
     //else
         //m_red_cube->DisableRendering();
         //m_red_cube->SetPosition(float3(0.f, 0.f, 0.f));
+
+    LocateMarkers();
+
+    // a located marker needs only one camera, and overrides the distance estimate
+    if (kPlaceCubeOnMarkerPose && !m_markerToWorld.empty())
+    {
+        const DirectX::XMFLOAT4X4& markerToWorld = m_markerToWorld[0];
+        m_red_cube->SetPosition(float3(markerToWorld._41, markerToWorld._42, markerToWorld._43));
+    }
+}
+
+bool CalibrationProjectionVisualizationScenario::LocateRig(const ResearchModeSensorTimestamp& timeStamp, DirectX::XMMATRIX& rigToWorld)
+{
+    if (!m_rigLocator || !m_stationaryReferenceFrame)
+    {
+        return false;
+    }
+
+    // HostTicks are on the QPC based 100 ns clock that perception timestamps convert from
+    auto timestamp = winrt::Windows::Perception::PerceptionTimestampHelper::FromSystemRelativeTargetTime(winrt::Windows::Foundation::TimeSpan(timeStamp.HostTicks));
+    SpatialLocation location = m_rigLocator.TryLocateAtTimestamp(timestamp, m_stationaryReferenceFrame.CoordinateSystem());
+    if (!location)
+    {
+        return false;
+    }
+
+    const quaternion orientation = location.Orientation();
+    const float3 position = location.Position();
+    rigToWorld = DirectX::XMMatrixRotationQuaternion(DirectX::XMVectorSet(orientation.x, orientation.y, orientation.z, orientation.w)) *
+        DirectX::XMMatrixTranslation(position.x, position.y, position.z);
+
+    return true;
+}
+
+void CalibrationProjectionVisualizationScenario::LocateMarkers()
+{
+    std::vector<MarkerPose> poses;
+    ResearchModeSensorTimestamp timeStamp;
+    DirectX::XMMATRIX rigToWorld;
+
+    m_markerPoses.clear();
+    m_markerToWorld.clear();
+
+    for (const auto& arucoDetector : { m_arucoDetectorLeft, m_arucoDetectorRight })
+    {
+        if (!arucoDetector->GetMarkerPoses(poses, &timeStamp) || !LocateRig(timeStamp, rigToWorld))
+        {
+            continue;
+        }
+
+        for (const MarkerPose& pose : poses)
+        {
+            DirectX::XMFLOAT4X4 markerToWorld;
+            DirectX::XMStoreFloat4x4(&markerToWorld, DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&pose.markerToRig), rigToWorld));
+
+            m_markerPoses.push_back(pose);
+            m_markerToWorld.push_back(markerToWorld);
+        }
+    }
 }
 
 void CalibrationProjectionVisualizationScenario::PositionCube(winrt::Windows::UI::Input::Spatial::SpatialPointerPose const& pointerPose)
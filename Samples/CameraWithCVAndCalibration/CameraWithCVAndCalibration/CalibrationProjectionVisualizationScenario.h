@@ -42,6 +42,8 @@ namespace BasicHologram
 
         void IntializeSensorFrameModelRendering();
         void InitializeArucoRendering();
+        bool LocateRig(const ResearchModeSensorTimestamp& timeStamp, DirectX::XMMATRIX& rigToWorld);
+        void LocateMarkers();
 
         IResearchModeSensorDevice *m_pSensorDevice;
         IResearchModeSensorDeviceConsent* m_pSensorDeviceConsent;
@@ -50,11 +52,18 @@ namespace BasicHologram
         DirectX::XMFLOAT4X4 m_LFCameraPose;
         DirectX::XMFLOAT4X4 m_LFCameraRotation;
         DirectX::XMFLOAT4 m_LFRotDeterminant;
+        std::shared_ptr<CameraUnitPlaneCache> m_LFUnitPlaneCache;
 
         IResearchModeSensor *m_pRFCameraSensor = nullptr;
         DirectX::XMFLOAT4X4 m_RFCameraPose;
         DirectX::XMFLOAT4X4 m_RFCameraRotation;
         DirectX::XMFLOAT4 m_RFRotDeterminant;
+        std::shared_ptr<CameraUnitPlaneCache> m_RFUnitPlaneCache;
+
+        winrt::Windows::Perception::Spatial::SpatialLocator m_rigLocator = nullptr;
+
+        // Declared before the renderers, so the camera threads that feed it stop first
+        std::shared_ptr<StereoDepthProcessor> m_stereoDepth;
 
         std::vector<std::shared_ptr<ModelRenderer>> m_modelRenderers;
         std::shared_ptr<VectorModel> m_rayLeft;
@@ -65,6 +74,10 @@ namespace BasicHologram
         std::shared_ptr<SlateFrameRendererWithCV> m_arucoDetectorRight;
 
         std::vector<std::shared_ptr<SlateFrameRendererWithCV>> m_arucoDetectors;
+
+        // Markers of the latest processed LF and RF frames, with their poses in the stationary frame in m_markerToWorld
+        std::vector<MarkerPose> m_markerPoses;
+        std::vector<DirectX::XMFLOAT4X4> m_markerToWorld;
         int m_state = 0;
     };
 }
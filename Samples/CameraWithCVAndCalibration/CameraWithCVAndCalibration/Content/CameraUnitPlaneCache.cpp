@@ -0,0 +1,97 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+#include "CameraUnitPlaneCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace BasicHologram;
+
+void CameraUnitPlaneCache::Build(IResearchModeCameraSensor *pCameraSensor, UINT width, UINT height)
+{
+    if (width == 0 || height == 0)
+    {
+        m_width = 0;
+        m_height = 0;
+        m_unitPlane.clear();
+        return;
+    }
+
+    const size_t stride = width + 1;
+
+    m_width = width;
+    m_height = height;
+    m_unitPlane.resize(2 * stride * (height + 1));
+
+    for (UINT v = 0; v <= height; v++)
+    {
+        for (UINT u = 0; u <= width; u++)
+        {
+            float uv[2] = { (float)u, (float)v };
+            float xy[2];
+            float *pPoint = &m_unitPlane[2 * (v * stride + u)];
+
+            if (SUCCEEDED(pCameraSensor->MapImagePointToCameraUnitPlane(uv, xy)))
+            {
+                pPoint[0] = xy[0];
+                pPoint[1] = xy[1];
+            }
+            else
+            {
+                pPoint[0] = std::numeric_limits<float>::quiet_NaN();
+                pPoint[1] = std::numeric_limits<float>::quiet_NaN();
+            }
+        }
+    }
+}
+
+HRESULT CameraUnitPlaneCache::MapImagePointToCameraUnitPlane(const float (&uv)[2], float (&xy)[2]) const
+{
+    // The grid below is indexed from m_width - 1 and m_height - 1
+    if (!IsBuilt())
+    {
+        return E_UNEXPECTED;
+    }
+
+    // Also rejects NaN coordinates
+    if (!(uv[0] >= 0.0f && uv[1] >= 0.0f && uv[0] <= m_width && uv[1] <= m_height))
+    {
+        return E_INVALIDARG;
+    }
+
+    // The last row and column interpolate towards themselves
+    const size_t stride = m_width + 1;
+    const UINT u0 = (std::min)((UINT)uv[0], m_width - 1);
+    const UINT v0 = (std::min)((UINT)uv[1], m_height - 1);
+    const float fu = uv[0] - u0;
+    const float fv = uv[1] - v0;
+
+    const float *pTop = &m_unitPlane[2 * (v0 * stride + u0)];
+    const float *pBottom = pTop + 2 * stride;
+
+    for (int k = 0; k < 2; k++)
+    {
+        const float top = pTop[k] + fu * (pTop[2 + k] - pTop[k]);
+        const float bottom = pBottom[k] + fu * (pBottom[2 + k] - pBottom[k]);
+        xy[k] = top + fv * (bottom - top);
+    }
+
+    // NaN spreads through the interpolation from any of the four points
+    if (std::isnan(xy[0]) || std::isnan(xy[1]))
+    {
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
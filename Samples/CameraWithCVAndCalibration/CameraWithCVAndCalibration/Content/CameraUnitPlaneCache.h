@@ -0,0 +1,43 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "researchmode\ResearchModeApi.h"
+
+namespace BasicHologram
+{
+    // MapImagePointToCameraUnitPlane sampled once at every integer image point, so that per frame lookups are
+    // a bilinear interpolation instead of a call into the sensor. Read only once built, it can be shared
+    // between threads.
+    class CameraUnitPlaneCache
+    {
+    public:
+        // Samples the (width + 1) x (height + 1) grid of integer points, the image corners included.
+        // An empty image leaves the cache unbuilt.
+        void Build(IResearchModeCameraSensor *pCameraSensor, UINT width, UINT height);
+
+        // Same signature and result as the sensor's, up to the interpolation between grid points.
+        // Fails outside the image, next to points the sensor could not map and before Build.
+        HRESULT MapImagePointToCameraUnitPlane(const float (&uv)[2], float (&xy)[2]) const;
+
+        bool IsBuilt() const { return m_width > 0 && m_height > 0; }
+        UINT GetWidth() const { return m_width; }
+        UINT GetHeight() const { return m_height; }
+
+    private:
+        UINT m_width = 0;
+        UINT m_height = 0;
+
+        // Interleaved x and y per grid point, NaN where the sensor failed
+        std::vector<float> m_unitPlane;
+    };
+}
@@ -0,0 +1,83 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+#include "MarkerPoseEstimator.h"
+
+#include <opencv2/calib3d.hpp>
+
+using namespace BasicHologram;
+using namespace DirectX;
+
+MarkerPoseEstimator::MarkerPoseEstimator(std::shared_ptr<const CameraUnitPlaneCache> unitPlaneCache, const XMFLOAT4X4& rigToCamera, float markerLength) :
+    m_unitPlaneCache(unitPlaneCache)
+{
+    XMMATRIX cameraPose = XMLoadFloat4x4(&rigToCamera);
+    XMVECTOR det = XMMatrixDeterminant(cameraPose);
+    XMStoreFloat4x4(&m_cameraToRig, XMMatrixInverse(&det, cameraPose));
+
+    // The corner order of cv::aruco::detectMarkers, which SOLVEPNP_IPPE_SQUARE expects
+    const float half = markerLength / 2.0f;
+    m_markerCorners = {
+        cv::Point3f(-half, half, 0.0f),
+        cv::Point3f(half, half, 0.0f),
+        cv::Point3f(half, -half, 0.0f),
+        cv::Point3f(-half, -half, 0.0f)
+    };
+    m_unitPlaneCorners.resize(4);
+}
+
+void MarkerPoseEstimator::EstimatePoses(const std::vector<int> &ids, const std::vector<std::vector<cv::Point2f>> &corners, std::vector<MarkerPose> &poses)
+{
+    // On the unit plane the camera matrix is the identity and there is no distortion left
+    static const cv::Matx33d identity = cv::Matx33d::eye();
+    const XMMATRIX cameraToRig = XMLoadFloat4x4(&m_cameraToRig);
+
+    poses.clear();
+
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        bool mapped = corners[i].size() == 4;
+        for (size_t k = 0; mapped && k < 4; k++)
+        {
+            float uv[2] = { corners[i][k].x, corners[i][k].y };
+            float xy[2];
+            mapped = SUCCEEDED(m_unitPlaneCache->MapImagePointToCameraUnitPlane(uv, xy));
+            m_unitPlaneCorners[k] = cv::Point2f(xy[0], xy[1]);
+        }
+        if (!mapped)
+        {
+            continue;
+        }
+
+        cv::Vec3d rvec;
+        cv::Vec3d tvec;
+        if (!cv::solvePnP(m_markerCorners, m_unitPlaneCorners, identity, cv::noArray(), rvec, tvec, false, cv::SOLVEPNP_IPPE_SQUARE))
+        {
+            continue;
+        }
+
+        cv::Matx33d rotation;
+        cv::Rodrigues(rvec, rotation);
+
+        // OpenCV maps column vectors, the transpose maps rows
+        MarkerPose pose;
+        pose.id = ids[i];
+        pose.markerToCamera = XMFLOAT4X4(
+            (float)rotation(0, 0), (float)rotation(1, 0), (float)rotation(2, 0), 0.0f,
+            (float)rotation(0, 1), (float)rotation(1, 1), (float)rotation(2, 1), 0.0f,
+            (float)rotation(0, 2), (float)rotation(1, 2), (float)rotation(2, 2), 0.0f,
+            (float)tvec[0], (float)tvec[1], (float)tvec[2], 1.0f);
+        XMStoreFloat4x4(&pose.markerToRig, XMMatrixMultiply(XMLoadFloat4x4(&pose.markerToCamera), cameraToRig));
+
+        poses.push_back(pose);
+    }
+}
@@ -0,0 +1,48 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "CameraUnitPlaneCache.h"
+
+#include <opencv2/core.hpp>
+
+namespace BasicHologram
+{
+    // Transforms apply to row vectors, like the camera extrinsics. The marker frame has its origin at the marker
+    // center, x along the first edge (first to second corner), y along the fourth (fourth to first corner) and
+    // z out of the printed side.
+    struct MarkerPose
+    {
+        int id;
+        DirectX::XMFLOAT4X4 markerToCamera;
+        DirectX::XMFLOAT4X4 markerToRig;
+    };
+
+    // 6-DoF poses of square markers seen by one camera. The corners go through the camera's unit plane cache,
+    // so the fisheye model is the sensor's own, and then through an IPPE square pose solver.
+    class MarkerPoseEstimator
+    {
+    public:
+        // rigToCamera is the sensor's GetCameraExtrinsicsMatrix, markerLength the side of the black square in meters
+        MarkerPoseEstimator(std::shared_ptr<const CameraUnitPlaneCache> unitPlaneCache, const DirectX::XMFLOAT4X4& rigToCamera, float markerLength);
+
+        // Poses of all the markers of a frame, in detection order. Markers with a corner the cache can't map are left out.
+        void EstimatePoses(const std::vector<int> &ids, const std::vector<std::vector<cv::Point2f>> &corners, std::vector<MarkerPose> &poses);
+
+    private:
+        std::shared_ptr<const CameraUnitPlaneCache> m_unitPlaneCache;
+        DirectX::XMFLOAT4X4 m_cameraToRig;
+
+        std::vector<cv::Point3f> m_markerCorners;
+        std::vector<cv::Point2f> m_unitPlaneCorners;
+    };
+}
@@ -35,7 +35,8 @@ void ProcessRmFrameWithAruco(IResearchModeSensorFrame* pSensorFrame, cv::Mat& cv
         cv::Mat processed(resolution.Height, resolution.Width, CV_8U, (void*)pImage);
         cv::aruco::detectMarkers(processed, dictionary, corners, ids);
 
-        cvResultMat = processed;
+        // The result outlives the frame, and the frame buffer is shared with the other frame callbacks
+        processed.copyTo(cvResultMat);
 
         // if at least one marker detected
         if (ids.size() > 0)
@@ -48,7 +49,6 @@ void ProcessRmFrameWithAruco(IResearchModeSensorFrame* pSensorFrame, cv::Mat& cv
     }
 }
 
-
 void ProcessRmFrameWithCanny(IResearchModeSensorFrame* pSensorFrame, cv::Mat& cvResultMat)
 {
     HRESULT hr = S_OK;
@@ -0,0 +1,285 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Converts sensor images to the BGRA8 slate textures. Header only and free of Windows dependencies,
+// so it can be benchmarked off device.
+//
+// The orientation is a template parameter, picked once per frame from the sensor type, so the per pixel
+// loops have no branches. Gray images are expanded 16 pixels at a time with NEON on ARM64 and SSE2 on x64.
+// 16-bit depth and active brightness images go through a 64K entry color table, which replaces the per pixel
+// clamp and float divide; table lookups are gathers, which neither instruction set has, so they stay scalar.
+//
+// Strides and pitches are in bytes. Output pixels are B = G = R = gray with alpha 0, as the renderers wrote them.
+// Define SENSOR_TEXTURE_KERNELS_NO_SIMD to use the scalar loops everywhere.
+
+#if !defined(SENSOR_TEXTURE_KERNELS_NO_SIMD)
+#if defined(_M_ARM64) || defined(__aarch64__)
+#define SENSOR_TEXTURE_KERNELS_NEON
+#include <arm_neon.h>
+#elif defined(_M_X64) || defined(__SSE2__)
+#define SENSOR_TEXTURE_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+namespace BasicHologram
+{
+    namespace SensorTextureKernels
+    {
+        // Where source pixel (x, y) of a width x height image lands in the texture
+        enum class Orientation
+        {
+            Identity,               // (x, y)
+            MirrorX,                // (width - 1 - x, y), left front camera
+            MirrorY,                // (x, height - 1 - y), right front camera
+            Rotate180,              // (width - 1 - x, height - 1 - y)
+            Rotate90Clockwise,      // (height - 1 - y, x), the texture is height x width
+            Rotate90CounterClockwise// (y, width - 1 - x), the texture is height x width
+        };
+
+        enum class Colormap
+        {
+            Gray,
+            Jet
+        };
+
+        namespace Detail
+        {
+            inline uint32_t GrayToBgra(uint8_t gray)
+            {
+                return gray | (gray << 8) | (gray << 16);
+            }
+
+            template<typename T>
+            inline const T* Row(const T* pImage, size_t stride, uint32_t y)
+            {
+                return reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(pImage) + stride * y);
+            }
+
+            template<typename T>
+            inline T* Row(T* pImage, size_t stride, uint32_t y)
+            {
+                return reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(pImage) + stride * y);
+            }
+
+            // Expands one row, writing it backwards when mirrored
+            template<bool Mirrored>
+            inline void Gray8RowToBgra(const uint8_t* pSrc, uint32_t width, uint32_t* pDst)
+            {
+                uint32_t x = 0;
+#if defined(SENSOR_TEXTURE_KERNELS_NEON)
+                const uint8x16_t zero = vdupq_n_u8(0);
+                for (; x + 16 <= width; x += 16)
+                {
+                    uint8x16_t gray = vld1q_u8(pSrc + x);
+                    uint8_t* pOut = reinterpret_cast<uint8_t*>(pDst + (Mirrored ? width - x - 16 : x));
+                    if (Mirrored)
+                    {
+                        gray = vrev64q_u8(gray);
+                        gray = vextq_u8(gray, gray, 8);
+                    }
+                    uint8x16x4_t bgra;
+                    bgra.val[0] = gray;
+                    bgra.val[1] = gray;
+                    bgra.val[2] = gray;
+                    bgra.val[3] = zero;
+                    vst4q_u8(pOut, bgra);
+                }
+#elif defined(SENSOR_TEXTURE_KERNELS_SSE2)
+                const __m128i zero = _mm_setzero_si128();
+                for (; x + 16 <= width; x += 16)
+                {
+                    const __m128i gray = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + x));
+                    const __m128i grayGrayLow = _mm_unpacklo_epi8(gray, gray);
+                    const __m128i grayGrayHigh = _mm_unpackhi_epi8(gray, gray);
+                    const __m128i grayZeroLow = _mm_unpacklo_epi8(gray, zero);
+                    const __m128i grayZeroHigh = _mm_unpackhi_epi8(gray, zero);
+                    __m128i bgra[4] = {
+                        _mm_unpacklo_epi16(grayGrayLow, grayZeroLow),
+                        _mm_unpackhi_epi16(grayGrayLow, grayZeroLow),
+                        _mm_unpacklo_epi16(grayGrayHigh, grayZeroHigh),
+                        _mm_unpackhi_epi16(grayGrayHigh, grayZeroHigh)
+                    };
+                    if (Mirrored)
+                    {
+                        __m128i* pOut = reinterpret_cast<__m128i*>(pDst + width - x - 16);
+                        for (int i = 0; i < 4; ++i)
+                        {
+                            _mm_storeu_si128(pOut + 3 - i, _mm_shuffle_epi32(bgra[i], _MM_SHUFFLE(0, 1, 2, 3)));
+                        }
+                    }
+                    else
+                    {
+                        __m128i* pOut = reinterpret_cast<__m128i*>(pDst + x);
+                        for (int i = 0; i < 4; ++i)
+                        {
+                            _mm_storeu_si128(pOut + i, bgra[i]);
+                        }
+                    }
+                }
+#endif
+                for (; x < width; ++x)
+                {
+                    pDst[Mirrored ? width - 1 - x : x] = GrayToBgra(pSrc[x]);
+                }
+            }
+
+            // Rotations write columns, done in tiles so the texture rows stay in cache
+            template<Orientation O, typename ConvertPixel>
+            inline void RotateImage(uint32_t width, uint32_t height, uint32_t* pDst, size_t dstPitch, ConvertPixel convert)
+            {
+                constexpr uint32_t kTile = 32;
+                for (uint32_t tileY = 0; tileY < height; tileY += kTile)
+                {
+                    const uint32_t endY = (tileY + kTile < height) ? tileY + kTile : height;
+                    for (uint32_t tileX = 0; tileX < width; tileX += kTile)
+                    {
+                        const uint32_t endX = (tileX + kTile < width) ? tileX + kTile : width;
+                        for (uint32_t x = tileX; x < endX; ++x)
+                        {
+                            const uint32_t dstY = (O == Orientation::Rotate90Clockwise) ? x : width - 1 - x;
+                            uint32_t* pDstRow = Row(pDst, dstPitch, dstY);
+                            for (uint32_t y = tileY; y < endY; ++y)
+                            {
+                                const uint32_t dstX = (O == Orientation::Rotate90Clockwise) ? height - 1 - y : y;
+                                pDstRow[dstX] = convert(x, y);
+                            }
+                        }
+                    }
+                }
+            }
+
+            constexpr bool IsRotation(Orientation o)
+            {
+                return o == Orientation::Rotate90Clockwise || o == Orientation::Rotate90CounterClockwise;
+            }
+
+            constexpr bool IsMirroredX(Orientation o)
+            {
+                return o == Orientation::MirrorX || o == Orientation::Rotate180;
+            }
+
+            constexpr bool IsMirroredY(Orientation o)
+            {
+                return o == Orientation::MirrorY || o == Orientation::Rotate180;
+            }
+        }
+
+        // Gray8 image to BGRA texture
+        template<Orientation O>
+        void Gray8ToBgra(const uint8_t* pSrc, size_t srcStride, uint32_t width, uint32_t height, uint32_t* pDst, size_t dstPitch)
+        {
+            if constexpr (Detail::IsRotation(O))
+            {
+                Detail::RotateImage<O>(width, height, pDst, dstPitch,
+                    [=](uint32_t x, uint32_t y) { return Detail::GrayToBgra(Detail::Row(pSrc, srcStride, y)[x]); });
+            }
+            else
+            {
+                for (uint32_t y = 0; y < height; ++y)
+                {
+                    const uint32_t dstY = Detail::IsMirroredY(O) ? height - 1 - y : y;
+                    Detail::Gray8RowToBgra<Detail::IsMirroredX(O)>(Detail::Row(pSrc, srcStride, y), width, Detail::Row(pDst, dstPitch, dstY));
+                }
+            }
+        }
+
+        // Color of every 16-bit value. Values up to minValue are black, values from maxValue on get the top color,
+        // values above invalidAbove (when not 0) are treated as 0. The gray ramp matches the renderers' former
+        // per pixel conversion exactly.
+        inline void BuildColorLut(std::vector<uint32_t>& lut, uint16_t minValue, uint16_t maxValue, uint16_t invalidAbove, Colormap colormap)
+        {
+            lut.resize(0x10000);
+            for (uint32_t v = 0; v < 0x10000; ++v)
+            {
+                const uint32_t value = (invalidAbove != 0 && v > invalidAbove) ? 0 : v;
+                float colorValue = 0.0f;
+                if (value <= minValue)
+                {
+                    colorValue = 0.0f;
+                }
+                else if (value >= maxValue)
+                {
+                    colorValue = 1.0f;
+                }
+                else
+                {
+                    colorValue = (float)(value - minValue) / (float)(maxValue - minValue);
+                }
+
+                if (colormap == Colormap::Gray || value <= minValue)
+                {
+                    lut[v] = Detail::GrayToBgra((uint8_t)(colorValue * 255));
+                    continue;
+                }
+
+                // Jet: blue, cyan, yellow, red
+                auto channel = [](float t) -> uint32_t
+                {
+                    const float c = 1.5f - (t < 0.0f ? -t : t);
+                    return (uint32_t)((c < 0.0f ? 0.0f : (c > 1.0f ? 1.0f : c)) * 255.0f);
+                };
+                const float t = colorValue * 4.0f - 2.0f;
+                lut[v] = channel(t + 1.0f) | (channel(t) << 8) | (channel(t - 1.0f) << 16);
+            }
+        }
+
+        // 16-bit depth or active brightness image to BGRA texture through a BuildColorLut table.
+        // Pixels whose sigma has a bit of sigmaMask set get the color of 0 (Long Throw invalidation);
+        // pass a null pSigma when there is no sigma buffer.
+        template<Orientation O>
+        void Depth16ToBgra(const uint16_t* pSrc, size_t srcStride, const uint8_t* pSigma, size_t sigmaStride, uint8_t sigmaMask,
+                           uint32_t width, uint32_t height, const uint32_t* pLut, uint32_t* pDst, size_t dstPitch)
+        {
+            const bool masked = pSigma != nullptr && sigmaMask != 0;
+
+            if constexpr (Detail::IsRotation(O))
+            {
+                Detail::RotateImage<O>(width, height, pDst, dstPitch,
+                    [=](uint32_t x, uint32_t y)
+                    {
+                        const uint16_t value = Detail::Row(pSrc, srcStride, y)[x];
+                        return pLut[(masked && (Detail::Row(pSigma, sigmaStride, y)[x] & sigmaMask)) ? 0 : value];
+                    });
+                return;
+            }
+
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                const uint16_t* pSrcRow = Detail::Row(pSrc, srcStride, y);
+                uint32_t* pDstRow = Detail::Row(pDst, dstPitch, Detail::IsMirroredY(O) ? height - 1 - y : y);
+                if (masked)
+                {
+                    const uint8_t* pSigmaRow = Detail::Row(pSigma, sigmaStride, y);
+                    for (uint32_t x = 0; x < width; ++x)
+                    {
+                        // Branchless: an invalid pixel reads entry 0
+                        const uint32_t valid = (pSigmaRow[x] & sigmaMask) == 0;
+                        pDstRow[Detail::IsMirroredX(O) ? width - 1 - x : x] = pLut[pSrcRow[x] * valid];
+                    }
+                }
+                else
+                {
+                    for (uint32_t x = 0; x < width; ++x)
+                    {
+                        pDstRow[Detail::IsMirroredX(O) ? width - 1 - x : x] = pLut[pSrcRow[x]];
+                    }
+                }
+            }
+        }
+    }
+}
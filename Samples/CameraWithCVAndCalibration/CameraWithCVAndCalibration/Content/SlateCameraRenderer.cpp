@@ -77,9 +77,9 @@ void SlateCameraRenderer::CameraUpdateThread(SlateCameraRenderer* pSlateCameraRe
 
         std::lock_guard<std::mutex> guard(pSlateCameraRenderer->m_mutex);
 
-        if (pSlateCameraRenderer->m_frameCallback)
+        for (const auto& frameCallback : pSlateCameraRenderer->m_frameCallbacks)
         {
-            pSlateCameraRenderer->m_frameCallback(pSensorFrame, pSlateCameraRenderer->m_frameCtx);
+            frameCallback.first(pSensorFrame, frameCallback.second);
         }
 
         if (pSlateCameraRenderer->m_pSensorFrame)
@@ -122,36 +122,6 @@ void SlateCameraRenderer::EnsureTextureForCameraFrame(IResearchModeSensorFrame*
     }
 }
 
-BYTE ConvertDepthPixel(USHORT v, BYTE bSigma, USHORT mask, USHORT maxshort, const int vmin, const int vmax)
-{
-    if ((mask != 0) && (bSigma & mask) > 0)
-    {
-        v = 0;
-    }
-
-    if ((maxshort != 0) && (v > maxshort))
-    {
-        v = 0;
-    }
-    
-    float colorValue = 0.0f;
-    if (v <= vmin)
-    {
-        colorValue = 0.0f;
-    }
-    else if (v >= vmax)
-    {
-        colorValue = 1.0f;
-    }
-    else
-    {
-        colorValue = (float)(v - vmin) / (float)(vmax - vmin);
-    }
-
-    return (BYTE)(colorValue * 255);
-}
-
-
 void SlateCameraRenderer::UpdateTextureFromCameraFrame(IResearchModeSensorFrame* pSensorFrame, std::shared_ptr<Texture2D> texture2D)
 {
 	HRESULT hr = S_OK;
@@ -161,6 +131,7 @@ void SlateCameraRenderer::UpdateTextureFromCameraFrame(IResearchModeSensorFrame*
     IResearchModeSensorDepthFrame *pDepthFrame = nullptr;
 	size_t outBufferCount = 0;
     const BYTE *pImage = nullptr;
+    const ResearchModeSensorType sensorType = m_pRMCameraSensor->GetSensorType();
 
     pSensorFrame->GetResolution(&resolution);
 
@@ -175,84 +146,59 @@ void SlateCameraRenderer::UpdateTextureFromCameraFrame(IResearchModeSensorFrame*
 	{
 		pVLCFrame->GetBuffer(&pImage, &outBufferCount);
 
-        void* mappedTexture =
-            texture2D->MapCPUTexture<void>(
+        UINT32* mappedTexture =
+            texture2D->MapCPUTexture<UINT32>(
                 D3D11_MAP_WRITE /* mapType */);
+        const size_t rowPitch = texture2D->GetRowPitch();
 
-        for (UINT i = 0; i < resolution.Height; i++)
+        if (sensorType == LEFT_FRONT)
         {
-            for (UINT j = 0; j < resolution.Width; j++)
-            {
-                UINT32 pixel = 0;
-                BYTE inputPixel = pImage[resolution.Width * i + j];
-                pixel = inputPixel | (inputPixel << 8) | (inputPixel << 16);
-
-                if (m_pRMCameraSensor->GetSensorType() == LEFT_FRONT)
-                {
-                    *((UINT32*)(mappedTexture)+((texture2D->GetRowPitch() / 4) * i + (resolution.Width - j - 1))) = pixel;
-                }
-                else if (m_pRMCameraSensor->GetSensorType() == RIGHT_FRONT)
-                {
-                    *((UINT32*)(mappedTexture)+((texture2D->GetRowPitch() / 4) * (resolution.Height - i - 1) + j)) = pixel;
-                }
-                else
-                {
-                    *((UINT32*)(mappedTexture)+((m_texture2D->GetRowPitch() / 4) * i + j)) = pixel;
-                }
-            }
+            SensorTextureKernels::Gray8ToBgra<SensorTextureKernels::Orientation::MirrorX>(pImage, resolution.Width, resolution.Width, resolution.Height, mappedTexture, rowPitch);
+        }
+        else if (sensorType == RIGHT_FRONT)
+        {
+            SensorTextureKernels::Gray8ToBgra<SensorTextureKernels::Orientation::MirrorY>(pImage, resolution.Width, resolution.Width, resolution.Height, mappedTexture, rowPitch);
+        }
+        else
+        {
+            SensorTextureKernels::Gray8ToBgra<SensorTextureKernels::Orientation::Identity>(pImage, resolution.Width, resolution.Width, resolution.Height, mappedTexture, rowPitch);
         }
 	}
 
     if (pDepthFrame)
     {
-        int maxClampDepth = 0;
-        USHORT maxshort = 0;
-        USHORT mask = 0;
+        BYTE sigmaMask = 0;
         const BYTE *pSigma = nullptr;
 
-        if (m_pRMCameraSensor->GetSensorType() == DEPTH_LONG_THROW)
-        {
-            mask = 0x80;
-            maxClampDepth = 4000;
-        }
-        else if (m_pRMCameraSensor->GetSensorType() == DEPTH_AHAT)
+        if (m_depthLut.empty())
         {
-            mask = 0x0;
-            maxClampDepth = 1000;
-            maxshort = 4090;
+            // Long Throw clamps at 4 m, AHaT at 1 m and marks invalid pixels with values above 4090
+            if (sensorType == DEPTH_LONG_THROW)
+            {
+                SensorTextureKernels::BuildColorLut(m_depthLut, 0, 4000, 0, SensorTextureKernels::Colormap::Gray);
+            }
+            else
+            {
+                SensorTextureKernels::BuildColorLut(m_depthLut, 0, 1000, 4090, SensorTextureKernels::Colormap::Gray);
+            }
         }
 
-        if (m_pRMCameraSensor->GetSensorType() == DEPTH_LONG_THROW)
+        if (sensorType == DEPTH_LONG_THROW)
         {
+            sigmaMask = 0x80;
             hr = pDepthFrame->GetSigmaBuffer(&pSigma, &outBufferCount);
         }
 
         const UINT16 *pDepth = nullptr;
         pDepthFrame->GetBuffer(&pDepth, &outBufferCount);
 
-        void* mappedTexture =
-            texture2D->MapCPUTexture<void>(
+        UINT32* mappedTexture =
+            texture2D->MapCPUTexture<UINT32>(
                 D3D11_MAP_WRITE /* mapType */);
 
-        for (UINT i = 0; i < resolution.Height; i++)
-        {
-            for (UINT j = 0; j < resolution.Width; j++)
-            {
-                UINT32 pixel = 0;
-                //BYTE inputPixel = pImage[resolution.Width * i + j];
-                BYTE inputPixel = ConvertDepthPixel(
-                    pDepth[resolution.Width * i + j],
-                    pSigma[resolution.Width * i + j],
-                    mask,
-                    maxshort,
-                    0,
-                    maxClampDepth);
-
-                pixel = inputPixel | (inputPixel << 8) | (inputPixel << 16);
-
-                *((UINT32*)(mappedTexture)+((m_texture2D->GetRowPitch() / 4) * i + j)) = pixel;
-            }
-        }
+        SensorTextureKernels::Depth16ToBgra<SensorTextureKernels::Orientation::Identity>(
+            pDepth, resolution.Width * sizeof(UINT16), pSigma, resolution.Width, sigmaMask,
+            resolution.Width, resolution.Height, m_depthLut.data(), mappedTexture, texture2D->GetRowPitch());
     }
     
 	if (pVLCFrame)
@@ -16,6 +16,7 @@
 #include "ShaderStructures.h"
 #include "researchmode\ResearchModeApi.h"
 #include "ModelRenderer.h"
+#include "SensorTextureKernels.h"
 
 namespace BasicHologram
 {
@@ -29,7 +30,6 @@ namespace BasicHologram
             m_pRMCameraSensor = pLLSensor;
             m_pRMCameraSensor->AddRef();
             m_pSensorFrame = nullptr;
-            m_frameCallback = nullptr;
 
             m_pixelShaderFile = L"ms-appx:///PixelShader.cso";
 
@@ -52,10 +52,11 @@ namespace BasicHologram
             return DirectX::XMMatrixRotationAxis(DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f), -DirectX::XM_PIDIV2);
         }
 
-        void SetFrameCallBack(std::function<void(IResearchModeSensorFrame*, PVOID frameCtx)> frameCallback, PVOID frameCtx)
+        // Every callback gets each frame, in the order they were added, on the camera thread
+        void AddFrameCallBack(std::function<void(IResearchModeSensorFrame*, PVOID frameCtx)> frameCallback, PVOID frameCtx)
         {
-            m_frameCallback = frameCallback;
-            m_frameCtx = frameCtx;
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_frameCallbacks.emplace_back(frameCallback, frameCtx);
         }
 
     protected:
@@ -74,10 +75,12 @@ namespace BasicHologram
 		IResearchModeSensor *m_pRMCameraSensor = nullptr;
 		IResearchModeSensorFrame* m_pSensorFrame;
 
-        std::function<void(IResearchModeSensorFrame*, PVOID frameCtx)> m_frameCallback;
-        PVOID m_frameCtx;
+        std::vector<std::pair<std::function<void(IResearchModeSensorFrame*, PVOID frameCtx)>, PVOID>> m_frameCallbacks;
 
         std::thread *m_pCameraUpdateThread;
         bool m_fExit = { false };
+
+        // Depth to texture colors, built with the first depth frame
+        std::vector<uint32_t> m_depthLut;
     };
 }
@@ -20,7 +20,7 @@ using namespace DirectX;
 using namespace winrt::Windows::Foundation::Numerics;
 using namespace winrt::Windows::UI::Input::Spatial;
 
-void SlateFrameRendererWithCV::UpdateSlateTextureWithBitmap(const BYTE *pImage, UINT uWidth, UINT uHeight)
+void SlateFrameRendererWithCV::UpdateSlateTextureWithBitmap(const BYTE *pImage, UINT uWidth, UINT uHeight, size_t uStride)
 {
     // update m_texture2D
     if (uWidth != m_Width || uHeight != m_Height)
@@ -32,19 +32,12 @@ void SlateFrameRendererWithCV::UpdateSlateTextureWithBitmap(const BYTE *pImage,
 
     EnsureSlateTexture();
 
-    void* mappedTexture =
-        m_texture2D->MapCPUTexture<void>(
+    UINT32* mappedTexture =
+        m_texture2D->MapCPUTexture<UINT32>(
             D3D11_MAP_WRITE /* mapType */);
 
-    for (UINT i = 0; i < uWidth * uHeight; i++)
-    {
-        UINT32 pixel = 0;
-        BYTE inputPixel = pImage[i];
-
-        pixel = inputPixel | (inputPixel << 8) | (inputPixel << 16);
-
-        *((UINT32*)(mappedTexture)+(i)) = pixel;
-    }
+    SensorTextureKernels::Gray8ToBgra<SensorTextureKernels::Orientation::Identity>(
+        pImage, uStride, uWidth, uHeight, mappedTexture, m_texture2D->GetRowPitch());
 
     m_texture2D->UnmapCPUTexture();
     m_texture2D->CopyCPU2GPU();
@@ -170,43 +163,15 @@ void SlateFrameRendererWithCV::GetModelTriangleIndices(std::vector<unsigned shor
 
 void SlateFrameRendererWithCV::UpdateSlateTexture()
 {
-    HRESULT hr = S_OK;
+    const ProcessedFrame& processedFrame = m_resultMailbox.GetReadBuffer();
 
-    ResearchModeSensorResolution resolution;
-    IResearchModeSensorVLCFrame *pVLCFrame = nullptr;
-    size_t outBufferCount = 0;
-    const BYTE *pImage = nullptr;
-
-    if (m_pSensorFrame == nullptr)
+    if (processedFrame.frameNumber == m_textureFrameNumber || processedFrame.image.data == nullptr)
     {
         return;
     }
 
-    m_pSensorFrame->GetResolution(&resolution);
-
-    hr = m_pSensorFrame->QueryInterface(IID_PPV_ARGS(&pVLCFrame));
-
-    if (SUCCEEDED(hr))
-    {
-        pVLCFrame->GetBuffer(&pImage, &outBufferCount);
-    }
-
-    if (m_cvResultMat.data == nullptr)
-    {
-        UpdateSlateTextureWithBitmap(pImage, resolution.Width, resolution.Height);
-    }
-    else
-    {
-        UpdateSlateTextureWithBitmap(m_cvResultMat.data, resolution.Width, resolution.Height);
-    }
-
-    if (pVLCFrame)
-    {
-        pVLCFrame->Release();
-    }
-
-    m_pSensorFrame->Release();
-    m_pSensorFrame = nullptr;
+    UpdateSlateTextureWithBitmap(processedFrame.image.data, processedFrame.image.cols, processedFrame.image.rows, processedFrame.image.step);
+    m_textureFrameNumber = processedFrame.frameNumber;
 }
 
 void SlateFrameRendererWithCV::EnsureSlateTexture()
@@ -222,75 +187,90 @@ void SlateFrameRendererWithCV::EnsureSlateTexture()
 
 void SlateFrameRendererWithCV::FrameProcessing()
 {
-    HRESULT hr = S_OK;
+    uint64_t frameNumber = 0;
 
     while (!m_fExit)
     {
         WaitForSingleObject(m_hFrameEvent, INFINITE);
 
-        //Sleep(500);
+        // Also woken for frames already taken with an earlier fetch, and to exit
+        if (!m_frameMailbox.Fetch() || !m_frameMailbox.GetReadBuffer())
         {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            {
-                std::lock_guard<std::mutex> frameguard(m_frameMutex);
-
-                if (m_pSensorFrameIn == nullptr)
-                {
-                    return;
-                }
-                if (m_pSensorFrame)
-                {
-                    m_pSensorFrame->Release();
-                }
-                m_pSensorFrame = m_pSensorFrameIn;
-                m_pSensorFrameIn = nullptr;
-            }
-
-            {
-                std::lock_guard<std::mutex> guard(m_cornerMutex);
-
-                m_corners.clear();
-                m_ids.clear();
+            continue;
+        }
 
-                m_cvFrameProcessor(m_pSensorFrame, m_cvResultMat, m_ids, m_corners);
+        IResearchModeSensorFrame* pSensorFrame = m_frameMailbox.GetReadBuffer().Get();
+        ProcessedFrame& processedFrame = m_resultMailbox.GetWriteBuffer();
 
-                m_centers.clear();
+        processedFrame.ids.clear();
+        processedFrame.corners.clear();
+        processedFrame.poses.clear();
+        processedFrame.image.release();
 
-                for (int i = 0; i < m_corners.size(); i++)
-                {
-                    float sumx = 0.0f;
-                    float sumy = 0.0f;
-                    cv::Point2f center;
+        m_cvFrameProcessor(pSensorFrame, processedFrame.image, processedFrame.ids, processedFrame.corners);
 
-                    for (int j = 0; j < m_corners[i].size(); j++)
-                    {
-                        sumx += m_corners[i][j].x;
-                        sumy += m_corners[i][j].y;
-                    }
+        // Processors that leave no image show the camera image
+        if (processedFrame.image.data == nullptr)
+        {
+            ResearchModeSensorResolution resolution;
+            IResearchModeSensorVLCFrame *pVLCFrame = nullptr;
+            size_t outBufferCount = 0;
+            const BYTE *pImage = nullptr;
 
-                    center.x = sumx / 4.0f;
-                    center.y = sumy / 4.0f;
+            pSensorFrame->GetResolution(&resolution);
+            if (SUCCEEDED(pSensorFrame->QueryInterface(IID_PPV_ARGS(&pVLCFrame))))
+            {
+                pVLCFrame->GetBuffer(&pImage, &outBufferCount);
+                cv::Mat(resolution.Height, resolution.Width, CV_8U, (void*)pImage).copyTo(processedFrame.image);
+                pVLCFrame->Release();
+            }
+        }
 
-                    m_centers.push_back(center);
-                }
+        if (m_markerPoseEstimator)
+        {
+            m_markerPoseEstimator->EstimatePoses(processedFrame.ids, processedFrame.corners, processedFrame.poses);
+        }
 
-                m_pSensorFrame->GetTimeStamp(&m_timeStamp);
-            }
+        pSensorFrame->GetTimeStamp(&processedFrame.timeStamp);
+        processedFrame.frameNumber = ++frameNumber;
 
+        // Nothing refers to the frame any more
+        m_frameMailbox.GetReadBuffer().Reset();
 
-            ResetEvent(m_hFrameEvent);
-        }
+        m_resultMailbox.Publish();
+        m_processedFrameCount++;
     }
 }
 
+void SlateFrameRendererWithCV::FetchLatestResults()
+{
+    // Without a new result the previous one stays in the read buffer
+    m_resultMailbox.Fetch();
+}
+
 bool SlateFrameRendererWithCV::GetFirstCenter(float *px, float *py, ResearchModeSensorTimestamp *pTimeStamp)
 {
-    std::lock_guard<std::mutex> guard(m_cornerMutex);
+    const ProcessedFrame& processedFrame = m_resultMailbox.GetReadBuffer();
 
-    if (m_centers.size() >= 1)
+    // Only the first marker is ever asked for, so its center is computed here rather than every marker's per frame
+    if (processedFrame.corners.size() >= 1)
     {
-        *px = m_centers[0].x;
-        *py = m_centers[0].y;
+        float sumx = 0.0f;
+        float sumy = 0.0f;
+
+        for (const cv::Point2f& corner : processedFrame.corners[0])
+        {
+            sumx += corner.x;
+            sumy += corner.y;
+        }
+
+        *px = sumx / 4.0f;
+        *py = sumy / 4.0f;
+
+        if (pTimeStamp)
+        {
+            *pTimeStamp = processedFrame.timeStamp;
+        }
 
         return true;
     }
@@ -298,13 +278,28 @@ bool SlateFrameRendererWithCV::GetFirstCenter(float *px, float *py, ResearchMode
     return false;
 }
 
+bool SlateFrameRendererWithCV::GetMarkerPoses(std::vector<MarkerPose> &poses, ResearchModeSensorTimestamp *pTimeStamp)
+{
+    const ProcessedFrame& processedFrame = m_resultMailbox.GetReadBuffer();
+
+    poses = processedFrame.poses;
+    if (pTimeStamp)
+    {
+        *pTimeStamp = processedFrame.timeStamp;
+    }
+
+    return !poses.empty();
+}
+
 void SlateFrameRendererWithCV::FrameProcessingThread(SlateFrameRendererWithCV* pSlateFrameRendererWithCV)
 {
     pSlateFrameRendererWithCV->FrameProcessing();
 }
 
-void SlateFrameRendererWithCV::StartCVProcessing(BYTE bright)
+void SlateFrameRendererWithCV::StartCVProcessing(BYTE bright, std::shared_ptr<MarkerPoseEstimator> markerPoseEstimator)
 {
+    m_markerPoseEstimator = markerPoseEstimator;
+
     m_Width = 200;
     m_Height = 200;
     m_texture2D = nullptr;
@@ -16,6 +16,9 @@
 #include "researchmode\ResearchModeApi.h"
 #include "ShaderStructures.h"
 #include "ModelRenderer.h"
+#include "SensorTextureKernels.h"
+#include "MarkerPoseEstimator.h"
+#include "TripleBuffer.h"
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>  // cv::Canny()
 #include <opencv2/aruco.hpp>
@@ -23,6 +26,9 @@
 
 namespace BasicHologram
 {
+    // Frames reach the processing thread, and results the app thread, through latest-wins mailboxes: the camera
+    // thread never waits for the processing, which never waits for the rendering. Frames that arrive while one
+    // is being processed replace each other, only the newest gets processed.
     class SlateFrameRendererWithCV :
         public ModelRenderer
     {
@@ -33,48 +39,67 @@ namespace BasicHologram
         {
             m_Width = 0;
             m_Height = 0;
-            m_pSensorFrame = nullptr;
-            m_pSensorFrameIn = nullptr;
             m_hFrameEvent = NULL;
 
             m_pixelShaderFile = L"ms-appx:///PixelShader.cso";
 
             m_fExit = false;
-            m_hFrameEvent = CreateEvent(NULL, true, false, NULL);
+            m_hFrameEvent = CreateEvent(NULL, false, false, NULL);
 
             m_cvFrameProcessor = cvFrameProcessor;
         }
         virtual ~SlateFrameRendererWithCV()
         {
             m_fExit = true;
-            m_pFrameUpdateThread->join();
+            SetEvent(m_hFrameEvent);
+            if (m_pFrameUpdateThread)
+            {
+                m_pFrameUpdateThread->join();
+                delete m_pFrameUpdateThread;
+            }
+            CloseHandle(m_hFrameEvent);
         }
 
         DirectX::XMMATRIX GetModelRotation();
 
-        void UpdateSlateTextureWithBitmap(const BYTE *pImage, UINT uWidth, UINT uHeight);
-        void StartCVProcessing(BYTE bright);
+        // uStride is the distance between the bitmap rows, in bytes
+        void UpdateSlateTextureWithBitmap(const BYTE *pImage, UINT uWidth, UINT uHeight, size_t uStride);
+        // markerPoseEstimator, when set, estimates the pose of every marker found in a frame on the processing thread.
+        // It's handed over with the start so the thread never sees it change.
+        void StartCVProcessing(BYTE bright, std::shared_ptr<MarkerPoseEstimator> markerPoseEstimator = nullptr);
 
+        // Called from a single camera thread
         static void FrameReadyCallback(IResearchModeSensorFrame* pSensorFrame, PVOID frameCtx)
         {
             SlateFrameRendererWithCV *pSlateTexture = (SlateFrameRendererWithCV*)frameCtx;
-            std::lock_guard<std::mutex> guard(pSlateTexture->m_frameMutex);
 
-            if (pSlateTexture->m_pSensorFrameIn)
-            {
-                pSlateTexture->m_pSensorFrameIn->Release();
-            }
-            pSlateTexture->m_pSensorFrameIn = pSensorFrame;
-            if (pSensorFrame)
+            pSlateTexture->m_frameMailbox.GetWriteBuffer() = pSensorFrame;
+            if (!pSlateTexture->m_frameMailbox.Publish())
             {
-                pSensorFrame->AddRef();
+                pSlateTexture->m_skippedFrameCount++;
             }
 
+            // The buffer handed back holds a skipped or an already processed frame, the camera can have it back
+            pSlateTexture->m_frameMailbox.GetWriteBuffer().Reset();
+
             SetEvent(pSlateTexture->m_hFrameEvent);
         }
 
+        // Takes the results of the latest processed frame, if there is a new one, for the getters and the rendering
+        // until the next call. Called once per update, so everything in an update comes from the same frame. These,
+        // and the rendering, are for the one app thread.
+        void FetchLatestResults();
+
+        // The results taken by FetchLatestResults
         bool GetFirstCenter(float *px, float *py, ResearchModeSensorTimestamp *pTimeStamp);
 
+        // Poses of the markers of the frame taken by FetchLatestResults, false when it had none
+        bool GetMarkerPoses(std::vector<MarkerPose> &poses, ResearchModeSensorTimestamp *pTimeStamp);
+
+        // Frames that went through the frame processor, and frames a newer one replaced before their turn
+        uint64_t GetProcessedFrameCount() const { return m_processedFrameCount; }
+        uint64_t GetSkippedFrameCount() const { return m_skippedFrameCount; }
+
     protected:
 
         void GetModelVertices(std::vector<VertexPositionColor> &returnedModelVertices);
@@ -89,24 +114,31 @@ namespace BasicHologram
 
         static void FrameProcessingThread(SlateFrameRendererWithCV* pSlateCameraRenderer);
         bool m_fExit = { false };
-        std::thread *m_pFrameUpdateThread;
+        std::thread *m_pFrameUpdateThread = nullptr;
         HANDLE m_hFrameEvent;
 
-        std::mutex m_frameMutex;
-        IResearchModeSensorFrame* m_pSensorFrame;
-        IResearchModeSensorFrame* m_pSensorFrameIn;
+        struct ProcessedFrame
+        {
+            uint64_t frameNumber = 0;   // 0 until the first frame is processed
+            ResearchModeSensorTimestamp timeStamp = {};
+            cv::Mat image;              // Owned, the frame itself goes back to the camera
+            std::vector<int> ids;
+            std::vector<std::vector<cv::Point2f>> corners;
+            std::vector<MarkerPose> poses;
+        };
+
+        TripleBuffer<Microsoft::WRL::ComPtr<IResearchModeSensorFrame>> m_frameMailbox;
+        TripleBuffer<ProcessedFrame> m_resultMailbox;
+
+        std::atomic<uint64_t> m_processedFrameCount = { 0 };
+        std::atomic<uint64_t> m_skippedFrameCount = { 0 };
+
         UINT m_Width;
         UINT m_Height;
+        uint64_t m_textureFrameNumber = 0;
 
-        std::vector<std::vector<cv::Point2f>> m_corners;
-        std::vector<cv::Point2f> m_centers;
-        std::vector<int> m_ids;
-        ResearchModeSensorTimestamp m_timeStamp;
-
-        std::mutex m_cornerMutex;
+        std::shared_ptr<MarkerPoseEstimator> m_markerPoseEstimator;
 
         std::function<void(IResearchModeSensorFrame* pSensorFrame, cv::Mat& cvResultMat, std::vector<int> &ids, std::vector<std::vector<cv::Point2f>> &corners)> m_cvFrameProcessor;
-
-        cv::Mat m_cvResultMat;
     };
 }
@@ -0,0 +1,611 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+#include "StereoDepth.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if !defined(STEREO_DEPTH_NO_SIMD)
+#if defined(_M_ARM64) || defined(__aarch64__)
+#define STEREO_DEPTH_NEON
+#include <arm_neon.h>
+#elif defined(_M_X64) || defined(__SSE2__)
+#define STEREO_DEPTH_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+using namespace BasicHologram;
+
+namespace
+{
+    // Aggregated costs stay far below this, so saturating at it never changes a minimum
+    const int16_t kCostLimit = 0x7fff;
+
+    // 5x5 census, 24 bits
+    const uint8_t kMaxCensusCost = 24;
+
+    // Eight disparities of a path
+#if defined(STEREO_DEPTH_NEON)
+    typedef int16x8_t Costs;
+    inline Costs Load(const int16_t* p) { return vld1q_s16(p); }
+    inline void Store(int16_t* p, Costs v) { vst1q_s16(p, v); }
+    inline Costs LoadMatchingCosts(const uint8_t* p) { return vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p))); }
+    inline Costs Splat(int value) { return vdupq_n_s16((int16_t)value); }
+    inline Costs Min(Costs a, Costs b) { return vminq_s16(a, b); }
+    inline Costs Add(Costs a, Costs b) { return vaddq_s16(a, b); }
+    inline Costs AddSaturated(Costs a, Costs b) { return vqaddq_s16(a, b); }
+    inline Costs Subtract(Costs a, Costs b) { return vsubq_s16(a, b); }
+    // Costs of disparity d - 1, lane 0 comes from the last lane of the previous eight
+    inline Costs ShiftInPrevious(Costs v, Costs previous) { return vextq_s16(previous, v, 7); }
+    // Costs of disparity d + 1, lane 7 comes from the first lane of the next eight
+    inline Costs ShiftInNext(Costs v, Costs next) { return vextq_s16(v, next, 1); }
+    inline int16_t HorizontalMin(Costs v) { return vminvq_s16(v); }
+#elif defined(STEREO_DEPTH_SSE2)
+    typedef __m128i Costs;
+    inline Costs Load(const int16_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    inline void Store(int16_t* p, Costs v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    inline Costs LoadMatchingCosts(const uint8_t* p) { return _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), _mm_setzero_si128()); }
+    inline Costs Splat(int value) { return _mm_set1_epi16((int16_t)value); }
+    inline Costs Min(Costs a, Costs b) { return _mm_min_epi16(a, b); }
+    inline Costs Add(Costs a, Costs b) { return _mm_add_epi16(a, b); }
+    inline Costs AddSaturated(Costs a, Costs b) { return _mm_adds_epi16(a, b); }
+    inline Costs Subtract(Costs a, Costs b) { return _mm_sub_epi16(a, b); }
+    inline Costs ShiftInPrevious(Costs v, Costs previous) { return _mm_or_si128(_mm_slli_si128(v, 2), _mm_srli_si128(previous, 14)); }
+    inline Costs ShiftInNext(Costs v, Costs next) { return _mm_or_si128(_mm_srli_si128(v, 2), _mm_slli_si128(next, 14)); }
+    inline int16_t HorizontalMin(Costs v)
+    {
+        v = _mm_min_epi16(v, _mm_srli_si128(v, 8));
+        v = _mm_min_epi16(v, _mm_srli_si128(v, 4));
+        v = _mm_min_epi16(v, _mm_srli_si128(v, 2));
+        return (int16_t)_mm_cvtsi128_si32(v);
+    }
+#else
+    struct Costs
+    {
+        int16_t lane[8];
+    };
+    inline Costs Load(const int16_t* p) { Costs v; memcpy(v.lane, p, sizeof(v.lane)); return v; }
+    inline void Store(int16_t* p, Costs v) { memcpy(p, v.lane, sizeof(v.lane)); }
+    inline Costs LoadMatchingCosts(const uint8_t* p) { Costs v; for (int i = 0; i < 8; i++) v.lane[i] = p[i]; return v; }
+    inline Costs Splat(int value) { Costs v; for (int i = 0; i < 8; i++) v.lane[i] = (int16_t)value; return v; }
+    inline Costs Min(Costs a, Costs b) { for (int i = 0; i < 8; i++) a.lane[i] = (std::min)(a.lane[i], b.lane[i]); return a; }
+    inline Costs Add(Costs a, Costs b) { for (int i = 0; i < 8; i++) a.lane[i] = (int16_t)(a.lane[i] + b.lane[i]); return a; }
+    inline Costs AddSaturated(Costs a, Costs b) { for (int i = 0; i < 8; i++) a.lane[i] = (int16_t)(std::min)(a.lane[i] + b.lane[i], (int)kCostLimit); return a; }
+    inline Costs Subtract(Costs a, Costs b) { for (int i = 0; i < 8; i++) a.lane[i] = (int16_t)(a.lane[i] - b.lane[i]); return a; }
+    inline Costs ShiftInPrevious(Costs v, Costs previous) { Costs r; r.lane[0] = previous.lane[7]; for (int i = 1; i < 8; i++) r.lane[i] = v.lane[i - 1]; return r; }
+    inline Costs ShiftInNext(Costs v, Costs next) { Costs r; for (int i = 0; i < 7; i++) r.lane[i] = v.lane[i + 1]; r.lane[7] = next.lane[0]; return r; }
+    inline int16_t HorizontalMin(Costs v) { int16_t m = v.lane[0]; for (int i = 1; i < 8; i++) m = (std::min)(m, v.lane[i]); return m; }
+#endif
+
+    // One step along a path, for every disparity:
+    // L(p, d) = C(p, d) + min(L(p - r, d), L(p - r, d +- 1) + P1, min L(p - r) + P2) - min L(p - r)
+    // pPrevious and pCurrent may be the same buffer. Adds L(p) to pSums and returns its minimum.
+    inline int16_t UpdatePath(const uint8_t* pMatchingCosts, const int16_t* pPrevious, int16_t previousMin, int16_t* pCurrent,
+                              int16_t* pSums, uint32_t disparityCount, Costs smallPenalty, int largePenalty)
+    {
+        const Costs jumpCost = Splat(previousMin + largePenalty);
+        const Costs previousMinCosts = Splat(previousMin);
+        const Costs border = Splat(kCostLimit);
+
+        Costs currentMin = border;
+        Costs before = border;
+        Costs previous = Load(pPrevious);
+        for (uint32_t d = 0; d < disparityCount; d += 8)
+        {
+            const Costs after = (d + 8 < disparityCount) ? Load(pPrevious + d + 8) : border;
+
+            Costs best = Min(previous, jumpCost);
+            best = Min(best, AddSaturated(ShiftInPrevious(previous, before), smallPenalty));
+            best = Min(best, AddSaturated(ShiftInNext(previous, after), smallPenalty));
+            const Costs current = Subtract(Add(LoadMatchingCosts(pMatchingCosts + d), best), previousMinCosts);
+
+            Store(pCurrent + d, current);
+            Store(pSums + d, Add(Load(pSums + d), current));
+            currentMin = Min(currentMin, current);
+
+            before = previous;
+            previous = after;
+        }
+        return HorizontalMin(currentMin);
+    }
+
+    inline uint32_t PopCount(uint32_t v)
+    {
+        v = v - ((v >> 1) & 0x55555555);
+        v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+        return (((v + (v >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+    }
+
+    void Normalize(float v[3])
+    {
+        const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+
+    void Cross(const float a[3], const float b[3], float result[3])
+    {
+        result[0] = a[1] * b[2] - a[2] * b[1];
+        result[1] = a[2] * b[0] - a[0] * b[2];
+        result[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    // Rotation (column vectors) and center in the rig frame of a camera, from its row vector extrinsics
+    void GetCameraPose(const StereoCameraModel& camera, float rotation[3][3], float center[3])
+    {
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                rotation[r][c] = camera.rigToCamera[c][r];
+            }
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            center[i] = 0.0f;
+            for (int r = 0; r < 3; r++)
+            {
+                center[i] -= camera.rigToCamera[i][r] * camera.rigToCamera[3][r];
+            }
+        }
+    }
+
+    // Pixels per unit plane unit around the image center
+    float EstimateFocalLength(const StereoCameraModel& camera)
+    {
+        const float u = camera.width * 0.5f;
+        const float v = camera.height * 0.5f;
+        float x0, y0, x1, y1;
+        if (!camera.imageToUnitPlane(u - 1.0f, v, x0, y0) || !camera.imageToUnitPlane(u + 1.0f, v, x1, y1))
+        {
+            return 0.0f;
+        }
+        const float step = std::sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+        return step > 0.0f ? 2.0f / step : 0.0f;
+    }
+}
+
+bool StereoRectification::Build(const StereoCameraModel& first, const StereoCameraModel& second, float scale)
+{
+    const StereoCameraModel* cameras[2] = { &first, &second };
+    for (const StereoCameraModel* pCamera : cameras)
+    {
+        if (!pCamera->imageToUnitPlane || !pCamera->unitPlaneToImage || pCamera->width < 2 || pCamera->height < 2)
+        {
+            return false;
+        }
+    }
+
+    float rotations[2][3][3];
+    float centers[2][3];
+    GetCameraPose(first, rotations[0], centers[0]);
+    GetCameraPose(second, rotations[1], centers[1]);
+
+    // Rectified axes in the rig frame: x along the baseline, z as close as possible to both optical axes
+    float axes[3][3];
+    for (int i = 0; i < 3; i++)
+    {
+        axes[0][i] = centers[1][i] - centers[0][i];
+    }
+    m_baseline = std::sqrt(axes[0][0] * axes[0][0] + axes[0][1] * axes[0][1] + axes[0][2] * axes[0][2]);
+    if (m_baseline < 1e-4f)
+    {
+        return false;
+    }
+    Normalize(axes[0]);
+
+    const float viewDirection[3] = {
+        rotations[0][2][0] + rotations[1][2][0],
+        rotations[0][2][1] + rotations[1][2][1],
+        rotations[0][2][2] + rotations[1][2][2]
+    };
+    Cross(viewDirection, axes[0], axes[1]);
+    Normalize(axes[1]);
+    Cross(axes[0], axes[1], axes[2]);
+
+    // rectifiedToCamera = cameraRotation * axes^T, and its transpose for the first camera
+    float rectifiedToCamera[2][3][3];
+    for (int k = 0; k < 2; k++)
+    {
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                rectifiedToCamera[k][r][c] = rotations[k][r][0] * axes[c][0] + rotations[k][r][1] * axes[c][1] + rotations[k][r][2] * axes[c][2];
+            }
+        }
+    }
+    for (int r = 0; r < 3; r++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            m_cameraToRectified[r][c] = rectifiedToCamera[0][c][r];
+        }
+    }
+
+    m_focal = scale * (std::min)(EstimateFocalLength(first), EstimateFocalLength(second));
+    if (!(m_focal > 0.0f))
+    {
+        return false;
+    }
+
+    // Rectified plane area seen by both cameras, from their image borders. Directions past about 63 degrees are
+    // left out, they would take most of the rectified image for little overlap.
+    const float kMaxTangent = 2.0f;
+    float bounds[2][4];     // Per camera: min x, min y, max x, max y on the rectified plane
+    for (int k = 0; k < 2; k++)
+    {
+        const StereoCameraModel& camera = *cameras[k];
+        float* b = bounds[k];
+        b[0] = b[1] = kMaxTangent;
+        b[2] = b[3] = -kMaxTangent;
+
+        const uint32_t perimeter = 2 * (camera.width + camera.height);
+        for (uint32_t i = 0; i < perimeter; i += 4)
+        {
+            float u, v;
+            if (i < camera.width) { u = (float)i; v = 0.0f; }
+            else if (i < 2 * camera.width) { u = (float)(i - camera.width); v = (float)camera.height; }
+            else if (i < 2 * camera.width + camera.height) { u = 0.0f; v = (float)(i - 2 * camera.width); }
+            else { u = (float)camera.width; v = (float)(i - 2 * camera.width - camera.height); }
+
+            float x, y;
+            if (!camera.imageToUnitPlane(u, v, x, y))
+            {
+                continue;
+            }
+            // Camera ray to the rectified frame: the transpose of rectifiedToCamera
+            float ray[3];
+            for (int r = 0; r < 3; r++)
+            {
+                ray[r] = rectifiedToCamera[k][0][r] * x + rectifiedToCamera[k][1][r] * y + rectifiedToCamera[k][2][r];
+            }
+            if (ray[2] <= 0.0f)
+            {
+                continue;
+            }
+            const float rx = (std::max)(-kMaxTangent, (std::min)(kMaxTangent, ray[0] / ray[2]));
+            const float ry = (std::max)(-kMaxTangent, (std::min)(kMaxTangent, ray[1] / ray[2]));
+            b[0] = (std::min)(b[0], rx);
+            b[1] = (std::min)(b[1], ry);
+            b[2] = (std::max)(b[2], rx);
+            b[3] = (std::max)(b[3], ry);
+        }
+    }
+
+    const float minX = (std::max)(bounds[0][0], bounds[1][0]);
+    const float minY = (std::max)(bounds[0][1], bounds[1][1]);
+    const float maxX = (std::min)(bounds[0][2], bounds[1][2]);
+    const float maxY = (std::min)(bounds[0][3], bounds[1][3]);
+    if (maxX <= minX || maxY <= minY)
+    {
+        return false;
+    }
+
+    m_width = (uint32_t)std::ceil((maxX - minX) * m_focal);
+    m_height = (uint32_t)std::ceil((maxY - minY) * m_focal);
+    m_centerU = -minX * m_focal;
+    m_centerV = -minY * m_focal;
+    m_first = first;
+
+    // Source pixel of every rectified pixel. Pixel centers are at +0.5, as for the camera mapping functions.
+    for (int k = 0; k < 2; k++)
+    {
+        const StereoCameraModel& camera = *cameras[k];
+        Map& map = m_maps[k];
+        map.sourceXY.assign(m_width * m_height, 0);
+        map.weights.assign(m_width * m_height, 0);
+        map.valid.assign(m_width * m_height, 0);
+
+        for (uint32_t v = 0; v < m_height; v++)
+        {
+            for (uint32_t u = 0; u < m_width; u++)
+            {
+                const float rectified[3] = { (u + 0.5f - m_centerU) / m_focal, (v + 0.5f - m_centerV) / m_focal, 1.0f };
+                float ray[3];
+                for (int r = 0; r < 3; r++)
+                {
+                    ray[r] = rectifiedToCamera[k][r][0] * rectified[0] + rectifiedToCamera[k][r][1] * rectified[1] + rectifiedToCamera[k][r][2];
+                }
+                float sourceU, sourceV;
+                if (ray[2] <= 0.0f || !camera.unitPlaneToImage(ray[0] / ray[2], ray[1] / ray[2], sourceU, sourceV))
+                {
+                    continue;
+                }
+
+                const float x = sourceU - 0.5f;
+                const float y = sourceV - 0.5f;
+                if (!(x >= 0.0f && y >= 0.0f && x < camera.width - 1 && y < camera.height - 1))
+                {
+                    continue;
+                }
+                const uint32_t x0 = (uint32_t)x;
+                const uint32_t y0 = (uint32_t)y;
+                const uint32_t fractionX = (uint32_t)((x - x0) * 128.0f + 0.5f);
+                const uint32_t fractionY = (uint32_t)((y - y0) * 128.0f + 0.5f);
+
+                const size_t index = v * m_width + u;
+                map.sourceXY[index] = x0 | (y0 << 16);
+                map.weights[index] = (uint16_t)(fractionX | (fractionY << 8));
+                map.valid[index] = 1;
+            }
+        }
+    }
+
+    return true;
+}
+
+void StereoRectification::Rectify(int camera, const uint8_t* pImage, size_t stride, uint8_t* pRectified) const
+{
+    const Map& map = m_maps[camera];
+    const size_t count = (size_t)m_width * m_height;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!map.valid[i])
+        {
+            pRectified[i] = 0;
+            continue;
+        }
+        const uint32_t sourceXY = map.sourceXY[i];
+        const uint8_t* p = pImage + (sourceXY >> 16) * stride + (sourceXY & 0xffff);
+        const uint32_t fractionX = map.weights[i] & 0xff;
+        const uint32_t fractionY = map.weights[i] >> 8;
+        const uint32_t top = p[0] * (128 - fractionX) + p[1] * fractionX;
+        const uint32_t bottom = p[stride] * (128 - fractionX) + p[stride + 1] * fractionX;
+        pRectified[i] = (uint8_t)((top * (128 - fractionY) + bottom * fractionY + (1 << 13)) >> 14);
+    }
+}
+
+bool StereoRectification::ImageToRectified(float u, float v, float& rectifiedU, float& rectifiedV) const
+{
+    float x, y;
+    if (m_width == 0 || !m_first.imageToUnitPlane(u, v, x, y))
+    {
+        return false;
+    }
+    float ray[3];
+    for (int r = 0; r < 3; r++)
+    {
+        ray[r] = m_cameraToRectified[r][0] * x + m_cameraToRectified[r][1] * y + m_cameraToRectified[r][2];
+    }
+    if (ray[2] <= 0.0f)
+    {
+        return false;
+    }
+    rectifiedU = m_focal * ray[0] / ray[2] + m_centerU;
+    rectifiedV = m_focal * ray[1] / ray[2] + m_centerV;
+    return rectifiedU >= 0.0f && rectifiedV >= 0.0f && rectifiedU < m_width && rectifiedV < m_height;
+}
+
+bool StereoRectification::RectifiedToCamera(float rectifiedU, float rectifiedV, float disparity, float point[3]) const
+{
+    const float depth = DisparityToDepth(disparity);
+    if (depth <= 0.0f)
+    {
+        return false;
+    }
+    const float rectified[3] = { (rectifiedU - m_centerU) / m_focal * depth, (rectifiedV - m_centerV) / m_focal * depth, depth };
+    for (int r = 0; r < 3; r++)
+    {
+        point[r] = m_cameraToRectified[0][r] * rectified[0] + m_cameraToRectified[1][r] * rectified[1] + m_cameraToRectified[2][r] * rectified[2];
+    }
+    return true;
+}
+
+SemiGlobalMatcher::SemiGlobalMatcher(const StereoOptions& options) :
+    m_options(options)
+{
+    m_options.disparityCount = (std::max)((m_options.disparityCount + 7) / 8 * 8, 8u);
+}
+
+void SemiGlobalMatcher::Compute(const uint8_t* pLeft, const uint8_t* pRight, const uint8_t* pLeftMask, uint32_t width, uint32_t height, int16_t* pDisparity)
+{
+    const size_t volume = (size_t)width * height * m_options.disparityCount;
+    m_costs.resize(volume);
+    m_sums.resize(volume);
+    m_pathRow.resize((size_t)width * m_options.disparityCount);
+    m_pathRowMin.resize(width);
+    m_pathPixel.resize(m_options.disparityCount);
+    m_rightBestCost.resize(width);
+    m_rightBestDisparity.resize(width);
+
+    ComputeCensus(pLeft, width, height, m_leftCensus);
+    ComputeCensus(pRight, width, height, m_rightCensus);
+    ComputeCosts(width, height);
+    AggregateForward(width, height);
+    AggregateBackwardAndSelect(pLeftMask, width, height, pDisparity);
+}
+
+void SemiGlobalMatcher::ComputeCensus(const uint8_t* pImage, uint32_t width, uint32_t height, std::vector<uint32_t>& census)
+{
+    census.assign((size_t)width * height, 0);
+    for (uint32_t y = 2; y + 2 < height; y++)
+    {
+        for (uint32_t x = 2; x + 2 < width; x++)
+        {
+            const uint8_t center = pImage[y * width + x];
+            uint32_t bits = 0;
+            for (int dy = -2; dy <= 2; dy++)
+            {
+                const uint8_t* pRow = pImage + (y + dy) * width + x;
+                for (int dx = -2; dx <= 2; dx++)
+                {
+                    if (dx != 0 || dy != 0)
+                    {
+                        bits = (bits << 1) | (pRow[dx] < center ? 1u : 0u);
+                    }
+                }
+            }
+            census[y * width + x] = bits;
+        }
+    }
+}
+
+void SemiGlobalMatcher::ComputeCosts(uint32_t width, uint32_t height)
+{
+    const uint32_t disparityCount = m_options.disparityCount;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint32_t* pLeftRow = &m_leftCensus[(size_t)y * width];
+        const uint32_t* pRightRow = &m_rightCensus[(size_t)y * width];
+        for (uint32_t x = 0; x < width; x++)
+        {
+            uint8_t* pCosts = &m_costs[((size_t)y * width + x) * disparityCount];
+            const uint32_t searched = (std::min)(disparityCount, x + 1);
+            for (uint32_t d = 0; d < searched; d++)
+            {
+                pCosts[d] = (uint8_t)PopCount(pLeftRow[x] ^ pRightRow[x - d]);
+            }
+            // Disparities that would match outside the right image
+            memset(pCosts + searched, kMaxCensusCost, disparityCount - searched);
+        }
+    }
+}
+
+// Left to right and top to bottom paths, which also start the sums
+void SemiGlobalMatcher::AggregateForward(uint32_t width, uint32_t height)
+{
+    const uint32_t disparityCount = m_options.disparityCount;
+    const Costs smallPenalty = Splat(m_options.smallPenalty);
+
+    std::fill(m_pathRow.begin(), m_pathRow.end(), (int16_t)0);
+    std::fill(m_pathRowMin.begin(), m_pathRowMin.end(), (int16_t)0);
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const size_t rowOffset = (size_t)y * width * disparityCount;
+        std::fill(m_sums.begin() + rowOffset, m_sums.begin() + rowOffset + (size_t)width * disparityCount, (int16_t)0);
+
+        std::fill(m_pathPixel.begin(), m_pathPixel.end(), (int16_t)0);
+        int16_t pixelMin = 0;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const size_t offset = rowOffset + (size_t)x * disparityCount;
+            pixelMin = UpdatePath(&m_costs[offset], m_pathPixel.data(), pixelMin, m_pathPixel.data(), &m_sums[offset],
+                                  disparityCount, smallPenalty, m_options.largePenalty);
+
+            int16_t* pColumn = &m_pathRow[(size_t)x * disparityCount];
+            m_pathRowMin[x] = UpdatePath(&m_costs[offset], pColumn, m_pathRowMin[x], pColumn, &m_sums[offset],
+                                         disparityCount, smallPenalty, m_options.largePenalty);
+        }
+    }
+}
+
+// Right to left and bottom to top paths. Each row is complete once they've passed it, so disparities are picked right away.
+void SemiGlobalMatcher::AggregateBackwardAndSelect(const uint8_t* pLeftMask, uint32_t width, uint32_t height, int16_t* pDisparity)
+{
+    const uint32_t disparityCount = m_options.disparityCount;
+    const Costs smallPenalty = Splat(m_options.smallPenalty);
+
+    std::fill(m_pathRow.begin(), m_pathRow.end(), (int16_t)0);
+    std::fill(m_pathRowMin.begin(), m_pathRowMin.end(), (int16_t)0);
+
+    for (uint32_t y = height; y-- > 0;)
+    {
+        const size_t rowOffset = (size_t)y * width * disparityCount;
+
+        std::fill(m_pathPixel.begin(), m_pathPixel.end(), (int16_t)0);
+        int16_t pixelMin = 0;
+        for (uint32_t x = width; x-- > 0;)
+        {
+            const size_t offset = rowOffset + (size_t)x * disparityCount;
+            pixelMin = UpdatePath(&m_costs[offset], m_pathPixel.data(), pixelMin, m_pathPixel.data(), &m_sums[offset],
+                                  disparityCount, smallPenalty, m_options.largePenalty);
+
+            int16_t* pColumn = &m_pathRow[(size_t)x * disparityCount];
+            m_pathRowMin[x] = UpdatePath(&m_costs[offset], pColumn, m_pathRowMin[x], pColumn, &m_sums[offset],
+                                         disparityCount, smallPenalty, m_options.largePenalty);
+        }
+
+        SelectRow(pLeftMask ? pLeftMask + (size_t)y * width : nullptr, width, y, pDisparity + (size_t)y * width);
+    }
+}
+
+void SemiGlobalMatcher::SelectRow(const uint8_t* pLeftMask, uint32_t width, uint32_t y, int16_t* pDisparityRow)
+{
+    const uint32_t disparityCount = m_options.disparityCount;
+    const int16_t* pRowSums = &m_sums[(size_t)y * width * disparityCount];
+
+    // Best disparity of each right pixel xr, among the left pixels xr + d, for the consistency check
+    std::fill(m_rightBestCost.begin(), m_rightBestCost.end(), kCostLimit);
+    for (uint32_t x = 0; x < width; x++)
+    {
+        const int16_t* pSums = pRowSums + (size_t)x * disparityCount;
+        const uint32_t searched = (std::min)(disparityCount, x + 1);
+        for (uint32_t d = 0; d < searched; d++)
+        {
+            if (pSums[d] < m_rightBestCost[x - d])
+            {
+                m_rightBestCost[x - d] = pSums[d];
+                m_rightBestDisparity[x - d] = (int16_t)d;
+            }
+        }
+    }
+
+    for (uint32_t x = 0; x < width; x++)
+    {
+        pDisparityRow[x] = kInvalidDisparity;
+        if (pLeftMask && !pLeftMask[x])
+        {
+            continue;
+        }
+
+        const int16_t* pSums = pRowSums + (size_t)x * disparityCount;
+        const uint32_t searched = (std::min)(disparityCount, x + 1);
+        uint32_t best = 0;
+        for (uint32_t d = 1; d < searched; d++)
+        {
+            if (pSums[d] < pSums[best])
+            {
+                best = d;
+            }
+        }
+
+        // Another disparity, not next to the best one, almost as good: the match is ambiguous
+        const int bestCost = pSums[best];
+        bool unique = true;
+        for (uint32_t d = 0; d < searched && unique; d++)
+        {
+            if ((d + 1 < best || d > best + 1) && pSums[d] * 100 <= bestCost * (100 + m_options.uniquenessPercent))
+            {
+                unique = false;
+            }
+        }
+        if (!unique)
+        {
+            continue;
+        }
+
+        if (std::abs(m_rightBestDisparity[x - best] - (int)best) > m_options.maxLeftRightDifference)
+        {
+            continue;
+        }
+
+        int disparity = (int)best * kDisparityScale;
+        if (best > 0 && best + 1 < searched)
+        {
+            // Parabola through the costs around the best disparity
+            const int before = pSums[best - 1];
+            const int after = pSums[best + 1];
+            const int curvature = before + after - 2 * bestCost;
+            if (curvature > 0)
+            {
+                disparity += (int)std::lround(kDisparityScale * (before - after) / (2.0f * curvature));
+            }
+        }
+        pDisparityRow[x] = (int16_t)disparity;
+    }
+}
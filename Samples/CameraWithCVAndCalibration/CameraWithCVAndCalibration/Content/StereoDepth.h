@@ -0,0 +1,134 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Depth from a pair of gray cameras, such as the LF and RF VLC cameras.
+//
+// StereoRectification is built once from the two camera models: it resamples both images onto a common image plane
+// parallel to the baseline, at a reduced resolution, so that matching pixels end up on the same row.
+// SemiGlobalMatcher then finds the disparity of every left pixel: 5x5 census costs, aggregated along the four image
+// axes with the semi-global matching recurrence, eight disparities at a time with NEON on ARM64 and SSE2 on x64,
+// followed by a uniqueness and a left-right consistency check.
+//
+// Free of Windows and OpenCV dependencies, so it can be benchmarked off device.
+// Define STEREO_DEPTH_NO_SIMD to use the scalar aggregation everywhere.
+
+namespace BasicHologram
+{
+    struct StereoCameraModel
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        // GetCameraExtrinsicsMatrix: rig to camera, applied to row vectors
+        float rigToCamera[4][4] = {};
+
+        // MapImagePointToCameraUnitPlane and MapCameraSpaceToImagePoint, false where the mapping fails
+        std::function<bool(float u, float v, float& x, float& y)> imageToUnitPlane;
+        std::function<bool(float x, float y, float& u, float& v)> unitPlaneToImage;
+    };
+
+    struct StereoOptions
+    {
+        float scale = 0.5f;             // Rectified focal length relative to the cameras'
+        uint32_t disparityCount = 64;   // Searched disparities, rounded up to a multiple of 8
+        int smallPenalty = 3;           // SGM penalty for a one pixel disparity change
+        int largePenalty = 36;          // SGM penalty for a larger change
+        int uniquenessPercent = 10;     // The best cost must beat the second best, away from its neighbours, by this much
+        int maxLeftRightDifference = 1; // In pixels, between the left and the right disparity of a match
+    };
+
+    class StereoRectification
+    {
+    public:
+        // The first camera is the left image of the rectified pair, the rectified x axis runs from it to the second one.
+        // Fails when a camera model is missing, the cameras share a center or no rectified pixel sees both images.
+        bool Build(const StereoCameraModel& first, const StereoCameraModel& second, float scale);
+
+        // Resamples a camera image (0 first, 1 second) onto the rectified grid, pixels outside the camera image are 0
+        void Rectify(int camera, const uint8_t* pImage, size_t stride, uint8_t* pRectified) const;
+
+        // Rectified pixels seen by the camera, 1 or 0
+        const std::vector<uint8_t>& GetValidMask(int camera) const { return m_maps[camera].valid; }
+
+        // Where a pixel of the first camera lands on the rectified grid
+        bool ImageToRectified(float u, float v, float& rectifiedU, float& rectifiedV) const;
+
+        // Point seen at a rectified pixel with that disparity, in the first camera's frame
+        bool RectifiedToCamera(float rectifiedU, float rectifiedV, float disparity, float point[3]) const;
+
+        uint32_t GetWidth() const { return m_width; }
+        uint32_t GetHeight() const { return m_height; }
+        float GetFocalLength() const { return m_focal; }
+        float GetBaseline() const { return m_baseline; }    // In meters
+
+        // Depth along the rectified optical axis, in meters
+        float DisparityToDepth(float disparity) const { return disparity > 0.0f ? m_focal * m_baseline / disparity : 0.0f; }
+
+    private:
+        struct Map
+        {
+            std::vector<uint32_t> sourceXY;     // Top left source pixel, x in the low 16 bits
+            std::vector<uint16_t> weights;      // Bilinear fractions in 1/128, x in the low byte
+            std::vector<uint8_t> valid;
+        };
+
+        uint32_t m_width = 0;
+        uint32_t m_height = 0;
+        float m_focal = 0.0f;
+        float m_centerU = 0.0f;
+        float m_centerV = 0.0f;
+        float m_baseline = 0.0f;
+        float m_cameraToRectified[3][3] = {};   // First camera to rectified, column vectors
+        StereoCameraModel m_first;
+        Map m_maps[2];
+    };
+
+    class SemiGlobalMatcher
+    {
+    public:
+        static constexpr int16_t kInvalidDisparity = -1;
+        static constexpr int kDisparityScale = 16;
+
+        explicit SemiGlobalMatcher(const StereoOptions& options = StereoOptions());
+
+        // Disparities of the left image in 1/16 pixel, kInvalidDisparity where there is no reliable match.
+        // The mask, when given, marks the left pixels to match (StereoRectification::GetValidMask).
+        void Compute(const uint8_t* pLeft, const uint8_t* pRight, const uint8_t* pLeftMask, uint32_t width, uint32_t height, int16_t* pDisparity);
+
+        const StereoOptions& GetOptions() const { return m_options; }
+
+    private:
+        void ComputeCensus(const uint8_t* pImage, uint32_t width, uint32_t height, std::vector<uint32_t>& census);
+        void ComputeCosts(uint32_t width, uint32_t height);
+        void AggregateForward(uint32_t width, uint32_t height);
+        void AggregateBackwardAndSelect(const uint8_t* pLeftMask, uint32_t width, uint32_t height, int16_t* pDisparity);
+        void SelectRow(const uint8_t* pLeftMask, uint32_t width, uint32_t y, int16_t* pDisparityRow);
+
+        StereoOptions m_options;
+
+        std::vector<uint32_t> m_leftCensus;
+        std::vector<uint32_t> m_rightCensus;
+        std::vector<uint8_t> m_costs;   // width x height x disparities
+        std::vector<int16_t> m_sums;    // Aggregated costs of all paths, same layout
+        std::vector<int16_t> m_pathRow; // Vertical path costs of the previous row
+        std::vector<int16_t> m_pathRowMin;
+        std::vector<int16_t> m_pathPixel;
+        std::vector<int16_t> m_rightBestCost;
+        std::vector<int16_t> m_rightBestDisparity;
+    };
+}
@@ -0,0 +1,285 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+#include "StereoDepthProcessor.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace BasicHologram;
+
+// The LF and RF cameras are triggered together, their frames of a pair carry the same timestamp
+static const uint64_t kPairTolerance = 10000;   // 1 ms in 100 ns ticks
+
+// Half the window of disparities GetDistance takes the median of
+static const int kDistanceWindowRadius = 2;
+
+static StereoCameraModel CreateCameraModel(IResearchModeSensor* pSensor, UINT width, UINT height)
+{
+    StereoCameraModel model;
+    IResearchModeCameraSensor* pCameraSensor = nullptr;
+    DirectX::XMFLOAT4X4 cameraPose;
+
+    if (FAILED(pSensor->QueryInterface(IID_PPV_ARGS(&pCameraSensor))))
+    {
+        return model;
+    }
+    if (FAILED(pCameraSensor->GetCameraExtrinsicsMatrix(&cameraPose)))
+    {
+        pCameraSensor->Release();
+        return model;
+    }
+
+    model.width = width;
+    model.height = height;
+    memcpy(model.rigToCamera, cameraPose.m, sizeof(model.rigToCamera));
+
+    // Both mapping functions share the reference to the camera sensor
+    std::shared_ptr<IResearchModeCameraSensor> cameraSensor(pCameraSensor, [](IResearchModeCameraSensor* p) { p->Release(); });
+    model.imageToUnitPlane = [cameraSensor](float u, float v, float& x, float& y)
+    {
+        float uv[2] = { u, v };
+        float xy[2];
+        const bool mapped = SUCCEEDED(cameraSensor->MapImagePointToCameraUnitPlane(uv, xy));
+        x = xy[0];
+        y = xy[1];
+        return mapped;
+    };
+    model.unitPlaneToImage = [cameraSensor](float x, float y, float& u, float& v)
+    {
+        float xy[2] = { x, y };
+        float uv[2];
+        const bool mapped = SUCCEEDED(cameraSensor->MapCameraSpaceToImagePoint(xy, uv));
+        u = uv[0];
+        v = uv[1];
+        return mapped;
+    };
+    return model;
+}
+
+StereoDepthProcessor::StereoDepthProcessor(IResearchModeSensor* pLeftSensor, IResearchModeSensor* pRightSensor, const StereoOptions& options) :
+    m_matcher(options)
+{
+    m_pSensors[0] = pLeftSensor;
+    m_pSensors[1] = pRightSensor;
+    for (IResearchModeSensor* pSensor : m_pSensors)
+    {
+        pSensor->AddRef();
+    }
+
+    m_hPairEvent = CreateEvent(NULL, true, false, NULL);
+    m_pDepthUpdateThread = new std::thread(DepthProcessingThread, this);
+}
+
+StereoDepthProcessor::~StereoDepthProcessor()
+{
+    m_fExit = true;
+    SetEvent(m_hPairEvent);
+    m_pDepthUpdateThread->join();
+    delete m_pDepthUpdateThread;
+    CloseHandle(m_hPairEvent);
+
+    for (int camera = 0; camera < 2; camera++)
+    {
+        if (m_pSensorFrameIn[camera])
+        {
+            m_pSensorFrameIn[camera]->Release();
+        }
+        if (m_pPairIn[camera])
+        {
+            m_pPairIn[camera]->Release();
+        }
+        m_pSensors[camera]->Release();
+    }
+}
+
+void StereoDepthProcessor::FrameReady(int camera, IResearchModeSensorFrame* pSensorFrame)
+{
+    std::lock_guard<std::mutex> guard(m_frameMutex);
+
+    if (m_pSensorFrameIn[camera])
+    {
+        m_pSensorFrameIn[camera]->Release();
+    }
+    m_pSensorFrameIn[camera] = pSensorFrame;
+    if (pSensorFrame == nullptr)
+    {
+        return;
+    }
+    pSensorFrame->AddRef();
+
+    IResearchModeSensorFrame* pOtherFrame = m_pSensorFrameIn[1 - camera];
+    if (pOtherFrame == nullptr)
+    {
+        return;
+    }
+
+    ResearchModeSensorTimestamp timeStamp;
+    ResearchModeSensorTimestamp otherTimeStamp;
+    pSensorFrame->GetTimeStamp(&timeStamp);
+    pOtherFrame->GetTimeStamp(&otherTimeStamp);
+    const uint64_t difference = (std::max)(timeStamp.HostTicks, otherTimeStamp.HostTicks) - (std::min)(timeStamp.HostTicks, otherTimeStamp.HostTicks);
+    if (difference > kPairTolerance)
+    {
+        return;
+    }
+
+    // The newer pair replaces one the worker has not picked up yet
+    for (int k = 0; k < 2; k++)
+    {
+        if (m_pPairIn[k])
+        {
+            m_pPairIn[k]->Release();
+        }
+        m_pPairIn[k] = m_pSensorFrameIn[k];
+        m_pSensorFrameIn[k] = nullptr;
+    }
+
+    SetEvent(m_hPairEvent);
+}
+
+void StereoDepthProcessor::DepthProcessing()
+{
+    while (!m_fExit)
+    {
+        WaitForSingleObject(m_hPairEvent, INFINITE);
+
+        IResearchModeSensorFrame* pPair[2];
+        {
+            std::lock_guard<std::mutex> guard(m_frameMutex);
+
+            pPair[0] = m_pPairIn[0];
+            pPair[1] = m_pPairIn[1];
+            m_pPairIn[0] = nullptr;
+            m_pPairIn[1] = nullptr;
+
+            ResetEvent(m_hPairEvent);
+        }
+
+        if (pPair[0] == nullptr)
+        {
+            continue;
+        }
+
+        IResearchModeSensorVLCFrame* pVLCFrame[2] = {};
+        const BYTE* pImage[2] = {};
+        ResearchModeSensorResolution resolution;
+        bool fHaveImages = true;
+
+        pPair[0]->GetResolution(&resolution);
+        for (int camera = 0; camera < 2; camera++)
+        {
+            size_t outBufferCount = 0;
+            if (SUCCEEDED(pPair[camera]->QueryInterface(IID_PPV_ARGS(&pVLCFrame[camera]))))
+            {
+                pVLCFrame[camera]->GetBuffer(&pImage[camera], &outBufferCount);
+            }
+            fHaveImages = fHaveImages && pImage[camera] != nullptr;
+        }
+
+        // The maps need the frame size, so they are built here, off the camera threads, with the first pair
+        if (fHaveImages && m_rectification.GetWidth() == 0 && !m_fRectificationFailed)
+        {
+            m_fRectificationFailed = !m_rectification.Build(
+                CreateCameraModel(m_pSensors[0], resolution.Width, resolution.Height),
+                CreateCameraModel(m_pSensors[1], resolution.Width, resolution.Height),
+                m_matcher.GetOptions().scale);
+        }
+
+        if (fHaveImages && !m_fRectificationFailed)
+        {
+            const UINT width = m_rectification.GetWidth();
+            const UINT height = m_rectification.GetHeight();
+
+            for (int camera = 0; camera < 2; camera++)
+            {
+                m_rectified[camera].resize(width * height);
+                m_rectification.Rectify(camera, pImage[camera], resolution.Width, m_rectified[camera].data());
+            }
+
+            m_disparityOut.resize(width * height);
+            m_matcher.Compute(m_rectified[0].data(), m_rectified[1].data(), m_rectification.GetValidMask(0).data(), width, height, m_disparityOut.data());
+
+            std::lock_guard<std::mutex> guard(m_disparityMutex);
+            m_disparity.swap(m_disparityOut);
+            pPair[0]->GetTimeStamp(&m_timeStamp);
+        }
+
+        for (int camera = 0; camera < 2; camera++)
+        {
+            if (pVLCFrame[camera])
+            {
+                pVLCFrame[camera]->Release();
+            }
+            pPair[camera]->Release();
+        }
+    }
+}
+
+void StereoDepthProcessor::DepthProcessingThread(StereoDepthProcessor* pStereoDepthProcessor)
+{
+    pStereoDepthProcessor->DepthProcessing();
+}
+
+bool StereoDepthProcessor::GetDistance(float u, float v, float *pDistance, ResearchModeSensorTimestamp *pTimeStamp)
+{
+    std::lock_guard<std::mutex> guard(m_disparityMutex);
+
+    // The rectification is only written before the first disparity map is published
+    float rectifiedU;
+    float rectifiedV;
+    if (m_disparity.empty() || !m_rectification.ImageToRectified(u, v, rectifiedU, rectifiedV))
+    {
+        return false;
+    }
+
+    // Median of the valid disparities around the pixel, which rides over a few failed matches
+    const int width = (int)m_rectification.GetWidth();
+    const int height = (int)m_rectification.GetHeight();
+    const int centerX = (int)rectifiedU;
+    const int centerY = (int)rectifiedV;
+    int16_t disparities[(2 * kDistanceWindowRadius + 1) * (2 * kDistanceWindowRadius + 1)];
+    int disparityCount = 0;
+
+    for (int y = (std::max)(0, centerY - kDistanceWindowRadius); y <= (std::min)(height - 1, centerY + kDistanceWindowRadius); y++)
+    {
+        for (int x = (std::max)(0, centerX - kDistanceWindowRadius); x <= (std::min)(width - 1, centerX + kDistanceWindowRadius); x++)
+        {
+            const int16_t disparity = m_disparity[y * width + x];
+            if (disparity != SemiGlobalMatcher::kInvalidDisparity && disparity > 0)
+            {
+                disparities[disparityCount++] = disparity;
+            }
+        }
+    }
+
+    if (disparityCount == 0)
+    {
+        return false;
+    }
+
+    std::nth_element(disparities, disparities + disparityCount / 2, disparities + disparityCount);
+    const float disparity = disparities[disparityCount / 2] / (float)SemiGlobalMatcher::kDisparityScale;
+
+    float point[3];
+    if (!m_rectification.RectifiedToCamera(rectifiedU, rectifiedV, disparity, point))
+    {
+        return false;
+    }
+
+    *pDistance = sqrtf(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
+    if (pTimeStamp)
+    {
+        *pTimeStamp = m_timeStamp;
+    }
+    return true;
+}
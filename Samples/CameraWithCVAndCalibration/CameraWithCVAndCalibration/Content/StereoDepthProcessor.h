@@ -0,0 +1,72 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "researchmode\ResearchModeApi.h"
+#include "StereoDepth.h"
+
+namespace BasicHologram
+{
+    // Disparity maps of the LF/RF pair on a worker thread. The camera threads hand over their frames with
+    // LeftFrameCallback and RightFrameCallback, frames with the same timestamp make a pair, and the worker
+    // matches the latest pair, dropping any it did not get to.
+    class StereoDepthProcessor
+    {
+    public:
+        StereoDepthProcessor(IResearchModeSensor* pLeftSensor, IResearchModeSensor* pRightSensor, const StereoOptions& options);
+        virtual ~StereoDepthProcessor();
+
+        static void LeftFrameCallback(IResearchModeSensorFrame* pSensorFrame, PVOID frameCtx)
+        {
+            ((StereoDepthProcessor*)frameCtx)->FrameReady(0, pSensorFrame);
+        }
+
+        static void RightFrameCallback(IResearchModeSensorFrame* pSensorFrame, PVOID frameCtx)
+        {
+            ((StereoDepthProcessor*)frameCtx)->FrameReady(1, pSensorFrame);
+        }
+
+        // Distance in meters from the LF camera to what it sees at pixel (u, v), in the latest disparity map.
+        // False until the first pair is matched, outside the view of the RF camera and where matching failed.
+        bool GetDistance(float u, float v, float *pDistance, ResearchModeSensorTimestamp *pTimeStamp);
+
+    protected:
+
+        void FrameReady(int camera, IResearchModeSensorFrame* pSensorFrame);
+
+        void DepthProcessing();
+
+        static void DepthProcessingThread(StereoDepthProcessor* pStereoDepthProcessor);
+
+        bool m_fExit = { false };
+        std::thread *m_pDepthUpdateThread;
+        HANDLE m_hPairEvent;
+
+        IResearchModeSensor *m_pSensors[2];
+
+        // Latest frame of each camera, and the latest pair not yet matched
+        std::mutex m_frameMutex;
+        IResearchModeSensorFrame* m_pSensorFrameIn[2] = {};
+        IResearchModeSensorFrame* m_pPairIn[2] = {};
+
+        // Only touched by the worker thread
+        StereoRectification m_rectification;
+        SemiGlobalMatcher m_matcher;
+        bool m_fRectificationFailed = { false };
+        std::vector<uint8_t> m_rectified[2];
+        std::vector<int16_t> m_disparityOut;
+
+        std::mutex m_disparityMutex;
+        std::vector<int16_t> m_disparity;
+        ResearchModeSensorTimestamp m_timeStamp;
+    };
+}
@@ -0,0 +1,68 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace BasicHologram
+{
+    // Lock-free mailbox from one writer thread to one reader thread, latest value wins. The writer fills the
+    // write buffer and publishes it, the reader fetches the latest published value, which stays its own until
+    // the next fetch. A value published before the reader fetched the previous one replaces it, so neither side
+    // ever waits for the other.
+    template <typename T>
+    class TripleBuffer
+    {
+    public:
+        // Writer side. The buffer handed back by Publish holds an older value, which the writer can reuse or clear.
+        T& GetWriteBuffer()
+        {
+            return m_buffers[m_writeIndex];
+        }
+
+        // False when the value replaced one the reader never fetched
+        bool Publish()
+        {
+            const uint8_t previous = m_middle.exchange(m_writeIndex | kFresh, std::memory_order_acq_rel);
+            m_writeIndex = previous & kIndexMask;
+            return (previous & kFresh) == 0;
+        }
+
+        // Reader side. False, and the read buffer unchanged, when nothing was published since the last fetch.
+        bool Fetch()
+        {
+            // Only the writer sets the flag, so it stays set until the exchange
+            if ((m_middle.load(std::memory_order_relaxed) & kFresh) == 0)
+            {
+                return false;
+            }
+            const uint8_t previous = m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+            m_readIndex = previous & kIndexMask;
+            return true;
+        }
+
+        T& GetReadBuffer()
+        {
+            return m_buffers[m_readIndex];
+        }
+
+    private:
+        static const uint8_t kIndexMask = 3;
+        static const uint8_t kFresh = 4;
+
+        T m_buffers[3];
+        uint8_t m_writeIndex = 0;
+        std::atomic<uint8_t> m_middle = { 1 };
+        uint8_t m_readIndex = 2;
+    };
+}
@@ -0,0 +1,340 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Checks SensorTextureKernels against the per pixel loops the slate renderers used before them, and times both.
+
+#include "SensorTextureKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace BasicHologram::SensorTextureKernels;
+
+namespace
+{
+    enum class SensorType
+    {
+        LeftFront,
+        RightFront,
+        LeftLeft,
+        LongThrow,
+        Ahat
+    };
+
+    // Former SlateCameraRenderer::UpdateTextureFromCameraFrame, sensor type checked per pixel
+    void ReferenceGray8ToBgra(SensorType sensorType, const uint8_t* pImage, uint32_t width, uint32_t height, uint32_t* pTexture, size_t rowPitch)
+    {
+        const volatile SensorType* pSensorType = &sensorType;   // Stands in for the virtual GetSensorType call
+        for (uint32_t i = 0; i < height; i++)
+        {
+            for (uint32_t j = 0; j < width; j++)
+            {
+                uint8_t inputPixel = pImage[width * i + j];
+                uint32_t pixel = inputPixel | (inputPixel << 8) | (inputPixel << 16);
+
+                if (*pSensorType == SensorType::LeftFront)
+                {
+                    pTexture[(rowPitch / 4) * i + (width - j - 1)] = pixel;
+                }
+                else if (*pSensorType == SensorType::RightFront)
+                {
+                    pTexture[(rowPitch / 4) * (height - i - 1) + j] = pixel;
+                }
+                else
+                {
+                    pTexture[(rowPitch / 4) * i + j] = pixel;
+                }
+            }
+        }
+    }
+
+    uint8_t ConvertDepthPixel(uint16_t v, uint8_t bSigma, uint16_t mask, uint16_t maxshort, const int vmin, const int vmax)
+    {
+        if ((mask != 0) && (bSigma & mask) > 0)
+        {
+            v = 0;
+        }
+
+        if ((maxshort != 0) && (v > maxshort))
+        {
+            v = 0;
+        }
+
+        float colorValue = 0.0f;
+        if (v <= vmin)
+        {
+            colorValue = 0.0f;
+        }
+        else if (v >= vmax)
+        {
+            colorValue = 1.0f;
+        }
+        else
+        {
+            colorValue = (float)(v - vmin) / (float)(vmax - vmin);
+        }
+
+        return (uint8_t)(colorValue * 255);
+    }
+
+    void ReferenceDepthToBgra(SensorType sensorType, const uint16_t* pDepth, const uint8_t* pSigma, uint32_t width, uint32_t height, uint32_t* pTexture, size_t rowPitch)
+    {
+        const bool isLongThrow = sensorType == SensorType::LongThrow;
+        const uint16_t mask = isLongThrow ? 0x80 : 0;
+        const int maxClampDepth = isLongThrow ? 4000 : 1000;
+        const uint16_t maxshort = isLongThrow ? 0 : 4090;
+        for (uint32_t i = 0; i < height; i++)
+        {
+            for (uint32_t j = 0; j < width; j++)
+            {
+                const uint8_t inputPixel = ConvertDepthPixel(pDepth[width * i + j], pSigma ? pSigma[width * i + j] : 0, mask, maxshort, 0, maxClampDepth);
+                pTexture[(rowPitch / 4) * i + j] = inputPixel | (inputPixel << 8) | (inputPixel << 16);
+            }
+        }
+    }
+
+    // Plain mapping of Orientation, to check the rotations
+    void NaiveGray8ToBgra(Orientation orientation, const uint8_t* pImage, uint32_t width, uint32_t height, uint32_t* pTexture, size_t rowPitch)
+    {
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                uint32_t dstX = x;
+                uint32_t dstY = y;
+                switch (orientation)
+                {
+                case Orientation::MirrorX: dstX = width - 1 - x; break;
+                case Orientation::MirrorY: dstY = height - 1 - y; break;
+                case Orientation::Rotate180: dstX = width - 1 - x; dstY = height - 1 - y; break;
+                case Orientation::Rotate90Clockwise: dstX = height - 1 - y; dstY = x; break;
+                case Orientation::Rotate90CounterClockwise: dstX = y; dstY = width - 1 - x; break;
+                default: break;
+                }
+                const uint8_t gray = pImage[y * width + x];
+                pTexture[(rowPitch / 4) * dstY + dstX] = gray | (gray << 8) | (gray << 16);
+            }
+        }
+    }
+
+    // D3D rounds texture rows up; padding makes the pitch handling visible
+    size_t TexturePitch(uint32_t width)
+    {
+        return (width * 4 + 255) / 256 * 256;
+    }
+
+    struct Timing
+    {
+        double megapixelsPerSecond;
+        double microsecondsPerFrame;
+    };
+
+    Timing Time(uint32_t pixelCount, double minSeconds, const std::function<void()>& body)
+    {
+        body();     // Warm up
+        uint64_t iterations = 0;
+        const auto start = std::chrono::steady_clock::now();
+        double elapsed = 0.0;
+        do
+        {
+            body();
+            ++iterations;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (elapsed < minSeconds);
+        return { double(pixelCount) * iterations / elapsed / 1e6, 1e6 * elapsed / iterations };
+    }
+
+    int g_failures = 0;
+
+    void Check(bool condition, const std::string& what)
+    {
+        if (!condition)
+        {
+            printf("MISMATCH %s\n", what.c_str());
+            g_failures++;
+        }
+    }
+
+    void PrintRow(const char* name, const Timing& reference, const Timing& kernel)
+    {
+        printf("%-28s %12.1f %12.1f %12.1f %12.1f %8.1fx\n", name, reference.megapixelsPerSecond, kernel.megapixelsPerSecond,
+            reference.microsecondsPerFrame, kernel.microsecondsPerFrame, kernel.megapixelsPerSecond / reference.megapixelsPerSecond);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double minSeconds = 0.5;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--min-time" && i + 1 < argc)
+        {
+            minSeconds = atof(argv[++i]);
+        }
+        else
+        {
+            printf("usage: SensorTextureBenchmark [--min-time seconds]\n");
+            return std::string(argv[i]) == "--help" ? 0 : 1;
+        }
+    }
+
+#if defined(SENSOR_TEXTURE_KERNELS_NEON)
+    printf("Kernels: NEON\n\n");
+#elif defined(SENSOR_TEXTURE_KERNELS_SSE2)
+    printf("Kernels: SSE2\n\n");
+#else
+    printf("Kernels: scalar\n\n");
+#endif
+
+    std::mt19937 random(1);
+
+    // VLC, 640x480 plus odd sizes for the tails
+    printf("%-28s %12s %12s %12s %12s %9s\n", "conversion", "ref Mpix/s", "Mpix/s", "ref us", "us", "speedup");
+    const uint32_t vlcSizes[][2] = { { 640, 480 }, { 37, 5 } };
+    for (const auto& size : vlcSizes)
+    {
+        const uint32_t width = size[0];
+        const uint32_t height = size[1];
+        std::vector<uint8_t> image(width * height);
+        for (uint8_t& pixel : image)
+        {
+            pixel = uint8_t(random());
+        }
+
+        const size_t pitch = TexturePitch((std::max)(width, height));
+        std::vector<uint32_t> expected(pitch / 4 * (std::max)(width, height));
+        std::vector<uint32_t> actual(expected.size());
+
+        struct Variant { const char* name; SensorType sensorType; Orientation orientation; };
+        const Variant variants[] = {
+            { "gray8/left_front", SensorType::LeftFront, Orientation::MirrorX },
+            { "gray8/right_front", SensorType::RightFront, Orientation::MirrorY },
+            { "gray8/left_left", SensorType::LeftLeft, Orientation::Identity },
+        };
+        for (const Variant& variant : variants)
+        {
+            auto kernel = [&]()
+            {
+                switch (variant.orientation)
+                {
+                case Orientation::MirrorX: Gray8ToBgra<Orientation::MirrorX>(image.data(), width, width, height, actual.data(), pitch); break;
+                case Orientation::MirrorY: Gray8ToBgra<Orientation::MirrorY>(image.data(), width, width, height, actual.data(), pitch); break;
+                default: Gray8ToBgra<Orientation::Identity>(image.data(), width, width, height, actual.data(), pitch); break;
+                }
+            };
+            auto reference = [&]() { ReferenceGray8ToBgra(variant.sensorType, image.data(), width, height, expected.data(), pitch); };
+
+            reference();
+            kernel();
+            const std::string name = std::string(variant.name) + "/" + std::to_string(width) + "x" + std::to_string(height);
+            Check(expected == actual, name);
+            if (width == 640)
+            {
+                PrintRow(name.c_str(), Time(width * height, minSeconds, reference), Time(width * height, minSeconds, kernel));
+            }
+        }
+
+        // Rotations have no former loop, compare with the plain mapping
+        struct Rotation { const char* name; Orientation orientation; };
+        const Rotation rotations[] = {
+            { "gray8/rotate180", Orientation::Rotate180 },
+            { "gray8/rotate90cw", Orientation::Rotate90Clockwise },
+            { "gray8/rotate90ccw", Orientation::Rotate90CounterClockwise },
+        };
+        for (const Rotation& rotation : rotations)
+        {
+            auto kernel = [&]()
+            {
+                switch (rotation.orientation)
+                {
+                case Orientation::Rotate180: Gray8ToBgra<Orientation::Rotate180>(image.data(), width, width, height, actual.data(), pitch); break;
+                case Orientation::Rotate90Clockwise: Gray8ToBgra<Orientation::Rotate90Clockwise>(image.data(), width, width, height, actual.data(), pitch); break;
+                default: Gray8ToBgra<Orientation::Rotate90CounterClockwise>(image.data(), width, width, height, actual.data(), pitch); break;
+                }
+            };
+            auto reference = [&]() { NaiveGray8ToBgra(rotation.orientation, image.data(), width, height, expected.data(), pitch); };
+
+            reference();
+            kernel();
+            const std::string name = std::string(rotation.name) + "/" + std::to_string(width) + "x" + std::to_string(height);
+            Check(expected == actual, name);
+            if (width == 640)
+            {
+                PrintRow(name.c_str(), Time(width * height, minSeconds, reference), Time(width * height, minSeconds, kernel));
+            }
+        }
+    }
+
+    // Depth, with every value range the sensors produce: invalid sigma, AHaT's invalid codes, beyond the clamp
+    struct DepthCase { const char* name; SensorType sensorType; uint32_t width; uint32_t height; };
+    const DepthCase depthCases[] = {
+        { "depth/long_throw/320x288", SensorType::LongThrow, 320, 288 },
+        { "depth/ahat/512x512", SensorType::Ahat, 512, 512 },
+    };
+    for (const DepthCase& depthCase : depthCases)
+    {
+        const bool isLongThrow = depthCase.sensorType == SensorType::LongThrow;
+        const uint32_t width = depthCase.width;
+        const uint32_t height = depthCase.height;
+        std::vector<uint16_t> depth(width * height);
+        std::vector<uint8_t> sigma(width * height);
+        for (size_t i = 0; i < depth.size(); ++i)
+        {
+            depth[i] = uint16_t(random() % (isLongThrow ? 7000 : 4096));
+            sigma[i] = uint8_t(random() % 8 == 0 ? 0x80 : 0);
+        }
+        const uint8_t* pSigma = isLongThrow ? sigma.data() : nullptr;
+
+        const size_t pitch = TexturePitch(width);
+        std::vector<uint32_t> expected(pitch / 4 * height);
+        std::vector<uint32_t> actual(expected.size());
+        std::vector<uint32_t> lut;
+
+        const auto lutStart = std::chrono::steady_clock::now();
+        BuildColorLut(lut, 0, isLongThrow ? 4000 : 1000, isLongThrow ? 0 : 4090, Colormap::Gray);
+        const double lutMilliseconds = 1000.0 * std::chrono::duration<double>(std::chrono::steady_clock::now() - lutStart).count();
+
+        auto reference = [&]() { ReferenceDepthToBgra(depthCase.sensorType, depth.data(), pSigma, width, height, expected.data(), pitch); };
+        auto kernel = [&]()
+        {
+            Depth16ToBgra<Orientation::Identity>(depth.data(), width * sizeof(uint16_t), pSigma, width, isLongThrow ? 0x80 : 0,
+                width, height, lut.data(), actual.data(), pitch);
+        };
+
+        reference();
+        kernel();
+        Check(expected == actual, depthCase.name);
+        PrintRow(depthCase.name, Time(width * height, minSeconds, reference), Time(width * height, minSeconds, kernel));
+        printf("%-28s %.2f ms to build the table\n", "", lutMilliseconds);
+    }
+
+    // The colormap only has to be monotonic in hue, check its ends
+    std::vector<uint32_t> jet;
+    BuildColorLut(jet, 0, 1000, 0, Colormap::Jet);
+    Check(jet[0] == 0, "jet/invalid is black");
+    Check((jet[1] & 0xFF) > 0 && (jet[1] >> 16) == 0, "jet/near is blue");
+    Check((jet[1000] >> 16) > 0 && (jet[1000] & 0xFF) == 0, "jet/far is red");
+
+    if (g_failures > 0)
+    {
+        printf("\n%d mismatches\n", g_failures);
+        return 1;
+    }
+    printf("\nAll kernels match the reference\n");
+    return 0;
+}
@@ -0,0 +1,592 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Times StereoRectification and SemiGlobalMatcher on LF/RF pairs, replayed from a StreamRecorder capture or
+// rendered from a synthetic scene whose true disparities are known.
+
+#include "StereoDepth.h"
+#include "ResearchModeReplay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace BasicHologram;
+
+namespace
+{
+    struct Pair
+    {
+        std::vector<uint8_t> left;
+        std::vector<uint8_t> right;
+        std::vector<float> trueDisparity;   // Synthetic pairs only, per rectified pixel, 0 where unknown
+    };
+
+    struct Stats
+    {
+        std::vector<double> rectifyMs;
+        std::vector<double> matchMs;
+        uint64_t maskedPixels = 0;
+        uint64_t validPixels = 0;
+        uint64_t comparedPixels = 0;
+        uint64_t badPixels = 0;
+        double absoluteErrorSum = 0.0;
+    };
+
+    double Mean(const std::vector<double>& values)
+    {
+        double sum = 0.0;
+        for (double value : values)
+        {
+            sum += value;
+        }
+        return values.empty() ? 0.0 : sum / values.size();
+    }
+
+    double Percentile(std::vector<double> values, double fraction)
+    {
+        if (values.empty())
+        {
+            return 0.0;
+        }
+        std::sort(values.begin(), values.end());
+        return values[(size_t)(fraction * (values.size() - 1))];
+    }
+
+    void WritePgm(const std::string& path, const uint8_t* pPixels, uint32_t width, uint32_t height)
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "P5\n" << width << " " << height << "\n255\n";
+        file.write(reinterpret_cast<const char*>(pPixels), (std::streamsize)width * height);
+    }
+
+    // Synthetic rig: two 640x480 pinhole cameras 10 cm apart, turned a quarter turn in opposite directions and
+    // yawed 10 degrees outwards, like the front VLC cameras. Rig axes: x right, y down, z forward.
+    struct SyntheticCamera
+    {
+        float rotation[3][3];   // Rig to camera, column vectors
+        float center[3];
+        float focal;
+    };
+
+    const uint32_t kSyntheticWidth = 640;
+    const uint32_t kSyntheticHeight = 480;
+
+    SyntheticCamera MakeSyntheticCamera(float centerX, float roll, float yaw)
+    {
+        // Camera to rig = yaw about y, then roll about the optical axis
+        const float cy = std::cos(yaw), sy = std::sin(yaw), cr = std::cos(roll), sr = std::sin(roll);
+        const float yawMatrix[3][3] = { { cy, 0, sy }, { 0, 1, 0 }, { -sy, 0, cy } };
+        const float rollMatrix[3][3] = { { cr, -sr, 0 }, { sr, cr, 0 }, { 0, 0, 1 } };
+
+        SyntheticCamera camera = {};
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                float cameraToRig = 0.0f;
+                for (int k = 0; k < 3; k++)
+                {
+                    cameraToRig += yawMatrix[r][k] * rollMatrix[k][c];
+                }
+                camera.rotation[c][r] = cameraToRig;
+            }
+        }
+        camera.center[0] = centerX;
+        camera.focal = 370.0f;
+        return camera;
+    }
+
+    StereoCameraModel MakeModel(const SyntheticCamera& camera)
+    {
+        StereoCameraModel model;
+        model.width = kSyntheticWidth;
+        model.height = kSyntheticHeight;
+
+        // Row vector rig to camera: the rotation transposed, then the translation -R * center
+        for (int r = 0; r < 3; r++)
+        {
+            float translation = 0.0f;
+            for (int c = 0; c < 3; c++)
+            {
+                model.rigToCamera[c][r] = camera.rotation[r][c];
+                translation -= camera.rotation[r][c] * camera.center[c];
+            }
+            model.rigToCamera[3][r] = translation;
+        }
+        model.rigToCamera[3][3] = 1.0f;
+
+        const float focal = camera.focal;
+        model.imageToUnitPlane = [focal](float u, float v, float& x, float& y)
+        {
+            x = (u - kSyntheticWidth * 0.5f) / focal;
+            y = (v - kSyntheticHeight * 0.5f) / focal;
+            return true;
+        };
+        model.unitPlaneToImage = [focal](float x, float y, float& u, float& v)
+        {
+            u = x * focal + kSyntheticWidth * 0.5f;
+            v = y * focal + kSyntheticHeight * 0.5f;
+            return u >= 0.0f && v >= 0.0f && u <= kSyntheticWidth && v <= kSyntheticHeight;
+        };
+        return model;
+    }
+
+    float Hash(int x, int y, int z)
+    {
+        uint32_t h = (uint32_t)x * 374761393u + (uint32_t)y * 668265263u + (uint32_t)z * 2147483647u;
+        h = (h ^ (h >> 13)) * 1274126177u;
+        return ((h ^ (h >> 16)) & 0xffff) / 65535.0f;
+    }
+
+    // Value noise, so both cameras see the same texture on the surfaces
+    float Texture(const float p[3])
+    {
+        float value = 0.0f;
+        float amplitude = 0.6f;
+        float frequency = 25.0f;
+        for (int octave = 0; octave < 3; octave++)
+        {
+            const float x = p[0] * frequency, y = p[1] * frequency, z = p[2] * frequency;
+            const int ix = (int)std::floor(x), iy = (int)std::floor(y), iz = (int)std::floor(z);
+            const float fx = x - ix, fy = y - iy, fz = z - iz;
+            float corners = 0.0f;
+            for (int k = 0; k < 8; k++)
+            {
+                const int dx = k & 1, dy = (k >> 1) & 1, dz = k >> 2;
+                corners += Hash(ix + dx, iy + dy, iz + dz) * (dx ? fx : 1 - fx) * (dy ? fy : 1 - fy) * (dz ? fz : 1 - fz);
+            }
+            value += amplitude * corners;
+            amplitude *= 0.5f;
+            frequency *= 2.3f;
+        }
+        return value;
+    }
+
+    // Distance along a unit ray from the rig origin region to the scene: a wall at 3 m, a floor 0.6 m down and
+    // a ball of 0.35 m at 1.2 m
+    float Trace(const float origin[3], const float direction[3], float hit[3])
+    {
+        float distance = 1e9f;
+        if (direction[2] > 0.0f)
+        {
+            distance = (std::min)(distance, (3.0f - origin[2]) / direction[2]);
+        }
+        if (direction[1] > 0.0f)
+        {
+            distance = (std::min)(distance, (0.6f - origin[1]) / direction[1]);
+        }
+        const float ball[3] = { 0.15f, 0.05f, 1.2f };
+        const float toBall[3] = { ball[0] - origin[0], ball[1] - origin[1], ball[2] - origin[2] };
+        const float along = toBall[0] * direction[0] + toBall[1] * direction[1] + toBall[2] * direction[2];
+        const float squared = toBall[0] * toBall[0] + toBall[1] * toBall[1] + toBall[2] * toBall[2] - along * along;
+        if (along > 0.0f && squared < 0.35f * 0.35f)
+        {
+            distance = (std::min)(distance, along - std::sqrt(0.35f * 0.35f - squared));
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            hit[i] = origin[i] + direction[i] * distance;
+        }
+        return distance;
+    }
+
+    void Render(const SyntheticCamera& camera, uint32_t seed, std::vector<uint8_t>& image)
+    {
+        image.resize(kSyntheticWidth * kSyntheticHeight);
+        uint32_t noise = seed * 2654435761u + 1;
+        for (uint32_t v = 0; v < kSyntheticHeight; v++)
+        {
+            for (uint32_t u = 0; u < kSyntheticWidth; u++)
+            {
+                const float ray[3] = { (u + 0.5f - kSyntheticWidth * 0.5f) / camera.focal, (v + 0.5f - kSyntheticHeight * 0.5f) / camera.focal, 1.0f };
+                float direction[3];
+                for (int r = 0; r < 3; r++)
+                {
+                    direction[r] = camera.rotation[0][r] * ray[0] + camera.rotation[1][r] * ray[1] + camera.rotation[2][r] * ray[2];
+                }
+                const float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+                for (float& component : direction)
+                {
+                    component /= length;
+                }
+                float hit[3];
+                Trace(camera.center, direction, hit);
+
+                noise = noise * 1664525u + 1013904223u;
+                const float sensorNoise = ((noise >> 24) / 255.0f - 0.5f) * 6.0f;
+                const float value = 30.0f + 190.0f * Texture(hit) + sensorNoise;
+                image[v * kSyntheticWidth + u] = (uint8_t)(std::max)(0.0f, (std::min)(255.0f, value));
+            }
+        }
+    }
+
+    // True disparity at every rectified pixel: a pixel at distance t along its ray has disparity |P1| / t,
+    // with P1 the point at disparity 1 on that ray
+    void ComputeTrueDisparity(const StereoRectification& rectification, const SyntheticCamera& leftCamera, std::vector<float>& disparity)
+    {
+        const uint32_t width = rectification.GetWidth();
+        const uint32_t height = rectification.GetHeight();
+        disparity.assign(width * height, 0.0f);
+        for (uint32_t v = 0; v < height; v++)
+        {
+            for (uint32_t u = 0; u < width; u++)
+            {
+                float point[3];
+                if (!rectification.RectifiedToCamera(u + 0.5f, v + 0.5f, 1.0f, point))
+                {
+                    continue;
+                }
+                const float length = std::sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
+                float direction[3];
+                for (int r = 0; r < 3; r++)
+                {
+                    direction[r] = (leftCamera.rotation[0][r] * point[0] + leftCamera.rotation[1][r] * point[1] + leftCamera.rotation[2][r] * point[2]) / length;
+                }
+                float hit[3];
+                disparity[v * width + u] = length / Trace(leftCamera.center, direction, hit);
+            }
+        }
+    }
+
+    StereoCameraModel MakeReplayModel(IResearchModeSensor* pSensor, uint32_t width, uint32_t height)
+    {
+        IResearchModeCameraSensor* pCameraSensor = nullptr;
+        StereoCameraModel model;
+        if (FAILED(pSensor->QueryInterface(IID_PPV_ARGS(&pCameraSensor))))
+        {
+            return model;
+        }
+        DirectX::XMFLOAT4X4 extrinsics;
+        if (FAILED(pCameraSensor->GetCameraExtrinsicsMatrix(&extrinsics)))
+        {
+            pCameraSensor->Release();
+            return model;
+        }
+        memcpy(model.rigToCamera, extrinsics.m, sizeof(model.rigToCamera));
+        model.width = width;
+        model.height = height;
+
+        // The lambdas keep the sensor alive, the model holds one reference per mapping function
+        std::shared_ptr<IResearchModeCameraSensor> camera(pCameraSensor, [](IResearchModeCameraSensor* p) { p->Release(); });
+        model.imageToUnitPlane = [camera](float u, float v, float& x, float& y)
+        {
+            float uv[2] = { u, v };
+            float xy[2];
+            const bool mapped = SUCCEEDED(camera->MapImagePointToCameraUnitPlane(uv, xy));
+            x = xy[0];
+            y = xy[1];
+            return mapped;
+        };
+        model.unitPlaneToImage = [camera](float x, float y, float& u, float& v)
+        {
+            float xy[2] = { x, y };
+            float uv[2];
+            const bool mapped = SUCCEEDED(camera->MapCameraSpaceToImagePoint(xy, uv));
+            u = uv[0];
+            v = uv[1];
+            return mapped;
+        };
+        return model;
+    }
+
+    struct ReplayFrame
+    {
+        uint64_t relativeTicks;
+        std::vector<uint8_t> pixels;
+    };
+
+    bool ReadReplayFrames(IResearchModeSensor* pSensor, size_t maxFrames, uint32_t& width, uint32_t& height, std::vector<ReplayFrame>& frames)
+    {
+        if (FAILED(pSensor->OpenStream()))
+        {
+            return false;
+        }
+        uint64_t firstTicks = 0;
+        while (frames.size() < maxFrames)
+        {
+            IResearchModeSensorFrame* pFrame = nullptr;
+            if (FAILED(pSensor->GetNextBuffer(&pFrame)))
+            {
+                break;
+            }
+            IResearchModeSensorVLCFrame* pVLCFrame = nullptr;
+            ResearchModeSensorResolution resolution;
+            ResearchModeSensorTimestamp timestamp;
+            pFrame->GetResolution(&resolution);
+            pFrame->GetTimeStamp(&timestamp);
+            if (SUCCEEDED(pFrame->QueryInterface(IID_PPV_ARGS(&pVLCFrame))))
+            {
+                const BYTE* pImage = nullptr;
+                size_t length = 0;
+                pVLCFrame->GetBuffer(&pImage, &length);
+                if (frames.empty())
+                {
+                    firstTicks = timestamp.HostTicks;
+                }
+                frames.push_back({ timestamp.HostTicks - firstTicks, std::vector<uint8_t>(pImage, pImage + length) });
+                width = resolution.Width;
+                height = resolution.Height;
+                pVLCFrame->Release();
+            }
+            pFrame->Release();
+        }
+        pSensor->CloseStream();
+        return !frames.empty();
+    }
+
+    void PrintUsage()
+    {
+        printf("usage: StereoDepthBenchmark [options] [capture folder]\n"
+               "  The capture folder holds \"VLC LF.tar\" and \"VLC RF.tar\" with their LUTs and extrinsics.\n"
+               "  Without one, a synthetic pair with known disparities is used.\n"
+               "  --scale s        rectified resolution relative to the cameras (default 0.5)\n"
+               "  --disparities n  disparity search range (default 64)\n"
+               "  --frames n       pairs to process (default 100)\n"
+               "  --dump prefix    write the last rectified pair and its disparities as <prefix>_*.pgm\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    StereoOptions options;
+    size_t frameCount = 100;
+    std::string captureFolder;
+    std::string dumpPrefix;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--scale" && hasValue)
+        {
+            options.scale = (float)atof(argv[++i]);
+        }
+        else if (arg == "--disparities" && hasValue)
+        {
+            options.disparityCount = (uint32_t)atoi(argv[++i]);
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            frameCount = (size_t)atoll(argv[++i]);
+        }
+        else if (arg == "--dump" && hasValue)
+        {
+            dumpPrefix = argv[++i];
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+        {
+            PrintUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+        else
+        {
+            captureFolder = arg;
+        }
+    }
+
+    StereoRectification rectification;
+    SemiGlobalMatcher matcher(options);
+    std::vector<Pair> pairs;
+    std::vector<std::vector<uint8_t>> leftImages;
+    std::vector<std::vector<uint8_t>> rightImages;
+    uint32_t cameraWidth = 0;
+    uint32_t cameraHeight = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    if (captureFolder.empty())
+    {
+        const float kPi = 3.14159265f;
+        const SyntheticCamera leftCamera = MakeSyntheticCamera(-0.05f, kPi / 2, -10.0f * kPi / 180);
+        const SyntheticCamera rightCamera = MakeSyntheticCamera(0.05f, -kPi / 2, 10.0f * kPi / 180);
+        cameraWidth = kSyntheticWidth;
+        cameraHeight = kSyntheticHeight;
+        start = std::chrono::steady_clock::now();
+        if (!rectification.Build(MakeModel(leftCamera), MakeModel(rightCamera), options.scale))
+        {
+            printf("Rectification failed\n");
+            return 1;
+        }
+
+        // A few distinct noise patterns, cycled through
+        const uint32_t kDistinctFrames = 4;
+        Pair truth;
+        ComputeTrueDisparity(rectification, leftCamera, truth.trueDisparity);
+        for (uint32_t i = 0; i < kDistinctFrames; i++)
+        {
+            leftImages.emplace_back();
+            rightImages.emplace_back();
+            Render(leftCamera, 2 * i, leftImages.back());
+            Render(rightCamera, 2 * i + 1, rightImages.back());
+        }
+        pairs.push_back(truth);
+    }
+    else
+    {
+        ResearchModeReplay::ReplayOptions replayOptions;
+        replayOptions.mode = ResearchModeReplay::PlaybackMode::AsFastAsPossible;
+        IResearchModeSensor* pSensors[2] = {};
+        const char* names[2] = { "VLC LF.tar", "VLC RF.tar" };
+        std::vector<ReplayFrame> frames[2];
+        StereoCameraModel models[2];
+        for (int k = 0; k < 2; k++)
+        {
+            const std::filesystem::path tarPath = std::filesystem::path(captureFolder) / names[k];
+            if (FAILED(ResearchModeReplay::CreateReplaySensor(tarPath, replayOptions, &pSensors[k])))
+            {
+                printf("Can't open %s\n", tarPath.string().c_str());
+                return 1;
+            }
+            if (!ReadReplayFrames(pSensors[k], frameCount * 2, cameraWidth, cameraHeight, frames[k]))
+            {
+                printf("No frames in %s\n", tarPath.string().c_str());
+                return 1;
+            }
+            models[k] = MakeReplayModel(pSensors[k], cameraWidth, cameraHeight);
+            pSensors[k]->Release();
+        }
+
+        start = std::chrono::steady_clock::now();
+        if (!rectification.Build(models[0], models[1], options.scale))
+        {
+            printf("Rectification failed, the capture needs the LUTs and extrinsics of both cameras\n");
+            return 1;
+        }
+
+        // Both cameras are triggered together; replayed timestamps start at each stream's first frame
+        const uint64_t kTolerance = 10000;  // 1 ms in 100 ns ticks
+        size_t j = 0;
+        for (const ReplayFrame& left : frames[0])
+        {
+            while (j < frames[1].size() && frames[1][j].relativeTicks + kTolerance < left.relativeTicks)
+            {
+                j++;
+            }
+            if (j < frames[1].size() && frames[1][j].relativeTicks <= left.relativeTicks + kTolerance)
+            {
+                leftImages.push_back(left.pixels);
+                rightImages.push_back(frames[1][j].pixels);
+            }
+        }
+        if (leftImages.empty())
+        {
+            printf("No LF frame has an RF frame with the same timestamp\n");
+            return 1;
+        }
+        pairs.emplace_back();
+    }
+    const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const uint32_t width = rectification.GetWidth();
+    const uint32_t height = rectification.GetHeight();
+    const std::vector<uint8_t>& leftMask = rectification.GetValidMask(0);
+    const std::vector<float>& trueDisparity = pairs[0].trueDisparity;
+
+    std::vector<uint8_t> left(width * height);
+    std::vector<uint8_t> right(width * height);
+    std::vector<int16_t> disparity(width * height);
+    Stats stats;
+
+    for (size_t frame = 0; frame < frameCount; frame++)
+    {
+        const std::vector<uint8_t>& leftImage = leftImages[frame % leftImages.size()];
+        const std::vector<uint8_t>& rightImage = rightImages[frame % rightImages.size()];
+
+        auto begin = std::chrono::steady_clock::now();
+        rectification.Rectify(0, leftImage.data(), cameraWidth, left.data());
+        rectification.Rectify(1, rightImage.data(), cameraWidth, right.data());
+        auto rectified = std::chrono::steady_clock::now();
+        matcher.Compute(left.data(), right.data(), leftMask.data(), width, height, disparity.data());
+        auto matched = std::chrono::steady_clock::now();
+
+        stats.rectifyMs.push_back(std::chrono::duration<double, std::milli>(rectified - begin).count());
+        stats.matchMs.push_back(std::chrono::duration<double, std::milli>(matched - rectified).count());
+
+        for (size_t i = 0; i < disparity.size(); i++)
+        {
+            if (!leftMask[i])
+            {
+                continue;
+            }
+            stats.maskedPixels++;
+            if (disparity[i] == SemiGlobalMatcher::kInvalidDisparity)
+            {
+                continue;
+            }
+            stats.validPixels++;
+            if (!trueDisparity.empty() && trueDisparity[i] > 0.0f && trueDisparity[i] < matcher.GetOptions().disparityCount - 1)
+            {
+                const double error = std::fabs(disparity[i] / (double)SemiGlobalMatcher::kDisparityScale - trueDisparity[i]);
+                stats.comparedPixels++;
+                stats.absoluteErrorSum += error;
+                stats.badPixels += error > 1.0 ? 1 : 0;
+            }
+        }
+    }
+
+    if (!dumpPrefix.empty())
+    {
+        std::vector<uint8_t> disparityImage(width * height);
+        for (size_t i = 0; i < disparity.size(); i++)
+        {
+            disparityImage[i] = disparity[i] < 0 ? 0 : (uint8_t)(std::min)(255, disparity[i] * 255 / (int)(matcher.GetOptions().disparityCount * SemiGlobalMatcher::kDisparityScale));
+        }
+        WritePgm(dumpPrefix + "_left.pgm", left.data(), width, height);
+        WritePgm(dumpPrefix + "_right.pgm", right.data(), width, height);
+        WritePgm(dumpPrefix + "_disparity.pgm", disparityImage.data(), width, height);
+    }
+
+    std::vector<double> totalMs(stats.rectifyMs.size());
+    for (size_t i = 0; i < totalMs.size(); i++)
+    {
+        totalMs[i] = stats.rectifyMs[i] + stats.matchMs[i];
+    }
+    const double fps = 1000.0 / Mean(totalMs);
+
+#if defined(STEREO_DEPTH_NO_SIMD)
+    const char* pAggregation = "scalar";
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    const char* pAggregation = "NEON";
+#elif defined(__SSE2__) || defined(_M_X64)
+    const char* pAggregation = "SSE2";
+#else
+    const char* pAggregation = "scalar";
+#endif
+
+    printf("Source:        %s, %zu distinct pairs of %ux%u\n", captureFolder.empty() ? "synthetic" : captureFolder.c_str(), leftImages.size(), cameraWidth, cameraHeight);
+    printf("Rectified:     %ux%u, focal %.1f px, baseline %.3f m, %u disparities (%.2f m and beyond)\n", width, height,
+           rectification.GetFocalLength(), rectification.GetBaseline(), matcher.GetOptions().disparityCount,
+           rectification.DisparityToDepth((float)matcher.GetOptions().disparityCount - 1));
+    printf("Aggregation:   %s\n", pAggregation);
+    printf("Map build:     %.1f ms, once\n\n", buildMs);
+
+    printf("%-12s %10s %10s\n", "stage", "mean ms", "p95 ms");
+    printf("%-12s %10.2f %10.2f\n", "rectify", Mean(stats.rectifyMs), Percentile(stats.rectifyMs, 0.95));
+    printf("%-12s %10.2f %10.2f\n", "match", Mean(stats.matchMs), Percentile(stats.matchMs, 0.95));
+    printf("%-12s %10.2f %10.2f\n\n", "total", Mean(totalMs), Percentile(totalMs, 0.95));
+
+    printf("Throughput:    %.1f fps (target 15)\n", fps);
+    printf("Valid:         %.1f%% of the pixels both cameras see\n", stats.maskedPixels ? 100.0 * stats.validPixels / stats.maskedPixels : 0.0);
+    if (stats.comparedPixels > 0)
+    {
+        printf("Error:         %.2f px mean, %.1f%% off by more than 1 px\n", stats.absoluteErrorSum / stats.comparedPixels,
+               100.0 * stats.badPixels / stats.comparedPixels);
+    }
+
+    return fps >= 15.0 ? 0 : 1;
+}
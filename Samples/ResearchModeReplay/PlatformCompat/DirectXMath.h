@@ -0,0 +1,30 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Only the storage types that appear in ResearchModeApi.h. Code doing math with DirectXMath on Linux should
+// use the real, header only, DirectXMath instead of this folder.
+
+namespace DirectX
+{
+    struct XMFLOAT3
+    {
+        float x;
+        float y;
+        float z;
+    };
+
+    struct XMFLOAT4X4
+    {
+        float m[4][4];
+    };
+}
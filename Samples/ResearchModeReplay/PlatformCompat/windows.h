@@ -0,0 +1,128 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// The subset of windows.h that ResearchModeApi.h and the replay sensors need, so they build on Linux.
+// Only put this folder on the include path when building off Windows.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+typedef uint8_t BYTE;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef uint32_t ULONG;
+typedef int32_t LONG;
+typedef uint32_t DWORD;
+typedef int32_t HRESULT;
+typedef const wchar_t* LPCWSTR;
+
+#define S_OK            ((HRESULT)0x00000000L)
+#define S_FALSE         ((HRESULT)0x00000001L)
+#define E_NOTIMPL       ((HRESULT)0x80004001L)
+#define E_NOINTERFACE   ((HRESULT)0x80004002L)
+#define E_POINTER       ((HRESULT)0x80004003L)
+#define E_ABORT         ((HRESULT)0x80004004L)
+#define E_FAIL          ((HRESULT)0x80004005L)
+#define E_UNEXPECTED    ((HRESULT)0x8000FFFFL)
+#define E_ACCESSDENIED  ((HRESULT)0x80070005L)
+#define E_INVALIDARG    ((HRESULT)0x80070057L)
+
+#define SUCCEEDED(hr)   (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)      (((HRESULT)(hr)) < 0)
+
+struct GUID
+{
+    uint32_t Data1;
+    uint16_t Data2;
+    uint16_t Data3;
+    uint8_t Data4[8];
+};
+typedef const GUID& REFIID;
+
+inline bool operator==(const GUID& a, const GUID& b) { return memcmp(&a, &b, sizeof(GUID)) == 0; }
+inline bool operator!=(const GUID& a, const GUID& b) { return !(a == b); }
+
+struct LUID
+{
+    DWORD LowPart;
+    LONG HighPart;
+};
+
+// "XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX", as in the DECLARE_INTERFACE_IID_ declarations
+inline GUID ParseGuidString(const char* text)
+{
+    unsigned int data1, data2, data3, data4[8];
+    GUID guid = {};
+    if (sscanf(text, "%8x-%4x-%4x-%2x%2x-%2x%2x%2x%2x%2x%2x", &data1, &data2, &data3,
+        &data4[0], &data4[1], &data4[2], &data4[3], &data4[4], &data4[5], &data4[6], &data4[7]) == 11)
+    {
+        guid.Data1 = data1;
+        guid.Data2 = static_cast<uint16_t>(data2);
+        guid.Data3 = static_cast<uint16_t>(data3);
+        for (int i = 0; i < 8; ++i)
+        {
+            guid.Data4[i] = static_cast<uint8_t>(data4[i]);
+        }
+    }
+    return guid;
+}
+
+// Stands in for __declspec(uuid), which only MSVC has
+template<typename Interface>
+struct InterfaceIid;
+
+#define __uuidof(Interface) (InterfaceIid<std::remove_cv_t<Interface>>::Get())
+
+#define interface struct
+#define STDMETHODCALLTYPE
+#define STDMETHOD(method) virtual HRESULT STDMETHODCALLTYPE method
+#define STDMETHOD_(type, method) virtual type STDMETHODCALLTYPE method
+#define STDMETHODIMP HRESULT STDMETHODCALLTYPE
+#define STDMETHODIMP_(type) type STDMETHODCALLTYPE
+
+#define DECLARE_INTERFACE_IID_(iface, baseiface, iid) \
+    struct iface; \
+    template<> struct InterfaceIid<iface> { static const GUID& Get() { static const GUID id = ParseGuidString(iid); return id; } }; \
+    struct iface : public baseiface
+
+struct IUnknown
+{
+    virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) = 0;
+    virtual ULONG STDMETHODCALLTYPE AddRef() = 0;
+    virtual ULONG STDMETHODCALLTYPE Release() = 0;
+};
+
+template<>
+struct InterfaceIid<IUnknown>
+{
+    static const GUID& Get() { static const GUID id = ParseGuidString("00000000-0000-0000-C000-000000000046"); return id; }
+};
+
+template<typename T>
+void** IID_PPV_ARGS_Helper(T** pp)
+{
+    return reinterpret_cast<void**>(pp);
+}
+
+#define IID_PPV_ARGS(ppType) __uuidof(std::remove_reference_t<decltype(**(ppType))>), IID_PPV_ARGS_Helper(ppType)
+
+// SAL annotations are documentation only here
+#define _In_
+#define _Out_
+#define _Outptr_
+#define _Outptr_result_nullonfailure_
+#define _Out_writes_(size)
@@ -0,0 +1,170 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "ResearchModeApi.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Frame object shared by the replay and synthetic sensors, not part of the library's interface.
+
+namespace ResearchModeReplay
+{
+    namespace Detail
+    {
+        // Same values as RMCameraReader uses to invalidate depth before saving
+        constexpr UINT16 kAhatInvalidValue = 4090;
+        constexpr BYTE kSigmaInvalidMask = 0x80;
+
+        constexpr uint64_t kTicksPerSecond = 10'000'000;
+
+        inline bool IsDepthSensor(ResearchModeSensorType sensorType)
+        {
+            return sensorType == DEPTH_AHAT || sensorType == DEPTH_LONG_THROW;
+        }
+
+        struct RecordedFrame
+        {
+            ResearchModeSensorResolution resolution = {};
+            std::vector<BYTE> image;        // VLC, or BGRA for synthetic color cameras
+            std::vector<UINT16> depth;
+            std::vector<UINT16> ab;
+            std::vector<BYTE> sigma;        // Long Throw only
+        };
+
+        class ReplayFrame : public IResearchModeSensorFrame, public IResearchModeSensorVLCFrame, public IResearchModeSensorDepthFrame
+        {
+        public:
+            ReplayFrame(std::shared_ptr<const RecordedFrame> frame, const ResearchModeSensorTimestamp& timestamp, ResearchModeSensorType sensorType) :
+                m_frame(std::move(frame)),
+                m_timestamp(timestamp),
+                m_sensorType(sensorType)
+            {
+            }
+
+            HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+            {
+                if (!ppvObject)
+                {
+                    return E_POINTER;
+                }
+
+                if (riid == __uuidof(IUnknown) || riid == __uuidof(IResearchModeSensorFrame))
+                {
+                    *ppvObject = static_cast<IResearchModeSensorFrame*>(this);
+                }
+                else if (riid == __uuidof(IResearchModeSensorVLCFrame) && !IsDepthSensor(m_sensorType))
+                {
+                    *ppvObject = static_cast<IResearchModeSensorVLCFrame*>(this);
+                }
+                else if (riid == __uuidof(IResearchModeSensorDepthFrame) && IsDepthSensor(m_sensorType))
+                {
+                    *ppvObject = static_cast<IResearchModeSensorDepthFrame*>(this);
+                }
+                else
+                {
+                    *ppvObject = nullptr;
+                    return E_NOINTERFACE;
+                }
+
+                AddRef();
+                return S_OK;
+            }
+
+            ULONG STDMETHODCALLTYPE AddRef() override
+            {
+                return ++m_refCount;
+            }
+
+            ULONG STDMETHODCALLTYPE Release() override
+            {
+                const ULONG refCount = --m_refCount;
+                if (refCount == 0)
+                {
+                    delete this;
+                }
+                return refCount;
+            }
+
+            // IResearchModeSensorFrame
+            HRESULT STDMETHODCALLTYPE GetResolution(ResearchModeSensorResolution* pResolution) override
+            {
+                *pResolution = m_frame->resolution;
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE GetTimeStamp(ResearchModeSensorTimestamp* pTimeStamp) override
+            {
+                *pTimeStamp = m_timestamp;
+                return S_OK;
+            }
+
+            // IResearchModeSensorVLCFrame
+            HRESULT STDMETHODCALLTYPE GetBuffer(const BYTE** ppBytes, size_t* pBufferOutLength) override
+            {
+                *ppBytes = m_frame->image.data();
+                *pBufferOutLength = m_frame->image.size();
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE GetGain(UINT32* pGain) override
+            {
+                *pGain = 0;     // Not recorded
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE GetExposure(UINT64* pExposure) override
+            {
+                *pExposure = 0; // Not recorded
+                return S_OK;
+            }
+
+            // IResearchModeSensorDepthFrame
+            HRESULT STDMETHODCALLTYPE GetBuffer(const UINT16** ppBytes, size_t* pBufferOutLength) override
+            {
+                *ppBytes = m_frame->depth.data();
+                *pBufferOutLength = m_frame->depth.size();
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE GetAbDepthBuffer(const UINT16** ppBytes, size_t* pBufferOutLength) override
+            {
+                *ppBytes = m_frame->ab.data();
+                *pBufferOutLength = m_frame->ab.size();
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE GetSigmaBuffer(const BYTE** ppBytes, size_t* pBufferOutLength) override
+            {
+                if (m_sensorType != DEPTH_LONG_THROW)
+                {
+                    *ppBytes = nullptr;
+                    *pBufferOutLength = 0;
+                    return E_NOTIMPL;
+                }
+                *ppBytes = m_frame->sigma.data();
+                *pBufferOutLength = m_frame->sigma.size();
+                return S_OK;
+            }
+
+        private:
+            virtual ~ReplayFrame() = default;
+
+            std::atomic<ULONG> m_refCount{ 1 };
+            std::shared_ptr<const RecordedFrame> m_frame;    // Shared with the preloaded frames, never copied
+            const ResearchModeSensorTimestamp m_timestamp;
+            const ResearchModeSensorType m_sensorType;
+        };
+    }
+}
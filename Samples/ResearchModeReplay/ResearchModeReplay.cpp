@@ -0,0 +1,867 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ResearchModeReplay.h"
+#include "ReplayFrame.h"
+#include "FisheyeCameraModel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ResearchModeReplay
+{
+    using namespace Detail;
+
+    namespace
+    {
+        constexpr uint64_t kTarBlockSize = 512;
+
+        struct TarEntry
+        {
+            std::string name;
+            uint64_t dataOffset;
+            uint64_t size;
+        };
+
+        // Regular files of a ustar archive, as written by Io::Tarball
+        std::vector<TarEntry> ReadTarIndex(std::ifstream& file)
+        {
+            std::vector<TarEntry> entries;
+            char header[kTarBlockSize];
+            uint64_t offset = 0;
+
+            while (file.seekg(offset) && file.read(header, sizeof(header)))
+            {
+                if (header[0] == '\0')
+                {
+                    break;  // End of archive marker
+                }
+
+                std::string name(header, strnlen(header, 100));
+                const size_t prefixLength = strnlen(header + 345, 155);
+                if (prefixLength > 0)
+                {
+                    name = std::string(header + 345, prefixLength) + "/" + name;
+                }
+
+                const std::string sizeField(header + 124, strnlen(header + 124, 12));
+                const uint64_t size = std::strtoull(sizeField.c_str(), nullptr, 8);
+                const char type = header[156];
+                if (type == '0' || type == '\0')
+                {
+                    entries.push_back({ name, offset + kTarBlockSize, size });
+                }
+
+                offset += kTarBlockSize + (size + kTarBlockSize - 1) / kTarBlockSize * kTarBlockSize;
+            }
+
+            file.clear();
+            return entries;
+        }
+
+        // Binary PGM (P5) header, returns the offset of the pixels or 0 if the data isn't a PGM
+        size_t ParsePgmHeader(const std::vector<BYTE>& data, uint32_t& width, uint32_t& height, uint32_t& maxValue)
+        {
+            if (data.size() < 2 || data[0] != 'P' || data[1] != '5')
+            {
+                return 0;
+            }
+
+            size_t position = 2;
+            uint32_t values[3] = {};
+            for (uint32_t& value : values)
+            {
+                while (position < data.size() && (isspace(data[position]) || data[position] == '#'))
+                {
+                    if (data[position] == '#')
+                    {
+                        while (position < data.size() && data[position] != '\n')
+                        {
+                            ++position;
+                        }
+                    }
+                    else
+                    {
+                        ++position;
+                    }
+                }
+                if (position >= data.size() || !isdigit(data[position]))
+                {
+                    return 0;
+                }
+                while (position < data.size() && isdigit(data[position]))
+                {
+                    value = value * 10 + (data[position++] - '0');
+                }
+            }
+
+            width = values[0];
+            height = values[1];
+            maxValue = values[2];
+            // A single whitespace separates the header from the pixels
+            return position + 1;
+        }
+
+        bool TryGetSensorType(const std::wstring& friendlyName, ResearchModeSensorType& sensorType)
+        {
+            static const std::map<std::wstring, ResearchModeSensorType> sensorTypes = {
+                { L"VLC LF", LEFT_FRONT },
+                { L"VLC LL", LEFT_LEFT },
+                { L"VLC RF", RIGHT_FRONT },
+                { L"VLC RR", RIGHT_RIGHT },
+                { L"Depth AHaT", DEPTH_AHAT },
+                { L"Depth Long Throw", DEPTH_LONG_THROW } };
+
+            auto it = sensorTypes.find(friendlyName);
+            if (it == sensorTypes.end())
+            {
+                return false;
+            }
+            sensorType = it->second;
+            return true;
+        }
+
+        bool ReadWholeFile(const std::filesystem::path& path, void* pData, size_t size)
+        {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            return file && uint64_t(file.tellg()) == size && file.seekg(0) && file.read(static_cast<char*>(pData), size);
+        }
+
+        std::string ReadEnvironmentVariable(const char* name)
+        {
+#ifdef _MSC_VER
+            char* value = nullptr;
+            size_t length = 0;
+            std::string result;
+            if (_dupenv_s(&value, &length, name) == 0 && value)
+            {
+                result = value;
+            }
+            free(value);
+            return result;
+#else
+            const char* value = std::getenv(name);
+            return value ? value : "";
+#endif
+        }
+
+        // Where recorder_console.py downloads the calibration cache of each device, as in utils.py
+        std::filesystem::path GetDefaultCalibrationStore()
+        {
+            const std::string store = ReadEnvironmentVariable("HOLOLENS2_CALIBRATION_STORE");
+            if (!store.empty())
+            {
+                return store;
+            }
+#ifdef _WIN32
+            return std::filesystem::path(ReadEnvironmentVariable("USERPROFILE")) / ".hololens2_calibration";
+#else
+            return std::filesystem::path(ReadEnvironmentVariable("HOME")) / ".hololens2_calibration";
+#endif
+        }
+
+        // The LUT blob a <sensor>_calibration.txt references in the calibration store, named like in the recorder's
+        // cache: <store>/<device id>/<sensor>_lut_<first 16 digits of the SHA-256>.bin. Only its size is checked,
+        // utils.load_sensor_lut also checks the hash.
+        bool ReadReferencedLut(const std::filesystem::path& referencePath, const std::filesystem::path& calibrationStore,
+            const std::string& sensorName, uint32_t width, uint32_t height, std::vector<float>& lut)
+        {
+            std::ifstream file(referencePath);
+            std::map<std::string, std::string> reference;
+            std::string line;
+            while (std::getline(file, line))
+            {
+                const size_t comma = line.find(',');
+                if (comma != std::string::npos)
+                {
+                    reference[line.substr(0, comma)] = line.substr(comma + 1);
+                }
+            }
+
+            if (reference["device"].empty() || reference["lut"].size() < 16 ||
+                std::strtoul(reference["width"].c_str(), nullptr, 10) != width ||
+                std::strtoul(reference["height"].c_str(), nullptr, 10) != height)
+            {
+                return false;
+            }
+
+            const std::filesystem::path store = calibrationStore.empty() ? GetDefaultCalibrationStore() : calibrationStore;
+            lut.resize(size_t(width) * height * 3);
+            return ReadWholeFile(store / reference["device"] / (sensorName + "_lut_" + reference["lut"].substr(0, 16) + ".bin"),
+                lut.data(), lut.size() * sizeof(float));
+        }
+
+        // The LUT of a sensor in a capture folder, resolved like utils.load_sensor_lut does: captures from older
+        // versions of the recorder have their own <sensor>_lut.bin, newer ones reference a blob of the calibration
+        // store and, when it wasn't downloaded, the LUT is rebuilt from <sensor>_camera_model.bin.
+        bool ReadSensorLut(const std::filesystem::path& folder, const std::string& sensorName, const std::filesystem::path& calibrationStore,
+            uint32_t width, uint32_t height, std::vector<float>& lut)
+        {
+            lut.resize(size_t(width) * height * 3);
+            if (ReadWholeFile(folder / (sensorName + "_lut.bin"), lut.data(), lut.size() * sizeof(float)) ||
+                ReadReferencedLut(folder / (sensorName + "_calibration.txt"), calibrationStore, sensorName, width, height, lut))
+            {
+                return true;
+            }
+
+            std::vector<uint8_t> data(FisheyeCameraModel::kSerializedSize);
+            FisheyeCameraModel cameraModel;
+            if (!ReadWholeFile(folder / (sensorName + "_camera_model.bin"), data.data(), data.size()) ||
+                !cameraModel.Deserialize(data.data(), data.size()) ||
+                cameraModel.GetWidth() != width || cameraModel.GetHeight() != height)
+            {
+                return false;
+            }
+            lut = cameraModel.CreateLut();
+            return true;
+        }
+
+        // Unit plane mapping from the recorded LUT (unit vectors at pixel centers)
+        class LutCameraModel
+        {
+        public:
+            void Load(const std::vector<float>& lut, uint32_t width, uint32_t height)
+            {
+                m_width = width;
+                m_height = height;
+                m_x.resize(size_t(width) * height);
+                m_y.resize(size_t(width) * height);
+                m_valid.resize(size_t(width) * height);
+                for (size_t i = 0; i < m_x.size(); ++i)
+                {
+                    const float z = lut[3 * i + 2];
+                    m_valid[i] = z > 0.0f;
+                    m_x[i] = m_valid[i] ? lut[3 * i] / z : 0.0f;
+                    m_y[i] = m_valid[i] ? lut[3 * i + 1] / z : 0.0f;
+                }
+
+                FitPinhole();
+            }
+
+            bool IsLoaded() const { return !m_x.empty(); }
+
+            HRESULT ImageToUnitPlane(const float (&uv)[2], float (&xy)[2]) const
+            {
+                float jacobian[4];
+                return Interpolate(uv[0], uv[1], xy[0], xy[1], jacobian) ? S_OK : E_FAIL;
+            }
+
+            HRESULT UnitPlaneToImage(const float (&xy)[2], float (&uv)[2]) const
+            {
+                // Newton iterations on the interpolated LUT, from the pinhole guess or, for strongly distorted
+                // corners where that doesn't converge, from the closest LUT sample
+                float u = xy[0] * m_focalX + m_centerX;
+                float v = xy[1] * m_focalY + m_centerY;
+                if (Solve(xy, u, v))
+                {
+                    uv[0] = u;
+                    uv[1] = v;
+                    return S_OK;
+                }
+
+                ClosestSample(xy, u, v);
+                if (Solve(xy, u, v))
+                {
+                    uv[0] = u;
+                    uv[1] = v;
+                    return S_OK;
+                }
+                return E_FAIL;
+            }
+
+        private:
+            bool Interpolate(float u, float v, float& x, float& y, float (&jacobian)[4]) const
+            {
+                if (!(u >= 0.0f && v >= 0.0f && u <= m_width && v <= m_height))
+                {
+                    return false;
+                }
+
+                // LUT samples sit at pixel centers, the outer half pixel is extrapolated from the border cells
+                const float px = u - 0.5f;
+                const float py = v - 0.5f;
+                const uint32_t x0 = uint32_t((std::min)((std::max)(px, 0.0f), float(m_width - 2)));
+                const uint32_t y0 = uint32_t((std::min)((std::max)(py, 0.0f), float(m_height - 2)));
+                const float a = px - x0;
+                const float b = py - y0;
+
+                const size_t i00 = size_t(y0) * m_width + x0;
+                const size_t i10 = i00 + 1;
+                const size_t i01 = i00 + m_width;
+                const size_t i11 = i01 + 1;
+                if (!(m_valid[i00] && m_valid[i10] && m_valid[i01] && m_valid[i11]))
+                {
+                    return false;
+                }
+
+                x = (1 - a) * (1 - b) * m_x[i00] + a * (1 - b) * m_x[i10] + (1 - a) * b * m_x[i01] + a * b * m_x[i11];
+                y = (1 - a) * (1 - b) * m_y[i00] + a * (1 - b) * m_y[i10] + (1 - a) * b * m_y[i01] + a * b * m_y[i11];
+                jacobian[0] = (1 - b) * (m_x[i10] - m_x[i00]) + b * (m_x[i11] - m_x[i01]);    // dx/du
+                jacobian[1] = (1 - a) * (m_x[i01] - m_x[i00]) + a * (m_x[i11] - m_x[i10]);    // dx/dv
+                jacobian[2] = (1 - b) * (m_y[i10] - m_y[i00]) + b * (m_y[i11] - m_y[i01]);    // dy/du
+                jacobian[3] = (1 - a) * (m_y[i01] - m_y[i00]) + a * (m_y[i11] - m_y[i10]);    // dy/dv
+                return true;
+            }
+
+            bool Solve(const float (&xy)[2], float& u, float& v) const
+            {
+                constexpr int kMaxIterations = 20;
+                constexpr float kTolerance = 1e-6f;
+
+                for (int iteration = 0; iteration < kMaxIterations; ++iteration)
+                {
+                    u = (std::min)((std::max)(u, 0.0f), float(m_width));
+                    v = (std::min)((std::max)(v, 0.0f), float(m_height));
+
+                    float x, y, jacobian[4];
+                    if (!Interpolate(u, v, x, y, jacobian))
+                    {
+                        return false;
+                    }
+
+                    const float dx = x - xy[0];
+                    const float dy = y - xy[1];
+                    if (dx * dx + dy * dy < kTolerance * kTolerance)
+                    {
+                        return true;
+                    }
+
+                    const float determinant = jacobian[0] * jacobian[3] - jacobian[1] * jacobian[2];
+                    if (std::fabs(determinant) < 1e-12f)
+                    {
+                        return false;
+                    }
+                    u -= (jacobian[3] * dx - jacobian[1] * dy) / determinant;
+                    v -= (-jacobian[2] * dx + jacobian[0] * dy) / determinant;
+                }
+                return false;
+            }
+
+            void ClosestSample(const float (&xy)[2], float& u, float& v) const
+            {
+                constexpr uint32_t kStep = 4;
+                float closestDistance = INFINITY;
+                for (uint32_t py = 0; py < m_height; py += kStep)
+                {
+                    for (uint32_t px = 0; px < m_width; px += kStep)
+                    {
+                        const size_t i = size_t(py) * m_width + px;
+                        const float dx = m_x[i] - xy[0];
+                        const float dy = m_y[i] - xy[1];
+                        if (m_valid[i] && dx * dx + dy * dy < closestDistance)
+                        {
+                            closestDistance = dx * dx + dy * dy;
+                            u = px + 0.5f;
+                            v = py + 0.5f;
+                        }
+                    }
+                }
+            }
+
+            // Least squares x = (u - cx) / fx, y = (v - cy) / fy over the central half of the image,
+            // only used to start the inverse mapping
+            void FitPinhole()
+            {
+                double sums[2][5] = {};  // n, sum(pixel), sum(pixel^2), sum(unit), sum(pixel * unit)
+                for (uint32_t py = m_height / 4; py < m_height * 3 / 4; ++py)
+                {
+                    for (uint32_t px = m_width / 4; px < m_width * 3 / 4; ++px)
+                    {
+                        const size_t i = size_t(py) * m_width + px;
+                        if (!m_valid[i])
+                        {
+                            continue;
+                        }
+                        const double pixel[2] = { px + 0.5, py + 0.5 };
+                        const double unit[2] = { m_x[i], m_y[i] };
+                        for (int axis = 0; axis < 2; ++axis)
+                        {
+                            sums[axis][0] += 1;
+                            sums[axis][1] += pixel[axis];
+                            sums[axis][2] += pixel[axis] * pixel[axis];
+                            sums[axis][3] += unit[axis];
+                            sums[axis][4] += pixel[axis] * unit[axis];
+                        }
+                    }
+                }
+
+                float focal[2] = { 1.0f, 1.0f };
+                float center[2] = { m_width * 0.5f, m_height * 0.5f };
+                for (int axis = 0; axis < 2; ++axis)
+                {
+                    const double* s = sums[axis];
+                    const double denominator = s[0] * s[2] - s[1] * s[1];
+                    if (s[0] < 2 || std::fabs(denominator) < 1e-12)
+                    {
+                        continue;
+                    }
+                    const double slope = (s[0] * s[4] - s[1] * s[3]) / denominator;    // 1 / f
+                    const double intercept = (s[3] - slope * s[1]) / s[0];              // -c / f
+                    if (std::fabs(slope) > 1e-12)
+                    {
+                        focal[axis] = float(1.0 / slope);
+                        center[axis] = float(-intercept / slope);
+                    }
+                }
+                m_focalX = focal[0];
+                m_focalY = focal[1];
+                m_centerX = center[0];
+                m_centerY = center[1];
+            }
+
+            uint32_t m_width = 0;
+            uint32_t m_height = 0;
+            std::vector<float> m_x;
+            std::vector<float> m_y;
+            std::vector<uint8_t> m_valid;
+            float m_focalX = 1.0f;
+            float m_focalY = 1.0f;
+            float m_centerX = 0.0f;
+            float m_centerY = 0.0f;
+        };
+
+        class ReplaySensor : public IResearchModeSensor, public IResearchModeCameraSensor, public IResearchModeDepthSensor
+        {
+        public:
+            ReplaySensor(const ReplayOptions& options) :
+                m_options(options)
+            {
+            }
+
+            HRESULT Initialize(const std::filesystem::path& tarPath)
+            {
+                m_friendlyName = tarPath.stem().wstring();
+                if (!TryGetSensorType(m_friendlyName, m_sensorType))
+                {
+                    return E_INVALIDARG;
+                }
+
+                m_tarFile.open(tarPath, std::ios::binary);
+                if (!m_tarFile)
+                {
+                    return E_INVALIDARG;
+                }
+                IndexFrames(ReadTarIndex(m_tarFile));
+                if (m_frames.empty())
+                {
+                    return E_FAIL;
+                }
+
+                // The LUT has one entry per pixel, so the resolution has to be known first. Without any calibration
+                // the sensor still replays, the mapping functions return E_NOTIMPL.
+                std::shared_ptr<const RecordedFrame> firstFrame = LoadFrame(0);
+                if (!firstFrame)
+                {
+                    return E_FAIL;
+                }
+
+                const std::filesystem::path folder = tarPath.parent_path();
+                const uint32_t width = firstFrame->resolution.Width;
+                const uint32_t height = firstFrame->resolution.Height;
+                std::vector<float> lut;
+                if (ReadSensorLut(folder, tarPath.stem().string(), m_options.calibrationStore, width, height, lut))
+                {
+                    m_cameraModel.Load(lut, width, height);
+                }
+                m_hasExtrinsics = LoadExtrinsics(folder / (tarPath.stem().string() + "_extrinsics.txt"));
+
+                if (m_options.preload)
+                {
+                    m_preloadedFrames.reserve(m_frames.size());
+                    m_preloadedFrames.push_back(firstFrame);
+                    for (size_t i = 1; i < m_frames.size(); ++i)
+                    {
+                        m_preloadedFrames.push_back(LoadFrame(i));
+                    }
+                }
+
+                const uint64_t recordedTicks = m_frames.back().ticks - m_frames.front().ticks;
+                m_loopDuration = recordedTicks + (m_frames.size() > 1 ? recordedTicks / (m_frames.size() - 1) : kTicksPerSecond / 30);
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+            {
+                if (!ppvObject)
+                {
+                    return E_POINTER;
+                }
+
+                if (riid == __uuidof(IUnknown) || riid == __uuidof(IResearchModeSensor))
+                {
+                    *ppvObject = static_cast<IResearchModeSensor*>(this);
+                }
+                else if (riid == __uuidof(IResearchModeCameraSensor))
+                {
+                    *ppvObject = static_cast<IResearchModeCameraSensor*>(this);
+                }
+                else if (riid == __uuidof(IResearchModeDepthSensor) && IsDepthSensor(m_sensorType))
+                {
+                    *ppvObject = static_cast<IResearchModeDepthSensor*>(this);
+                }
+                else
+                {
+                    *ppvObject = nullptr;
+                    return E_NOINTERFACE;
+                }
+
+                AddRef();
+                return S_OK;
+            }
+
+            ULONG STDMETHODCALLTYPE AddRef() override
+            {
+                return ++m_refCount;
+            }
+
+            ULONG STDMETHODCALLTYPE Release() override
+            {
+                const ULONG refCount = --m_refCount;
+                if (refCount == 0)
+                {
+                    delete this;
+                }
+                return refCount;
+            }
+
+            // IResearchModeSensor
+            HRESULT STDMETHODCALLTYPE OpenStream() override
+            {
+                std::lock_guard<std::mutex> guard(m_streamMutex);
+                m_streamOpen = true;
+                m_nextFrame = 0;
+                m_loopOffset = 0;
+                m_playbackStart = std::chrono::steady_clock::now();
+                m_hostTicksBase = std::chrono::duration_cast<std::chrono::duration<uint64_t, std::ratio<1, kTicksPerSecond>>>(
+                    m_playbackStart.time_since_epoch()).count();
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE CloseStream() override
+            {
+                {
+                    std::lock_guard<std::mutex> guard(m_streamMutex);
+                    m_streamOpen = false;
+                }
+                // Wakes up a GetNextBuffer waiting for its frame time
+                m_streamCondVar.notify_all();
+                return S_OK;
+            }
+
+            LPCWSTR STDMETHODCALLTYPE GetFriendlyName() override
+            {
+                return m_friendlyName.c_str();
+            }
+
+            ResearchModeSensorType STDMETHODCALLTYPE GetSensorType() override
+            {
+                return m_sensorType;
+            }
+
+            HRESULT STDMETHODCALLTYPE GetSampleBufferSize(size_t* pSampleBufferSize) override
+            {
+                *pSampleBufferSize = 1;
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE GetNextBuffer(IResearchModeSensorFrame** ppSensorFrame) override
+            {
+                if (!ppSensorFrame)
+                {
+                    return E_POINTER;
+                }
+                *ppSensorFrame = nullptr;
+
+                std::unique_lock<std::mutex> lock(m_streamMutex);
+                if (!m_streamOpen)
+                {
+                    return E_UNEXPECTED;
+                }
+
+                if (m_nextFrame == m_frames.size())
+                {
+                    if (!m_options.loop)
+                    {
+                        return kEndOfStream;
+                    }
+                    m_nextFrame = 0;
+                    m_loopOffset += m_loopDuration;
+                }
+
+                const size_t frameIndex = m_nextFrame++;
+                const uint64_t playbackTicks = m_frames[frameIndex].ticks - m_frames.front().ticks + m_loopOffset;
+
+                if (m_options.mode == PlaybackMode::RealTime)
+                {
+                    const auto dueTime = m_playbackStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(playbackTicks / (double(kTicksPerSecond) * m_options.speed)));
+                    if (m_streamCondVar.wait_until(lock, dueTime, [this] { return !m_streamOpen; }))
+                    {
+                        return E_ABORT;
+                    }
+                }
+
+                std::shared_ptr<const RecordedFrame> frame = m_options.preload ? m_preloadedFrames[frameIndex] : LoadFrame(frameIndex);
+                if (!frame)
+                {
+                    return E_FAIL;
+                }
+
+                ResearchModeSensorTimestamp timestamp = {};
+                timestamp.Source = SensorTimestampSource_CenterOfExposure;
+                timestamp.SensorTicks = m_hostTicksBase + playbackTicks;
+                timestamp.SensorTicksPerSecond = kTicksPerSecond;
+                timestamp.HostTicks = m_hostTicksBase + playbackTicks;
+                timestamp.HostTicksPerSecond = kTicksPerSecond;
+
+                *ppSensorFrame = new ReplayFrame(std::move(frame), timestamp, m_sensorType);
+                return S_OK;
+            }
+
+            // IResearchModeCameraSensor
+            HRESULT STDMETHODCALLTYPE MapImagePointToCameraUnitPlane(float (&uv)[2], float (&xy)[2]) override
+            {
+                return m_cameraModel.IsLoaded() ? m_cameraModel.ImageToUnitPlane(uv, xy) : E_NOTIMPL;
+            }
+
+            HRESULT STDMETHODCALLTYPE MapCameraSpaceToImagePoint(float (&xy)[2], float (&uv)[2]) override
+            {
+                return m_cameraModel.IsLoaded() ? m_cameraModel.UnitPlaneToImage(xy, uv) : E_NOTIMPL;
+            }
+
+            HRESULT STDMETHODCALLTYPE GetCameraExtrinsicsMatrix(DirectX::XMFLOAT4X4* pCameraViewMatrix) override
+            {
+                if (!m_hasExtrinsics)
+                {
+                    return E_NOTIMPL;
+                }
+                *pCameraViewMatrix = m_extrinsics;
+                return S_OK;
+            }
+
+        private:
+            struct FrameFiles
+            {
+                uint64_t ticks;     // Absolute ticks from the file name
+                const TarEntry* pImage;
+                const TarEntry* pAb;
+            };
+
+            virtual ~ReplaySensor() = default;
+
+            // Frames are <ticks>.pgm, depth frames also have <ticks>_ab.pgm
+            void IndexFrames(std::vector<TarEntry> entries)
+            {
+                m_entries = std::move(entries);
+
+                std::map<uint64_t, FrameFiles> frames;
+                for (const TarEntry& entry : m_entries)
+                {
+                    char* pEnd = nullptr;
+                    const uint64_t ticks = std::strtoull(entry.name.c_str(), &pEnd, 10);
+                    if (pEnd == entry.name.c_str())
+                    {
+                        continue;
+                    }
+
+                    FrameFiles& files = frames.emplace(ticks, FrameFiles{ ticks, nullptr, nullptr }).first->second;
+                    if (strcmp(pEnd, ".pgm") == 0)
+                    {
+                        files.pImage = &entry;
+                    }
+                    else if (strcmp(pEnd, "_ab.pgm") == 0)
+                    {
+                        files.pAb = &entry;
+                    }
+                }
+
+                for (const auto& [ticks, files] : frames)
+                {
+                    if (files.pImage && (files.pAb || !IsDepthSensor(m_sensorType)))
+                    {
+                        m_frames.push_back(files);
+                    }
+                }
+            }
+
+            bool ReadEntry(const TarEntry& entry, std::vector<BYTE>& data)
+            {
+                data.resize(size_t(entry.size));
+                m_tarFile.seekg(entry.dataOffset);
+                if (!m_tarFile.read(reinterpret_cast<char*>(data.data()), data.size()))
+                {
+                    m_tarFile.clear();
+                    return false;
+                }
+                return true;
+            }
+
+            // Big endian 16 bit PGM pixels, as RMCameraReader writes them
+            static bool Decode16BitPgm(const std::vector<BYTE>& data, std::vector<UINT16>& pixels, ResearchModeSensorResolution& resolution)
+            {
+                uint32_t width, height, maxValue;
+                const size_t pixelOffset = ParsePgmHeader(data, width, height, maxValue);
+                const size_t pixelCount = size_t(width) * height;
+                if (pixelOffset == 0 || maxValue < 256 || data.size() < pixelOffset + pixelCount * 2)
+                {
+                    return false;
+                }
+
+                pixels.resize(pixelCount);
+                const BYTE* pPixels = data.data() + pixelOffset;
+                for (size_t i = 0; i < pixelCount; ++i)
+                {
+                    pixels[i] = UINT16((pPixels[2 * i] << 8) | pPixels[2 * i + 1]);
+                }
+                resolution = { width, height, width * 2, 16, 2 };
+                return true;
+            }
+
+            std::shared_ptr<const RecordedFrame> LoadFrame(size_t frameIndex)
+            {
+                const FrameFiles& files = m_frames[frameIndex];
+                auto frame = std::make_shared<RecordedFrame>();
+
+                if (!ReadEntry(*files.pImage, m_readBuffer))
+                {
+                    return nullptr;
+                }
+
+                if (!IsDepthSensor(m_sensorType))
+                {
+                    uint32_t width, height, maxValue;
+                    const size_t pixelOffset = ParsePgmHeader(m_readBuffer, width, height, maxValue);
+                    const size_t pixelCount = size_t(width) * height;
+                    if (pixelOffset == 0 || maxValue > 255 || m_readBuffer.size() < pixelOffset + pixelCount)
+                    {
+                        return nullptr;
+                    }
+                    frame->image.assign(m_readBuffer.begin() + pixelOffset, m_readBuffer.begin() + pixelOffset + pixelCount);
+                    frame->resolution = { width, height, width, 8, 1 };
+                    return frame;
+                }
+
+                if (!Decode16BitPgm(m_readBuffer, frame->depth, frame->resolution))
+                {
+                    return nullptr;
+                }
+
+                ResearchModeSensorResolution abResolution;
+                if (!ReadEntry(*files.pAb, m_readBuffer) || !Decode16BitPgm(m_readBuffer, frame->ab, abResolution) ||
+                    frame->ab.size() != frame->depth.size())
+                {
+                    return nullptr;
+                }
+
+                // The recorder saves invalid pixels as 0, give them back the device's invalid markers
+                if (m_sensorType == DEPTH_LONG_THROW)
+                {
+                    frame->sigma.resize(frame->depth.size());
+                    for (size_t i = 0; i < frame->depth.size(); ++i)
+                    {
+                        frame->sigma[i] = frame->depth[i] == 0 ? kSigmaInvalidMask : 0;
+                    }
+                }
+                else
+                {
+                    for (UINT16& depth : frame->depth)
+                    {
+                        if (depth == 0)
+                        {
+                            depth = kAhatInvalidValue;
+                        }
+                    }
+                }
+                return frame;
+            }
+
+            // Transposed, as RMCameraReader::DumpCalibration writes it
+            bool LoadExtrinsics(const std::filesystem::path& extrinsicsPath)
+            {
+                std::ifstream file(extrinsicsPath);
+                std::string line;
+                if (!std::getline(file, line))
+                {
+                    return false;
+                }
+
+                std::stringstream values(line);
+                std::string value;
+                for (int i = 0; i < 16; ++i)
+                {
+                    if (!std::getline(values, value, ','))
+                    {
+                        return false;
+                    }
+                    m_extrinsics.m[i % 4][i / 4] = std::strtof(value.c_str(), nullptr);
+                }
+                return true;
+            }
+
+            std::atomic<ULONG> m_refCount{ 1 };
+            const ReplayOptions m_options;
+
+            std::wstring m_friendlyName;
+            ResearchModeSensorType m_sensorType = LEFT_FRONT;
+
+            std::ifstream m_tarFile;
+            std::vector<TarEntry> m_entries;
+            std::vector<FrameFiles> m_frames;
+            std::vector<std::shared_ptr<const RecordedFrame>> m_preloadedFrames;
+            std::vector<BYTE> m_readBuffer;
+
+            LutCameraModel m_cameraModel;
+            DirectX::XMFLOAT4X4 m_extrinsics = {};
+            bool m_hasExtrinsics = false;
+
+            std::mutex m_streamMutex;   // Guards the playback state, the tar file and m_readBuffer
+            std::condition_variable m_streamCondVar;
+            bool m_streamOpen = false;
+            size_t m_nextFrame = 0;
+            uint64_t m_loopOffset = 0;
+            uint64_t m_loopDuration = 0;
+            std::chrono::steady_clock::time_point m_playbackStart;
+            uint64_t m_hostTicksBase = 0;
+        };
+    }
+
+    HRESULT CreateReplaySensor(const std::filesystem::path& tarPath, const ReplayOptions& options, IResearchModeSensor** ppSensor)
+    {
+        if (!ppSensor)
+        {
+            return E_POINTER;
+        }
+        *ppSensor = nullptr;
+
+        ReplaySensor* pSensor = new ReplaySensor(options);
+        const HRESULT hr = pSensor->Initialize(tarPath);
+        if (FAILED(hr))
+        {
+            pSensor->Release();
+            return hr;
+        }
+
+        *ppSensor = pSensor;
+        return S_OK;
+    }
+}
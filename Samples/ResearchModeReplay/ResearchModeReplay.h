@@ -0,0 +1,98 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "ResearchModeApi.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Research Mode camera sensors backed by StreamRecorder captures instead of the device.
+//
+// A replay sensor reads <name>.tar (the frames), the calibration and <name>_extrinsics.txt from a capture folder and
+// implements IResearchModeSensor, IResearchModeCameraSensor and, for depth, IResearchModeDepthSensor. Its frames
+// implement IResearchModeSensorFrame plus IResearchModeSensorVLCFrame or IResearchModeSensorDepthFrame, so code
+// written against GetNextBuffer (RMCameraReader, the CV processors) runs unchanged, on or off the device.
+//
+// What the recorder doesn't keep is reconstructed: invalid depth pixels get back their AHaT invalid value or
+// Long Throw sigma flag, VLC gain and exposure read as 0 and timestamps are shifted to the playback clock.
+//
+// The calibration is the capture's <name>_lut.bin if it has one (older recorders), else the LUT its
+// <name>_calibration.txt references in the calibration store, else the LUT rebuilt from <name>_camera_model.bin.
+
+namespace ResearchModeReplay
+{
+    enum class PlaybackMode
+    {
+        RealTime,           // Frames are handed out at their recorded spacing, divided by speed
+        AsFastAsPossible    // GetNextBuffer never waits
+    };
+
+    struct ReplayOptions
+    {
+        PlaybackMode mode = PlaybackMode::RealTime;
+        double speed = 1.0;
+        bool loop = false;      // Start over at the end instead of returning kEndOfStream
+        bool preload = false;   // Decode every frame in CreateReplaySensor, keeps disk reads out of load tests
+        // Where recorder_console.py downloaded the calibration caches; empty for HOLOLENS2_CALIBRATION_STORE or
+        // ~/.hololens2_calibration, as in utils.py
+        std::filesystem::path calibrationStore;
+    };
+
+    // GetNextBuffer result once a non looping replay has handed out every frame
+    // (HRESULT_FROM_WIN32(ERROR_HANDLE_EOF)).
+    constexpr HRESULT kEndOfStream = static_cast<HRESULT>(0x80070026L);
+
+    // tarPath is <capture folder>/<sensor friendly name>.tar, the friendly name also gives the sensor type.
+    // The sensor is returned with one reference.
+    HRESULT CreateReplaySensor(const std::filesystem::path& tarPath, const ReplayOptions& options, IResearchModeSensor** ppSensor);
+
+    // Synthetic sensors generate frames instead of reading a capture, for load tests at rates and resolutions no
+    // recording has. They implement the same interfaces as a replay sensor except IResearchModeCameraSensor.
+
+    enum class SyntheticPixelFormat
+    {
+        Gray8,      // VLC cameras
+        Bgra8,      // Stands in for the PV camera, handed out through IResearchModeSensorVLCFrame::GetBuffer
+        Depth16     // Depth, active brightness and, for Long Throw, sigma
+    };
+
+    enum class SyntheticDepthPattern
+    {
+        Plane,      // Fronto parallel wall
+        Ramp,       // Depth growing left to right
+        Sphere,     // Ball in front of a wall
+        Noise       // Uniform random depth, the worst case for any compression
+    };
+
+    struct SyntheticSensorOptions
+    {
+        std::wstring friendlyName = L"Synthetic";
+        ResearchModeSensorType sensorType = LEFT_FRONT; // Depth types need Depth16, the others Gray8 or Bgra8
+        SyntheticPixelFormat pixelFormat = SyntheticPixelFormat::Gray8;
+        uint32_t width = 640;
+        uint32_t height = 480;
+        double fps = 30.0;
+
+        SyntheticDepthPattern depthPattern = SyntheticDepthPattern::Sphere;
+        float invalidFraction = 0.05f;  // Share of depth pixels flagged invalid
+
+        double jitterMs = 0.0;          // Uniform delivery jitter around the nominal frame time
+        uint32_t burstLength = 1;       // Frames held back and delivered together, as after a stalled driver
+        uint64_t frameLimit = 0;        // GetNextBuffer returns kEndOfStream after that many frames, 0 never ends
+        PlaybackMode mode = PlaybackMode::RealTime;
+        uint32_t seed = 1;
+    };
+
+    HRESULT CreateSyntheticSensor(const SyntheticSensorOptions& options, IResearchModeSensor** ppSensor);
+}
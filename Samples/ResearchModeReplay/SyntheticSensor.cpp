@@ -0,0 +1,337 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ResearchModeReplay.h"
+#include "ReplayFrame.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+
+namespace ResearchModeReplay
+{
+    using namespace Detail;
+
+    namespace
+    {
+        // Generated once and handed out in turn, so GetNextBuffer costs the same as a preloaded replay
+        constexpr size_t kFrameVariations = 8;
+
+        bool IsValidFormat(ResearchModeSensorType sensorType, SyntheticPixelFormat pixelFormat)
+        {
+            if (IsDepthSensor(sensorType))
+            {
+                return pixelFormat == SyntheticPixelFormat::Depth16;
+            }
+            return sensorType <= RIGHT_RIGHT && pixelFormat != SyntheticPixelFormat::Depth16;
+        }
+
+        // Millimeters, roughly the working range of each depth mode
+        float GetPatternDepth(SyntheticDepthPattern pattern, float x, float y, float phase, float nearDepth, float farDepth, std::mt19937& random)
+        {
+            const float range = farDepth - nearDepth;
+            switch (pattern)
+            {
+            case SyntheticDepthPattern::Plane:
+                return nearDepth + range * (0.5f + 0.25f * std::sin(phase));
+            case SyntheticDepthPattern::Ramp:
+                return nearDepth + range * std::fmod(x + phase / 6.2831853f, 1.0f);
+            case SyntheticDepthPattern::Sphere:
+            {
+                // Ball of radius 0.25 (in image widths) drifting horizontally in front of a far wall
+                const float centerX = 0.5f + 0.25f * std::sin(phase);
+                const float dx = x - centerX;
+                const float dy = y - 0.5f;
+                const float r2 = dx * dx + dy * dy;
+                if (r2 >= 0.0625f)
+                {
+                    return farDepth;
+                }
+                return nearDepth + range * (0.25f - std::sqrt(0.0625f - r2));
+            }
+            case SyntheticDepthPattern::Noise:
+                return nearDepth + range * std::uniform_real_distribution<float>(0.0f, 1.0f)(random);
+            }
+            return farDepth;
+        }
+
+        std::shared_ptr<const RecordedFrame> GenerateFrame(const SyntheticSensorOptions& options, size_t variation, std::mt19937& random)
+        {
+            auto frame = std::make_shared<RecordedFrame>();
+            const uint32_t width = options.width;
+            const uint32_t height = options.height;
+            const size_t pixelCount = size_t(width) * height;
+            const float phase = 6.2831853f * variation / kFrameVariations;
+
+            switch (options.pixelFormat)
+            {
+            case SyntheticPixelFormat::Gray8:
+            {
+                // Moving gradient with a checkerboard, so the image isn't trivially compressible either
+                frame->resolution = { width, height, width, 8, 1 };
+                frame->image.resize(pixelCount);
+                const uint32_t shift = uint32_t(variation * width / kFrameVariations);
+                for (uint32_t v = 0; v < height; ++v)
+                {
+                    for (uint32_t u = 0; u < width; ++u)
+                    {
+                        const uint32_t checker = ((u / 16) ^ (v / 16)) & 1;
+                        frame->image[size_t(v) * width + u] = BYTE(((u + shift) * 255 / width) ^ (checker * 0x3f));
+                    }
+                }
+                break;
+            }
+            case SyntheticPixelFormat::Bgra8:
+            {
+                frame->resolution = { width, height, width * 4, 32, 4 };
+                frame->image.resize(pixelCount * 4);
+                const uint32_t shift = uint32_t(variation * width / kFrameVariations);
+                for (uint32_t v = 0; v < height; ++v)
+                {
+                    BYTE* pRow = frame->image.data() + size_t(v) * width * 4;
+                    for (uint32_t u = 0; u < width; ++u)
+                    {
+                        pRow[4 * u] = BYTE((u + shift) * 255 / width);
+                        pRow[4 * u + 1] = BYTE(v * 255 / height);
+                        pRow[4 * u + 2] = BYTE(((u / 16) ^ (v / 16)) & 1 ? 200 : 50);
+                        pRow[4 * u + 3] = 255;
+                    }
+                }
+                break;
+            }
+            case SyntheticPixelFormat::Depth16:
+            {
+                const bool isLongThrow = options.sensorType == DEPTH_LONG_THROW;
+                const float nearDepth = isLongThrow ? 500.0f : 200.0f;
+                const float farDepth = isLongThrow ? 4000.0f : 1000.0f;
+                std::bernoulli_distribution isInvalid(std::clamp(options.invalidFraction, 0.0f, 1.0f));
+
+                frame->resolution = { width, height, width * 2, 16, 2 };
+                frame->depth.resize(pixelCount);
+                frame->ab.resize(pixelCount);
+                if (isLongThrow)
+                {
+                    frame->sigma.resize(pixelCount);
+                }
+
+                for (uint32_t v = 0; v < height; ++v)
+                {
+                    for (uint32_t u = 0; u < width; ++u)
+                    {
+                        const size_t i = size_t(v) * width + u;
+                        const float depth = GetPatternDepth(options.depthPattern, (u + 0.5f) / width, (v + 0.5f) / height, phase, nearDepth, farDepth, random);
+                        frame->depth[i] = UINT16(depth);
+                        // Active brightness falls off with the square of the distance
+                        frame->ab[i] = UINT16((std::min)(65535.0f, 4.0e8f / (depth * depth)));
+
+                        if (isInvalid(random))
+                        {
+                            if (isLongThrow)
+                            {
+                                frame->sigma[i] = kSigmaInvalidMask;
+                            }
+                            else
+                            {
+                                frame->depth[i] = kAhatInvalidValue;
+                            }
+                        }
+                    }
+                }
+                break;
+            }
+            }
+            return frame;
+        }
+
+        class SyntheticSensor : public IResearchModeSensor, public IResearchModeDepthSensor
+        {
+        public:
+            SyntheticSensor(const SyntheticSensorOptions& options) :
+                m_options(options),
+                m_random(options.seed)
+            {
+                m_options.burstLength = (std::max)(m_options.burstLength, 1u);
+                for (size_t i = 0; i < kFrameVariations; ++i)
+                {
+                    m_frames.push_back(GenerateFrame(m_options, i, m_random));
+                }
+            }
+
+            HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+            {
+                if (!ppvObject)
+                {
+                    return E_POINTER;
+                }
+
+                if (riid == __uuidof(IUnknown) || riid == __uuidof(IResearchModeSensor))
+                {
+                    *ppvObject = static_cast<IResearchModeSensor*>(this);
+                }
+                else if (riid == __uuidof(IResearchModeDepthSensor) && IsDepthSensor(m_options.sensorType))
+                {
+                    *ppvObject = static_cast<IResearchModeDepthSensor*>(this);
+                }
+                else
+                {
+                    *ppvObject = nullptr;
+                    return E_NOINTERFACE;
+                }
+
+                AddRef();
+                return S_OK;
+            }
+
+            ULONG STDMETHODCALLTYPE AddRef() override
+            {
+                return ++m_refCount;
+            }
+
+            ULONG STDMETHODCALLTYPE Release() override
+            {
+                const ULONG refCount = --m_refCount;
+                if (refCount == 0)
+                {
+                    delete this;
+                }
+                return refCount;
+            }
+
+            // IResearchModeSensor
+            HRESULT STDMETHODCALLTYPE OpenStream() override
+            {
+                std::lock_guard<std::mutex> guard(m_streamMutex);
+                m_streamOpen = true;
+                m_nextFrame = 0;
+                m_lastDeliveryTime = 0.0;
+                m_streamStart = std::chrono::steady_clock::now();
+                m_hostTicksBase = std::chrono::duration_cast<std::chrono::duration<uint64_t, std::ratio<1, kTicksPerSecond>>>(
+                    m_streamStart.time_since_epoch()).count();
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE CloseStream() override
+            {
+                {
+                    std::lock_guard<std::mutex> guard(m_streamMutex);
+                    m_streamOpen = false;
+                }
+                m_streamCondVar.notify_all();
+                return S_OK;
+            }
+
+            LPCWSTR STDMETHODCALLTYPE GetFriendlyName() override
+            {
+                return m_options.friendlyName.c_str();
+            }
+
+            ResearchModeSensorType STDMETHODCALLTYPE GetSensorType() override
+            {
+                return m_options.sensorType;
+            }
+
+            HRESULT STDMETHODCALLTYPE GetSampleBufferSize(size_t* pSampleBufferSize) override
+            {
+                *pSampleBufferSize = 1;
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE GetNextBuffer(IResearchModeSensorFrame** ppSensorFrame) override
+            {
+                if (!ppSensorFrame)
+                {
+                    return E_POINTER;
+                }
+                *ppSensorFrame = nullptr;
+
+                std::unique_lock<std::mutex> lock(m_streamMutex);
+                if (!m_streamOpen)
+                {
+                    return E_UNEXPECTED;
+                }
+                if (m_options.frameLimit != 0 && m_nextFrame >= m_options.frameLimit)
+                {
+                    return kEndOfStream;
+                }
+
+                const uint64_t frameIndex = m_nextFrame++;
+                const double frameTime = frameIndex / m_options.fps;
+
+                if (m_options.mode == PlaybackMode::RealTime)
+                {
+                    // A burst is held until its last frame exists, jitter moves every delivery but never reorders them
+                    const uint64_t burstEnd = (frameIndex / m_options.burstLength + 1) * m_options.burstLength - 1;
+                    double deliveryTime = burstEnd / m_options.fps;
+                    if (m_options.jitterMs > 0.0)
+                    {
+                        deliveryTime += std::uniform_real_distribution<double>(-m_options.jitterMs, m_options.jitterMs)(m_random) / 1000.0;
+                    }
+                    m_lastDeliveryTime = (std::max)(m_lastDeliveryTime, deliveryTime);
+
+                    const auto dueTime = m_streamStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(m_lastDeliveryTime));
+                    if (m_streamCondVar.wait_until(lock, dueTime, [this] { return !m_streamOpen; }))
+                    {
+                        return E_ABORT;
+                    }
+                }
+
+                // The timestamp is always the nominal frame time, like a device sensor's center of exposure
+                const uint64_t frameTicks = m_hostTicksBase + uint64_t(frameTime * kTicksPerSecond);
+                ResearchModeSensorTimestamp timestamp = {};
+                timestamp.Source = SensorTimestampSource_CenterOfExposure;
+                timestamp.SensorTicks = frameTicks;
+                timestamp.SensorTicksPerSecond = kTicksPerSecond;
+                timestamp.HostTicks = frameTicks;
+                timestamp.HostTicksPerSecond = kTicksPerSecond;
+
+                *ppSensorFrame = new ReplayFrame(m_frames[frameIndex % m_frames.size()], timestamp, m_options.sensorType);
+                return S_OK;
+            }
+
+        private:
+            virtual ~SyntheticSensor() = default;
+
+            std::atomic<ULONG> m_refCount{ 1 };
+            SyntheticSensorOptions m_options;
+            std::vector<std::shared_ptr<const RecordedFrame>> m_frames;
+
+            std::mutex m_streamMutex;   // Guards the stream state and m_random
+            std::condition_variable m_streamCondVar;
+            bool m_streamOpen = false;
+            uint64_t m_nextFrame = 0;
+            double m_lastDeliveryTime = 0.0;   // Seconds since OpenStream
+            std::chrono::steady_clock::time_point m_streamStart;
+            uint64_t m_hostTicksBase = 0;
+            std::mt19937 m_random;
+        };
+    }
+
+    HRESULT CreateSyntheticSensor(const SyntheticSensorOptions& options, IResearchModeSensor** ppSensor)
+    {
+        if (!ppSensor)
+        {
+            return E_POINTER;
+        }
+        *ppSensor = nullptr;
+
+        if (!IsValidFormat(options.sensorType, options.pixelFormat) || options.width == 0 || options.height == 0 || !(options.fps > 0.0))
+        {
+            return E_INVALIDARG;
+        }
+
+        *ppSensor = new SyntheticSensor(options);
+        return S_OK;
+    }
+}
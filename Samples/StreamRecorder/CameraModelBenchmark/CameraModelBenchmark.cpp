@@ -0,0 +1,250 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Fits FisheyeCameraModel to unprojection LUTs, either recorded (_lut.bin) or from synthetic lenses shaped like the
+// HoloLens 2 cameras, and reports its accuracy, its size against the LUT's, the fit time and the throughput of the
+// batch projection and unprojection. Exits with 1 when a model is off by more than --max-error pixels or doesn't
+// survive serialization unchanged.
+
+#include "FisheyeCameraModel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // A fisheye lens the Kannala-Brandt polynomial can't quite follow: the same radial terms plus a tangential
+    // (decentering) component. Pixels further than maxRadius from the principal point can't be mapped, like the
+    // dark corners of the depth cameras.
+    struct SyntheticLens
+    {
+        const char* name;
+        uint32_t width;
+        uint32_t height;
+        double f;
+        double cx;
+        double cy;
+        double k[4];
+        double p1;
+        double p2;
+        double maxRadius;
+    };
+
+    const SyntheticLens kLenses[] = {
+        { "long_throw_320x288", 320, 288, 150.0, 161.3, 143.1, { -0.015, 0.004, -0.0006, 0.0 }, 4e-4, -3e-4, 1e9 },
+        { "ahat_512x512", 512, 512, 215.0, 257.8, 253.4, { -0.012, 0.003, -0.0004, 0.0 }, -2e-4, 5e-4, 300.0 },
+        { "vlc_640x480", 640, 480, 280.0, 322.4, 238.6, { 0.02, -0.01, 0.002, -0.0002 }, 3e-4, 2e-4, 1e9 },
+    };
+
+    double DistortRadius(const SyntheticLens& lens, double theta)
+    {
+        const double t2 = theta * theta;
+        return theta * (1.0 + t2 * (lens.k[0] + t2 * (lens.k[1] + t2 * (lens.k[2] + t2 * lens.k[3]))));
+    }
+
+    // What MapImagePointToCameraUnitPlane followed by the normalization of DumpCalibration would give, in double
+    bool UnprojectSynthetic(const SyntheticLens& lens, double u, double v, float* pRay)
+    {
+        const double du = u - lens.cx;
+        const double dv = v - lens.cy;
+        if (du * du + dv * dv > lens.maxRadius * lens.maxRadius)
+        {
+            return false;
+        }
+
+        // Tangential distortion removed by fixed point iteration
+        const double mx = du / lens.f;
+        const double my = dv / lens.f;
+        double x = mx;
+        double y = my;
+        for (int i = 0; i < 50; i++)
+        {
+            const double r2 = x * x + y * y;
+            x = mx - (2.0 * lens.p1 * x * y + lens.p2 * (r2 + 2.0 * x * x));
+            y = my - (lens.p1 * (r2 + 2.0 * y * y) + 2.0 * lens.p2 * x * y);
+        }
+
+        const double rd = std::sqrt(x * x + y * y);
+        double theta = rd;
+        for (int i = 0; i < 50; i++)
+        {
+            const double t2 = theta * theta;
+            const double slope = 1.0 + t2 * (3.0 * lens.k[0] + t2 * (5.0 * lens.k[1] + t2 * (7.0 * lens.k[2] + t2 * 9.0 * lens.k[3])));
+            theta -= (DistortRadius(lens, theta) - rd) / slope;
+        }
+        if (!(theta >= 0.0 && theta < 1.5))
+        {
+            return false;
+        }
+
+        const double scale = rd > 0.0 ? std::sin(theta) / rd : 1.0;
+        pRay[0] = float(x * scale);
+        pRay[1] = float(y * scale);
+        pRay[2] = float(std::cos(theta));
+        return true;
+    }
+
+    std::vector<float> CreateSyntheticLut(const SyntheticLens& lens)
+    {
+        std::vector<float> lut(3 * size_t(lens.width) * lens.height);
+        for (uint32_t y = 0; y < lens.height; y++)
+        {
+            for (uint32_t x = 0; x < lens.width; x++)
+            {
+                float* pRay = &lut[3 * (size_t(y) * lens.width + x)];
+                if (!UnprojectSynthetic(lens, x + 0.5, y + 0.5, pRay))
+                {
+                    pRay[0] = 0.0f;
+                    pRay[1] = 0.0f;
+                    pRay[2] = 0.0f;
+                }
+            }
+        }
+        return lut;
+    }
+
+    // Mega points per second of body, run on count points until minSeconds have passed
+    template <typename Body>
+    double MeasureThroughput(size_t count, double minSeconds, Body body)
+    {
+        body();
+        size_t runs = 0;
+        const auto start = std::chrono::steady_clock::now();
+        auto now = start;
+        while (now - start < std::chrono::duration<double>(minSeconds))
+        {
+            body();
+            runs++;
+            now = std::chrono::steady_clock::now();
+        }
+        return runs * count / std::chrono::duration<double>(now - start).count() / 1e6;
+    }
+
+    bool CheckModel(const std::string& name, const std::vector<float>& lut, uint32_t width, uint32_t height, double maxError, double minSeconds)
+    {
+        const auto fitStart = std::chrono::steady_clock::now();
+        FisheyeFitReport report;
+        const FisheyeCameraModel model = FisheyeCameraModel::Fit(lut.data(), width, height, &report);
+        const double fitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - fitStart).count();
+
+        // The serialized model must give the same rays, to the bit
+        const std::vector<uint8_t> data = model.Serialize();
+        FisheyeCameraModel loaded;
+        const std::vector<float> fittedLut = model.CreateLut();
+        const bool roundTrip = loaded.Deserialize(data.data(), data.size()) &&
+            std::memcmp(fittedLut.data(), loaded.CreateLut().data(), fittedLut.size() * sizeof(float)) == 0;
+
+        const size_t pixelCount = size_t(width) * height;
+        std::vector<float> centers(2 * pixelCount);
+        for (size_t i = 0; i < pixelCount; i++)
+        {
+            centers[2 * i] = (i % width) + 0.5f;
+            centers[2 * i + 1] = (i / width) + 0.5f;
+        }
+        std::vector<float> points(2 * pixelCount);
+        std::vector<float> rays(3 * pixelCount);
+        const double projectRate = MeasureThroughput(pixelCount, minSeconds, [&]() { model.Project(lut.data(), pixelCount, points.data()); });
+        const double unprojectRate = MeasureThroughput(pixelCount, minSeconds, [&]() { model.Unproject(centers.data(), pixelCount, rays.data()); });
+
+        const bool passed = roundTrip && report.unmappedCount == 0 && report.maxPixelError <= maxError;
+        printf("%-20s %8zu %8zu %9.4f %9.4f %10.5f %6zu B %8zu B %8.1f ms %9.1f %9.1f  %s\n",
+            name.c_str(), report.sampleCount, report.unmappedCount, report.maxPixelError, report.rmsPixelError, report.maxRayErrorDegrees,
+            data.size(), lut.size() * sizeof(float), fitMs, projectRate, unprojectRate,
+            passed ? "ok" : (roundTrip ? "FAILED" : "FAILED (serialization)"));
+        return passed;
+    }
+
+    bool ReadLut(const std::string& path, uint32_t width, uint32_t height, std::vector<float>& lut)
+    {
+        std::ifstream file(path, std::ios::binary);
+        lut.resize(3 * size_t(width) * height);
+        return bool(file.read(reinterpret_cast<char*>(lut.data()), lut.size() * sizeof(float)));
+    }
+
+    void PrintUsage()
+    {
+        printf(
+            "usage: CameraModelBenchmark [--lut path --width w --height h] [--max-error pixels] [--min-time seconds]\n"
+            "  --lut fits a recorded LUT instead of the synthetic lenses: a <sensor>_lut_<hash>.bin of the calibration\n"
+            "        store, or the <sensor>_lut.bin of a capture from an older recorder.\n"
+            "  --max-error is the largest projection error accepted, 0.05 pixels by default.\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string lutPath;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    double maxError = 0.05;
+    double minSeconds = 0.5;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--lut" && hasValue)
+        {
+            lutPath = argv[++i];
+        }
+        else if (arg == "--width" && hasValue)
+        {
+            width = uint32_t(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--height" && hasValue)
+        {
+            height = uint32_t(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--max-error" && hasValue)
+        {
+            maxError = atof(argv[++i]);
+        }
+        else if (arg == "--min-time" && hasValue)
+        {
+            minSeconds = atof(argv[++i]);
+        }
+        else
+        {
+            PrintUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    printf("%-20s %8s %8s %9s %9s %10s %8s %10s %11s %9s %9s\n",
+        "lut", "mapped", "refused", "max px", "rms px", "max deg", "model", "lut", "fit", "proj Mp/s", "unpr Mp/s");
+
+    bool passed = true;
+    if (!lutPath.empty())
+    {
+        std::vector<float> lut;
+        if (width == 0 || height == 0 || !ReadLut(lutPath, width, height, lut))
+        {
+            fprintf(stderr, "Can't read a %ux%u LUT from %s\n", width, height, lutPath.c_str());
+            return 1;
+        }
+        passed = CheckModel(lutPath, lut, width, height, maxError, minSeconds);
+    }
+    else
+    {
+        for (const SyntheticLens& lens : kLenses)
+        {
+            passed = CheckModel(lens.name, CreateSyntheticLut(lens), lens.width, lens.height, maxError, minSeconds) && passed;
+        }
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,276 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Checks ClockDomain, the relative to absolute time mapping the recorder's streams share, against simulated clocks:
+// an absolute clock drifting from QPC by a few tens of ppm, with sampling jitter and a jump of the system time.
+// Each session compares the fitted mapping with a single offset measured at the start, as TimeConverter used before.
+// Also checks the integer conversion against double arithmetic, and that readers racing the writer never see a torn
+// snapshot. Exits with 1 when a check fails.
+
+#include "ClockDomain.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Session
+    {
+        const char* name;
+        uint64_t qpcFrequency;
+        double hours;
+        double driftPpm;            // At the start of the session
+        double driftChangePpm;      // Added linearly over the session, as the device warms up
+        double jitterUs;            // Uniform error of each clock sample
+        double stepSeconds;         // System time jump halfway through, 0 for none
+    };
+
+    const Session kSessions[] = {
+        { "10MHz_30ppm", 10'000'000, 2.0, 30.0, 0.0, 2.0, 0.0 },
+        { "10MHz_warmup", 10'000'000, 2.0, 30.0, -20.0, 2.0, 0.0 },
+        { "19.2MHz_-45ppm", 19'200'000, 2.0, -45.0, 5.0, 5.0, 0.0 },
+        { "10MHz_time_step", 10'000'000, 2.0, 20.0, 0.0, 2.0, 5.0 },
+    };
+
+    const int64_t kTicksPerSecond = 10'000'000;
+    const int64_t kStartFileTime = 132'000'000'000'000'000;     // Some day in 2019
+
+    // The simulated absolute clock: FILETIME ticks at a relative time, without the sampling jitter
+    struct AbsoluteClock
+    {
+        const Session& session;
+
+        double DriftTicks(double seconds) const
+        {
+            // Integral of the drift rate, which changes linearly over the session
+            const double sessionSeconds = session.hours * 3600.0;
+            return kTicksPerSecond * 1e-6 * (session.driftPpm * seconds + 0.5 * session.driftChangePpm * seconds * seconds / sessionSeconds);
+        }
+
+        int64_t At(int64_t relativeTicks) const
+        {
+            const double seconds = double(relativeTicks) / kTicksPerSecond;
+            const double step = session.stepSeconds != 0.0 && seconds >= session.hours * 1800.0 ? session.stepSeconds * kTicksPerSecond : 0.0;
+            return kStartFileTime + relativeTicks + int64_t(std::llround(DriftTicks(seconds) + step));
+        }
+    };
+
+    int64_t TicksToQpc(int64_t ticks, uint64_t qpcFrequency)
+    {
+        return int64_t((long double)ticks * qpcFrequency / kTicksPerSecond);
+    }
+
+    // Largest conversion error in microseconds, between samples taken every second, after the first minute and
+    // away from the system time step
+    bool CheckSession(const Session& session, double maxErrorUs)
+    {
+        std::mt19937_64 random(42);
+        std::uniform_real_distribution<double> jitter(-session.jitterUs * 10.0, session.jitterUs * 10.0);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        const AbsoluteClock clock{ session };
+        ClockDomain domain(session.qpcFrequency);
+        const int64_t startTicks = 3600 * kTicksPerSecond;      // The device booted an hour ago
+        const int64_t sessionTicks = int64_t(session.hours * 3600.0) * kTicksPerSecond;
+        const int64_t stepTicks = startTicks + sessionTicks / 2;
+
+        auto sample = [&](int64_t ticks)
+        {
+            const int64_t qpc = TicksToQpc(ticks, session.qpcFrequency);
+            // What the clock reads at the QPC value, which is the truth for the conversion
+            const int64_t relativeTicks = domain.QpcToRelativeTicks(qpc).count();
+            domain.AddSample(qpc, clock.At(relativeTicks - startTicks) + int64_t(std::llround(jitter(random))));
+        };
+
+        sample(startTicks);
+        const int64_t fixedOffset = domain.GetSnapshot().offsetTicks;
+
+        double maxError = 0.0;
+        double maxFixedError = 0.0;
+        double sumSquares = 0.0;
+        size_t queries = 0;
+        for (int64_t ticks = startTicks + kTicksPerSecond; ticks <= startTicks + sessionTicks; ticks += kTicksPerSecond)
+        {
+            sample(ticks);
+
+            // Frames timestamped until the next sample
+            for (int i = 0; i < 10; i++)
+            {
+                const int64_t frameTicks = ticks + int64_t(unit(random) * kTicksPerSecond);
+                const bool settled = frameTicks - startTicks > 60 * kTicksPerSecond &&
+                    (session.stepSeconds == 0.0 || std::llabs(frameTicks - stepTicks) > 2 * kTicksPerSecond);
+                if (!settled)
+                {
+                    continue;
+                }
+
+                const double truth = double(clock.At(frameTicks - startTicks));
+                const double error = std::abs(double(domain.RelativeTicksToAbsoluteTicks(HundredsOfNanoseconds(frameTicks)).count()) - truth) / 10.0;
+                const double fixedError = std::abs(double(frameTicks + fixedOffset) - truth) / 10.0;
+                maxError = (std::max)(maxError, error);
+                maxFixedError = (std::max)(maxFixedError, fixedError);
+                sumSquares += error * error;
+                queries++;
+            }
+        }
+
+        const bool passed = maxError <= maxErrorUs;
+        printf("%-18s %6.1f h %8.1f ppm %9zu %10.2f %10.2f %14.1f  %s\n",
+            session.name, session.hours, session.driftPpm, queries, maxError, std::sqrt(sumSquares / queries), maxFixedError,
+            passed ? "ok" : "FAILED");
+        return passed;
+    }
+
+    // ClockDomain::Convert against the same line in double precision
+    bool CheckIntegerConversion()
+    {
+        std::mt19937_64 random(7);
+        std::uniform_int_distribution<int64_t> spans(-(int64_t(1) << 40), int64_t(1) << 40);
+        std::uniform_real_distribution<double> drifts(-1e-3, 1e-3);
+
+        double maxError = 0.0;
+        for (int i = 0; i < 1'000'000; i++)
+        {
+            ClockSnapshot snapshot;
+            snapshot.referenceTicks = 1'000'000'000'000 + int64_t(random() % 1'000'000'000'000);
+            snapshot.offsetTicks = kStartFileTime + int64_t(random() % 1'000'000);
+            snapshot.driftQ32 = std::llround(drifts(random) * 4294967296.0);
+            const int64_t span = spans(random);
+
+            const int64_t ticks = snapshot.referenceTicks + span;
+            const long double expected = (long double)ticks + snapshot.offsetTicks + (long double)span * snapshot.driftQ32 / 4294967296.0L;
+            const long double converted = (long double)ClockDomain::Convert(snapshot, HundredsOfNanoseconds(ticks)).count();
+            maxError = (std::max)(maxError, double(std::abs(converted - expected)));
+        }
+
+        const bool passed = maxError <= 1.0;
+        printf("integer conversion: max error %.3f ticks against double  %s\n", maxError, passed ? "ok" : "FAILED");
+        return passed;
+    }
+
+    // With a window of one sample, snapshot n is fully determined by n. Readers check each snapshot they get is one.
+    bool CheckConcurrentReads(double seconds)
+    {
+        ClockDomainOptions options;
+        options.windowSize = 1;
+        ClockDomain domain(10'000'000, options);
+        domain.AddSample(1000, 1000 + 7);
+
+        std::atomic<bool> stop{ false };
+        std::atomic<uint64_t> reads{ 0 };
+        std::atomic<uint64_t> tornReads{ 0 };
+        std::vector<std::thread> readers;
+        const unsigned readerCount = (std::max)(2u, (std::min)(4u, std::thread::hardware_concurrency()));
+        for (unsigned r = 0; r < readerCount; r++)
+        {
+            readers.emplace_back([&]()
+            {
+                uint64_t localReads = 0;
+                uint64_t localTorn = 0;
+                uint64_t lastVersion = 0;
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    const ClockSnapshot snapshot = domain.GetSnapshot();
+                    const int64_t n = int64_t(snapshot.version);
+                    if (snapshot.referenceTicks != n * 1000 || snapshot.offsetTicks != n * 7 || snapshot.driftQ32 != 0 ||
+                        snapshot.version < lastVersion)
+                    {
+                        localTorn++;
+                    }
+                    lastVersion = snapshot.version;
+                    localReads++;
+                }
+                reads += localReads;
+                tornReads += localTorn;
+            });
+        }
+
+        uint64_t writes = 1;
+        const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+        while (std::chrono::steady_clock::now() < end)
+        {
+            for (int i = 0; i < 1000; i++)
+            {
+                writes++;
+                domain.AddSample(int64_t(writes) * 1000, int64_t(writes) * 1000 + int64_t(writes) * 7);
+            }
+        }
+        stop = true;
+        for (std::thread& reader : readers)
+        {
+            reader.join();
+        }
+
+        const bool passed = tornReads == 0;
+        printf("concurrent reads: %u readers, %llu snapshots during %llu updates, %llu torn  %s\n", readerCount,
+            (unsigned long long)reads.load(), (unsigned long long)writes, (unsigned long long)tornReads.load(), passed ? "ok" : "FAILED");
+        return passed;
+    }
+
+    void MeasureConversions()
+    {
+        ClockDomain domain(10'000'000);
+        domain.AddSample(3600 * kTicksPerSecond, kStartFileTime);
+        domain.AddSample(3601 * kTicksPerSecond, kStartFileTime + kTicksPerSecond + 300);
+
+        const int kCount = 10'000'000;
+        int64_t sink = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kCount; i++)
+        {
+            sink += domain.RelativeTicksToAbsoluteTicks(HundredsOfNanoseconds(3600 * kTicksPerSecond + int64_t(i) * 333)).count();
+        }
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kCount;
+        printf("conversion: %.1f ns each (%lld)\n", ns, (long long)(sink & 1));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double maxErrorUs = 20.0;
+    double raceSeconds = 1.0;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--max-error" && i + 1 < argc)
+        {
+            maxErrorUs = atof(argv[++i]);
+        }
+        else if (arg == "--race-time" && i + 1 < argc)
+        {
+            raceSeconds = atof(argv[++i]);
+        }
+        else
+        {
+            printf("usage: ClockDomainTest [--max-error microseconds] [--race-time seconds]\n");
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    printf("%-18s %8s %12s %9s %10s %10s %14s\n", "session", "length", "drift", "queries", "max us", "rms us", "fixed max us");
+    bool passed = true;
+    for (const Session& session : kSessions)
+    {
+        passed = CheckSession(session, maxErrorUs) && passed;
+    }
+    passed = CheckIntegerConversion() && passed;
+    passed = CheckConcurrentReads(raceSeconds) && passed;
+    MeasureConversions();
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,270 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Checks that FilterDoubleExponentialBatch, which smooths all the hand joints of TrackedHands, gives the same positions
+// as one FilterDoubleExponential per joint. Both hands are laid out as in TrackedHands, 26 joints padded to 28 per hand,
+// and follow noisy trajectories with tracking losses: a whole hand drops out, so only the other hand's range is
+// updated, or single joints read as invalid (all zero) and restart their filter. Runs with the default parameters
+// TrackedHands uses and with ones that exercise the trend, the prediction and the deviation clamp. Then times both for
+// one frame of both hands. Exits with 1 when a position differs by more than the tolerance.
+
+#include "Common/FilterDoubleExponential.h"
+#include "Common/FilterDoubleExponentialBatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const size_t kHandCount = 2;
+    const size_t kHandJointCount = 26;
+    const size_t kJointStride = (kHandJointCount + FilterDoubleExponentialBatch::kLanesPerGroup - 1) /
+        FilterDoubleExponentialBatch::kLanesPerGroup * FilterDoubleExponentialBatch::kLanesPerGroup;
+    const size_t kFilterCount = kHandCount * kJointStride;
+
+    struct Parameters
+    {
+        const char* name;
+        float smoothing;
+        float correction;
+        float prediction;
+        float jitterRadius;
+        float maxDeviationRadius;
+    };
+
+    const Parameters kParameterSets[] = {
+        { "defaults", 0.5f, 0.0f, 0.0f, 0.05f, 0.05f },
+        { "trend_prediction", 0.3f, 0.4f, 1.5f, 0.01f, 0.02f },
+        { "heavy_smoothing", 0.9f, 0.1f, 0.5f, 0.0f, 0.1f },
+    };
+
+    // Joint positions of both hands for one frame, as the separate x, y and z arrays TrackedHands keeps.
+    // Hands that aren't tracked this frame are left out of the update.
+    struct Frame
+    {
+        std::vector<float> x, y, z;
+        bool tracked[kHandCount];
+    };
+
+    std::vector<Frame> MakeFrames(size_t frameCount, unsigned seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+        std::normal_distribution<float> noise(0.0f, 0.004f);
+
+        float jointOffsets[kHandCount][kHandJointCount][3];
+        for (auto& hand : jointOffsets)
+        {
+            for (auto& joint : hand)
+            {
+                for (float& coordinate : joint)
+                    coordinate = unit(random) * 0.1f;
+            }
+        }
+
+        std::vector<Frame> frames(frameCount);
+        bool tracked[kHandCount] = { true, true };
+        for (size_t frameIndex = 0; frameIndex < frameCount; frameIndex++)
+        {
+            Frame& frame = frames[frameIndex];
+            frame.x.assign(kFilterCount, 0.0f);
+            frame.y.assign(kFilterCount, 0.0f);
+            frame.z.assign(kFilterCount, 0.0f);
+
+            const float t = frameIndex / 60.0f;
+            for (size_t handIndex = 0; handIndex < kHandCount; handIndex++)
+            {
+                // Hands drop out and come back every few seconds
+                if (chance(random) < (tracked[handIndex] ? 0.01f : 0.05f))
+                    tracked[handIndex] = !tracked[handIndex];
+                frame.tracked[handIndex] = tracked[handIndex];
+
+                // Mostly slow movement, with fast swipes that go past the jitter and deviation radii
+                const float side = handIndex == 0 ? -0.2f : 0.2f;
+                const float swipe = std::sin(t * 0.5f + handIndex) > 0.8f ? 0.6f : 0.05f;
+                const float center[3] = { side + swipe * std::sin(t * 3.0f), 0.1f * std::cos(t * 1.3f), 0.4f + 0.05f * std::sin(t * 0.7f) };
+                for (size_t jointIndex = 0; jointIndex < kHandJointCount; jointIndex++)
+                {
+                    const size_t filterIndex = handIndex * kJointStride + jointIndex;
+                    if (chance(random) < 0.01f)
+                        continue;   // Invalid joint, all zero
+
+                    frame.x[filterIndex] = center[0] + jointOffsets[handIndex][jointIndex][0] + noise(random);
+                    frame.y[filterIndex] = center[1] + jointOffsets[handIndex][jointIndex][1] + noise(random);
+                    frame.z[filterIndex] = center[2] + jointOffsets[handIndex][jointIndex][2] + noise(random);
+                }
+            }
+        }
+        return frames;
+    }
+
+    // Feeds the frame to the batch like TrackedHands::Update: one call per run of consecutive tracked hands
+    void UpdateBatch(FilterDoubleExponentialBatch& batch, const Frame& frame)
+    {
+        for (size_t handIndex = 0; handIndex < kHandCount;)
+        {
+            if (!frame.tracked[handIndex])
+            {
+                handIndex++;
+                continue;
+            }
+
+            size_t endHandIndex = handIndex + 1;
+            while (endHandIndex < kHandCount && frame.tracked[endHandIndex])
+                endHandIndex++;
+
+            batch.Update(frame.x.data(), frame.y.data(), frame.z.data(), handIndex * kJointStride, endHandIndex * kJointStride);
+            handIndex = endHandIndex;
+        }
+    }
+
+    void UpdateFilters(std::vector<FilterDoubleExponential>& filters, const Frame& frame)
+    {
+        for (size_t handIndex = 0; handIndex < kHandCount; handIndex++)
+        {
+            if (!frame.tracked[handIndex])
+                continue;
+
+            for (size_t jointIndex = 0; jointIndex < kHandJointCount; jointIndex++)
+            {
+                const size_t filterIndex = handIndex * kJointStride + jointIndex;
+                filters[filterIndex].Update(XMVectorSet(frame.x[filterIndex], frame.y[filterIndex], frame.z[filterIndex], 0.0f));
+            }
+        }
+    }
+
+    bool CheckEquivalence(const Parameters& parameters, const std::vector<Frame>& frames, float tolerance)
+    {
+        FilterDoubleExponentialBatch batch(kFilterCount);
+        batch.SetParameters(parameters.smoothing, parameters.correction, parameters.prediction, parameters.jitterRadius, parameters.maxDeviationRadius);
+
+        std::vector<FilterDoubleExponential> filters(kFilterCount);
+        for (FilterDoubleExponential& filter : filters)
+            filter.SetParameters(parameters.smoothing, parameters.correction, parameters.prediction, parameters.jitterRadius, parameters.maxDeviationRadius);
+
+        std::vector<float> x(kFilterCount), y(kFilterCount), z(kFilterCount);
+        float maxDifference = 0.0f;
+        size_t compared = 0;
+        size_t differing = 0;
+        size_t exact = 0;
+        for (const Frame& frame : frames)
+        {
+            UpdateBatch(batch, frame);
+            UpdateFilters(filters, frame);
+            batch.GetFilteredValues(x.data(), y.data(), z.data(), 0, kFilterCount);
+
+            for (size_t handIndex = 0; handIndex < kHandCount; handIndex++)
+            {
+                for (size_t jointIndex = 0; jointIndex < kHandJointCount; jointIndex++)
+                {
+                    const size_t filterIndex = handIndex * kJointStride + jointIndex;
+                    XMFLOAT4 expected;
+                    XMStoreFloat4(&expected, filters[filterIndex].GetFilteredValue());
+                    XMFLOAT4 single;
+                    XMStoreFloat4(&single, batch.GetFilteredValue(filterIndex));
+
+                    const float difference = (std::max)({ std::fabs(x[filterIndex] - expected.x), std::fabs(y[filterIndex] - expected.y),
+                        std::fabs(z[filterIndex] - expected.z) });
+                    const bool sameSingle = single.x == x[filterIndex] && single.y == y[filterIndex] && single.z == z[filterIndex] && single.w == 1.0f;
+                    maxDifference = (std::max)(maxDifference, difference);
+                    differing += !(difference <= tolerance) || !sameSingle;
+                    exact += difference == 0.0f;
+                    compared++;
+                }
+            }
+        }
+
+        const bool passed = differing == 0;
+        printf("%-18s %8zu %12.3g %9.1f%%  %s\n", parameters.name, compared, maxDifference, 100.0 * exact / compared, passed ? "ok" : "FAILED");
+        return passed;
+    }
+
+    // One frame of both hands, per call
+    void MeasureUpdates(const std::vector<Frame>& frames)
+    {
+        FilterDoubleExponentialBatch batch(kFilterCount);
+        std::vector<FilterDoubleExponential> filters(kFilterCount);
+        std::vector<float> x(kFilterCount), y(kFilterCount), z(kFilterCount);
+        const size_t repeatCount = (std::max)(size_t(1), 200000 / frames.size());
+
+        float sink = 0.0f;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t repeat = 0; repeat < repeatCount; repeat++)
+        {
+            for (const Frame& frame : frames)
+            {
+                batch.Update(frame.x.data(), frame.y.data(), frame.z.data(), 0, kFilterCount);
+                batch.GetFilteredValues(x.data(), y.data(), z.data(), 0, kFilterCount);
+                sink += x[0];
+            }
+        }
+        const double batchNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (repeatCount * frames.size());
+
+        start = std::chrono::steady_clock::now();
+        for (size_t repeat = 0; repeat < repeatCount; repeat++)
+        {
+            for (const Frame& frame : frames)
+            {
+                for (size_t handIndex = 0; handIndex < kHandCount; handIndex++)
+                {
+                    for (size_t jointIndex = 0; jointIndex < kHandJointCount; jointIndex++)
+                    {
+                        const size_t filterIndex = handIndex * kJointStride + jointIndex;
+                        filters[filterIndex].Update(XMVectorSet(frame.x[filterIndex], frame.y[filterIndex], frame.z[filterIndex], 0.0f));
+                        sink += XMVectorGetX(filters[filterIndex].GetFilteredValue());
+                    }
+                }
+            }
+        }
+        const double filtersNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (repeatCount * frames.size());
+
+        printf("both hands per frame: batch %.0f ns, per joint filters %.0f ns, %.1fx (%d)\n", batchNs, filtersNs, filtersNs / batchNs, int(sink) & 1);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t frameCount = 3000;
+    float tolerance = 1e-5f;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc)
+        {
+            frameCount = (std::max)(size_t(1), size_t(strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (arg == "--tolerance" && i + 1 < argc)
+        {
+            tolerance = float(atof(argv[++i]));
+        }
+        else
+        {
+            printf("usage: FilterBatchTest [--frames count] [--tolerance meters]\n");
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    const std::vector<Frame> frames = MakeFrames(frameCount, 21);
+    printf("%zu frames of %zu joints, tolerance %g m\n", frameCount, kHandCount * kHandJointCount, tolerance);
+    printf("%-18s %8s %12s %10s\n", "parameters", "compared", "max diff m", "exact");
+    bool passed = true;
+    for (const Parameters& parameters : kParameterSets)
+        passed = CheckEquivalence(parameters, frames, tolerance) && passed;
+    MeasureUpdates(frames);
+    return passed ? 0 : 1;
+}
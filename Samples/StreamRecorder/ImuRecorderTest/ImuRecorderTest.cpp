@@ -0,0 +1,330 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Records SyntheticImuSource through ImuStreamRecorder, the IMU recording path of the app, and reads the files back:
+// the header must match, the samples must be consecutive samples of the source, bit for bit, and their timestamps
+// must follow the clock domain as it changes during the recording. Also checks that
+// samples that don't fit in the ring are counted in the header, that a recorder can record several times, and that
+// destroying a recorder returns while its source blocks (waiting for consent, or for a batch that never comes).
+// Exits with 1 when a check fails.
+
+#include "ImuSampleStream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct ImuFile
+    {
+        bool valid = false;
+        uint32_t version = 0;
+        uint32_t sensor = 0;
+        uint64_t droppedSampleCount = 0;
+        std::vector<ImuSample> samples;
+        std::vector<int64_t> timestamps;
+    };
+
+    // Same layout as utils.load_imu_samples reads
+    ImuFile ReadImuFile(const std::filesystem::path& path)
+    {
+        ImuFile file;
+        std::ifstream stream(path, std::ios::binary);
+        char magic[8];
+        stream.read(magic, sizeof(magic));
+        stream.read(reinterpret_cast<char*>(&file.version), sizeof(file.version));
+        stream.read(reinterpret_cast<char*>(&file.sensor), sizeof(file.sensor));
+        stream.read(reinterpret_cast<char*>(&file.droppedSampleCount), sizeof(file.droppedSampleCount));
+        if (!stream || memcmp(magic, "HLIMUSMP", sizeof(magic)) != 0)
+            return file;
+
+        ImuFileSample sample;
+        while (stream.read(reinterpret_cast<char*>(&sample), sizeof(sample)))
+        {
+            file.samples.push_back(sample.sample);
+            file.timestamps.push_back(sample.timestamp);
+        }
+        file.valid = stream.gcount() == 0;  // No partial sample at the end
+        return file;
+    }
+
+    // Index of the source sample, from its SoC ticks
+    uint64_t SampleIndex(const ImuSample& sample, double sampleRate)
+    {
+        return uint64_t(sample.socTicks * 1e-7 * sampleRate + 0.5);
+    }
+
+    bool SameSample(const ImuSample& a, const ImuSample& b)
+    {
+        return memcmp(&a, &b, sizeof(ImuSample)) == 0;
+    }
+
+    bool Report(const char* name, bool passed, const std::string& details)
+    {
+        printf("%-30s %s  %s\n", name, details.c_str(), passed ? "ok" : "FAILED");
+        return passed;
+    }
+
+    // Records for a while at the device rate and checks every sample against the source. Halfway, the system time
+    // jumps by a second: the samples written from then on must be converted with the new mapping.
+    bool CheckRoundTrip(ImuSensorKind kind, const std::filesystem::path& folder, double seconds)
+    {
+        const double sampleRate = 1000.0;
+        SyntheticImuSource reference(kind, sampleRate);
+        const std::filesystem::path path = folder / (std::string(GetImuSensorName(kind)) + ".bin");
+        const int64_t offset = 132'000'000'000'000'000 + int64_t(kind);
+        const int64_t step = 10'000'000;
+        ClockDomain clockDomain(10'000'000);
+        clockDomain.AddSample(0, offset);
+
+        uint64_t writtenSampleCount = 0;
+        {
+            ImuStreamRecorder recorder(std::make_unique<SyntheticImuSource>(kind, sampleRate), kind);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));    // Not recorded
+            if (!recorder.StartRecording(path, clockDomain))
+                return Report(GetImuSensorName(kind), false, "can't create " + path.string());
+            std::this_thread::sleep_for(std::chrono::duration<double>(seconds / 2));
+            clockDomain.AddSample(0, offset + step);
+            std::this_thread::sleep_for(std::chrono::duration<double>(seconds / 2));
+            recorder.StopRecording();
+            writtenSampleCount = recorder.GetWrittenSampleCount();
+        }
+
+        const ImuFile file = ReadImuFile(path);
+        size_t mismatches = 0;
+        for (size_t i = 0; i < file.samples.size(); i++)
+        {
+            const uint64_t index = SampleIndex(file.samples[i], sampleRate);
+            const bool consecutive = i == 0 || index == SampleIndex(file.samples[i - 1], sampleRate) + 1;
+            mismatches += !consecutive || !SameSample(file.samples[i], reference.GetSample(index));
+        }
+
+        // Timestamps switch to the new mapping once, and never back
+        size_t timestampErrors = 0;
+        size_t steppedSampleCount = 0;
+        for (size_t i = 0; i < file.samples.size(); i++)
+        {
+            const int64_t shift = file.timestamps[i] - int64_t(file.samples[i].socTicks) - offset;
+            const bool stepped = shift == step;
+            timestampErrors += (shift != 0 && !stepped) || (steppedSampleCount > 0 && !stepped);
+            steppedSampleCount += stepped;
+        }
+
+        // Anything recorded before StartRecording or lost would show up as a late first sample or a gap
+        const double expected = seconds * sampleRate;
+        const bool passed = file.valid && file.version == ImuStreamRecorder::kFileVersion && file.sensor == uint32_t(kind) &&
+            file.droppedSampleCount == 0 && mismatches == 0 && timestampErrors == 0 &&
+            steppedSampleCount > expected * 0.3 && steppedSampleCount < expected * 0.7 &&
+            file.samples.size() == writtenSampleCount && file.samples.size() > expected * 0.8 && file.samples.size() < expected * 1.2 &&
+            !file.samples.empty() && SampleIndex(file.samples[0], sampleRate) >= 90;
+
+        char details[200];
+        snprintf(details, sizeof(details), "%6zu samples in %.1f s, first #%llu, %zu mismatched, %zu after the clock step, %zu bad timestamps",
+            file.samples.size(), seconds, file.samples.empty() ? 0ull : (unsigned long long)SampleIndex(file.samples[0], sampleRate), mismatches,
+            steppedSampleCount, timestampErrors);
+        return Report(GetImuSensorName(kind), passed, details);
+    }
+
+    // A source far faster than the writer drains a small ring: samples get dropped and counted, the rest stay in order
+    bool CheckOverflow(const std::filesystem::path& folder)
+    {
+        const double sampleRate = 1e6;
+        SyntheticImuSource reference(ImuSensorKind::Gyroscope, sampleRate);
+        const std::filesystem::path path = folder / "overflow.bin";
+        uint64_t droppedSampleCount = 0;
+        const ClockDomain clockDomain(10'000'000);
+        {
+            ImuStreamRecorder recorder(std::make_unique<SyntheticImuSource>(ImuSensorKind::Gyroscope, sampleRate, 256, false),
+                ImuSensorKind::Gyroscope, 64);
+            recorder.StartRecording(path, clockDomain);
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            recorder.StopRecording();
+            droppedSampleCount = recorder.GetDroppedSampleCount();
+        }
+
+        const ImuFile file = ReadImuFile(path);
+        size_t mismatches = 0;
+        for (size_t i = 0; i < file.samples.size(); i++)
+        {
+            const uint64_t index = SampleIndex(file.samples[i], sampleRate);
+            const bool increasing = i == 0 || index > SampleIndex(file.samples[i - 1], sampleRate);
+            mismatches += !increasing || !SameSample(file.samples[i], reference.GetSample(index));
+        }
+
+        const bool passed = file.valid && file.droppedSampleCount == droppedSampleCount && droppedSampleCount > 0 && mismatches == 0;
+        char details[160];
+        snprintf(details, sizeof(details), "%6zu samples, %llu dropped and counted, %zu out of order", file.samples.size(),
+            (unsigned long long)file.droppedSampleCount, mismatches);
+        return Report("ring overflow", passed, details);
+    }
+
+    // Two recordings from one recorder, with a pause in between: each file only holds its own samples
+    bool CheckRestart(const std::filesystem::path& folder)
+    {
+        const double sampleRate = 1000.0;
+        const std::filesystem::path paths[2] = { folder / "first.bin", folder / "second.bin" };
+        const ClockDomain clockDomain(10'000'000);
+        {
+            ImuStreamRecorder recorder(std::make_unique<SyntheticImuSource>(ImuSensorKind::Accelerometer, sampleRate), ImuSensorKind::Accelerometer);
+            for (const std::filesystem::path& path : paths)
+            {
+                recorder.StartRecording(path, clockDomain);
+                std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                recorder.StopRecording();
+                std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            }
+        }
+
+        const ImuFile first = ReadImuFile(paths[0]);
+        const ImuFile second = ReadImuFile(paths[1]);
+        bool passed = first.valid && second.valid && !first.samples.empty() && !second.samples.empty();
+        uint64_t gap = 0;
+        if (passed)
+        {
+            gap = SampleIndex(second.samples.front(), sampleRate) - SampleIndex(first.samples.back(), sampleRate);
+            passed = gap >= 200;   // The pause isn't recorded
+        }
+
+        char details[160];
+        snprintf(details, sizeof(details), "%6zu and %zu samples, %llu ms apart", first.samples.size(), second.samples.size(), (unsigned long long)gap);
+        return Report("record twice", passed, details);
+    }
+
+    // Blocks in Open or ReadBatch until interrupted, like a consent prompt nobody answers or a stalled sensor
+    class BlockingSource : public ImuSampleSource
+    {
+    public:
+        explicit BlockingSource(bool blockInOpen) : m_blockInOpen(blockInOpen) {}
+
+        bool Open() override { return !m_blockInOpen || Wait(); }
+        bool ReadBatch(ImuSample*, size_t, size_t& count) override { count = 0; return Wait(); }
+        void Close() override {}
+
+        void Interrupt() override
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_interrupted = true;
+            }
+            m_condition.notify_all();
+        }
+
+    private:
+        bool Wait()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_interrupted; });
+            return false;
+        }
+
+        const bool m_blockInOpen;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_interrupted = false;
+    };
+
+    // The destructor runs on a separate thread, so a hang fails the check instead of the whole run
+    bool CheckDestroyWhileBlocked(const char* name, std::unique_ptr<ImuSampleSource> source)
+    {
+        auto pRecorder = std::make_shared<ImuStreamRecorder>(std::move(source), ImuSensorKind::Accelerometer);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        std::atomic<bool> destroyed{ false };
+        const auto start = std::chrono::steady_clock::now();
+        std::thread destroyThread([&]()
+        {
+            pRecorder.reset();
+            destroyed = true;
+        });
+
+        while (!destroyed && std::chrono::steady_clock::now() - start < std::chrono::seconds(2))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!destroyed)
+        {
+            Report(name, false, "destructor still blocked after 2 s");
+            fflush(stdout);
+            std::_Exit(1);
+        }
+        destroyThread.join();
+
+        char details[160];
+        snprintf(details, sizeof(details), "destroyed in %.1f ms", ms);
+        return Report(name, ms < 500.0, details);
+    }
+
+    // Samples per second through the ring and the writer, with a source that never waits
+    void MeasureThroughput(const std::filesystem::path& folder)
+    {
+        const std::filesystem::path path = folder / "throughput.bin";
+        uint64_t written = 0;
+        uint64_t dropped = 0;
+        const double seconds = 1.0;
+        const ClockDomain clockDomain(10'000'000);
+        {
+            ImuStreamRecorder recorder(std::make_unique<SyntheticImuSource>(ImuSensorKind::Gyroscope, 1e6, 256, false), ImuSensorKind::Gyroscope);
+            recorder.StartRecording(path, clockDomain);
+            std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+            recorder.StopRecording();
+            written = recorder.GetWrittenSampleCount();
+            dropped = recorder.GetDroppedSampleCount();
+        }
+        printf("throughput: the writer keeps up with %.2f M samples/s, %.2f M/s more were dropped\n", written / seconds * 1e-6, dropped / seconds * 1e-6);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::filesystem::path folder = std::filesystem::temp_directory_path() / "ImuRecorderTest";
+    double seconds = 1.0;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc)
+        {
+            folder = argv[++i];
+        }
+        else if (arg == "--seconds" && i + 1 < argc)
+        {
+            seconds = (std::max)(0.1, atof(argv[++i]));
+        }
+        else
+        {
+            printf("usage: ImuRecorderTest [--output folder] [--seconds duration]\n");
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(folder, error);
+    if (error)
+    {
+        printf("can't create %s: %s\n", folder.string().c_str(), error.message().c_str());
+        return 1;
+    }
+
+    bool passed = true;
+    for (ImuSensorKind kind : { ImuSensorKind::Accelerometer, ImuSensorKind::Gyroscope, ImuSensorKind::Magnetometer })
+        passed = CheckRoundTrip(kind, folder, seconds) && passed;
+    passed = CheckOverflow(folder) && passed;
+    passed = CheckRestart(folder) && passed;
+    passed = CheckDestroyWhileBlocked("destroy, blocked in Open", std::make_unique<BlockingSource>(true)) && passed;
+    passed = CheckDestroyWhileBlocked("destroy, blocked in ReadBatch", std::make_unique<BlockingSource>(false)) && passed;
+    passed = CheckDestroyWhileBlocked("destroy, slow synthetic", std::make_unique<SyntheticImuSource>(ImuSensorKind::Magnetometer, 0.1)) && passed;
+    MeasureThroughput(folder);
+    return passed ? 0 : 1;
+}
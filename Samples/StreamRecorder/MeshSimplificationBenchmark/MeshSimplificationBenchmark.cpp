@@ -0,0 +1,530 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Builds the LOD chain of GenerateMeshLODChain (through GenerateSimplificationLevels) for a synthetic spatial mapping
+// surface, a noisy room corner with a box on the floor, and reports per level: the triangle count, the error the
+// chain reports, the actual deviation from the room's surfaces and the time of brute force ray queries. The same is
+// reported for a chain that simplifies each level from the previous one, to show how much its errors understate.
+// Then times the closest point queries hand tracking makes every frame, for the 26 joints of both hands, through
+// Mesh's bounding box octree (MeshOctree.h, on plain floats), and checks them against testing every triangle.
+// Exits with 1 when a level deviates from the room by more than its reported error plus the noise, when the levels
+// don't shrink, or when a closest point query is wrong or the 52 joints take longer than the frame budget.
+
+#include "MeshDecimator.h"
+#include "Common/MeshOctree.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    struct Vec3
+    {
+        float x, y, z;
+    };
+
+    Vec3 operator+(const Vec3& a, const Vec3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+    Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    Vec3 operator*(const Vec3& a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+    float Dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    Vec3 Cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+
+    // Spatial mapping coordinates are far from the origin
+    const Vec3 kRoomOrigin = { 30.0f, -1.5f, 20.0f };
+
+    // An axis aligned rectangle of the room, in room coordinates: axis is the constant coordinate
+    struct Rectangle
+    {
+        int axis;
+        float value;
+        float min[2];
+        float max[2];
+    };
+
+    // Floor, two walls and the top and sides of a box
+    const Rectangle kRectangles[] = {
+        { 1, 0.0f, { 0.0f, 0.0f }, { 4.0f, 4.0f } },
+        { 0, 0.0f, { 0.0f, 0.0f }, { 2.5f, 4.0f } },
+        { 2, 0.0f, { 0.0f, 0.0f }, { 4.0f, 2.5f } },
+        { 1, 0.8f, { 1.5f, 1.5f }, { 2.5f, 2.5f } },
+        { 0, 1.5f, { 0.0f, 1.5f }, { 0.8f, 2.5f } },
+        { 0, 2.5f, { 0.0f, 1.5f }, { 0.8f, 2.5f } },
+        { 2, 1.5f, { 1.5f, 0.0f }, { 2.5f, 0.8f } },
+        { 2, 2.5f, { 1.5f, 0.0f }, { 2.5f, 0.8f } },
+    };
+
+    // The two coordinates a rectangle spans, in order
+    void SpanAxes(int axis, int& u, int& v)
+    {
+        u = axis == 0 ? 1 : 0;
+        v = axis == 2 ? 1 : 2;
+    }
+
+    float& Component(Vec3& p, int axis) { return axis == 0 ? p.x : axis == 1 ? p.y : p.z; }
+
+    double DistanceToRoom(Vec3 p)
+    {
+        p = p - kRoomOrigin;
+        double best = 1e30;
+        for (const Rectangle& rectangle : kRectangles)
+        {
+            int u, v;
+            SpanAxes(rectangle.axis, u, v);
+            const double du = (std::max)({ rectangle.min[0] - Component(p, u), 0.0f, Component(p, u) - rectangle.max[0] });
+            const double dv = (std::max)({ rectangle.min[1] - Component(p, v), 0.0f, Component(p, v) - rectangle.max[1] });
+            const double dn = Component(p, rectangle.axis) - rectangle.value;
+            best = (std::min)(best, std::sqrt(du * du + dv * dv + dn * dn));
+        }
+        return best;
+    }
+
+    // Each rectangle tessellated on its own grid, like the surface blocks of spatial mapping, with noise along its normal
+    SimplificationMesh MakeRoom(float spacing, float noise)
+    {
+        std::mt19937 random(11);
+        std::uniform_real_distribution<float> offset(-noise, noise);
+
+        SimplificationMesh mesh;
+        for (const Rectangle& rectangle : kRectangles)
+        {
+            int u, v;
+            SpanAxes(rectangle.axis, u, v);
+            const int countU = (std::max)(1, int(std::lround((rectangle.max[0] - rectangle.min[0]) / spacing)));
+            const int countV = (std::max)(1, int(std::lround((rectangle.max[1] - rectangle.min[1]) / spacing)));
+            const unsigned firstVertex = unsigned(mesh.positions.size() / 3);
+            for (int j = 0; j <= countV; j++)
+            {
+                for (int i = 0; i <= countU; i++)
+                {
+                    Vec3 p = { 0.0f, 0.0f, 0.0f };
+                    Component(p, u) = rectangle.min[0] + (rectangle.max[0] - rectangle.min[0]) * i / countU;
+                    Component(p, v) = rectangle.min[1] + (rectangle.max[1] - rectangle.min[1]) * j / countV;
+                    Component(p, rectangle.axis) = rectangle.value + offset(random);
+                    p = p + kRoomOrigin;
+                    mesh.positions.insert(mesh.positions.end(), { p.x, p.y, p.z });
+                }
+            }
+            for (int j = 0; j < countV; j++)
+            {
+                for (int i = 0; i < countU; i++)
+                {
+                    const unsigned a = firstVertex + unsigned(j * (countU + 1) + i);
+                    const unsigned b = a + 1;
+                    const unsigned c = a + unsigned(countU + 1);
+                    mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, c + 1 });
+                }
+            }
+        }
+        return mesh;
+    }
+
+    Vec3 Position(const SimplificationMesh& mesh, unsigned index)
+    {
+        return { mesh.positions[index * 3 + 0], mesh.positions[index * 3 + 1], mesh.positions[index * 3 + 2] };
+    }
+
+    // Largest distance from the room's surfaces, over the vertices and the triangle centers
+    double MaxDeviation(const SimplificationMesh& mesh)
+    {
+        double deviation = 0.0;
+        for (size_t vertex = 0; vertex < mesh.positions.size() / 3; vertex++)
+            deviation = (std::max)(deviation, DistanceToRoom(Position(mesh, unsigned(vertex))));
+        for (size_t index = 0; index < mesh.indices.size(); index += 3)
+        {
+            const Vec3 center = (Position(mesh, mesh.indices[index]) + Position(mesh, mesh.indices[index + 1]) + Position(mesh, mesh.indices[index + 2])) * (1.0f / 3.0f);
+            deviation = (std::max)(deviation, DistanceToRoom(center));
+        }
+        return deviation;
+    }
+
+    // Nearest hit of a ray against every triangle (Moller-Trumbore), what Mesh intersection costs without its boxes
+    float CastRay(const SimplificationMesh& mesh, const Vec3& origin, const Vec3& direction)
+    {
+        float nearest = 1e30f;
+        for (size_t index = 0; index < mesh.indices.size(); index += 3)
+        {
+            const Vec3 p0 = Position(mesh, mesh.indices[index]);
+            const Vec3 e1 = Position(mesh, mesh.indices[index + 1]) - p0;
+            const Vec3 e2 = Position(mesh, mesh.indices[index + 2]) - p0;
+            const Vec3 p = Cross(direction, e2);
+            const float det = Dot(e1, p);
+            if (std::fabs(det) < 1e-12f)
+                continue;
+            const float inverseDet = 1.0f / det;
+            const Vec3 s = origin - p0;
+            const float u = Dot(s, p) * inverseDet;
+            if (u < 0.0f || u > 1.0f)
+                continue;
+            const Vec3 q = Cross(s, e1);
+            const float v = Dot(direction, q) * inverseDet;
+            if (v < 0.0f || u + v > 1.0f)
+                continue;
+            const float t = Dot(e2, q) * inverseDet;
+            if (t > 0.0f && t < nearest)
+                nearest = t;
+        }
+        return nearest;
+    }
+
+    struct Ray
+    {
+        Vec3 origin;
+        Vec3 direction;
+    };
+
+    // From head height in the room, towards the floor, the walls and the box
+    std::vector<Ray> MakeRays(size_t count)
+    {
+        std::mt19937 random(3);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::vector<Ray> rays;
+        while (rays.size() < count)
+        {
+            Vec3 direction = { unit(random), unit(random) - 0.5f, unit(random) };
+            const float length = std::sqrt(Dot(direction, direction));
+            if (length < 0.1f || length > 1.0f)
+                continue;
+            direction = direction * (1.0f / length);
+            if (direction.x > 0.0f && direction.z > 0.0f && direction.y > -0.2f)
+                continue;   // Towards the open side of the room
+            rays.push_back({ kRoomOrigin + Vec3{ 3.0f, 1.6f, 3.2f }, direction });
+        }
+        return rays;
+    }
+
+    // The VectorOps of MeshOctree.h on Vec3
+    struct FloatOps
+    {
+        typedef Vec3 Vector;
+
+        static Vec3 Add(const Vec3& a, const Vec3& b) { return a + b; }
+        static Vec3 Subtract(const Vec3& a, const Vec3& b) { return a - b; }
+        static Vec3 Scale(const Vec3& v, float scale) { return v * scale; }
+        static Vec3 Abs(const Vec3& v) { return { std::fabs(v.x), std::fabs(v.y), std::fabs(v.z) }; }
+        static float Dot(const Vec3& a, const Vec3& b) { return ::Dot(a, b); }
+        static Vec3 Cross(const Vec3& a, const Vec3& b) { return ::Cross(a, b); }
+        static Vec3 Min(const Vec3& a, const Vec3& b) { return { (std::min)(a.x, b.x), (std::min)(a.y, b.y), (std::min)(a.z, b.z) }; }
+        static Vec3 Max(const Vec3& a, const Vec3& b) { return { (std::max)(a.x, b.x), (std::max)(a.y, b.y), (std::max)(a.z, b.z) }; }
+        static Vec3 Replicate(float value) { return { value, value, value }; }
+        static Vec3 Load3(const Vec3& v) { return v; }
+        static void Store3(const Vec3& v, Vec3& destination) { destination = v; }
+
+        static bool InBounds(const Vec3& v, const Vec3& bounds)
+        {
+            return std::fabs(v.x) <= bounds.x && std::fabs(v.y) <= bounds.y && std::fabs(v.z) <= bounds.z;
+        }
+
+        static Vec3 Normalize(const Vec3& v)
+        {
+            const float length = std::sqrt(::Dot(v, v));
+            return length > 0.0f ? v * (1.0f / length) : v;
+        }
+    };
+
+    struct OctreeVertex
+    {
+        Vec3 position;
+    };
+
+    struct OctreeBox
+    {
+        Vec3 Center;
+        Vec3 Extents;
+    };
+
+    // Mesh::BoundingBoxNode
+    struct OctreeNode
+    {
+        OctreeBox boundingBox;
+        std::vector<unsigned> indicesContained;
+        std::vector<OctreeNode> children;
+        OctreeBox triangleBounds;
+    };
+
+    // Mesh::BoundingBoxNode::targetTriangleCount
+    const size_t kTargetTriangleCount = 250;
+
+    struct Octree
+    {
+        std::vector<OctreeVertex> vertices;
+        OctreeNode root;
+    };
+
+    // Mesh::UpdateBoundingBox
+    Octree BuildOctree(const SimplificationMesh& mesh)
+    {
+        Octree octree;
+        for (size_t vertex = 0; vertex < mesh.positions.size() / 3; vertex++)
+            octree.vertices.push_back({ Position(mesh, unsigned(vertex)) });
+
+        Vec3 minimum = FloatOps::Replicate(FLT_MAX);
+        Vec3 maximum = FloatOps::Replicate(-FLT_MAX);
+        for (const OctreeVertex& vertex : octree.vertices)
+        {
+            minimum = FloatOps::Min(minimum, vertex.position);
+            maximum = FloatOps::Max(maximum, vertex.position);
+        }
+        octree.root.boundingBox.Extents = (maximum - minimum) * 0.5f;
+        octree.root.boundingBox.Center = minimum + octree.root.boundingBox.Extents;
+        GenerateOctreeNodes<FloatOps>(octree.root, octree.vertices, mesh.indices, 1, kTargetTriangleCount);
+        return octree;
+    }
+
+    // Mesh::RefineClosestPoints for a batch of points with an identity transform: the distance to the closest point
+    // within maxDistance of each point, or maxDistance when there is none
+    void FindClosestDistances(const Octree& octree, const Vec3* pPoints, size_t pointCount, float maxDistance, float* pDistances)
+    {
+        for (size_t pointIndex = 0; pointIndex < pointCount; pointIndex++)
+        {
+            float closestDistanceSquared = maxDistance * maxDistance;
+            Vec3 closestPoint, normal;
+            pDistances[pointIndex] = FindClosestPointInOctree<FloatOps>(octree.root, octree.vertices, pPoints[pointIndex], closestDistanceSquared,
+                closestPoint, normal) ? std::sqrt(closestDistanceSquared) : maxDistance;
+        }
+    }
+
+    float FindClosestDistanceBruteForce(const SimplificationMesh& mesh, const Vec3& p, float maxDistance)
+    {
+        float closestDistanceSquared = maxDistance * maxDistance;
+        for (size_t index = 0; index < mesh.indices.size(); index += 3)
+        {
+            const Vec3 pointOnTriangle = ClosestPointOnTriangle<FloatOps>(p, Position(mesh, mesh.indices[index]),
+                Position(mesh, mesh.indices[index + 1]), Position(mesh, mesh.indices[index + 2]));
+            closestDistanceSquared = (std::min)(closestDistanceSquared, Dot(pointOnTriangle - p, pointOnTriangle - p));
+        }
+        return std::sqrt(closestDistanceSquared);
+    }
+
+    const size_t kJointsPerHand = 26;
+
+    // The joints of both hands over a number of frames: two hands of about 20 cm, one moving across the room up to
+    // half a meter above the floor and the box, the other along a wall
+    std::vector<Vec3> MakeHandJoints(size_t frameCount)
+    {
+        std::mt19937 random(9);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        Vec3 handShape[kJointsPerHand];
+        for (Vec3& joint : handShape)
+            joint = Vec3{ unit(random), unit(random), unit(random) } * 0.1f;
+
+        std::vector<Vec3> joints;
+        for (size_t frame = 0; frame < frameCount; frame++)
+        {
+            const float t = float(frame) / 60.0f;
+            const Vec3 hands[2] = {
+                { 2.0f + 1.5f * std::sin(t * 0.7f), 0.3f + 0.25f * std::sin(t * 1.3f), 2.0f + 1.5f * std::cos(t * 0.5f) },
+                { 0.15f + 0.1f * std::sin(t * 1.1f), 0.9f + 0.5f * std::sin(t * 0.4f), 1.0f + 0.8f * std::cos(t * 0.9f) } };
+            for (const Vec3& hand : hands)
+            {
+                for (const Vec3& joint : handShape)
+                    joints.push_back(kRoomOrigin + hand + joint);
+            }
+        }
+        return joints;
+    }
+
+    struct LevelReport
+    {
+        size_t triangleCount;
+        float reportedError;
+        double deviation;
+    };
+
+    // Simplifying each level from the previous one, as GenerateMeshLODChain first did
+    std::vector<SimplificationLevel> GenerateChainedLevels(const SimplificationMesh& source, unsigned maxLevelCount, float ratio, size_t minTriangleCount)
+    {
+        std::vector<SimplificationLevel> levels;
+        const SimplificationMesh* pPrevious = &source;
+        float previousError = 0.0f;
+        while (levels.size() + 1 < maxLevelCount)
+        {
+            const size_t previousTriangleCount = pPrevious->indices.size() / 3;
+            const size_t target = size_t(previousTriangleCount * ratio);
+            if (target < minTriangleCount)
+                break;
+            SimplificationLevel level;
+            const MeshSimplificationResult result = SimplifyTriangles(*pPrevious, target, 1e30f, level.mesh);
+            if (result.triangleCount == 0 || result.triangleCount >= previousTriangleCount)
+                break;
+            level.error = (std::max)(result.error, previousError);
+            previousError = level.error;
+            levels.push_back(std::move(level));
+            pPrevious = &levels.back().mesh;
+        }
+        return levels;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    float spacing = 0.04f;
+    float noise = 0.003f;
+    size_t rayCount = 200;
+    unsigned levelCount = 5;
+    size_t frameCount = 600;
+    float maxDistance = 0.5f;
+    double budgetUs = 1000.0;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--spacing" && i + 1 < argc)
+        {
+            spacing = (std::max)(0.005f, float(atof(argv[++i])));
+        }
+        else if (arg == "--noise" && i + 1 < argc)
+        {
+            noise = (std::max)(0.0f, float(atof(argv[++i])));
+        }
+        else if (arg == "--rays" && i + 1 < argc)
+        {
+            rayCount = (std::max)(size_t(1), size_t(strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (arg == "--levels" && i + 1 < argc)
+        {
+            levelCount = (std::max)(2u, unsigned(strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (arg == "--frames" && i + 1 < argc)
+        {
+            frameCount = (std::max)(size_t(1), size_t(strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (arg == "--max-distance" && i + 1 < argc)
+        {
+            maxDistance = (std::max)(0.001f, float(atof(argv[++i])));
+        }
+        else if (arg == "--budget" && i + 1 < argc)
+        {
+            budgetUs = atof(argv[++i]);
+        }
+        else
+        {
+            printf("usage: MeshSimplificationBenchmark [--spacing meters] [--noise meters] [--rays count] [--levels count]\n"
+                "                                   [--frames count] [--max-distance meters] [--budget microseconds]\n");
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    const SimplificationMesh room = MakeRoom(spacing, noise);
+    const std::vector<Ray> rays = MakeRays(rayCount);
+
+    auto start = std::chrono::steady_clock::now();
+    const std::vector<SimplificationLevel> levels = GenerateSimplificationLevels(room, levelCount, 0.35f, 32);
+    const double chainMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    const std::vector<SimplificationLevel> chainedLevels = GenerateChainedLevels(room, levelCount, 0.35f, 32);
+    const double chainedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("room: %zu triangles at %.0f mm spacing, %.1f mm noise, %zu rays\n", room.indices.size() / 3, spacing * 1e3, noise * 1e3, rays.size());
+    printf("%-6s %10s %9s %11s %13s %11s %9s %8s %13s %13s\n", "level", "triangles", "kept", "error mm", "deviation mm",
+        "ray us", "speedup", "misses", "chained err", "chained dev");
+
+    std::vector<float> referenceHits;
+    double referenceRayUs = 0.0;
+    bool passed = true;
+    size_t previousTriangleCount = room.indices.size() / 3 + 1;
+    for (size_t level = 0; level <= levels.size(); level++)
+    {
+        const SimplificationMesh& mesh = level == 0 ? room : levels[level - 1].mesh;
+        const float reportedError = level == 0 ? 0.0f : levels[level - 1].error;
+        const size_t triangleCount = mesh.indices.size() / 3;
+
+        std::vector<float> hits;
+        start = std::chrono::steady_clock::now();
+        for (const Ray& ray : rays)
+            hits.push_back(CastRay(mesh, ray.origin, ray.direction));
+        const double rayUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rays.size();
+        if (level == 0)
+        {
+            referenceHits = hits;
+            referenceRayUs = rayUs;
+        }
+
+        // Rays that hit level 0 but go through a hole of this level
+        size_t misses = 0;
+        for (size_t i = 0; i < hits.size(); i++)
+            misses += referenceHits[i] < 1e29f && hits[i] >= 1e29f;
+
+        const double deviation = MaxDeviation(mesh);
+        const bool withinError = deviation <= reportedError + 2.0 * noise + 1e-4;
+        const bool shrinks = triangleCount < previousTriangleCount;
+        passed = passed && withinError && shrinks;
+        previousTriangleCount = triangleCount;
+
+        char chainedError[32] = "-";
+        char chainedDeviation[32] = "-";
+        if (level > 0 && level <= chainedLevels.size())
+        {
+            snprintf(chainedError, sizeof(chainedError), "%.1f", chainedLevels[level - 1].error * 1e3);
+            snprintf(chainedDeviation, sizeof(chainedDeviation), "%.1f", MaxDeviation(chainedLevels[level - 1].mesh) * 1e3);
+        }
+
+        printf("%-6zu %10zu %8.1f%% %11.1f %13.1f %11.1f %8.1fx %8zu %13s %13s  %s\n", level, triangleCount,
+            100.0 * triangleCount / (room.indices.size() / 3), reportedError * 1e3, deviation * 1e3, rayUs, referenceRayUs / rayUs,
+            misses, chainedError, chainedDeviation, withinError && shrinks ? "ok" : "FAILED");
+    }
+    printf("chain built in %.0f ms from level 0, %.0f ms level from level\n", chainMs, chainedMs);
+
+    // Closest points for both hands every frame, what SurfaceMapping::FindClosestPoints does per surface
+    const std::vector<Vec3> joints = MakeHandJoints(frameCount);
+    const size_t jointsPerFrame = 2 * kJointsPerHand;
+    printf("\nclosest points: %zu joints per frame, %zu frames, within %.0f mm, budget %.0f us per frame\n", jointsPerFrame,
+        frameCount, maxDistance * 1e3, budgetUs);
+    printf("%-6s %10s %9s %12s %12s %12s %9s %10s\n", "level", "triangles", "build ms", "frame us", "worst us", "brute us",
+        "speedup", "in reach");
+    for (size_t level = 0; level <= levels.size(); level++)
+    {
+        const SimplificationMesh& mesh = level == 0 ? room : levels[level - 1].mesh;
+
+        start = std::chrono::steady_clock::now();
+        const Octree octree = BuildOctree(mesh);
+        const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<float> distances(joints.size());
+        double totalUs = 0.0;
+        double worstUs = 0.0;
+        for (size_t frame = 0; frame < frameCount; frame++)
+        {
+            start = std::chrono::steady_clock::now();
+            FindClosestDistances(octree, &joints[frame * jointsPerFrame], jointsPerFrame, maxDistance, &distances[frame * jointsPerFrame]);
+            const double frameUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            totalUs += frameUs;
+            worstUs = (std::max)(worstUs, frameUs);
+        }
+        const double frameUs = totalUs / frameCount;
+
+        // Testing every triangle gives the same distances, on a subset of the frames
+        const size_t checkedFrameStep = (std::max)(size_t(1), frameCount / 20);
+        size_t checkedFrames = 0;
+        size_t wrong = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t frame = 0; frame < frameCount; frame += checkedFrameStep, checkedFrames++)
+        {
+            for (size_t joint = frame * jointsPerFrame; joint < (frame + 1) * jointsPerFrame; joint++)
+                wrong += std::fabs(FindClosestDistanceBruteForce(mesh, joints[joint], maxDistance) - distances[joint]) > 1e-5f;
+        }
+        const double bruteUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / checkedFrames;
+
+        const size_t inReach = size_t(std::count_if(distances.begin(), distances.end(), [&](float d) { return d < maxDistance; }));
+        const bool withinBudget = frameUs <= budgetUs;
+        passed = passed && wrong == 0 && withinBudget;
+        printf("%-6zu %10zu %9.1f %12.1f %12.1f %12.0f %8.0fx %9.0f%%  %s%s\n", level, mesh.indices.size() / 3, buildMs, frameUs,
+            worstUs, bruteUs, bruteUs / frameUs, 100.0 * inReach / distances.size(), wrong == 0 && withinBudget ? "ok" : "FAILED",
+            wrong != 0 ? " (wrong closest points)" : !withinBudget ? " (over budget)" : "");
+    }
+    return passed ? 0 : 1;
+}
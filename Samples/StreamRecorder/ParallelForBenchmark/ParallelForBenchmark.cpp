@@ -0,0 +1,430 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Checks and times ParallelForChunks and the mesh kernels of MeshKernels.h, which Cannon's Mesh runs on DirectXMath
+// for BakeTransform, GenerateSmoothNormals and UpdateBoundingBox. Here the kernels run on plain floats. The checks:
+// every index is visited exactly once, nested and concurrent calls complete, the smooth normals gathered in parallel
+// are bit for bit the ones of a serial scatter over the triangles, and the bounds folded from per chunk partial results
+// are those of a serial walk over the vertices. The benchmarks time the kernels serially, with a thread per chunk
+// created on every call (the previous ParallelForChunks) and on the shared pool, then the fixed cost of a call of each
+// kind. Exits with 1 when a check fails.
+
+#include "MeshKernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Float3
+    {
+        float x, y, z;
+    };
+
+    struct Float4x4
+    {
+        float m[4][4];
+    };
+
+    // The VectorOps of MeshKernels.h on plain floats, with the row vector convention of DirectXMath
+    struct FloatOps
+    {
+        typedef Float3 Vector;
+        typedef Float4x4 Matrix;
+
+        static Float3 Add(const Float3& a, const Float3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+        static Float3 Subtract(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+        static Float3 Min(const Float3& a, const Float3& b) { return { (std::min)(a.x, b.x), (std::min)(a.y, b.y), (std::min)(a.z, b.z) }; }
+        static Float3 Max(const Float3& a, const Float3& b) { return { (std::max)(a.x, b.x), (std::max)(a.y, b.y), (std::max)(a.z, b.z) }; }
+        static Float3 Replicate(float value) { return { value, value, value }; }
+
+        static Float3 Cross(const Float3& a, const Float3& b)
+        {
+            return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+        }
+
+        static Float3 Normalize(const Float3& v)
+        {
+            const float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+            return length > 0.0f ? Float3{ v.x / length, v.y / length, v.z / length } : v;
+        }
+
+        static Float3 TransformCoord(const Float3& p, const Float4x4& transform)
+        {
+            const auto& m = transform.m;
+            const float w = p.x * m[0][3] + p.y * m[1][3] + p.z * m[2][3] + m[3][3];
+            return {
+                (p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0]) / w,
+                (p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1]) / w,
+                (p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2]) / w };
+        }
+
+        static Float3 TransformNormal(const Float3& n, const Float4x4& transform)
+        {
+            const auto& m = transform.m;
+            return {
+                n.x * m[0][0] + n.y * m[1][0] + n.z * m[2][0],
+                n.x * m[0][1] + n.y * m[1][1] + n.z * m[2][1],
+                n.x * m[0][2] + n.y * m[1][2] + n.z * m[2][2] };
+        }
+    };
+
+    struct Vertex
+    {
+        Float3 position;
+        Float3 normal;
+    };
+
+    struct TestMesh
+    {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned> indices;
+    };
+
+    // A bumpy grid, with its triangles shuffled so vertices are shared by triangles far apart in the index buffer
+    TestMesh MakeMesh(size_t vertexCount, uint64_t seed)
+    {
+        std::mt19937_64 random(seed);
+        std::uniform_real_distribution<float> bump(-0.01f, 0.01f);
+        const size_t side = (std::max)(size_t(2), size_t(std::sqrt(double(vertexCount))));
+
+        TestMesh mesh;
+        for (size_t y = 0; y < side; y++)
+        {
+            for (size_t x = 0; x < side; x++)
+            {
+                mesh.vertices.push_back({ { x * 0.01f, y * 0.01f, bump(random) }, { 0.0f, 0.0f, 0.0f } });
+            }
+        }
+
+        std::vector<unsigned> quads;
+        for (unsigned y = 0; y + 1 < side; y++)
+        {
+            for (unsigned x = 0; x + 1 < side; x++)
+            {
+                quads.push_back(unsigned(y * side + x));
+            }
+        }
+        std::shuffle(quads.begin(), quads.end(), random);
+        for (unsigned corner : quads)
+        {
+            const unsigned right = corner + 1;
+            const unsigned below = corner + unsigned(side);
+            mesh.indices.insert(mesh.indices.end(), { corner, right, below, right, below + 1, below });
+        }
+        return mesh;
+    }
+
+    // What Mesh::GenerateSmoothNormals did before it went parallel
+    void SmoothNormalsSerial(std::vector<Vertex>& vertices, const std::vector<unsigned>& indices)
+    {
+        for (size_t index = 0; index < indices.size(); index += 3)
+        {
+            Vertex& a = vertices[indices[index + 0]];
+            Vertex& b = vertices[indices[index + 1]];
+            Vertex& c = vertices[indices[index + 2]];
+            const Float3 faceNormal = FloatOps::Cross(FloatOps::Subtract(a.position, b.position), FloatOps::Subtract(c.position, b.position));
+            a.normal = FloatOps::Add(a.normal, faceNormal);
+            b.normal = FloatOps::Add(b.normal, faceNormal);
+            c.normal = FloatOps::Add(c.normal, faceNormal);
+        }
+        for (Vertex& vertex : vertices)
+        {
+            vertex.normal = FloatOps::Normalize(vertex.normal);
+        }
+    }
+
+    // The other ways of running the kernels' chunks, besides PoolChunks: all of them inline as a single chunk, or
+    // on a thread created per chunk, either chunked like ParallelForChunks or into a set number of chunks
+    struct SerialChunks
+    {
+        size_t GetChunkCount(size_t, size_t) const
+        {
+            return 1;
+        }
+
+        template<typename Function>
+        void operator()(size_t count, size_t, Function function) const
+        {
+            if (count > 0)
+                function(size_t(0), size_t(0), count);
+        }
+    };
+
+    struct ThreadPerChunk
+    {
+        size_t chunkCount = 0;
+
+        size_t GetChunkCount(size_t count, size_t minCountPerThread) const
+        {
+            return chunkCount > 0 ? chunkCount : GetParallelChunkCount(count, minCountPerThread);
+        }
+
+        template<typename Function>
+        void operator()(size_t count, size_t minCountPerThread, Function function) const
+        {
+            if (count == 0)
+                return;
+
+            const size_t chunks = GetChunkCount(count, minCountPerThread);
+            const size_t chunkSize = (count + chunks - 1) / chunks;
+            std::vector<std::thread> threads;
+            for (size_t chunkIndex = 1; chunkIndex < chunks; ++chunkIndex)
+            {
+                const size_t begin = (std::min)(count, chunkIndex * chunkSize);
+                threads.emplace_back(function, chunkIndex, begin, (std::min)(count, begin + chunkSize));
+            }
+            function(size_t(0), size_t(0), (std::min)(count, chunkSize));
+            for (auto& thread : threads)
+                thread.join();
+        }
+    };
+
+    bool CheckCoverage()
+    {
+        bool passed = true;
+        for (size_t count : { size_t(0), size_t(1), size_t(7), size_t(1000), size_t(4097), size_t(100003) })
+        {
+            for (size_t minCountPerThread : { size_t(0), size_t(1), size_t(100), size_t(1024) })
+            {
+                std::vector<std::atomic<int>> visits(count);
+                std::atomic<bool> badChunk{ false };
+                const size_t chunkCount = GetParallelChunkCount(count, minCountPerThread);
+                ParallelForChunks(count, minCountPerThread, [&](size_t chunkIndex, size_t begin, size_t end)
+                {
+                    if (chunkIndex >= chunkCount || begin > end || end > count)
+                        badChunk = true;
+                    for (size_t i = begin; i < end; i++)
+                        visits[i]++;
+                });
+                const bool covered = std::all_of(visits.begin(), visits.end(), [](const std::atomic<int>& v) { return v == 1; });
+                if (!covered || badChunk)
+                {
+                    printf("coverage: %zu elements, at least %zu per thread  FAILED\n", count, minCountPerThread);
+                    passed = false;
+                }
+            }
+        }
+
+        // Calls nested in a chunk, and calls from several threads at once, run inline instead of waiting for the pool
+        std::atomic<size_t> nestedTotal{ 0 };
+        ParallelForChunks(64, 1, [&](size_t, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+                ParallelForChunks(100, 1, [&](size_t, size_t innerBegin, size_t innerEnd) { nestedTotal += innerEnd - innerBegin; });
+        });
+        std::atomic<size_t> concurrentTotal{ 0 };
+        std::vector<std::thread> callers;
+        for (int caller = 0; caller < 4; caller++)
+        {
+            callers.emplace_back([&]()
+            {
+                for (int call = 0; call < 1000; call++)
+                    ParallelForChunks(1000, 10, [&](size_t, size_t begin, size_t end) { concurrentTotal += end - begin; });
+            });
+        }
+        for (auto& caller : callers)
+            caller.join();
+
+        const bool reentrant = nestedTotal == 6400 && concurrentTotal == 4'000'000;
+        printf("coverage: every index once for 24 shapes%s, nested and concurrent calls %s  %s\n",
+            passed ? "" : " (see above)", reentrant ? "complete" : "lost chunks", passed && reentrant ? "ok" : "FAILED");
+        return passed && reentrant;
+    }
+
+    // kMinVerticesPerThread and kMinTrianglesPerThread of DrawCall.cpp
+    const size_t kMinVerticesPerThread = 4096;
+    const size_t kMinTrianglesPerThread = 4096;
+
+    bool CheckSmoothNormals()
+    {
+        bool passed = true;
+        for (size_t vertexCount : { size_t(100), size_t(10'000), size_t(250'000) })
+        {
+            TestMesh serial = MakeMesh(vertexCount, vertexCount);
+            TestMesh pool = serial;
+            TestMesh threads = serial;
+            SmoothNormalsSerial(serial.vertices, serial.indices);
+            AccumulateSmoothNormals<FloatOps>(pool.vertices.data(), pool.vertices.size(), pool.indices.data(), pool.indices.size() / 3,
+                kMinVerticesPerThread, kMinTrianglesPerThread);
+            AccumulateSmoothNormals<FloatOps>(threads.vertices.data(), threads.vertices.size(), threads.indices.data(), threads.indices.size() / 3,
+                1, 1, ThreadPerChunk{ 7 });
+
+            const size_t size = serial.vertices.size() * sizeof(Vertex);
+            const bool identical = memcmp(serial.vertices.data(), pool.vertices.data(), size) == 0 &&
+                memcmp(serial.vertices.data(), threads.vertices.data(), size) == 0;
+            printf("smooth normals: %zu vertices, %zu triangles, parallel gather on the pool and on 7 chunks %s serial scatter  %s\n",
+                serial.vertices.size(), serial.indices.size() / 3, identical ? "bit for bit equal to" : "differs from",
+                identical ? "ok" : "FAILED");
+            passed = passed && identical;
+        }
+        return passed;
+    }
+
+    bool CheckBounds()
+    {
+        bool passed = true;
+        for (size_t vertexCount : { size_t(4), size_t(25), size_t(10'000), size_t(250'000) })
+        {
+            TestMesh mesh = MakeMesh(vertexCount, vertexCount + 1);
+            std::mt19937_64 random(vertexCount);
+            std::uniform_real_distribution<float> coordinate(-50.0f, 50.0f);
+            for (Vertex& vertex : mesh.vertices)
+                vertex.position = { coordinate(random), coordinate(random), coordinate(random) };
+
+            Float3 expectedMin = FloatOps::Replicate(FLT_MAX);
+            Float3 expectedMax = FloatOps::Replicate(-FLT_MAX);
+            for (const Vertex& vertex : mesh.vertices)
+            {
+                expectedMin = FloatOps::Min(expectedMin, vertex.position);
+                expectedMax = FloatOps::Max(expectedMax, vertex.position);
+            }
+
+            bool matches = true;
+            for (size_t chunkCount : { size_t(0), size_t(2), size_t(3), size_t(8) })
+            {
+                Float3 minPosition, maxPosition;
+                if (chunkCount == 0)
+                    ComputePositionBounds<FloatOps>(mesh.vertices.data(), mesh.vertices.size(), kMinVerticesPerThread, minPosition, maxPosition);
+                else
+                    ComputePositionBounds<FloatOps>(mesh.vertices.data(), mesh.vertices.size(), 1, minPosition, maxPosition, ThreadPerChunk{ chunkCount });
+                matches = matches && memcmp(&minPosition, &expectedMin, sizeof(Float3)) == 0 && memcmp(&maxPosition, &expectedMax, sizeof(Float3)) == 0;
+            }
+            printf("bounds: %zu vertices, folded from the pool and 2, 3 and 8 chunks, %s  %s\n", mesh.vertices.size(),
+                matches ? "equal to a serial walk" : "differ from a serial walk", matches ? "ok" : "FAILED");
+            passed = passed && matches;
+        }
+        return passed;
+    }
+
+    // Microseconds per call, the median of enough calls to fill minSeconds
+    double TimeCalls(double minSeconds, const std::function<void()>& call)
+    {
+        std::vector<double> samples;
+        const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(minSeconds);
+        while (samples.size() < 5 || std::chrono::steady_clock::now() < end)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            call();
+            samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+        return samples[samples.size() / 2];
+    }
+
+    // Microseconds per call of each kernel, run with each way of running the chunks
+    template<typename Chunks>
+    void TimeKernels(double minSeconds, TestMesh& mesh, Chunks chunks, double& transformUs, double& normalsUs, double& boundsUs)
+    {
+        const Float4x4 transform = { {
+            { 0.98f, -0.17f, 0.02f, 0.0f }, { 0.17f, 0.98f, -0.01f, 0.0f }, { -0.02f, 0.01f, 0.99f, 0.0f }, { 0.1f, -0.4f, 1.7f, 1.0f } } };
+        Vertex* pVertices = mesh.vertices.data();
+        const size_t vertexCount = mesh.vertices.size();
+        transformUs = TimeCalls(minSeconds, [&]()
+        {
+            TransformMeshVertices<FloatOps>(pVertices, vertexCount, transform, kMinVerticesPerThread, chunks);
+        });
+        normalsUs = TimeCalls(minSeconds, [&]()
+        {
+            AccumulateSmoothNormals<FloatOps>(pVertices, vertexCount, mesh.indices.data(), mesh.indices.size() / 3,
+                kMinVerticesPerThread, kMinTrianglesPerThread, chunks);
+        });
+        boundsUs = TimeCalls(minSeconds, [&]()
+        {
+            Float3 minPosition, maxPosition;
+            ComputePositionBounds<FloatOps>(pVertices, vertexCount, kMinVerticesPerThread, minPosition, maxPosition, chunks);
+        });
+    }
+
+    void Benchmark(double minSeconds)
+    {
+        printf("\n%-22s %10s %12s %12s %12s %9s\n", "benchmark", "vertices", "serial us", "spawn us", "pool us", "speedup");
+        for (size_t vertexCount : { size_t(1'000), size_t(10'000), size_t(100'000), size_t(1'000'000) })
+        {
+            TestMesh mesh = MakeMesh(vertexCount, 1);
+            double us[3][3];
+            TimeKernels(minSeconds, mesh, SerialChunks(), us[0][0], us[1][0], us[2][0]);
+            TimeKernels(minSeconds, mesh, ThreadPerChunk(), us[0][1], us[1][1], us[2][1]);
+            TimeKernels(minSeconds, mesh, PoolChunks(), us[0][2], us[1][2], us[2][2]);
+
+            const char* names[] = { "bake_transform", "smooth_normals", "bounding_box" };
+            for (int kernel = 0; kernel < 3; kernel++)
+            {
+                printf("%-22s %10zu %12.1f %12.1f %12.1f %8.2fx\n", names[kernel], mesh.vertices.size(),
+                    us[kernel][0], us[kernel][1], us[kernel][2], us[kernel][0] / us[kernel][2]);
+            }
+        }
+        printf("%u hardware threads, %zu pool workers\n", std::thread::hardware_concurrency(), ParallelForPool::Get().GetWorkerCount());
+    }
+
+    // The fixed cost of a parallel call on chunkCount chunks that do nothing, whatever the core count
+    void BenchmarkDispatch(double minSeconds, size_t chunkCount)
+    {
+        ParallelForPool pool(chunkCount - 1);
+        std::atomic<size_t> chunks{ 0 };
+        const double spawnUs = TimeCalls(minSeconds, [&]()
+        {
+            std::vector<std::thread> threads;
+            for (size_t chunkIndex = 1; chunkIndex < chunkCount; ++chunkIndex)
+                threads.emplace_back([&]() { chunks++; });
+            chunks++;
+            for (auto& thread : threads)
+                thread.join();
+        });
+        const double poolUs = TimeCalls(minSeconds, [&]()
+        {
+            pool.Run(chunkCount, [&](size_t) { chunks++; });
+        });
+        printf("%-22s %10zu chunks %13.1f %12.1f %8.2fx\n", "dispatch", chunkCount, spawnUs, poolUs, spawnUs / poolUs);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double minSeconds = 0.5;
+    size_t dispatchChunks = (std::max)(4u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--min-time" && i + 1 < argc)
+        {
+            minSeconds = atof(argv[++i]);
+        }
+        else if (arg == "--dispatch-chunks" && i + 1 < argc)
+        {
+            dispatchChunks = (std::max)(size_t(2), size_t(strtoul(argv[++i], nullptr, 10)));
+        }
+        else
+        {
+            printf("usage: ParallelForBenchmark [--min-time seconds] [--dispatch-chunks count]\n");
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    bool passed = CheckCoverage();
+    passed = CheckSmoothNormals() && passed;
+    passed = CheckBounds() && passed;
+    Benchmark(minSeconds);
+    printf("\n%-22s %17s %13s %12s %9s\n", "", "", "spawn us", "pool us", "speedup");
+    BenchmarkDispatch(minSeconds, dispatchChunks);
+    return passed ? 0 : 1;
+}
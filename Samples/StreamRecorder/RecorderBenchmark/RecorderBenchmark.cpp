@@ -0,0 +1,475 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Micro benchmarks of the StreamRecorder code that doesn't need the device: the tarball, the PGM encoding of
+// RMCameraReader, the clock conversions of TimeConverter, the rig2world / PV log lines and the head, hand and eye
+// records of HeTHaTEyeStream::DumpToDisk. Each benchmark reports
+// throughput, heap allocations per iteration and p50 / p99 / p99.9 latency, as a table and optionally as JSON.
+
+#include "AllocationCounter.h"
+#include "ClockDomain.h"
+#include "RMFrameEncoder.h"
+#include "RecorderLogWriters.h"
+#include "Tar.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct BenchmarkResult
+    {
+        std::string name;
+        uint64_t iterations = 0;
+        uint64_t bytesPerIteration = 0;
+        double totalSeconds = 0.0;
+        double allocationsPerIteration = 0.0;
+        double p50Us = 0.0;
+        double p99Us = 0.0;
+        double p999Us = 0.0;
+        double maxUs = 0.0;
+
+        double IterationsPerSecond() const { return iterations / totalSeconds; }
+        double MegabytesPerSecond() const { return bytesPerIteration * IterationsPerSecond() / 1e6; }
+    };
+
+    struct BenchmarkSettings
+    {
+        double minSeconds = 1.0;
+        uint64_t minIterations = 1000;  // Enough samples for a meaningful p99.9
+        uint64_t warmupIterations = 20;
+    };
+
+    // Runs body until both the minimum time and iteration count are reached, timing every iteration
+    BenchmarkResult Run(const std::string& name, uint64_t bytesPerIteration, const BenchmarkSettings& settings, const std::function<void()>& body)
+    {
+        for (uint64_t i = 0; i < settings.warmupIterations; ++i)
+        {
+            body();
+        }
+
+        std::vector<double> latencies;
+        latencies.reserve(settings.minIterations * 4);
+        uint64_t allocationCount = 0;
+        const auto start = std::chrono::steady_clock::now();
+        auto now = start;
+        while (latencies.size() < settings.minIterations || now - start < std::chrono::duration<double>(settings.minSeconds))
+        {
+            const uint64_t allocationsBefore = GetAllocationCount();
+            const auto iterationStart = std::chrono::steady_clock::now();
+            body();
+            now = std::chrono::steady_clock::now();
+            allocationCount += GetAllocationCount() - allocationsBefore;
+            latencies.push_back(std::chrono::duration<double, std::micro>(now - iterationStart).count());
+        }
+
+        BenchmarkResult result;
+        result.name = name;
+        result.iterations = latencies.size();
+        result.bytesPerIteration = bytesPerIteration;
+        result.totalSeconds = std::chrono::duration<double>(now - start).count();
+        result.allocationsPerIteration = double(allocationCount) / result.iterations;
+
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double p) { return latencies[std::min(latencies.size() - 1, size_t(p * latencies.size()))]; };
+        result.p50Us = percentile(0.5);
+        result.p99Us = percentile(0.99);
+        result.p999Us = percentile(0.999);
+        result.maxUs = latencies.back();
+        return result;
+    }
+
+    // Stands in for winrt::Windows::Foundation::Numerics::float4x4
+    struct Matrix4x4
+    {
+        float m11, m12, m13, m14;
+        float m21, m22, m23, m24;
+        float m31, m32, m33, m34;
+        float m41, m42, m43, m44;
+    };
+
+    // Stand in for the HeTHaTEyeStream frames, which need Cannon's hand joint types: same members, same file records
+    struct Float3
+    {
+        float x, y, z;
+    };
+
+    struct Float4
+    {
+        float x, y, z, w;
+    };
+
+    struct Pose
+    {
+        Float3 position;
+        Float4 orientation;
+    };
+
+    struct QuantizedPose
+    {
+        int16_t position[3];
+        int16_t orientation[4];
+    };
+
+    const size_t kJointsPerHand = 26;  // HandJointIndex::Count
+
+    struct HeadHandEyeFrame
+    {
+        long long timestamp;
+        Pose head;
+        std::array<Pose, kJointsPerHand> leftHand;
+        std::array<Pose, kJointsPerHand> rightHand;
+        Float3 eyeGazeOrigin;
+        Float3 eyeGazeDirection;
+        float eyeGazeDistance;
+        uint8_t presence;
+    };
+
+    struct QuantizedHeadHandEyeFrame
+    {
+        long long timestamp;
+        float eyeGazeDistance;
+        QuantizedPose head;
+        std::array<QuantizedPose, kJointsPerHand> leftHand;
+        std::array<QuantizedPose, kJointsPerHand> rightHand;
+        int16_t eyeGazeOrigin[3];
+        int16_t eyeGazeDirection[3];
+        uint8_t presence;
+    };
+
+    struct DepthFrame
+    {
+        uint32_t width;
+        uint32_t height;
+        bool isLongThrow;
+        std::vector<uint16_t> depth;
+        std::vector<uint16_t> ab;
+        std::vector<uint8_t> sigma;
+    };
+
+    DepthFrame MakeDepthFrame(uint32_t width, uint32_t height, bool isLongThrow, std::mt19937& random)
+    {
+        DepthFrame frame{ width, height, isLongThrow, {}, {}, {} };
+        const size_t pixelCount = size_t(width) * height;
+        frame.depth.resize(pixelCount);
+        frame.ab.resize(pixelCount);
+        frame.sigma.resize(isLongThrow ? pixelCount : 0);
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            frame.depth[i] = uint16_t(random() % (isLongThrow ? 4000 : 4096));
+            frame.ab[i] = uint16_t(random());
+            if (isLongThrow)
+            {
+                frame.sigma[i] = (random() % 20 == 0) ? 0x80 : 0;
+            }
+        }
+        return frame;
+    }
+
+    std::string JsonEscape(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    bool WriteJson(const std::filesystem::path& path, const std::vector<BenchmarkResult>& results)
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            return false;
+        }
+
+        const auto now = std::chrono::system_clock::now().time_since_epoch();
+        file << "{\n  \"timestamp\": " << std::chrono::duration_cast<std::chrono::seconds>(now).count() << ",\n";
+        file << "  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const BenchmarkResult& r = results[i];
+            file << "    {\"name\": \"" << JsonEscape(r.name) << "\""
+                << ", \"iterations\": " << r.iterations
+                << ", \"bytes_per_iteration\": " << r.bytesPerIteration
+                << ", \"iterations_per_second\": " << r.IterationsPerSecond()
+                << ", \"megabytes_per_second\": " << r.MegabytesPerSecond()
+                << ", \"allocations_per_iteration\": " << r.allocationsPerIteration
+                << ", \"p50_us\": " << r.p50Us
+                << ", \"p99_us\": " << r.p99Us
+                << ", \"p999_us\": " << r.p999Us
+                << ", \"max_us\": " << r.maxUs << "}"
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        file << "  ]\n}\n";
+        return !file.fail();
+    }
+
+    void PrintUsage()
+    {
+        printf(
+            "usage: RecorderBenchmark [--filter text] [--json path] [--output folder] [--min-time seconds] [--min-iterations n]\n"
+            "  --filter only runs the benchmarks whose name contains text.\n"
+            "  --output is where the tarball benchmarks write, by default the system temp folder.\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkSettings settings;
+    std::string filter;
+    std::filesystem::path jsonPath;
+    std::filesystem::path outputFolder = std::filesystem::temp_directory_path();
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--filter" && hasValue)
+        {
+            filter = argv[++i];
+        }
+        else if (arg == "--json" && hasValue)
+        {
+            jsonPath = argv[++i];
+        }
+        else if (arg == "--output" && hasValue)
+        {
+            outputFolder = argv[++i];
+        }
+        else if (arg == "--min-time" && hasValue)
+        {
+            settings.minSeconds = atof(argv[++i]);
+        }
+        else if (arg == "--min-iterations" && hasValue)
+        {
+            settings.minIterations = strtoull(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            PrintUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    // Io::Tarball asserts that its file opens
+    std::error_code error;
+    std::filesystem::create_directories(outputFolder, error);
+    if (error)
+    {
+        fprintf(stderr, "cannot create the output folder %s: %s\n", outputFolder.string().c_str(), error.message().c_str());
+        return 1;
+    }
+
+    std::vector<BenchmarkResult> results;
+    auto run = [&](const std::string& name, uint64_t bytesPerIteration, const std::function<void()>& body)
+    {
+        if (name.find(filter) == std::string::npos)
+        {
+            return;
+        }
+        results.push_back(Run(name, bytesPerIteration, settings, body));
+        const BenchmarkResult& r = results.back();
+        printf("%-32s %10.0f it/s %9.1f MB/s %7.2f allocs %9.2f %9.2f %9.2f us\n",
+            r.name.c_str(), r.IterationsPerSecond(), r.MegabytesPerSecond(), r.allocationsPerIteration, r.p50Us, r.p99Us, r.p999Us);
+    };
+
+    printf("%-32s %15s %14s %14s %9s %9s %9s\n", "benchmark", "rate", "throughput", "", "p50", "p99", "p99.9");
+
+    std::mt19937 random(1);
+    volatile uint64_t sink = 0;     // Keeps results of the pure computations alive
+
+    // Io::Tarball::AddFile, from metadata sized files to PV frames
+    {
+        const std::filesystem::path tarPath = outputFolder / "RecorderBenchmark.tar";
+        const std::vector<std::pair<const char*, size_t>> sizes = {
+            { "1KiB", 1 << 10 },
+            { "64KiB", 64 << 10 },
+            { "vlc_307KiB", 640 * 480 + 15 },
+            { "ahat_512KiB", 512 * 512 * 2 + 17 },
+            { "pv_1300KiB", 760 * 428 * 4 },
+            { "4MiB", 4 << 20 },
+        };
+        for (const auto& [sizeName, size] : sizes)
+        {
+            std::vector<uint8_t> data(size, 0x5a);
+            Io::Tarball tarball(tarPath.wstring());
+            uint64_t fileIndex = 0;
+            run(std::string("tar_add_file/") + sizeName, size, [&]
+            {
+                tarball.AddFile(std::to_wstring(fileIndex++) + L".pgm", data.data(), data.size());
+            });
+            tarball.Close();
+        }
+        std::error_code error;
+        std::filesystem::remove(tarPath, error);
+    }
+
+    run("pgm_header", 0, [&]
+    {
+        sink = sink + RMFrameEncoder::CreatePgmHeader(512, 512, 65535).size();
+    });
+
+    // RMCameraReader::SaveVLC and SaveDepth payloads, with the buffers reused as the reader does
+    {
+        std::vector<uint8_t> image(640 * 480);
+        for (uint8_t& pixel : image)
+        {
+            pixel = uint8_t(random());
+        }
+        std::vector<uint8_t> pgmData;
+        run("encode_vlc/640x480", image.size(), [&]
+        {
+            RMFrameEncoder::EncodeVlcPgm(640, 480, image.data(), image.size(), pgmData);
+        });
+    }
+
+    for (const DepthFrame& frame : { MakeDepthFrame(512, 512, false, random), MakeDepthFrame(320, 288, true, random) })
+    {
+        std::vector<uint8_t> depthPgmData;
+        std::vector<uint8_t> abPgmData;
+        const size_t pixelCount = frame.depth.size();
+        run(std::string(frame.isLongThrow ? "encode_depth/long_throw_320x288" : "encode_depth/ahat_512x512"), pixelCount * 4, [&]
+        {
+            RMFrameEncoder::EncodeDepthPgms(frame.width, frame.height, frame.isLongThrow, frame.depth.data(), frame.ab.data(),
+                frame.isLongThrow ? frame.sigma.data() : nullptr, pixelCount, depthPgmData, abPgmData);
+        });
+    }
+
+    // The whole per frame save of RMCameraReader: file names, encoding and both tarball entries
+    {
+        const std::filesystem::path tarPath = outputFolder / "RecorderBenchmark_depth.tar";
+        const DepthFrame frame = MakeDepthFrame(512, 512, false, random);
+        std::vector<uint8_t> depthPgmData;
+        std::vector<uint8_t> abPgmData;
+        Io::Tarball tarball(tarPath.wstring());
+        uint64_t ticks = 132'000'000'000'000'000;
+        run("save_depth_frame/ahat_512x512", frame.depth.size() * 4, [&]
+        {
+            const std::wstring name = std::to_wstring(ticks += 222'222);
+            RMFrameEncoder::EncodeDepthPgms(frame.width, frame.height, false, frame.depth.data(), frame.ab.data(), nullptr,
+                frame.depth.size(), depthPgmData, abPgmData);
+            tarball.AddFile(name + L"_ab.pgm", abPgmData.data(), abPgmData.size());
+            tarball.AddFile(name + L".pgm", depthPgmData.data(), depthPgmData.size());
+        });
+        tarball.Close();
+        std::error_code error;
+        std::filesystem::remove(tarPath, error);
+    }
+
+    // TimeConverter::RelativeTicksToAbsoluteTicks(QpcToRelativeTicks(qpc)) through the shared ClockDomain, fitted
+    // on a drifting clock, 1000 conversions per iteration
+    {
+        ClockDomain clockDomain(10'000'000);
+        for (int64_t second = 0; second < 16; second++)
+        {
+            clockDomain.AddSample(second * 10'000'000, 132'000'000'000'000'000 + second * 10'000'300);
+        }
+        std::vector<int64_t> qpcs(1000);
+        for (int64_t& qpc : qpcs)
+        {
+            qpc = int64_t(random()) * 4096;
+        }
+        run("time_converter/1000", 0, [&]
+        {
+            int64_t total = 0;
+            for (int64_t qpc : qpcs)
+            {
+                total += clockDomain.RelativeTicksToAbsoluteTicks(clockDomain.QpcToRelativeTicks(qpc)).count();
+            }
+            sink = sink + uint64_t(total);
+        });
+    }
+
+    // Metadata logs, one line per frame as DumpFrameLocations and DumpDataToDisk write them
+    {
+        const std::filesystem::path logPath = outputFolder / "RecorderBenchmark_log.txt";
+        Matrix4x4 transform = { 0.98f, -0.17f, 0.02f, 0.0f, 0.17f, 0.98f, -0.01f, 0.0f, -0.02f, 0.01f, 0.99f, 0.0f, 0.123f, -0.456f, 1.789f, 1.0f };
+        long long timestamp = 132'000'000'000'000'000;
+
+        std::ofstream rig2worldFile(logPath);
+        run("log_line/rig2world", 0, [&]
+        {
+            RecorderLog::WriteRig2WorldLine(rig2worldFile, timestamp += 333'333, transform);
+        });
+        rig2worldFile.close();
+
+        std::ofstream pvFile(logPath);
+        run("log_line/pv", 0, [&]
+        {
+            RecorderLog::WritePVFrameLine(pvFile, timestamp += 333'333, 1480.5f, 1479.25f, transform);
+        });
+        pvFile.close();
+
+        std::error_code error;
+        std::filesystem::remove(logPath, error);
+    }
+
+    // HeTHaTEyeStream::DumpToDisk, one frame of both hands and the eye gaze per iteration, without and with quantization
+    {
+        const std::filesystem::path logPath = outputFolder / "RecorderBenchmark_head_hand_eye.bin";
+        HeadHandEyeFrame frame = {};
+        QuantizedHeadHandEyeFrame quantizedFrame = {};
+        for (size_t joint = 0; joint < kJointsPerHand; joint++)
+        {
+            frame.leftHand[joint] = { { 0.1f * joint, 1.5f, -0.3f }, { 0.0f, 0.38f, 0.0f, 0.92f } };
+            frame.rightHand[joint] = { { -0.1f * joint, 1.5f, -0.3f }, { 0.0f, -0.38f, 0.0f, 0.92f } };
+            quantizedFrame.leftHand[joint] = { { int16_t(205 * joint), 3072, -614 }, { 0, 12452, 0, 30146 } };
+            quantizedFrame.rightHand[joint] = { { int16_t(-205 * int(joint)), 3072, -614 }, { 0, -12452, 0, 30146 } };
+        }
+        frame.presence = quantizedFrame.presence = 7;
+        frame.timestamp = quantizedFrame.timestamp = 132'000'000'000'000'000;
+        const uint64_t frameBytes = 8 + 4 + (2 * kJointsPerHand + 1) * 28 + 2 * 12 + 4;
+        const uint64_t quantizedFrameBytes = 8 + 4 + (2 * kJointsPerHand + 1) * 14 + 2 * 6 + 4;
+
+        std::ofstream file(logPath, std::ios::binary);
+        RecorderLog::WriteHeadHandEyeHeader(file, 1, false, uint32_t(kJointsPerHand), Float3{ 0.0f, 0.0f, 0.0f }, 1.0f / 2048.0f);
+        run("head_hand_eye_frame/float", frameBytes, [&]
+        {
+            frame.timestamp += 166'667;
+            RecorderLog::WriteHeadHandEyeFrame(file, frame);
+        });
+        file.close();
+
+        std::ofstream quantizedFile(logPath, std::ios::binary);
+        RecorderLog::WriteHeadHandEyeHeader(quantizedFile, 1, true, uint32_t(kJointsPerHand), Float3{ 30.0f, -1.5f, 20.0f }, 1.0f / 2048.0f);
+        run("head_hand_eye_frame/quantized", quantizedFrameBytes, [&]
+        {
+            quantizedFrame.timestamp += 166'667;
+            RecorderLog::WriteHeadHandEyeFrame(quantizedFile, quantizedFrame);
+        });
+        quantizedFile.close();
+
+        std::error_code error;
+        std::filesystem::remove(logPath, error);
+    }
+
+    if (!jsonPath.empty() && !WriteJson(jsonPath, results))
+    {
+        fprintf(stderr, "Can't write %s\n", jsonPath.string().c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,828 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Headless load test of the StreamRecorder write path. Synthetic Research Mode sensors feed one recorder per stream,
+// which keeps the latest frame like RMCameraReader and saves it with the same encoder and Io::Tarball. At the end
+// it reports how many frames each stream delivered and saved; with --unpaced the sensors deliver as fast as they're
+// read and the saved rate is the sustainable rate of the machine. With --pose-latency the saved frames' poses are
+// looked up by an AsyncPoseResolver, as in RMCameraReader, from a stand-in locator that takes that long per lookup.
+// --writers picks how frames get to disk: the app's shared WriterPool, or one write thread per stream, either waiting
+// for frames or polling for them like the recorder did before the pool. The CPU time of the whole run is reported
+// with the drop rate, to compare them.
+
+#include "AsyncPoseResolver.h"
+#include "ResearchModeReplay.h"
+#include "RMFrameEncoder.h"
+#include "Tar.h"
+#include "WriterPool.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace ResearchModeReplay;
+
+namespace
+{
+    struct StreamStats
+    {
+        uint64_t deliveredFrames = 0;
+        uint64_t savedFrames = 0;
+        uint64_t savedBytes = 0;
+        double totalWriteSeconds = 0.0;
+        double maxWriteSeconds = 0.0;
+        uint64_t resolvedPoses = 0;
+        uint64_t poseErrors = 0;        // Poses missing, out of order or not matching their frame
+        double maxPoseLagSeconds = 0.0;
+    };
+
+    struct PoseLatency
+    {
+        double minMs = 0.0;
+        double maxMs = 0.0;
+    };
+
+    enum class WriterModel
+    {
+        Pool,       // Saves posted to a WriterPool::Stream, as the app does
+        Dedicated,  // A write thread per stream, woken up for each frame
+        Polling     // A write thread per stream checking for new frames in a loop, as RMCameraReader used to
+    };
+
+    using RigPose = std::array<float, 16>;
+
+    // What the stand-in locator returns for a frame: a translation along x by the frame's time, so every resolved
+    // pose can be matched back to its frame
+    RigPose MakeExpectedPose(uint64_t relativeTicks)
+    {
+        RigPose pose{};
+        pose[0] = pose[5] = pose[10] = pose[15] = 1.0f;
+        pose[12] = float(double(relativeTicks % 10000000000ull) * 1e-7);
+        return pose;
+    }
+
+    class StreamRecorder
+    {
+    public:
+        // Without a writer pool every stream gets its own write thread
+        StreamRecorder(const SyntheticSensorOptions& options, const std::filesystem::path& outputFolder, const PoseLatency* pPoseLatency,
+                       WriterPool* pWriterPool, bool pollForFrames) :
+            m_options(options),
+            m_pollForFrames(pollForFrames),
+            m_random(options.seed)
+        {
+            if (FAILED(CreateSyntheticSensor(options, &m_pSensor)))
+            {
+                m_pSensor = nullptr;
+                return;
+            }
+            m_tarball = std::make_unique<Io::Tarball>((outputFolder / (options.friendlyName + L".tar")).wstring());
+
+            if (pPoseLatency)
+            {
+                m_poseLatency = std::uniform_real_distribution<double>(pPoseLatency->minMs, pPoseLatency->maxMs);
+                m_poseResolver = std::make_unique<AsyncPoseResolver<RigPose>>(
+                    [this](uint64_t relativeTicks, RigPose& pose) { return LocateRig(relativeTicks, pose); });
+            }
+
+            if (pWriterPool)
+            {
+                m_writerStream = pWriterPool->CreateStream();
+            }
+        }
+
+        ~StreamRecorder()
+        {
+            Stop();
+            if (m_pSensor)
+            {
+                m_pSensor->Release();
+            }
+        }
+
+        bool IsValid() const { return m_pSensor != nullptr; }
+        const SyntheticSensorOptions& GetOptions() const { return m_options; }
+
+        void Start()
+        {
+            m_pSensor->OpenStream();
+            m_updateThread = std::thread(UpdateThread, this);
+            if (!m_writerStream)
+            {
+                m_writeThread = std::thread(m_pollForFrames ? PollingWriteThread : WriteThread, this);
+            }
+        }
+
+        void Stop()
+        {
+            if (!m_updateThread.joinable())
+            {
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> guard(m_frameMutex);
+                m_fExit = true;
+            }
+            m_frameCondVar.notify_all();
+            m_pSensor->CloseStream();
+            m_updateThread.join();
+            if (m_writerStream)
+            {
+                m_writerStream.reset();
+            }
+            else
+            {
+                m_writeThread.join();
+            }
+
+            if (m_pLatestFrame)
+            {
+                m_pLatestFrame->Release();
+                m_pLatestFrame = nullptr;
+            }
+            m_tarball->Close();
+        }
+
+        // Waits for the poses lagging behind and joins them with the saved frames, as RMCameraReader::ResetStorageFolder does
+        void JoinPoses()
+        {
+            if (m_poseResolver)
+            {
+                m_poseResolver->Flush();
+                CheckResolvedPoses(m_poseResolver->TakeResolvedPoses());
+            }
+        }
+
+        StreamStats GetStats()
+        {
+            std::lock_guard<std::mutex> guard(m_frameMutex);
+            return m_stats;
+        }
+
+    private:
+        static void UpdateThread(StreamRecorder* pRecorder)
+        {
+            const bool unpaced = pRecorder->m_options.mode == PlaybackMode::AsFastAsPossible;
+            while (!pRecorder->m_fExit)
+            {
+                if (unpaced)
+                {
+                    // Nothing would pace the sensor, only fetch a frame once the last one is being saved
+                    std::unique_lock<std::mutex> lock(pRecorder->m_frameMutex);
+                    pRecorder->m_frameCondVar.wait(lock, [&] { return pRecorder->m_fExit || pRecorder->m_latestFrameTaken; });
+                }
+
+                IResearchModeSensorFrame* pSensorFrame = nullptr;
+                if (FAILED(pRecorder->m_pSensor->GetNextBuffer(&pSensorFrame)))
+                {
+                    break;
+                }
+
+                // Latest frame wins, as in RMCameraReader::CameraUpdateThread
+                {
+                    std::lock_guard<std::mutex> guard(pRecorder->m_frameMutex);
+                    if (pRecorder->m_pLatestFrame)
+                    {
+                        pRecorder->m_pLatestFrame->Release();
+                    }
+                    pRecorder->m_pLatestFrame = pSensorFrame;
+                    pRecorder->m_latestFrameTaken = false;
+                    pRecorder->m_stats.deliveredFrames++;
+                }
+                pRecorder->m_frameCondVar.notify_all();
+
+                // As RMCameraReader, a save still waiting in the stream will pick this frame up
+                if (pRecorder->m_writerStream && !pRecorder->m_saveQueued.exchange(true))
+                {
+                    pRecorder->m_writerStream->Post([pRecorder]() { pRecorder->SaveLatestFrame(); });
+                }
+            }
+        }
+
+        // Unlike RMCameraReader the frame is saved outside the lock, so a slow write drops frames instead of
+        // delaying the sensor, which is what the device's sensor buffer does
+        static void WriteThread(StreamRecorder* pRecorder)
+        {
+            while (true)
+            {
+                IResearchModeSensorFrame* pSensorFrame = nullptr;
+                {
+                    std::unique_lock<std::mutex> lock(pRecorder->m_frameMutex);
+                    pRecorder->m_frameCondVar.wait(lock, [&] { return pRecorder->m_fExit || pRecorder->HasNewFrame(); });
+                    if (pRecorder->m_fExit)
+                    {
+                        break;
+                    }
+                    pSensorFrame = pRecorder->TakeLatestFrame();
+                }
+                pRecorder->m_frameCondVar.notify_all();
+                pRecorder->SaveTakenFrame(pSensorFrame);
+            }
+        }
+
+        static void PollingWriteThread(StreamRecorder* pRecorder)
+        {
+            while (!pRecorder->m_fExit)
+            {
+                IResearchModeSensorFrame* pSensorFrame = nullptr;
+                {
+                    std::lock_guard<std::mutex> guard(pRecorder->m_frameMutex);
+                    if (pRecorder->HasNewFrame())
+                    {
+                        pSensorFrame = pRecorder->TakeLatestFrame();
+                    }
+                }
+                if (pSensorFrame)
+                {
+                    pRecorder->m_frameCondVar.notify_all();
+                    pRecorder->SaveTakenFrame(pSensorFrame);
+                }
+            }
+        }
+
+        // Runs on the writer pool
+        void SaveLatestFrame()
+        {
+            m_saveQueued = false;
+            IResearchModeSensorFrame* pSensorFrame = nullptr;
+            {
+                std::lock_guard<std::mutex> guard(m_frameMutex);
+                if (m_fExit || !HasNewFrame())
+                {
+                    return;
+                }
+                pSensorFrame = TakeLatestFrame();
+            }
+            m_frameCondVar.notify_all();
+            SaveTakenFrame(pSensorFrame);
+        }
+
+        // Expects m_frameMutex to be held, the caller gets its own reference
+        IResearchModeSensorFrame* TakeLatestFrame()
+        {
+            m_pLatestFrame->AddRef();
+            m_latestFrameTaken = true;
+            ResearchModeSensorTimestamp timestamp;
+            m_pLatestFrame->GetTimeStamp(&timestamp);
+            m_savedTimestamp = timestamp.HostTicks;
+            return m_pLatestFrame;
+        }
+
+        void SaveTakenFrame(IResearchModeSensorFrame* pSensorFrame)
+        {
+            ResearchModeSensorTimestamp timestamp;
+            pSensorFrame->GetTimeStamp(&timestamp);
+
+            const auto start = std::chrono::steady_clock::now();
+            if (m_poseResolver)
+            {
+                {
+                    std::lock_guard<std::mutex> guard(m_poseMutex);
+                    m_poseSubmitTimes.push_back(start);
+                    m_savedTimestamps.push_back(timestamp.HostTicks);
+                }
+                m_poseResolver->Submit(timestamp.HostTicks, (long long)timestamp.HostTicks);
+            }
+            const size_t savedBytes = SaveFrame(pSensorFrame, timestamp.HostTicks);
+            const double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            pSensorFrame->Release();
+
+            std::lock_guard<std::mutex> guard(m_frameMutex);
+            m_stats.savedFrames++;
+            m_stats.savedBytes += savedBytes;
+            m_stats.totalWriteSeconds += writeSeconds;
+            m_stats.maxWriteSeconds = (std::max)(m_stats.maxWriteSeconds, writeSeconds);
+        }
+
+        // Expects m_frameMutex to be held
+        bool HasNewFrame() const
+        {
+            if (!m_pLatestFrame)
+            {
+                return false;
+            }
+            ResearchModeSensorTimestamp timestamp;
+            m_pLatestFrame->GetTimeStamp(&timestamp);
+            return timestamp.HostTicks != m_savedTimestamp;
+        }
+
+        // Stand-in for SpatialLocator::TryLocateAtTimestamp, runs on the resolver's thread.
+        // Lookups are answered in submission order, so the front submit time is this frame's.
+        bool LocateRig(uint64_t relativeTicks, RigPose& pose)
+        {
+            std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(m_poseLatency(m_random)));
+            pose = MakeExpectedPose(relativeTicks);
+
+            std::lock_guard<std::mutex> guard(m_poseMutex);
+            const double lagSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_poseSubmitTimes.front()).count();
+            m_poseSubmitTimes.pop_front();
+
+            std::lock_guard<std::mutex> statsGuard(m_frameMutex);
+            m_stats.resolvedPoses++;
+            m_stats.maxPoseLagSeconds = (std::max)(m_stats.maxPoseLagSeconds, lagSeconds);
+            return true;
+        }
+
+        void CheckResolvedPoses(const std::vector<AsyncPoseResolver<RigPose>::ResolvedPose>& poses)
+        {
+            uint64_t poseErrors = 0;
+            if (poses.size() != m_savedTimestamps.size())
+            {
+                poseErrors += poses.size() > m_savedTimestamps.size() ? poses.size() - m_savedTimestamps.size() : m_savedTimestamps.size() - poses.size();
+            }
+            for (size_t i = 0; i < (std::min)(poses.size(), m_savedTimestamps.size()); ++i)
+            {
+                const uint64_t timestamp = m_savedTimestamps[i];
+                if (poses[i].timestamp != (long long)timestamp || poses[i].pose != MakeExpectedPose(timestamp))
+                {
+                    poseErrors++;
+                }
+            }
+
+            std::lock_guard<std::mutex> guard(m_frameMutex);
+            m_stats.poseErrors = poseErrors;
+        }
+
+        // Same payloads and file names as RMCameraReader::SaveVLC / SaveDepth and VideoFrameProcessor::DumpFrame
+        size_t SaveFrame(IResearchModeSensorFrame* pSensorFrame, uint64_t timestamp)
+        {
+            ResearchModeSensorResolution resolution;
+            pSensorFrame->GetResolution(&resolution);
+            const std::wstring ticks = std::to_wstring(timestamp);
+
+            IResearchModeSensorDepthFrame* pDepthFrame = nullptr;
+            if (SUCCEEDED(pSensorFrame->QueryInterface(IID_PPV_ARGS(&pDepthFrame))))
+            {
+                const UINT16* pDepth = nullptr;
+                const UINT16* pAbImage = nullptr;
+                const BYTE* pSigma = nullptr;
+                size_t depthCount = 0;
+                size_t abCount = 0;
+                size_t sigmaCount = 0;
+                pDepthFrame->GetBuffer(&pDepth, &depthCount);
+                pDepthFrame->GetAbDepthBuffer(&pAbImage, &abCount);
+                const bool isLongThrow = m_options.sensorType == DEPTH_LONG_THROW;
+                if (isLongThrow)
+                {
+                    pDepthFrame->GetSigmaBuffer(&pSigma, &sigmaCount);
+                }
+                pDepthFrame->Release();
+
+                RMFrameEncoder::EncodeDepthPgms(resolution.Width, resolution.Height, isLongThrow, pDepth, pAbImage, pSigma, depthCount, m_depthPgmData, m_abPgmData);
+                m_tarball->AddFile(ticks + L"_ab.pgm", m_abPgmData.data(), m_abPgmData.size());
+                m_tarball->AddFile(ticks + L".pgm", m_depthPgmData.data(), m_depthPgmData.size());
+                return m_abPgmData.size() + m_depthPgmData.size();
+            }
+
+            IResearchModeSensorVLCFrame* pVLCFrame = nullptr;
+            if (FAILED(pSensorFrame->QueryInterface(IID_PPV_ARGS(&pVLCFrame))))
+            {
+                return 0;
+            }
+            const BYTE* pImage = nullptr;
+            size_t imageSize = 0;
+            pVLCFrame->GetBuffer(&pImage, &imageSize);
+            pVLCFrame->Release();
+
+            if (m_options.pixelFormat == SyntheticPixelFormat::Bgra8)
+            {
+                // PV frames are stored as raw bitmap bytes
+                m_tarball->AddFile(ticks + L".bytes", pImage, imageSize);
+                return imageSize;
+            }
+
+            RMFrameEncoder::EncodeVlcPgm(resolution.Width, resolution.Height, pImage, imageSize, m_vlcPgmData);
+            m_tarball->AddFile(ticks + L".pgm", m_vlcPgmData.data(), m_vlcPgmData.size());
+            return m_vlcPgmData.size();
+        }
+
+        const SyntheticSensorOptions m_options;
+        const bool m_pollForFrames;
+        IResearchModeSensor* m_pSensor = nullptr;
+        std::unique_ptr<Io::Tarball> m_tarball;
+
+        std::mutex m_frameMutex;    // Guards m_pLatestFrame, m_latestFrameTaken, m_savedTimestamp, m_fExit and m_stats
+        std::condition_variable m_frameCondVar;
+        IResearchModeSensorFrame* m_pLatestFrame = nullptr;
+        bool m_latestFrameTaken = true;     // The write thread holds its own reference to m_pLatestFrame
+        uint64_t m_savedTimestamp = 0;
+        std::atomic<bool> m_fExit{ false };
+        StreamStats m_stats;
+
+        // Only used by the write thread, or the save jobs which the writer stream runs one at a time
+        std::vector<uint8_t> m_vlcPgmData;
+        std::vector<uint8_t> m_depthPgmData;
+        std::vector<uint8_t> m_abPgmData;
+
+        // Only set with --pose-latency. The random latency is only used by the resolver's thread.
+        std::unique_ptr<AsyncPoseResolver<RigPose>> m_poseResolver;
+        std::mt19937 m_random;
+        std::uniform_real_distribution<double> m_poseLatency;
+        std::mutex m_poseMutex;     // Guards m_poseSubmitTimes and m_savedTimestamps
+        std::deque<std::chrono::steady_clock::time_point> m_poseSubmitTimes;
+        std::vector<uint64_t> m_savedTimestamps;
+
+        std::thread m_updateThread;
+        std::thread m_writeThread;
+        std::unique_ptr<WriterPool::Stream> m_writerStream;
+        std::atomic<bool> m_saveQueued{ false };
+    };
+
+    // User and kernel time of all the process' threads
+    double GetProcessCpuSeconds()
+    {
+#ifdef _WIN32
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime);
+        auto toSeconds = [](const FILETIME& time) { return ((uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 1e-7; };
+        return toSeconds(kernelTime) + toSeconds(userTime);
+#else
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+    }
+
+    bool ParseCores(const std::string& text, std::vector<unsigned>& cores)
+    {
+        std::stringstream stream(text);
+        std::string field;
+        while (std::getline(stream, field, ','))
+        {
+            if (field.empty() || field.find_first_not_of("0123456789") != std::string::npos)
+            {
+                return false;
+            }
+            cores.push_back(unsigned(atoi(field.c_str())));
+        }
+        return !cores.empty();
+    }
+
+    SyntheticSensorOptions MakeStream(const std::wstring& name, ResearchModeSensorType sensorType, SyntheticPixelFormat pixelFormat, uint32_t width, uint32_t height, double fps)
+    {
+        SyntheticSensorOptions options;
+        options.friendlyName = name;
+        options.sensorType = sensorType;
+        options.pixelFormat = pixelFormat;
+        options.width = width;
+        options.height = height;
+        options.fps = fps;
+        return options;
+    }
+
+    // The streams StreamRecorder captures with every sensor enabled
+    std::vector<SyntheticSensorOptions> GetHoloLensPreset()
+    {
+        return {
+            MakeStream(L"Depth AHaT", DEPTH_AHAT, SyntheticPixelFormat::Depth16, 512, 512, 45.0),
+            MakeStream(L"VLC LF", LEFT_FRONT, SyntheticPixelFormat::Gray8, 640, 480, 30.0),
+            MakeStream(L"VLC LL", LEFT_LEFT, SyntheticPixelFormat::Gray8, 640, 480, 30.0),
+            MakeStream(L"VLC RF", RIGHT_FRONT, SyntheticPixelFormat::Gray8, 640, 480, 30.0),
+            MakeStream(L"VLC RR", RIGHT_RIGHT, SyntheticPixelFormat::Gray8, 640, 480, 30.0),
+            MakeStream(L"PV", LEFT_FRONT, SyntheticPixelFormat::Bgra8, 760, 428, 30.0),
+        };
+    }
+
+    // name,format,WIDTHxHEIGHT,fps[,jitterMs[,burstLength]] with format one of vlc, pv, ahat, longthrow
+    bool ParseStream(const std::string& text, SyntheticSensorOptions& options)
+    {
+        std::vector<std::string> fields;
+        std::stringstream stream(text);
+        std::string field;
+        while (std::getline(stream, field, ','))
+        {
+            fields.push_back(field);
+        }
+        if (fields.size() < 4 || fields.size() > 6)
+        {
+            return false;
+        }
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        if (sscanf(fields[2].c_str(), "%ux%u", &width, &height) != 2)
+        {
+            return false;
+        }
+
+        const std::wstring name(fields[0].begin(), fields[0].end());
+        const double fps = atof(fields[3].c_str());
+        if (fields[1] == "vlc")
+        {
+            options = MakeStream(name, LEFT_FRONT, SyntheticPixelFormat::Gray8, width, height, fps);
+        }
+        else if (fields[1] == "pv")
+        {
+            options = MakeStream(name, LEFT_FRONT, SyntheticPixelFormat::Bgra8, width, height, fps);
+        }
+        else if (fields[1] == "ahat")
+        {
+            options = MakeStream(name, DEPTH_AHAT, SyntheticPixelFormat::Depth16, width, height, fps);
+        }
+        else if (fields[1] == "longthrow")
+        {
+            options = MakeStream(name, DEPTH_LONG_THROW, SyntheticPixelFormat::Depth16, width, height, fps);
+        }
+        else
+        {
+            return false;
+        }
+
+        if (fields.size() > 4)
+        {
+            options.jitterMs = atof(fields[4].c_str());
+        }
+        if (fields.size() > 5)
+        {
+            options.burstLength = uint32_t(atoi(fields[5].c_str()));
+        }
+        return true;
+    }
+
+    bool ParseDepthPattern(const std::string& text, SyntheticDepthPattern& pattern)
+    {
+        if (text == "plane")
+        {
+            pattern = SyntheticDepthPattern::Plane;
+        }
+        else if (text == "ramp")
+        {
+            pattern = SyntheticDepthPattern::Ramp;
+        }
+        else if (text == "sphere")
+        {
+            pattern = SyntheticDepthPattern::Sphere;
+        }
+        else if (text == "noise")
+        {
+            pattern = SyntheticDepthPattern::Noise;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    void PrintUsage()
+    {
+        printf(
+            "usage: RecorderStressTest [--preset hololens] [--stream name,format,WxH,fps[,jitterMs[,burst]]]...\n"
+            "                          [--pattern plane|ramp|sphere|noise] [--duration seconds] [--output folder] [--unpaced]\n"
+            "                          [--pose-latency minMs[,maxMs]] [--writers pool|dedicated|polling] [--writer-threads count]\n"
+            "                          [--pin core[,core]...]\n"
+            "  format is vlc, pv, ahat or longthrow. Without --stream the hololens preset is used.\n"
+            "  --unpaced delivers frames as fast as they're read, the saved fps is then the sustainable rate.\n"
+            "  --pose-latency resolves each saved frame's pose on a separate thread, with a locator taking that long.\n"
+            "  --writers pool (the default) shares --writer-threads threads (2) between all streams, pinned with --pin.\n"
+            "  dedicated and polling give each stream its own write thread, polling checks for frames in a loop.\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<SyntheticSensorOptions> streams;
+    SyntheticDepthPattern depthPattern = SyntheticDepthPattern::Sphere;
+    bool usePattern = false;
+    double durationSeconds = 10.0;
+    std::filesystem::path outputFolder = "stress_output";
+    bool unpaced = false;
+    PoseLatency poseLatency;
+    bool resolvePoses = false;
+    WriterModel writerModel = WriterModel::Pool;
+    WriterPoolOptions writerPoolOptions;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--preset" && hasValue && std::string(argv[i + 1]) == "hololens")
+        {
+            const auto preset = GetHoloLensPreset();
+            streams.insert(streams.end(), preset.begin(), preset.end());
+            ++i;
+        }
+        else if (arg == "--stream" && hasValue)
+        {
+            SyntheticSensorOptions options;
+            if (!ParseStream(argv[++i], options))
+            {
+                fprintf(stderr, "Invalid stream: %s\n", argv[i]);
+                return 1;
+            }
+            streams.push_back(options);
+        }
+        else if (arg == "--pattern" && hasValue)
+        {
+            if (!ParseDepthPattern(argv[++i], depthPattern))
+            {
+                fprintf(stderr, "Invalid depth pattern: %s\n", argv[i]);
+                return 1;
+            }
+            usePattern = true;
+        }
+        else if (arg == "--duration" && hasValue)
+        {
+            durationSeconds = atof(argv[++i]);
+        }
+        else if (arg == "--output" && hasValue)
+        {
+            outputFolder = argv[++i];
+        }
+        else if (arg == "--unpaced")
+        {
+            unpaced = true;
+        }
+        else if (arg == "--pose-latency" && hasValue)
+        {
+            const int fieldCount = sscanf(argv[++i], "%lf,%lf", &poseLatency.minMs, &poseLatency.maxMs);
+            if (fieldCount < 1 || poseLatency.minMs < 0.0)
+            {
+                fprintf(stderr, "Invalid pose latency: %s\n", argv[i]);
+                return 1;
+            }
+            if (fieldCount == 1 || poseLatency.maxMs < poseLatency.minMs)
+            {
+                poseLatency.maxMs = poseLatency.minMs;
+            }
+            resolvePoses = true;
+        }
+        else if (arg == "--writers" && hasValue)
+        {
+            const std::string model = argv[++i];
+            if (model == "pool")
+            {
+                writerModel = WriterModel::Pool;
+            }
+            else if (model == "dedicated")
+            {
+                writerModel = WriterModel::Dedicated;
+            }
+            else if (model == "polling")
+            {
+                writerModel = WriterModel::Polling;
+            }
+            else
+            {
+                fprintf(stderr, "Invalid writers: %s\n", model.c_str());
+                return 1;
+            }
+        }
+        else if (arg == "--writer-threads" && hasValue)
+        {
+            writerPoolOptions.threadCount = unsigned((std::max)(atoi(argv[++i]), 1));
+        }
+        else if (arg == "--pin" && hasValue)
+        {
+            if (!ParseCores(argv[++i], writerPoolOptions.cores))
+            {
+                fprintf(stderr, "Invalid cores: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else
+        {
+            PrintUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (streams.empty())
+    {
+        streams = GetHoloLensPreset();
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(outputFolder, error);
+
+    // Declared first, so it outlives the recorders' streams
+    std::unique_ptr<WriterPool> writerPool;
+    if (writerModel == WriterModel::Pool)
+    {
+        writerPool = std::make_unique<WriterPool>(writerPoolOptions);
+    }
+
+    std::vector<std::unique_ptr<StreamRecorder>> recorders;
+    for (size_t i = 0; i < streams.size(); ++i)
+    {
+        SyntheticSensorOptions& options = streams[i];
+        options.mode = unpaced ? PlaybackMode::AsFastAsPossible : PlaybackMode::RealTime;
+        options.seed = uint32_t(i + 1);
+        if (usePattern)
+        {
+            options.depthPattern = depthPattern;
+        }
+
+        auto recorder = std::make_unique<StreamRecorder>(options, outputFolder, resolvePoses ? &poseLatency : nullptr,
+            writerPool.get(), writerModel == WriterModel::Polling);
+        if (!recorder->IsValid())
+        {
+            fprintf(stderr, "Can't create stream %ls\n", options.friendlyName.c_str());
+            return 1;
+        }
+        recorders.push_back(std::move(recorder));
+    }
+
+    const char* writerNames[] = { "a pool of", "dedicated", "polling" };
+    const unsigned writerThreadCount = writerPool ? writerPool->GetThreadCount() : unsigned(recorders.size());
+    printf("Recording %zu streams for %.1f s into %s%s, with %s %u write threads\n", recorders.size(), durationSeconds, outputFolder.string().c_str(),
+        unpaced ? ", unpaced" : "", writerNames[static_cast<int>(writerModel)], writerThreadCount);
+
+    const double startCpuSeconds = GetProcessCpuSeconds();
+    const auto start = std::chrono::steady_clock::now();
+    for (auto& recorder : recorders)
+    {
+        recorder->Start();
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(durationSeconds));
+    for (auto& recorder : recorders)
+    {
+        recorder->Stop();
+    }
+    const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double cpuSeconds = GetProcessCpuSeconds() - startCpuSeconds;
+    for (auto& recorder : recorders)
+    {
+        recorder->JoinPoses();
+    }
+
+    printf("\n%-18s %10s %10s %10s %10s %10s %10s %10s %10s\n", "stream", "target fps", "delivered", "saved", "dropped", "saved fps", "MB/s", "write ms", "max ms");
+    double totalBytes = 0.0;
+    uint64_t totalDelivered = 0;
+    uint64_t totalSaved = 0;
+    for (auto& recorder : recorders)
+    {
+        const SyntheticSensorOptions& options = recorder->GetOptions();
+        const StreamStats stats = recorder->GetStats();
+        const double savedFps = stats.savedFrames / elapsedSeconds;
+        const double meanWriteMs = stats.savedFrames > 0 ? 1000.0 * stats.totalWriteSeconds / stats.savedFrames : 0.0;
+        totalBytes += double(stats.savedBytes);
+        totalDelivered += stats.deliveredFrames;
+        totalSaved += stats.savedFrames;
+
+        char targetFps[16];
+        snprintf(targetFps, sizeof(targetFps), unpaced ? "-" : "%.1f", options.fps);
+        printf("%-18ls %10s %10llu %10llu %10llu %10.1f %10.1f %10.2f %10.2f\n",
+            options.friendlyName.c_str(),
+            targetFps,
+            (unsigned long long)stats.deliveredFrames,
+            (unsigned long long)stats.savedFrames,
+            (unsigned long long)(stats.deliveredFrames - stats.savedFrames),
+            savedFps,
+            stats.savedBytes / elapsedSeconds / 1e6,
+            meanWriteMs,
+            1000.0 * stats.maxWriteSeconds);
+    }
+    printf("\nTotal %.1f MB/s, %.1f%% of the delivered frames dropped\n", totalBytes / elapsedSeconds / 1e6,
+        totalDelivered > 0 ? 100.0 * (totalDelivered - totalSaved) / totalDelivered : 0.0);
+    // 100% is one core kept busy
+    printf("CPU %.2f s, %.0f%% of a core\n", cpuSeconds, 100.0 * cpuSeconds / elapsedSeconds);
+
+    if (!resolvePoses)
+    {
+        return 0;
+    }
+
+    // Lag is from the frame's save to its pose lookup, the write thread never waits for it
+    uint64_t totalPoseErrors = 0;
+    printf("\n%-18s %10s %10s %10s\n", "stream", "poses", "errors", "max lag ms");
+    for (auto& recorder : recorders)
+    {
+        const StreamStats stats = recorder->GetStats();
+        totalPoseErrors += stats.poseErrors;
+        printf("%-18ls %10llu %10llu %10.1f\n",
+            recorder->GetOptions().friendlyName.c_str(),
+            (unsigned long long)stats.resolvedPoses,
+            (unsigned long long)stats.poseErrors,
+            1000.0 * stats.maxPoseLagSeconds);
+    }
+    return totalPoseErrors == 0 ? 0 : 1;
+}
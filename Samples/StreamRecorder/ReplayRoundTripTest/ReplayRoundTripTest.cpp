@@ -0,0 +1,638 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Records known frames the way RMCameraReader does (RMFrameEncoder into an Io::Tarball, named after their absolute
+// ticks, with a LUT and the transposed extrinsics next to the tarball), replays them through CreateReplaySensor and
+// compares what comes back: the pixels, with invalid depth given back its AHaT value or Long Throw sigma flag, the
+// timestamp spacing, the end of stream, looping, real time pacing, the extrinsics and the camera mapping against the
+// model the LUT was generated from. The mapping is checked again with the calibration of the current recorder, a
+// reference into the calibration store and the fitted camera model. Exits with 1 when a check fails.
+
+#include "ResearchModeReplay.h"
+#include "FisheyeCameraModel.h"
+#include "RMFrameEncoder.h"
+#include "Tar.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ResearchModeReplay;
+
+namespace
+{
+    const uint64_t kStartTicks = 132000000000000000ull;  // Absolute ticks, as in the file names of a 2019 capture
+
+    struct SensorSpec
+    {
+        const wchar_t* friendlyName;
+        ResearchModeSensorType sensorType;
+        uint32_t width;
+        uint32_t height;
+        double fps;
+    };
+
+    const SensorSpec kSensors[] = {
+        { L"VLC LF", LEFT_FRONT, 640, 480, 30.0 },
+        { L"Depth AHaT", DEPTH_AHAT, 512, 512, 45.0 },
+        { L"Depth Long Throw", DEPTH_LONG_THROW, 320, 288, 5.0 },
+    };
+
+    bool IsDepth(ResearchModeSensorType sensorType)
+    {
+        return sensorType == DEPTH_AHAT || sensorType == DEPTH_LONG_THROW;
+    }
+
+    // What the device handed to the recorder
+    struct SourceFrame
+    {
+        uint64_t ticks;
+        std::vector<uint8_t> image;     // VLC
+        std::vector<uint16_t> depth;
+        std::vector<uint16_t> ab;
+        std::vector<uint8_t> sigma;     // Long Throw
+    };
+
+    std::vector<SourceFrame> MakeFrames(const SensorSpec& spec, size_t frameCount, unsigned seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_int_distribution<int> byte(0, 255);
+        std::uniform_int_distribution<int> depth(1, 4089);     // 0 reads back as invalid, so valid pixels start at 1
+        std::uniform_int_distribution<int> ab(0, 65535);
+        std::uniform_real_distribution<double> chance(0.0, 1.0);
+        const size_t pixelCount = size_t(spec.width) * spec.height;
+        const uint64_t period = uint64_t(1e7 / spec.fps);
+
+        std::vector<SourceFrame> frames(frameCount);
+        uint64_t ticks = kStartTicks;
+        for (SourceFrame& frame : frames)
+        {
+            // Frames come a little early or late, and the recorder sometimes misses one
+            ticks += period + uint64_t(chance(random) * period * 0.1) + (chance(random) < 0.1 ? period : 0);
+            frame.ticks = ticks;
+
+            if (!IsDepth(spec.sensorType))
+            {
+                frame.image.resize(pixelCount);
+                for (uint8_t& pixel : frame.image)
+                    pixel = uint8_t(byte(random));
+                continue;
+            }
+
+            frame.depth.resize(pixelCount);
+            frame.ab.resize(pixelCount);
+            if (spec.sensorType == DEPTH_LONG_THROW)
+                frame.sigma.resize(pixelCount);
+            for (size_t i = 0; i < pixelCount; i++)
+            {
+                const bool invalid = chance(random) < 0.05;
+                frame.ab[i] = uint16_t(ab(random));
+                if (spec.sensorType == DEPTH_LONG_THROW)
+                {
+                    // Invalid pixels keep a depth, only the sigma flag marks them
+                    frame.depth[i] = uint16_t(depth(random));
+                    frame.sigma[i] = uint8_t(byte(random) & 0x7f) | (invalid ? 0x80 : 0);
+                }
+                else
+                {
+                    frame.depth[i] = invalid ? uint16_t(4090 + byte(random) % 6) : uint16_t(depth(random));
+                }
+            }
+        }
+        return frames;
+    }
+
+    // Radial distortion around a pinhole, sampled at the pixel centers like RMCameraReader's LUT
+    struct LutModel
+    {
+        double fx, fy, cx, cy, k1, k2;
+
+        // Image point to unit plane, the mapping the LUT samples
+        void ImageToUnitPlane(double u, double v, double& x, double& y) const
+        {
+            const double px = (u - cx) / fx;
+            const double py = (v - cy) / fy;
+            const double r2 = px * px + py * py;
+            const double scale = 1.0 + k1 * r2 + k2 * r2 * r2;
+            x = px * scale;
+            y = py * scale;
+        }
+    };
+
+    LutModel MakeLutModel(const SensorSpec& spec)
+    {
+        const double focal = spec.width * 0.55;
+        return { focal, focal * 1.01, spec.width * 0.5 + 3.2, spec.height * 0.5 - 2.7, 0.12, 0.02 };
+    }
+
+    std::vector<float> MakeLut(const SensorSpec& spec, const LutModel& model)
+    {
+        std::vector<float> lut;
+        lut.reserve(size_t(spec.width) * spec.height * 3);
+        for (uint32_t v = 0; v < spec.height; v++)
+        {
+            for (uint32_t u = 0; u < spec.width; u++)
+            {
+                double x, y;
+                model.ImageToUnitPlane(u + 0.5, v + 0.5, x, y);
+                const double norm = std::sqrt(x * x + y * y + 1.0);
+                lut.push_back(float(x / norm));
+                lut.push_back(float(y / norm));
+                lut.push_back(float(1.0 / norm));
+            }
+        }
+        return lut;
+    }
+
+    void WriteBinaryFile(const std::filesystem::path& path, const void* pData, size_t size)
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(static_cast<const char*>(pData), size);
+    }
+
+    // A rotation about z and a translation, written transposed like RMCameraReader::DumpCalibration
+    DirectX::XMFLOAT4X4 WriteExtrinsics(const std::filesystem::path& path)
+    {
+        const float angle = 0.3f;
+        DirectX::XMFLOAT4X4 matrix = {};
+        matrix.m[0][0] = std::cos(angle);
+        matrix.m[0][1] = std::sin(angle);
+        matrix.m[1][0] = -std::sin(angle);
+        matrix.m[1][1] = std::cos(angle);
+        matrix.m[2][2] = 1.0f;
+        matrix.m[3][0] = 0.0123f;
+        matrix.m[3][1] = -0.0456f;
+        matrix.m[3][2] = 0.0789f;
+        matrix.m[3][3] = 1.0f;
+
+        std::ofstream file(path);
+        for (int column = 0; column < 4; column++)
+        {
+            for (int row = 0; row < 4; row++)
+                file << matrix.m[row][column] << (row == 3 && column == 3 ? "\n" : ",");
+        }
+        return matrix;
+    }
+
+    void Record(const std::filesystem::path& folder, const SensorSpec& spec, const std::vector<SourceFrame>& frames)
+    {
+        Io::Tarball tarball((folder / (std::wstring(spec.friendlyName) + L".tar")).wstring());
+        std::vector<uint8_t> imagePgm, abPgm;
+        const size_t pixelCount = size_t(spec.width) * spec.height;
+        for (const SourceFrame& frame : frames)
+        {
+            const std::wstring ticks = std::to_wstring(frame.ticks);
+            if (!IsDepth(spec.sensorType))
+            {
+                RMFrameEncoder::EncodeVlcPgm(spec.width, spec.height, frame.image.data(), pixelCount, imagePgm);
+                tarball.AddFile(ticks + L".pgm", imagePgm.data(), imagePgm.size());
+                continue;
+            }
+
+            RMFrameEncoder::EncodeDepthPgms(spec.width, spec.height, spec.sensorType == DEPTH_LONG_THROW, frame.depth.data(),
+                frame.ab.data(), frame.sigma.empty() ? nullptr : frame.sigma.data(), pixelCount, imagePgm, abPgm);
+            tarball.AddFile(ticks + L"_ab.pgm", abPgm.data(), abPgm.size());
+            tarball.AddFile(ticks + L".pgm", imagePgm.data(), imagePgm.size());
+        }
+        tarball.Close();
+    }
+
+    // Mismatching pixels of a replayed frame, -1 if its buffers can't be read
+    long long ComparePixels(const SensorSpec& spec, const SourceFrame& source, IResearchModeSensorFrame* pFrame)
+    {
+        ResearchModeSensorResolution resolution = {};
+        pFrame->GetResolution(&resolution);
+        const size_t pixelCount = size_t(spec.width) * spec.height;
+        if (resolution.Width != spec.width || resolution.Height != spec.height)
+            return -1;
+
+        long long mismatches = 0;
+        if (!IsDepth(spec.sensorType))
+        {
+            IResearchModeSensorVLCFrame* pVLCFrame = nullptr;
+            IResearchModeSensorDepthFrame* pDepthFrame = nullptr;
+            if (FAILED(pFrame->QueryInterface(IID_PPV_ARGS(&pVLCFrame))))
+                return -1;
+            // A VLC frame must not pass for a depth frame
+            if (SUCCEEDED(pFrame->QueryInterface(IID_PPV_ARGS(&pDepthFrame))))
+            {
+                pDepthFrame->Release();
+                mismatches++;
+            }
+
+            const BYTE* pImage = nullptr;
+            size_t length = 0;
+            UINT32 gain = 1;
+            UINT64 exposure = 1;
+            if (FAILED(pVLCFrame->GetBuffer(&pImage, &length)) || length != pixelCount)
+            {
+                pVLCFrame->Release();
+                return -1;
+            }
+            pVLCFrame->GetGain(&gain);
+            pVLCFrame->GetExposure(&exposure);
+            for (size_t i = 0; i < pixelCount; i++)
+                mismatches += pImage[i] != source.image[i];
+            mismatches += gain != 0 || exposure != 0;
+            pVLCFrame->Release();
+            return mismatches;
+        }
+
+        IResearchModeSensorDepthFrame* pDepthFrame = nullptr;
+        if (FAILED(pFrame->QueryInterface(IID_PPV_ARGS(&pDepthFrame))))
+            return -1;
+
+        const UINT16* pDepth = nullptr;
+        const UINT16* pAb = nullptr;
+        const BYTE* pSigma = nullptr;
+        size_t depthLength = 0, abLength = 0, sigmaLength = 0;
+        const bool isLongThrow = spec.sensorType == DEPTH_LONG_THROW;
+        if (FAILED(pDepthFrame->GetBuffer(&pDepth, &depthLength)) || FAILED(pDepthFrame->GetAbDepthBuffer(&pAb, &abLength)) ||
+            (isLongThrow && FAILED(pDepthFrame->GetSigmaBuffer(&pSigma, &sigmaLength))) ||
+            depthLength != pixelCount || abLength != pixelCount || (isLongThrow && sigmaLength != pixelCount))
+        {
+            pDepthFrame->Release();
+            return -1;
+        }
+
+        for (size_t i = 0; i < pixelCount; i++)
+        {
+            mismatches += pAb[i] != source.ab[i];
+            if (isLongThrow)
+            {
+                // The recorder writes invalid depth as 0 and drops the rest of sigma
+                const bool invalid = (source.sigma[i] & 0x80) != 0;
+                mismatches += pDepth[i] != (invalid ? 0 : source.depth[i]);
+                mismatches += pSigma[i] != (invalid ? 0x80 : 0);
+            }
+            else
+            {
+                mismatches += pDepth[i] != (std::min)(source.depth[i], uint16_t(4090));
+            }
+        }
+        pDepthFrame->Release();
+        return mismatches;
+    }
+
+    struct ReplayResult
+    {
+        size_t frames = 0;
+        long long pixelMismatches = 0;
+        size_t timestampErrors = 0;
+        bool endOfStream = false;
+    };
+
+    // Plays the whole capture once and compares every frame, then expects kEndOfStream
+    ReplayResult ReplayOnce(IResearchModeSensor* pSensor, const SensorSpec& spec, const std::vector<SourceFrame>& frames)
+    {
+        ReplayResult result;
+        pSensor->OpenStream();
+        uint64_t firstTicks = 0;
+        for (size_t frameIndex = 0; frameIndex < frames.size(); frameIndex++)
+        {
+            IResearchModeSensorFrame* pFrame = nullptr;
+            if (FAILED(pSensor->GetNextBuffer(&pFrame)))
+                break;
+
+            ResearchModeSensorTimestamp timestamp = {};
+            pFrame->GetTimeStamp(&timestamp);
+            if (frameIndex == 0)
+                firstTicks = timestamp.SensorTicks;
+            const uint64_t expectedTicks = firstTicks + (frames[frameIndex].ticks - frames.front().ticks);
+            result.timestampErrors += timestamp.SensorTicks != expectedTicks || timestamp.HostTicks != expectedTicks ||
+                timestamp.SensorTicksPerSecond != 10000000 || timestamp.HostTicksPerSecond != 10000000;
+
+            const long long mismatches = ComparePixels(spec, frames[frameIndex], pFrame);
+            result.pixelMismatches += mismatches < 0 ? 1 : mismatches;
+            result.frames++;
+            pFrame->Release();
+        }
+
+        IResearchModeSensorFrame* pFrame = nullptr;
+        result.endOfStream = pSensor->GetNextBuffer(&pFrame) == kEndOfStream && pFrame == nullptr;
+        pSensor->CloseStream();
+        return result;
+    }
+
+    // Looping replays start over with timestamps that keep increasing, one frame period past the last frame
+    bool CheckLoop(const std::filesystem::path& tarPath, const std::vector<SourceFrame>& frames)
+    {
+        ReplayOptions options;
+        options.mode = PlaybackMode::AsFastAsPossible;
+        options.loop = true;
+        IResearchModeSensor* pSensor = nullptr;
+        if (FAILED(CreateReplaySensor(tarPath, options, &pSensor)))
+            return false;
+
+        const uint64_t recorded = frames.back().ticks - frames.front().ticks;
+        const uint64_t loopDuration = recorded + recorded / (frames.size() - 1);
+        bool passed = true;
+        uint64_t firstTicks = 0;
+        pSensor->OpenStream();
+        for (size_t i = 0; i < frames.size() * 2 + 1 && passed; i++)
+        {
+            IResearchModeSensorFrame* pFrame = nullptr;
+            if (FAILED(pSensor->GetNextBuffer(&pFrame)))
+            {
+                passed = false;
+                break;
+            }
+            ResearchModeSensorTimestamp timestamp = {};
+            pFrame->GetTimeStamp(&timestamp);
+            pFrame->Release();
+            if (i == 0)
+                firstTicks = timestamp.SensorTicks;
+            const size_t frameIndex = i % frames.size();
+            const uint64_t expected = firstTicks + (frames[frameIndex].ticks - frames.front().ticks) + (i / frames.size()) * loopDuration;
+            passed = timestamp.SensorTicks == expected;
+        }
+        pSensor->CloseStream();
+        pSensor->Release();
+        return passed;
+    }
+
+    // Real time playback can't hand out the frames faster than their recorded spacing divided by the speed.
+    // Only the lower bound is checked, a loaded machine may be late.
+    bool CheckRealTime(const std::filesystem::path& tarPath, const std::vector<SourceFrame>& frames, double speed, double& seconds)
+    {
+        ReplayOptions options;
+        options.mode = PlaybackMode::RealTime;
+        options.speed = speed;
+        options.preload = true;
+        IResearchModeSensor* pSensor = nullptr;
+        if (FAILED(CreateReplaySensor(tarPath, options, &pSensor)))
+            return false;
+
+        pSensor->OpenStream();
+        const auto start = std::chrono::steady_clock::now();
+        size_t frameCount = 0;
+        IResearchModeSensorFrame* pFrame = nullptr;
+        while (frameCount <= frames.size() && SUCCEEDED(pSensor->GetNextBuffer(&pFrame)))
+        {
+            pFrame->Release();
+            frameCount++;
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        pSensor->CloseStream();
+        pSensor->Release();
+
+        const double expected = (frames.back().ticks - frames.front().ticks) / 1e7 / speed;
+        return frameCount == frames.size() && seconds >= expected * 0.99;
+    }
+
+    struct MappingResult
+    {
+        bool available = false;
+        double maxUnitPlaneError = 0.0;     // Against the model the LUT was sampled from
+        double maxRoundTripPixels = 0.0;    // Image point to unit plane and back
+        size_t failures = 0;
+    };
+
+    MappingResult CheckMapping(IResearchModeSensor* pSensor, const SensorSpec& spec, const LutModel& model)
+    {
+        MappingResult result;
+        IResearchModeCameraSensor* pCameraSensor = nullptr;
+        if (FAILED(pSensor->QueryInterface(IID_PPV_ARGS(&pCameraSensor))))
+            return result;
+
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> u(0.5f, spec.width - 0.5f);
+        std::uniform_real_distribution<float> v(0.5f, spec.height - 0.5f);
+        result.available = true;
+        for (int i = 0; i < 2000; i++)
+        {
+            float uv[2] = { u(random), v(random) };
+            float xy[2];
+            if (FAILED(pCameraSensor->MapImagePointToCameraUnitPlane(uv, xy)))
+            {
+                result.failures++;
+                continue;
+            }
+            double x, y;
+            model.ImageToUnitPlane(uv[0], uv[1], x, y);
+            result.maxUnitPlaneError = (std::max)(result.maxUnitPlaneError, std::hypot(xy[0] - x, xy[1] - y));
+
+            float back[2];
+            if (FAILED(pCameraSensor->MapCameraSpaceToImagePoint(xy, back)))
+            {
+                result.failures++;
+                continue;
+            }
+            result.maxRoundTripPixels = (std::max)(result.maxRoundTripPixels, double(std::hypot(back[0] - uv[0], back[1] - uv[1])));
+        }
+        pCameraSensor->Release();
+        return result;
+    }
+
+    bool CheckExtrinsics(IResearchModeSensor* pSensor, const DirectX::XMFLOAT4X4& expected)
+    {
+        IResearchModeCameraSensor* pCameraSensor = nullptr;
+        if (FAILED(pSensor->QueryInterface(IID_PPV_ARGS(&pCameraSensor))))
+            return false;
+
+        DirectX::XMFLOAT4X4 extrinsics = {};
+        const bool read = SUCCEEDED(pCameraSensor->GetCameraExtrinsicsMatrix(&extrinsics));
+        pCameraSensor->Release();
+
+        float maxError = 0.0f;
+        for (int row = 0; row < 4; row++)
+        {
+            for (int column = 0; column < 4; column++)
+                maxError = (std::max)(maxError, std::fabs(extrinsics.m[row][column] - expected.m[row][column]));
+        }
+        // The recorder writes 6 significant digits
+        return read && maxError < 1e-5f;
+    }
+
+    bool CheckSensor(const std::filesystem::path& folder, const SensorSpec& spec, size_t frameCount, double speed)
+    {
+        const std::vector<SourceFrame> frames = MakeFrames(spec, frameCount, unsigned(spec.sensorType) + 11);
+        const std::string name = std::filesystem::path(spec.friendlyName).string();
+        const std::filesystem::path tarPath = folder / (name + ".tar");
+        const LutModel model = MakeLutModel(spec);
+        Record(folder, spec, frames);
+        const std::vector<float> lut = MakeLut(spec, model);
+        WriteBinaryFile(folder / (name + "_lut.bin"), lut.data(), lut.size() * sizeof(float));
+        const DirectX::XMFLOAT4X4 extrinsics = WriteExtrinsics(folder / (name + "_extrinsics.txt"));
+
+        bool passed = true;
+        for (bool preload : { false, true })
+        {
+            ReplayOptions options;
+            options.mode = PlaybackMode::AsFastAsPossible;
+            options.preload = preload;
+            IResearchModeSensor* pSensor = nullptr;
+            if (FAILED(CreateReplaySensor(tarPath, options, &pSensor)))
+            {
+                printf("%-17s cannot open %s\n", name.c_str(), tarPath.string().c_str());
+                return false;
+            }
+
+            IResearchModeDepthSensor* pDepthSensor = nullptr;
+            const bool isDepth = SUCCEEDED(pSensor->QueryInterface(IID_PPV_ARGS(&pDepthSensor)));
+            if (pDepthSensor)
+                pDepthSensor->Release();
+            const bool sameType = pSensor->GetSensorType() == spec.sensorType && isDepth == IsDepth(spec.sensorType) &&
+                std::wstring(pSensor->GetFriendlyName()) == spec.friendlyName;
+
+            const ReplayResult replay = ReplayOnce(pSensor, spec, frames);
+            const MappingResult mapping = CheckMapping(pSensor, spec, model);
+            const bool extrinsicsMatch = CheckExtrinsics(pSensor, extrinsics);
+            pSensor->Release();
+
+            // The LUT is sampled every pixel, bilinear interpolation of the distortion stays well under 1e-4
+            const bool ok = sameType && replay.frames == frames.size() && replay.pixelMismatches == 0 && replay.timestampErrors == 0 &&
+                replay.endOfStream && mapping.available && mapping.failures == 0 && mapping.maxUnitPlaneError < 1e-4 &&
+                mapping.maxRoundTripPixels < 0.01 && extrinsicsMatch;
+            printf("%-17s %-8s %7zu %10lld %11zu %4s %12.2e %11.2e %11s  %s\n", name.c_str(), preload ? "preload" : "read", replay.frames,
+                replay.pixelMismatches, replay.timestampErrors, replay.endOfStream ? "yes" : "no", mapping.maxUnitPlaneError,
+                mapping.maxRoundTripPixels, extrinsicsMatch ? "yes" : "no", ok ? "ok" : "FAILED");
+            passed = passed && ok;
+        }
+
+        const bool loopPassed = CheckLoop(tarPath, frames);
+        double realTimeSeconds = 0.0;
+        const bool realTimePassed = CheckRealTime(tarPath, frames, speed, realTimeSeconds);
+        printf("%-17s loop %s, real time at %gx %.2f s for %.2f s recorded %s\n", name.c_str(), loopPassed ? "ok" : "FAILED", speed,
+            realTimeSeconds, (frames.back().ticks - frames.front().ticks) / 1e7, realTimePassed ? "ok" : "FAILED");
+        return passed && loopPassed && realTimePassed;
+    }
+
+    // Recordings of the current recorder have no _lut.bin. The replay takes the LUT from the calibration store when
+    // the reference resolves, else rebuilds it from the camera model, and without either the mapping is unavailable.
+    bool CheckCalibrationSources(const std::filesystem::path& folder, const SensorSpec& spec)
+    {
+        const std::string name = std::filesystem::path(spec.friendlyName).string();
+        const std::filesystem::path recording = folder / "calibration_reference";
+        const std::filesystem::path store = folder / "calibration_store";
+        const std::string device = "ReplayRoundTripTest";
+        // The replay finds the blob by the first 16 digits and checks its size, not its hash
+        const std::string lutHash(64, 'a');
+        std::filesystem::create_directories(recording);
+        std::filesystem::create_directories(store / device);
+        std::filesystem::copy_file(folder / (name + ".tar"), recording / (name + ".tar"), std::filesystem::copy_options::overwrite_existing);
+        std::filesystem::remove(recording / (name + "_calibration.txt"));
+        std::filesystem::remove(recording / (name + "_camera_model.bin"));
+
+        const LutModel model = MakeLutModel(spec);
+        const std::vector<float> lut = MakeLut(spec, model);
+        WriteBinaryFile(store / device / (name + "_lut_" + lutHash.substr(0, 16) + ".bin"), lut.data(), lut.size() * sizeof(float));
+        FisheyeFitReport report;
+        const std::vector<uint8_t> cameraModel = FisheyeCameraModel::Fit(lut.data(), spec.width, spec.height, &report).Serialize();
+
+        auto map = [&](const std::filesystem::path& calibrationStore)
+        {
+            ReplayOptions options;
+            options.mode = PlaybackMode::AsFastAsPossible;
+            options.calibrationStore = calibrationStore;
+            IResearchModeSensor* pSensor = nullptr;
+            MappingResult mapping;
+            if (SUCCEEDED(CreateReplaySensor(recording / (name + ".tar"), options, &pSensor)))
+            {
+                mapping = CheckMapping(pSensor, spec, model);
+                pSensor->Release();
+            }
+            return mapping;
+        };
+
+        const MappingResult none = map(store);
+        {
+            std::ofstream reference(recording / (name + "_calibration.txt"));
+            reference << "device," << device << "\n" << "width," << spec.width << "\n" << "height," << spec.height << "\n"
+                      << "lut," << lutHash << "\n" << "camera_model," << std::string(64, 'b') << "\n";
+        }
+        // The camera model is written only after, so the store can't pass thanks to it
+        const MappingResult fromStore = map(store);
+        WriteBinaryFile(recording / (name + "_camera_model.bin"), cameraModel.data(), cameraModel.size());
+        const MappingResult fromCameraModel = map(folder / "missing_calibration_store");
+
+        // The camera model is off by its fit error, about 0.01 pixels, on the unit plane that is under 1e-4
+        const bool noneOk = none.available && none.failures == 2000;
+        const bool storeOk = fromStore.available && fromStore.failures == 0 && fromStore.maxUnitPlaneError < 1e-4;
+        const bool cameraModelOk = fromCameraModel.available && fromCameraModel.failures == 0 &&
+            fromCameraModel.maxUnitPlaneError < 1e-4 && fromCameraModel.maxRoundTripPixels < 0.01;
+        printf("%-17s calibration store %.2e %s, camera model %.2e (fit %.4f px) %s, none unavailable %s\n", name.c_str(),
+            fromStore.maxUnitPlaneError, storeOk ? "ok" : "FAILED", fromCameraModel.maxUnitPlaneError, report.maxPixelError,
+            cameraModelOk ? "ok" : "FAILED", noneOk ? "ok" : "FAILED");
+        return noneOk && storeOk && cameraModelOk;
+    }
+
+    // Captures the replay can't use are refused instead of replaying nothing
+    bool CheckRejections(const std::filesystem::path& folder)
+    {
+        IResearchModeSensor* pSensor = nullptr;
+        const bool missing = CreateReplaySensor(folder / "VLC RR.tar", ReplayOptions(), &pSensor) == E_INVALIDARG && pSensor == nullptr;
+
+        std::filesystem::copy_file(folder / "VLC LF.tar", folder / "Unknown.tar", std::filesystem::copy_options::overwrite_existing);
+        const bool unknown = CreateReplaySensor(folder / "Unknown.tar", ReplayOptions(), &pSensor) == E_INVALIDARG && pSensor == nullptr;
+
+        { Io::Tarball empty((folder / "VLC LL.tar").wstring()); }
+        const bool empty = FAILED(CreateReplaySensor(folder / "VLC LL.tar", ReplayOptions(), &pSensor)) && pSensor == nullptr;
+
+        printf("rejects a missing tarball %s, an unknown sensor %s, a tarball without frames %s\n", missing ? "ok" : "FAILED",
+            unknown ? "ok" : "FAILED", empty ? "ok" : "FAILED");
+        return missing && unknown && empty;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::filesystem::path folder = std::filesystem::temp_directory_path() / "ReplayRoundTripTest";
+    size_t frameCount = 20;
+    double speed = 4.0;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc)
+        {
+            folder = argv[++i];
+        }
+        else if (arg == "--frames" && i + 1 < argc)
+        {
+            frameCount = (std::max)(size_t(2), size_t(strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (arg == "--speed" && i + 1 < argc)
+        {
+            speed = (std::max)(0.01, atof(argv[++i]));
+        }
+        else
+        {
+            printf("usage: ReplayRoundTripTest [--output folder] [--frames count] [--speed factor]\n");
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(folder, error);
+    if (error)
+    {
+        printf("cannot create %s: %s\n", folder.string().c_str(), error.message().c_str());
+        return 1;
+    }
+
+    printf("%zu frames per sensor, recorded into %s\n", frameCount, folder.string().c_str());
+    printf("%-17s %-8s %7s %10s %11s %4s %12s %11s %11s\n", "sensor", "mode", "frames", "bad pixels", "bad stamps", "eos",
+        "unit plane", "round trip", "extrinsics");
+    bool passed = true;
+    for (const SensorSpec& spec : kSensors)
+        passed = CheckSensor(folder, spec, frameCount, speed) && passed;
+    for (const SensorSpec& spec : kSensors)
+        passed = CheckCalibrationSources(folder, spec) && passed;
+    passed = CheckRejections(folder) && passed;
+    return passed ? 0 : 1;
+}
@@ -10,8 +10,10 @@
 //*********************************************************
 
 #include "AppMain.h"
+#include "FrameTrace.h"
 #include <winrt/Windows.Foundation.h>
 #include <ctime>
+#include <filesystem>
 
 using namespace DirectX;
 using namespace std;
@@ -31,16 +33,27 @@ enum class ButtonID
 	RIGHT_FRONT,
 	RIGHT_RIGHT,
 	DEPTH_AHAT,
-	DEPTH_LONG_THROW
+	DEPTH_LONG_THROW,
+	IMU_ACCEL,	// Written to imu_accel.bin
+	IMU_GYRO,	// Written to imu_gyro.bin
+	IMU_MAG		// Written to imu_mag.bin
 }*/
 // Note that concurrent access to AHAT and Long Throw is currently not supported
-std::vector<ResearchModeSensorType> AppMain::kEnabledRMStreamTypes = { ResearchModeSensorType::DEPTH_LONG_THROW };
+// The IMU streams take a few MB per minute, little next to depth, and imu_preintegration.py needs the accelerometer and gyroscope
+std::vector<ResearchModeSensorType> AppMain::kEnabledRMStreamTypes = { ResearchModeSensorType::DEPTH_LONG_THROW,
+	ResearchModeSensorType::IMU_ACCEL, ResearchModeSensorType::IMU_GYRO, ResearchModeSensorType::IMU_MAG };
 /* Supported not-ResearchMode streams:
 {
 	PV,  // RGB
 	EYE  // Eye gaze tracking
 }*/
 std::vector<StreamTypes> AppMain::kEnabledStreamTypes = { StreamTypes::PV };
+// Writes <datetime>_trace.json next to the recording, a timeline of the capture and write threads
+// (open in chrome://tracing or ui.perfetto.dev)
+bool AppMain::kTraceRecordings = false;
+// Threads encoding and writing the frames of all the camera streams, each stream's frames are still written in order.
+// Workers can be pinned to cores (e.g. { 2, 3 }) and given a priority.
+WriterPoolOptions AppMain::kWriterPoolOptions = { 2, {}, WriterThreadPriority::Normal, "Writer" };
 
 AppMain::AppMain() :
 	m_recording(false),
@@ -61,6 +74,17 @@ AppMain::AppMain() :
 	m_mixedReality.EnableSurfaceMapping();
 	m_mixedReality.EnableQRCodeTracking();
 
+	// Surface meshes are also saved with each recording, for offline ray casts against the environment
+	m_surfaceMeshStream = make_shared<SurfaceMeshStream>();
+	if (auto surfaceMapping = m_mixedReality.GetSurfaceMappingInterface())
+	{
+		auto surfaceMeshStream = m_surfaceMeshStream;
+		surfaceMapping->SetSurfaceMeshCallback([surfaceMeshStream](const SurfaceMeshSnapshot& snapshot)
+		{
+			surfaceMeshStream->OnSurfaceMesh(snapshot);
+		});
+	}
+
 	const float rootMenuHeight = 0.10f;
 	XMVECTOR mainButtonSize = XMVectorSet(0.04f, 0.04f, 0.015f, 0.0f);
 
@@ -70,15 +94,18 @@ AppMain::AppMain() :
 	m_menu.AddButton(make_shared<FloatingSlateButton>(XMVectorSet(-0.025f, 0.0f, 0.0f, 1.0f), mainButtonSize, XMVectorSet(0.0f, 0.5f, 0.0f, 1.0f), (unsigned)ButtonID::Start, this, "Start"));
 	m_menu.AddButton(make_shared<FloatingSlateButton>(XMVectorSet(0.025f, 0.0f, 0.0f, 1.0f), mainButtonSize, XMVectorSet(0.5f, 0.0f, 0.0f, 1.0f), (unsigned)ButtonID::Stop, this, "Stop"));
 
-	m_hethateyeStream.Clear();
+	// Head, hand and eye poses are kept as 16-bit position + quaternion while recording
+	m_hethateyeStream.SetQuantized(true);
 
+	m_writerPool = std::make_unique<WriterPool>(kWriterPoolOptions);
 
 	if (AppMain::kEnabledRMStreamTypes.size() > 0)
 	{
 		// Enable SensorScenario for RM
-		m_scenario = std::make_unique<SensorScenario>(kEnabledRMStreamTypes);
+		m_scenario = std::make_unique<SensorScenario>(kEnabledRMStreamTypes, *m_writerPool);
 		m_scenario->InitializeSensors();
 		m_scenario->InitializeCameraReaders();
+		m_scenario->InitializeImuReaders();
 	}	
 
 	for (int i = 0; i < kEnabledStreamTypes.size(); ++i)
@@ -135,41 +162,45 @@ void AppMain::Update()
 	{		
 		HeTHaTEyeFrame frame;
 		// Get head transform
-		frame.headTransform = m_hands.GetHeadTransform();
-		// Get hand joints transforms
+		frame.head = PackPose(m_hands.GetHeadTransform());
+		// Get hand joints poses, packed straight from position and orientation
 		for (int j = 0; j < (int)HandJointIndex::Count; ++j)
 		{
-			frame.leftHandTransform[j] = m_hands.GetOrientedJoint(0, HandJointIndex(j));
-			frame.rightHandTransform[j] = m_hands.GetOrientedJoint(1, HandJointIndex(j));
+			frame.leftHand[j] = PackPose(m_hands.GetJoint(0, HandJointIndex(j)), m_hands.GetJointOrientation(0, HandJointIndex(j)));
+			frame.rightHand[j] = PackPose(m_hands.GetJoint(1, HandJointIndex(j)), m_hands.GetJointOrientation(1, HandJointIndex(j)));
 		}
 		// Check if hands are tracked
-		frame.leftHandPresent = m_hands.IsHandTracked(0);
-		frame.rightHandPresent = m_hands.IsHandTracked(1);
+		if (m_hands.IsHandTracked(0))
+		{
+			frame.presence |= LeftHandPresent;
+		}
+		if (m_hands.IsHandTracked(1))
+		{
+			frame.presence |= RightHandPresent;
+		}
 		// Get timestamp
 		frame.timestamp = m_mixedReality.GetPredictedDisplayTime();
 
 		// Get eye gaze tracking data
 		if (m_mixedReality.IsEyeTrackingEnabled() && m_mixedReality.IsEyeTrackingActive())
 		{
-			frame.eyeGazePresent = true;
-			frame.eyeGazeOrigin = m_mixedReality.GetEyeGazeOrigin();
-			frame.eyeGazeDirection = m_mixedReality.GetEyeGazeDirection();
+			const XMVECTOR eyeGazeOrigin = m_mixedReality.GetEyeGazeOrigin();
+			const XMVECTOR eyeGazeDirection = m_mixedReality.GetEyeGazeDirection();
+			frame.presence |= EyeGazePresent;
+			XMStoreFloat3(&frame.eyeGazeOrigin, eyeGazeOrigin);
+			XMStoreFloat3(&frame.eyeGazeDirection, eyeGazeDirection);
 			frame.eyeGazeDistance = 0.0f;
 			// Use surface mapping to compute the distance the user is looking at
 			if (m_mixedReality.IsSurfaceMappingActive())
 			{				
 				float distance;
 				XMVECTOR normal;
-				if (m_mixedReality.GetSurfaceMappingInterface()->TestRayIntersection(frame.eyeGazeOrigin, frame.eyeGazeDirection, distance, normal))
+				if (m_mixedReality.GetSurfaceMappingInterface()->TestRayIntersection(eyeGazeOrigin, eyeGazeDirection, distance, normal))
 				{
 					frame.eyeGazeDistance = distance;
 				}
 			}
 		}
-		else
-		{
-			frame.eyeGazePresent = false;
-		}
 		m_hethateyeStream.AddFrame(std::move(frame));			
 		
 	}
@@ -188,7 +219,8 @@ void AppMain::Update()
 		const XMVECTOR projectPosition = headPosition + horizontalOffset;	
 		const XMVECTOR headSide = XMVector3Normalize(XMVector3Cross(headForward, minusY));
 
-		if (m_mixedReality.GetSurfaceMappingInterface()->TestRayIntersection(projectPosition, minusY, distance, normal))
+		// The height estimate is smoothed anyway, a few centimeters of mesh simplification error don't matter
+		if (m_mixedReality.GetSurfaceMappingInterface()->TestRayIntersection(projectPosition, minusY, distance, normal, 0.05f))
 		{
 			m_currentHeight = 0.9f * m_currentHeight + 0.1f * distance;
 		}
@@ -251,6 +283,11 @@ winrt::Windows::Foundation::IAsyncAction AppMain::StartRecordingAsync()
 	{
 		m_archiveFolder = archiveSourceFolder;
 
+		if (kTraceRecordings)
+		{
+			FrameTrace::StartSession();
+			FrameTrace::SetEnabled(true);
+		}
 		if (m_scenario)
 		{
 			m_scenario->StartRecording(archiveSourceFolder, m_mixedReality.GetWorldCoordinateSystem());
@@ -260,6 +297,7 @@ winrt::Windows::Foundation::IAsyncAction AppMain::StartRecordingAsync()
 			m_videoFrameProcessor->Clear();
 			m_videoFrameProcessor->StartRecording(archiveSourceFolder, m_mixedReality.GetWorldCoordinateSystem());
 		}
+		m_surfaceMeshStream->StartRecording(archiveSourceFolder, m_datetime);
 		m_recording = true;
 	}
 }
@@ -275,6 +313,13 @@ void AppMain::StopRecording()
 	{
 		m_scenario->StopRecording();
 	}
+	m_surfaceMeshStream->StopRecording();
+
+	if (FrameTrace::IsEnabled())
+	{
+		FrameTrace::SetEnabled(false);
+		FrameTrace::WriteChromeTrace(std::filesystem::path(m_archiveFolder.Path().c_str()) / (m_datetime + L"_trace.json"));
+	}
 	
 	m_recording = false;
 	m_hethatStreamVis.Update(m_hethateyeStream);
@@ -300,7 +345,7 @@ winrt::Windows::Foundation::IAsyncAction AppMain::InitializeVideoFrameProcessorA
 		return;
 	}
 
-	m_videoFrameProcessor = make_unique<VideoFrameProcessor>();
+	m_videoFrameProcessor = make_unique<VideoFrameProcessor>(*m_writerPool);
 	if (!m_videoFrameProcessor.get())
 	{
 		throw winrt::hresult(E_POINTER);
@@ -20,7 +20,9 @@
 
 #include "HeTHaTEyeStream.h"
 #include "SensorScenario.h"
+#include "SurfaceMeshStream.h"
 #include "VideoFrameProcessor.h"
+#include "WriterPool.h"
 
 enum StreamTypes
 {
@@ -46,6 +48,8 @@ public:
 
 	static std::vector<ResearchModeSensorType> kEnabledRMStreamTypes;
 	static std::vector<StreamTypes> kEnabledStreamTypes;
+	static bool kTraceRecordings;
+	static WriterPoolOptions kWriterPoolOptions;
 
 private:
 	winrt::Windows::Foundation::IAsyncAction InitializeVideoFrameProcessorAsync();
@@ -73,7 +77,12 @@ private:
 	HeTHaTEyeStream m_hethateyeStream;
 	HeTHaTStreamVisualizer m_hethatStreamVis;
 
+	// Shared with the surface mapping callback, which runs on the surface observation thread
+	std::shared_ptr<SurfaceMeshStream> m_surfaceMeshStream;
+
 	winrt::Windows::Storage::StorageFolder m_archiveFolder = nullptr;
+	// Shared by the camera readers and the video frame processor, declared first so it outlives them
+	std::unique_ptr<WriterPool> m_writerPool;
 	std::unique_ptr<SensorScenario> m_scenario = nullptr;;
 
 	std::unique_ptr<VideoFrameProcessor> m_videoFrameProcessor = nullptr;
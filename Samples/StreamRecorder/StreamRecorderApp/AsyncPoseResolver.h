@@ -0,0 +1,156 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Looks up the poses of saved frames on a worker thread, so a slow locator never holds up the write thread.
+// The write thread only submits timestamps; the worker resolves whatever has queued up since its last batch,
+// lagging behind as far as the locator needs (the spatial locators keep a few seconds of history).
+// Pose is the locator's transform type, float4x4 on the device.
+template<typename Pose>
+class AsyncPoseResolver
+{
+public:
+    // Called on the worker thread with the frame's relative (QPC based) ticks, returns false when the pose is unknown
+    using LocateFunction = std::function<bool(uint64_t relativeTicks, Pose& pose)>;
+
+    struct ResolvedPose
+    {
+        long long timestamp;    // Absolute ticks, as in the frame file names
+        Pose pose;
+    };
+
+    explicit AsyncPoseResolver(LocateFunction locate) :
+        m_locate(std::move(locate))
+    {
+        // Reserve for 10 seconds at 30fps
+        m_pending.reserve(10 * 30);
+        m_batch.reserve(10 * 30);
+        m_resolved.reserve(10 * 30);
+        m_workerThread = std::thread(WorkerThread, this);
+    }
+
+    ~AsyncPoseResolver()
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_fExit = true;
+        }
+        m_condVar.notify_all();
+        m_workerThread.join();
+    }
+
+    AsyncPoseResolver(const AsyncPoseResolver&) = delete;
+    AsyncPoseResolver& operator=(const AsyncPoseResolver&) = delete;
+
+    void Submit(uint64_t relativeTicks, long long timestamp)
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_pending.push_back({ relativeTicks, timestamp });
+        }
+        m_condVar.notify_all();
+    }
+
+    // Blocks until every timestamp submitted so far has been looked up
+    void Flush()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condVar.wait(lock, [this] { return m_pending.empty() && !m_batchInProgress; });
+    }
+
+    // The poses resolved so far, in submission order. Frames whose pose couldn't be found are left out.
+    std::vector<ResolvedPose> TakeResolvedPoses()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        std::vector<ResolvedPose> resolved;
+        resolved.swap(m_resolved);
+        m_resolved.reserve(resolved.capacity());
+        return resolved;
+    }
+
+    uint64_t GetFailedCount() const
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return m_failedCount;
+    }
+
+private:
+    struct Request
+    {
+        uint64_t relativeTicks;
+        long long timestamp;
+    };
+
+    static void WorkerThread(AsyncPoseResolver* pResolver)
+    {
+        std::vector<ResolvedPose> batchResults;
+        uint64_t batchFailures = 0;
+
+        std::unique_lock<std::mutex> lock(pResolver->m_mutex);
+        while (true)
+        {
+            pResolver->m_condVar.wait(lock, [pResolver] { return pResolver->m_fExit || !pResolver->m_pending.empty(); });
+            if (pResolver->m_pending.empty())
+            {
+                break;  // Exiting, and nothing left to resolve
+            }
+
+            // Take everything queued so far; the swap hands the submitter back an already allocated vector
+            pResolver->m_batch.clear();
+            pResolver->m_batch.swap(pResolver->m_pending);
+            pResolver->m_batchInProgress = true;
+            lock.unlock();
+
+            batchResults.clear();
+            batchFailures = 0;
+            for (const Request& request : pResolver->m_batch)
+            {
+                ResolvedPose resolved;
+                resolved.timestamp = request.timestamp;
+                if (pResolver->m_locate(request.relativeTicks, resolved.pose))
+                {
+                    batchResults.push_back(resolved);
+                }
+                else
+                {
+                    batchFailures++;
+                }
+            }
+
+            lock.lock();
+            pResolver->m_resolved.insert(pResolver->m_resolved.end(), batchResults.begin(), batchResults.end());
+            pResolver->m_failedCount += batchFailures;
+            pResolver->m_batchInProgress = false;
+            pResolver->m_condVar.notify_all();
+        }
+    }
+
+    LocateFunction m_locate;
+
+    mutable std::mutex m_mutex;     // Guards everything below but m_batch, which only the worker touches unlocked
+    std::condition_variable m_condVar;
+    std::vector<Request> m_pending;
+    std::vector<Request> m_batch;
+    std::vector<ResolvedPose> m_resolved;
+    uint64_t m_failedCount = 0;
+    bool m_batchInProgress = false;
+    bool m_fExit = false;
+
+    std::thread m_workerThread;
+};
@@ -0,0 +1,176 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CalibrationCache.h"
+#include "StringHelpers.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <winrt/Windows.Security.Cryptography.h>
+#include <winrt/Windows.Security.Cryptography.Core.h>
+#include <winrt/Windows.Security.ExchangeActiveSyncProvisioning.h>
+#include <winrt/Windows.Storage.h>
+#include <winrt/Windows.Storage.Streams.h>
+
+using namespace winrt::Windows::Security::Cryptography;
+using namespace winrt::Windows::Security::Cryptography::Core;
+using namespace winrt::Windows::Security::ExchangeActiveSyncProvisioning;
+using namespace winrt::Windows::Storage;
+
+namespace
+{
+    // Same file in the cache and in the recordings, one "key,value" line per field
+    void WriteEntry(const std::filesystem::path& path, const CalibrationEntry& entry)
+    {
+        std::ofstream file(path);
+        file << "device," << entry.deviceId << "\n"
+             << "fingerprint," << entry.fingerprint << "\n"
+             << "width," << entry.width << "\n"
+             << "height," << entry.height << "\n"
+             << "lut," << entry.lutHash << "\n"
+             << "camera_model," << entry.cameraModelHash << "\n";
+    }
+
+    bool ReadEntry(const std::filesystem::path& path, CalibrationEntry& entry)
+    {
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            const size_t comma = line.find(',');
+            if (comma == std::string::npos)
+            {
+                continue;
+            }
+            const std::string key = line.substr(0, comma);
+            const std::string value = line.substr(comma + 1);
+            if (key == "device")
+            {
+                entry.deviceId = value;
+            }
+            else if (key == "fingerprint")
+            {
+                entry.fingerprint = value;
+            }
+            else if (key == "width")
+            {
+                entry.width = uint32_t(strtoul(value.c_str(), nullptr, 10));
+            }
+            else if (key == "height")
+            {
+                entry.height = uint32_t(strtoul(value.c_str(), nullptr, 10));
+            }
+            else if (key == "lut")
+            {
+                entry.lutHash = value;
+            }
+            else if (key == "camera_model")
+            {
+                entry.cameraModelHash = value;
+            }
+        }
+        return !entry.fingerprint.empty() && !entry.lutHash.empty() && !entry.cameraModelHash.empty();
+    }
+
+    void WriteBlob(const std::filesystem::path& path, const void* pData, size_t size)
+    {
+        std::ofstream file(path, std::ios::out | std::ios::binary);
+        file.write(static_cast<const char*>(pData), size);
+    }
+
+    bool HasSize(const std::filesystem::path& path, uintmax_t size)
+    {
+        std::error_code error;
+        return std::filesystem::file_size(path, error) == size && !error;
+    }
+
+    // The GUID Windows gives this app for the device, without the braces
+    std::string GetDeviceId()
+    {
+        std::string id = Utf16ToUtf8(winrt::to_hstring(EasClientDeviceInformation().Id()).c_str());
+        id.erase(std::remove_if(id.begin(), id.end(), [](char c) { return c == '{' || c == '}'; }), id.end());
+        std::transform(id.begin(), id.end(), id.begin(), [](char c) { return char(tolower(c)); });
+        return id;
+    }
+}
+
+CalibrationCache::CalibrationCache()
+{
+    m_deviceId = GetDeviceId();
+    m_folder = std::filesystem::path(ApplicationData::Current().LocalFolder().Path().c_str()) / L"calibration" / m_deviceId;
+    std::filesystem::create_directories(m_folder);
+}
+
+std::string CalibrationCache::HashHex(const void* pData, size_t size)
+{
+    const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+    const auto buffer = CryptographicBuffer::CreateFromByteArray(winrt::array_view<const uint8_t>(pBytes, pBytes + size));
+    const auto hash = HashAlgorithmProvider::OpenAlgorithm(HashAlgorithmNames::Sha256()).HashData(buffer);
+    return Utf16ToUtf8(CryptographicBuffer::EncodeToHexString(hash).c_str());
+}
+
+bool CalibrationCache::Lookup(const std::wstring& sensorName, const std::string& fingerprint, CalibrationEntry& entry) const
+{
+    CalibrationEntry cached;
+    if (!ReadEntry(GetEntryPath(sensorName), cached) || cached.fingerprint != fingerprint)
+    {
+        return false;
+    }
+
+    // Blobs cut short by a crash while storing them have the right name but not the right size
+    const uintmax_t lutSize = uintmax_t(cached.width) * cached.height * 3 * sizeof(float);
+    if (!HasSize(GetBlobPath(sensorName, L"lut", cached.lutHash), lutSize) ||
+        !std::filesystem::exists(GetBlobPath(sensorName, L"camera_model", cached.cameraModelHash)))
+    {
+        return false;
+    }
+
+    entry = cached;
+    return true;
+}
+
+CalibrationEntry CalibrationCache::Store(const std::wstring& sensorName, const std::string& fingerprint, uint32_t width, uint32_t height,
+    const std::vector<float>& lut, const std::vector<uint8_t>& cameraModel)
+{
+    CalibrationEntry entry;
+    entry.deviceId = m_deviceId;
+    entry.fingerprint = fingerprint;
+    entry.width = width;
+    entry.height = height;
+    entry.lutHash = HashHex(lut.data(), lut.size() * sizeof(float));
+    entry.cameraModelHash = HashHex(cameraModel.data(), cameraModel.size());
+
+    // Blobs of older entries are kept, recordings that reference them can still be resolved
+    WriteBlob(GetBlobPath(sensorName, L"lut", entry.lutHash), lut.data(), lut.size() * sizeof(float));
+    WriteBlob(GetBlobPath(sensorName, L"camera_model", entry.cameraModelHash), cameraModel.data(), cameraModel.size());
+    WriteEntry(GetEntryPath(sensorName), entry);
+    return entry;
+}
+
+void CalibrationCache::WriteReference(const std::wstring& sensorName, const CalibrationEntry& entry, const std::filesystem::path& recordingFolder) const
+{
+    WriteEntry(recordingFolder / (sensorName + L"_calibration.txt"), entry);
+    std::filesystem::copy_file(GetBlobPath(sensorName, L"camera_model", entry.cameraModelHash),
+        recordingFolder / (sensorName + L"_camera_model.bin"), std::filesystem::copy_options::overwrite_existing);
+}
+
+std::filesystem::path CalibrationCache::GetEntryPath(const std::wstring& sensorName) const
+{
+    return m_folder / (sensorName + L"_calibration.txt");
+}
+
+std::filesystem::path CalibrationCache::GetBlobPath(const std::wstring& sensorName, const wchar_t* kind, const std::string& hash) const
+{
+    const std::wstring shortHash(hash.begin(), hash.begin() + (std::min)(hash.size(), size_t(16)));
+    return m_folder / (sensorName + L"_" + kind + L"_" + shortHash + L".bin");
+}
@@ -0,0 +1,65 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// The Research Mode calibration of a device doesn't change between recordings, so the per pixel LUT of each camera
+// and the camera model fitted to it are kept once in LocalState\calibration\<device id>, named after the SHA-256 of
+// their content, instead of being computed and written at the end of every recording. A recording only gets a
+// <sensor>_calibration.txt referencing the blobs, and a copy of the camera model (a few hundred bytes) so it stays
+// usable on its own.
+//
+// Entries are looked up by a fingerprint of the extrinsics and of a sparse grid of unprojected pixels, which takes
+// a fraction of the time of the full LUT; the blobs are regenerated when it doesn't match. recorder_console.py
+// downloads the cache into a local calibration store, where utils.load_sensor_lut resolves the references.
+
+struct CalibrationEntry
+{
+    std::string deviceId;
+    std::string fingerprint;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::string lutHash;            // SHA-256 of the _lut.bin blob, 64 hex digits
+    std::string cameraModelHash;    // SHA-256 of the _camera_model.bin blob
+};
+
+class CalibrationCache
+{
+public:
+    // The cache of this device, under the app's LocalState
+    CalibrationCache();
+
+    // SHA-256 of the data, as 64 lowercase hex digits
+    static std::string HashHex(const void* pData, size_t size);
+
+    // False when the sensor has no entry with this fingerprint, or its blobs are missing
+    bool Lookup(const std::wstring& sensorName, const std::string& fingerprint, CalibrationEntry& entry) const;
+
+    // Writes the blobs, then the entry replacing the previous one of the sensor
+    CalibrationEntry Store(const std::wstring& sensorName, const std::string& fingerprint, uint32_t width, uint32_t height,
+        const std::vector<float>& lut, const std::vector<uint8_t>& cameraModel);
+
+    // Writes <sensor>_calibration.txt and <sensor>_camera_model.bin into the recording folder
+    void WriteReference(const std::wstring& sensorName, const CalibrationEntry& entry, const std::filesystem::path& recordingFolder) const;
+
+private:
+    std::filesystem::path GetEntryPath(const std::wstring& sensorName) const;
+    // <sensor>_<kind>_<first 16 digits of the hash>.bin
+    std::filesystem::path GetBlobPath(const std::wstring& sensorName, const wchar_t* kind, const std::string& hash) const;
+
+    std::string m_deviceId;
+    std::filesystem::path m_folder;
+};
@@ -0,0 +1,182 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+using namespace DirectX;
+
+// FilterDoubleExponential for many 3D positions at once (e.g. every hand joint).
+//	State is kept as structure of arrays, one XMVECTOR holds the x (or y, z) of four filters, so a whole group is
+//	filtered with the same instructions. The per-filter branches of FilterDoubleExponential become selects.
+//	Each lane gives the same results as its own FilterDoubleExponential with the same parameters, up to float rounding.
+
+class FilterDoubleExponentialBatch
+{
+public:
+	static constexpr size_t kLanesPerGroup = 4;
+
+	FilterDoubleExponentialBatch(size_t filterCount = 0) { SetParameters(); Resize(filterCount); }
+
+	// Rounds up to a multiple of kLanesPerGroup and resets every filter
+	void Resize(size_t filterCount)
+	{
+		m_groups.resize((filterCount + kLanesPerGroup - 1) / kLanesPerGroup);
+		Reset();
+	}
+
+	size_t GetFilterCount() const { return m_groups.size() * kLanesPerGroup; }
+
+	void SetParameters(float smoothing = 0.5f, float correction = 0.0f, float prediction = 0.0f, float jitterRadius = 0.05f, float maxDeviationRadius = 0.05f)
+	{
+		m_smoothing = smoothing;
+		m_correction = correction;
+		m_prediction = prediction;
+		m_jitterRadius = XMMax(0.0001f, jitterRadius);	// Same epsilon as FilterDoubleExponential
+		m_maxDeviationRadius = maxDeviationRadius;
+
+		Reset();
+	}
+
+	void Reset() { Reset(0, GetFilterCount()); }
+
+	// Resets filters [begin, end), both multiples of kLanesPerGroup
+	void Reset(size_t begin, size_t end)
+	{
+		for (size_t filterIndex = begin; filterIndex < end; filterIndex += kLanesPerGroup)
+		{
+			Group& group = m_groups[filterIndex / kLanesPerGroup];
+			for (auto* pVectors : { group.raw, group.filtered, group.trend, group.output })
+			{
+				for (int axis = 0; axis < 3; ++axis)
+					pVectors[axis] = XMVectorZero();
+			}
+			group.frameCount = XMVectorZero();
+		}
+	}
+
+	// Feeds one new raw position to filters [begin, end), both multiples of kLanesPerGroup.
+	//	Raw positions are indexed by filter, as separate x, y and z arrays.
+	void Update(const float* pRawX, const float* pRawY, const float* pRawZ, size_t begin, size_t end)
+	{
+		const XMVECTOR zero = XMVectorZero();
+		const XMVECTOR one = XMVectorSplatOne();
+		const XMVECTOR two = XMVectorReplicate(2.0f);
+		const XMVECTOR half = XMVectorReplicate(0.5f);
+		const XMVECTOR smoothing = XMVectorReplicate(m_smoothing);
+		const XMVECTOR oneMinusSmoothing = XMVectorReplicate(1.0f - m_smoothing);
+		const XMVECTOR correction = XMVectorReplicate(m_correction);
+		const XMVECTOR oneMinusCorrection = XMVectorReplicate(1.0f - m_correction);
+		const XMVECTOR prediction = XMVectorReplicate(m_prediction);
+		const XMVECTOR jitterRadius = XMVectorReplicate(m_jitterRadius);
+		const XMVECTOR maxDeviationRadius = XMVectorReplicate(m_maxDeviationRadius);
+
+		for (size_t filterIndex = begin; filterIndex < end; filterIndex += kLanesPerGroup)
+		{
+			Group& group = m_groups[filterIndex / kLanesPerGroup];
+
+			XMVECTOR raw[3] = {
+				XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pRawX + filterIndex)),
+				XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pRawY + filterIndex)),
+				XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pRawZ + filterIndex)) };
+
+			// Invalid (all zero) positions restart the filter
+			XMVECTOR isInvalid = XMVectorAndInt(XMVectorAndInt(XMVectorEqual(raw[0], zero), XMVectorEqual(raw[1], zero)), XMVectorEqual(raw[2], zero));
+			XMVECTOR frameCount = XMVectorSelect(group.frameCount, zero, isInvalid);
+			XMVECTOR isFirstFrame = XMVectorEqual(frameCount, zero);
+			XMVECTOR isSecondFrame = XMVectorEqual(frameCount, one);
+
+			// Jitter filter weight for the steady state case
+			XMVECTOR jitterDistance = Length(raw[0] - group.filtered[0], raw[1] - group.filtered[1], raw[2] - group.filtered[2]);
+			XMVECTOR isJitter = XMVectorLessOrEqual(jitterDistance, jitterRadius);
+			XMVECTOR jitterWeight = jitterDistance / jitterRadius;
+
+			XMVECTOR filtered[3], trend[3], predicted[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				// Second frame: average of the first two raw positions
+				XMVECTOR secondFiltered = (raw[axis] + group.raw[axis]) * half;
+
+				// Steady state: jitter filter, then double exponential smoothing
+				XMVECTOR dejittered = XMVectorSelect(raw[axis], raw[axis] * jitterDistance / jitterRadius + group.filtered[axis] * (one - jitterWeight), isJitter);
+				XMVECTOR steadyFiltered = dejittered * oneMinusSmoothing + (group.filtered[axis] + group.trend[axis]) * smoothing;
+
+				filtered[axis] = XMVectorSelect(XMVectorSelect(steadyFiltered, secondFiltered, isSecondFrame), raw[axis], isFirstFrame);
+				trend[axis] = XMVectorSelect((filtered[axis] - group.filtered[axis]) * correction + group.trend[axis] * oneMinusCorrection, zero, isFirstFrame);
+
+				// Predict into the future to reduce latency
+				predicted[axis] = filtered[axis] + trend[axis] * prediction;
+			}
+
+			// Pull the prediction back when it strays too far from the raw data
+			XMVECTOR deviationDistance = Length(predicted[0] - raw[0], predicted[1] - raw[1], predicted[2] - raw[2]);
+			XMVECTOR isTooFar = XMVectorGreater(deviationDistance, maxDeviationRadius);
+			XMVECTOR clampedDeviationDistance = XMVectorMax(deviationDistance, maxDeviationRadius);	// Keeps lanes that aren't pulled back finite
+			XMVECTOR deviationWeight = maxDeviationRadius / clampedDeviationDistance;
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				group.output[axis] = XMVectorSelect(predicted[axis], predicted[axis] * maxDeviationRadius / clampedDeviationDistance + raw[axis] * (one - deviationWeight), isTooFar);
+				group.raw[axis] = raw[axis];
+				group.filtered[axis] = filtered[axis];
+				group.trend[axis] = trend[axis];
+			}
+
+			// Only "first", "second" and "later" matter, so the count saturates
+			group.frameCount = XMVectorMin(frameCount + one, two);
+		}
+	}
+
+	// Filtered position with w = 1, as FilterDoubleExponential::GetFilteredValue returns it
+	XMVECTOR GetFilteredValue(size_t filterIndex) const
+	{
+		const Group& group = m_groups[filterIndex / kLanesPerGroup];
+		const uint32_t lane = (uint32_t)(filterIndex % kLanesPerGroup);
+		return XMVectorSet(XMVectorGetByIndex(group.output[0], lane), XMVectorGetByIndex(group.output[1], lane), XMVectorGetByIndex(group.output[2], lane), 1.0f);
+	}
+
+	// Filtered x, y and z of filters [begin, end), both multiples of kLanesPerGroup
+	void GetFilteredValues(float* pX, float* pY, float* pZ, size_t begin, size_t end) const
+	{
+		for (size_t filterIndex = begin; filterIndex < end; filterIndex += kLanesPerGroup)
+		{
+			const Group& group = m_groups[filterIndex / kLanesPerGroup];
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pX + filterIndex), group.output[0]);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pY + filterIndex), group.output[1]);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pZ + filterIndex), group.output[2]);
+		}
+	}
+
+private:
+	struct Group
+	{
+		XMVECTOR raw[3];
+		XMVECTOR filtered[3];
+		XMVECTOR trend[3];
+		XMVECTOR output[3];
+		XMVECTOR frameCount;	// Per lane, as float
+	};
+
+	static XMVECTOR Length(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z)
+	{
+		return XMVectorSqrt(x * x + y * y + z * z);
+	}
+
+	std::vector<Group> m_groups;
+
+	float m_smoothing;
+	float m_correction;
+	float m_prediction;
+	float m_jitterRadius;
+	float m_maxDeviationRadius;
+};
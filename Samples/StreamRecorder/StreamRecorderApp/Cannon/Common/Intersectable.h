@@ -22,4 +22,14 @@ public:
 
 	virtual bool TestRayIntersection(XMVECTOR rayOrigin, XMVECTOR rayDirection, float& distance, XMVECTOR& normal) = 0;
 
+	// Proximity queries are optional, systems that only support rays report no geometry nearby
+	virtual bool FindClosestPoint(XMVECTOR point, float maxDistance, XMVECTOR& closestPoint, XMVECTOR& normal, float& distance) { return false; }
+
+	virtual bool TestSphereIntersection(XMVECTOR sphereCenter, float sphereRadius)
+	{
+		XMVECTOR closestPoint, normal;
+		float distance;
+		return FindClosestPoint(sphereCenter, sphereRadius, closestPoint, normal, distance);
+	}
+
 };
\ No newline at end of file
@@ -0,0 +1,130 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "ParallelFor.h"
+#include "VertexCornerTable.h"
+
+#include <cfloat>
+#include <vector>
+
+// The bulk vertex and triangle loops of Mesh, templated on the vector math so that ParallelForBenchmark runs them on
+//	plain floats. VectorOps provides the Vector and Matrix types and static Add, Subtract, Cross, Normalize, Min, Max,
+//	Replicate, TransformCoord and TransformNormal functions with the semantics of their DirectXMath counterparts.
+//	Vertex needs position and normal members of type Vector. The chunks run through Chunks, which is ParallelForChunks
+//	unless a benchmark substitutes its own way of running them.
+
+struct PoolChunks
+{
+	size_t GetChunkCount(size_t count, size_t minCountPerThread) const
+	{
+		return GetParallelChunkCount(count, minCountPerThread);
+	}
+
+	template<typename Function>
+	void operator()(size_t count, size_t minCountPerThread, Function function) const
+	{
+		ParallelForChunks(count, minCountPerThread, function);
+	}
+};
+
+template<typename VectorOps, typename Vertex, typename Chunks = PoolChunks>
+void TransformMeshVertices(Vertex* pVertices, size_t vertexCount, const typename VectorOps::Matrix& transform,
+	size_t minVerticesPerThread, Chunks chunks = Chunks())
+{
+	chunks(vertexCount, minVerticesPerThread, [pVertices, &transform](size_t, size_t begin, size_t end)
+	{
+		for (size_t vertexIndex = begin; vertexIndex < end; ++vertexIndex)
+		{
+			Vertex& vertex = pVertices[vertexIndex];
+			vertex.position = VectorOps::TransformCoord(vertex.position, transform);
+			vertex.normal = VectorOps::Normalize(VectorOps::TransformNormal(vertex.normal, transform));
+		}
+	});
+}
+
+// Adds the area weighted normals of the triangles around each vertex to its normal, then normalizes it
+template<typename VectorOps, typename Vertex, typename Chunks = PoolChunks>
+void AccumulateSmoothNormals(Vertex* pVertices, size_t vertexCount, const unsigned* pIndices, size_t triangleCount,
+	size_t minVerticesPerThread, size_t minTrianglesPerThread, Chunks chunks = Chunks())
+{
+	typedef typename VectorOps::Vector Vector;
+
+	// Face normals are independent of each other, so compute them all up front
+	std::vector<Vector> faceNormals(triangleCount);
+	Vector* pFaceNormals = faceNormals.data();
+	chunks(triangleCount, minTrianglesPerThread, [pIndices, pVertices, pFaceNormals](size_t, size_t begin, size_t end)
+	{
+		for (size_t triangleIndex = begin; triangleIndex < end; ++triangleIndex)
+		{
+			const Vertex& a = pVertices[pIndices[triangleIndex * 3 + 0]];
+			const Vertex& b = pVertices[pIndices[triangleIndex * 3 + 1]];
+			const Vertex& c = pVertices[pIndices[triangleIndex * 3 + 2]];
+			pFaceNormals[triangleIndex] = VectorOps::Cross(VectorOps::Subtract(a.position, b.position), VectorOps::Subtract(c.position, b.position));
+		}
+	});
+
+	// Gather the face normals per vertex instead of scattering them, so vertices can be summed in parallel. The corner
+	//	table keeps the per vertex summation order of a serial walk over the triangles.
+	std::vector<unsigned> cornerOffsets;
+	std::vector<unsigned> cornerTriangles;
+	BuildVertexCornerTable(pIndices, triangleCount * 3, vertexCount, cornerOffsets, cornerTriangles);
+
+	const unsigned* pCornerOffsets = cornerOffsets.data();
+	const unsigned* pCornerTriangles = cornerTriangles.data();
+	chunks(vertexCount, minVerticesPerThread, [pVertices, pFaceNormals, pCornerOffsets, pCornerTriangles](size_t, size_t begin, size_t end)
+	{
+		for (size_t vertexIndex = begin; vertexIndex < end; ++vertexIndex)
+		{
+			Vector normal = pVertices[vertexIndex].normal;
+			for (unsigned corner = pCornerOffsets[vertexIndex]; corner < pCornerOffsets[vertexIndex + 1]; ++corner)
+				normal = VectorOps::Add(normal, pFaceNormals[pCornerTriangles[corner]]);
+
+			pVertices[vertexIndex].normal = VectorOps::Normalize(normal);
+		}
+	});
+}
+
+// Min/max reduction is done on whole vectors, one partial result per chunk, then folded together
+template<typename VectorOps, typename Vertex, typename Chunks = PoolChunks>
+void ComputePositionBounds(const Vertex* pVertices, size_t vertexCount, size_t minVerticesPerThread,
+	typename VectorOps::Vector& minPosition, typename VectorOps::Vector& maxPosition, Chunks chunks = Chunks())
+{
+	typedef typename VectorOps::Vector Vector;
+
+	const size_t chunkCount = chunks.GetChunkCount(vertexCount, minVerticesPerThread);
+	std::vector<Vector> chunkMins(chunkCount, VectorOps::Replicate(FLT_MAX));
+	std::vector<Vector> chunkMaxs(chunkCount, VectorOps::Replicate(-FLT_MAX));
+
+	Vector* pChunkMins = chunkMins.data();
+	Vector* pChunkMaxs = chunkMaxs.data();
+	chunks(vertexCount, minVerticesPerThread, [pVertices, pChunkMins, pChunkMaxs](size_t chunkIndex, size_t begin, size_t end)
+	{
+		Vector chunkMin = pChunkMins[chunkIndex];
+		Vector chunkMax = pChunkMaxs[chunkIndex];
+		for (size_t vertexIndex = begin; vertexIndex < end; ++vertexIndex)
+		{
+			chunkMin = VectorOps::Min(chunkMin, pVertices[vertexIndex].position);
+			chunkMax = VectorOps::Max(chunkMax, pVertices[vertexIndex].position);
+		}
+		pChunkMins[chunkIndex] = chunkMin;
+		pChunkMaxs[chunkIndex] = chunkMax;
+	});
+
+	minPosition = chunkMins[0];
+	maxPosition = chunkMaxs[0];
+	for (size_t chunkIndex = 1; chunkIndex < chunkCount; ++chunkIndex)
+	{
+		minPosition = VectorOps::Min(minPosition, chunkMins[chunkIndex]);
+		maxPosition = VectorOps::Max(maxPosition, chunkMaxs[chunkIndex]);
+	}
+}
@@ -0,0 +1,212 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cfloat>
+#include <utility>
+#include <vector>
+
+// The octree of Mesh::BoundingBoxNode and its closest point search, templated on the vector math like MeshKernels.h so
+//	that MeshSimplificationBenchmark runs them on plain floats. On top of the operations of MeshKernels.h, VectorOps
+//	provides Scale, Abs, Dot (returning a float over x, y and z), InBounds (XMVector3InBounds), Load3 and Store3 (from
+//	and to the type of a box's Center and Extents). Node has boundingBox and triangleBounds boxes with Center and
+//	Extents members, like DirectX::BoundingBox, plus indicesContained and children.
+
+// Real-Time Collision Detection (Ericson), 5.1.5
+template<typename VectorOps>
+typename VectorOps::Vector ClosestPointOnTriangle(const typename VectorOps::Vector& p, const typename VectorOps::Vector& a,
+	const typename VectorOps::Vector& b, const typename VectorOps::Vector& c)
+{
+	typedef typename VectorOps::Vector Vector;
+
+	Vector ab = VectorOps::Subtract(b, a);
+	Vector ac = VectorOps::Subtract(c, a);
+	Vector ap = VectorOps::Subtract(p, a);
+
+	float d1 = VectorOps::Dot(ab, ap);
+	float d2 = VectorOps::Dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+		return a;
+
+	Vector bp = VectorOps::Subtract(p, b);
+	float d3 = VectorOps::Dot(ab, bp);
+	float d4 = VectorOps::Dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3)
+		return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		return VectorOps::Add(a, VectorOps::Scale(ab, d1 / (d1 - d3)));
+
+	Vector cp = VectorOps::Subtract(p, c);
+	float d5 = VectorOps::Dot(ab, cp);
+	float d6 = VectorOps::Dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6)
+		return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		return VectorOps::Add(a, VectorOps::Scale(ac, d2 / (d2 - d6)));
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		return VectorOps::Add(b, VectorOps::Scale(VectorOps::Subtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+
+	float denom = 1.0f / (va + vb + vc);
+	return VectorOps::Add(VectorOps::Add(a, VectorOps::Scale(ab, vb * denom)), VectorOps::Scale(ac, vc * denom));
+}
+
+template<typename VectorOps, typename Box>
+float DistanceSquaredToBox(const typename VectorOps::Vector& point, const Box& box)
+{
+	typename VectorOps::Vector outside = VectorOps::Max(VectorOps::Subtract(VectorOps::Abs(VectorOps::Subtract(point, VectorOps::Load3(box.Center))),
+		VectorOps::Load3(box.Extents)), VectorOps::Replicate(0.0f));
+	return VectorOps::Dot(outside, outside);
+}
+
+// Keeps the triangles of indices that have a vertex in node.boundingBox (all of them at depth 1), and splits the node
+//	into 8 children while they number more than targetTriangleCount
+template<typename VectorOps, typename Node, typename Vertex>
+void GenerateOctreeNodes(Node& node, const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices, unsigned currentDepth,
+	size_t targetTriangleCount)
+{
+	typedef typename VectorOps::Vector Vector;
+
+	node.indicesContained.clear();
+	if (currentDepth == 1)
+	{
+		node.indicesContained = indices;
+	}
+	else
+	{
+		const Vector center = VectorOps::Load3(node.boundingBox.Center);
+		const Vector extents = VectorOps::Load3(node.boundingBox.Extents);
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			unsigned indexA = indices[i + 0];
+			unsigned indexB = indices[i + 1];
+			unsigned indexC = indices[i + 2];
+
+			if (VectorOps::InBounds(VectorOps::Subtract(vertices[indexA].position, center), extents) ||
+				VectorOps::InBounds(VectorOps::Subtract(vertices[indexB].position, center), extents) ||
+				VectorOps::InBounds(VectorOps::Subtract(vertices[indexC].position, center), extents))
+			{
+				node.indicesContained.push_back(indexA);
+				node.indicesContained.push_back(indexB);
+				node.indicesContained.push_back(indexC);
+			}
+		}
+	}
+
+	Vector minPosition = VectorOps::Replicate(FLT_MAX);
+	Vector maxPosition = VectorOps::Replicate(-FLT_MAX);
+	for (unsigned index : node.indicesContained)
+	{
+		minPosition = VectorOps::Min(minPosition, vertices[index].position);
+		maxPosition = VectorOps::Max(maxPosition, vertices[index].position);
+	}
+	if (node.indicesContained.empty())
+		minPosition = maxPosition = VectorOps::Load3(node.boundingBox.Center);
+	VectorOps::Store3(VectorOps::Scale(VectorOps::Add(minPosition, maxPosition), 0.5f), node.triangleBounds.Center);
+	VectorOps::Store3(VectorOps::Scale(VectorOps::Subtract(maxPosition, minPosition), 0.5f), node.triangleBounds.Extents);
+
+	if (indices.size() / 3 > targetTriangleCount)
+	{
+		auto childExtents = node.boundingBox.Extents;
+		childExtents.x = node.boundingBox.Extents.x / 2.0f;
+		childExtents.y = node.boundingBox.Extents.y / 2.0f;
+		childExtents.z = node.boundingBox.Extents.z / 2.0f;
+
+		float xSigns[8] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+		float ySigns[8] = { 1.0f, 1.0f, 1.0f, 1.0f, -1.0f, -1.0f, -1.0f, -1.0f };
+		float zSigns[8] = { 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f };
+
+		node.children.resize(8);
+		for (unsigned i = 0; i < 8; ++i)
+		{
+			auto& child = node.children[i];
+			child.boundingBox.Center.x = node.boundingBox.Center.x + xSigns[i] * childExtents.x;
+			child.boundingBox.Center.y = node.boundingBox.Center.y + ySigns[i] * childExtents.y;
+			child.boundingBox.Center.z = node.boundingBox.Center.z + zSigns[i] * childExtents.z;
+			child.boundingBox.Extents = childExtents;
+			GenerateOctreeNodes<VectorOps>(child, vertices, node.indicesContained, currentDepth + 1, targetTriangleCount);
+		}
+	}
+	else
+	{
+		node.children.clear();
+	}
+}
+
+// Only looks for points closer than sqrt(closestDistanceSquared), which is tightened as closer triangles are found
+template<typename VectorOps, typename Node, typename Vertex>
+bool FindClosestPointInOctree(const Node& node, const std::vector<Vertex>& vertices, const typename VectorOps::Vector& pointInLocalSpace,
+	float& closestDistanceSquared, typename VectorOps::Vector& closestPointInLocalSpace, typename VectorOps::Vector& normalInLocalSpace)
+{
+	typedef typename VectorOps::Vector Vector;
+
+	if (DistanceSquaredToBox<VectorOps>(pointInLocalSpace, node.triangleBounds) >= closestDistanceSquared)
+		return false;
+
+	bool found = false;
+
+	if (!node.children.empty())
+	{
+		// Visit nearer children first so the search radius shrinks early and prunes the rest (insertion sort, at most 8)
+		std::pair<float, unsigned> childOrder[8];
+		unsigned childCount = 0;
+		for (unsigned i = 0; i < node.children.size() && i < 8; ++i)
+		{
+			if (!node.children[i].indicesContained.empty())
+				childOrder[childCount++] = { DistanceSquaredToBox<VectorOps>(pointInLocalSpace, node.children[i].triangleBounds), i };
+		}
+		for (unsigned i = 1; i < childCount; ++i)
+		{
+			for (unsigned j = i; j > 0 && childOrder[j] < childOrder[j - 1]; --j)
+				std::swap(childOrder[j], childOrder[j - 1]);
+		}
+
+		for (unsigned i = 0; i < childCount; ++i)
+		{
+			if (childOrder[i].first >= closestDistanceSquared)
+				break;
+
+			if (FindClosestPointInOctree<VectorOps>(node.children[childOrder[i].second], vertices, pointInLocalSpace, closestDistanceSquared,
+				closestPointInLocalSpace, normalInLocalSpace))
+				found = true;
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < node.indicesContained.size(); i += 3)
+		{
+			Vector v1 = vertices[node.indicesContained[i + 0]].position;
+			Vector v2 = vertices[node.indicesContained[i + 1]].position;
+			Vector v3 = vertices[node.indicesContained[i + 2]].position;
+
+			Vector pointOnTriangle = ClosestPointOnTriangle<VectorOps>(pointInLocalSpace, v1, v2, v3);
+			Vector offset = VectorOps::Subtract(pointOnTriangle, pointInLocalSpace);
+			float distanceSquared = VectorOps::Dot(offset, offset);
+			if (distanceSquared < closestDistanceSquared)
+			{
+				closestDistanceSquared = distanceSquared;
+				closestPointInLocalSpace = pointOnTriangle;
+
+				// Same (clockwise) convention as the ray test
+				normalInLocalSpace = VectorOps::Normalize(VectorOps::Cross(VectorOps::Subtract(v3, v1), VectorOps::Subtract(v2, v1)));
+				found = true;
+			}
+		}
+	}
+
+	return found;
+}
@@ -0,0 +1,175 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Splits [0, count) into contiguous chunks and calls function(chunkIndex, begin, end) for each of them.
+//	Below minCountPerThread * 2 elements everything runs inline on the calling thread as a single chunk,
+//	so small meshes don't pay for waking the pool. Chunks are contiguous and ordered by chunkIndex, so callers
+//	that need per-chunk partial results (reductions) can size their scratch buffers with GetParallelChunkCount.
+
+inline size_t GetParallelChunkCount(size_t count, size_t minCountPerThread)
+{
+	if (minCountPerThread == 0)
+		minCountPerThread = 1;
+
+	size_t hardwareThreadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+	size_t chunkCount = std::min(hardwareThreadCount, count / minCountPerThread);
+	return std::max<size_t>(1, chunkCount);
+}
+
+// Worker threads shared by every ParallelForChunks call, started on first use. The calling thread works on the
+//	chunks too. One call uses the workers at a time: a call made while they are busy (from another thread, or nested
+//	inside a chunk) runs its chunks inline instead of waiting.
+class ParallelForPool
+{
+public:
+	static ParallelForPool& Get()
+	{
+		static ParallelForPool s_pool(std::max<size_t>(1, std::thread::hardware_concurrency()) - 1);
+		return s_pool;
+	}
+
+	explicit ParallelForPool(size_t workerCount)
+	{
+		m_workers.reserve(workerCount);
+		for (size_t workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+			m_workers.emplace_back([this]() { WorkerLoop(); });
+	}
+
+	~ParallelForPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exit = true;
+		}
+		m_workAvailable.notify_all();
+		for (auto& worker : m_workers)
+			worker.join();
+	}
+
+	ParallelForPool(const ParallelForPool&) = delete;
+	ParallelForPool& operator=(const ParallelForPool&) = delete;
+
+	size_t GetWorkerCount() const { return m_workers.size(); }
+
+	// Calls task(chunkIndex) for every chunkIndex in [0, chunkCount) and returns once all of them are done
+	void Run(size_t chunkCount, const std::function<void(size_t)>& task)
+	{
+		if (m_workers.empty() || chunkCount < 2 || m_busy.exchange(true, std::memory_order_acquire))
+		{
+			for (size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+				task(chunkIndex);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_pTask = &task;
+			m_chunkCount = chunkCount;
+			m_nextChunk.store(0, std::memory_order_relaxed);
+			++m_generation;
+		}
+		m_workAvailable.notify_all();
+
+		RunChunks(task, chunkCount);
+
+		// Workers that picked up this task may still be in a chunk. Ones that haven't woken up yet find no task.
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_workDone.wait(lock, [this]() { return m_activeWorkerCount == 0; });
+		m_pTask = nullptr;
+		m_busy.store(false, std::memory_order_release);
+	}
+
+private:
+	void RunChunks(const std::function<void(size_t)>& task, size_t chunkCount)
+	{
+		for (;;)
+		{
+			const size_t chunkIndex = m_nextChunk.fetch_add(1, std::memory_order_relaxed);
+			if (chunkIndex >= chunkCount)
+				return;
+			task(chunkIndex);
+		}
+	}
+
+	void WorkerLoop()
+	{
+		uint64_t seenGeneration = 0;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (;;)
+		{
+			m_workAvailable.wait(lock, [&]() { return m_exit || m_generation != seenGeneration; });
+			if (m_exit)
+				return;
+
+			seenGeneration = m_generation;
+			if (!m_pTask)
+				continue;
+
+			const std::function<void(size_t)>* pTask = m_pTask;
+			const size_t chunkCount = m_chunkCount;
+			++m_activeWorkerCount;
+			lock.unlock();
+
+			RunChunks(*pTask, chunkCount);
+
+			lock.lock();
+			if (--m_activeWorkerCount == 0)
+				m_workDone.notify_one();
+		}
+	}
+
+	std::vector<std::thread> m_workers;
+	std::atomic<bool> m_busy{ false };
+
+	std::mutex m_mutex;
+	std::condition_variable m_workAvailable;
+	std::condition_variable m_workDone;
+	const std::function<void(size_t)>* m_pTask = nullptr;
+	size_t m_chunkCount = 0;
+	uint64_t m_generation = 0;
+	size_t m_activeWorkerCount = 0;
+	bool m_exit = false;
+
+	std::atomic<size_t> m_nextChunk{ 0 };
+};
+
+template<typename Function>
+inline void ParallelForChunks(size_t count, size_t minCountPerThread, Function function)
+{
+	if (count == 0)
+		return;
+
+	const size_t chunkCount = GetParallelChunkCount(count, minCountPerThread);
+	if (chunkCount == 1)
+	{
+		function((size_t)0, (size_t)0, count);
+		return;
+	}
+
+	const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+	ParallelForPool::Get().Run(chunkCount, [&](size_t chunkIndex)
+	{
+		size_t begin = std::min(count, chunkIndex * chunkSize);
+		size_t end = std::min(count, begin + chunkSize);
+		function(chunkIndex, begin, end);
+	});
+}
@@ -0,0 +1,322 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+// Decides which spatial surfaces get (re)meshed next and runs the work on a small thread pool.
+//	Only depends on the standard library so it can be driven by a stand-in surface source off device.
+//
+// The owner calls Submit() with every currently observed surface whenever it polls the system. Surfaces that were
+//	never processed go first, closest to the head first. Already processed ones are only picked up again once their
+//	update time moved past minimumUpdateInterval, and are then ordered by distance scaled down by how long ago they
+//	were last processed. Finished results are handed to the publish function in batches.
+//
+// SurfaceID needs operator<. ProcessFunction is called concurrently from the worker threads, PublishFunction too
+//	(never with an empty batch).
+
+struct SurfaceSchedulerMetrics
+{
+	size_t knownSurfaceCount = 0;		// Surfaces in the last Submit
+	size_t coveredSurfaceCount = 0;		// Of those, how many have been published at least once
+	size_t pendingCount = 0;
+	size_t inFlightCount = 0;
+	size_t processedCount = 0;			// Total successful results
+	size_t failedCount = 0;				// Total ProcessFunction calls that returned false
+
+	// Seconds from the first Submit until the covered fraction first reached 50/90/100%, negative until it did
+	double timeToHalfCoverage = -1.0;
+	double timeToNinetyPercentCoverage = -1.0;
+	double timeToFullCoverage = -1.0;
+
+	double averageLatency = 0.0;		// Seconds from a surface getting queued until its result was published
+};
+
+template<typename SurfaceID, typename Surface, typename Result>
+class SurfaceScheduler
+{
+public:
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct Candidate
+	{
+		SurfaceID id;
+		Surface surface;
+		float distanceToHead;		// Meters, from the head to the surface bounds center
+		long long updateTime;		// Time the system last updated the surface, any monotonic unit matching minimumUpdateInterval
+	};
+
+	struct Settings
+	{
+		unsigned workerCount = 3;							// Number of surfaces being computed/converted at once
+		size_t maxBatchSize = 8;							// Publish as soon as this many results are waiting...
+		Clock::duration publishInterval = std::chrono::milliseconds(100);	// ...or once the oldest waiting result is this old
+		long long minimumUpdateInterval = 5 * 10000000ll;	// Skip surface updates newer than this since the last processed one
+		float stalenessScaleSeconds = 10.0f;				// Distance priority halves after this long without processing
+	};
+
+	typedef SurfaceSchedulerMetrics Metrics;
+
+	// Returns false if nothing usable came out (e.g. mesh computation timed out), the surface will be retried on a later Submit
+	typedef std::function<bool(const Surface& surface, Result& result)> ProcessFunction;
+	typedef std::function<void(std::vector<Result>&& batch)> PublishFunction;
+
+	SurfaceScheduler(ProcessFunction processFunction, PublishFunction publishFunction, const Settings& settings = Settings()) :
+		m_processFunction(processFunction),
+		m_publishFunction(publishFunction),
+		m_settings(settings)
+	{
+		for (unsigned workerIndex = 0; workerIndex < std::max(1u, m_settings.workerCount); ++workerIndex)
+			m_workerThreads.emplace_back(&SurfaceScheduler::WorkerThreadFunction, this);
+	}
+
+	~SurfaceScheduler()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exit = true;
+		}
+		m_workAvailable.notify_all();
+
+		for (auto& thread : m_workerThreads)
+			thread.join();
+	}
+
+	// Replaces the pending queue with the given set of observed surfaces. Surfaces missing from it are forgotten.
+	void Submit(const std::vector<Candidate>& candidates)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		const Clock::time_point now = Clock::now();
+		if (!m_hasSubmitted)
+		{
+			m_hasSubmitted = true;
+			m_firstSubmitTime = now;
+		}
+
+		std::map<SurfaceID, Clock::time_point> previousQueueTimes;
+		for (auto& entry : m_pending)
+			previousQueueTimes[entry.candidate.id] = entry.queueTime;
+		m_pending.clear();
+
+		std::set<SurfaceID> knownIDs;
+		for (auto& candidate : candidates)
+		{
+			knownIDs.insert(candidate.id);
+
+			if (m_inFlightIDs.count(candidate.id))
+				continue;
+
+			auto processedIterator = m_processedSurfaces.find(candidate.id);
+			if (processedIterator != m_processedSurfaces.end() &&
+				candidate.updateTime - processedIterator->second.updateTime <= m_settings.minimumUpdateInterval)
+				continue;
+
+			PendingEntry entry;
+			entry.candidate = candidate;
+			auto previousQueueTime = previousQueueTimes.find(candidate.id);
+			entry.queueTime = (previousQueueTime != previousQueueTimes.end()) ? previousQueueTime->second : now;
+			m_pending.push_back(entry);
+		}
+
+		for (auto iterator = m_processedSurfaces.begin(); iterator != m_processedSurfaces.end();)
+		{
+			if (!knownIDs.count(iterator->first) && !m_inFlightIDs.count(iterator->first))
+				iterator = m_processedSurfaces.erase(iterator);
+			else
+				++iterator;
+		}
+
+		m_knownIDs.swap(knownIDs);
+		UpdateCoverage(now);
+
+		if (!m_pending.empty())
+			m_workAvailable.notify_all();
+	}
+
+	size_t GetPendingCount()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_pending.size() + m_inFlightIDs.size();
+	}
+
+	Metrics GetMetrics()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Metrics metrics = m_metrics;
+		metrics.knownSurfaceCount = m_knownIDs.size();
+		metrics.pendingCount = m_pending.size();
+		metrics.inFlightCount = m_inFlightIDs.size();
+		metrics.averageLatency = (m_latencySampleCount > 0) ? m_totalLatency / m_latencySampleCount : 0.0;
+		return metrics;
+	}
+
+private:
+
+	struct PendingEntry
+	{
+		Candidate candidate;
+		Clock::time_point queueTime;
+	};
+
+	struct ProcessedSurface
+	{
+		long long updateTime = 0;
+		Clock::time_point processedTime;
+		bool published = false;
+	};
+
+	ProcessFunction m_processFunction;
+	PublishFunction m_publishFunction;
+	const Settings m_settings;
+
+	std::mutex m_mutex;
+	std::condition_variable m_workAvailable;
+	bool m_exit = false;
+
+	std::vector<PendingEntry> m_pending;
+	std::set<SurfaceID> m_inFlightIDs;
+	std::map<SurfaceID, ProcessedSurface> m_processedSurfaces;
+	std::set<SurfaceID> m_knownIDs;
+
+	std::vector<Result> m_batch;
+	std::vector<std::pair<SurfaceID, Clock::time_point>> m_batchQueueTimes;
+	Clock::time_point m_batchStartTime;
+
+	bool m_hasSubmitted = false;
+	Clock::time_point m_firstSubmitTime;
+	Metrics m_metrics;
+	double m_totalLatency = 0.0;
+	size_t m_latencySampleCount = 0;
+
+	std::vector<std::thread> m_workerThreads;
+
+	// Lower is more urgent. Expects m_mutex to be held.
+	std::pair<int, float> GetPriority(const PendingEntry& entry, Clock::time_point now) const
+	{
+		auto processedIterator = m_processedSurfaces.find(entry.candidate.id);
+		if (processedIterator == m_processedSurfaces.end())
+			return { 0, entry.candidate.distanceToHead };
+
+		const float stalenessSeconds = std::chrono::duration<float>(now - processedIterator->second.processedTime).count();
+		return { 1, entry.candidate.distanceToHead / (1.0f + stalenessSeconds / m_settings.stalenessScaleSeconds) };
+	}
+
+	// Expects m_mutex to be held
+	void UpdateCoverage(Clock::time_point now)
+	{
+		size_t coveredCount = 0;
+		for (auto& id : m_knownIDs)
+		{
+			auto processedIterator = m_processedSurfaces.find(id);
+			if (processedIterator != m_processedSurfaces.end() && processedIterator->second.published)
+				++coveredCount;
+		}
+		m_metrics.coveredSurfaceCount = coveredCount;
+
+		if (m_knownIDs.empty())
+			return;
+
+		const double coverage = coveredCount / (double)m_knownIDs.size();
+		const double elapsed = std::chrono::duration<double>(now - m_firstSubmitTime).count();
+		if (coverage >= 0.5 && m_metrics.timeToHalfCoverage < 0.0)
+			m_metrics.timeToHalfCoverage = elapsed;
+		if (coverage >= 0.9 && m_metrics.timeToNinetyPercentCoverage < 0.0)
+			m_metrics.timeToNinetyPercentCoverage = elapsed;
+		if (coverage >= 1.0 && m_metrics.timeToFullCoverage < 0.0)
+			m_metrics.timeToFullCoverage = elapsed;
+	}
+
+	void WorkerThreadFunction()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		for (;;)
+		{
+			m_workAvailable.wait(lock, [this] { return m_exit || !m_pending.empty(); });
+			if (m_exit)
+				break;
+
+			// Queues are a few hundred surfaces at most, a linear scan is cheaper than keeping a heap in sync with Submit
+			const Clock::time_point now = Clock::now();
+			auto bestEntry = std::min_element(m_pending.begin(), m_pending.end(), [this, now](const PendingEntry& a, const PendingEntry& b)
+			{
+				return GetPriority(a, now) < GetPriority(b, now);
+			});
+
+			PendingEntry entry = *bestEntry;
+			m_pending.erase(bestEntry);
+			m_inFlightIDs.insert(entry.candidate.id);
+
+			lock.unlock();
+			Result result;
+			const bool succeeded = m_processFunction(entry.candidate.surface, result);
+			lock.lock();
+
+			m_inFlightIDs.erase(entry.candidate.id);
+
+			if (!succeeded)
+			{
+				++m_metrics.failedCount;
+			}
+			else
+			{
+				++m_metrics.processedCount;
+
+				ProcessedSurface& processedSurface = m_processedSurfaces[entry.candidate.id];
+				processedSurface.updateTime = entry.candidate.updateTime;
+				processedSurface.processedTime = Clock::now();
+
+				if (m_batch.empty())
+					m_batchStartTime = processedSurface.processedTime;
+				m_batch.push_back(std::move(result));
+				m_batchQueueTimes.emplace_back(entry.candidate.id, entry.queueTime);
+			}
+
+			const bool isIdle = m_pending.empty() && m_inFlightIDs.empty();
+			const bool publishNow = !m_batch.empty() &&
+				(m_batch.size() >= m_settings.maxBatchSize || isIdle || Clock::now() - m_batchStartTime >= m_settings.publishInterval);
+			if (!publishNow)
+				continue;
+
+			std::vector<Result> batch;
+			batch.swap(m_batch);
+			std::vector<std::pair<SurfaceID, Clock::time_point>> batchQueueTimes;
+			batchQueueTimes.swap(m_batchQueueTimes);
+
+			lock.unlock();
+			m_publishFunction(std::move(batch));
+			lock.lock();
+
+			const Clock::time_point publishTime = Clock::now();
+			for (auto& idQueueTime : batchQueueTimes)
+			{
+				auto processedIterator = m_processedSurfaces.find(idQueueTime.first);
+				if (processedIterator != m_processedSurfaces.end())
+					processedIterator->second.published = true;
+
+				m_totalLatency += std::chrono::duration<double>(publishTime - idQueueTime.second).count();
+				++m_latencySampleCount;
+			}
+			UpdateCoverage(publishTime);
+		}
+	}
+};
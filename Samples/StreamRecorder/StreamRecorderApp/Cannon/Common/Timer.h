@@ -54,6 +54,18 @@ public:
         OutputDebugStringA(outputString);
     }
 
+	// The frequency is fixed at boot, so it is only queried once
+	static long long GetFrequency()
+	{
+		static const long long s_frequency = []()
+		{
+			LARGE_INTEGER freq;
+			QueryPerformanceFrequency(&freq);
+			return freq.QuadPart;
+		}();
+		return s_frequency;
+	}
+
 	// Returns the total time from QueryPerformanceCounter in 100's of nanoseconds
 	static unsigned long long GetSystemRelativeTime()
 	{
@@ -62,10 +74,10 @@ public:
 		LARGE_INTEGER time;
 		QueryPerformanceCounter(&time);
 
-		LARGE_INTEGER freq;
-		QueryPerformanceFrequency(&freq);
-
-		return (time.QuadPart * 10000000 / freq.QuadPart);
+		// Whole seconds apart, so the multiplication doesn't overflow after a day of uptime
+		const unsigned long long freq = GetFrequency();
+		const unsigned long long counts = time.QuadPart;
+		return (counts / freq) * 10000000 + (counts % freq) * 10000000 / freq;
 	}
 
 	static double GetSystemRelativeTimeInSeconds()
@@ -75,10 +87,7 @@ public:
 		LARGE_INTEGER time;
 		QueryPerformanceCounter(&time);
 
-		LARGE_INTEGER freq;
-		QueryPerformanceFrequency(&freq);
-
-		return time.QuadPart / (double) freq.QuadPart;
+		return time.QuadPart / (double) GetFrequency();
 	}
 
 	static unsigned long long GetFileTime()
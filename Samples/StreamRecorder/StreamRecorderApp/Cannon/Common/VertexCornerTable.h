@@ -0,0 +1,33 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <vector>
+
+// Vertex -> triangle-corner table of an index buffer (counting sort over the indices). The triangles touching vertex v
+//	are cornerTriangles[cornerOffsets[v]] to cornerTriangles[cornerOffsets[v + 1] - 1], in index buffer order, so a
+//	per-vertex gather over them sums in the same order as a serial scatter over the triangles.
+inline void BuildVertexCornerTable(const unsigned* pIndices, size_t indexCount, size_t vertexCount,
+	std::vector<unsigned>& cornerOffsets, std::vector<unsigned>& cornerTriangles)
+{
+	cornerOffsets.assign(vertexCount + 1, 0);
+	for (size_t index = 0; index < indexCount; ++index)
+		++cornerOffsets[pIndices[index] + 1];
+
+	for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex)
+		cornerOffsets[vertexIndex + 1] += cornerOffsets[vertexIndex];
+
+	cornerTriangles.resize(indexCount);
+	std::vector<unsigned> writePositions(cornerOffsets.begin(), cornerOffsets.end() - 1);
+	for (size_t index = 0; index < indexCount; ++index)
+		cornerTriangles[writePositions[pIndices[index]]++] = (unsigned)(index / 3);
+}
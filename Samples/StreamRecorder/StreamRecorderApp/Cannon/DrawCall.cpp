@@ -13,7 +13,11 @@
 
 #include "DrawCall.h"
 #include "Common/FileUtilities.h"
+#include "Common/MeshKernels.h"
+#include "Common/MeshOctree.h"
+#include "Common/ParallelFor.h"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -24,6 +28,34 @@
 
 using namespace std;
 
+// Below these sizes bulk mesh operations aren't worth spreading across threads
+static const size_t kMinVerticesPerThread = 4096;
+static const size_t kMinTrianglesPerThread = 4096;
+static const size_t kMinDiscsPerThread = 64;
+
+// DirectXMath for the mesh kernels of MeshKernels.h and the octree of MeshOctree.h
+struct XMVectorOps
+{
+	typedef XMVECTOR Vector;
+	typedef XMMATRIX Matrix;
+
+	static XMVECTOR XM_CALLCONV Add(FXMVECTOR a, FXMVECTOR b) { return XMVectorAdd(a, b); }
+	static XMVECTOR XM_CALLCONV Subtract(FXMVECTOR a, FXMVECTOR b) { return XMVectorSubtract(a, b); }
+	static XMVECTOR XM_CALLCONV Scale(FXMVECTOR v, float scale) { return XMVectorScale(v, scale); }
+	static XMVECTOR XM_CALLCONV Abs(FXMVECTOR v) { return XMVectorAbs(v); }
+	static float XM_CALLCONV Dot(FXMVECTOR a, FXMVECTOR b) { return XMVectorGetX(XMVector3Dot(a, b)); }
+	static XMVECTOR XM_CALLCONV Cross(FXMVECTOR a, FXMVECTOR b) { return XMVector3Cross(a, b); }
+	static XMVECTOR XM_CALLCONV Normalize(FXMVECTOR v) { return XMVector3Normalize(v); }
+	static XMVECTOR XM_CALLCONV Min(FXMVECTOR a, FXMVECTOR b) { return XMVectorMin(a, b); }
+	static XMVECTOR XM_CALLCONV Max(FXMVECTOR a, FXMVECTOR b) { return XMVectorMax(a, b); }
+	static XMVECTOR XM_CALLCONV Replicate(float value) { return XMVectorReplicate(value); }
+	static bool XM_CALLCONV InBounds(FXMVECTOR v, FXMVECTOR bounds) { return XMVector3InBounds(v, bounds); }
+	static XMVECTOR XM_CALLCONV Load3(const XMFLOAT3& v) { return XMLoadFloat3(&v); }
+	static void XM_CALLCONV Store3(FXMVECTOR v, XMFLOAT3& destination) { XMStoreFloat3(&destination, v); }
+	static XMVECTOR XM_CALLCONV TransformCoord(FXMVECTOR v, const XMMATRIX& m) { return XMVector3TransformCoord(v, m); }
+	static XMVECTOR XM_CALLCONV TransformNormal(FXMVECTOR v, const XMMATRIX& m) { return XMVector3TransformNormal(v, m); }
+};
+
 Microsoft::WRL::ComPtr<ID3D11Device> g_d3dDevice;
 Microsoft::WRL::ComPtr<ID3D11DeviceContext> g_d3dContext;
 
@@ -1291,7 +1323,7 @@ void Mesh::LoadSphere()
 	m_d3dBuffersNeedUpdate = true;
 }
 
-void AppendVerticesForCircleDisc(std::vector<Mesh::Vertex>& vertices, const Mesh::Disc& disc, const unsigned segmentCount)
+void WriteVerticesForCircleDisc(Mesh::Vertex* pVertices, const Mesh::Disc& disc, const unsigned segmentCount)
 {
 	Mesh::Vertex v;
 	memset(&v, 0, sizeof(v));
@@ -1303,11 +1335,11 @@ void AppendVerticesForCircleDisc(std::vector<Mesh::Vertex>& vertices, const Mesh
 
 		XMVECTOR localPosition = XMVector3Transform(discEdgeStartPosition, XMMatrixRotationAxis(disc.upDir, yawAngle));
 		v.position = XMVectorSetW(disc.center + localPosition, 1.0f);
-		vertices.push_back(v);
+		pVertices[discEdgeIndex] = v;
 	}
 }
 
-void AppendVerticesForSquareDisc(std::vector<Mesh::Vertex>& vertices, const Mesh::Disc& disc, const unsigned segmentCount)
+void WriteVerticesForSquareDisc(Mesh::Vertex* pVertices, const Mesh::Disc& disc, const unsigned segmentCount)
 {
 	const float curveRadius = disc.radiusRight * 0.2f;
 
@@ -1325,13 +1357,13 @@ void AppendVerticesForSquareDisc(std::vector<Mesh::Vertex>& vertices, const Mesh
 		v.position = XMVectorSetW(disc.center + centerToCorner, 1.0f);
 		v.texcoord.x = XMVectorGetX(disc.rightDir * XMVector3Dot(centerToCorner, disc.rightDir) / (disc.radiusRight * 2.0f) + 0.5f * disc.rightDir);
 		v.texcoord.y = XMVectorGetZ(backDir * XMVector3Dot(centerToCorner, backDir) / (disc.radiusBack * 2.0f) + 0.5f * backDir);
-		vertices.push_back(v);
+		pVertices[cornerIndex] = v;
 
 		centerToCorner = XMVector3TransformNormal(centerToCorner, boxCornerStepRotation);
 	}
 }
 
-void AppendVerticesForRoundedSquareDisc(std::vector<Mesh::Vertex>& vertices, const Mesh::Disc& disc, const unsigned segmentCount)
+void WriteVerticesForRoundedSquareDisc(Mesh::Vertex* pVertices, const Mesh::Disc& disc, const unsigned segmentCount)
 {
 	float curveRadius = disc.radiusRight * 0.2f;
 
@@ -1367,13 +1399,26 @@ void AppendVerticesForRoundedSquareDisc(std::vector<Mesh::Vertex>& vertices, con
 			v.position = XMVectorSetW(disc.center + localPosition, 1.0f);
 			v.texcoord.x = XMVectorGetX(disc.rightDir * XMVector3Dot(localPosition, disc.rightDir) / (disc.radiusRight * 2.0f) + 0.5f * disc.rightDir);
 			v.texcoord.y = XMVectorGetZ(backDir * XMVector3Dot(localPosition, backDir) / (disc.radiusBack * 2.0f) + 0.5f * backDir);
-			vertices.push_back(v);
+			pVertices[cornerIndex * segmentsPerCorner + discEdgeIndex] = v;
 		}
 
 		circleEdgeStartPosition = XMVector3TransformNormal(circleEdgeStartPosition, boxCornerStepRotation);
 	}
 }
 
+unsigned GetVertexCountForDisc(const Mesh::DiscMode discMode, const unsigned segmentCount)
+{
+	switch (discMode)
+	{
+	case Mesh::DiscMode::Circle:
+		return segmentCount;
+	case Mesh::DiscMode::Square:
+		return 4;
+	default:
+		return 4 * (segmentCount / 4);
+	}
+}
+
 void AppendIndicesForCylinderBody(std::vector<unsigned>& indices, const unsigned startingVertexIndex, const unsigned geometryLoopCount, const unsigned segmentCount)
 {
 	for (unsigned loopIndex = 0; loopIndex < geometryLoopCount - 1; ++loopIndex)
@@ -1435,8 +1480,8 @@ void Mesh::AppendGeometryForDiscs(const std::vector<Disc>& discs, unsigned segme
 	if (discs.empty())
 		return;
 
-	auto AppendVerticesFunction = (discMode == DiscMode::Circle) ? AppendVerticesForCircleDisc : 
-		(discMode == DiscMode::Square) ? AppendVerticesForSquareDisc : AppendVerticesForRoundedSquareDisc;
+	auto WriteVerticesFunction = (discMode == DiscMode::Circle) ? WriteVerticesForCircleDisc : 
+		(discMode == DiscMode::Square) ? WriteVerticesForSquareDisc : WriteVerticesForRoundedSquareDisc;
 
 	Vertex v;
 	memset(&v, 0, sizeof(v));
@@ -1470,34 +1515,64 @@ void Mesh::AppendGeometryForDiscs(const std::vector<Disc>& discs, unsigned segme
 		}
 	}
 
+	// Lay out every disc's vertex range up front, so the (trig heavy) per-disc vertex generation can run in parallel
+	//	straight into the final vertex buffer
+	const unsigned discVertexCount = GetVertexCountForDisc(discMode, segmentCount);
+	vector<unsigned> discVertexOffsets(discs.size() + 1);
 	unsigned geometryLoopCount = 0;
+	unsigned vertexOffset = startingVertexIndex;
 	for (size_t discIndex = 0; discIndex < discs.size(); ++discIndex)
 	{
-		const Disc& disc = discs[discIndex];
-		if (discIndex == 0 && beginCapType != CapType::None)
-		{
-			v.position = XMVectorSetW(disc.center, 1.0f);
-			v.texcoord = { 0.5f, 0.5f };
-			m_vertices.push_back(v);
-		}
-		else if (discIndex == discs.size() - 1 && endCapType != CapType::None)
+		discVertexOffsets[discIndex] = vertexOffset;
+		if ((discIndex == 0 && beginCapType != CapType::None) ||
+			(discIndex == discs.size() - 1 && endCapType != CapType::None))
 		{
-			v.position = XMVectorSetW(disc.center, 1.0f);
-			v.texcoord = { 0.5f, 0.5f };
-			m_vertices.push_back(v);
+			vertexOffset += 1;
 		}
 		else
 		{
 			if ((beginCapType == CapType::Flat && discIndex == 1) ||
 				(endCapType == CapType::Flat && discIndex == discs.size() - 2))
 			{
-				AppendVerticesFunction(m_vertices, discs[discIndex], segmentCount);
+				vertexOffset += discVertexCount;
 			}
 
-			AppendVerticesFunction(m_vertices, discs[discIndex], segmentCount);
+			vertexOffset += discVertexCount;
 			++geometryLoopCount;
 		}
 	}
+	discVertexOffsets[discs.size()] = vertexOffset;
+
+	m_vertices.resize(vertexOffset, v);
+
+	Vertex* pVertices = m_vertices.data();
+	const Disc* pDiscs = discs.data();
+	const unsigned* pDiscVertexOffsets = discVertexOffsets.data();
+	const size_t discCount = discs.size();
+	ParallelForChunks(discs.size(), kMinDiscsPerThread, [=](size_t, size_t begin, size_t end)
+	{
+		for (size_t discIndex = begin; discIndex < end; ++discIndex)
+		{
+			const Disc& disc = pDiscs[discIndex];
+			Vertex* pDiscVertices = pVertices + pDiscVertexOffsets[discIndex];
+			const unsigned vertexCount = pDiscVertexOffsets[discIndex + 1] - pDiscVertexOffsets[discIndex];
+
+			const bool isCapCenter = (discIndex == 0 && beginCapType != CapType::None) ||
+				(discIndex == discCount - 1 && endCapType != CapType::None);
+			if (isCapCenter)
+			{
+				Vertex capVertex = v;
+				capVertex.position = XMVectorSetW(disc.center, 1.0f);
+				capVertex.texcoord = { 0.5f, 0.5f };
+				pDiscVertices[0] = capVertex;
+				continue;
+			}
+
+			// Flat caps duplicate the ring next to them so the cap gets its own hard edge
+			for (unsigned ringOffset = 0; ringOffset < vertexCount; ringOffset += discVertexCount)
+				WriteVerticesFunction(pDiscVertices + ringOffset, disc, segmentCount);
+		}
+	});
 
 	unsigned bodyStartIndex = startingVertexIndex;
 	if (beginCapType == CapType::Flat)
@@ -1554,34 +1629,15 @@ void Mesh::BakeTransform(const XMMATRIX& transform)
 	m_boundingBoxNeedsUpdate = true;
 	m_d3dBuffersNeedUpdate = true;
 
-	for (auto& vertex : m_vertices)
-	{
-		vertex.position = XMVector3TransformCoord(vertex.position, transform);
-		vertex.normal = XMVector3Normalize(XMVector3TransformNormal(vertex.normal, transform));
-	}
+	TransformMeshVertices<XMVectorOps>(m_vertices.data(), m_vertices.size(), transform, kMinVerticesPerThread);
 }
 
 void Mesh::GenerateSmoothNormals()
 {
 	m_d3dBuffersNeedUpdate = true;
 
-	for (size_t index = 0; index < m_indices.size(); index += 3)
-	{
-		auto& a = m_vertices[m_indices[index + 0]];
-		auto& b = m_vertices[m_indices[index + 1]];
-		auto& c = m_vertices[m_indices[index + 2]];
-
-		XMVECTOR normal = XMVector3Cross(a.position - b.position, c.position - b.position);
-		a.normal += normal;
-		b.normal += normal;
-		c.normal += normal;
-	}
-
-	for (size_t vertexIndex = 0; vertexIndex < m_vertices.size(); ++vertexIndex)
-	{
-		Mesh::Vertex& vertex = m_vertices[vertexIndex];
-		vertex.normal = XMVector3Normalize(m_vertices[vertexIndex].normal);
-	}
+	AccumulateSmoothNormals<XMVectorOps>(m_vertices.data(), m_vertices.size(), m_indices.data(), m_indices.size() / 3,
+		kMinVerticesPerThread, kMinTrianglesPerThread);
 }
 
 void Mesh::UpdateVertices(Vertex* pVertices, unsigned vertexCount)
@@ -1783,60 +1839,79 @@ bool Mesh::TestPointInside(const XMVECTOR& pointInWorldSpace, const XMMATRIX& wo
 	return orientedBoundingBox.Contains(pointInWorldSpace) == CONTAINS;
 }
 
-void Mesh::BoundingBoxNode::GenerateChildNodes(const vector<Mesh::Vertex>& vertices, const vector<unsigned>& indices, unsigned currentDepth)
+bool Mesh::BoundingBoxNode::FindClosestPoint(const vector<Vertex>& vertices, const XMVECTOR& pointInLocalSpace, float& closestDistanceSquared,
+	XMVECTOR& closestPointInLocalSpace, XMVECTOR& normalInLocalSpace) const
 {
-	indicesContained.clear();
-	if (currentDepth == 1)
+	return FindClosestPointInOctree<XMVectorOps>(*this, vertices, pointInLocalSpace, closestDistanceSquared, closestPointInLocalSpace, normalInLocalSpace);
+}
+
+bool Mesh::FindClosestPoint(const XMVECTOR& pointInWorldSpace, const XMMATRIX& worldTransform, float maxDistance, XMVECTOR& closestPoint, XMVECTOR& normal, float& distance)
+{
+	ClosestPointResult result;
+	FindClosestPoints(&pointInWorldSpace, 1, worldTransform, maxDistance, &result);
+	if (!result.found)
+		return false;
+
+	closestPoint = result.point;
+	normal = result.normal;
+	distance = result.distance;
+	return true;
+}
+
+void Mesh::FindClosestPoints(const XMVECTOR* pPointsInWorldSpace, size_t pointCount, const XMMATRIX& worldTransform, float maxDistance, ClosestPointResult* pResults)
+{
+	for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex)
 	{
-		indicesContained = indices;
+		pResults[pointIndex].found = false;
+		pResults[pointIndex].distance = maxDistance;
 	}
-	else
-	{
-		for (size_t i = 0; i < indices.size(); i += 3)
-		{
-			unsigned indexA = indices[i + 0];
-			unsigned indexB = indices[i + 1];
-			unsigned indexC = indices[i + 2];
 
-			if (boundingBox.Contains(vertices[indexA].position) == ContainmentType::CONTAINS ||
-				boundingBox.Contains(vertices[indexB].position) == ContainmentType::CONTAINS ||
-				boundingBox.Contains(vertices[indexC].position) == ContainmentType::CONTAINS)
-			{
-				indicesContained.push_back(indexA);
-				indicesContained.push_back(indexB);
-				indicesContained.push_back(indexC);
-			}
-		}
-	}
+	RefineClosestPoints(pPointsInWorldSpace, pointCount, worldTransform, pResults);
+}
 
-	if(indices.size() / 3 > targetTriangleCount)
-	{
-		XMFLOAT3 childExtents;
-		childExtents.x = boundingBox.Extents.x / 2.0f;
-		childExtents.y = boundingBox.Extents.y / 2.0f;
-		childExtents.z = boundingBox.Extents.z / 2.0f;
+void Mesh::RefineClosestPoints(const XMVECTOR* pPointsInWorldSpace, size_t pointCount, const XMMATRIX& worldTransform, ClosestPointResult* pResults)
+{
+	if (IsEmpty() || m_drawStyle != Mesh::DS_TRILIST)
+		return;
 
-		float xSigns[8] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
-		float ySigns[8] = { 1.0f, 1.0f, 1.0f, 1.0f, -1.0f, -1.0f, -1.0f, -1.0f };
-		float zSigns[8] = { 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f };
+	if (m_boundingBoxNeedsUpdate)
+		UpdateBoundingBox();
 
-		children.resize(8);
-		for (unsigned i = 0; i < 8; ++i)
-		{
-			auto& child = children[i];
-			child.boundingBox.Center.x = boundingBox.Center.x + xSigns[i] * childExtents.x;
-			child.boundingBox.Center.y = boundingBox.Center.y + ySigns[i] * childExtents.y;
-			child.boundingBox.Center.z = boundingBox.Center.z + zSigns[i] * childExtents.z;
-			child.boundingBox.Extents = childExtents;
-			child.GenerateChildNodes(vertices, indicesContained, currentDepth + 1);
-		}
-	}
-	else
+	// The search runs in local space, so the transform is inverted once for the whole batch
+	XMMATRIX inverseWorldTransform = XMMatrixInverse(nullptr, worldTransform);
+	float worldScale = XMVectorGetX(XMVector3Length(worldTransform.r[0]));
+
+	for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex)
 	{
-		children.clear();
+		ClosestPointResult& result = pResults[pointIndex];
+		float maxLocalDistance = (result.distance < FLT_MAX && worldScale > 0.0f) ? result.distance / worldScale : FLT_MAX;
+		float closestDistanceSquared = (maxLocalDistance < sqrtf(FLT_MAX)) ? maxLocalDistance * maxLocalDistance : FLT_MAX;
+
+		XMVECTOR pointInLocalSpace = XMVector3TransformCoord(pPointsInWorldSpace[pointIndex], inverseWorldTransform);
+		XMVECTOR closestPointInLocalSpace = XMVectorZero();
+		XMVECTOR normalInLocalSpace = XMVectorZero();
+		if (!m_boundingBoxNode.FindClosestPoint(m_vertices, pointInLocalSpace, closestDistanceSquared, closestPointInLocalSpace, normalInLocalSpace))
+			continue;
+
+		result.point = XMVector3TransformCoord(closestPointInLocalSpace, worldTransform);
+		result.normal = XMVector3Normalize(XMVector3TransformNormal(normalInLocalSpace, worldTransform));
+		result.distance = XMVectorGetX(XMVector3Length(result.point - pPointsInWorldSpace[pointIndex]));
+		result.found = true;
 	}
 }
 
+bool Mesh::TestSphereIntersection(const XMVECTOR& sphereCenterInWorldSpace, float sphereRadius, const XMMATRIX& worldTransform)
+{
+	XMVECTOR closestPoint, normal;
+	float distance;
+	return FindClosestPoint(sphereCenterInWorldSpace, worldTransform, sphereRadius, closestPoint, normal, distance);
+}
+
+void Mesh::BoundingBoxNode::GenerateChildNodes(const vector<Mesh::Vertex>& vertices, const vector<unsigned>& indices, unsigned currentDepth)
+{
+	GenerateOctreeNodes<XMVectorOps>(*this, vertices, indices, currentDepth, targetTriangleCount);
+}
+
 const BoundingBox& Mesh::GetBoundingBox()
 {
 	if (m_boundingBoxNeedsUpdate)
@@ -1856,33 +1931,14 @@ void Mesh::UpdateBoundingBox()
 		return;
 	}
 
-	float minX, minY, minZ;
-	minX = minY = minZ = FLT_MAX;
-	float maxX, maxY, maxZ;
-	maxX = maxY = maxZ = -FLT_MAX;
+	XMVECTOR minPosition, maxPosition;
+	ComputePositionBounds<XMVectorOps>(m_vertices.data(), m_vertices.size(), kMinVerticesPerThread, minPosition, maxPosition);
 
-	for (unsigned i = 0; i < m_vertices.size(); ++i)
-	{
-		Vertex& vertex = m_vertices[i];
-		float x = XMVectorGetX(vertex.position);
-		float y = XMVectorGetY(vertex.position);
-		float z = XMVectorGetZ(vertex.position);
-
-		if (x < minX)
-			minX = x;
-		if (x > maxX)
-			maxX = x;
-		
-		if (y < minY)
-			minY = y;
-		if (y > maxY)
-			maxY = y;
-		
-		if (z < minZ)
-			minZ = z;
-		if (z > maxZ)
-			maxZ = z;
-	}
+	XMFLOAT3 minimum, maximum;
+	XMStoreFloat3(&minimum, minPosition);
+	XMStoreFloat3(&maximum, maxPosition);
+	const float minX = minimum.x, minY = minimum.y, minZ = minimum.z;
+	const float maxX = maximum.x, maxY = maximum.y, maxZ = maximum.z;
 
 	m_boundingBoxNode.boundingBox.Extents.x = (maxX - minX) / 2.0f;
 	m_boundingBoxNode.boundingBox.Extents.y = (maxY - minY) / 2.0f;
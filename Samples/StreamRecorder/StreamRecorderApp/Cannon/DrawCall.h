@@ -358,10 +358,24 @@ public:
 
 		std::vector<BoundingBoxNode> children;
 
+		// Bounds of the triangles in indicesContained, which can stick out of boundingBox. Used to prune distance queries.
+		BoundingBox triangleBounds;
+
 		static const unsigned targetTriangleCount = 250;
 
 		void GenerateChildNodes(const std::vector<Mesh::Vertex>& vertices, const std::vector<unsigned>& indices, unsigned currentDepth);
 		bool TestRayIntersection(const std::vector<Vertex>& vertices, const XMVECTOR& rayOriginInWorldSpace, const XMVECTOR& rayDirectionInWorldSpace, const XMMATRIX& worldTransform, float &distance, XMVECTOR& normalInLocalSpace, float maxDistance = std::numeric_limits<float>::max(), bool returnFurthest = false);
+
+		// Only looks for points closer than sqrt(closestDistanceSquared), which is tightened as closer triangles are found
+		bool FindClosestPoint(const std::vector<Vertex>& vertices, const XMVECTOR& pointInLocalSpace, float& closestDistanceSquared, XMVECTOR& closestPointInLocalSpace, XMVECTOR& normalInLocalSpace) const;
+	};
+
+	struct ClosestPointResult
+	{
+		XMVECTOR point;		// World space
+		XMVECTOR normal;	// World space, facing the side triangles are visible from
+		float distance;
+		bool found;
 	};
 
 	struct Disc
@@ -399,6 +413,13 @@ public:
 	bool TestRayIntersection(const XMVECTOR& rayOriginInWorldSpace, const XMVECTOR& rayDirectionInWorldSpace, const XMMATRIX& worldTransform, float &distance, XMVECTOR &normal, float maxDistance = std::numeric_limits<float>::max(), bool returnFurthest = false);
 	bool TestRayIntersection(const XMVECTOR& rayOriginInWorldSpace, const XMVECTOR& rayDirectionInWorldSpace, const XMMATRIX& worldTransform, float& distance);
 	bool TestPointInside(const XMVECTOR& pointInWorldSpace, const XMMATRIX& worldTransform);	// This currently only tests against the bounding box
+
+	// Closest point on the mesh surface within maxDistance of the query point. worldTransform may scale, but only uniformly.
+	bool FindClosestPoint(const XMVECTOR& pointInWorldSpace, const XMMATRIX& worldTransform, float maxDistance, XMVECTOR& closestPoint, XMVECTOR& normal, float& distance);
+	void FindClosestPoints(const XMVECTOR* pPointsInWorldSpace, size_t pointCount, const XMMATRIX& worldTransform, float maxDistance, ClosestPointResult* pResults);
+	// Same search, within each result's distance, replacing only the results it finds closer points for
+	void RefineClosestPoints(const XMVECTOR* pPointsInWorldSpace, size_t pointCount, const XMMATRIX& worldTransform, ClosestPointResult* pResults);
+	bool TestSphereIntersection(const XMVECTOR& sphereCenterInWorldSpace, float sphereRadius, const XMMATRIX& worldTransform);
 	const BoundingBox& GetBoundingBox();
 
 	void SetDrawStyle(DrawStyle drawStyle){m_drawStyle = drawStyle;}
@@ -0,0 +1,532 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include "MeshDecimator.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+// The decimator is adapted from Fast-Quadric-Mesh-Simplification by Sven Forstmann
+//	(https://github.com/sp4cerat/Fast-Quadric-Mesh-Simplification), used under the MIT License:
+//
+//	Copyright (c) 2014 Sven Forstmann
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+//	documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+//	to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+//	the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+//	THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+//	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//	IN THE SOFTWARE.
+//
+// It follows the threshold based variant of QEM simplification: instead of keeping a heap of edge costs,
+//	it sweeps the triangles repeatedly with a growing error threshold and collapses every edge under it. Quadrics are
+//	kept in double precision since spatial mapping coordinates are tens of meters away from the origin.
+
+namespace
+{
+	struct Vec3
+	{
+		double x, y, z;
+
+		Vec3 operator+(const Vec3& b) const { return { x + b.x, y + b.y, z + b.z }; }
+		Vec3 operator-(const Vec3& b) const { return { x - b.x, y - b.y, z - b.z }; }
+		Vec3 operator*(double s) const { return { x * s, y * s, z * s }; }
+
+		double Dot(const Vec3& b) const { return x * b.x + y * b.y + z * b.z; }
+		Vec3 Cross(const Vec3& b) const { return { y * b.z - z * b.y, z * b.x - x * b.z, x * b.y - y * b.x }; }
+
+		Vec3 Normalized() const
+		{
+			double length = sqrt(Dot(*this));
+			return (length > 0.0) ? (*this) * (1.0 / length) : Vec3{ 0.0, 0.0, 0.0 };
+		}
+	};
+
+	// Upper triangle of the symmetric 4x4 plane quadric
+	struct Quadric
+	{
+		double m[10];
+
+		Quadric() { memset(m, 0, sizeof(m)); }
+
+		Quadric(double a, double b, double c, double d)
+		{
+			m[0] = a * a; m[1] = a * b; m[2] = a * c; m[3] = a * d;
+			m[4] = b * b; m[5] = b * c; m[6] = b * d;
+			m[7] = c * c; m[8] = c * d;
+			m[9] = d * d;
+		}
+
+		Quadric operator+(const Quadric& b) const
+		{
+			Quadric result;
+			for (int i = 0; i < 10; ++i)
+				result.m[i] = m[i] + b.m[i];
+			return result;
+		}
+
+		double Det(int a11, int a12, int a13, int a21, int a22, int a23, int a31, int a32, int a33) const
+		{
+			return m[a11] * m[a22] * m[a33] + m[a13] * m[a21] * m[a32] + m[a12] * m[a23] * m[a31]
+				- m[a13] * m[a22] * m[a31] - m[a11] * m[a23] * m[a32] - m[a12] * m[a21] * m[a33];
+		}
+
+		double Error(const Vec3& p) const
+		{
+			return m[0] * p.x * p.x + 2 * m[1] * p.x * p.y + 2 * m[2] * p.x * p.z + 2 * m[3] * p.x
+				+ m[4] * p.y * p.y + 2 * m[5] * p.y * p.z + 2 * m[6] * p.y
+				+ m[7] * p.z * p.z + 2 * m[8] * p.z
+				+ m[9];
+		}
+	};
+
+	struct Triangle
+	{
+		unsigned v[3];
+		double error[4];	// Per edge, [3] is the smallest
+		bool deleted;
+		bool dirty;
+		Vec3 normal;
+	};
+
+	struct Vertex
+	{
+		Vec3 position;
+		Quadric quadric;
+		unsigned triangleStart;
+		unsigned triangleCount;
+		bool border;
+	};
+
+	struct TriangleRef
+	{
+		unsigned triangle;
+		unsigned corner;
+	};
+
+	class Decimator
+	{
+	public:
+		vector<Triangle> triangles;
+		vector<Vertex> vertices;
+
+		double maxAcceptedError = 0.0;
+
+		void Simplify(size_t targetTriangleCount, double maxError)
+		{
+			const double maxErrorSquared = maxError * maxError;
+			size_t deletedTriangleCount = 0;
+			const size_t startTriangleCount = triangles.size();
+
+			vector<bool> deleted0, deleted1;
+
+			for (int iteration = 0; iteration < 100; ++iteration)
+			{
+				if (startTriangleCount - deletedTriangleCount <= targetTriangleCount)
+					break;
+
+				// Rebuild the triangle references every few sweeps, collapses leave them fragmented
+				if (iteration % 5 == 0)
+					UpdateMesh(iteration);
+
+				for (auto& triangle : triangles)
+					triangle.dirty = false;
+
+				// Threshold growth follows the usual aggressiveness of 7
+				const double threshold = min(1e-9 * pow(iteration + 3.0, 7.0), maxErrorSquared);
+
+				bool collapsedAny = false;
+				for (size_t triangleIndex = 0; triangleIndex < triangles.size(); ++triangleIndex)
+				{
+					Triangle& triangle = triangles[triangleIndex];
+					if (triangle.error[3] > threshold || triangle.deleted || triangle.dirty)
+						continue;
+
+					for (int j = 0; j < 3; ++j)
+					{
+						if (triangle.error[j] > threshold)
+							continue;
+
+						const unsigned i0 = triangle.v[j];
+						const unsigned i1 = triangle.v[(j + 1) % 3];
+						Vertex& v0 = vertices[i0];
+						Vertex& v1 = vertices[i1];
+
+						if (v0.border != v1.border)
+							continue;
+
+						Vec3 position;
+						const double error = CalculateError(i0, i1, position);
+
+						deleted0.assign(v0.triangleCount, false);
+						deleted1.assign(v1.triangleCount, false);
+						if (Flipped(position, i1, v0, deleted0) || Flipped(position, i0, v1, deleted1))
+							continue;
+
+						v0.position = position;
+						v0.quadric = v1.quadric + v0.quadric;
+
+						const unsigned refStart = (unsigned)m_refs.size();
+						UpdateTriangles(i0, v0, deleted0, deletedTriangleCount);
+						UpdateTriangles(i0, v1, deleted1, deletedTriangleCount);
+						const unsigned refCount = (unsigned)m_refs.size() - refStart;
+
+						if (refCount <= v0.triangleCount)
+						{
+							// The new references fit where the old ones were
+							if (refCount)
+								memcpy(&m_refs[v0.triangleStart], &m_refs[refStart], refCount * sizeof(TriangleRef));
+						}
+						else
+						{
+							v0.triangleStart = refStart;
+						}
+						v0.triangleCount = refCount;
+
+						maxAcceptedError = max(maxAcceptedError, error);
+						collapsedAny = true;
+						break;
+					}
+
+					if (startTriangleCount - deletedTriangleCount <= targetTriangleCount)
+						break;
+				}
+
+				// Nothing left under the caller's error bound
+				if (!collapsedAny && threshold >= maxErrorSquared)
+					break;
+			}
+
+			CompactMesh();
+		}
+
+	private:
+		vector<TriangleRef> m_refs;
+
+		double CalculateError(unsigned id0, unsigned id1, Vec3& result) const
+		{
+			const Quadric q = vertices[id0].quadric + vertices[id1].quadric;
+			const bool border = vertices[id0].border && vertices[id1].border;
+
+			const double det = q.Det(0, 1, 2, 1, 4, 5, 2, 5, 7);
+			if (det != 0.0 && !border)
+			{
+				// Optimal position solves the quadric's 3x3 system
+				result.x = -1.0 / det * q.Det(1, 2, 3, 4, 5, 6, 5, 7, 8);
+				result.y = 1.0 / det * q.Det(0, 2, 3, 1, 5, 6, 2, 7, 8);
+				result.z = -1.0 / det * q.Det(0, 1, 3, 1, 4, 6, 2, 5, 8);
+				return q.Error(result);
+			}
+
+			// Otherwise pick the best of both ends and the midpoint
+			const Vec3& p0 = vertices[id0].position;
+			const Vec3& p1 = vertices[id1].position;
+			const Vec3 p2 = (p0 + p1) * 0.5;
+			const double error0 = q.Error(p0);
+			const double error1 = q.Error(p1);
+			const double error2 = q.Error(p2);
+			const double error = min(error0, min(error1, error2));
+			result = (error == error0) ? p0 : (error == error1) ? p1 : p2;
+			return error;
+		}
+
+		// Would moving vertex to position flip (or degenerate) one of its triangles? Marks triangles shared with otherID for deletion.
+		bool Flipped(const Vec3& position, unsigned otherID, const Vertex& vertex, vector<bool>& deleted) const
+		{
+			for (unsigned k = 0; k < vertex.triangleCount; ++k)
+			{
+				const TriangleRef& ref = m_refs[vertex.triangleStart + k];
+				const Triangle& triangle = triangles[ref.triangle];
+				if (triangle.deleted)
+					continue;
+
+				const unsigned id1 = triangle.v[(ref.corner + 1) % 3];
+				const unsigned id2 = triangle.v[(ref.corner + 2) % 3];
+				if (id1 == otherID || id2 == otherID)
+				{
+					deleted[k] = true;
+					continue;
+				}
+
+				const Vec3 d1 = (vertices[id1].position - position).Normalized();
+				const Vec3 d2 = (vertices[id2].position - position).Normalized();
+				if (fabs(d1.Dot(d2)) > 0.999)
+					return true;
+
+				const Vec3 normal = d1.Cross(d2).Normalized();
+				deleted[k] = false;
+				if (normal.Dot(triangle.normal) < 0.2)
+					return true;
+			}
+			return false;
+		}
+
+		void UpdateTriangles(unsigned i0, const Vertex& vertex, const vector<bool>& deleted, size_t& deletedTriangleCount)
+		{
+			Vec3 position;
+			for (unsigned k = 0; k < vertex.triangleCount; ++k)
+			{
+				const TriangleRef ref = m_refs[vertex.triangleStart + k];
+				Triangle& triangle = triangles[ref.triangle];
+				if (triangle.deleted)
+					continue;
+
+				if (deleted[k])
+				{
+					triangle.deleted = true;
+					++deletedTriangleCount;
+					continue;
+				}
+
+				triangle.v[ref.corner] = i0;
+				triangle.dirty = true;
+				triangle.error[0] = CalculateError(triangle.v[0], triangle.v[1], position);
+				triangle.error[1] = CalculateError(triangle.v[1], triangle.v[2], position);
+				triangle.error[2] = CalculateError(triangle.v[2], triangle.v[0], position);
+				triangle.error[3] = min(triangle.error[0], min(triangle.error[1], triangle.error[2]));
+				m_refs.push_back(ref);
+			}
+		}
+
+		void UpdateMesh(int iteration)
+		{
+			if (iteration > 0)
+			{
+				size_t destination = 0;
+				for (size_t i = 0; i < triangles.size(); ++i)
+				{
+					if (!triangles[i].deleted)
+						triangles[destination++] = triangles[i];
+				}
+				triangles.resize(destination);
+			}
+
+			// Vertex -> triangle references
+			for (auto& vertex : vertices)
+			{
+				vertex.triangleStart = 0;
+				vertex.triangleCount = 0;
+			}
+			for (auto& triangle : triangles)
+			{
+				for (int j = 0; j < 3; ++j)
+					vertices[triangle.v[j]].triangleCount++;
+			}
+			unsigned triangleStart = 0;
+			for (auto& vertex : vertices)
+			{
+				vertex.triangleStart = triangleStart;
+				triangleStart += vertex.triangleCount;
+				vertex.triangleCount = 0;
+			}
+
+			m_refs.resize(triangles.size() * 3);
+			for (unsigned i = 0; i < triangles.size(); ++i)
+			{
+				for (unsigned j = 0; j < 3; ++j)
+				{
+					Vertex& vertex = vertices[triangles[i].v[j]];
+					m_refs[vertex.triangleStart + vertex.triangleCount] = { i, j };
+					vertex.triangleCount++;
+				}
+			}
+
+			if (iteration != 0)
+				return;
+
+			// Border vertices have a neighbor shared by a single triangle, they are only collapsed along the border
+			vector<unsigned> neighborCounts, neighborIDs;
+			for (auto& vertex : vertices)
+				vertex.border = false;
+
+			for (auto& vertex : vertices)
+			{
+				neighborCounts.clear();
+				neighborIDs.clear();
+				for (unsigned k = 0; k < vertex.triangleCount; ++k)
+				{
+					const Triangle& triangle = triangles[m_refs[vertex.triangleStart + k].triangle];
+					for (int j = 0; j < 3; ++j)
+					{
+						const unsigned id = triangle.v[j];
+						auto found = find(neighborIDs.begin(), neighborIDs.end(), id);
+						if (found == neighborIDs.end())
+						{
+							neighborIDs.push_back(id);
+							neighborCounts.push_back(1);
+						}
+						else
+						{
+							neighborCounts[found - neighborIDs.begin()]++;
+						}
+					}
+				}
+
+				for (size_t j = 0; j < neighborCounts.size(); ++j)
+				{
+					if (neighborCounts[j] == 1)
+						vertices[neighborIDs[j]].border = true;
+				}
+			}
+
+			// Initial quadrics are the sum of the planes of the triangles around each vertex
+			for (auto& vertex : vertices)
+				vertex.quadric = Quadric();
+
+			for (auto& triangle : triangles)
+			{
+				const Vec3& p0 = vertices[triangle.v[0]].position;
+				const Vec3 normal = (vertices[triangle.v[1]].position - p0).Cross(vertices[triangle.v[2]].position - p0).Normalized();
+				triangle.normal = normal;
+
+				const Quadric plane(normal.x, normal.y, normal.z, -normal.Dot(p0));
+				for (int j = 0; j < 3; ++j)
+					vertices[triangle.v[j]].quadric = vertices[triangle.v[j]].quadric + plane;
+			}
+
+			Vec3 position;
+			for (auto& triangle : triangles)
+			{
+				for (int j = 0; j < 3; ++j)
+					triangle.error[j] = CalculateError(triangle.v[j], triangle.v[(j + 1) % 3], position);
+				triangle.error[3] = min(triangle.error[0], min(triangle.error[1], triangle.error[2]));
+			}
+		}
+
+		void CompactMesh()
+		{
+			for (auto& vertex : vertices)
+				vertex.triangleCount = 0;
+
+			size_t destination = 0;
+			for (size_t i = 0; i < triangles.size(); ++i)
+			{
+				if (triangles[i].deleted)
+					continue;
+
+				triangles[destination++] = triangles[i];
+				for (int j = 0; j < 3; ++j)
+					vertices[triangles[i].v[j]].triangleCount = 1;
+			}
+			triangles.resize(destination);
+
+			// Drop unreferenced vertices, triangleStart becomes the remapped index
+			destination = 0;
+			for (size_t i = 0; i < vertices.size(); ++i)
+			{
+				if (vertices[i].triangleCount)
+				{
+					vertices[i].triangleStart = (unsigned)destination;
+					vertices[destination].position = vertices[i].position;
+					destination++;
+				}
+			}
+
+			for (auto& triangle : triangles)
+			{
+				for (int j = 0; j < 3; ++j)
+					triangle.v[j] = vertices[triangle.v[j]].triangleStart;
+			}
+			vertices.resize(destination);
+		}
+	};
+}
+
+MeshSimplificationResult SimplifyTriangles(const SimplificationMesh& source, size_t targetTriangleCount, float maxError, SimplificationMesh& result)
+{
+	Decimator decimator;
+
+	const size_t vertexCount = source.positions.size() / 3;
+	decimator.vertices.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i)
+		decimator.vertices[i].position = { source.positions[i * 3 + 0], source.positions[i * 3 + 1], source.positions[i * 3 + 2] };
+
+	decimator.triangles.reserve(source.indices.size() / 3);
+	for (size_t i = 0; i + 2 < source.indices.size(); i += 3)
+	{
+		Triangle triangle = {};
+		triangle.v[0] = source.indices[i + 0];
+		triangle.v[1] = source.indices[i + 1];
+		triangle.v[2] = source.indices[i + 2];
+
+		// Degenerate triangles would never go away and only confuse border detection
+		if (triangle.v[0] == triangle.v[1] || triangle.v[1] == triangle.v[2] || triangle.v[2] == triangle.v[0])
+			continue;
+
+		decimator.triangles.push_back(triangle);
+	}
+
+	decimator.Simplify(targetTriangleCount, maxError);
+
+	result.positions.resize(decimator.vertices.size() * 3);
+	for (size_t i = 0; i < decimator.vertices.size(); ++i)
+	{
+		const Vec3& position = decimator.vertices[i].position;
+		result.positions[i * 3 + 0] = (float)position.x;
+		result.positions[i * 3 + 1] = (float)position.y;
+		result.positions[i * 3 + 2] = (float)position.z;
+	}
+
+	result.indices.resize(decimator.triangles.size() * 3);
+	for (size_t i = 0; i < decimator.triangles.size(); ++i)
+	{
+		result.indices[i * 3 + 0] = decimator.triangles[i].v[0];
+		result.indices[i * 3 + 1] = decimator.triangles[i].v[1];
+		result.indices[i * 3 + 2] = decimator.triangles[i].v[2];
+	}
+
+	MeshSimplificationResult simplificationResult;
+	simplificationResult.triangleCount = decimator.triangles.size();
+	simplificationResult.error = (float)sqrt(max(0.0, decimator.maxAcceptedError));
+	return simplificationResult;
+}
+
+std::vector<SimplificationLevel> GenerateSimplificationLevels(const SimplificationMesh& source, unsigned maxLevelCount, float triangleRatioPerLevel, size_t minTriangleCount)
+{
+	vector<SimplificationLevel> levels;
+	size_t previousTriangleCount = source.indices.size() / 3;
+	float previousError = 0.0f;
+	size_t targetTriangleCount = previousTriangleCount;
+
+	while (levels.size() + 1 < maxLevelCount)
+	{
+		targetTriangleCount = (size_t)(targetTriangleCount * triangleRatioPerLevel);
+		if (targetTriangleCount < minTriangleCount)
+			break;
+
+		// Every level starts over from the full detail mesh, so its error is measured against the source planes.
+		//	Simplifying the previous level would be cheaper, but its fresh quadrics forget the error already made.
+		SimplificationLevel level;
+		const MeshSimplificationResult result = SimplifyTriangles(source, targetTriangleCount, FLT_MAX, level.mesh);
+		if (result.triangleCount == 0 || result.triangleCount >= previousTriangleCount)
+			break;
+
+		// Kept non decreasing along the chain, SelectLODForTolerance stops at the first level over the tolerance
+		level.error = max(result.error, previousError);
+		previousTriangleCount = result.triangleCount;
+		previousError = level.error;
+		levels.push_back(std::move(level));
+	}
+
+	return levels;
+}
@@ -0,0 +1,45 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Quadric error metric edge collapse decimation (Garland & Heckbert) on bare triangle lists. MeshSimplification.h
+//	wraps it for Mesh; this part doesn't depend on DirectX so it also builds off device (MeshSimplificationBenchmark).
+
+struct MeshSimplificationResult
+{
+	size_t triangleCount = 0;
+	float error = 0.0f;		// Square root of the largest quadric error accepted, roughly the max deviation in mesh units
+};
+
+struct SimplificationMesh
+{
+	std::vector<float> positions;		// x, y, z per vertex
+	std::vector<unsigned> indices;		// Three per triangle
+};
+
+// Collapses edges until targetTriangleCount is reached or every remaining collapse would exceed maxError
+MeshSimplificationResult SimplifyTriangles(const SimplificationMesh& source, size_t targetTriangleCount, float maxError, SimplificationMesh& result);
+
+struct SimplificationLevel
+{
+	SimplificationMesh mesh;
+	float error = 0.0f;		// Against the source mesh, never smaller than the previous level's
+};
+
+// The levels below full detail: level n keeps about triangleRatioPerLevel^n of the source triangles and is simplified
+//	from the source itself. Stops early once a level would drop under minTriangleCount or stops shrinking.
+//	maxLevelCount counts the full detail level.
+std::vector<SimplificationLevel> GenerateSimplificationLevels(const SimplificationMesh& source, unsigned maxLevelCount, float triangleRatioPerLevel, size_t minTriangleCount);
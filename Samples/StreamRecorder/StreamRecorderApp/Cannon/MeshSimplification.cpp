@@ -0,0 +1,95 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include "MeshSimplification.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+using namespace std;
+
+namespace
+{
+	void ToSimplificationMesh(const std::vector<Mesh::Vertex>& vertices, const std::vector<unsigned>& indices, SimplificationMesh& mesh)
+	{
+		mesh.positions.resize(vertices.size() * 3);
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			XMFLOAT3 position;
+			XMStoreFloat3(&position, vertices[i].position);
+			mesh.positions[i * 3 + 0] = position.x;
+			mesh.positions[i * 3 + 1] = position.y;
+			mesh.positions[i * 3 + 2] = position.z;
+		}
+		mesh.indices = indices;
+	}
+
+	void FromSimplificationMesh(const SimplificationMesh& mesh, std::vector<Mesh::Vertex>& vertices, std::vector<unsigned>& indices)
+	{
+		vertices.resize(mesh.positions.size() / 3);
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			vertices[i].position = XMVectorSet(mesh.positions[i * 3 + 0], mesh.positions[i * 3 + 1], mesh.positions[i * 3 + 2], 1.0f);
+			vertices[i].normal = XMVectorZero();
+			vertices[i].texcoord = XMFLOAT2(0.0f, 0.0f);
+		}
+		indices = mesh.indices;
+	}
+}
+
+MeshSimplificationResult SimplifyMesh(const std::vector<Mesh::Vertex>& sourceVertices, const std::vector<unsigned>& sourceIndices,
+	size_t targetTriangleCount, float maxError, std::vector<Mesh::Vertex>& vertices, std::vector<unsigned>& indices)
+{
+	SimplificationMesh source, result;
+	ToSimplificationMesh(sourceVertices, sourceIndices, source);
+	MeshSimplificationResult simplificationResult = SimplifyTriangles(source, targetTriangleCount, maxError, result);
+	FromSimplificationMesh(result, vertices, indices);
+	return simplificationResult;
+}
+
+std::vector<MeshLOD> GenerateMeshLODChain(const std::shared_ptr<Mesh>& mesh, unsigned maxLevelCount, float triangleRatioPerLevel, size_t minTriangleCount)
+{
+	vector<MeshLOD> lods;
+	if (!mesh)
+		return lods;
+
+	MeshLOD fullDetail;
+	fullDetail.mesh = mesh;
+	lods.push_back(fullDetail);
+
+	SimplificationMesh source;
+	ToSimplificationMesh(mesh->GetVertices(), mesh->GetIndices(), source);
+	for (const SimplificationLevel& level : GenerateSimplificationLevels(source, maxLevelCount, triangleRatioPerLevel, minTriangleCount))
+	{
+		MeshLOD lod;
+		lod.mesh = make_shared<Mesh>(nullptr, 0);
+		FromSimplificationMesh(level.mesh, lod.mesh->GetVertices(), lod.mesh->GetIndices());
+		lod.mesh->GenerateSmoothNormals();
+		lod.mesh->UpdateBoundingBox();
+		lod.error = level.error;
+		lods.push_back(lod);
+	}
+
+	return lods;
+}
+
+size_t SelectLODForTolerance(const std::vector<MeshLOD>& lods, float tolerance)
+{
+	size_t selectedLOD = 0;
+	for (size_t lodIndex = 1; lodIndex < lods.size(); ++lodIndex)
+	{
+		if (lods[lodIndex].error > tolerance)
+			break;
+		selectedLOD = lodIndex;
+	}
+	return selectedLOD;
+}
@@ -0,0 +1,45 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "DrawCall.h"
+#include "MeshDecimator.h"
+
+#include <memory>
+#include <vector>
+
+// Quadric error metric edge collapse decimation (MeshDecimator.h) for Mesh vertex/index buffers.
+//	Texcoords are dropped and smooth normals are regenerated on the output, so this is meant for
+//	environment geometry such as spatial mapping surfaces rather than textured models.
+
+// Collapses edges until targetTriangleCount is reached or every remaining collapse would exceed maxError
+MeshSimplificationResult SimplifyMesh(const std::vector<Mesh::Vertex>& sourceVertices, const std::vector<unsigned>& sourceIndices,
+	size_t targetTriangleCount, float maxError, std::vector<Mesh::Vertex>& vertices, std::vector<unsigned>& indices);
+
+struct MeshLOD
+{
+	std::shared_ptr<Mesh> mesh;
+	float error = 0.0f;		// 0 for the full detail level
+};
+
+// Level 0 is the source mesh itself, each following level keeps about triangleRatioPerLevel of the previous one and is
+//	simplified from level 0, see GenerateSimplificationLevels. Bounding boxes of new levels are built.
+std::vector<MeshLOD> GenerateMeshLODChain(const std::shared_ptr<Mesh>& mesh, unsigned maxLevelCount = 4, float triangleRatioPerLevel = 0.35f, size_t minTriangleCount = 32);
+
+// Index of the coarsest level whose error is within tolerance (0 if lods is empty)
+size_t SelectLODForTolerance(const std::vector<MeshLOD>& lods, float tolerance);
+
+// Same as above with the tolerance growing linearly with distance, angularTolerance is in radians
+inline size_t SelectLODForDistance(const std::vector<MeshLOD>& lods, float distance, float angularTolerance)
+{
+	return SelectLODForTolerance(lods, distance * angularTolerance);
+}
@@ -892,6 +892,7 @@ SurfaceMapping::SurfaceMapping(winrt::Windows::Perception::Spatial::SpatialStati
 	m_referenceFrame(referenceFrame),
 	m_isActive(false),
 	m_surfaceDrawMode(SurfaceDrawMode::None),
+	m_drawLODAngularTolerance(0.002f),
 	m_headPosition(XMVectorZero()),
 	m_numberOfSurfacesInProcessingQueue(0),
 	m_surfaceObservationThread(new std::thread(&SurfaceMapping::SurfaceObservationThreadFunction, this))
@@ -910,112 +911,119 @@ void SurfaceMapping::CreaterObserverIfNeeded()
 	}
 }
 
-// Returns the list of observed surfaces that are new or in need of an update.
-// The list is sorted newest to oldest with brand new meshes appearing after the oldest.
-// Code processing this list should work from back to front, so then new meshes get processed first,
-//  followed by meshes that have gone the longest without an update.
+// Returns every observed surface along with its distance to the head, the scheduler decides which ones actually need work.
+// Mesh records for surfaces the system no longer reports are queued for removal.
 
-void SurfaceMapping::GetLatestSurfacesToProcess(std::vector<TimestampSurfacePair>& surfacesToProcess)
+void SurfaceMapping::GetLatestSurfacesToProcess(const XMVECTOR& headPosition, std::vector<SurfaceMeshScheduler::Candidate>& surfacesToProcess)
 {
 	auto observedSurfaces = m_surfaceObserver.GetObservedSurfaces();
-
-	m_meshRecordsMutex.lock();
+	auto coordinateSystem = m_referenceFrame.CoordinateSystem();
 
 	for (auto const& observedSurfacePair : observedSurfaces)
 	{
 		auto surfaceInfo = observedSurfacePair.Value();
 
-		auto meshRecordIterator = m_meshRecords.find(surfaceInfo.Id());
-		if (meshRecordIterator == m_meshRecords.end())
-		{
-			surfacesToProcess.push_back(pair<long long, winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo>(0, surfaceInfo));
-		}
-		else if (surfaceInfo.UpdateTime().time_since_epoch().count() - meshRecordIterator->second.lastSurfaceUpdateTime > 5 * 10000000 || !meshRecordIterator->second.mesh)
+		SurfaceMeshScheduler::Candidate candidate;
+		candidate.id = surfaceInfo.Id();
+		candidate.surface = surfaceInfo;
+		candidate.updateTime = surfaceInfo.UpdateTime().time_since_epoch().count();
+		candidate.distanceToHead = FLT_MAX;
+
+		auto bounds = surfaceInfo.TryGetBounds(coordinateSystem);
+		if (bounds)
 		{
-			surfacesToProcess.push_back(pair<long long, winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo>(meshRecordIterator->second.lastMeshUpdateTime, surfaceInfo));
+			XMFLOAT3 boundsCenter = bounds.Value().Center;
+			candidate.distanceToHead = XMVectorGetX(XMVector3Length(XMVectorSetW(XMLoadFloat3(&boundsCenter), 1.0f) - headPosition));
 		}
+
+		surfacesToProcess.push_back(candidate);
 	}
 
+	lock_guard<mutex> lock(m_meshRecordsMutex);
 	for (auto& meshRecordPair : m_meshRecords)
 	{
 		if (!observedSurfaces.HasKey(meshRecordPair.first))
 			m_meshRecordIDsToErase.push_back(meshRecordPair.first);
 	}
-
-	m_meshRecordsMutex.unlock();
-
-	sort(surfacesToProcess.begin(), surfacesToProcess.end(), [](const pair<long long, winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo>& a, const pair<long long, winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo>& b)
-		{
-			return a.first > b.first;
-		});
 }
 
 void SurfaceMapping::SurfaceObservationThreadFunction()
 {
-	vector<TimestampSurfacePair> surfacesToProcess;
+	// Several meshes are computed at once and converted on the scheduler's workers, results reach m_newMeshRecords in batches
+	SurfaceMeshScheduler scheduler(
+		[this](const winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo& surfaceInfo, MeshRecord& meshRecord)
+		{
+			return ProcessSurface(surfaceInfo, meshRecord);
+		},
+		[this](vector<MeshRecord>&& meshRecords)
+		{
+			PublishMeshRecords(move(meshRecords));
+		});
+
+	vector<SurfaceMeshScheduler::Candidate> surfacesToProcess;
 
 	for (;;)
 	{
+		Sleep(50);
+
 		CreaterObserverIfNeeded();
 		if (!m_surfaceObserver || !m_referenceFrame)
-		{
-			Sleep(50);
 			continue;
-		}
 
 		m_headPositionMutex.lock();
-		winrt::Windows::Perception::Spatial::SpatialBoundingBox box = { { XMVectorGetX(m_headPosition), XMVectorGetY(m_headPosition), XMVectorGetZ(m_headPosition) }, { 10.f, 10.f, 5.f } };
+		XMVECTOR headPosition = m_headPosition;
+		m_headPositionMutex.unlock();
+
+		winrt::Windows::Perception::Spatial::SpatialBoundingBox box = { { XMVectorGetX(headPosition), XMVectorGetY(headPosition), XMVectorGetZ(headPosition) }, { 10.f, 10.f, 5.f } };
 		winrt::Windows::Perception::Spatial::SpatialBoundingVolume bounds = winrt::Windows::Perception::Spatial::SpatialBoundingVolume::FromBox(m_referenceFrame.CoordinateSystem(), box);
 		m_surfaceObserver.SetBoundingVolume(bounds);
-		m_headPositionMutex.unlock();
 
-		if (surfacesToProcess.empty())
-		{
-			Sleep(50);
-			GetLatestSurfacesToProcess(surfacesToProcess);
-		}
+		surfacesToProcess.clear();
+		GetLatestSurfacesToProcess(headPosition, surfacesToProcess);
+		scheduler.Submit(surfacesToProcess);
 
-		while (!surfacesToProcess.empty())
-		{
-			Sleep(50);
+		m_numberOfSurfacesInProcessingQueueMutex.lock();
+		m_numberOfSurfacesInProcessingQueue = (unsigned)scheduler.GetPendingCount();
+		m_surfaceProcessingMetrics = scheduler.GetMetrics();
+		m_numberOfSurfacesInProcessingQueueMutex.unlock();
+	}
+}
 
-			auto surfaceInfo = surfacesToProcess.back().second;
-			surfacesToProcess.pop_back();
+bool SurfaceMapping::ProcessSurface(const winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo& surfaceInfo, MeshRecord& meshRecord)
+{
+	auto options = winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceMeshOptions();
+	options.IncludeVertexNormals(true);
+	auto sourceMesh = surfaceInfo.TryComputeLatestMeshAsync(1000.0, options).get();
+	if (!sourceMesh)
+		return false;
 
-			m_numberOfSurfacesInProcessingQueueMutex.lock();
-			m_numberOfSurfacesInProcessingQueue = (unsigned)surfacesToProcess.size();
-			m_numberOfSurfacesInProcessingQueueMutex.unlock();
+	meshRecord.id = sourceMesh.SurfaceInfo().Id();
+	meshRecord.sourceMesh = sourceMesh;
+	meshRecord.lastMeshUpdateTime = Timer::GetSystemRelativeTime();
+	meshRecord.lastSurfaceUpdateTime = sourceMesh.SurfaceInfo().UpdateTime().time_since_epoch().count();
+	meshRecord.color = XMVectorSet(0.5f, 0.5f, 0.5f, 1.0f);
+
+	auto tryTransform = sourceMesh.CoordinateSystem().TryGetTransformTo(m_referenceFrame.CoordinateSystem());
+	if (tryTransform)
+		meshRecord.worldTransform = tryTransform.Value();
+
+	meshRecord.mesh = make_shared<Mesh>(nullptr, 0);
+	ConvertMesh(meshRecord.sourceMesh, meshRecord.mesh);
+	NotifySurfaceMeshCallback(meshRecord.sourceMesh, meshRecord.worldTransform);
+	meshRecord.sourceMesh = nullptr;
+	meshRecord.mesh->UpdateBoundingBox();
+	meshRecord.mesh->GetBoundingBox().Transform(meshRecord.worldBoundingBox, XMLoadFloat4x4(&meshRecord.worldTransform));
+	meshRecord.lods = GenerateMeshLODChain(meshRecord.mesh);
+
+	// Draw calls are created lazily by DrawMeshes, keeping D3D resource creation off the worker threads
+	return true;
+}
 
-			auto options = winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceMeshOptions();
-			options.IncludeVertexNormals(true);
-			auto sourceMesh = surfaceInfo.TryComputeLatestMeshAsync(1000.0, options).get();
-			if (sourceMesh)
-			{
-				MeshRecord newMeshRecord;
-				newMeshRecord.id = sourceMesh.SurfaceInfo().Id();
-				newMeshRecord.sourceMesh = sourceMesh;
-				newMeshRecord.lastMeshUpdateTime = Timer::GetSystemRelativeTime();
-				newMeshRecord.lastSurfaceUpdateTime = sourceMesh.SurfaceInfo().UpdateTime().time_since_epoch().count();
-				newMeshRecord.color = XMVectorSet(0.5f, 0.5f, 0.5f, 1.0f);
-
-				auto tryTransform = sourceMesh.CoordinateSystem().TryGetTransformTo(m_referenceFrame.CoordinateSystem());
-				if (tryTransform)
-					newMeshRecord.worldTransform = tryTransform.Value();
-
-				newMeshRecord.mesh = make_shared<Mesh>(nullptr, 0);
-				ConvertMesh(newMeshRecord.sourceMesh, newMeshRecord.mesh);
-				newMeshRecord.sourceMesh = nullptr;
-				newMeshRecord.mesh->UpdateBoundingBox();
-
-				if (m_surfaceDrawMode != SurfaceDrawMode::None)
-					newMeshRecord.InitDrawCall();
-
-				m_newMeshRecordsMutex.lock();
-				m_newMeshRecords.push_back(newMeshRecord);
-				m_newMeshRecordsMutex.unlock();
-			}
-		}
-	}
+void SurfaceMapping::PublishMeshRecords(std::vector<MeshRecord>&& meshRecords)
+{
+	lock_guard<mutex> lock(m_newMeshRecordsMutex);
+	for (auto& meshRecord : meshRecords)
+		m_newMeshRecords.push_back(move(meshRecord));
 }
 
 unsigned SurfaceMapping::GetNumberOfSurfacesInProcessingQueue()
@@ -1024,6 +1032,18 @@ unsigned SurfaceMapping::GetNumberOfSurfacesInProcessingQueue()
 	return m_numberOfSurfacesInProcessingQueue;
 }
 
+void SurfaceMapping::SetSurfaceMeshCallback(SurfaceMeshCallback callback)
+{
+	lock_guard<mutex> lock(m_surfaceMeshCallbackMutex);
+	m_surfaceMeshCallback = callback;
+}
+
+SurfaceSchedulerMetrics SurfaceMapping::GetSurfaceProcessingMetrics()
+{
+	lock_guard<mutex> lock(m_numberOfSurfacesInProcessingQueueMutex);
+	return m_surfaceProcessingMetrics;
+}
+
 bool SurfaceMapping::IsActive()
 {
 	return m_isActive;
@@ -1053,11 +1073,13 @@ void SurfaceMapping::Update(const XMVECTOR& headPosition)
 	}
 	m_meshRecordIDsToErase.clear();
 
+	m_newMeshRecordsMutex.lock();
 	for (auto& meshRecord : m_newMeshRecords)
 	{
 		m_meshRecords[meshRecord.id] = meshRecord;
 	}
 	m_newMeshRecords.clear();
+	m_newMeshRecordsMutex.unlock();
 
 	if (!m_meshRecords.empty())
 		m_isActive = true;
@@ -1065,6 +1087,18 @@ void SurfaceMapping::Update(const XMVECTOR& headPosition)
 	m_meshRecordsMutex.unlock();
 }
 
+template<typename T>
+static T* GetBufferData(winrt::Windows::Storage::Streams::IBuffer const& buffer)
+{
+	Microsoft::WRL::ComPtr<IUnknown> unknown = (IUnknown*)winrt::get_abi(buffer);
+	Microsoft::WRL::ComPtr<Windows::Storage::Streams::IBufferByteAccess> bufferByteAccess;
+	unknown.As(&bufferByteAccess);
+
+	T* pData = nullptr;
+	bufferByteAccess->Buffer((unsigned char**)& pData);
+	return pData;
+}
+
 void SurfaceMapping::ConvertMesh(winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh sourceMesh, shared_ptr<Mesh> destinationMesh)
 {
 	if (!sourceMesh || !destinationMesh)
@@ -1079,23 +1113,9 @@ void SurfaceMapping::ConvertMesh(winrt::Windows::Perception::Spatial::Surfaces::
 	auto spatialNormalsFormat = sourceMesh.VertexNormals().Format();
 	assert((DXGI_FORMAT)spatialNormalsFormat == DXGI_FORMAT_R8G8B8A8_SNORM);
 
-	Microsoft::WRL::ComPtr<IUnknown> unknown;
-	Microsoft::WRL::ComPtr<Windows::Storage::Streams::IBufferByteAccess> bufferByteAccess;
-
-	unknown = (IUnknown*)winrt::get_abi(sourceMesh.TriangleIndices().Data());
-	unknown.As(&bufferByteAccess);
-	unsigned short* pSourceIndexBuffer = nullptr;
-	bufferByteAccess->Buffer((unsigned char**)& pSourceIndexBuffer);
-
-	unknown = (IUnknown*)winrt::get_abi(sourceMesh.VertexPositions().Data());
-	unknown.As(&bufferByteAccess);
-	short* pSourcePositionsBuffer = nullptr;
-	bufferByteAccess->Buffer((unsigned char**)& pSourcePositionsBuffer);
-
-	unknown = (IUnknown*)winrt::get_abi(sourceMesh.VertexNormals().Data());
-	unknown.As(&bufferByteAccess);
-	char* pSourceNormalsBuffer = nullptr;
-	bufferByteAccess->Buffer((unsigned char**)& pSourceNormalsBuffer);
+	unsigned short* pSourceIndexBuffer = GetBufferData<unsigned short>(sourceMesh.TriangleIndices().Data());
+	short* pSourcePositionsBuffer = GetBufferData<short>(sourceMesh.VertexPositions().Data());
+	char* pSourceNormalsBuffer = GetBufferData<char>(sourceMesh.VertexNormals().Data());
 
 	auto vertexScaleFactor = sourceMesh.VertexPositionScale();
 	float short_max = pow(2.0f, 15.0f);
@@ -1132,6 +1152,32 @@ void SurfaceMapping::ConvertMesh(winrt::Windows::Perception::Spatial::Surfaces::
 	}
 }
 
+void SurfaceMapping::NotifySurfaceMeshCallback(winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh sourceMesh, const winrt::Windows::Foundation::Numerics::float4x4& worldTransform)
+{
+	lock_guard<mutex> lock(m_surfaceMeshCallbackMutex);
+	if (!m_surfaceMeshCallback || !sourceMesh)
+		return;
+
+	SurfaceMeshSnapshot snapshot;
+	snapshot.id = sourceMesh.SurfaceInfo().Id();
+	snapshot.surfaceUpdateTime = sourceMesh.SurfaceInfo().UpdateTime().time_since_epoch().count();
+	snapshot.worldTransform = worldTransform;
+	snapshot.vertexPositionScale = sourceMesh.VertexPositionScale();
+
+	const unsigned vertexCount = sourceMesh.VertexPositions().ElementCount();
+	const unsigned indexCount = sourceMesh.TriangleIndices().ElementCount();
+
+	const short* pSourcePositionsBuffer = GetBufferData<short>(sourceMesh.VertexPositions().Data());
+	const char* pSourceNormalsBuffer = GetBufferData<char>(sourceMesh.VertexNormals().Data());
+	const unsigned short* pSourceIndexBuffer = GetBufferData<unsigned short>(sourceMesh.TriangleIndices().Data());
+
+	snapshot.positions.assign(pSourcePositionsBuffer, pSourcePositionsBuffer + vertexCount * 4);
+	snapshot.normals.assign(pSourceNormalsBuffer, pSourceNormalsBuffer + vertexCount * 4);
+	snapshot.indices.assign(pSourceIndexBuffer, pSourceIndexBuffer + indexCount);
+
+	m_surfaceMeshCallback(snapshot);
+}
+
 void SurfaceMapping::DrawMeshes()
 {
 	if (m_surfaceDrawMode == SurfaceDrawMode::None)
@@ -1140,15 +1186,27 @@ void SurfaceMapping::DrawMeshes()
 	if(m_surfaceDrawMode == SurfaceDrawMode::Occlusion)
 		DrawCall::PushAlphaBlendState(DrawCall::BLEND_COLOR_DISABLED);
 
+	m_headPositionMutex.lock();
+	XMVECTOR headPosition = m_headPosition;
+	m_headPositionMutex.unlock();
+
 	m_meshRecordsMutex.lock();
 	for (auto& pair : m_meshRecords)
 	{
-		if (!pair.second.drawCall)
+		MeshRecord& meshRecord = pair.second;
+		if (meshRecord.drawCalls.empty())
 		{
-			pair.second.InitDrawCall();
+			meshRecord.InitDrawCalls();
+			if (meshRecord.drawCalls.empty())
+				continue;
 		}
 
-		pair.second.drawCall->Draw();
+		const BoundingBox& boundingBox = meshRecord.mesh->GetBoundingBox();
+		XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&boundingBox.Center), XMLoadFloat4x4(&meshRecord.worldTransform));
+		float distance = XMVectorGetX(XMVector3Length(center - headPosition));
+
+		size_t lodIndex = SelectLODForDistance(meshRecord.lods, distance, m_drawLODAngularTolerance);
+		meshRecord.drawCalls[lodIndex]->Draw();
 	}
 	m_meshRecordsMutex.unlock();
 
@@ -1157,6 +1215,11 @@ void SurfaceMapping::DrawMeshes()
 }
 
 bool SurfaceMapping::TestRayIntersection(XMVECTOR rayOrigin, XMVECTOR rayDirection, float& distance, XMVECTOR& normal)
+{
+	return TestRayIntersection(rayOrigin, rayDirection, distance, normal, 0.0f);
+}
+
+bool SurfaceMapping::TestRayIntersection(XMVECTOR rayOrigin, XMVECTOR rayDirection, float& distance, XMVECTOR& normal, float tolerance)
 {
 	bool hit = false;
 	distance = FLT_MAX;
@@ -1164,15 +1227,18 @@ bool SurfaceMapping::TestRayIntersection(XMVECTOR rayOrigin, XMVECTOR rayDirecti
 	m_meshRecordsMutex.lock();
 	for (auto& meshRecordPair : m_meshRecords)
 	{
-		if (!meshRecordPair.second.mesh)
+		const MeshRecord& meshRecord = meshRecordPair.second;
+		if (!meshRecord.mesh)
 			continue;
 
-		XMMATRIX worldTransform = XMLoadFloat4x4(&meshRecordPair.second.worldTransform);
+		const shared_ptr<Mesh>& mesh = meshRecord.lods.empty() ? meshRecord.mesh : meshRecord.lods[SelectLODForTolerance(meshRecord.lods, tolerance)].mesh;
+
+		XMMATRIX worldTransform = XMLoadFloat4x4(&meshRecord.worldTransform);
 
 		float currentDistance;
 		XMVECTOR currentNormal;
 
-		bool result = meshRecordPair.second.mesh->TestRayIntersection(rayOrigin, rayDirection, worldTransform, currentDistance, currentNormal);
+		bool result = mesh->TestRayIntersection(rayOrigin, rayDirection, worldTransform, currentDistance, currentNormal);
 
 		if (result && currentDistance < distance)
 		{
@@ -1186,6 +1252,54 @@ bool SurfaceMapping::TestRayIntersection(XMVECTOR rayOrigin, XMVECTOR rayDirecti
 	return hit;
 }
 
+bool SurfaceMapping::FindClosestPoint(XMVECTOR point, float maxDistance, XMVECTOR& closestPoint, XMVECTOR& normal, float& distance)
+{
+	Mesh::ClosestPointResult result;
+	FindClosestPoints(&point, 1, maxDistance, &result);
+	if (!result.found)
+		return false;
+
+	closestPoint = result.point;
+	normal = result.normal;
+	distance = result.distance;
+	return true;
+}
+
+void SurfaceMapping::FindClosestPoints(const XMVECTOR* pPoints, size_t pointCount, float maxDistance, Mesh::ClosestPointResult* pResults, float tolerance)
+{
+	for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex)
+	{
+		pResults[pointIndex].found = false;
+		pResults[pointIndex].distance = maxDistance;
+	}
+
+	lock_guard<mutex> lock(m_meshRecordsMutex);
+	for (auto& meshRecordPair : m_meshRecords)
+	{
+		const MeshRecord& meshRecord = meshRecordPair.second;
+		if (!meshRecord.mesh)
+			continue;
+
+		const shared_ptr<Mesh>& mesh = meshRecord.lods.empty() ? meshRecord.mesh : meshRecord.lods[SelectLODForTolerance(meshRecord.lods, tolerance)].mesh;
+		XMMATRIX worldTransform = XMLoadFloat4x4(&meshRecord.worldTransform);
+		XMVECTOR boundsCenter = XMLoadFloat3(&meshRecord.worldBoundingBox.Center);
+		XMVECTOR boundsExtents = XMLoadFloat3(&meshRecord.worldBoundingBox.Extents);
+
+		// Coarser LODs can stray from the full detail bounds by up to their error. The surface is searched once for the
+		//	whole batch, as soon as one of the points may have a closer point on it.
+		bool inReach = false;
+		for (size_t pointIndex = 0; pointIndex < pointCount && !inReach; ++pointIndex)
+		{
+			XMVECTOR outside = XMVectorMax(XMVectorAbs(pPoints[pointIndex] - boundsCenter) - boundsExtents, XMVectorZero());
+			float boundsDistance = XMVectorGetX(XMVector3Length(outside)) - tolerance;
+			inReach = boundsDistance <= pResults[pointIndex].distance;
+		}
+
+		if (inReach)
+			mesh->RefineClosestPoints(pPoints, pointCount, worldTransform, pResults);
+	}
+}
+
 #ifdef ENABLE_QRCODE_API
 size_t QRCodeTracker::m_nextInstanceID = 1;
 
@@ -28,11 +28,14 @@
 #endif
 
 #include "Common/Intersectable.h"
+#include "Common/SurfaceScheduler.h"
 #include "DrawCall.h"
+#include "MeshSimplification.h"
 
 #include <d3d11.h>
 #include <DirectXMath.h>
 
+#include <functional>
 #include <memory>
 #include <vector>
 #include <map>
@@ -280,6 +283,24 @@ enum class SurfaceDrawMode
 	Mode_Count
 };
 
+// Surface geometry exactly as the system delivered it, before conversion to float vertices.
+//	Positions are R16G16B16A16_SNORM (multiply by vertexPositionScale / 32768), normals R8G8B8A8_SNORM,
+//	worldTransform takes row vectors from surface space into the SurfaceMapping reference frame.
+struct SurfaceMeshSnapshot
+{
+	winrt::guid id;
+	long long surfaceUpdateTime = 0;	// SpatialSurfaceInfo::UpdateTime, 100ns ticks
+	winrt::Windows::Foundation::Numerics::float4x4 worldTransform;
+	winrt::Windows::Foundation::Numerics::float3 vertexPositionScale;
+
+	std::vector<short> positions;			// 4 per vertex
+	std::vector<char> normals;				// 4 per vertex
+	std::vector<unsigned short> indices;
+};
+
+// Called on the surface observation thread each time a surface mesh is (re)computed
+typedef std::function<void(const SurfaceMeshSnapshot& snapshot)> SurfaceMeshCallback;
+
 class SurfaceMapping : public Intersectable
 {
 public:
@@ -297,10 +318,28 @@ public:
 
 	unsigned GetNumberOfSurfacesInProcessingQueue();
 
+	// Time-to-coverage and throughput of the background surface processing, refreshed every observation poll
+	SurfaceSchedulerMetrics GetSurfaceProcessingMetrics();
+
+	// Pass nullptr to stop receiving snapshots
+	void SetSurfaceMeshCallback(SurfaceMeshCallback callback);
+
 	void DrawMeshes();
 
 	virtual bool TestRayIntersection(XMVECTOR rayOrigin, XMVECTOR rayDirection, float& distance, XMVECTOR& normal);
 
+	// Tests against the coarsest mesh LODs whose simplification error is within tolerance (meters), for queries that don't need full detail
+	bool TestRayIntersection(XMVECTOR rayOrigin, XMVECTOR rayDirection, float& distance, XMVECTOR& normal, float tolerance);
+
+	virtual bool FindClosestPoint(XMVECTOR point, float maxDistance, XMVECTOR& closestPoint, XMVECTOR& normal, float& distance);
+
+	// Batched form for per-frame queries such as every hand joint, the mesh records are locked once for the whole batch.
+	//	Surfaces whose world bounds are further than the best hit so far are skipped without touching their triangles.
+	void FindClosestPoints(const XMVECTOR* pPoints, size_t pointCount, float maxDistance, Mesh::ClosestPointResult* pResults, float tolerance = 0.0f);
+
+	// Meshes are drawn at the coarsest LOD whose error stays under this angle seen from the head (radians), 0 draws full detail
+	void SetDrawLODAngularTolerance(float angularTolerance) { m_drawLODAngularTolerance = angularTolerance; }
+
 private:
 
 	struct MeshRecord
@@ -308,15 +347,17 @@ private:
 		winrt::guid id;
 
 		std::shared_ptr<Mesh> mesh;
+		std::vector<MeshLOD> lods;		// lods[0].mesh == mesh, coarser levels generated on the processing workers
 		winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh sourceMesh{ nullptr };	// This will be nullptr unless update is in progresss
 
 		long long lastMeshUpdateTime;		// The time when this mesh was last updated with the last surface
 		long long lastSurfaceUpdateTime;	// The time when the last surface was last updated by the system
 
 		winrt::Windows::Foundation::Numerics::float4x4 worldTransform;
+		BoundingBox worldBoundingBox;		// Full detail mesh bounds in the reference frame, for culling proximity queries
 		XMVECTOR color;
 
-		std::shared_ptr<DrawCall> drawCall;	// For visualization
+		std::vector<std::shared_ptr<DrawCall>> drawCalls;	// For visualization, one per LOD
 
 		MeshRecord()
 		{
@@ -329,11 +370,16 @@ private:
 			color = XMVectorZero();
 		}
 
-		void InitDrawCall()
+		void InitDrawCalls()
 		{
-			drawCall = std::make_shared<DrawCall>("Lit_VS.cso", "Lit_PS.cso", mesh);
-			drawCall->SetColor(color);
-			drawCall->SetWorldTransform(XMLoadFloat4x4(&worldTransform));
+			drawCalls.clear();
+			for (auto& lod : lods)
+			{
+				auto drawCall = std::make_shared<DrawCall>("Lit_VS.cso", "Lit_PS.cso", lod.mesh);
+				drawCall->SetColor(color);
+				drawCall->SetWorldTransform(XMLoadFloat4x4(&worldTransform));
+				drawCalls.push_back(drawCall);
+			}
 		}
 	};
 	typedef std::pair<winrt::guid, MeshRecord> MeshRecordPair;
@@ -344,6 +390,7 @@ private:
 
 	bool m_isActive;
 	SurfaceDrawMode m_surfaceDrawMode;
+	float m_drawLODAngularTolerance;
 
 	XMVECTOR m_headPosition;
 	std::mutex m_headPositionMutex;
@@ -358,13 +405,21 @@ private:
 	std::vector<MeshRecord> m_newMeshRecords;
 	std::mutex m_newMeshRecordsMutex;
 
+	SurfaceMeshCallback m_surfaceMeshCallback;
+	std::mutex m_surfaceMeshCallbackMutex;
+
 	std::unique_ptr<std::thread> m_surfaceObservationThread;
 
-	typedef std::pair<long long, winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo> TimestampSurfacePair;
+	typedef SurfaceScheduler<winrt::guid, winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo, MeshRecord> SurfaceMeshScheduler;
+	SurfaceMeshScheduler::Metrics m_surfaceProcessingMetrics;
+
 	void CreaterObserverIfNeeded();
-	void GetLatestSurfacesToProcess(std::vector<TimestampSurfacePair>& surfacesToProcess);
+	void GetLatestSurfacesToProcess(const XMVECTOR& headPosition, std::vector<SurfaceMeshScheduler::Candidate>& surfacesToProcess);
 	void SurfaceObservationThreadFunction();
+	bool ProcessSurface(const winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo& surfaceInfo, MeshRecord& meshRecord);
+	void PublishMeshRecords(std::vector<MeshRecord>&& meshRecords);
 	void ConvertMesh(winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh sourceMesh, std::shared_ptr<Mesh> destinationMesh);
+	void NotifySurfaceMeshCallback(winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh sourceMesh, const winrt::Windows::Foundation::Numerics::float4x4& worldTransform);
 };
 
 // To use QR code tracking:
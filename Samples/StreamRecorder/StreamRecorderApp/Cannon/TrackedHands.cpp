@@ -13,11 +13,18 @@
 
 #include "TrackedHands.h"
 
+#include <algorithm>
+#include <cstring>
+
 
 TrackedHands::TrackedHands() :
 	m_timestamps{ 0 },
-	m_isNewFrameAvailable(false)
+	m_isNewFrameAvailable(false),
+	m_jointFilter(HAND_COUNT * kJointStride)
 {
+	memset(m_newJointPositions, 0, sizeof(m_newJointPositions));
+	memset(m_newSmoothedJointPositions, 0, sizeof(m_newSmoothedJointPositions));
+
 	m_headPosition = XMVectorZero();
 	m_headForward = XMVectorZero();
 	m_headUp = XMVectorZero();
@@ -37,10 +44,27 @@ void TrackedHands::ResetHand(size_t handIndex)
 
 	for (size_t jointIndex = 0; jointIndex < kHandJointCount; ++jointIndex)
 	{
-		m_handJoints[handIndex * kHandJointCount + jointIndex].Reset();
-		m_handOrientations[handIndex * kHandJointCount + jointIndex].Reset();
+		m_handOrientations[handIndex * kHandJointCount + jointIndex] = XMQuaternionIdentity();
 		m_handRadii[handIndex * kHandJointCount + jointIndex] = 0.0f;
-	}	
+	}
+
+	memset(m_jointHistory[handIndex], 0, sizeof(m_jointHistory[handIndex]));
+	memset(m_smoothedJointHistory[handIndex], 0, sizeof(m_smoothedJointHistory[handIndex]));
+	m_currentHistoryFrames[handIndex] = 0;
+	m_historyFrameCounts[handIndex] = 0;
+	m_jointFilter.Reset(handIndex * kJointStride, (handIndex + 1) * kJointStride);
+}
+
+int TrackedHands::GetHistoryFrame(size_t handIndex, int framesAgo) const
+{
+	// Asking for more than was recorded gives the oldest frame
+	framesAgo = std::max(0, std::min(framesAgo, m_historyFrameCounts[handIndex] - 1));
+	return (m_currentHistoryFrames[handIndex] - framesAgo + kMaxHistoryFrames) % kMaxHistoryFrames;
+}
+
+XMVECTOR TrackedHands::GetHistoryPosition(const float (&positions)[3][kJointStride], size_t jointIndex) const
+{
+	return XMVectorSet(positions[0][jointIndex], positions[1][jointIndex], positions[2][jointIndex], 1.0f);
 }
 
 bool TrackedHands::IsHandTracked(size_t handIndex)
@@ -51,11 +75,11 @@ bool TrackedHands::IsHandTracked(size_t handIndex)
 		return false;
 }
 
-XMVECTOR TrackedHands::GetJoint(size_t handIndex, HandJointIndex jointIndex)
+XMVECTOR TrackedHands::GetJoint(size_t handIndex, HandJointIndex jointIndex, int framesAgo)
 {
 	if (handIndex < HAND_COUNT && (size_t)jointIndex < kHandJointCount)
 	{
-		return m_handJoints[handIndex * kHandJointCount + (size_t)jointIndex].GetValue(0);
+		return GetHistoryPosition(m_jointHistory[handIndex][GetHistoryFrame(handIndex, framesAgo)], (size_t)jointIndex);
 	}
 	else
 	{
@@ -67,7 +91,7 @@ XMVECTOR TrackedHands::GetJointOrientation(size_t handIndex, HandJointIndex join
 {
 	if (handIndex < HAND_COUNT && (size_t)jointIndex < kHandJointCount)
 	{
-		return m_handOrientations[handIndex * kHandJointCount + (size_t)jointIndex].GetValue(0);
+		return m_handOrientations[handIndex * kHandJointCount + (size_t)jointIndex];
 	}
 	else
 	{
@@ -93,8 +117,8 @@ XMMATRIX TrackedHands::GetOrientedJoint(size_t handIndex, HandJointIndex jointIn
 
 XMVECTOR TrackedHands::GetIndexTipSurfacePosition(size_t handIndex, int framesAgo)
 {
-	XMVECTOR indexTip = GetJointHistory(handIndex, HandJointIndex::IndexTip).GetValue(framesAgo);
-	XMVECTOR indexDistal = GetJointHistory(handIndex, HandJointIndex::IndexDistal).GetValue(framesAgo);
+	XMVECTOR indexTip = GetJoint(handIndex, HandJointIndex::IndexTip, framesAgo);
+	XMVECTOR indexDistal = GetJoint(handIndex, HandJointIndex::IndexDistal, framesAgo);
 	float indexRadius = GetJointRadius(handIndex, HandJointIndex::IndexTip);
 
 	return XMVectorSetW(indexTip + XMVector3Normalize(indexTip - indexDistal) * indexRadius * 1.5f, 1.0f);
@@ -112,24 +136,19 @@ float TrackedHands::GetJointRadius(size_t handIndex, HandJointIndex jointIndex)
 	}
 }
 
-RecordedValue& TrackedHands::GetJointHistory(size_t handIndex, HandJointIndex jointIndex)
+unsigned TrackedHands::GetJointHistoryFrameCount(size_t handIndex)
 {
-	if (handIndex < HAND_COUNT && (size_t)jointIndex < kHandJointCount)
-	{
-		return m_handJoints[handIndex * kHandJointCount + (size_t)jointIndex];
-	}
+	if (handIndex < HAND_COUNT)
+		return m_historyFrameCounts[handIndex];
 	else
-	{
-		static RecordedValue blankRecordedValue;
-		return blankRecordedValue;
-	}
+		return 0;
 }
 
-XMVECTOR TrackedHands::GetSmoothedJoint(size_t handIndex, HandJointIndex jointIndex)
+XMVECTOR TrackedHands::GetSmoothedJoint(size_t handIndex, HandJointIndex jointIndex, int framesAgo)
 {
 	if (handIndex < HAND_COUNT && (size_t)jointIndex < kHandJointCount)
 	{
-		return m_handJoints[handIndex * kHandJointCount + (size_t)jointIndex].GetSmoothedValue(0);
+		return GetHistoryPosition(m_smoothedJointHistory[handIndex][GetHistoryFrame(handIndex, framesAgo)], (size_t)jointIndex);
 	}
 	else
 	{
@@ -165,6 +184,7 @@ XMVECTOR TrackedHands::CalculatePalmDirection(size_t handIndex, XMVECTOR wrist,
 void TrackedHands::UpdateFromMixedReality(MixedReality& mixedReality)
 {
 	m_isNewFrameAvailable = false;
+	bool handUpdated[HAND_COUNT] = {};
 
 	for (size_t handIndex = 0; handIndex < HAND_COUNT; ++handIndex)
 	{
@@ -178,6 +198,7 @@ void TrackedHands::UpdateFromMixedReality(MixedReality& mixedReality)
 			{
 				m_timestamps[handIndex] = pHandData->lastTimestamp;
 				m_isNewFrameAvailable = true;
+				handUpdated[handIndex] = true;
 			}
 			else
 			{
@@ -194,15 +215,54 @@ void TrackedHands::UpdateFromMixedReality(MixedReality& mixedReality)
 		for (size_t jointIndex = 0; jointIndex < kHandJointCount; ++jointIndex)
 		{
 			size_t finalIndex = handIndex * kHandJointCount + jointIndex;
-			XMVECTOR worldPosition = pHandData->handJoints[jointIndex].position;
+			size_t laneIndex = handIndex * kJointStride + jointIndex;
+
+			XMFLOAT3 worldPosition;
+			XMStoreFloat3(&worldPosition, pHandData->handJoints[jointIndex].position);
+			m_newJointPositions[0][laneIndex] = worldPosition.x;
+			m_newJointPositions[1][laneIndex] = worldPosition.y;
+			m_newJointPositions[2][laneIndex] = worldPosition.z;
 
-			m_handJoints[finalIndex].RecordValue(worldPosition);
-			XMVECTOR worldOrientation = pHandData->handJoints[jointIndex].orientation;
-			m_handOrientations[finalIndex].RecordValue(worldOrientation);
+			m_handOrientations[finalIndex] = pHandData->handJoints[jointIndex].orientation;
 			m_handRadii[finalIndex] = pHandData->handJoints[jointIndex].radius;			
 		}		
 	}
 
+	// Smooth the joints of every updated hand in one pass over the filter lanes. Hands are laid out one after the other,
+	//	so consecutive updated hands are merged into a single range.
+	for (size_t handIndex = 0; handIndex < HAND_COUNT;)
+	{
+		if (!handUpdated[handIndex])
+		{
+			++handIndex;
+			continue;
+		}
+
+		size_t endHandIndex = handIndex + 1;
+		while (endHandIndex < HAND_COUNT && handUpdated[endHandIndex])
+			++endHandIndex;
+
+		m_jointFilter.Update(m_newJointPositions[0], m_newJointPositions[1], m_newJointPositions[2], handIndex * kJointStride, endHandIndex * kJointStride);
+		m_jointFilter.GetFilteredValues(m_newSmoothedJointPositions[0], m_newSmoothedJointPositions[1], m_newSmoothedJointPositions[2], handIndex * kJointStride, endHandIndex * kJointStride);
+		handIndex = endHandIndex;
+	}
+
+	for (size_t handIndex = 0; handIndex < HAND_COUNT; ++handIndex)
+	{
+		if (!handUpdated[handIndex])
+			continue;
+
+		const int frame = (m_currentHistoryFrames[handIndex] + 1) % kMaxHistoryFrames;
+		m_currentHistoryFrames[handIndex] = frame;
+		m_historyFrameCounts[handIndex] = std::min(m_historyFrameCounts[handIndex] + 1, kMaxHistoryFrames);
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			memcpy(m_jointHistory[handIndex][frame][axis], &m_newJointPositions[axis][handIndex * kJointStride], sizeof(float) * kJointStride);
+			memcpy(m_smoothedJointHistory[handIndex][frame][axis], &m_newSmoothedJointPositions[axis][handIndex * kJointStride], sizeof(float) * kJointStride);
+		}
+	}
+
 	m_headPosition = mixedReality.GetHeadPosition();
 	m_headForward = mixedReality.GetHeadForwardDirection();
 	m_headUp = mixedReality.GetHeadUpDirection();
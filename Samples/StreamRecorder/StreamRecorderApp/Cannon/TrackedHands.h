@@ -13,7 +13,7 @@
 #pragma once
 
 #include "MixedReality.h"
-#include "RecordedValue.h"
+#include "Common/FilterDoubleExponentialBatch.h"
 
 #define HAND_COUNT 2
 
@@ -29,14 +29,15 @@ public:
 	const XMMATRIX& GetHeadTransform() { return m_headTransform; }
 	bool IsHandTracked(size_t handIndex);
 	
-	XMVECTOR GetJoint(size_t handIndex, HandJointIndex jointIndex);
+	// framesAgo counts hand tracking frames of that hand, up to kMaxHistoryFrames - 1
+	XMVECTOR GetJoint(size_t handIndex, HandJointIndex jointIndex, int framesAgo = 0);
 	XMVECTOR GetJointOrientation(size_t handIndex, HandJointIndex jointIndex);	// XMVECTOR is a quaternion in this case
 	XMMATRIX GetOrientedJoint(size_t handIndex, HandJointIndex jointIndex);
 	XMVECTOR GetIndexTipSurfacePosition(size_t handIndex, int framesAgo = 0);
 	float GetJointRadius(size_t handIndex, HandJointIndex jointIndex);
-	RecordedValue& GetJointHistory(size_t handIndex, HandJointIndex jointIndex);
+	unsigned GetJointHistoryFrameCount(size_t handIndex);
 
-	XMVECTOR GetSmoothedJoint(size_t handIndex, HandJointIndex jointIndex);
+	XMVECTOR GetSmoothedJoint(size_t handIndex, HandJointIndex jointIndex, int framesAgo = 0);
 	XMVECTOR GetSmoothedPalmDirection(size_t handIndex);
 	static XMVECTOR CalculatePointingDirection(XMVECTOR wrist, XMVECTOR indexBase, XMVECTOR pinkyBase); //Direction from wrist through middle knuckle area
 	static XMVECTOR CalculatePalmDirection(size_t handIndex, XMVECTOR wrist, XMVECTOR indexBase, XMVECTOR pinkyBase); // Normal to palm of hand
@@ -45,7 +46,13 @@ public:
 	XMVECTOR GetHeadForward() { return m_headForward; }
 	XMVECTOR GetHeadUp() { return m_headUp; }
 	
+	static constexpr int kMaxHistoryFrames = 60;
+
 private:
+	// Joints of one hand padded to whole filter groups, so each hand owns its own range of filter lanes
+	static constexpr size_t kJointStride = (kHandJointCount + FilterDoubleExponentialBatch::kLanesPerGroup - 1) /
+		FilterDoubleExponentialBatch::kLanesPerGroup * FilterDoubleExponentialBatch::kLanesPerGroup;
+
 	long long m_timestamps[HAND_COUNT];
 	bool m_isNewFrameAvailable;
 
@@ -56,7 +63,21 @@ private:
 	XMMATRIX m_headTransform;
 
 	bool m_handTrackedStates[HAND_COUNT];	
-	RecordedValue m_handJoints[HAND_COUNT * kHandJointCount];
-	RecordedValue m_handOrientations[HAND_COUNT * kHandJointCount];
+	XMVECTOR m_handOrientations[HAND_COUNT * kHandJointCount];
 	float m_handRadii[HAND_COUNT * kHandJointCount];
+
+	// Joint positions are stored as structure of arrays, [axis][handIndex * kJointStride + jointIndex] for the
+	//	newest frame and [handIndex][frame][axis][jointIndex] for the history rings
+	float m_newJointPositions[3][HAND_COUNT * kJointStride];
+	float m_newSmoothedJointPositions[3][HAND_COUNT * kJointStride];
+	float m_jointHistory[HAND_COUNT][kMaxHistoryFrames][3][kJointStride];
+	float m_smoothedJointHistory[HAND_COUNT][kMaxHistoryFrames][3][kJointStride];
+	int m_currentHistoryFrames[HAND_COUNT];
+	int m_historyFrameCounts[HAND_COUNT];
+
+	// One double exponential filter per joint of both hands, updated together
+	FilterDoubleExponentialBatch m_jointFilter;
+
+	int GetHistoryFrame(size_t handIndex, int framesAgo) const;
+	XMVECTOR GetHistoryPosition(const float (&positions)[3][kJointStride], size_t jointIndex) const;
 };
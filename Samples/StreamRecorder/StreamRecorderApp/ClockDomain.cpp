@@ -0,0 +1,141 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ClockDomain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+    // Crystal oscillators are off by tens of ppm, a larger fitted drift is noise on too short a window
+    const double kMaxDrift = 1e-3;
+
+    // Conversions further than this from the reference (about 30 hours) use the drift up to there. With the drift
+    // clamped, the correction can't overflow.
+    const int64_t kMaxDriftSpan = int64_t(1) << 40;
+
+    const double kQ32 = 4294967296.0;
+}
+
+ClockDomain::ClockDomain(uint64_t qpcFrequency, const ClockDomainOptions& options) :
+    m_qpcFrequency(qpcFrequency),
+    m_options(options)
+{
+    m_samples.reserve((std::max)(m_options.windowSize, size_t(1)));
+}
+
+void ClockDomain::AddSample(int64_t qpc, int64_t fileTime)
+{
+    const int64_t ticks = QpcToRelativeTicks(qpc).count();
+    const int64_t offset = fileTime - ticks;
+
+    // The system time was set or synchronized: the older samples belong to another mapping
+    if (m_sampleCount > 0)
+    {
+        const int64_t predictedOffset = Convert(m_published, HundredsOfNanoseconds(ticks)).count() - ticks;
+        if (std::llabs(offset - predictedOffset) > m_options.stepThreshold.count())
+        {
+            m_samples.clear();
+            m_nextSample = 0;
+        }
+    }
+
+    const size_t windowSize = (std::max)(m_options.windowSize, size_t(1));
+    if (m_samples.size() < windowSize)
+    {
+        m_samples.push_back(Sample{ ticks, offset });
+    }
+    else
+    {
+        m_samples[m_nextSample] = Sample{ ticks, offset };
+    }
+    m_nextSample = (m_nextSample + 1) % windowSize;
+    m_sampleCount++;
+
+    // Least squares line of the offset against the relative time, centered on the new sample so the doubles only
+    // hold differences
+    const double count = double(m_samples.size());
+    double meanTicks = 0.0;
+    double meanOffset = 0.0;
+    for (const Sample& sample : m_samples)
+    {
+        meanTicks += double(sample.ticks - ticks);
+        meanOffset += double(sample.offset - offset);
+    }
+    meanTicks /= count;
+    meanOffset /= count;
+
+    double sxx = 0.0;
+    double sxy = 0.0;
+    for (const Sample& sample : m_samples)
+    {
+        const double dx = double(sample.ticks - ticks) - meanTicks;
+        sxx += dx * dx;
+        sxy += dx * (double(sample.offset - offset) - meanOffset);
+    }
+    const double drift = sxx > 0.0 ? (std::min)((std::max)(sxy / sxx, -kMaxDrift), kMaxDrift) : 0.0;
+
+    ClockSnapshot snapshot;
+    snapshot.referenceTicks = ticks;
+    snapshot.offsetTicks = offset + std::llround(meanOffset - drift * meanTicks);
+    snapshot.driftQ32 = std::llround(drift * kQ32);
+    snapshot.version = m_sampleCount;
+    Publish(snapshot);
+}
+
+void ClockDomain::Publish(const ClockSnapshot& snapshot)
+{
+    m_published = snapshot;
+
+    const uint64_t sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_referenceTicks.store(snapshot.referenceTicks, std::memory_order_relaxed);
+    m_offsetTicks.store(snapshot.offsetTicks, std::memory_order_relaxed);
+    m_driftQ32.store(snapshot.driftQ32, std::memory_order_relaxed);
+    m_version.store(snapshot.version, std::memory_order_relaxed);
+
+    m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+ClockSnapshot ClockDomain::GetSnapshot() const
+{
+    ClockSnapshot snapshot;
+    for (;;)
+    {
+        const uint64_t sequence = m_sequence.load(std::memory_order_acquire);
+        if (sequence & 1)
+        {
+            continue;
+        }
+
+        snapshot.referenceTicks = m_referenceTicks.load(std::memory_order_relaxed);
+        snapshot.offsetTicks = m_offsetTicks.load(std::memory_order_relaxed);
+        snapshot.driftQ32 = m_driftQ32.load(std::memory_order_relaxed);
+        snapshot.version = m_version.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_sequence.load(std::memory_order_relaxed) == sequence)
+        {
+            return snapshot;
+        }
+    }
+}
+
+HundredsOfNanoseconds ClockDomain::Convert(const ClockSnapshot& snapshot, HundredsOfNanoseconds ticks)
+{
+    const int64_t span = (std::min)((std::max)(ticks.count() - snapshot.referenceTicks, -kMaxDriftSpan), kMaxDriftSpan);
+    // The arithmetic shift rounds towards minus infinity, a bias below one tick
+    return ticks + HundredsOfNanoseconds(snapshot.offsetTicks + ((span * snapshot.driftQ32) >> 32));
+}
@@ -0,0 +1,100 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "TickConversions.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The mapping from the system relative time of the sensors (QPC, in 100 ns ticks) to absolute time (FILETIME ticks),
+// shared by all the recorded streams so their timestamps agree. Instead of one offset measured once, it fits
+// absolute = relative + offset + drift * (relative - reference) by least squares over the last clock samples, and
+// follows the drift between the two clocks over long sessions. A jump of the system time restarts the fit.
+//
+// One thread adds the samples (TimeConverter's refresh thread in the app), any number of threads convert. The
+// fitted mapping is published through a seqlock, so a conversion takes no lock and only integer arithmetic.
+// Kept free of Windows types so it also builds off device (ClockDomainTest).
+
+struct ClockDomainOptions
+{
+    size_t windowSize = 16;                                 // Samples the fit runs on
+    HundredsOfNanoseconds stepThreshold{ 10 * 10'000 };     // Larger residuals restart the fit
+};
+
+// The published mapping, a consistent copy of it
+struct ClockSnapshot
+{
+    int64_t referenceTicks = 0;     // Relative ticks of the latest sample
+    int64_t offsetTicks = 0;        // Absolute minus relative ticks at the reference
+    int64_t driftQ32 = 0;           // Drift of the absolute clock against the relative one, times 2^32
+    uint64_t version = 0;           // Number of samples added so far, 0 before the first one
+};
+
+class ClockDomain
+{
+public:
+    explicit ClockDomain(uint64_t qpcFrequency, const ClockDomainOptions& options = ClockDomainOptions());
+
+    ClockDomain(const ClockDomain&) = delete;
+    ClockDomain& operator=(const ClockDomain&) = delete;
+
+    // Writer side. qpc and fileTime are read at the same time, or as close as the caller can get.
+    void AddSample(int64_t qpc, int64_t fileTime);
+
+    // Reader side, lock free
+    ClockSnapshot GetSnapshot() const;
+
+    HundredsOfNanoseconds RelativeTicksToAbsoluteTicks(HundredsOfNanoseconds ticks) const
+    {
+        return Convert(GetSnapshot(), ticks);
+    }
+
+    HundredsOfNanoseconds QpcToRelativeTicks(int64_t qpc) const
+    {
+        // QPC usually counts 100 ns ticks already
+        return m_qpcFrequency == 10'000'000 ? HundredsOfNanoseconds(qpc) : ::QpcToRelativeTicks(qpc, m_qpcFrequency);
+    }
+
+    uint64_t GetQpcFrequency() const { return m_qpcFrequency; }
+
+    // For batches of timestamps converted with the same snapshot
+    static HundredsOfNanoseconds Convert(const ClockSnapshot& snapshot, HundredsOfNanoseconds ticks);
+
+private:
+    struct Sample
+    {
+        int64_t ticks;      // Relative
+        int64_t offset;     // Absolute minus relative
+    };
+
+    void Publish(const ClockSnapshot& snapshot);
+
+    const uint64_t m_qpcFrequency;
+    const ClockDomainOptions m_options;
+
+    // Writer state
+    std::vector<Sample> m_samples;      // Ring of the last windowSize samples
+    size_t m_nextSample = 0;
+    uint64_t m_sampleCount = 0;
+    ClockSnapshot m_published;
+
+    // Seqlock: odd while the writer updates the fields. The fields are atomics only so that a reader racing with
+    // the writer reads torn values instead of undefined behavior; it then retries.
+    std::atomic<uint64_t> m_sequence{ 0 };
+    std::atomic<int64_t> m_referenceTicks{ 0 };
+    std::atomic<int64_t> m_offsetTicks{ 0 };
+    std::atomic<int64_t> m_driftQ32{ 0 };
+    std::atomic<uint64_t> m_version{ 0 };
+};
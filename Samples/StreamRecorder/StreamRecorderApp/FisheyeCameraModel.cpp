@@ -0,0 +1,899 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "FisheyeCameraModel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if !defined(FISHEYE_CAMERA_MODEL_NO_SIMD)
+#if defined(_M_ARM64) || defined(__aarch64__)
+#define FISHEYE_CAMERA_MODEL_NEON
+#include <arm_neon.h>
+#elif defined(_M_X64) || defined(__SSE2__)
+#define FISHEYE_CAMERA_MODEL_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+namespace
+{
+    constexpr char kFileMagic[8] = { 'H', 'L', 'C', 'A', 'M', 'M', 'D', 'L' };
+
+    constexpr float kPi = 3.14159265358979f;
+    constexpr float kTanPiOver8 = 0.414213562f;
+    constexpr float kTiny = 1e-30f;
+    constexpr float kNaN = std::numeric_limits<float>::quiet_NaN();
+
+    // Lets the pixels at the edge of the field of view through, whatever side of it the fitted model puts them
+    constexpr float kMaxThetaMargin = 1e-3f;
+
+    constexpr int kNewtonIterations = 6;
+    constexpr int kResidualInversionSteps = 3;
+
+    constexpr size_t kMaxFitSamples = 20000;
+    constexpr int kMaxFitIterations = 50;
+
+    // Weight of the smoothness term between neighbouring grid nodes, relative to the samples per node. It fills
+    // the nodes outside the field of view and keeps the others from following noise.
+    constexpr double kResidualSmoothness = 1e-3;
+
+    // The part of the model the batch kernels need
+    struct PolynomialParams
+    {
+        float fx, fy, cx, cy;
+        float k[4];
+        float maxTheta;
+        float maxDistortedRadius;
+    };
+
+    // The kernels below are written once, as templates over float and the 4 lane type, so both give the same results
+    inline float Sqrt(float a) { return std::sqrt(a); }
+    inline float Min(float a, float b) { return (std::min)(a, b); }
+    inline float Max(float a, float b) { return (std::max)(a, b); }
+    inline float Abs(float a) { return std::fabs(a); }
+    inline bool Greater(float a, float b) { return a > b; }
+    inline bool LessEqual(float a, float b) { return a <= b; }
+    inline float Select(bool mask, float a, float b) { return mask ? a : b; }
+
+#if defined(FISHEYE_CAMERA_MODEL_NEON)
+    struct Float4
+    {
+        float32x4_t v;
+        Float4() = default;
+        Float4(float32x4_t a) : v(a) {}
+        Float4(float a) : v(vdupq_n_f32(a)) {}
+    };
+
+    inline Float4 operator+(Float4 a, Float4 b) { return vaddq_f32(a.v, b.v); }
+    inline Float4 operator-(Float4 a, Float4 b) { return vsubq_f32(a.v, b.v); }
+    inline Float4 operator*(Float4 a, Float4 b) { return vmulq_f32(a.v, b.v); }
+    inline Float4 operator/(Float4 a, Float4 b) { return vdivq_f32(a.v, b.v); }
+    inline Float4 Sqrt(Float4 a) { return vsqrtq_f32(a.v); }
+    inline Float4 Min(Float4 a, Float4 b) { return vminq_f32(a.v, b.v); }
+    inline Float4 Max(Float4 a, Float4 b) { return vmaxq_f32(a.v, b.v); }
+    inline Float4 Abs(Float4 a) { return vabsq_f32(a.v); }
+    inline uint32x4_t Greater(Float4 a, Float4 b) { return vcgtq_f32(a.v, b.v); }
+    inline uint32x4_t LessEqual(Float4 a, Float4 b) { return vcleq_f32(a.v, b.v); }
+    inline Float4 Select(uint32x4_t mask, Float4 a, Float4 b) { return vbslq_f32(mask, a.v, b.v); }
+    inline Float4 Load(const float* p) { return vld1q_f32(p); }
+    inline void Store(float* p, Float4 a) { vst1q_f32(p, a.v); }
+#elif defined(FISHEYE_CAMERA_MODEL_SSE2)
+    struct Float4
+    {
+        __m128 v;
+        Float4() = default;
+        Float4(__m128 a) : v(a) {}
+        Float4(float a) : v(_mm_set1_ps(a)) {}
+    };
+
+    inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+    inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+    inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+    inline Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+    inline Float4 Sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+    inline Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+    inline Float4 Max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+    inline Float4 Abs(Float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+
+    // Masks stay in float registers, all bits set in the lanes where the comparison holds
+    struct Mask4
+    {
+        __m128 m;
+    };
+
+    inline Mask4 Greater(Float4 a, Float4 b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+    inline Mask4 LessEqual(Float4 a, Float4 b) { return { _mm_cmple_ps(a.v, b.v) }; }
+    inline Float4 Select(Mask4 mask, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(mask.m, a.v), _mm_andnot_ps(mask.m, b.v)); }
+    inline Float4 Load(const float* p) { return _mm_loadu_ps(p); }
+    inline void Store(float* p, Float4 a) { _mm_storeu_ps(p, a.v); }
+#endif
+
+    // atan(a) for a in [0, 1]: the Cephes polynomial, after reducing a above tan(pi / 8) around 1
+    template <typename V>
+    V AtanUnit(V a)
+    {
+        const auto reduced = Greater(a, V(kTanPiOver8));
+        const V t = Select(reduced, (a - V(1.0f)) / (a + V(1.0f)), a);
+        const V t2 = t * t;
+        const V p = (((V(8.05374449538e-2f) * t2 - V(1.38776856032e-1f)) * t2 + V(1.99777106478e-1f)) * t2 - V(3.33329491539e-1f)) * t2 * t + t;
+        return Select(reduced, p + V(kPi / 4.0f), p);
+    }
+
+    // Angle between a ray and the z axis, r being the length of its (x, y) part
+    template <typename V>
+    V AngleFromAxis(V r, V z)
+    {
+        const V absZ = Abs(z);
+        const V a = AtanUnit(Min(r, absZ) / Max(Max(r, absZ), V(kTiny)));
+        const V theta = Select(Greater(r, absZ), V(kPi / 2.0f) - a, a);
+        return Select(Greater(V(0.0f), z), V(kPi) - theta, theta);
+    }
+
+    template <typename V>
+    V Distort(const PolynomialParams& p, V theta)
+    {
+        const V t2 = theta * theta;
+        return theta * (V(1.0f) + t2 * (V(p.k[0]) + t2 * (V(p.k[1]) + t2 * (V(p.k[2]) + t2 * V(p.k[3])))));
+    }
+
+    // Inverse of Distort by Newton's method from theta = rd. A fixed number of iterations keeps the lanes in step;
+    // the polynomial is close to the identity over the field of view, so it is already converged in float.
+    template <typename V>
+    V Undistort(const PolynomialParams& p, V rd)
+    {
+        V theta = rd;
+        for (int i = 0; i < kNewtonIterations; i++)
+        {
+            const V t2 = theta * theta;
+            const V slope = V(1.0f) + t2 * (V(3.0f * p.k[0]) + t2 * (V(5.0f * p.k[1]) + t2 * (V(7.0f * p.k[2]) + t2 * V(9.0f * p.k[3]))));
+            theta = theta - (Distort(p, theta) - rd) / Max(slope, V(1e-3f));
+            theta = Min(Max(theta, V(0.0f)), V(kPi / 2.0f));
+        }
+        return theta;
+    }
+
+    // Taylor series of the half angle, which stays under pi / 4 for the rays in front of the camera
+    template <typename V>
+    void SinCos(V theta, V& sinTheta, V& cosTheta)
+    {
+        const V h = theta * V(0.5f);
+        const V h2 = h * h;
+        const V sinH = h * (V(1.0f) - h2 * V(1.0f / 6.0f) * (V(1.0f) - h2 * V(1.0f / 20.0f) * (V(1.0f) - h2 * V(1.0f / 42.0f) * (V(1.0f) - h2 * V(1.0f / 72.0f)))));
+        const V cosH = V(1.0f) - h2 * V(0.5f) * (V(1.0f) - h2 * V(1.0f / 12.0f) * (V(1.0f) - h2 * V(1.0f / 30.0f) * (V(1.0f) - h2 * V(1.0f / 56.0f) * (V(1.0f) - h2 * V(1.0f / 90.0f)))));
+        sinTheta = V(2.0f) * sinH * cosH;
+        cosTheta = V(1.0f) - V(2.0f) * sinH * sinH;
+    }
+
+    // The polynomial part of the projection, NaN outside the field of view
+    template <typename V>
+    void ProjectPolynomial(const PolynomialParams& p, V x, V y, V z, V& u, V& v)
+    {
+        const V r = Sqrt(x * x + y * y);
+        const V theta = AngleFromAxis(r, z);
+        const V scale = Distort(p, theta) / Max(r, V(kTiny));
+        const auto inside = LessEqual(theta, V(p.maxTheta));
+        u = Select(inside, V(p.fx) * x * scale + V(p.cx), V(kNaN));
+        v = Select(inside, V(p.fy) * y * scale + V(p.cy), V(kNaN));
+    }
+
+    // The inverse of ProjectPolynomial, to unit rays, (0, 0, 0) outside the field of view or for NaN points
+    template <typename V>
+    void UnprojectPolynomial(const PolynomialParams& p, V u, V v, V& x, V& y, V& z)
+    {
+        const V mx = (u - V(p.cx)) * V(1.0f / p.fx);
+        const V my = (v - V(p.cy)) * V(1.0f / p.fy);
+        const V rd = Sqrt(mx * mx + my * my);
+        V sinTheta;
+        V cosTheta;
+        SinCos(Undistort(p, rd), sinTheta, cosTheta);
+        const V scale = sinTheta / Max(rd, V(kTiny));
+        const auto inside = LessEqual(rd, V(p.maxDistortedRadius));
+        x = Select(inside, mx * scale, V(0.0f));
+        y = Select(inside, my * scale, V(0.0f));
+        z = Select(inside, cosTheta, V(0.0f));
+    }
+
+    // Gaussian elimination with partial pivoting of the n x n system a x = b, row major. b receives x.
+    bool SolveLinearSystem(std::vector<double>& a, std::vector<double>& b, size_t n)
+    {
+        for (size_t column = 0; column < n; column++)
+        {
+            size_t pivot = column;
+            for (size_t row = column + 1; row < n; row++)
+            {
+                if (std::fabs(a[row * n + column]) > std::fabs(a[pivot * n + column]))
+                {
+                    pivot = row;
+                }
+            }
+            if (a[pivot * n + column] == 0.0)
+            {
+                return false;
+            }
+            if (pivot != column)
+            {
+                std::swap_ranges(a.begin() + pivot * n, a.begin() + (pivot + 1) * n, a.begin() + column * n);
+                std::swap(b[pivot], b[column]);
+            }
+            for (size_t row = column + 1; row < n; row++)
+            {
+                const double factor = a[row * n + column] / a[column * n + column];
+                for (size_t k = column; k < n; k++)
+                {
+                    a[row * n + k] -= factor * a[column * n + k];
+                }
+                b[row] -= factor * b[column];
+            }
+        }
+        for (size_t row = n; row-- > 0;)
+        {
+            double sum = b[row];
+            for (size_t k = row + 1; k < n; k++)
+            {
+                sum -= a[row * n + k] * b[k];
+            }
+            b[row] = sum / a[row * n + row];
+        }
+        return true;
+    }
+
+    // A mapped LUT pixel: its center and the direction of its ray
+    struct FitSample
+    {
+        double u;
+        double v;
+        double cosPhi;
+        double sinPhi;
+        double theta;
+    };
+
+    // Kannala-Brandt parameters while fitting: fx, fy, cx, cy, k1, k2, k3, k4
+    constexpr size_t kParamCount = 8;
+    using KannalaBrandtParams = double[kParamCount];
+
+    // Sum of the squared pixel errors of every step-th sample. When given, jtj and jtr receive the normal
+    // equations of the Gauss-Newton step.
+    double AccumulateErrors(const KannalaBrandtParams& params, const std::vector<FitSample>& samples, size_t step, double* pJtJ, double* pJtr)
+    {
+        if (pJtJ)
+        {
+            std::fill(pJtJ, pJtJ + kParamCount * kParamCount, 0.0);
+            std::fill(pJtr, pJtr + kParamCount, 0.0);
+        }
+
+        double cost = 0.0;
+        for (size_t i = 0; i < samples.size(); i += step)
+        {
+            const FitSample& s = samples[i];
+            const double t2 = s.theta * s.theta;
+            const double powers[4] = { s.theta * t2, s.theta * t2 * t2, s.theta * t2 * t2 * t2, s.theta * t2 * t2 * t2 * t2 };
+            const double d = s.theta + params[4] * powers[0] + params[5] * powers[1] + params[6] * powers[2] + params[7] * powers[3];
+
+            const double errors[2] = {
+                params[0] * d * s.cosPhi + params[2] - s.u,
+                params[1] * d * s.sinPhi + params[3] - s.v };
+            cost += errors[0] * errors[0] + errors[1] * errors[1];
+
+            if (pJtJ)
+            {
+                double jacobian[2][kParamCount] = {};
+                jacobian[0][0] = d * s.cosPhi;
+                jacobian[0][2] = 1.0;
+                jacobian[1][1] = d * s.sinPhi;
+                jacobian[1][3] = 1.0;
+                for (size_t k = 0; k < 4; k++)
+                {
+                    jacobian[0][4 + k] = params[0] * s.cosPhi * powers[k];
+                    jacobian[1][4 + k] = params[1] * s.sinPhi * powers[k];
+                }
+
+                for (size_t e = 0; e < 2; e++)
+                {
+                    for (size_t r = 0; r < kParamCount; r++)
+                    {
+                        pJtr[r] += jacobian[e][r] * errors[e];
+                        for (size_t c = 0; c < kParamCount; c++)
+                        {
+                            pJtJ[r * kParamCount + c] += jacobian[e][r] * jacobian[e][c];
+                        }
+                    }
+                }
+            }
+        }
+        return cost;
+    }
+
+    // Levenberg-Marquardt from an equidistant-like start: the principal point at the image center and a common
+    // focal length and radial terms from a linear fit.
+    void FitKannalaBrandt(const std::vector<FitSample>& samples, size_t step, uint32_t width, uint32_t height, KannalaBrandtParams& params)
+    {
+        const double cx = width / 2.0;
+        const double cy = height / 2.0;
+
+        // u - cx = cos(phi) (f theta + f k1 theta^3 + ... + f k4 theta^9), and the same in v with sin(phi)
+        std::vector<double> ata(5 * 5, 0.0);
+        std::vector<double> atb(5, 0.0);
+        for (size_t i = 0; i < samples.size(); i += step)
+        {
+            const FitSample& s = samples[i];
+            const double t2 = s.theta * s.theta;
+            double powers[5] = { s.theta };
+            for (size_t k = 1; k < 5; k++)
+            {
+                powers[k] = powers[k - 1] * t2;
+            }
+            const double rows[2][2] = { { s.cosPhi, s.u - cx }, { s.sinPhi, s.v - cy } };
+            for (const auto& row : rows)
+            {
+                for (size_t r = 0; r < 5; r++)
+                {
+                    atb[r] += row[0] * powers[r] * row[1];
+                    for (size_t c = 0; c < 5; c++)
+                    {
+                        ata[r * 5 + c] += row[0] * row[0] * powers[r] * powers[c];
+                    }
+                }
+            }
+        }
+
+        const double fallbackFocal = (std::max)(width, height) / kPi;
+        const bool initialized = SolveLinearSystem(ata, atb, 5) && atb[0] > 0.0;
+        const double focal = initialized ? atb[0] : fallbackFocal;
+        params[0] = focal;
+        params[1] = focal;
+        params[2] = cx;
+        params[3] = cy;
+        for (size_t k = 0; k < 4; k++)
+        {
+            params[4 + k] = initialized ? atb[1 + k] / focal : 0.0;
+        }
+
+        double lambda = 1e-3;
+        double cost = AccumulateErrors(params, samples, step, nullptr, nullptr);
+        std::vector<double> jtj(kParamCount * kParamCount);
+        std::vector<double> jtr(kParamCount);
+        for (int iteration = 0; iteration < kMaxFitIterations; iteration++)
+        {
+            AccumulateErrors(params, samples, step, jtj.data(), jtr.data());
+
+            bool improved = false;
+            double newCost = cost;
+            while (!improved && lambda < 1e10)
+            {
+                std::vector<double> a = jtj;
+                std::vector<double> delta(kParamCount);
+                for (size_t r = 0; r < kParamCount; r++)
+                {
+                    a[r * kParamCount + r] *= 1.0 + lambda;
+                    delta[r] = -jtr[r];
+                }
+
+                KannalaBrandtParams candidate;
+                if (SolveLinearSystem(a, delta, kParamCount))
+                {
+                    for (size_t r = 0; r < kParamCount; r++)
+                    {
+                        candidate[r] = params[r] + delta[r];
+                    }
+                    newCost = AccumulateErrors(candidate, samples, step, nullptr, nullptr);
+                    improved = newCost < cost;
+                }
+
+                if (improved)
+                {
+                    std::copy(candidate, candidate + kParamCount, params);
+                    lambda *= 0.1;
+                }
+                else
+                {
+                    lambda *= 10.0;
+                }
+            }
+
+            if (!improved)
+            {
+                break;
+            }
+            const bool converged = cost - newCost < 1e-12 * cost;
+            cost = newCost;
+            if (converged)
+            {
+                break;
+            }
+        }
+    }
+}
+
+FisheyeCameraModel FisheyeCameraModel::Fit(const float* pLut, uint32_t width, uint32_t height, FisheyeFitReport* pReport)
+{
+    FisheyeCameraModel model;
+    model.m_width = width;
+    model.m_height = height;
+
+    std::vector<FitSample> samples;
+    samples.reserve(size_t(width) * height);
+    std::vector<const float*> sampleRays;
+    sampleRays.reserve(size_t(width) * height);
+    double maxTheta = 0.0;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const float* pRay = pLut + 3 * (size_t(y) * width + x);
+            if (!(pRay[2] > 0.0f))
+            {
+                continue;
+            }
+
+            const double r = std::sqrt(double(pRay[0]) * pRay[0] + double(pRay[1]) * pRay[1]);
+            FitSample sample;
+            sample.u = x + 0.5;
+            sample.v = y + 0.5;
+            sample.cosPhi = r > 0.0 ? pRay[0] / r : 0.0;
+            sample.sinPhi = r > 0.0 ? pRay[1] / r : 0.0;
+            sample.theta = std::atan2(r, double(pRay[2]));
+            maxTheta = (std::max)(maxTheta, sample.theta);
+
+            samples.push_back(sample);
+            sampleRays.push_back(pRay);
+        }
+    }
+
+    if (samples.empty())
+    {
+        model.UpdateLimits();
+        model.m_fitReport = model.Evaluate(pLut);
+        if (pReport)
+        {
+            *pReport = model.m_fitReport;
+        }
+        return model;
+    }
+
+    KannalaBrandtParams params;
+    FitKannalaBrandt(samples, (std::max)(size_t(1), samples.size() / kMaxFitSamples), width, height, params);
+    model.m_fx = float(params[0]);
+    model.m_fy = float(params[1]);
+    model.m_cx = float(params[2]);
+    model.m_cy = float(params[3]);
+    for (size_t k = 0; k < 4; k++)
+    {
+        model.m_k[k] = float(params[4 + k]);
+    }
+    model.m_maxTheta = float(maxTheta) + kMaxThetaMargin;
+    model.UpdateLimits();
+
+    // Least squares fit of the grid to what the float polynomial leaves, on all the samples
+    const size_t n = kResidualGridSize;
+    const size_t nodeCount = n * n;
+    const PolynomialParams polynomial = {
+        model.m_fx, model.m_fy, model.m_cx, model.m_cy,
+        { model.m_k[0], model.m_k[1], model.m_k[2], model.m_k[3] },
+        model.m_maxTheta, model.m_maxDistortedRadius };
+    const double gridScaleX = double(n - 1) / width;
+    const double gridScaleY = double(n - 1) / height;
+
+    std::vector<double> ata(nodeCount * nodeCount, 0.0);
+    std::vector<double> atbU(nodeCount, 0.0);
+    std::vector<double> atbV(nodeCount, 0.0);
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        const float* pRay = sampleRays[i];
+        float u;
+        float v;
+        ProjectPolynomial<float>(polynomial, pRay[0], pRay[1], pRay[2], u, v);
+        if (std::isnan(u) || std::isnan(v))
+        {
+            continue;
+        }
+
+        const double gx = (std::min)((std::max)(u * gridScaleX, 0.0), double(n - 1));
+        const double gy = (std::min)((std::max)(v * gridScaleY, 0.0), double(n - 1));
+        const size_t i0 = (std::min)(size_t(gx), n - 2);
+        const size_t j0 = (std::min)(size_t(gy), n - 2);
+        const double fx = gx - i0;
+        const double fy = gy - j0;
+        const size_t nodes[4] = { j0 * n + i0, j0 * n + i0 + 1, (j0 + 1) * n + i0, (j0 + 1) * n + i0 + 1 };
+        const double weights[4] = { (1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy, fx * fy };
+
+        for (size_t r = 0; r < 4; r++)
+        {
+            atbU[nodes[r]] += weights[r] * (samples[i].u - u);
+            atbV[nodes[r]] += weights[r] * (samples[i].v - v);
+            for (size_t c = 0; c < 4; c++)
+            {
+                ata[nodes[r] * nodeCount + nodes[c]] += weights[r] * weights[c];
+            }
+        }
+    }
+
+    const double smoothness = kResidualSmoothness * double(samples.size()) / nodeCount;
+    auto addSmoothness = [&](size_t a, size_t b)
+    {
+        ata[a * nodeCount + a] += smoothness;
+        ata[b * nodeCount + b] += smoothness;
+        ata[a * nodeCount + b] -= smoothness;
+        ata[b * nodeCount + a] -= smoothness;
+    };
+    for (size_t j = 0; j < n; j++)
+    {
+        for (size_t i = 0; i + 1 < n; i++)
+        {
+            addSmoothness(j * n + i, j * n + i + 1);
+            addSmoothness(i * n + j, (i + 1) * n + j);
+        }
+    }
+
+    std::vector<double> ataCopy = ata;
+    if (SolveLinearSystem(ata, atbU, nodeCount) && SolveLinearSystem(ataCopy, atbV, nodeCount))
+    {
+        for (size_t node = 0; node < nodeCount; node++)
+        {
+            model.m_residuals[2 * node] = float(atbU[node]);
+            model.m_residuals[2 * node + 1] = float(atbV[node]);
+        }
+    }
+    model.QuantizeResiduals();
+
+    model.m_fitReport = model.Evaluate(pLut);
+    if (pReport)
+    {
+        *pReport = model.m_fitReport;
+    }
+    return model;
+}
+
+void FisheyeCameraModel::UpdateLimits()
+{
+    const PolynomialParams polynomial = { m_fx, m_fy, m_cx, m_cy, { m_k[0], m_k[1], m_k[2], m_k[3] }, m_maxTheta, 0.0f };
+    m_maxDistortedRadius = Distort(polynomial, m_maxTheta);
+}
+
+void FisheyeCameraModel::QuantizeResiduals()
+{
+    float maxResidual = 0.0f;
+    for (float residual : m_residuals)
+    {
+        maxResidual = (std::max)(maxResidual, std::fabs(residual));
+    }
+
+    m_residualScale = maxResidual / 32767.0f;
+    for (float& residual : m_residuals)
+    {
+        residual = m_residualScale > 0.0f ? std::round(residual / m_residualScale) * m_residualScale : 0.0f;
+    }
+}
+
+void FisheyeCameraModel::LookupResidual(float u, float v, float& du, float& dv) const
+{
+    const uint32_t n = kResidualGridSize;
+    const float gx = (std::min)((std::max)(u * float(n - 1) / m_width, 0.0f), float(n - 1));
+    const float gy = (std::min)((std::max)(v * float(n - 1) / m_height, 0.0f), float(n - 1));
+    const uint32_t i0 = (std::min)(uint32_t(gx), n - 2);
+    const uint32_t j0 = (std::min)(uint32_t(gy), n - 2);
+    const float fx = gx - i0;
+    const float fy = gy - j0;
+
+    const float* pTop = &m_residuals[2 * (j0 * n + i0)];
+    const float* pBottom = pTop + 2 * n;
+    float corrections[2];
+    for (int k = 0; k < 2; k++)
+    {
+        const float top = pTop[k] + fx * (pTop[2 + k] - pTop[k]);
+        const float bottom = pBottom[k] + fx * (pBottom[2 + k] - pBottom[k]);
+        corrections[k] = top + fy * (bottom - top);
+    }
+    du = corrections[0];
+    dv = corrections[1];
+}
+
+void FisheyeCameraModel::Project(const float* pRays, size_t count, float* pImagePoints) const
+{
+    const PolynomialParams polynomial = { m_fx, m_fy, m_cx, m_cy, { m_k[0], m_k[1], m_k[2], m_k[3] }, m_maxTheta, m_maxDistortedRadius };
+
+    auto finish = [this](float u, float v, float* pImagePoint)
+    {
+        if (!std::isnan(u))
+        {
+            float du;
+            float dv;
+            LookupResidual(u, v, du, dv);
+            u += du;
+            v += dv;
+        }
+        const bool inside = u >= 0.0f && v >= 0.0f && u <= m_width && v <= m_height;
+        pImagePoint[0] = inside ? u : kNaN;
+        pImagePoint[1] = inside ? v : kNaN;
+    };
+
+    size_t i = 0;
+#if defined(FISHEYE_CAMERA_MODEL_NEON) || defined(FISHEYE_CAMERA_MODEL_SSE2)
+    float x[4];
+    float y[4];
+    float z[4];
+    float u[4];
+    float v[4];
+    for (; i + 4 <= count; i += 4)
+    {
+        for (size_t k = 0; k < 4; k++)
+        {
+            x[k] = pRays[3 * (i + k)];
+            y[k] = pRays[3 * (i + k) + 1];
+            z[k] = pRays[3 * (i + k) + 2];
+        }
+
+        Float4 u4;
+        Float4 v4;
+        ProjectPolynomial<Float4>(polynomial, Load(x), Load(y), Load(z), u4, v4);
+        Store(u, u4);
+        Store(v, v4);
+
+        for (size_t k = 0; k < 4; k++)
+        {
+            finish(u[k], v[k], pImagePoints + 2 * (i + k));
+        }
+    }
+#endif
+    for (; i < count; i++)
+    {
+        float u;
+        float v;
+        ProjectPolynomial<float>(polynomial, pRays[3 * i], pRays[3 * i + 1], pRays[3 * i + 2], u, v);
+        finish(u, v, pImagePoints + 2 * i);
+    }
+}
+
+void FisheyeCameraModel::Unproject(const float* pImagePoints, size_t count, float* pRays) const
+{
+    const PolynomialParams polynomial = { m_fx, m_fy, m_cx, m_cy, { m_k[0], m_k[1], m_k[2], m_k[3] }, m_maxTheta, m_maxDistortedRadius };
+
+    // The point q the polynomial should give for q + R(q) = p, by fixed point iteration. The corrections vary
+    // slowly across the grid, so a few steps are enough. NaN outside the image.
+    auto removeResidual = [this](const float* pImagePoint, float& u, float& v)
+    {
+        u = pImagePoint[0];
+        v = pImagePoint[1];
+        if (!(u >= 0.0f && v >= 0.0f && u <= m_width && v <= m_height))
+        {
+            u = kNaN;
+            v = kNaN;
+            return;
+        }
+
+        float qu = u;
+        float qv = v;
+        for (int step = 0; step < kResidualInversionSteps; step++)
+        {
+            float du;
+            float dv;
+            LookupResidual(qu, qv, du, dv);
+            qu = u - du;
+            qv = v - dv;
+        }
+        u = qu;
+        v = qv;
+    };
+
+    size_t i = 0;
+#if defined(FISHEYE_CAMERA_MODEL_NEON) || defined(FISHEYE_CAMERA_MODEL_SSE2)
+    float u[4];
+    float v[4];
+    float x[4];
+    float y[4];
+    float z[4];
+    for (; i + 4 <= count; i += 4)
+    {
+        for (size_t k = 0; k < 4; k++)
+        {
+            removeResidual(pImagePoints + 2 * (i + k), u[k], v[k]);
+        }
+
+        Float4 x4;
+        Float4 y4;
+        Float4 z4;
+        UnprojectPolynomial<Float4>(polynomial, Load(u), Load(v), x4, y4, z4);
+        Store(x, x4);
+        Store(y, y4);
+        Store(z, z4);
+
+        for (size_t k = 0; k < 4; k++)
+        {
+            pRays[3 * (i + k)] = x[k];
+            pRays[3 * (i + k) + 1] = y[k];
+            pRays[3 * (i + k) + 2] = z[k];
+        }
+    }
+#endif
+    for (; i < count; i++)
+    {
+        float u;
+        float v;
+        removeResidual(pImagePoints + 2 * i, u, v);
+        UnprojectPolynomial<float>(polynomial, u, v, pRays[3 * i], pRays[3 * i + 1], pRays[3 * i + 2]);
+    }
+}
+
+FisheyeFitReport FisheyeCameraModel::Evaluate(const float* pLut) const
+{
+    FisheyeFitReport report;
+    std::vector<float> centers(2 * size_t(m_width));
+    std::vector<float> projected(2 * size_t(m_width));
+    std::vector<float> rays(3 * size_t(m_width));
+    double sumSquaredError = 0.0;
+    size_t errorCount = 0;
+    double maxRayError = 0.0;
+
+    for (uint32_t y = 0; y < m_height; y++)
+    {
+        const float* pLutRow = pLut + 3 * size_t(y) * m_width;
+        for (uint32_t x = 0; x < m_width; x++)
+        {
+            centers[2 * x] = x + 0.5f;
+            centers[2 * x + 1] = y + 0.5f;
+        }
+        Project(pLutRow, m_width, projected.data());
+        Unproject(centers.data(), m_width, rays.data());
+
+        for (uint32_t x = 0; x < m_width; x++)
+        {
+            const float* pLutRay = pLutRow + 3 * x;
+            if (!(pLutRay[2] > 0.0f))
+            {
+                continue;
+            }
+            report.sampleCount++;
+
+            const float* pRay = &rays[3 * x];
+            if (std::isnan(projected[2 * x]) || pRay[2] == 0.0f)
+            {
+                report.unmappedCount++;
+                continue;
+            }
+
+            const double du = projected[2 * x] - centers[2 * x];
+            const double dv = projected[2 * x + 1] - centers[2 * x + 1];
+            const double squaredError = du * du + dv * dv;
+            sumSquaredError += squaredError;
+            errorCount++;
+            report.maxPixelError = (std::max)(report.maxPixelError, float(std::sqrt(squaredError)));
+
+            // atan2 of the cross and dot products keeps its precision at small angles, unlike acos
+            const double cross[3] = {
+                double(pRay[1]) * pLutRay[2] - double(pRay[2]) * pLutRay[1],
+                double(pRay[2]) * pLutRay[0] - double(pRay[0]) * pLutRay[2],
+                double(pRay[0]) * pLutRay[1] - double(pRay[1]) * pLutRay[0] };
+            const double dot = double(pRay[0]) * pLutRay[0] + double(pRay[1]) * pLutRay[1] + double(pRay[2]) * pLutRay[2];
+            const double angle = std::atan2(std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]), dot);
+            maxRayError = (std::max)(maxRayError, angle);
+        }
+    }
+
+    report.rmsPixelError = errorCount > 0 ? float(std::sqrt(sumSquaredError / errorCount)) : 0.0f;
+    report.maxRayErrorDegrees = float(maxRayError * 180.0 / 3.14159265358979323846);
+    return report;
+}
+
+std::vector<float> FisheyeCameraModel::CreateLut() const
+{
+    std::vector<float> centers(2 * size_t(m_width) * m_height);
+    for (uint32_t y = 0; y < m_height; y++)
+    {
+        for (uint32_t x = 0; x < m_width; x++)
+        {
+            centers[2 * (size_t(y) * m_width + x)] = x + 0.5f;
+            centers[2 * (size_t(y) * m_width + x) + 1] = y + 0.5f;
+        }
+    }
+
+    std::vector<float> lut(3 * size_t(m_width) * m_height);
+    Unproject(centers.data(), size_t(m_width) * m_height, lut.data());
+    return lut;
+}
+
+// Little endian, packed:
+//   0  char[8]  "HLCAMMDL"
+//   8  uint32   version
+//  12  uint16   width, height
+//  16  uint32   grid size n
+//  20  float[8] fx, fy, cx, cy, k1, k2, k3, k4
+//  52  float    max theta (radians)
+//  56  float    residual scale (pixels per unit)
+//  60  float[3] max pixel error, RMS pixel error, max ray error (degrees)
+//  72  int16[n * n * 2] residuals (du, dv), row by row
+std::vector<uint8_t> FisheyeCameraModel::Serialize() const
+{
+    std::vector<uint8_t> data(kSerializedSize);
+    uint8_t* p = data.data();
+    auto put = [&p](const auto& value)
+    {
+        std::memcpy(p, &value, sizeof(value));
+        p += sizeof(value);
+    };
+
+    put(kFileMagic);
+    put(kFileVersion);
+    put(uint16_t(m_width));
+    put(uint16_t(m_height));
+    put(kResidualGridSize);
+    put(m_fx);
+    put(m_fy);
+    put(m_cx);
+    put(m_cy);
+    put(m_k);
+    put(m_maxTheta);
+    put(m_residualScale);
+    put(m_fitReport.maxPixelError);
+    put(m_fitReport.rmsPixelError);
+    put(m_fitReport.maxRayErrorDegrees);
+    for (float residual : m_residuals)
+    {
+        put(int16_t(m_residualScale > 0.0f ? std::lround(residual / m_residualScale) : 0));
+    }
+
+    assert(p == data.data() + data.size());
+    return data;
+}
+
+bool FisheyeCameraModel::Deserialize(const uint8_t* pData, size_t size)
+{
+    if (size != kSerializedSize || std::memcmp(pData, kFileMagic, sizeof(kFileMagic)) != 0)
+    {
+        return false;
+    }
+
+    const uint8_t* p = pData + sizeof(kFileMagic);
+    auto get = [&p](auto& value)
+    {
+        std::memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+    };
+
+    uint32_t version;
+    uint32_t gridSize;
+    uint16_t width;
+    uint16_t height;
+    get(version);
+    get(width);
+    get(height);
+    get(gridSize);
+    if (version != kFileVersion || gridSize != kResidualGridSize)
+    {
+        return false;
+    }
+
+    FisheyeCameraModel model;
+    model.m_width = width;
+    model.m_height = height;
+    get(model.m_fx);
+    get(model.m_fy);
+    get(model.m_cx);
+    get(model.m_cy);
+    get(model.m_k);
+    get(model.m_maxTheta);
+    get(model.m_residualScale);
+    get(model.m_fitReport.maxPixelError);
+    get(model.m_fitReport.rmsPixelError);
+    get(model.m_fitReport.maxRayErrorDegrees);
+    for (float& residual : model.m_residuals)
+    {
+        int16_t quantized;
+        get(quantized);
+        residual = quantized * model.m_residualScale;
+    }
+    model.UpdateLimits();
+
+    *this = model;
+    return true;
+}
@@ -0,0 +1,104 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A compact stand-in for the per pixel unprojection LUT RMCameraReader::DumpCalibration writes: a Kannala-Brandt
+// fisheye model (focal lengths, principal point and four radial terms) plus a coarse grid of pixel corrections
+// for what the polynomial can't follow. It is fitted to the LUT at the end of a capture and serialized in a few
+// hundred bytes, next to the LUT. Kept free of Research Mode and WinRT types so it also runs in the off device
+// tools (CameraModelBenchmark).
+//
+// Rays are in the camera frame of the extrinsics, x right, y down and z forward, like the LUT. Pixel (0, 0) is
+// the corner of the image, so the center of the first pixel is (0.5, 0.5).
+//
+// The batch functions work on 4 points at a time with NEON on ARM64 and SSE2 on x64. The grid corrections are
+// lookups, which neither instruction set can gather, so they stay scalar. Define FISHEYE_CAMERA_MODEL_NO_SIMD to
+// use the scalar code everywhere.
+
+struct FisheyeFitReport
+{
+    size_t sampleCount = 0;         // LUT pixels the sensor could map
+    size_t unmappedCount = 0;       // Of those, pixels the model refuses to project or unproject
+    float maxPixelError = 0.0f;     // Projection of the LUT rays against the pixel centers
+    float rmsPixelError = 0.0f;
+    float maxRayErrorDegrees = 0.0f;// Unprojection of the pixel centers against the LUT rays
+};
+
+class FisheyeCameraModel
+{
+public:
+    static constexpr uint32_t kResidualGridSize = 8;
+    static constexpr uint32_t kFileVersion = 1;
+    static constexpr size_t kSerializedSize = 72 + kResidualGridSize * kResidualGridSize * 2 * sizeof(int16_t);
+
+    // pLut holds width x height unit rays (x, y, z) through the pixel centers, row by row, as in the _lut.bin files.
+    // Rays with z <= 0 are the pixels the sensor couldn't map and are left out. pReport, when given, receives the
+    // errors of the fitted model as serialized, over all the mapped pixels.
+    static FisheyeCameraModel Fit(const float* pLut, uint32_t width, uint32_t height, FisheyeFitReport* pReport = nullptr);
+
+    // count rays (x, y, z) to image points (u, v); they need not be normalized. Rays outside the field of view
+    // the model was fitted on, or landing outside the image, give (NaN, NaN).
+    void Project(const float* pRays, size_t count, float* pImagePoints) const;
+
+    // count image points (u, v) to unit rays (x, y, z). Points outside the image or outside the field of view give
+    // (0, 0, 0), like the pixels the sensor couldn't map in the LUT.
+    void Unproject(const float* pImagePoints, size_t count, float* pRays) const;
+
+    // Errors against a LUT of this model's size, see Fit
+    FisheyeFitReport Evaluate(const float* pLut) const;
+
+    // The whole width x height LUT, in the _lut.bin layout
+    std::vector<float> CreateLut() const;
+
+    std::vector<uint8_t> Serialize() const;
+
+    // False, and the model unchanged, when the data isn't a model of this version
+    bool Deserialize(const uint8_t* pData, size_t size);
+
+    uint32_t GetWidth() const { return m_width; }
+    uint32_t GetHeight() const { return m_height; }
+
+    // The errors stored at Fit time; Deserialize restores them too
+    const FisheyeFitReport& GetFitReport() const { return m_fitReport; }
+
+private:
+    void UpdateLimits();
+    void QuantizeResiduals();
+
+    // Bilinear interpolation of the grid at an image point, clamped to the image
+    void LookupResidual(float u, float v, float& du, float& dv) const;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+
+    // u = fx * d(theta) * x / r + cx, v = fy * d(theta) * y / r + cy, d(theta) = theta (1 + k1 theta^2 + ... + k4 theta^8)
+    float m_fx = 1.0f;
+    float m_fy = 1.0f;
+    float m_cx = 0.0f;
+    float m_cy = 0.0f;
+    float m_k[4] = {};
+
+    // Largest angle from the optical axis of the mapped pixels, and its distorted radius on the normalized plane
+    float m_maxTheta = 0.0f;
+    float m_maxDistortedRadius = 0.0f;
+
+    // Pixel corrections (du, dv) added after the polynomial, at kResidualGridSize x kResidualGridSize nodes
+    // spread evenly from the image corner (0, 0) to (width, height). Multiples of m_residualScale, as serialized.
+    float m_residualScale = 0.0f;
+    float m_residuals[kResidualGridSize * kResidualGridSize * 2] = {};
+
+    FisheyeFitReport m_fitReport;
+};
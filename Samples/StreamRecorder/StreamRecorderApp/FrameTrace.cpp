@@ -0,0 +1,251 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "FrameTrace.h"
+
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace FrameTrace
+{
+    std::atomic<bool> g_enabled{ false };
+
+    namespace
+    {
+        constexpr size_t kEventsPerThread = 1 << 16;  // 2 MB, about 10 minutes of a camera's write thread
+
+        enum class EventType : uint32_t
+        {
+            Zone,
+            Counter
+        };
+
+        struct TraceEvent
+        {
+            const char* name;
+            EventType type;
+            int64_t startNs;
+            union
+            {
+                int64_t durationNs;
+                double value;
+            };
+        };
+
+        // Written by its thread only. The dump reads the first count events, published with release.
+        struct ThreadBuffer
+        {
+            uint32_t threadIndex = 0;
+            std::string name;                   // Written under g_registryMutex
+            std::unique_ptr<TraceEvent[]> events;
+            std::atomic<size_t> count{ 0 };
+            std::atomic<uint64_t> session{ 0 };
+            std::atomic<uint64_t> droppedCount{ 0 };
+        };
+
+        std::mutex g_registryMutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> g_threadBuffers;     // Kept after their thread exits
+        std::atomic<uint64_t> g_session{ 1 };
+        std::atomic<int64_t> g_sessionStart{ 0 };
+
+        ThreadBuffer& GetThreadBuffer()
+        {
+            thread_local ThreadBuffer* pBuffer = nullptr;
+            if (!pBuffer)
+            {
+                std::lock_guard<std::mutex> guard(g_registryMutex);
+                g_threadBuffers.push_back(std::make_unique<ThreadBuffer>());
+                pBuffer = g_threadBuffers.back().get();
+                pBuffer->threadIndex = static_cast<uint32_t>(g_threadBuffers.size());
+            }
+            return *pBuffer;
+        }
+
+        void Record(const TraceEvent& event)
+        {
+            ThreadBuffer& buffer = GetThreadBuffer();
+            if (!buffer.events)
+            {
+                buffer.events.reset(new TraceEvent[kEventsPerThread]);
+            }
+
+            // The first event of a session drops the previous session's events
+            const uint64_t session = g_session.load(std::memory_order_acquire);
+            if (buffer.session.load(std::memory_order_relaxed) != session)
+            {
+                buffer.count.store(0, std::memory_order_relaxed);
+                buffer.droppedCount.store(0, std::memory_order_relaxed);
+                buffer.session.store(session, std::memory_order_release);
+            }
+
+            const size_t count = buffer.count.load(std::memory_order_relaxed);
+            if (count == kEventsPerThread)
+            {
+                buffer.droppedCount.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            buffer.events[count] = event;
+            buffer.count.store(count + 1, std::memory_order_release);
+        }
+
+        void WriteJsonString(std::ostream& out, const char* text)
+        {
+            out << '"';
+            for (const char* p = text; *p; ++p)
+            {
+                if (*p == '"' || *p == '\\')
+                {
+                    out << '\\';
+                }
+                out << *p;
+            }
+            out << '"';
+        }
+    }
+
+    void SetEnabled(bool enabled)
+    {
+        g_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void StartSession()
+    {
+        g_sessionStart.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+        g_session.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    void SetThreadName(const std::string& name)
+    {
+        ThreadBuffer& buffer = GetThreadBuffer();
+        if (buffer.name != name)
+        {
+            std::lock_guard<std::mutex> guard(g_registryMutex);
+            buffer.name = name;
+        }
+    }
+
+    int64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() -
+            g_sessionStart.load(std::memory_order_relaxed);
+    }
+
+    void RecordZone(const char* name, int64_t startNs, int64_t endNs)
+    {
+        TraceEvent event;
+        event.name = name;
+        event.type = EventType::Zone;
+        event.startNs = startNs;
+        event.durationNs = endNs - startNs;
+        Record(event);
+    }
+
+    void RecordCounter(const char* name, double value)
+    {
+        TraceEvent event;
+        event.name = name;
+        event.type = EventType::Counter;
+        event.startNs = Now();
+        event.value = value;
+        Record(event);
+    }
+
+    uint64_t GetEventCount()
+    {
+        const uint64_t session = g_session.load(std::memory_order_acquire);
+        std::lock_guard<std::mutex> guard(g_registryMutex);
+        uint64_t eventCount = 0;
+        for (const auto& buffer : g_threadBuffers)
+        {
+            if (buffer->session.load(std::memory_order_acquire) == session)
+            {
+                eventCount += buffer->count.load(std::memory_order_acquire);
+            }
+        }
+        return eventCount;
+    }
+
+    uint64_t GetDroppedEventCount()
+    {
+        const uint64_t session = g_session.load(std::memory_order_acquire);
+        std::lock_guard<std::mutex> guard(g_registryMutex);
+        uint64_t droppedCount = 0;
+        for (const auto& buffer : g_threadBuffers)
+        {
+            if (buffer->session.load(std::memory_order_acquire) == session)
+            {
+                droppedCount += buffer->droppedCount.load(std::memory_order_relaxed);
+            }
+        }
+        return droppedCount;
+    }
+
+    bool WriteChromeTrace(const std::filesystem::path& path)
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            return false;
+        }
+
+        const uint64_t session = g_session.load(std::memory_order_acquire);
+        uint64_t droppedCount = 0;
+        bool first = true;
+        auto separator = [&]() -> std::ostream& { file << (first ? "\n" : ",\n"); first = false; return file; };
+
+        file << std::fixed << std::setprecision(3);   // Microseconds, so nanosecond resolution
+        file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+        {
+            // Threads may still add events while this runs, only the ones published so far are written
+            std::lock_guard<std::mutex> guard(g_registryMutex);
+            for (const auto& buffer : g_threadBuffers)
+            {
+                if (buffer->session.load(std::memory_order_acquire) != session)
+                {
+                    continue;
+                }
+
+                if (!buffer->name.empty())
+                {
+                    separator() << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->threadIndex << ", \"args\": {\"name\": ";
+                    WriteJsonString(file, buffer->name.c_str());
+                    file << "}}";
+                }
+
+                const size_t count = buffer->count.load(std::memory_order_acquire);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const TraceEvent& event = buffer->events[i];
+                    separator() << "{\"name\": ";
+                    WriteJsonString(file, event.name);
+                    if (event.type == EventType::Zone)
+                    {
+                        file << ", \"ph\": \"X\", \"ts\": " << event.startNs / 1000.0 << ", \"dur\": " << event.durationNs / 1000.0;
+                    }
+                    else
+                    {
+                        file << ", \"ph\": \"C\", \"ts\": " << event.startNs / 1000.0 << ", \"args\": {\"value\": " << event.value << "}";
+                    }
+                    file << ", \"pid\": 1, \"tid\": " << buffer->threadIndex << "}";
+                }
+                droppedCount += buffer->droppedCount.load(std::memory_order_relaxed);
+            }
+        }
+        file << "\n], \"otherData\": {\"droppedEvents\": " << droppedCount << "}}\n";
+
+        file.close();
+        return !file.fail();
+    }
+}
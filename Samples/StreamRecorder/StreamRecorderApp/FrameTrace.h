@@ -0,0 +1,92 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Timeline of where the recorder's threads spend their time, written as Chrome trace JSON
+// (open in chrome://tracing or ui.perfetto.dev).
+//
+// Every thread records into its own fixed size buffer, so recording an event takes no lock and never allocates
+// after the thread's first event. When tracing is disabled a zone or counter costs one relaxed atomic load.
+//
+// Event and counter names are kept as pointers until the trace is written: pass string literals, or strings that
+// outlive the session.
+namespace FrameTrace
+{
+    extern std::atomic<bool> g_enabled;
+
+    inline bool IsEnabled()
+    {
+        return g_enabled.load(std::memory_order_relaxed);
+    }
+
+    void SetEnabled(bool enabled);
+
+    // Forgets the events of the previous session, timestamps are relative to this call
+    void StartSession();
+
+    // Shows up as the thread's name in the trace, cheap to call again with the same name
+    void SetThreadName(const std::string& name);
+
+    int64_t Now();  // Nanoseconds since StartSession
+    void RecordZone(const char* name, int64_t startNs, int64_t endNs);
+    void RecordCounter(const char* name, double value);
+
+    inline void Counter(const char* name, double value)
+    {
+        if (IsEnabled())
+        {
+            RecordCounter(name, value);
+        }
+    }
+
+    // Times its scope
+    class Zone
+    {
+    public:
+        explicit Zone(const char* name) :
+            m_name(IsEnabled() ? name : nullptr),
+            m_startNs(m_name ? Now() : 0)
+        {
+        }
+
+        ~Zone()
+        {
+            if (m_name)
+            {
+                RecordZone(m_name, m_startNs, Now());
+            }
+        }
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        const char* m_name;
+        int64_t m_startNs;
+    };
+
+    // Events recorded in this session, and events lost to full thread buffers
+    uint64_t GetEventCount();
+    uint64_t GetDroppedEventCount();
+
+    bool WriteChromeTrace(const std::filesystem::path& path);
+}
+
+#define FRAME_TRACE_CONCAT_(a, b) a##b
+#define FRAME_TRACE_CONCAT(a, b) FRAME_TRACE_CONCAT_(a, b)
+#define FRAME_TRACE_ZONE(name) FrameTrace::Zone FRAME_TRACE_CONCAT(frameTraceZone, __LINE__)(name)
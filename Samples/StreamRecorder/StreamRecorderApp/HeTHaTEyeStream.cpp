@@ -10,38 +10,220 @@
 //*********************************************************
 
 #include "HeTHaTEyeStream.h"
+#include "RecorderLogWriters.h"
 
 #include <winrt/Windows.Storage.h>
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iomanip>
 
 using namespace DirectX;
 using namespace winrt::Windows::Storage;
 
+CompactPose PackPose(FXMVECTOR position, FXMVECTOR orientation)
+{
+    CompactPose pose;
+    XMStoreFloat3(&pose.position, position);
+    XMStoreFloat4(&pose.orientation, orientation);
+    return pose;
+}
+
+CompactPose PackPose(FXMMATRIX transform)
+{
+    return PackPose(transform.r[3], XMQuaternionNormalize(XMQuaternionRotationMatrix(transform)));
+}
+
+XMMATRIX UnpackPose(const CompactPose& pose)
+{
+    return XMMatrixAffineTransformation(XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f), XMVectorZero(),
+        XMLoadFloat4(&pose.orientation), XMLoadFloat3(&pose.position));
+}
+
+static int16_t QuantizeSnorm16(float value)
+{
+    return (int16_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+static float DequantizeSnorm16(int16_t value)
+{
+    return value / 32767.0f;
+}
+
+// Positions further than 32767 steps from the origin are clamped
+static int16_t QuantizePosition(float value, float origin, float metersPerUnit)
+{
+    return (int16_t)std::clamp(std::lround((value - origin) / metersPerUnit), -32767l, 32767l);
+}
+
+static float DequantizePosition(int16_t value, float origin, float metersPerUnit)
+{
+    return origin + value * metersPerUnit;
+}
+
+QuantizedPose QuantizePose(const CompactPose& pose, const PoseQuantization& quantization)
+{
+    // q and -q are the same rotation, keeping w >= 0 leaves the full SNORM16 range to the other components
+    const float sign = (pose.orientation.w < 0.0f) ? -1.0f : 1.0f;
+
+    QuantizedPose quantizedPose;
+    quantizedPose.position[0] = QuantizePosition(pose.position.x, quantization.origin.x, quantization.metersPerUnit);
+    quantizedPose.position[1] = QuantizePosition(pose.position.y, quantization.origin.y, quantization.metersPerUnit);
+    quantizedPose.position[2] = QuantizePosition(pose.position.z, quantization.origin.z, quantization.metersPerUnit);
+    quantizedPose.orientation[0] = QuantizeSnorm16(sign * pose.orientation.x);
+    quantizedPose.orientation[1] = QuantizeSnorm16(sign * pose.orientation.y);
+    quantizedPose.orientation[2] = QuantizeSnorm16(sign * pose.orientation.z);
+    quantizedPose.orientation[3] = QuantizeSnorm16(sign * pose.orientation.w);
+    return quantizedPose;
+}
+
+CompactPose DequantizePose(const QuantizedPose& quantizedPose, const PoseQuantization& quantization)
+{
+    const XMVECTOR position = XMVectorSet(
+        DequantizePosition(quantizedPose.position[0], quantization.origin.x, quantization.metersPerUnit),
+        DequantizePosition(quantizedPose.position[1], quantization.origin.y, quantization.metersPerUnit),
+        DequantizePosition(quantizedPose.position[2], quantization.origin.z, quantization.metersPerUnit),
+        1.0f);
+    const XMVECTOR orientation = XMVectorSet(
+        DequantizeSnorm16(quantizedPose.orientation[0]),
+        DequantizeSnorm16(quantizedPose.orientation[1]),
+        DequantizeSnorm16(quantizedPose.orientation[2]),
+        DequantizeSnorm16(quantizedPose.orientation[3]));
+    return PackPose(position, XMQuaternionNormalize(orientation));
+}
+
 HeTHaTEyeStream::HeTHaTEyeStream()
 {
     // reserve for 10 seconds at 60fps
     m_hethateyeLog.reserve(10 * 60); 
 }
 
-void HeTHaTEyeStream::AddFrame(HeTHaTEyeFrame&& frame)
+void HeTHaTEyeStream::SetQuantized(bool quantized, float metersPerUnit)
+{
+    Clear();
+    m_quantized = quantized;
+    m_quantization.metersPerUnit = metersPerUnit;
+
+    // Only one of the logs is ever used
+    if (m_quantized)
+    {
+        m_quantizedLog.reserve(10 * 60);
+        std::vector<HeTHaTEyeFrame>().swap(m_hethateyeLog);
+    }
+    else
+    {
+        m_hethateyeLog.reserve(10 * 60);
+        std::vector<QuantizedHeTHaTEyeFrame>().swap(m_quantizedLog);
+    }
+}
+
+bool HeTHaTEyeStream::IsQuantized() const
 {
-    m_hethateyeLog.push_back(std::move(frame));
+    return m_quantized;
+}
+
+void HeTHaTEyeStream::AddFrame(const HeTHaTEyeFrame& frame)
+{
+    if (!m_quantized)
+    {
+        m_hethateyeLog.push_back(frame);
+        return;
+    }
+
+    if (m_quantizedLog.empty())
+    {
+        m_quantization.origin = frame.head.position;
+    }
+
+    QuantizedHeTHaTEyeFrame quantizedFrame;
+    quantizedFrame.timestamp = frame.timestamp;
+    quantizedFrame.eyeGazeDistance = frame.eyeGazeDistance;
+    quantizedFrame.presence = frame.presence;
+    quantizedFrame.head = QuantizePose(frame.head, m_quantization);
+    for (size_t j = 0; j < (size_t)HandJointIndex::Count; ++j)
+    {
+        quantizedFrame.leftHand[j] = QuantizePose(frame.leftHand[j], m_quantization);
+        quantizedFrame.rightHand[j] = QuantizePose(frame.rightHand[j], m_quantization);
+    }
+    quantizedFrame.eyeGazeOrigin[0] = QuantizePosition(frame.eyeGazeOrigin.x, m_quantization.origin.x, m_quantization.metersPerUnit);
+    quantizedFrame.eyeGazeOrigin[1] = QuantizePosition(frame.eyeGazeOrigin.y, m_quantization.origin.y, m_quantization.metersPerUnit);
+    quantizedFrame.eyeGazeOrigin[2] = QuantizePosition(frame.eyeGazeOrigin.z, m_quantization.origin.z, m_quantization.metersPerUnit);
+    quantizedFrame.eyeGazeDirection[0] = QuantizeSnorm16(frame.eyeGazeDirection.x);
+    quantizedFrame.eyeGazeDirection[1] = QuantizeSnorm16(frame.eyeGazeDirection.y);
+    quantizedFrame.eyeGazeDirection[2] = QuantizeSnorm16(frame.eyeGazeDirection.z);
+    m_quantizedLog.push_back(quantizedFrame);
 }
 
 void HeTHaTEyeStream::Clear()
 {
     m_hethateyeLog.clear();
+    m_quantizedLog.clear();
 }
 
 size_t HeTHaTEyeStream::FrameCount() const
 {
-    return m_hethateyeLog.size();
+    return m_quantized ? m_quantizedLog.size() : m_hethateyeLog.size();
 }
 
-const std::vector<HeTHaTEyeFrame>& HeTHaTEyeStream::Log() const
+HeTHaTEyeFrame HeTHaTEyeStream::GetFrame(size_t index) const
 {
-    return m_hethateyeLog;
+    if (!m_quantized)
+    {
+        return m_hethateyeLog[index];
+    }
+
+    const QuantizedHeTHaTEyeFrame& quantizedFrame = m_quantizedLog[index];
+
+    HeTHaTEyeFrame frame;
+    frame.timestamp = quantizedFrame.timestamp;
+    frame.eyeGazeDistance = quantizedFrame.eyeGazeDistance;
+    frame.presence = quantizedFrame.presence;
+    frame.head = DequantizePose(quantizedFrame.head, m_quantization);
+    for (size_t j = 0; j < (size_t)HandJointIndex::Count; ++j)
+    {
+        frame.leftHand[j] = DequantizePose(quantizedFrame.leftHand[j], m_quantization);
+        frame.rightHand[j] = DequantizePose(quantizedFrame.rightHand[j], m_quantization);
+    }
+    frame.eyeGazeOrigin.x = DequantizePosition(quantizedFrame.eyeGazeOrigin[0], m_quantization.origin.x, m_quantization.metersPerUnit);
+    frame.eyeGazeOrigin.y = DequantizePosition(quantizedFrame.eyeGazeOrigin[1], m_quantization.origin.y, m_quantization.metersPerUnit);
+    frame.eyeGazeOrigin.z = DequantizePosition(quantizedFrame.eyeGazeOrigin[2], m_quantization.origin.z, m_quantization.metersPerUnit);
+    frame.eyeGazeDirection.x = DequantizeSnorm16(quantizedFrame.eyeGazeDirection[0]);
+    frame.eyeGazeDirection.y = DequantizeSnorm16(quantizedFrame.eyeGazeDirection[1]);
+    frame.eyeGazeDirection.z = DequantizeSnorm16(quantizedFrame.eyeGazeDirection[2]);
+    return frame;
+}
+
+bool HeTHaTEyeStream::DumpToDisk(const StorageFolder& folder, const std::wstring& datetime_path) const
+{
+    auto path = folder.Path().data();
+    std::wstring fullName(path);
+    fullName += +L"\\" + datetime_path + L"_head_hand_eye.bin";
+    std::ofstream file(fullName, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    RecorderLog::WriteHeadHandEyeHeader(file, kFileVersion, m_quantized, (uint32_t)HandJointIndex::Count,
+        m_quantization.origin, m_quantization.metersPerUnit);
+
+    if (m_quantized)
+    {
+        for (const QuantizedHeTHaTEyeFrame& frame : m_quantizedLog)
+        {
+            RecorderLog::WriteHeadHandEyeFrame(file, frame);
+        }
+    }
+    else
+    {
+        for (const HeTHaTEyeFrame& frame : m_hethateyeLog)
+        {
+            RecorderLog::WriteHeadHandEyeFrame(file, frame);
+        }
+    }
+
+    file.close();
+    return !file.fail();
 }
 
 std::ostream& operator<<(std::ostream& out, const XMMATRIX& m)
@@ -72,13 +254,13 @@ std::ostream& operator<<(std::ostream& out, const XMVECTOR& v)
     return out;
 }
 
-void DumpHandIfPresentElseZero(bool present, const XMMATRIX& handTransform, std::ostream& out)
+void DumpHandIfPresentElseZero(bool present, const CompactPose& pose, std::ostream& out)
 {
     static const float zeros[16] = { 0.0 };
     static const XMMATRIX zero4x4(zeros);
     if (present)
     {
-        out << handTransform;
+        out << UnpackPose(pose);
     }
     else
     {
@@ -86,14 +268,14 @@ void DumpHandIfPresentElseZero(bool present, const XMMATRIX& handTransform, std:
     }
 }
 
-void DumpEyeGazeIfPresentElseZero(bool present, const XMVECTOR& origin, const XMVECTOR& direction, float distance, std::ostream& out)
+void DumpEyeGazeIfPresentElseZero(bool present, const XMFLOAT3& origin, const XMFLOAT3& direction, float distance, std::ostream& out)
 {
     XMFLOAT4 zeros{ 0, 0, 0, 0 };
     XMVECTOR zero4 = XMLoadFloat4(&zeros);
     out << present << ",";
     if (present)
     {
-        out << origin << "," << direction;
+        out << XMVectorSetW(XMLoadFloat3(&origin), 1.0f) << "," << XMLoadFloat3(&direction);
     }
     else
     {
@@ -102,7 +284,7 @@ void DumpEyeGazeIfPresentElseZero(bool present, const XMVECTOR& origin, const XM
     out << "," << distance;
 }
 
-bool HeTHaTEyeStream::DumpToDisk(const StorageFolder& folder, const std::wstring& datetime_path) const
+bool HeTHaTEyeStream::DumpCsvToDisk(const StorageFolder& folder, const std::wstring& datetime_path) const
 {  
     auto path = folder.Path().data();
     std::wstring fullName(path);
@@ -113,26 +295,30 @@ bool HeTHaTEyeStream::DumpToDisk(const StorageFolder& folder, const std::wstring
         return false;
     }
 
-    for (const HeTHaTEyeFrame& frame : m_hethateyeLog)
+    for (size_t i_frame = 0; i_frame < FrameCount(); ++i_frame)
     {
+        const HeTHaTEyeFrame frame = GetFrame(i_frame);
+        const bool leftHandPresent = frame.IsPresent(LeftHandPresent);
+        const bool rightHandPresent = frame.IsPresent(RightHandPresent);
+
         file << frame.timestamp << ",";
-        file << frame.headTransform;
+        file << UnpackPose(frame.head);
         file << ",";
-        file << frame.leftHandPresent;
+        file << leftHandPresent;
         for (int j = 0; j < (int)HandJointIndex::Count; ++j)
         {
             file << ",";
-            DumpHandIfPresentElseZero(frame.leftHandPresent, frame.leftHandTransform[j], file);
+            DumpHandIfPresentElseZero(leftHandPresent, frame.leftHand[j], file);
         }
         file << ",";
-        file << frame.rightHandPresent;
+        file << rightHandPresent;
         for (int j = 0; j < (int)HandJointIndex::Count; ++j)
         {
             file << ",";
-            DumpHandIfPresentElseZero(frame.rightHandPresent, frame.rightHandTransform[j], file);
+            DumpHandIfPresentElseZero(rightHandPresent, frame.rightHand[j], file);
         }
         file << ",";
-        DumpEyeGazeIfPresentElseZero(frame.eyeGazePresent, frame.eyeGazeOrigin, frame.eyeGazeDirection, frame.eyeGazeDistance, file);
+        DumpEyeGazeIfPresentElseZero(frame.IsPresent(EyeGazePresent), frame.eyeGazeOrigin, frame.eyeGazeDirection, frame.eyeGazeDistance, file);
         file << std::endl;
     }
     file.close();
@@ -173,20 +359,20 @@ void HeTHaTStreamVisualizer::Update(const HeTHaTEyeStream& stream)
     const XMMATRIX scale = XMMatrixScaling(0.03f, 0.03f, 0.03f);
     for (int i_frame = 0; i_frame < stream.FrameCount(); i_frame += kStride)
     {
-        const HeTHaTEyeFrame& frame = stream.Log()[i_frame];
+        const HeTHaTEyeFrame frame = stream.GetFrame(i_frame);
 
         auto drawCallLeft = std::make_shared<DrawCall>("Lit_VS.cso", "Lit_PS.cso", Mesh::MT_PLANE);
-        drawCallLeft->SetWorldTransform(scale * frame.leftHandTransform[(int)HandJointIndex::Palm]);
+        drawCallLeft->SetWorldTransform(scale * UnpackPose(frame.leftHand[(int)HandJointIndex::Palm]));
         drawCallLeft->SetColor(XMVectorSet(1.0f, 0.0f, 0.0f, 1.0f));
         m_drawCalls.push_back(drawCallLeft);
 
         auto drawCallRight = std::make_shared<DrawCall>("Lit_VS.cso", "Lit_PS.cso", Mesh::MT_PLANE);
-        drawCallRight->SetWorldTransform(scale * frame.rightHandTransform[(int)HandJointIndex::Palm]);
+        drawCallRight->SetWorldTransform(scale * UnpackPose(frame.rightHand[(int)HandJointIndex::Palm]));
         drawCallRight->SetColor(XMVectorSet(0.0f, 1.0f, 0.0f, 1.0f));
         m_drawCalls.push_back(drawCallRight);
 
         auto drawCallHead = std::make_shared<DrawCall>("Lit_VS.cso", "Lit_PS.cso", Mesh::MT_UIPLANE);
-        drawCallHead->SetWorldTransform(scale * frame.headTransform);
+        drawCallHead->SetWorldTransform(scale * UnpackPose(frame.head));
         drawCallHead->SetColor(XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f));
         m_drawCalls.push_back(drawCallHead);
     }
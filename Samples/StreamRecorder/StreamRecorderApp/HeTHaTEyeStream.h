@@ -11,40 +11,108 @@
 
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include "../Cannon/DrawCall.h"
 #include "../Cannon/MixedReality.h"
 
-__declspec(align(16))
+// Rigid transform as position + unit quaternion, 28 bytes instead of a 64 byte XMMATRIX
+struct CompactPose
+{
+    DirectX::XMFLOAT3 position;
+    DirectX::XMFLOAT4 orientation;
+};
+
+CompactPose PackPose(DirectX::FXMVECTOR position, DirectX::FXMVECTOR orientation);
+CompactPose PackPose(DirectX::FXMMATRIX transform);     // transform must be rotation + translation only
+DirectX::XMMATRIX UnpackPose(const CompactPose& pose);  // Same matrix TrackedHands::GetOrientedJoint builds from the pose
+
+// 16-bit CompactPose, 14 bytes. Positions are steps of metersPerUnit from a per-session origin,
+// quaternion components are SNORM16 with w kept non-negative.
+struct QuantizedPose
+{
+    int16_t position[3];
+    int16_t orientation[4];
+};
+
+struct PoseQuantization
+{
+    DirectX::XMFLOAT3 origin{ 0.0f, 0.0f, 0.0f };
+    float metersPerUnit = 1.0f / 2048.0f;   // Just under half a millimeter, covers 16m around the origin
+};
+
+QuantizedPose QuantizePose(const CompactPose& pose, const PoseQuantization& quantization);
+CompactPose DequantizePose(const QuantizedPose& pose, const PoseQuantization& quantization);
+
+enum HeTHaTEyePresence : uint8_t
+{
+    LeftHandPresent = 1 << 0,
+    RightHandPresent = 1 << 1,
+    EyeGazePresent = 1 << 2
+};
+
 struct HeTHaTEyeFrame
 {
-    DirectX::XMMATRIX headTransform;
-    std::array<DirectX::XMMATRIX, (size_t)HandJointIndex::Count> leftHandTransform;
-    std::array<DirectX::XMMATRIX, (size_t)HandJointIndex::Count> rightHandTransform;
-    DirectX::XMVECTOR eyeGazeOrigin;
-    DirectX::XMVECTOR eyeGazeDirection;
-    float eyeGazeDistance;
-    bool leftHandPresent;
-    bool rightHandPresent;
-    bool eyeGazePresent;
+    long long timestamp = 0;
+    CompactPose head;
+    std::array<CompactPose, (size_t)HandJointIndex::Count> leftHand;
+    std::array<CompactPose, (size_t)HandJointIndex::Count> rightHand;
+    DirectX::XMFLOAT3 eyeGazeOrigin{ 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT3 eyeGazeDirection{ 0.0f, 0.0f, 0.0f };
+    float eyeGazeDistance = 0.0f;
+    uint8_t presence = 0;   // HeTHaTEyePresence flags
+
+    bool IsPresent(HeTHaTEyePresence flag) const { return (presence & flag) != 0; }
+};
+
+// What the stream keeps in memory when quantization is on, about a fifth of the old matrix based frame
+struct QuantizedHeTHaTEyeFrame
+{
     long long timestamp;
+    float eyeGazeDistance;
+    QuantizedPose head;
+    std::array<QuantizedPose, (size_t)HandJointIndex::Count> leftHand;
+    std::array<QuantizedPose, (size_t)HandJointIndex::Count> rightHand;
+    int16_t eyeGazeOrigin[3];       // Quantized like pose positions
+    int16_t eyeGazeDirection[3];    // SNORM16
+    uint8_t presence;
 };
 
+// Head, hand joint and eye gaze log of a recording.
+//
+// DumpToDisk writes <datetime>_head_hand_eye.bin (little endian):
+//   header: char[8] "HLHNDEYE", uint32 version, uint32 flags (1: quantized), uint32 jointsPerHand,
+//           float[3] quantization origin, float quantization metersPerUnit
+//   frames: int64 timestamp, uint32 presence flags, then the head, left hand joints and right hand joints as
+//           position + quaternion (x, y, z, w), float[7] each or int16[7] each when quantized,
+//           then eye gaze origin and direction as float[3] each or int16[3] each, and float eyeGazeDistance.
+// Poses are stored whether or not the hand is present, check the presence flags.
 class HeTHaTEyeStream
 {
 public:
+    static constexpr uint32_t kFileVersion = 1;
+
     HeTHaTEyeStream();
 
-    void AddFrame(HeTHaTEyeFrame&& frame);
+    // Also clears the log. The quantization origin is the head position of the first frame added afterwards.
+    void SetQuantized(bool quantized, float metersPerUnit = PoseQuantization().metersPerUnit);
+    bool IsQuantized() const;
+
+    void AddFrame(const HeTHaTEyeFrame& frame);
     void Clear();
-    const std::vector<HeTHaTEyeFrame>& Log() const;
+    HeTHaTEyeFrame GetFrame(size_t index) const;    // Dequantized if needed
     size_t FrameCount() const;
     bool DumpToDisk(const winrt::Windows::Storage::StorageFolder& folder, const std::wstring& datetime_path) const;
+    // Previous text format with a 4x4 matrix per pose, about 12x larger than the binary file
+    bool DumpCsvToDisk(const winrt::Windows::Storage::StorageFolder& folder, const std::wstring& datetime_path) const;
     bool DumpTransformToDisk(const DirectX::XMMATRIX& mtx, const winrt::Windows::Storage::StorageFolder& folder,
                              const std::wstring& datetime_path, const std::wstring& suffix) const;
 
 private:
+    bool m_quantized = false;
+    PoseQuantization m_quantization;
     std::vector<HeTHaTEyeFrame> m_hethateyeLog;
+    std::vector<QuantizedHeTHaTEyeFrame> m_quantizedLog;
 };
 
 class HeTHaTStreamVisualizer
@@ -0,0 +1,316 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "ImuSampleStream.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr char kFileMagic[8] = { 'H', 'L', 'I', 'M', 'U', 'S', 'M', 'P' };
+    constexpr std::streamoff kDroppedCountOffset = 16;
+    constexpr size_t kBatchCapacity = 256;
+    constexpr auto kWritePeriod = std::chrono::milliseconds(10);
+
+    template<typename T>
+    void WriteValue(std::ofstream& file, const T& value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+}
+
+const char* GetImuSensorName(ImuSensorKind kind)
+{
+    switch (kind)
+    {
+    case ImuSensorKind::Accelerometer:
+        return "imu_accel";
+    case ImuSensorKind::Gyroscope:
+        return "imu_gyro";
+    case ImuSensorKind::Magnetometer:
+        return "imu_mag";
+    }
+    return "imu";
+}
+
+ImuSampleRing::ImuSampleRing(size_t capacity)
+{
+    size_t roundedCapacity = 1;
+    while (roundedCapacity < capacity)
+    {
+        roundedCapacity <<= 1;
+    }
+    m_samples.resize(roundedCapacity);
+    m_mask = roundedCapacity - 1;
+}
+
+size_t ImuSampleRing::Push(const ImuSample* pSamples, size_t count)
+{
+    const size_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+    const size_t readIndex = m_readIndex.load(std::memory_order_acquire);
+    const size_t pushCount = std::min(count, m_samples.size() - (writeIndex - readIndex));
+
+    // At most two contiguous copies, before and after the wrap
+    const size_t start = writeIndex & m_mask;
+    const size_t firstCount = std::min(pushCount, m_samples.size() - start);
+    std::copy(pSamples, pSamples + firstCount, m_samples.begin() + start);
+    std::copy(pSamples + firstCount, pSamples + pushCount, m_samples.begin());
+
+    m_writeIndex.store(writeIndex + pushCount, std::memory_order_release);
+    return pushCount;
+}
+
+size_t ImuSampleRing::Pop(ImuSample* pSamples, size_t maxCount)
+{
+    const size_t readIndex = m_readIndex.load(std::memory_order_relaxed);
+    const size_t writeIndex = m_writeIndex.load(std::memory_order_acquire);
+    const size_t popCount = std::min(maxCount, writeIndex - readIndex);
+
+    const size_t start = readIndex & m_mask;
+    const size_t firstCount = std::min(popCount, m_samples.size() - start);
+    std::copy(m_samples.begin() + start, m_samples.begin() + start + firstCount, pSamples);
+    std::copy(m_samples.begin(), m_samples.begin() + (popCount - firstCount), pSamples + firstCount);
+
+    m_readIndex.store(readIndex + popCount, std::memory_order_release);
+    return popCount;
+}
+
+size_t ImuSampleRing::Size() const
+{
+    return m_writeIndex.load(std::memory_order_acquire) - m_readIndex.load(std::memory_order_acquire);
+}
+
+SyntheticImuSource::SyntheticImuSource(ImuSensorKind kind, double sampleRate, size_t samplesPerBatch, bool realTime, uint64_t sampleLimit) :
+    m_kind(kind),
+    m_sampleRate(sampleRate),
+    m_samplesPerBatch(std::max<size_t>(samplesPerBatch, 1)),
+    m_realTime(realTime),
+    m_sampleLimit(sampleLimit)
+{
+}
+
+bool SyntheticImuSource::Open()
+{
+    m_nextSample = 0;
+    m_startTime = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(m_interruptMutex);
+    return !m_interrupted;
+}
+
+bool SyntheticImuSource::ReadBatch(ImuSample* pSamples, size_t capacity, size_t& count)
+{
+    count = 0;
+    if (m_sampleLimit != 0 && m_nextSample >= m_sampleLimit)
+    {
+        return false;
+    }
+
+    uint64_t batchEnd = m_nextSample + std::min(capacity, m_samplesPerBatch);
+    if (m_sampleLimit != 0)
+    {
+        batchEnd = std::min(batchEnd, m_sampleLimit);
+    }
+
+    // The device hands out a batch once its last sample has been measured
+    const auto batchTime = m_startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(batchEnd / m_sampleRate));
+    {
+        std::unique_lock<std::mutex> lock(m_interruptMutex);
+        if (m_realTime)
+        {
+            m_interruptCondition.wait_until(lock, batchTime, [this]() { return m_interrupted; });
+        }
+        if (m_interrupted)
+        {
+            return false;
+        }
+    }
+
+    for (; m_nextSample < batchEnd; ++m_nextSample)
+    {
+        pSamples[count++] = GetSample(m_nextSample);
+    }
+    return true;
+}
+
+void SyntheticImuSource::Interrupt()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_interruptMutex);
+        m_interrupted = true;
+    }
+    m_interruptCondition.notify_all();
+}
+
+ImuSample SyntheticImuSource::GetSample(uint64_t sampleIndex) const
+{
+    const double seconds = sampleIndex / m_sampleRate;
+    const float phase = static_cast<float>(seconds * 2.0 * 3.14159265358979);
+
+    ImuSample sample = {};
+    sample.socTicks = static_cast<uint64_t>(seconds * 1e7 + 0.5);
+    sample.vinylHupTicks = static_cast<uint64_t>(seconds * 1e9 + 0.5);
+    switch (m_kind)
+    {
+    case ImuSensorKind::Accelerometer:
+        sample.values[0] = 0.2f * std::sin(phase);
+        sample.values[1] = -9.81f;
+        sample.values[2] = 0.2f * std::cos(phase);
+        sample.temperature = 30.0f;
+        break;
+    case ImuSensorKind::Gyroscope:
+        sample.values[0] = 0.0f;
+        sample.values[1] = 0.5f;
+        sample.values[2] = 0.1f * std::sin(phase);
+        sample.temperature = 30.0f;
+        break;
+    case ImuSensorKind::Magnetometer:
+        sample.values[0] = 20.0f;
+        sample.values[1] = -40.0f;
+        sample.values[2] = 5.0f;
+        break;
+    }
+    return sample;
+}
+
+ImuStreamRecorder::ImuStreamRecorder(std::unique_ptr<ImuSampleSource> source, ImuSensorKind kind, size_t ringCapacity) :
+    m_source(std::move(source)),
+    m_kind(kind),
+    m_ring(ringCapacity),
+    m_readBatch(kBatchCapacity),
+    m_writeBatch(kBatchCapacity),
+    m_fileBatch(kBatchCapacity)
+{
+    m_readThread = std::thread(ReadThread, this);
+    m_writeThread = std::thread(WriteThread, this);
+}
+
+ImuStreamRecorder::~ImuStreamRecorder()
+{
+    StopRecording();
+
+    // The read thread may be blocked in the source, waiting for consent or for the next batch
+    m_fExit = true;
+    m_source->Interrupt();
+    m_readThread.join();
+    m_writeThread.join();
+}
+
+bool ImuStreamRecorder::StartRecording(const std::filesystem::path& path, const ClockDomain& clockDomain)
+{
+    std::lock_guard<std::mutex> guard(m_fileMutex);
+
+    if (m_file.is_open())
+    {
+        return false;
+    }
+
+    m_file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_file)
+    {
+        return false;
+    }
+
+    m_file.write(kFileMagic, sizeof(kFileMagic));
+    WriteValue(m_file, kFileVersion);
+    WriteValue(m_file, static_cast<uint32_t>(m_kind));
+    WriteValue(m_file, uint64_t(0));   // Dropped sample count, patched in StopRecording
+    m_clockDomain = &clockDomain;
+
+    // Left over from after the last drain of the previous recording
+    while (m_ring.Pop(m_writeBatch.data(), m_writeBatch.size()) > 0)
+    {
+    }
+
+    m_writtenSampleCount = 0;
+    m_droppedSampleCount = 0;
+    m_recording = true;
+    return true;
+}
+
+void ImuStreamRecorder::StopRecording()
+{
+    m_recording = false;
+
+    std::lock_guard<std::mutex> guard(m_fileMutex);
+    if (!m_file.is_open())
+    {
+        return;
+    }
+
+    // A batch the read thread pushes after this drain stays in the ring until the next StartRecording discards it
+    DrainRing();
+
+    const uint64_t droppedSampleCount = m_droppedSampleCount;
+    m_file.seekp(kDroppedCountOffset);
+    WriteValue(m_file, droppedSampleCount);
+    m_file.close();
+    m_clockDomain = nullptr;
+}
+
+void ImuStreamRecorder::DrainRing()
+{
+    size_t count;
+    while ((count = m_ring.Pop(m_writeBatch.data(), m_writeBatch.size())) > 0)
+    {
+        // One snapshot per batch, the mapping only changes once a second
+        const ClockSnapshot snapshot = m_clockDomain->GetSnapshot();
+        for (size_t i = 0; i < count; ++i)
+        {
+            m_fileBatch[i].sample = m_writeBatch[i];
+            m_fileBatch[i].timestamp = ClockDomain::Convert(snapshot, HundredsOfNanoseconds(static_cast<int64_t>(m_writeBatch[i].socTicks))).count();
+        }
+        m_file.write(reinterpret_cast<const char*>(m_fileBatch.data()), count * sizeof(ImuFileSample));
+        m_writtenSampleCount += count;
+    }
+}
+
+void ImuStreamRecorder::ReadThread(ImuStreamRecorder* pRecorder)
+{
+    if (!pRecorder->m_source->Open())
+    {
+        return;
+    }
+    pRecorder->m_sourceRunning = true;
+
+    size_t count = 0;
+    while (!pRecorder->m_fExit && pRecorder->m_source->ReadBatch(pRecorder->m_readBatch.data(), pRecorder->m_readBatch.size(), count))
+    {
+        if (pRecorder->m_recording && count > 0)
+        {
+            const size_t pushed = pRecorder->m_ring.Push(pRecorder->m_readBatch.data(), count);
+            if (pushed < count)
+            {
+                pRecorder->m_droppedSampleCount += count - pushed;
+            }
+        }
+    }
+
+    pRecorder->m_sourceRunning = false;
+    pRecorder->m_source->Close();
+}
+
+void ImuStreamRecorder::WriteThread(ImuStreamRecorder* pRecorder)
+{
+    while (!pRecorder->m_fExit)
+    {
+        {
+            std::lock_guard<std::mutex> guard(pRecorder->m_fileMutex);
+            if (pRecorder->m_file.is_open())
+            {
+                pRecorder->DrainRing();
+            }
+        }
+        std::this_thread::sleep_for(kWritePeriod);
+    }
+}
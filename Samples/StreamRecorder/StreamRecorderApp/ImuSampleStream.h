@@ -0,0 +1,177 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "ClockDomain.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Accelerometer, gyroscope and magnetometer recording. Only depends on the standard library and ClockDomain; the
+// Research Mode sensors plug in through ImuSampleSource (see RMImuReader.h) and SyntheticImuSource stands in for
+// them off device.
+//
+// File layout (little endian), version 2:
+//   header:  char[8] "HLIMUSMP", uint32 version, uint32 sensor (ImuSensorKind), uint64 droppedSampleCount
+//   samples: uint64 vinylHupTicks, uint64 socTicks, float[3] values, float temperature (0 for the magnetometer),
+//            int64 timestamp
+//
+// socTicks are on the QPC based 100 ns clock of the camera HostTicks. timestamp is socTicks converted through the
+// clock domain when the sample is written, so it follows the drift of the clocks like the camera frame names and
+// rig2world files. Version 1 files had one int64 socTicksToAbsoluteTicks after the sensor instead, and no timestamp.
+
+enum class ImuSensorKind : uint32_t
+{
+    Accelerometer = 0,  // m/s^2
+    Gyroscope = 1,      // rad/s
+    Magnetometer = 2
+};
+
+// File name stem of each sensor's recording, e.g. imu_accel.bin
+const char* GetImuSensorName(ImuSensorKind kind);
+
+struct ImuSample
+{
+    uint64_t vinylHupTicks;
+    uint64_t socTicks;
+    float values[3];
+    float temperature;
+};
+static_assert(sizeof(ImuSample) == 32, "ImuSample is written to disk as is");
+
+struct ImuFileSample
+{
+    ImuSample sample;
+    int64_t timestamp;  // Absolute 100 ns ticks
+};
+static_assert(sizeof(ImuFileSample) == 40, "ImuFileSample is written to disk as is");
+
+// Produces batches of samples. Open, ReadBatch and Close are all called from the recorder's read thread.
+class ImuSampleSource
+{
+public:
+    virtual ~ImuSampleSource() = default;
+
+    virtual bool Open() = 0;
+    // Blocks until samples are available and copies up to capacity of them. Returns false when the source is done.
+    virtual bool ReadBatch(ImuSample* pSamples, size_t capacity, size_t& count) = 0;
+    virtual void Close() = 0;
+    // Called from another thread when the recorder is destroyed. A pending or later Open or ReadBatch must return false soon.
+    virtual void Interrupt() = 0;
+};
+
+// Single producer / single consumer ring of preallocated samples. Push never blocks or allocates;
+// samples that don't fit are dropped and reported to the caller.
+class ImuSampleRing
+{
+public:
+    explicit ImuSampleRing(size_t capacity);    // Rounded up to a power of two
+
+    size_t Push(const ImuSample* pSamples, size_t count);   // Producer thread only, returns how many were stored
+    size_t Pop(ImuSample* pSamples, size_t maxCount);       // Consumer thread only
+    size_t Size() const;
+    size_t Capacity() const { return m_samples.size(); }
+
+private:
+    std::vector<ImuSample> m_samples;
+    size_t m_mask;
+    std::atomic<size_t> m_writeIndex{ 0 };  // Free running, only wraps through the mask
+    std::atomic<size_t> m_readIndex{ 0 };
+};
+
+// Deterministic samples at a fixed rate: gravity plus a slow sway for the accelerometer, a slow rotation for the
+// gyroscope and a constant field for the magnetometer. Sample i can be recomputed with GetSample(i).
+class SyntheticImuSource : public ImuSampleSource
+{
+public:
+    // realTime paces batches to the sample rate, otherwise batches come as fast as they're read.
+    // sampleLimit stops the source after that many samples, 0 runs until the recorder is destroyed.
+    SyntheticImuSource(ImuSensorKind kind, double sampleRate = 1000.0, size_t samplesPerBatch = 32, bool realTime = true, uint64_t sampleLimit = 0);
+
+    bool Open() override;
+    bool ReadBatch(ImuSample* pSamples, size_t capacity, size_t& count) override;
+    void Close() override {}
+    void Interrupt() override;
+
+    ImuSample GetSample(uint64_t sampleIndex) const;
+
+private:
+    const ImuSensorKind m_kind;
+    const double m_sampleRate;
+    const size_t m_samplesPerBatch;
+    const bool m_realTime;
+    const uint64_t m_sampleLimit;
+
+    uint64_t m_nextSample = 0;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    std::mutex m_interruptMutex;
+    std::condition_variable m_interruptCondition;
+    bool m_interrupted = false;
+};
+
+// Drains a source on its own thread into a ring buffer while recording, and writes the ring to disk on another.
+// The source is read even when not recording so the sensor never backs up.
+class ImuStreamRecorder
+{
+public:
+    static constexpr uint32_t kFileVersion = 2;
+    static constexpr size_t kDefaultRingCapacity = 1 << 14;  // About 16 s at 1 kHz before the writer falls behind
+
+    ImuStreamRecorder(std::unique_ptr<ImuSampleSource> source, ImuSensorKind kind, size_t ringCapacity = kDefaultRingCapacity);
+    ~ImuStreamRecorder();
+
+    // Samples are timestamped with clockDomain, which must outlive the recording
+    bool StartRecording(const std::filesystem::path& path, const ClockDomain& clockDomain);
+    void StopRecording();
+
+    ImuSensorKind GetKind() const { return m_kind; }
+    bool IsSourceRunning() const { return m_sourceRunning; }
+    uint64_t GetWrittenSampleCount() const { return m_writtenSampleCount; }
+    uint64_t GetDroppedSampleCount() const { return m_droppedSampleCount; }
+
+private:
+    static void ReadThread(ImuStreamRecorder* pRecorder);
+    static void WriteThread(ImuStreamRecorder* pRecorder);
+
+    void DrainRing();   // Expects m_fileMutex to be held
+
+    std::unique_ptr<ImuSampleSource> m_source;
+    const ImuSensorKind m_kind;
+    ImuSampleRing m_ring;
+
+    // Preallocated so neither thread allocates per batch
+    std::vector<ImuSample> m_readBatch;
+    std::vector<ImuSample> m_writeBatch;
+    std::vector<ImuFileSample> m_fileBatch;
+
+    std::atomic<bool> m_recording{ false };
+    std::atomic<bool> m_sourceRunning{ false };
+    std::atomic<bool> m_fExit{ false };
+    std::atomic<uint64_t> m_writtenSampleCount{ 0 };
+    std::atomic<uint64_t> m_droppedSampleCount{ 0 };
+
+    std::mutex m_fileMutex;     // Guards m_file, m_clockDomain and the consumer side of m_ring
+    std::ofstream m_file;
+    const ClockDomain* m_clockDomain = nullptr;
+
+    std::thread m_readThread;
+    std::thread m_writeThread;
+};
@@ -10,7 +10,10 @@
 //*********************************************************
 
 #include "RMCameraReader.h"
-#include <sstream>
+#include "FisheyeCameraModel.h"
+#include "FrameTrace.h"
+#include "RMFrameEncoder.h"
+#include "RecorderLogWriters.h"
 
 using namespace winrt::Windows::Perception;
 using namespace winrt::Windows::Perception::Spatial;
@@ -18,15 +21,6 @@ using namespace winrt::Windows::Foundation::Numerics;
 using namespace winrt::Windows::Storage;
 
 
-namespace Depth
-{
-    enum InvalidationMasks
-    {
-        Invalid = 0x80,
-    };
-    static constexpr UINT16 AHAT_INVALID_VALUE = 4090;
-}
-
 void RMCameraReader::CameraUpdateThread(RMCameraReader* pCameraReader, HANDLE camConsentGiven, ResearchModeSensorConsent* camAccessConsent)
 {
 	HRESULT hr = S_OK;
@@ -77,21 +71,41 @@ void RMCameraReader::CameraUpdateThread(RMCameraReader* pCameraReader, HANDLE ca
             pCameraReader->m_pRMSensor = nullptr;
         }
 
+        FrameTrace::SetThreadName(pCameraReader->m_sensorName + " update");
+
         while (!pCameraReader->m_fExit && pCameraReader->m_pRMSensor)
         {
             HRESULT hr = S_OK;
             IResearchModeSensorFrame* pSensorFrame = nullptr;
 
-            hr = pCameraReader->m_pRMSensor->GetNextBuffer(&pSensorFrame);
+            {
+                FRAME_TRACE_ZONE("GetNextBuffer");
+                hr = pCameraReader->m_pRMSensor->GetNextBuffer(&pSensorFrame);
+            }
 
             if (SUCCEEDED(hr))
             {
-                std::lock_guard<std::mutex> guard(pCameraReader->m_sensorFrameMutex);
+                std::unique_lock<std::mutex> guard(pCameraReader->m_sensorFrameMutex, std::defer_lock);
+                {
+                    FRAME_TRACE_ZONE("Wait m_sensorFrameMutex");
+                    guard.lock();
+                }
                 if (pCameraReader->m_pSensorFrame)
                 {
+                    if (!pCameraReader->m_sensorFrameSaved)
+                    {
+                        FrameTrace::Counter(pCameraReader->m_unsavedFramesCounterName.c_str(), ++pCameraReader->m_unsavedFrameCount);
+                    }
                     pCameraReader->m_pSensorFrame->Release();
                 }
                 pCameraReader->m_pSensorFrame = pSensorFrame;
+                pCameraReader->m_sensorFrameSaved = false;
+            }
+
+            // A save still waiting in the stream will pick this frame up
+            if (SUCCEEDED(hr) && pCameraReader->m_recording && !pCameraReader->m_saveQueued.exchange(true))
+            {
+                pCameraReader->m_writerStream->Post([pCameraReader]() { pCameraReader->SaveLatestFrame(); });
             }
         }
 
@@ -102,25 +116,34 @@ void RMCameraReader::CameraUpdateThread(RMCameraReader* pCameraReader, HANDLE ca
     }
 }
 
-void RMCameraReader::CameraWriteThread(RMCameraReader* pReader)
+void RMCameraReader::SaveLatestFrame()
 {
-    while (!pReader->m_fExit)
+    FRAME_TRACE_ZONE(m_sensorName.c_str());
+    // Cleared first, so a frame arriving during the save queues the next one
+    m_saveQueued = false;
+
+    std::lock_guard<std::mutex> storage_guard(m_storageMutex);
+    if (m_storageFolder == nullptr)
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> reader_guard(m_sensorFrameMutex, std::defer_lock);
+    {
+        FRAME_TRACE_ZONE("Wait m_sensorFrameMutex");
+        reader_guard.lock();
+    }
+    if (m_pSensorFrame && IsNewTimestamp(m_pSensorFrame))
     {
-        std::unique_lock<std::mutex> storage_lock(pReader->m_storageMutex);
-        if (pReader->m_storageFolder == nullptr)
+        FRAME_TRACE_ZONE("SaveFrame");
+        SaveFrame(m_pSensorFrame);
+        m_sensorFrameSaved = true;
+        if (m_unsavedFrameCount > 0)
         {
-            pReader->m_storageCondVar.wait(storage_lock);
+            m_unsavedFrameCount = 0;
+            FrameTrace::Counter(m_unsavedFramesCounterName.c_str(), 0);
         }
-        
-        std::lock_guard<std::mutex> reader_guard(pReader->m_sensorFrameMutex);
-        if (pReader->m_pSensorFrame)
-        {
-            if (pReader->IsNewTimestamp(pReader->m_pSensorFrame))
-            {
-                pReader->SaveFrame(pReader->m_pSensorFrame);
-            }
-        }       
-    }	
+    }
 }
 
 void RMCameraReader::DumpCalibration()
@@ -155,9 +178,44 @@ void RMCameraReader::DumpCalibration()
     
     fileExtrinsics.close();
 
-    wchar_t outputPath[MAX_PATH] = {};    
-    swprintf_s(outputPath, L"%s\\%s_lut.bin", m_storageFolder.Path().data(), m_pRMSensor->GetFriendlyName());
-    
+    // The LUT takes seconds to compute and megabytes to store, and only changes with the calibration of the device
+    const std::wstring sensorName = m_pRMSensor->GetFriendlyName();
+    const std::string fingerprint = ComputeCalibrationFingerprint(pCameraSensor, resolution, cameraViewMatrix);
+    CalibrationEntry calibration;
+    if (!m_calibrationCache.Lookup(sensorName, fingerprint, calibration))
+    {
+        const std::vector<float> lutTable = ComputeLut(pCameraSensor, resolution);
+        // The fisheye model fitted to the LUT, a few hundred bytes consumers can use instead of it
+        const std::vector<uint8_t> cameraModel = FisheyeCameraModel::Fit(lutTable.data(), resolution.Width, resolution.Height).Serialize();
+        calibration = m_calibrationCache.Store(sensorName, fingerprint, resolution.Width, resolution.Height, lutTable, cameraModel);
+    }
+    pCameraSensor->Release();
+
+    m_calibrationCache.WriteReference(sensorName, calibration, m_storageFolder.Path().c_str());
+}
+
+std::string RMCameraReader::ComputeCalibrationFingerprint(IResearchModeCameraSensor* pCameraSensor, const ResearchModeSensorResolution& resolution, const DirectX::XMFLOAT4X4& extrinsics)
+{
+    // Resolution, extrinsics and the unit plane points of a 9x9 grid of pixels, failures included
+    const int kProbeCount = 9;
+    std::vector<float> probe = { float(resolution.Width), float(resolution.Height) };
+    probe.insert(probe.end(), &extrinsics.m[0][0], &extrinsics.m[0][0] + 16);
+    for (int j = 0; j < kProbeCount; j++)
+    {
+        for (int i = 0; i < kProbeCount; i++)
+        {
+            float uv[2] = { (i + 0.5f) * resolution.Width / kProbeCount, (j + 0.5f) * resolution.Height / kProbeCount };
+            float xy[2] = {};
+            const HRESULT hr = pCameraSensor->MapImagePointToCameraUnitPlane(uv, xy);
+            probe.push_back(SUCCEEDED(hr) ? xy[0] : NAN);
+            probe.push_back(SUCCEEDED(hr) ? xy[1] : NAN);
+        }
+    }
+    return CalibrationCache::HashHex(probe.data(), probe.size() * sizeof(float));
+}
+
+std::vector<float> RMCameraReader::ComputeLut(IResearchModeCameraSensor* pCameraSensor, const ResearchModeSensorResolution& resolution)
+{
     float uv[2];
     float xy[2];
     std::vector<float> lutTable(size_t(resolution.Width * resolution.Height) * 3);
@@ -169,7 +227,7 @@ void RMCameraReader::DumpCalibration()
         for (size_t x = 0; x < resolution.Width; x++)
         {
             uv[0] = (x + 0.5f);
-            hr = pCameraSensor->MapImagePointToCameraUnitPlane(uv, xy);
+            HRESULT hr = pCameraSensor->MapImagePointToCameraUnitPlane(uv, xy);
             if (FAILED(hr))
             {
 				*pLutTable++ = xy[0];
@@ -189,13 +247,8 @@ void RMCameraReader::DumpCalibration()
             *pLutTable++ = xy[1];
             *pLutTable++ = z;
         }
-    }    
-    pCameraSensor->Release();
-
-    // Save binary LUT to disk
-    std::ofstream file(outputPath, std::ios::out | std::ios::binary);
-	file.write(reinterpret_cast<char*> (lutTable.data()), lutTable.size() * sizeof(float));
-    file.close();
+    }
+    return lutTable;
 }
 
 void RMCameraReader::DumpFrameLocations()
@@ -206,11 +259,7 @@ void RMCameraReader::DumpFrameLocations()
     std::ofstream file(outputPath);
     for (const FrameLocation& location : m_frameLocations)
     {
-        file << location.timestamp << "," <<
-            location.rigToWorldtransform.m11 << "," << location.rigToWorldtransform.m21 << "," << location.rigToWorldtransform.m31 << "," << location.rigToWorldtransform.m41 << "," <<
-            location.rigToWorldtransform.m12 << "," << location.rigToWorldtransform.m22 << "," << location.rigToWorldtransform.m32 << "," << location.rigToWorldtransform.m42 << "," <<
-            location.rigToWorldtransform.m13 << "," << location.rigToWorldtransform.m23 << "," << location.rigToWorldtransform.m33 << "," << location.rigToWorldtransform.m43 << "," <<
-            location.rigToWorldtransform.m14 << "," << location.rigToWorldtransform.m24 << "," << location.rigToWorldtransform.m34 << "," << location.rigToWorldtransform.m44 << std::endl;
+        RecorderLog::WriteRig2WorldLine(file, location.timestamp, location.rigToWorldtransform);
     }
     file.close();
 
@@ -244,13 +293,21 @@ void RMCameraReader::SetStorageFolder(const StorageFolder& storageFolder)
     wchar_t fileName[MAX_PATH] = {};    
     swprintf_s(fileName, L"%s\\%s.tar", m_storageFolder.Path().data(), m_pRMSensor->GetFriendlyName());
     m_tarball.reset(new Io::Tarball(fileName));
-    m_storageCondVar.notify_all();
+    m_recording = true;
 }
 
 void RMCameraReader::ResetStorageFolder()
 {
     std::lock_guard<std::mutex> storage_guard(m_storageMutex);
+    m_recording = false;
     DumpCalibration();
+
+    // No save can submit more frames while the storage mutex is held
+    m_poseResolver.Flush();
+    for (const auto& resolved : m_poseResolver.TakeResolvedPoses())
+    {
+        m_frameLocations.push_back(FrameLocation{ resolved.timestamp, resolved.pose });
+    }
     DumpFrameLocations();
     m_tarball.reset();
     m_storageFolder = nullptr;
@@ -261,20 +318,7 @@ void RMCameraReader::SetWorldCoordSystem(const SpatialCoordinateSystem& coordSys
     m_worldCoordSystem = coordSystem;
 }
 
-std::string CreateHeader(const ResearchModeSensorResolution& resolution, int maxBitmapValue)
-{
-    std::string bitmapFormat = "P5"; 
-
-    // Compose PGM header string
-    std::stringstream header;
-    header << bitmapFormat << "\n"
-        << resolution.Width << " "
-        << resolution.Height << "\n"
-        << maxBitmapValue << "\n";
-    return header.str();
-}
-
-void RMCameraReader::SaveDepth(IResearchModeSensorFrame* pSensorFrame, IResearchModeSensorDepthFrame* pDepthFrame)
+void RMCameraReader::SaveDepth(IResearchModeSensorFrame* pSensorFrame, IResearchModeSensorDepthFrame* pDepthFrame, long long absoluteTimestamp)
 {        
     // Get resolution (will be used for PGM header)
     ResearchModeSensorResolution resolution;    
@@ -293,8 +337,6 @@ void RMCameraReader::SaveDepth(IResearchModeSensorFrame* pSensorFrame, IResearch
     const BYTE* pSigma = nullptr;
     size_t outSigmaBufferCount = 0;
 
-    HundredsOfNanoseconds timestamp = m_converter.RelativeTicksToAbsoluteTicks(HundredsOfNanoseconds((long long)m_prevTimestamp));
-
     if (isLongThrow)
     {
         winrt::check_hresult(pDepthFrame->GetSigmaBuffer(&pSigma, &outSigmaBufferCount));
@@ -303,83 +345,54 @@ void RMCameraReader::SaveDepth(IResearchModeSensorFrame* pSensorFrame, IResearch
     winrt::check_hresult(pDepthFrame->GetAbDepthBuffer(&pAbImage, &outAbBufferCount));
     winrt::check_hresult(pDepthFrame->GetBuffer(&pDepth, &outDepthBufferCount));
 
-    // Get header for AB and Depth (16 bits)
-    // Prepare the data to save for AB
-    const std::string abHeaderString = CreateHeader(resolution, 65535);
-    swprintf_s(outputAbPath, L"%llu_ab.pgm", timestamp.count());
-    std::vector<BYTE> abPgmData;
-    abPgmData.reserve(abHeaderString.size() + outAbBufferCount * sizeof(UINT16));
-    abPgmData.insert(abPgmData.end(), abHeaderString.c_str(), abHeaderString.c_str() + abHeaderString.size());
-    
-    // Prepare the data to save for Depth
-    const std::string depthHeaderString = CreateHeader(resolution, 65535);
-    swprintf_s(outputDepthPath, L"%llu.pgm", timestamp.count());
-    std::vector<BYTE> depthPgmData;
-    depthPgmData.reserve(depthHeaderString.size() + outDepthBufferCount * sizeof(UINT16));
-    depthPgmData.insert(depthPgmData.end(), depthHeaderString.c_str(), depthHeaderString.c_str() + depthHeaderString.size());
-    
+    swprintf_s(outputAbPath, L"%llu_ab.pgm", absoluteTimestamp);
+    swprintf_s(outputDepthPath, L"%llu.pgm", absoluteTimestamp);
+
     assert(outAbBufferCount == outDepthBufferCount);
     if (isLongThrow)
         assert(outAbBufferCount == outSigmaBufferCount);
-    // Validate depth
-    for (size_t i = 0; i < outAbBufferCount; ++i)
-    {
-        UINT16 abVal;
-        UINT16 d;
-        const bool invalid = isLongThrow ? ((pSigma[i] & Depth::InvalidationMasks::Invalid) > 0) :
-                                           (pDepth[i] >= Depth::AHAT_INVALID_VALUE);
-        if (invalid)
-        {
-            d = 0;
-        }
-        else
-        {            
-            d = pDepth[i];
-        }
 
-        abVal = pAbImage[i];
-
-        abPgmData.push_back((BYTE)(abVal >> 8));
-        abPgmData.push_back((BYTE)abVal);
-        depthPgmData.push_back((BYTE)(d >> 8));
-        depthPgmData.push_back((BYTE)d);
+    // Prepare the data to save for AB and Depth (16 bits)
+    {
+        FRAME_TRACE_ZONE("EncodeDepthPgms");
+        RMFrameEncoder::EncodeDepthPgms(resolution.Width, resolution.Height, isLongThrow, pDepth, pAbImage, pSigma, outAbBufferCount, m_depthPgmData, m_abPgmData);
     }
 
-    m_tarball->AddFile(outputAbPath, &abPgmData[0], abPgmData.size());
-    m_tarball->AddFile(outputDepthPath, &depthPgmData[0], depthPgmData.size());
+    FRAME_TRACE_ZONE("Tarball::AddFile");
+    m_tarball->AddFile(outputAbPath, &m_abPgmData[0], m_abPgmData.size());
+    m_tarball->AddFile(outputDepthPath, &m_depthPgmData[0], m_depthPgmData.size());
 }
 
-void RMCameraReader::SaveVLC(IResearchModeSensorFrame* pSensorFrame, IResearchModeSensorVLCFrame* pVLCFrame)
+void RMCameraReader::SaveVLC(IResearchModeSensorFrame* pSensorFrame, IResearchModeSensorVLCFrame* pVLCFrame, long long absoluteTimestamp)
 {        
     wchar_t outputPath[MAX_PATH];
 
-    // Get PGM header
-    int maxBitmapValue = 255;
     ResearchModeSensorResolution resolution;
     winrt::check_hresult(pSensorFrame->GetResolution(&resolution));
 
-    const std::string headerString = CreateHeader(resolution, maxBitmapValue);
-
     // Compose the output file name using absolute ticks
-    swprintf_s(outputPath, L"%llu.pgm", m_converter.RelativeTicksToAbsoluteTicks(HundredsOfNanoseconds(checkAndConvertUnsigned(m_prevTimestamp))).count());
+    swprintf_s(outputPath, L"%llu.pgm", absoluteTimestamp);
 
     // Convert the software bitmap to raw bytes    
-    std::vector<BYTE> pgmData;
     size_t outBufferCount = 0;
     const BYTE* pImage = nullptr;
 
     winrt::check_hresult(pVLCFrame->GetBuffer(&pImage, &outBufferCount));
 
-    pgmData.reserve(headerString.size() + outBufferCount);
-    pgmData.insert(pgmData.end(), headerString.c_str(), headerString.c_str() + headerString.size());
-    pgmData.insert(pgmData.end(), pImage, pImage + outBufferCount);
+    {
+        FRAME_TRACE_ZONE("EncodeVlcPgm");
+        RMFrameEncoder::EncodeVlcPgm(resolution.Width, resolution.Height, pImage, outBufferCount, m_vlcPgmData);
+    }
 
-    m_tarball->AddFile(outputPath, &pgmData[0], pgmData.size());
+    FRAME_TRACE_ZONE("Tarball::AddFile");
+    m_tarball->AddFile(outputPath, &m_vlcPgmData[0], m_vlcPgmData.size());
 }
 
 void RMCameraReader::SaveFrame(IResearchModeSensorFrame* pSensorFrame)
 {
-    AddFrameLocation();
+    // Converted once, so the pose and the file names of the frame can't straddle a refresh of the clock domain
+    const long long absoluteTimestamp = m_converter.RelativeTicksToAbsoluteTicks(HundredsOfNanoseconds(checkAndConvertUnsigned(m_prevTimestamp))).count();
+    m_poseResolver.Submit(m_prevTimestamp, absoluteTimestamp);
 
 	IResearchModeSensorVLCFrame* pVLCFrame = nullptr;
 	IResearchModeSensorDepthFrame* pDepthFrame = nullptr;
@@ -393,28 +406,30 @@ void RMCameraReader::SaveFrame(IResearchModeSensorFrame* pSensorFrame)
 
 	if (pVLCFrame)
 	{
-		SaveVLC(pSensorFrame, pVLCFrame);
+		SaveVLC(pSensorFrame, pVLCFrame, absoluteTimestamp);
         pVLCFrame->Release();
 	}
 
 	if (pDepthFrame)
 	{		
-		SaveDepth(pSensorFrame, pDepthFrame);
+		SaveDepth(pSensorFrame, pDepthFrame, absoluteTimestamp);
         pDepthFrame->Release();
 	}    
 }
 
-bool RMCameraReader::AddFrameLocation()
+bool RMCameraReader::LocateRig(uint64_t relativeTicks, float4x4& rigToWorld)
 {         
-    auto timestamp = PerceptionTimestampHelper::FromSystemRelativeTargetTime(HundredsOfNanoseconds(checkAndConvertUnsigned(m_prevTimestamp)));
-    auto location = m_locator.TryLocateAtTimestamp(timestamp, m_worldCoordSystem);
+    auto timestamp = PerceptionTimestampHelper::FromSystemRelativeTargetTime(HundredsOfNanoseconds(checkAndConvertUnsigned(relativeTicks)));
+    SpatialLocation location = nullptr;
+    {
+        FRAME_TRACE_ZONE("TryLocateAtTimestamp");
+        location = m_locator.TryLocateAtTimestamp(timestamp, m_worldCoordSystem);
+    }
     if (!location)
     {
         return false;
     }
-    const float4x4 dynamicNodeToCoordinateSystem = make_float4x4_from_quaternion(location.Orientation()) * make_float4x4_translation(location.Position());
-    auto absoluteTimestamp = m_converter.RelativeTicksToAbsoluteTicks(HundredsOfNanoseconds((long long)m_prevTimestamp)).count();
-    m_frameLocations.push_back(std::move(FrameLocation{absoluteTimestamp, dynamicNodeToCoordinateSystem}));
+    rigToWorld = make_float4x4_from_quaternion(location.Orientation()) * make_float4x4_translation(location.Position());
 
     return true;
 }
@@ -12,12 +12,18 @@
 #pragma once
 
 #include "researchmode\ResearchModeApi.h"
+#include "AsyncPoseResolver.h"
+#include "CalibrationCache.h"
+#include "StringHelpers.h"
 #include "Tar.h"
 #include "TimeConverter.h"
+#include "WriterPool.h"
 
+#include <atomic>
 #include <mutex>
 #include <winrt/Windows.Perception.Spatial.h>
 #include <winrt/Windows.Perception.Spatial.Preview.h>
+#include <winrt/Windows.Storage.h>
 
 
 // Struct to store per-frame rig2world transformations
@@ -32,7 +38,8 @@ struct FrameLocation
 class RMCameraReader
 {
 public:
-	RMCameraReader(IResearchModeSensor* pLLSensor, HANDLE camConsentGiven, ResearchModeSensorConsent* camAccessConsent, const GUID& guid)
+	RMCameraReader(IResearchModeSensor* pLLSensor, HANDLE camConsentGiven, ResearchModeSensorConsent* camAccessConsent, const GUID& guid, WriterPool& writerPool, CalibrationCache& calibrationCache) :
+		m_calibrationCache(calibrationCache)
 	{
 		m_pRMSensor = pLLSensor;
 		m_pRMSensor->AddRef();
@@ -44,8 +51,11 @@ public:
 		// Reserve for 10 seconds at 30fps (holds for VLC)
 		m_frameLocations.reserve(10 * 30);
 
+		m_sensorName = Utf16ToUtf8(m_pRMSensor->GetFriendlyName());
+		m_unsavedFramesCounterName = m_sensorName + " unsaved frames";
+
+		m_writerStream = writerPool.CreateStream();
 		m_pCameraUpdateThread = new std::thread(CameraUpdateThread, this, camConsentGiven, camAccessConsent);
-		m_pWriteThread = new std::thread(CameraWriteThread, this);
 	}
 
 	void SetStorageFolder(const winrt::Windows::Storage::StorageFolder& storageFolder);
@@ -57,31 +67,44 @@ public:
 		m_fExit = true;
 		m_pCameraUpdateThread->join();
 
+		// Nothing posts saves once the update thread is gone. Drop the waiting ones and wait for the running one
+		// before the sensor and the latest frame it saves are released.
+		m_writerStream.reset();
+
+		if (m_pSensorFrame)
+		{
+			m_pSensorFrame->Release();
+			m_pSensorFrame = nullptr;
+		}
+
 		if (m_pRMSensor)
 		{
 			m_pRMSensor->CloseStream();
 			m_pRMSensor->Release();
 		}
-
-		m_pWriteThread->join();
 	}	
 
 protected:
 	// Thread for retrieving frames
 	static void CameraUpdateThread(RMCameraReader* pReader, HANDLE camConsentGiven, ResearchModeSensorConsent* camAccessConsent);
-	// Thread for writing frames to disk
-	static void CameraWriteThread(RMCameraReader* pReader);
+	// Runs on the writer pool, saves the latest frame if it's new
+	void SaveLatestFrame();
 
 	bool IsNewTimestamp(IResearchModeSensorFrame* pSensorFrame);
 
 	void SaveFrame(IResearchModeSensorFrame* pSensorFrame);
-	void SaveVLC(IResearchModeSensorFrame* pSensorFrame, IResearchModeSensorVLCFrame* pVLCFrame);
-	void SaveDepth(IResearchModeSensorFrame* pSensorFrame, IResearchModeSensorDepthFrame* pDepthFrame);
+	// absoluteTimestamp names the files, as converted by SaveFrame
+	void SaveVLC(IResearchModeSensorFrame* pSensorFrame, IResearchModeSensorVLCFrame* pVLCFrame, long long absoluteTimestamp);
+	void SaveDepth(IResearchModeSensorFrame* pSensorFrame, IResearchModeSensorDepthFrame* pDepthFrame, long long absoluteTimestamp);
 
+	// Extrinsics into the recording, LUT and camera model through the calibration cache
 	void DumpCalibration();
+	std::string ComputeCalibrationFingerprint(IResearchModeCameraSensor* pCameraSensor, const ResearchModeSensorResolution& resolution, const DirectX::XMFLOAT4X4& extrinsics);
+	std::vector<float> ComputeLut(IResearchModeCameraSensor* pCameraSensor, const ResearchModeSensorResolution& resolution);
 
 	void SetLocator(const GUID& guid);
-	bool AddFrameLocation();
+	// Runs on the pose resolver's thread
+	bool LocateRig(uint64_t relativeTicks, winrt::Windows::Foundation::Numerics::float4x4& rigToWorld);
 	void DumpFrameLocations();
 
 	// Mutex to access sensor frame
@@ -91,19 +114,37 @@ protected:
 
 	bool m_fExit = false;
 	std::thread* m_pCameraUpdateThread;
-	std::thread* m_pWriteThread;
+
+	// Saves are posted by the update thread, at most one waits in the stream at a time
+	std::unique_ptr<WriterPool::Stream> m_writerStream;
+	std::atomic<bool> m_saveQueued{ false };
 	
 	// Mutex to access storage folder
 	std::mutex m_storageMutex;
-	// conditional variable to enable / disable writing to disk
-	std::condition_variable m_storageCondVar;	
 	winrt::Windows::Storage::StorageFolder m_storageFolder = nullptr;
+	std::atomic<bool> m_recording{ false };	// Lets the update thread skip posting saves without taking m_storageMutex
 	std::unique_ptr<Io::Tarball> m_tarball;
+	// Reused between frames by the save jobs
+	std::vector<BYTE> m_vlcPgmData;
+	std::vector<BYTE> m_depthPgmData;
+	std::vector<BYTE> m_abPgmData;
 
 	TimeConverter m_converter;
 	UINT64 m_prevTimestamp = 0;
 
 	winrt::Windows::Perception::Spatial::SpatialLocator m_locator = nullptr;
 	winrt::Windows::Perception::Spatial::SpatialCoordinateSystem m_worldCoordSystem = nullptr;
-	std::vector<FrameLocation> m_frameLocations;	
+	// The save jobs only submit timestamps, poses are looked up behind it and joined into the log when the recording stops
+	AsyncPoseResolver<winrt::Windows::Foundation::Numerics::float4x4> m_poseResolver{
+		[this](uint64_t relativeTicks, winrt::Windows::Foundation::Numerics::float4x4& rigToWorld) { return LocateRig(relativeTicks, rigToWorld); } };
+	std::vector<FrameLocation> m_frameLocations;
+
+	// Shared by the camera readers, owned by SensorScenario
+	CalibrationCache& m_calibrationCache;
+
+	// Tracing, see FrameTrace.h
+	std::string m_sensorName;
+	std::string m_unsavedFramesCounterName;
+	bool m_sensorFrameSaved = true;		// Guarded by m_sensorFrameMutex
+	uint32_t m_unsavedFrameCount = 0;	// Frames replaced by a newer one before they were saved	
 };
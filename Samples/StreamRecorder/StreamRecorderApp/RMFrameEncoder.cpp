@@ -0,0 +1,81 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "RMFrameEncoder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+namespace RMFrameEncoder
+{
+    std::string CreatePgmHeader(uint32_t width, uint32_t height, int maxBitmapValue)
+    {
+        std::string bitmapFormat = "P5";
+
+        // Compose PGM header string
+        std::stringstream header;
+        header << bitmapFormat << "\n"
+            << width << " "
+            << height << "\n"
+            << maxBitmapValue << "\n";
+        return header.str();
+    }
+
+    void EncodeVlcPgm(uint32_t width, uint32_t height, const uint8_t* pImage, size_t pixelCount, std::vector<uint8_t>& pgmData)
+    {
+        const std::string headerString = CreatePgmHeader(width, height, 255);
+
+        pgmData.clear();
+        pgmData.reserve(headerString.size() + pixelCount);
+        pgmData.insert(pgmData.end(), headerString.c_str(), headerString.c_str() + headerString.size());
+        pgmData.insert(pgmData.end(), pImage, pImage + pixelCount);
+    }
+
+    void EncodeDepthPgms(
+        uint32_t width,
+        uint32_t height,
+        bool isLongThrow,
+        const uint16_t* pDepth,
+        const uint16_t* pAbImage,
+        const uint8_t* pSigma,
+        size_t pixelCount,
+        std::vector<uint8_t>& depthPgmData,
+        std::vector<uint8_t>& abPgmData)
+    {
+        assert(!isLongThrow || pSigma != nullptr);
+
+        // Both images share the same header
+        const std::string headerString = CreatePgmHeader(width, height, 65535);
+        const size_t headerSize = headerString.size();
+
+        depthPgmData.resize(headerSize + pixelCount * sizeof(uint16_t));
+        abPgmData.resize(headerSize + pixelCount * sizeof(uint16_t));
+        std::copy(headerString.begin(), headerString.end(), depthPgmData.begin());
+        std::copy(headerString.begin(), headerString.end(), abPgmData.begin());
+
+        // Validate depth, writing straight into the sized buffers instead of growing them per byte
+        uint8_t* pDepthOut = depthPgmData.data() + headerSize;
+        uint8_t* pAbOut = abPgmData.data() + headerSize;
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            const bool invalid = isLongThrow ? ((pSigma[i] & Depth::InvalidationMasks::Invalid) > 0) :
+                                               (pDepth[i] >= Depth::AHAT_INVALID_VALUE);
+            const uint16_t d = invalid ? 0 : pDepth[i];
+            const uint16_t abVal = pAbImage[i];
+
+            pDepthOut[2 * i] = static_cast<uint8_t>(d >> 8);
+            pDepthOut[2 * i + 1] = static_cast<uint8_t>(d);
+            pAbOut[2 * i] = static_cast<uint8_t>(abVal >> 8);
+            pAbOut[2 * i + 1] = static_cast<uint8_t>(abVal);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The PGM payloads RMCameraReader adds to its tarball. Kept free of Research Mode and WinRT types so the
+// same encoding runs in the off device tools (RecorderStressTest).
+
+namespace Depth
+{
+    enum InvalidationMasks
+    {
+        Invalid = 0x80,
+    };
+    static constexpr uint16_t AHAT_INVALID_VALUE = 4090;
+}
+
+namespace RMFrameEncoder
+{
+    std::string CreatePgmHeader(uint32_t width, uint32_t height, int maxBitmapValue);
+
+    // 8 bit P5 image. pgmData is overwritten; reusing it across frames keeps its allocation.
+    void EncodeVlcPgm(uint32_t width, uint32_t height, const uint8_t* pImage, size_t pixelCount, std::vector<uint8_t>& pgmData);
+
+    // 16 bit big endian P5 images of the depth and active brightness buffers. Invalid depth is written as 0:
+    // pSigma's invalid flag for Long Throw (pSigma must then be non null), values from AHAT_INVALID_VALUE up for AHaT.
+    void EncodeDepthPgms(
+        uint32_t width,
+        uint32_t height,
+        bool isLongThrow,
+        const uint16_t* pDepth,
+        const uint16_t* pAbImage,
+        const uint8_t* pSigma,
+        size_t pixelCount,
+        std::vector<uint8_t>& depthPgmData,
+        std::vector<uint8_t>& abPgmData);
+}
@@ -0,0 +1,205 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "RMImuReader.h"
+
+#include <algorithm>
+
+namespace
+{
+    template<typename T>
+    void CopyImuSample(const T& source, const float (&values)[3], float temperature, ImuSample& sample)
+    {
+        sample.vinylHupTicks = source.VinylHupTicks;
+        sample.socTicks = source.SocTicks;
+        sample.values[0] = values[0];
+        sample.values[1] = values[1];
+        sample.values[2] = values[2];
+        sample.temperature = temperature;
+    }
+}
+
+RMImuSource::RMImuSource(IResearchModeSensor* pSensor, ImuSensorKind kind, HANDLE imuConsentGiven, ResearchModeSensorConsent* imuAccessConsent) :
+    m_pRMSensor(pSensor),
+    m_kind(kind),
+    m_imuConsentGiven(imuConsentGiven),
+    m_imuAccessConsent(imuAccessConsent)
+{
+    m_pRMSensor->AddRef();
+    m_interruptEvent = CreateEvent(nullptr, true, false, nullptr);
+}
+
+RMImuSource::~RMImuSource()
+{
+    Close();
+    m_pRMSensor->Release();
+    CloseHandle(m_interruptEvent);
+}
+
+bool RMImuSource::Open()
+{
+    // The consent prompt may never be answered, so the wait also ends on Interrupt
+    const HANDLE events[] = { m_imuConsentGiven, m_interruptEvent };
+    if (WaitForMultipleObjects(ARRAYSIZE(events), events, false, INFINITE) != WAIT_OBJECT_0)
+    {
+        return false;
+    }
+
+    if (*m_imuAccessConsent != ResearchModeSensorConsent::Allowed)
+    {
+        OutputDebugString(L"IMU access is denied\n");
+        return false;
+    }
+
+    m_streamOpen = SUCCEEDED(m_pRMSensor->OpenStream());
+    return m_streamOpen;
+}
+
+void RMImuSource::Close()
+{
+    ReleaseFrame();
+    if (m_streamOpen)
+    {
+        m_pRMSensor->CloseStream();
+        m_streamOpen = false;
+    }
+}
+
+void RMImuSource::Interrupt()
+{
+    SetEvent(m_interruptEvent);
+}
+
+bool RMImuSource::ReadBatch(ImuSample* pSamples, size_t capacity, size_t& count)
+{
+    count = 0;
+    if (WaitForSingleObject(m_interruptEvent, 0) == WAIT_OBJECT_0)
+    {
+        return false;
+    }
+
+    if (m_frameSampleOffset >= m_frameSampleCount && !AcquireFrame())
+    {
+        return false;
+    }
+
+    count = std::min(capacity, m_frameSampleCount - m_frameSampleOffset);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const size_t sampleIndex = m_frameSampleOffset + i;
+        switch (m_kind)
+        {
+        case ImuSensorKind::Accelerometer:
+        {
+            const AccelDataStruct& source = static_cast<const AccelDataStruct*>(m_pFrameSamples)[sampleIndex];
+            CopyImuSample(source, source.AccelValues, source.temperature, pSamples[i]);
+            break;
+        }
+        case ImuSensorKind::Gyroscope:
+        {
+            const GyroDataStruct& source = static_cast<const GyroDataStruct*>(m_pFrameSamples)[sampleIndex];
+            CopyImuSample(source, source.GyroValues, source.temperature, pSamples[i]);
+            break;
+        }
+        case ImuSensorKind::Magnetometer:
+        {
+            const MagDataStruct& source = static_cast<const MagDataStruct*>(m_pFrameSamples)[sampleIndex];
+            CopyImuSample(source, source.MagValues, 0.0f, pSamples[i]);
+            break;
+        }
+        }
+    }
+    m_frameSampleOffset += count;
+
+    // Give the buffer back as soon as it's consumed
+    if (m_frameSampleOffset >= m_frameSampleCount)
+    {
+        ReleaseFrame();
+    }
+    return true;
+}
+
+bool RMImuSource::AcquireFrame()
+{
+    ReleaseFrame();
+
+    // Blocks until the sensor has a new batch. Open streams hand out one every few milliseconds, so ReadBatch
+    // gets back to checking for Interrupt soon.
+    if (FAILED(m_pRMSensor->GetNextBuffer(&m_pSensorFrame)) || !m_pSensorFrame)
+    {
+        return false;
+    }
+
+    HRESULT hr = E_FAIL;
+    switch (m_kind)
+    {
+    case ImuSensorKind::Accelerometer:
+    {
+        IResearchModeAccelFrame* pAccelFrame = nullptr;
+        const AccelDataStruct* pAccelSamples = nullptr;
+        if (SUCCEEDED(m_pSensorFrame->QueryInterface(IID_PPV_ARGS(&pAccelFrame))))
+        {
+            m_pTypedFrame = pAccelFrame;
+            hr = pAccelFrame->GetCalibratedAccelarationSamples(&pAccelSamples, &m_frameSampleCount);
+            m_pFrameSamples = pAccelSamples;
+        }
+        break;
+    }
+    case ImuSensorKind::Gyroscope:
+    {
+        IResearchModeGyroFrame* pGyroFrame = nullptr;
+        const GyroDataStruct* pGyroSamples = nullptr;
+        if (SUCCEEDED(m_pSensorFrame->QueryInterface(IID_PPV_ARGS(&pGyroFrame))))
+        {
+            m_pTypedFrame = pGyroFrame;
+            hr = pGyroFrame->GetCalibratedGyroSamples(&pGyroSamples, &m_frameSampleCount);
+            m_pFrameSamples = pGyroSamples;
+        }
+        break;
+    }
+    case ImuSensorKind::Magnetometer:
+    {
+        IResearchModeMagFrame* pMagFrame = nullptr;
+        const MagDataStruct* pMagSamples = nullptr;
+        if (SUCCEEDED(m_pSensorFrame->QueryInterface(IID_PPV_ARGS(&pMagFrame))))
+        {
+            m_pTypedFrame = pMagFrame;
+            hr = pMagFrame->GetMagnetometerSamples(&pMagSamples, &m_frameSampleCount);
+            m_pFrameSamples = pMagSamples;
+        }
+        break;
+    }
+    }
+
+    if (FAILED(hr))
+    {
+        // Skip the buffer, the next one may be fine
+        ReleaseFrame();
+    }
+    return true;
+}
+
+void RMImuSource::ReleaseFrame()
+{
+    if (m_pTypedFrame)
+    {
+        m_pTypedFrame->Release();
+        m_pTypedFrame = nullptr;
+    }
+    if (m_pSensorFrame)
+    {
+        m_pSensorFrame->Release();
+        m_pSensorFrame = nullptr;
+    }
+    m_pFrameSamples = nullptr;
+    m_frameSampleCount = 0;
+    m_frameSampleOffset = 0;
+}
@@ -0,0 +1,47 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "researchmode\ResearchModeApi.h"
+#include "ImuSampleStream.h"
+
+// ImuSampleSource for the Research Mode accelerometer, gyroscope and magnetometer.
+// Each sensor buffer holds a batch of samples; a buffer larger than the reader's batch is handed out over several ReadBatch calls.
+class RMImuSource : public ImuSampleSource
+{
+public:
+    RMImuSource(IResearchModeSensor* pSensor, ImuSensorKind kind, HANDLE imuConsentGiven, ResearchModeSensorConsent* imuAccessConsent);
+    ~RMImuSource() override;
+
+    bool Open() override;
+    bool ReadBatch(ImuSample* pSamples, size_t capacity, size_t& count) override;
+    void Close() override;
+    void Interrupt() override;
+
+private:
+    bool AcquireFrame();
+    void ReleaseFrame();
+
+    IResearchModeSensor* m_pRMSensor;
+    const ImuSensorKind m_kind;
+    HANDLE m_imuConsentGiven;
+    ResearchModeSensorConsent* m_imuAccessConsent;
+    HANDLE m_interruptEvent;    // Manual reset, set by Interrupt
+    bool m_streamOpen = false;
+
+    // Current sensor buffer and how far into it we are
+    IResearchModeSensorFrame* m_pSensorFrame = nullptr;
+    IUnknown* m_pTypedFrame = nullptr;
+    const void* m_pFrameSamples = nullptr;
+    size_t m_frameSampleCount = 0;
+    size_t m_frameSampleOffset = 0;
+};
@@ -0,0 +1,100 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// Lines of the <sensor>_rig2world.txt and <datetime>_pv.txt logs, and the records of <datetime>_head_hand_eye.bin.
+// Templated on the matrix and frame types so any type with the same members works: float4x4 and the HeTHaTEyeStream
+// frames on the device, plain structs in the off device benchmarks.
+namespace RecorderLog
+{
+    // The 16 values transposed (m11, m21, m31, m41, m12, ...), so numpy's reshape(4, 4) gives the column vector transform
+    template<typename Matrix>
+    void WriteTransposedMatrix(std::ostream& out, const Matrix& m)
+    {
+        out << m.m11 << "," << m.m21 << "," << m.m31 << "," << m.m41 << ","
+            << m.m12 << "," << m.m22 << "," << m.m32 << "," << m.m42 << ","
+            << m.m13 << "," << m.m23 << "," << m.m33 << "," << m.m43 << ","
+            << m.m14 << "," << m.m24 << "," << m.m34 << "," << m.m44;
+    }
+
+    // timestamp,<rig to world>. Lines end with "\n" rather than std::endl. DumpFrameLocations writes them all at the
+    // end of a recording from locations held in memory, which a crash loses anyway, so a flush per line bought nothing.
+    template<typename Matrix>
+    void WriteRig2WorldLine(std::ostream& out, long long timestamp, const Matrix& rigToWorld)
+    {
+        out << timestamp << ",";
+        WriteTransposedMatrix(out, rigToWorld);
+        out << "\n";
+    }
+
+    // timestamp,fx,fy,<PV to world>
+    template<typename Matrix>
+    void WritePVFrameLine(std::ostream& out, long long timestamp, float fx, float fy, const Matrix& pvToWorld)
+    {
+        out << timestamp << ",";
+        out << fx << "," << fy << ",";
+        WriteTransposedMatrix(out, pvToWorld);
+        out << "\n";
+    }
+
+    // A value as the binary logs store it, in the little endian layout of every target of the app
+    template<typename T>
+    void WriteValue(std::ostream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    // Position, then orientation, of a CompactPose or a QuantizedPose
+    template<typename Pose>
+    void WritePose(std::ostream& out, const Pose& pose)
+    {
+        WriteValue(out, pose.position);
+        WriteValue(out, pose.orientation);
+    }
+
+    // Header of <datetime>_head_hand_eye.bin, see HeTHaTEyeStream.h for the layout
+    template<typename Float3>
+    void WriteHeadHandEyeHeader(std::ostream& out, uint32_t version, bool quantized, uint32_t jointsPerHand,
+        const Float3& quantizationOrigin, float quantizationMetersPerUnit)
+    {
+        static const char kMagic[8] = { 'H', 'L', 'H', 'N', 'D', 'E', 'Y', 'E' };
+        out.write(kMagic, sizeof(kMagic));
+        WriteValue(out, version);
+        WriteValue(out, quantized ? uint32_t(1) : uint32_t(0));
+        WriteValue(out, jointsPerHand);
+        WriteValue(out, quantizationOrigin);
+        WriteValue(out, quantizationMetersPerUnit);
+    }
+
+    // One frame of <datetime>_head_hand_eye.bin, from a HeTHaTEyeFrame or a QuantizedHeTHaTEyeFrame
+    template<typename Frame>
+    void WriteHeadHandEyeFrame(std::ostream& out, const Frame& frame)
+    {
+        WriteValue(out, (int64_t)frame.timestamp);
+        WriteValue(out, (uint32_t)frame.presence);
+        WritePose(out, frame.head);
+        for (const auto& pose : frame.leftHand)
+        {
+            WritePose(out, pose);
+        }
+        for (const auto& pose : frame.rightHand)
+        {
+            WritePose(out, pose);
+        }
+        WriteValue(out, frame.eyeGazeOrigin);
+        WriteValue(out, frame.eyeGazeDirection);
+        WriteValue(out, frame.eyeGazeDistance);
+    }
+}
@@ -18,14 +18,20 @@ HMODULE LoadLibraryA(
 
 static ResearchModeSensorConsent camAccessCheck;
 static HANDLE camConsentGiven;
+static ResearchModeSensorConsent imuAccessCheck;
+static HANDLE imuConsentGiven;
 
-SensorScenario::SensorScenario(const std::vector<ResearchModeSensorType>& kEnabledSensorTypes):
-	m_kEnabledSensorTypes(kEnabledSensorTypes)
+SensorScenario::SensorScenario(const std::vector<ResearchModeSensorType>& kEnabledSensorTypes, WriterPool& writerPool):
+	m_kEnabledSensorTypes(kEnabledSensorTypes),
+	m_writerPool(writerPool)
 {
 }
 
 SensorScenario::~SensorScenario()
 {
+	// The recorders hold their own references and close the streams
+	m_imuRecorders.clear();
+
 	if (m_pLFCameraSensor)
 	{
 		m_pLFCameraSensor->Release();
@@ -50,6 +56,18 @@ SensorScenario::~SensorScenario()
 	{
 		m_pAHATSensor->Release();
 	}
+	if (m_pAccelSensor)
+	{
+		m_pAccelSensor->Release();
+	}
+	if (m_pGyroSensor)
+	{
+		m_pGyroSensor->Release();
+	}
+	if (m_pMagSensor)
+	{
+		m_pMagSensor->Release();
+	}
 
 	if (m_pSensorDevice)
 	{
@@ -75,6 +93,7 @@ void SensorScenario::InitializeSensors()
 {
 	size_t sensorCount = 0;
 	camConsentGiven = CreateEvent(nullptr, true, false, nullptr);
+	imuConsentGiven = CreateEvent(nullptr, true, false, nullptr);
 
 	// Load Research Mode library
 	HMODULE hrResearchMode = LoadLibraryA("ResearchModeAPI");
@@ -91,6 +110,14 @@ void SensorScenario::InitializeSensors()
 	// Manage Sensor Consent
 	winrt::check_hresult(m_pSensorDevice->QueryInterface(IID_PPV_ARGS(&m_pSensorDeviceConsent)));
 	winrt::check_hresult(m_pSensorDeviceConsent->RequestCamAccessAsync(SensorScenario::CamAccessOnComplete));	
+	for (auto imuSensorType : { IMU_ACCEL, IMU_GYRO, IMU_MAG })
+	{
+		if (std::find(m_kEnabledSensorTypes.begin(), m_kEnabledSensorTypes.end(), imuSensorType) != m_kEnabledSensorTypes.end())
+		{
+			winrt::check_hresult(m_pSensorDeviceConsent->RequestIMUAccessAsync(SensorScenario::ImuAccessOnComplete));
+			break;
+		}
+	}
 
 	m_pSensorDevice->DisableEyeSelection();
 
@@ -159,6 +186,33 @@ void SensorScenario::InitializeSensors()
 			}
 			winrt::check_hresult(m_pSensorDevice->GetSensor(sensorDescriptor.sensorType, &m_pAHATSensor));
 		}
+
+		if (sensorDescriptor.sensorType == IMU_ACCEL)
+		{
+			if (std::find(m_kEnabledSensorTypes.begin(), m_kEnabledSensorTypes.end(), IMU_ACCEL) == m_kEnabledSensorTypes.end())
+			{
+				continue;
+			}
+			winrt::check_hresult(m_pSensorDevice->GetSensor(sensorDescriptor.sensorType, &m_pAccelSensor));
+		}
+
+		if (sensorDescriptor.sensorType == IMU_GYRO)
+		{
+			if (std::find(m_kEnabledSensorTypes.begin(), m_kEnabledSensorTypes.end(), IMU_GYRO) == m_kEnabledSensorTypes.end())
+			{
+				continue;
+			}
+			winrt::check_hresult(m_pSensorDevice->GetSensor(sensorDescriptor.sensorType, &m_pGyroSensor));
+		}
+
+		if (sensorDescriptor.sensorType == IMU_MAG)
+		{
+			if (std::find(m_kEnabledSensorTypes.begin(), m_kEnabledSensorTypes.end(), IMU_MAG) == m_kEnabledSensorTypes.end())
+			{
+				continue;
+			}
+			winrt::check_hresult(m_pSensorDevice->GetSensor(sensorDescriptor.sensorType, &m_pMagSensor));
+		}
 	}	
 }
 
@@ -168,6 +222,12 @@ void SensorScenario::CamAccessOnComplete(ResearchModeSensorConsent consent)
 	SetEvent(camConsentGiven);
 }
 
+void SensorScenario::ImuAccessOnComplete(ResearchModeSensorConsent consent)
+{
+	imuAccessCheck = consent;
+	SetEvent(imuConsentGiven);
+}
+
 void SensorScenario::InitializeCameraReaders()
 {
 	// Get RigNode id which will be used to initialize
@@ -177,41 +237,63 @@ void SensorScenario::InitializeCameraReaders()
 
 	if (m_pLFCameraSensor)
 	{
-		auto cameraReader = std::make_shared<RMCameraReader>(m_pLFCameraSensor, camConsentGiven, &camAccessCheck, guid);
+		auto cameraReader = std::make_shared<RMCameraReader>(m_pLFCameraSensor, camConsentGiven, &camAccessCheck, guid, m_writerPool, m_calibrationCache);
 		m_cameraReaders.push_back(cameraReader);
 	}
 
 	if (m_pRFCameraSensor)
 	{
-		auto cameraReader = std::make_shared<RMCameraReader>(m_pRFCameraSensor, camConsentGiven, &camAccessCheck, guid);
+		auto cameraReader = std::make_shared<RMCameraReader>(m_pRFCameraSensor, camConsentGiven, &camAccessCheck, guid, m_writerPool, m_calibrationCache);
 		m_cameraReaders.push_back(cameraReader);
 	}
 
 	if (m_pLLCameraSensor)
 	{
-		auto cameraReader = std::make_shared<RMCameraReader>(m_pLLCameraSensor, camConsentGiven, &camAccessCheck, guid);
+		auto cameraReader = std::make_shared<RMCameraReader>(m_pLLCameraSensor, camConsentGiven, &camAccessCheck, guid, m_writerPool, m_calibrationCache);
 		m_cameraReaders.push_back(cameraReader);
 	}
 
 	if (m_pRRCameraSensor)
 	{
-		auto cameraReader = std::make_shared<RMCameraReader>(m_pRRCameraSensor, camConsentGiven, &camAccessCheck, guid);
+		auto cameraReader = std::make_shared<RMCameraReader>(m_pRRCameraSensor, camConsentGiven, &camAccessCheck, guid, m_writerPool, m_calibrationCache);
 		m_cameraReaders.push_back(cameraReader);
 	}
 
 	if (m_pLTSensor)
 	{
-		auto cameraReader = std::make_shared<RMCameraReader>(m_pLTSensor, camConsentGiven, &camAccessCheck, guid);
+		auto cameraReader = std::make_shared<RMCameraReader>(m_pLTSensor, camConsentGiven, &camAccessCheck, guid, m_writerPool, m_calibrationCache);
 		m_cameraReaders.push_back(cameraReader);
 	}
 
 	if (m_pAHATSensor)
 	{
-		auto cameraReader = std::make_shared<RMCameraReader>(m_pAHATSensor, camConsentGiven, &camAccessCheck, guid);
+		auto cameraReader = std::make_shared<RMCameraReader>(m_pAHATSensor, camConsentGiven, &camAccessCheck, guid, m_writerPool, m_calibrationCache);
 		m_cameraReaders.push_back(cameraReader);
 	}	
 }
 
+void SensorScenario::InitializeImuReaders()
+{
+	// Samples are drained as soon as the streams open, and only kept while recording
+	if (m_pAccelSensor)
+	{
+		auto source = std::make_unique<RMImuSource>(m_pAccelSensor, ImuSensorKind::Accelerometer, imuConsentGiven, &imuAccessCheck);
+		m_imuRecorders.push_back(std::make_shared<ImuStreamRecorder>(std::move(source), ImuSensorKind::Accelerometer));
+	}
+
+	if (m_pGyroSensor)
+	{
+		auto source = std::make_unique<RMImuSource>(m_pGyroSensor, ImuSensorKind::Gyroscope, imuConsentGiven, &imuAccessCheck);
+		m_imuRecorders.push_back(std::make_shared<ImuStreamRecorder>(std::move(source), ImuSensorKind::Gyroscope));
+	}
+
+	if (m_pMagSensor)
+	{
+		auto source = std::make_unique<RMImuSource>(m_pMagSensor, ImuSensorKind::Magnetometer, imuConsentGiven, &imuAccessCheck);
+		m_imuRecorders.push_back(std::make_shared<ImuStreamRecorder>(std::move(source), ImuSensorKind::Magnetometer));
+	}
+}
+
 void SensorScenario::StartRecording(const winrt::Windows::Storage::StorageFolder& folder,
 									const winrt::Windows::Perception::Spatial::SpatialCoordinateSystem& worldCoordSystem)
 {
@@ -220,6 +302,14 @@ void SensorScenario::StartRecording(const winrt::Windows::Storage::StorageFolder
 		m_cameraReaders[i]->SetWorldCoordSystem(worldCoordSystem);
 		m_cameraReaders[i]->SetStorageFolder(folder);		
 	}
+
+	// IMU SocTicks are on the same QPC based 100 ns clock as the camera HostTicks, each batch is converted with the
+	// shared clock domain as it is written
+	const std::filesystem::path folderPath(folder.Path().c_str());
+	for (const auto& imuRecorder : m_imuRecorders)
+	{
+		imuRecorder->StartRecording(folderPath / (std::string(GetImuSensorName(imuRecorder->GetKind())) + ".bin"), TimeConverter::GetSharedClockDomain());
+	}
 }
 
 void SensorScenario::StopRecording()
@@ -228,4 +318,9 @@ void SensorScenario::StopRecording()
 	{
 		m_cameraReaders[i]->ResetStorageFolder();
 	}
+
+	for (const auto& imuRecorder : m_imuRecorders)
+	{
+		imuRecorder->StopRecording();
+	}
 }
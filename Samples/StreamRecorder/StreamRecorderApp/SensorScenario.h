@@ -13,25 +13,33 @@
 
 #include "researchmode\ResearchModeApi.h"
 #include "RMCameraReader.h"
+#include "RMImuReader.h"
 
 
 class SensorScenario
 {
 public:
-	SensorScenario(const std::vector<ResearchModeSensorType>& kEnabledSensorTypes);
+	SensorScenario(const std::vector<ResearchModeSensorType>& kEnabledSensorTypes, WriterPool& writerPool);
 	virtual ~SensorScenario();
 
 	void InitializeSensors();
 	void InitializeCameraReaders();	
+	void InitializeImuReaders();
 	void StartRecording(const winrt::Windows::Storage::StorageFolder& folder, const winrt::Windows::Perception::Spatial::SpatialCoordinateSystem& worldCoordSystem);
 	void StopRecording();
 	static void CamAccessOnComplete(ResearchModeSensorConsent consent);
+	static void ImuAccessOnComplete(ResearchModeSensorConsent consent);
 
 private:
 	void GetRigNodeId(GUID& outGuid) const;
 
 	const std::vector<ResearchModeSensorType>& m_kEnabledSensorTypes;
+	// Encodes and writes the camera frames, owned by AppMain
+	WriterPool& m_writerPool;
+	// LUTs and camera models of this device, referenced by the recordings
+	CalibrationCache m_calibrationCache;
 	std::vector<std::shared_ptr<RMCameraReader>> m_cameraReaders;
+	std::vector<std::shared_ptr<ImuStreamRecorder>> m_imuRecorders;
 
 	IResearchModeSensorDevice* m_pSensorDevice = nullptr;
 	IResearchModeSensorDeviceConsent* m_pSensorDeviceConsent = nullptr;
@@ -44,4 +52,7 @@ private:
 	IResearchModeSensor* m_pRRCameraSensor = nullptr;
 	IResearchModeSensor* m_pLTSensor = nullptr;
 	IResearchModeSensor* m_pAHATSensor = nullptr;		
+	IResearchModeSensor* m_pAccelSensor = nullptr;
+	IResearchModeSensor* m_pGyroSensor = nullptr;
+	IResearchModeSensor* m_pMagSensor = nullptr;
 };
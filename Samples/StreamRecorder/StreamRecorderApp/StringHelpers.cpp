@@ -12,13 +12,16 @@
 
 #include "StringHelpers.h"
 
+#include <cstdio>
+
 std::string Utf16ToUtf8(const wchar_t* text)
 {
     char buffer[1024];
 
-    sprintf_s(
+    snprintf(
         buffer,
-        "%S",
+        sizeof(buffer),
+        "%ls",
         text);
 
     return std::string(buffer);
@@ -0,0 +1,203 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "SurfaceMeshStream.h"
+
+using namespace winrt::Windows::Storage;
+
+namespace
+{
+    const char kFileMagic[8] = { 'H', 'L', 'S', 'U', 'R', 'F', 'M', 'S' };
+
+    // 64-bit FNV-1a
+    uint64_t HashBytes(uint64_t hash, const void* pData, size_t size)
+    {
+        const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= pBytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    template<typename T>
+    void WriteValue(std::ofstream& file, const T& value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    void WriteArray(std::ofstream& file, const std::vector<T>& values)
+    {
+        if (!values.empty())
+        {
+            file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+        }
+    }
+}
+
+SurfaceMeshStream::SurfaceMeshStream() :
+    m_writeThread(WriteThread, this)
+{
+}
+
+SurfaceMeshStream::~SurfaceMeshStream()
+{
+    StopRecording();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_fExit = true;
+    }
+    m_condVar.notify_all();
+    m_writeThread.join();
+}
+
+uint64_t SurfaceMeshStream::HashSnapshot(const SurfaceMeshSnapshot& snapshot)
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash = HashBytes(hash, &snapshot.worldTransform, sizeof(snapshot.worldTransform));
+    hash = HashBytes(hash, &snapshot.vertexPositionScale, sizeof(snapshot.vertexPositionScale));
+    hash = HashBytes(hash, snapshot.positions.data(), snapshot.positions.size() * sizeof(short));
+    hash = HashBytes(hash, snapshot.normals.data(), snapshot.normals.size() * sizeof(char));
+    hash = HashBytes(hash, snapshot.indices.data(), snapshot.indices.size() * sizeof(unsigned short));
+    return hash;
+}
+
+void SurfaceMeshStream::OnSurfaceMesh(const SurfaceMeshSnapshot& snapshot)
+{
+    // Hash outside of the lock, surfaces can hold tens of thousands of vertices
+    const uint64_t hash = HashSnapshot(snapshot);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    CachedSurface& cachedSurface = m_latestSurfaces[snapshot.id];
+    if (cachedSurface.snapshot && cachedSurface.hash == hash)
+    {
+        return;
+    }
+
+    cachedSurface.snapshot = std::make_shared<const SurfaceMeshSnapshot>(snapshot);
+    cachedSurface.hash = hash;
+
+    if (m_recording)
+    {
+        EnqueueIfChanged(cachedSurface.snapshot, hash);
+    }
+}
+
+// Expects m_mutex to be held
+void SurfaceMeshStream::EnqueueIfChanged(const std::shared_ptr<const SurfaceMeshSnapshot>& snapshot, uint64_t hash)
+{
+    auto writtenHash = m_writtenHashes.find(snapshot->id);
+    if (writtenHash != m_writtenHashes.end() && writtenHash->second == hash)
+    {
+        return;
+    }
+
+    m_writtenHashes[snapshot->id] = hash;
+    m_writeQueue.push_back(snapshot);
+    ++m_pendingWriteCount;
+    m_condVar.notify_all();
+}
+
+bool SurfaceMeshStream::StartRecording(const StorageFolder& folder, const std::wstring& datetime_path)
+{
+    StopRecording();
+
+    std::wstring fullName(folder.Path().data());
+    fullName += L"\\" + datetime_path + L"_surfaces.bin";
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_file.open(fullName, std::ios::binary | std::ios::trunc);
+    if (!m_file)
+    {
+        return false;
+    }
+
+    const uint32_t reserved = 0;
+    m_file.write(kFileMagic, sizeof(kFileMagic));
+    WriteValue(m_file, kFileVersion);
+    WriteValue(m_file, reserved);
+
+    m_writtenHashes.clear();
+    m_recordCount = 0;
+    m_recording = true;
+
+    for (auto& surfacePair : m_latestSurfaces)
+    {
+        EnqueueIfChanged(surfacePair.second.snapshot, surfacePair.second.hash);
+    }
+
+    return true;
+}
+
+void SurfaceMeshStream::StopRecording()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_recording)
+    {
+        return;
+    }
+
+    // Let the write thread drain whatever is queued so the file holds everything seen up to this point
+    m_recording = false;
+    m_condVar.wait(lock, [this] { return m_pendingWriteCount == 0; });
+
+    m_file.close();
+}
+
+size_t SurfaceMeshStream::RecordCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_recordCount;
+}
+
+void SurfaceMeshStream::WriteThread(SurfaceMeshStream* pStream)
+{
+    std::unique_lock<std::mutex> lock(pStream->m_mutex);
+    for (;;)
+    {
+        pStream->m_condVar.wait(lock, [pStream] { return pStream->m_fExit || !pStream->m_writeQueue.empty(); });
+        if (pStream->m_writeQueue.empty())
+        {
+            break;
+        }
+
+        std::shared_ptr<const SurfaceMeshSnapshot> snapshot = pStream->m_writeQueue.front();
+        pStream->m_writeQueue.pop_front();
+
+        lock.unlock();
+        pStream->WriteSnapshot(*snapshot);
+        lock.lock();
+
+        ++pStream->m_recordCount;
+        --pStream->m_pendingWriteCount;
+        pStream->m_condVar.notify_all();
+    }
+}
+
+void SurfaceMeshStream::WriteSnapshot(const SurfaceMeshSnapshot& snapshot)
+{
+    const uint32_t vertexCount = (uint32_t)(snapshot.positions.size() / 4);
+    const uint32_t indexCount = (uint32_t)snapshot.indices.size();
+
+    WriteValue(m_file, snapshot.id);
+    WriteValue(m_file, snapshot.surfaceUpdateTime);
+    WriteValue(m_file, snapshot.worldTransform);
+    WriteValue(m_file, snapshot.vertexPositionScale);
+    WriteValue(m_file, vertexCount);
+    WriteValue(m_file, indexCount);
+    WriteArray(m_file, snapshot.positions);
+    WriteArray(m_file, snapshot.normals);
+    WriteArray(m_file, snapshot.indices);
+}
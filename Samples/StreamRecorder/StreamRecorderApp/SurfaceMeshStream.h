@@ -0,0 +1,78 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "../Cannon/MixedReality.h"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <winrt/Windows.Storage.h>
+
+// Streams spatial mapping surfaces into <datetime>_surfaces.bin while recording.
+//
+// File layout (little endian):
+//   header:  char[8] "HLSURFMS", uint32 version, uint32 reserved
+//   records: guid id (16 bytes), int64 surfaceUpdateTime, float[16] worldTransform (row major, row vectors),
+//            float[3] vertexPositionScale, uint32 vertexCount, uint32 indexCount,
+//            int16[4 * vertexCount] positions, int8[4 * vertexCount] normals, uint16[indexCount] indices
+//
+// A surface id can appear several times; later records replace earlier ones. Surfaces whose geometry
+// and transform did not change since they were last written are skipped.
+class SurfaceMeshStream
+{
+public:
+    static constexpr uint32_t kFileVersion = 1;
+
+    SurfaceMeshStream();
+    ~SurfaceMeshStream();
+
+    // Meant to be registered with SurfaceMapping::SetSurfaceMeshCallback, can be called from any thread
+    void OnSurfaceMesh(const SurfaceMeshSnapshot& snapshot);
+
+    // Every surface seen so far is written at the start of a recording, not only the ones that update during it
+    bool StartRecording(const winrt::Windows::Storage::StorageFolder& folder, const std::wstring& datetime_path);
+    void StopRecording();
+
+    size_t RecordCount() const;
+
+private:
+    static void WriteThread(SurfaceMeshStream* pStream);
+
+    static uint64_t HashSnapshot(const SurfaceMeshSnapshot& snapshot);
+    void EnqueueIfChanged(const std::shared_ptr<const SurfaceMeshSnapshot>& snapshot, uint64_t hash);
+    void WriteSnapshot(const SurfaceMeshSnapshot& snapshot);
+
+    struct CachedSurface
+    {
+        std::shared_ptr<const SurfaceMeshSnapshot> snapshot;
+        uint64_t hash = 0;
+    };
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condVar;
+
+    std::map<winrt::guid, CachedSurface> m_latestSurfaces;
+    std::map<winrt::guid, uint64_t> m_writtenHashes;    // What the current file already holds for each surface
+    std::deque<std::shared_ptr<const SurfaceMeshSnapshot>> m_writeQueue;
+    size_t m_pendingWriteCount = 0;
+    size_t m_recordCount = 0;
+
+    bool m_recording = false;
+    bool m_fExit = false;
+    std::ofstream m_file;   // Written by the write thread, opened/closed under m_mutex with an empty queue
+    std::thread m_writeThread;
+};
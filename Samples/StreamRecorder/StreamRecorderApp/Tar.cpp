@@ -12,12 +12,13 @@
 #include <cassert>
 #include <chrono>
 #include <cstdint>
+#include <cstdio>
+#include <filesystem>
 #include <ios>
 #include <string>
 
 #include "StringHelpers.h"
 #include "Tar.h"
-#include "TimeConverter.h"
 
 namespace Io
 {    
@@ -134,11 +135,12 @@ namespace Io
         {
             char buffer[32] = {};
 
-            numberOfOctets = sprintf_s(
+            numberOfOctets = snprintf(
                 buffer,
+                sizeof(buffer),
                 "%0*llo",
                 static_cast<int>(N - 1),
-                input);
+                static_cast<unsigned long long>(input));
 
             assert(numberOfOctets <= N - 1);
 
@@ -155,7 +157,7 @@ namespace Io
     }
 
     Tarball::Tarball(const std::wstring& tarballFileName) {
-        m_tarballFile.open(tarballFileName, std::ios::binary);
+        m_tarballFile.open(std::filesystem::path(tarballFileName), std::ios::binary);
         assert(m_tarballFile.is_open());
     }
 
@@ -11,9 +11,8 @@
 
 #pragma once
 
-#include <intrin.h>
-#include <winrt/Windows.Storage.h>
 #include <fstream>
+#include <string>
 #include <vector>
 
 namespace Io
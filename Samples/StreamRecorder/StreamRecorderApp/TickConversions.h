@@ -0,0 +1,46 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Clock arithmetic behind TimeConverter, without the Windows clock queries so it also builds off device.
+
+typedef std::chrono::duration<int64_t, std::ratio<1, 10'000'000>> HundredsOfNanoseconds;
+
+// qpcFrequency is QueryPerformanceFrequency's counts per second. Splitting off the whole seconds keeps
+// the multiplication from overflowing for any uptime.
+inline HundredsOfNanoseconds UnsignedQpcToRelativeTicks(const uint64_t qpc, const uint64_t qpcFrequency)
+{
+    static const std::uint64_t c_ticksPerSecond = 10'000'000;
+
+    const std::uint64_t q = qpc / qpcFrequency;
+    const std::uint64_t r = qpc % qpcFrequency;
+
+    return HundredsOfNanoseconds(
+        q * c_ticksPerSecond + (r * c_ticksPerSecond) / qpcFrequency);
+}
+
+inline HundredsOfNanoseconds QpcToRelativeTicks(const int64_t qpc, const uint64_t qpcFrequency)
+{
+    if (qpc < 0)
+    {
+        return -UnsignedQpcToRelativeTicks(
+            static_cast<uint64_t>(-qpc), qpcFrequency);
+    }
+    else
+    {
+        return UnsignedQpcToRelativeTicks(
+            static_cast<uint64_t>(qpc), qpcFrequency);
+    }
+}
@@ -11,6 +11,101 @@
 
 #include "TimeConverter.h"
 
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    // Owns the app's ClockDomain and adds a clock sample to it every kRefreshPeriod
+    class SharedClockDomain
+    {
+    public:
+        SharedClockDomain() :
+            m_clockDomain(QueryFrequency())
+        {
+            AddSample();
+            m_refreshThread = std::thread([this]() { RefreshLoop(); });
+        }
+
+        ~SharedClockDomain()
+        {
+            {
+                std::lock_guard<std::mutex> guard(m_mutex);
+                m_exit = true;
+            }
+            m_exitCondition.notify_one();
+            m_refreshThread.join();
+        }
+
+        ClockDomain& Get()
+        {
+            return m_clockDomain;
+        }
+
+    private:
+        static constexpr std::chrono::seconds kRefreshPeriod{ 1 };
+        static constexpr int kReadsPerSample = 3;
+
+        static uint64_t QueryFrequency()
+        {
+            LARGE_INTEGER qpf;
+            QueryPerformanceFrequency(&qpf);
+            return static_cast<uint64_t>(qpf.QuadPart);
+        }
+
+        // Of a few reads of the system time, keeps the one the two QPC reads around it bracket the closest
+        void AddSample()
+        {
+            int64_t bestBracket = std::numeric_limits<int64_t>::max();
+            int64_t qpc = 0;
+            int64_t fileTime = 0;
+            for (int i = 0; i < kReadsPerSample; i++)
+            {
+                LARGE_INTEGER before;
+                LARGE_INTEGER after;
+                FILETIME ft;
+                QueryPerformanceCounter(&before);
+                GetSystemTimePreciseAsFileTime(&ft);
+                QueryPerformanceCounter(&after);
+
+                const int64_t bracket = after.QuadPart - before.QuadPart;
+                if (bracket < bestBracket)
+                {
+                    bestBracket = bracket;
+                    qpc = before.QuadPart + bracket / 2;
+                    fileTime = static_cast<int64_t>(ft.dwLowDateTime + (static_cast<uint64_t>(ft.dwHighDateTime) << 32));
+                }
+            }
+            m_clockDomain.AddSample(qpc, fileTime);
+        }
+
+        void RefreshLoop()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (!m_exitCondition.wait_for(lock, kRefreshPeriod, [this]() { return m_exit; }))
+            {
+                lock.unlock();
+                AddSample();
+                lock.lock();
+            }
+        }
+
+        ClockDomain m_clockDomain;
+        std::mutex m_mutex;
+        std::condition_variable m_exitCondition;
+        bool m_exit = false;
+        std::thread m_refreshThread;
+    };
+}
+
+ClockDomain& TimeConverter::GetSharedClockDomain()
+{
+    static SharedClockDomain s_clockDomain;
+    return s_clockDomain.Get();
+}
+
 static constexpr UINT64 kMaxLongLong = static_cast<UINT64>(std::numeric_limits<long long>::max());
 
 long long checkAndConvertUnsigned(UINT64 val)
@@ -10,6 +10,8 @@
 //*********************************************************
 
 #include "VideoFrameProcessor.h"
+#include "FrameTrace.h"
+#include "RecorderLogWriters.h"
 #include <winrt/Windows.Foundation.Collections.h>
 #include <fstream>
 
@@ -104,18 +106,42 @@ winrt::Windows::Foundation::IAsyncAction VideoFrameProcessor::InitializeAsync()
 
     // reserve for 10 seconds at 30fps
     m_PVFrameLog.reserve(10 * 30);
-    m_pWriteThread = new std::thread(CameraWriteThread, this);
 
+    m_mediaFrameReader = mediaFrameReader;
     m_OnFrameArrivedRegistration = mediaFrameReader.FrameArrived({ this, &VideoFrameProcessor::OnFrameArrived });
 }
 
 void VideoFrameProcessor::OnFrameArrived(const MediaFrameReader& sender, const MediaFrameArrivedEventArgs& args)
 {
-    if (MediaFrameReference frame = sender.TryAcquireLatestFrame())
+    std::shared_lock<std::shared_mutex> frameArrivedLock(m_frameArrivedMutex);
+    if (m_closing)
+    {
+        return;
+    }
+
+    if (FrameTrace::IsEnabled())
+    {
+        // Frame arrived events come on thread pool threads
+        FrameTrace::SetThreadName("PV frame arrived");
+    }
+
+    MediaFrameReference frame = nullptr;
+    {
+        FRAME_TRACE_ZONE("TryAcquireLatestFrame");
+        frame = sender.TryAcquireLatestFrame();
+    }
+    if (frame)
     {    
+        FRAME_TRACE_ZONE("Store m_latestFrame");
         std::lock_guard<std::shared_mutex> lock(m_frameMutex);
         m_latestFrame = frame;
     }
+
+    // A save still waiting in the stream will pick this frame up
+    if (frame && m_recording && !m_saveQueued.exchange(true))
+    {
+        m_writerStream->Post([this]() { SaveLatestFrame(); });
+    }
 }
 
 void VideoFrameProcessor::Clear()
@@ -133,6 +159,7 @@ void VideoFrameProcessor::AddLogFrame()
     frame.fx = m_latestFrame.VideoMediaFrame().CameraIntrinsics().FocalLength().x;
     frame.fy = m_latestFrame.VideoMediaFrame().CameraIntrinsics().FocalLength().y;
 
+    FRAME_TRACE_ZONE("TryGetTransformTo");
     auto PVtoWorld = m_latestFrame.CoordinateSystem().TryGetTransformTo(m_worldCoordSystem);
     if (PVtoWorld)
     {
@@ -157,6 +184,7 @@ void VideoFrameProcessor::DumpFrame(const SoftwareBitmap& softwareBitmap, long l
     auto spMemoryBufferByteAccess{ bitmapBuffer.CreateReference().as<::Windows::Foundation::IMemoryBufferByteAccess>() };
     winrt::check_hresult(spMemoryBufferByteAccess->GetBuffer(&pixelBufferData, &pixelBufferDataLength));
 
+    FRAME_TRACE_ZONE("Tarball::AddFile");
     m_tarball->AddFile(bitmapPath, &pixelBufferData[0], pixelBufferDataLength);    
 }
 
@@ -179,13 +207,7 @@ bool VideoFrameProcessor::DumpDataToDisk(const StorageFolder& folder, const std:
     
     for (const PVFrame& frame : m_PVFrameLog)
     {
-        file << frame.timestamp << ",";
-        file << frame.fx << "," << frame.fy << ",";
-        file << frame.PVtoWorldtransform.m11 << "," << frame.PVtoWorldtransform.m21 << "," << frame.PVtoWorldtransform.m31 << "," << frame.PVtoWorldtransform.m41 << ","
-            << frame.PVtoWorldtransform.m12 << "," << frame.PVtoWorldtransform.m22 << "," << frame.PVtoWorldtransform.m32 << "," << frame.PVtoWorldtransform.m42 << ","
-            << frame.PVtoWorldtransform.m13 << "," << frame.PVtoWorldtransform.m23 << "," << frame.PVtoWorldtransform.m33 << "," << frame.PVtoWorldtransform.m43 << ","
-            << frame.PVtoWorldtransform.m14 << "," << frame.PVtoWorldtransform.m24 << "," << frame.PVtoWorldtransform.m34 << "," << frame.PVtoWorldtransform.m44;
-        file << "\n";
+        RecorderLog::WritePVFrameLine(file, frame.timestamp, frame.fx, frame.fy, frame.PVtoWorldtransform);
     }
     file.close();
     return true;
@@ -202,42 +224,55 @@ void VideoFrameProcessor::StartRecording(const StorageFolder& storageFolder, con
     m_tarball.reset(new Io::Tarball(fileName));
 
     m_worldCoordSystem = worldCoordSystem;
+    m_recording = true;
 }
 
 void VideoFrameProcessor::StopRecording()
 {
     std::lock_guard<std::mutex> guard(m_storageMutex);
+    m_recording = false;
     m_tarball.reset();
     m_storageFolder = nullptr;
 }
 
-void VideoFrameProcessor::CameraWriteThread(VideoFrameProcessor* pProcessor)
+void VideoFrameProcessor::SaveLatestFrame()
 {
-    while (!pProcessor->m_fExit)
+    FRAME_TRACE_ZONE("PV");
+    // Cleared first, so a frame arriving during the save queues the next one
+    m_saveQueued = false;
+
+    std::lock_guard<std::mutex> guard(m_storageMutex);
+    if (m_storageFolder == nullptr)
+    {
+        return;
+    }
+
+    SoftwareBitmap softwareBitmap = nullptr;
     {
-        std::lock_guard<std::mutex> guard(pProcessor->m_storageMutex);
-        if (pProcessor->m_storageFolder != nullptr)
+        std::unique_lock<std::shared_mutex> lock(m_frameMutex, std::defer_lock);
         {
-            SoftwareBitmap softwareBitmap = nullptr;
+            FRAME_TRACE_ZONE("Wait m_frameMutex");
+            lock.lock();
+        }
+        if (m_latestFrame != nullptr)
+        {
+            auto frame = m_latestFrame;
+            long long timestamp = m_converter.RelativeTicksToAbsoluteTicks(HundredsOfNanoseconds(frame.SystemRelativeTime().Value().count())).count();
+            if (timestamp != m_latestTimestamp)
             {
-                std::lock_guard<std::shared_mutex> lock(pProcessor->m_frameMutex);
-                if (pProcessor->m_latestFrame != nullptr)
                 {
-                    auto frame = pProcessor->m_latestFrame;                    
-                    long long timestamp = pProcessor->m_converter.RelativeTicksToAbsoluteTicks(HundredsOfNanoseconds(frame.SystemRelativeTime().Value().count())).count();
-                    if (timestamp != pProcessor->m_latestTimestamp)
-                    {
-                        softwareBitmap = SoftwareBitmap::Convert(frame.VideoMediaFrame().SoftwareBitmap(), BitmapPixelFormat::Bgra8);
-                        pProcessor->m_latestTimestamp = timestamp;
-                        pProcessor->AddLogFrame();
-                    }
+                    FRAME_TRACE_ZONE("SoftwareBitmap::Convert");
+                    softwareBitmap = SoftwareBitmap::Convert(frame.VideoMediaFrame().SoftwareBitmap(), BitmapPixelFormat::Bgra8);
                 }
-            }
-            // Convert and write the bitmap
-            if (softwareBitmap != nullptr)
-            {
-                pProcessor->DumpFrame(softwareBitmap, pProcessor->m_latestTimestamp);
+                m_latestTimestamp = timestamp;
+                AddLogFrame();
             }
         }
     }
+    // Convert and write the bitmap
+    if (softwareBitmap != nullptr)
+    {
+        FRAME_TRACE_ZONE("DumpFrame");
+        DumpFrame(softwareBitmap, m_latestTimestamp);
+    }
 }
@@ -16,8 +16,11 @@
 #include <winrt/Windows.Media.Capture.Frames.h>
 #include <winrt/Windows.Perception.Spatial.h>
 #include <winrt/Windows.Graphics.Imaging.h>
+#include <winrt/Windows.Storage.h>
 #include "Tar.h"
 #include "TimeConverter.h"
+#include "WriterPool.h"
+#include <atomic>
 #include <mutex>
 #include <shared_mutex>
 #include <thread>
@@ -36,14 +39,25 @@ struct PVFrame
 class VideoFrameProcessor
 {
 public:
-    VideoFrameProcessor()
+    explicit VideoFrameProcessor(WriterPool& writerPool) :
+        m_writerStream(writerPool.CreateStream())
     {
     }
 
     virtual ~VideoFrameProcessor()
     {
-        m_fExit = true;
-        m_pWriteThread->join();
+        if (m_mediaFrameReader)
+        {
+            m_mediaFrameReader.FrameArrived(m_OnFrameArrivedRegistration);
+        }
+
+        // Revoking doesn't wait for a handler already running on the thread pool. Wait for those to leave,
+        // and turn away any that got past the revoke, before the stream they post to goes away.
+        {
+            std::unique_lock<std::shared_mutex> lock(m_frameArrivedMutex);
+            m_closing = true;
+        }
+        m_writerStream.reset();
     }
 
     void Clear();
@@ -62,6 +76,9 @@ private:
 
     winrt::Windows::Media::Capture::Frames::MediaFrameReader m_mediaFrameReader = nullptr;
     winrt::event_token m_OnFrameArrivedRegistration;
+    // Held shared by OnFrameArrived, exclusively by the destructor to drain the handlers
+    std::shared_mutex m_frameArrivedMutex;
+    bool m_closing = false;
 
     std::shared_mutex m_frameMutex;
     long long m_latestTimestamp = 0;
@@ -75,10 +92,12 @@ private:
     TimeConverter m_converter;
     winrt::Windows::Perception::Spatial::SpatialCoordinateSystem m_worldCoordSystem = nullptr;
 
-    // writing thread
-    static void CameraWriteThread(VideoFrameProcessor* pProcessor);
-    std::thread* m_pWriteThread = nullptr;
-    bool m_fExit = false;
+    // Runs on the writer pool, saves the latest frame if it's new
+    void SaveLatestFrame();
+    // Saves are posted by OnFrameArrived, at most one waits in the stream at a time
+    std::unique_ptr<WriterPool::Stream> m_writerStream;
+    std::atomic<bool> m_saveQueued{ false };
+    std::atomic<bool> m_recording{ false };
 
     static const int kImageWidth;
     static const wchar_t kSensorName[3];
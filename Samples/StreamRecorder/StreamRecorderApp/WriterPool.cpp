@@ -0,0 +1,166 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "WriterPool.h"
+#include "FrameTrace.h"
+
+#include <algorithm>
+#include <cassert>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+WriterPool::Stream::~Stream()
+{
+    std::unique_lock<std::mutex> lock(m_pool.m_mutex);
+    m_jobs.clear();
+    if (m_scheduled && !m_running)
+    {
+        auto& readyStreams = m_pool.m_readyStreams;
+        readyStreams.erase(std::remove(readyStreams.begin(), readyStreams.end(), this), readyStreams.end());
+        m_scheduled = false;
+    }
+    m_pool.m_jobDone.wait(lock, [this] { return !m_scheduled; });
+}
+
+void WriterPool::Stream::Post(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> guard(m_pool.m_mutex);
+        m_jobs.push_back(std::move(job));
+        if (m_scheduled)
+        {
+            // The worker running this stream picks the job up when it's done
+            return;
+        }
+        m_scheduled = true;
+        m_pool.m_readyStreams.push_back(this);
+    }
+    m_pool.m_workAvailable.notify_one();
+}
+
+void WriterPool::Stream::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_pool.m_mutex);
+    m_pool.m_jobDone.wait(lock, [this] { return !m_scheduled; });
+}
+
+WriterPool::WriterPool(const WriterPoolOptions& options) :
+    m_options(options)
+{
+    const unsigned threadCount = (std::max)(options.threadCount, 1u);
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        m_threads.emplace_back(WorkerThread, this, i);
+    }
+}
+
+WriterPool::~WriterPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        assert(m_readyStreams.empty());
+        m_fExit = true;
+    }
+    m_workAvailable.notify_all();
+    for (std::thread& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+std::unique_ptr<WriterPool::Stream> WriterPool::CreateStream()
+{
+    return std::unique_ptr<Stream>(new Stream(*this));
+}
+
+bool WriterPool::SetCurrentThreadOptions(int core, WriterThreadPriority priority)
+{
+    bool succeeded = true;
+#ifdef _WIN32
+    if (core >= 0)
+    {
+        succeeded &= SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core) != 0;
+    }
+    static const int kPriorities[] = { THREAD_PRIORITY_LOWEST, THREAD_PRIORITY_BELOW_NORMAL, THREAD_PRIORITY_NORMAL,
+                                       THREAD_PRIORITY_ABOVE_NORMAL, THREAD_PRIORITY_HIGHEST };
+    succeeded &= SetThreadPriority(GetCurrentThread(), kPriorities[static_cast<int>(priority)]) != 0;
+#elif defined(__linux__)
+    if (core >= 0)
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(core, &cpuSet);
+        succeeded &= pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+    }
+    // Linux threads have their own nice value; raising it above normal needs CAP_SYS_NICE
+    static const int kNiceValues[] = { 10, 5, 0, -5, -10 };
+    if (priority != WriterThreadPriority::Normal)
+    {
+        succeeded &= setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), kNiceValues[static_cast<int>(priority)]) == 0;
+    }
+#else
+    succeeded = core < 0 && priority == WriterThreadPriority::Normal;
+#endif
+    return succeeded;
+}
+
+void WriterPool::WorkerThread(WriterPool* pPool, unsigned index)
+{
+    const WriterPoolOptions& options = pPool->m_options;
+    const int core = options.cores.empty() ? -1 : static_cast<int>(options.cores[index % options.cores.size()]);
+    if (core >= 0 || options.priority != WriterThreadPriority::Normal)
+    {
+        SetCurrentThreadOptions(core, options.priority);
+    }
+    FrameTrace::SetThreadName(options.name + " " + std::to_string(index));
+
+    std::unique_lock<std::mutex> lock(pPool->m_mutex);
+    while (true)
+    {
+        pPool->m_workAvailable.wait(lock, [pPool] { return pPool->m_fExit || !pPool->m_readyStreams.empty(); });
+        if (pPool->m_readyStreams.empty())
+        {
+            break;
+        }
+
+        Stream* pStream = pPool->m_readyStreams.front();
+        pPool->m_readyStreams.pop_front();
+        std::function<void()> job = std::move(pStream->m_jobs.front());
+        pStream->m_jobs.pop_front();
+        pStream->m_running = true;
+
+        lock.unlock();
+        job();
+        job = nullptr;  // Releases what the job captured outside the lock
+        lock.lock();
+
+        // One job per turn, so a stream with a backlog can't hold a worker while the others wait
+        pStream->m_running = false;
+        if (pStream->m_jobs.empty())
+        {
+            pStream->m_scheduled = false;
+        }
+        else
+        {
+            pPool->m_readyStreams.push_back(pStream);
+            pPool->m_workAvailable.notify_one();
+        }
+        pPool->m_jobDone.notify_all();
+    }
+}
@@ -0,0 +1,99 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Small set of threads shared by all the recorded streams for encoding and writing frames.
+// Each sensor keeps its own acquisition thread, since GetNextBuffer blocks, and posts its saves to a
+// WriterPool::Stream. Jobs of one stream run one at a time and in the order they were posted, jobs of
+// different streams run in parallel on whichever worker is free.
+
+enum class WriterThreadPriority
+{
+    Lowest,
+    BelowNormal,
+    Normal,
+    AboveNormal,
+    Highest
+};
+
+struct WriterPoolOptions
+{
+    unsigned threadCount = 2;
+    std::vector<unsigned> cores;    // Worker i only runs on cores[i % cores.size()], empty leaves it to the scheduler
+    WriterThreadPriority priority = WriterThreadPriority::Normal;
+    std::string name = "Writer";    // Worker threads show up as "<name> <index>" in frame traces
+};
+
+class WriterPool
+{
+public:
+    class Stream
+    {
+    public:
+        // Drops the jobs that haven't started and waits for the running one
+        ~Stream();
+
+        Stream(const Stream&) = delete;
+        Stream& operator=(const Stream&) = delete;
+
+        void Post(std::function<void()> job);
+
+        // Blocks until every job posted so far has run
+        void Wait();
+
+    private:
+        friend class WriterPool;
+        explicit Stream(WriterPool& pool) : m_pool(pool) {}
+
+        WriterPool& m_pool;
+        // Guarded by the pool's mutex
+        std::deque<std::function<void()>> m_jobs;
+        bool m_scheduled = false;   // Waiting in the pool's ready queue, or running
+        bool m_running = false;
+    };
+
+    explicit WriterPool(const WriterPoolOptions& options = WriterPoolOptions());
+    // All streams must be destroyed first
+    ~WriterPool();
+
+    WriterPool(const WriterPool&) = delete;
+    WriterPool& operator=(const WriterPool&) = delete;
+
+    std::unique_ptr<Stream> CreateStream();
+
+    unsigned GetThreadCount() const { return static_cast<unsigned>(m_threads.size()); }
+
+    // Pinning and priority are best effort, returns false if the platform refused them
+    static bool SetCurrentThreadOptions(int core, WriterThreadPriority priority);
+
+private:
+    static void WorkerThread(WriterPool* pPool, unsigned index);
+
+    const WriterPoolOptions m_options;
+
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_jobDone;
+    std::deque<Stream*> m_readyStreams;     // Streams with a job to run, each one at most once
+    bool m_fExit = false;
+
+    std::vector<std::thread> m_threads;
+};
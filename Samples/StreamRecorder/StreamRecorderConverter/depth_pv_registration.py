@@ -0,0 +1,216 @@
+"""
+ Copyright (c) Microsoft. All rights reserved.
+ This code is licensed under the MIT License (MIT).
+ THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+ ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+ IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+ PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+"""
+import argparse
+import time
+from pathlib import Path
+
+import numpy as np
+import cv2
+
+from project_hand_eye_to_pv import load_pv_data, match_timestamp
+from utils import load_sensor_lut, project_on_pv, project_on_depth
+
+
+# Virtual pinhole camera the depth frames are resampled to for the RGB-D datasets of save_pclouds.py
+PINHOLE_WIDTH = 320
+PINHOLE_HEIGHT = 288
+PINHOLE_FOCAL_LENGTH = 200
+
+
+def pinhole_intrinsics(scale=1):
+    width = PINHOLE_WIDTH * scale
+    height = PINHOLE_HEIGHT * scale
+    focal_length = PINHOLE_FOCAL_LENGTH * scale
+    return np.array([[focal_length, 0, width / 2.],
+                     [0, focal_length, height / 2.],
+                     [0, 0, 1.]]), width, height
+
+
+class DepthPvRegistration:
+    """Maps the frames of a depth camera onto PV frames and onto the virtual pinhole camera
+
+    Everything that only depends on the depth camera is computed once: the rays of the mapped pixels, the
+    camera to rig transform, and the pinhole pixel of each ray, which doesn't depend on the depth. Per frame
+    pair, only the depth to PV transform is composed (4x4), and the points go to PV pixels in one pass over the
+    depth image, without building world space points.
+
+    Same results as the projection through world space (register_reference), except for:
+    - points behind the PV camera, which get no color instead of a mirrored one;
+    - pixels that several points land on, which keep the nearest point instead of the last one.
+    """
+
+    def __init__(self, lut, rig2cam, pinhole_scale=1):
+        """
+        Args:
+            lut: (width * height) x 3 unit rays of the depth camera, as utils.load_sensor_lut returns them
+            rig2cam: extrinsics of the depth camera, as save_pclouds.load_extrinsics returns them
+        """
+        lut = np.asarray(lut, dtype=np.float64).reshape((-1, 3))
+        # Depth images must have exactly this many pixels for pixel_ids to index them
+        self.pixel_count = len(lut)
+        # Rays with z <= 0 are the pixels the sensor couldn't map
+        self.pixel_ids = np.nonzero(lut[:, 2] > 0)[0]
+        # Depth images are in millimeters, points in meters
+        self.rays = lut[self.pixel_ids] / 1000.
+        self.cam2rig = np.linalg.inv(rig2cam)
+
+        self.pinhole_intrinsics, self.pinhole_width, self.pinhole_height = pinhole_intrinsics(pinhole_scale)
+        uv = self.rays[:, :2] / self.rays[:, 2:] @ self.pinhole_intrinsics[:2, :2].T + self.pinhole_intrinsics[:2, 2]
+        uv = np.around(uv).astype(int)
+        inside = (uv[:, 0] >= 0) & (uv[:, 0] < self.pinhole_width) & (uv[:, 1] >= 0) & (uv[:, 1] < self.pinhole_height)
+        self.pinhole_pixels = np.where(inside, uv[:, 1] * self.pinhole_width + uv[:, 0], -1)
+
+    def points_in_cam_space(self, depth_img):
+        """(N x 3) points of the pixels with a depth, in meters, and their index among the mapped pixels"""
+        assert depth_img.size == self.pixel_count, f'{depth_img.size} depth pixels for a LUT of {self.pixel_count}'
+        depth = depth_img.reshape(-1)[self.pixel_ids]
+        ids = np.nonzero(depth)[0]
+        return self.rays[ids] * depth[ids, np.newaxis], ids
+
+    def cam2world(self, points, rig2world):
+        """World space points and the cam2world transform (rig2world @ inv(rig2cam)) of the frame"""
+        cam2world_transform = rig2world @ self.cam2rig
+        return points @ cam2world_transform[:3, :3].T + cam2world_transform[:3, 3], cam2world_transform
+
+    def depth2pv(self, rig2world, pv2world):
+        """Transform from the depth camera to the PV camera of a frame pair"""
+        return np.linalg.inv(pv2world) @ rig2world @ self.cam2rig
+
+    def project_on_pv(self, points, pv_img, rig2world, pv2world, focal_length, principal_point, with_depth=True):
+        """Colors of camera space points in a PV frame, like utils.project_on_pv but from camera space
+
+        Returns:
+            (N x 3) rgb in [0, 1], black for the points the PV camera doesn't see, and the PV aligned depth image
+            (z of the PV camera frame, negative in front, as utils.project_on_pv gives it), or None unless with_depth
+        """
+        height, width, _ = pv_img.shape
+        depth2pv = self.depth2pv(rig2world, pv2world)
+        points_pv = points @ depth2pv[:3, :3].T + depth2pv[:3, 3]
+
+        # The PV camera looks along -z with y up, hence the signs of utils.project_on_pv's intrinsics and mirroring
+        z = points_pv[:, 2]
+        in_front = z < 0
+        inv_z = np.divide(1, z, out=np.zeros_like(z), where=in_front)
+        u = np.floor(principal_point[0] - focal_length[0] * points_pv[:, 0] * inv_z).astype(int)
+        v = np.floor(principal_point[1] + focal_length[1] * points_pv[:, 1] * inv_z).astype(int)
+        valid_ids = np.nonzero(in_front & (u >= 0) & (u < width) & (v >= 0) & (v < height))[0]
+        u = u[valid_ids]
+        v = v[valid_ids]
+
+        rgb = np.zeros_like(points)
+        rgb[valid_ids] = pv_img[v, u, ::-1] / 255.
+
+        depth_image = None
+        if with_depth:
+            depth_image = np.zeros((height, width))
+            # Farthest first, so the nearest point of each pixel is written last
+            order = np.argsort(z[valid_ids], kind='stable')
+            depth_image[v[order], u[order]] = z[valid_ids][order]
+        return rgb, depth_image
+
+    def project_on_pinhole(self, point_ids, points, rgb):
+        """Depth and color of the virtual pinhole camera, like utils.project_on_depth
+
+        Args:
+            point_ids: indices of the points among the mapped pixels, from points_in_cam_space
+        Returns:
+            pinhole image (BGR, 0 to 255) and depth image (meters)
+        """
+        pixels = self.pinhole_pixels[point_ids]
+        inside = np.nonzero(pixels >= 0)[0]
+        order = inside[np.argsort(-points[inside, 2], kind='stable')]
+        pixels = pixels[order]
+
+        depth_image = np.zeros(self.pinhole_height * self.pinhole_width)
+        depth_image[pixels] = points[order, 2]
+        image = np.zeros((self.pinhole_height * self.pinhole_width, 3))
+        image[pixels] = rgb[order, ::-1] * 255.
+        return (image.reshape((self.pinhole_height, self.pinhole_width, 3)),
+                depth_image.reshape((self.pinhole_height, self.pinhole_width)))
+
+
+def register_reference(lut, rig2cam, depth_img, rig2world, pv_img, pv2world, focal_length, principal_point):
+    """The registration save_pclouds.py did frame by frame, through world space, for comparison"""
+    points = np.tile(depth_img.flatten().reshape((-1, 1)), (1, 3)) * lut
+    points = points[(lut[:, 2] > 0) & (depth_img.reshape(-1) > 0)] / 1000.
+    homog_points = np.hstack((points, np.ones((points.shape[0], 1))))
+    xyz = ((rig2world @ np.linalg.inv(rig2cam)) @ homog_points.T).T[:, :3]
+    rgb, _ = project_on_pv(xyz, pv_img, pv2world, focal_length, principal_point)
+    intrinsic_matrix, width, height = pinhole_intrinsics()
+    rgb_proj, depth_proj = project_on_depth(points, rgb, intrinsic_matrix, width, height)
+    return rgb, rgb_proj, depth_proj
+
+
+def check_registration(folder, sensor_name, frame_count, calibration_store=None):
+    """Registration against the reference on the first frames of a capture
+
+    Returns:
+        True when both give the same colors and pinhole depth, up to the pixels several points land on
+    """
+    from save_pclouds import load_extrinsics, load_rig2world_transforms, extract_timestamp
+
+    lut = load_sensor_lut(folder, sensor_name, calibration_store)
+    rig2cam = load_extrinsics(folder / r'{}_extrinsics.txt'.format(sensor_name))
+    rig2world_transforms = load_rig2world_transforms(folder / r'{}_rig2world.txt'.format(sensor_name))
+    (pv_timestamps, focal_lengths, pv2world_transforms, ox, oy, _, _) = load_pv_data(sorted(folder.glob('*pv.txt'))[0])
+    principal_point = np.array([ox, oy])
+    registration = DepthPvRegistration(lut, rig2cam)
+
+    paths = [path for path in sorted((folder / sensor_name).glob('*[0-9].pgm'))
+             if extract_timestamp(path.name) in rig2world_transforms][:frame_count]
+    if not paths:
+        raise SystemExit(f'No depth frame with a pose in {folder / sensor_name}')
+
+    reference_seconds = registration_seconds = 0
+    color_mismatches = depth_mismatches = point_count = 0
+    for path in paths:
+        timestamp = extract_timestamp(path.name)
+        target_id = match_timestamp(timestamp, pv_timestamps)
+        depth_img = cv2.imread(str(path), -1)
+        pv_img = cv2.imread(str(folder / 'PV' / f'{pv_timestamps[target_id]}.png'))
+        frame = (rig2world_transforms[timestamp], pv_img, pv2world_transforms[target_id], focal_lengths[target_id],
+                 principal_point)
+
+        start = time.perf_counter()
+        rgb, rgb_proj, depth_proj = register_reference(lut, rig2cam, depth_img, *frame)
+        reference_seconds += time.perf_counter() - start
+
+        start = time.perf_counter()
+        points, ids = registration.points_in_cam_space(depth_img)
+        fast_rgb, _ = registration.project_on_pv(points, pv_img, frame[0], *frame[2:], with_depth=False)
+        fast_rgb_proj, fast_depth_proj = registration.project_on_pinhole(ids, points, fast_rgb)
+        registration_seconds += time.perf_counter() - start
+
+        # Rounding can move a point across a pixel border, and the reference colors points behind the camera
+        point_count += len(points)
+        color_mismatches += np.count_nonzero(np.any(np.abs(fast_rgb - rgb) > 1e-6, axis=1))
+        depth_mismatches += np.count_nonzero(np.abs(fast_depth_proj - depth_proj) > 1e-4)
+
+    print('{}: {} frames, {:.1f} ms per frame through world space, {:.1f} ms registered ({:.1f}x), '
+          '{} of {} colors and {} pinhole depths differ'.format(
+              sensor_name, len(paths), reference_seconds / len(paths) * 1e3, registration_seconds / len(paths) * 1e3,
+              reference_seconds / registration_seconds, color_mismatches, point_count, depth_mismatches))
+    return color_mismatches <= 1e-3 * point_count
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Check the depth to PV registration against the projection '
+                                                 'through world space on a capture with PV frames.')
+    parser.add_argument("--recording_path", required=True,
+                        help="Path to recording folder, with the PV and depth tar files extracted")
+    parser.add_argument("--sensor_name", default="Depth Long Throw",
+                        choices=["Depth Long Throw", "Depth AHaT"])
+    parser.add_argument("--frame_count", type=int, default=20,
+                        help="Number of depth frames compared")
+    parser.add_argument("--calibration_store", default=None,
+                        help="Folder of the calibration blobs downloaded by recorder_console.py")
+
+    args = parser.parse_args()
+    passed = check_registration(Path(args.recording_path), args.sensor_name, args.frame_count, args.calibration_store)
+    raise SystemExit(0 if passed else 1)
@@ -0,0 +1,502 @@
+"""
+ Copyright (c) Microsoft. All rights reserved.
+ This code is licensed under the MIT License (MIT).
+ THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+ ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+ IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+ PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+"""
+import argparse
+import tempfile
+from pathlib import Path
+
+import numpy as np
+
+from utils import (IMU_FILE_MAGIC, IMU_FILE_VERSION, IMU_SAMPLE_DTYPE, IMU_SENSOR_NAMES, load_imu_samples,
+                   quaternion_to_matrix)
+
+# Spatial coordinate systems are y up. Accelerometers measure specific force, so at rest they read +9.81 upwards.
+GRAVITY_WORLD = np.array([0.0, -9.81, 0.0])
+TICKS_PER_SECOND = 1e7
+
+
+def quaternion_multiply(a, b):
+    """Hamilton product of (..., 4) x, y, z, w quaternions"""
+    ax, ay, az, aw = np.moveaxis(a, -1, 0)
+    bx, by, bz, bw = np.moveaxis(b, -1, 0)
+    return np.stack([aw * bx + ax * bw + ay * bz - az * by,
+                     aw * by - ax * bz + ay * bw + az * bx,
+                     aw * bz + ax * by - ay * bx + az * bw,
+                     aw * bw - ax * bx - ay * by - az * bz], axis=-1)
+
+
+def quaternion_conjugate(q):
+    return q * np.array([-1.0, -1.0, -1.0, 1.0])
+
+
+def rotation_vector_to_quaternion(rotation_vectors):
+    angle = np.linalg.norm(rotation_vectors, axis=-1, keepdims=True)
+    # sin(angle / 2) / angle, with its Taylor expansion near 0
+    scale = np.where(angle > 1e-8, np.sin(0.5 * angle) / np.maximum(angle, 1e-12), 0.5 - angle ** 2 / 48)
+    return np.concatenate((rotation_vectors * scale, np.cos(0.5 * angle)), axis=-1)
+
+
+def quaternion_to_rotation_vector(q):
+    q = np.where(q[..., 3:] < 0, -q, q)
+    sin_half = np.linalg.norm(q[..., :3], axis=-1, keepdims=True)
+    angle = 2 * np.arctan2(sin_half, q[..., 3:])
+    scale = np.where(sin_half > 1e-12, angle / np.maximum(sin_half, 1e-12), 2.0)
+    return q[..., :3] * scale
+
+
+def matrix_to_quaternion(matrices):
+    """Unit x, y, z, w quaternions of (..., 3, 3) rotation matrices (column vectors)"""
+    m = matrices
+    trace = m[..., 0, 0] + m[..., 1, 1] + m[..., 2, 2]
+    # 4x^2, 4y^2, 4z^2, 4w^2: dividing by the largest one is the stable choice
+    squares = np.stack([1 + 2 * m[..., 0, 0] - trace,
+                        1 + 2 * m[..., 1, 1] - trace,
+                        1 + 2 * m[..., 2, 2] - trace,
+                        1 + trace], axis=-1)
+    largest = np.argmax(squares, axis=-1)
+    root = 2 * np.sqrt(np.maximum(np.take_along_axis(squares, largest[..., None], axis=-1)[..., 0], 1e-12))
+
+    candidates = np.stack([
+        np.stack([0.25 * root, (m[..., 0, 1] + m[..., 1, 0]) / root,
+                  (m[..., 0, 2] + m[..., 2, 0]) / root, (m[..., 2, 1] - m[..., 1, 2]) / root], axis=-1),
+        np.stack([(m[..., 0, 1] + m[..., 1, 0]) / root, 0.25 * root,
+                  (m[..., 1, 2] + m[..., 2, 1]) / root, (m[..., 0, 2] - m[..., 2, 0]) / root], axis=-1),
+        np.stack([(m[..., 0, 2] + m[..., 2, 0]) / root, (m[..., 1, 2] + m[..., 2, 1]) / root,
+                  0.25 * root, (m[..., 1, 0] - m[..., 0, 1]) / root], axis=-1),
+        np.stack([(m[..., 2, 1] - m[..., 1, 2]) / root, (m[..., 0, 2] - m[..., 2, 0]) / root,
+                  (m[..., 1, 0] - m[..., 0, 1]) / root, 0.25 * root], axis=-1)], axis=-2)
+    q = np.take_along_axis(candidates, largest[..., None, None], axis=-2)[..., 0, :]
+    return q / np.linalg.norm(q, axis=-1, keepdims=True)
+
+
+def load_rig2world_keyframes(rig2world_path):
+    """Timestamps (N) and 4x4 rig to world transforms (N x 4 x 4, column vectors) of a _rig2world.txt file,
+    sorted by timestamp"""
+    data = np.atleast_2d(np.loadtxt(str(rig2world_path), delimiter=','))
+    # Absolute ticks need more than the 53 bits of a float64 mantissa, so they're read again as integers
+    timestamps = np.atleast_1d(np.loadtxt(str(rig2world_path), delimiter=',', usecols=0, dtype=np.int64))
+    order = np.argsort(timestamps, kind='stable')
+    timestamps = timestamps[order]
+    transforms = data[order, 1:].reshape((-1, 4, 4))
+    return timestamps, transforms
+
+
+def interpolate_keyframe_rotations(keyframe_timestamps, keyframe_quaternions, timestamps):
+    """Slerp between the rotation keyframes, clamped outside of them"""
+    timestamps = np.clip(timestamps, keyframe_timestamps[0], keyframe_timestamps[-1])
+    segment = np.clip(np.searchsorted(keyframe_timestamps, timestamps, side='right') - 1, 0, len(keyframe_timestamps) - 2)
+    q0 = keyframe_quaternions[segment]
+    q1 = keyframe_quaternions[segment + 1]
+    duration = np.maximum(keyframe_timestamps[segment + 1] - keyframe_timestamps[segment], 1)
+    s = ((timestamps - keyframe_timestamps[segment]) / duration)[:, None]
+    delta = quaternion_to_rotation_vector(quaternion_multiply(quaternion_conjugate(q0), q1))
+    return quaternion_multiply(q0, rotation_vector_to_quaternion(delta * s))
+
+
+def estimate_static_biases(gyro_timestamps, gyro, accel_timestamps, accel,
+                           keyframe_timestamps, rig2world_transforms, imu2rig_rotation=None,
+                           window_seconds=0.5, max_gyro_std=0.01, max_accel_std=0.05):
+    """Gyroscope and accelerometer biases from the intervals where the device is at rest
+
+    The recording is cut into windows of window_seconds and those where neither sensor varies more
+    than the given standard deviations (rad/s, m/s^2) count as static. There the gyroscope should read 0
+    and the accelerometer should read gravity, rotated into the IMU frame with the keyframe orientation.
+
+    Returns:
+        dict with gyro and accel biases (3, in the IMU frame) and static_sample_count. Biases are 0
+        when no static window was found.
+    """
+    imu2rig_rotation = np.eye(3) if imu2rig_rotation is None else imu2rig_rotation
+    biases = {'gyro': np.zeros(3), 'accel': np.zeros(3), 'static_sample_count': 0}
+    if len(gyro) < 2:
+        return biases
+
+    sample_period = np.median(np.diff(gyro_timestamps)) / TICKS_PER_SECOND
+    window_size = max(int(round(window_seconds / max(sample_period, 1e-6))), 2)
+    n_windows = len(gyro) // window_size
+    if n_windows == 0:
+        return biases
+
+    # Evaluate the accelerometer on the gyroscope timestamps so both share the windows
+    accel_on_gyro = np.stack([np.interp(gyro_timestamps, accel_timestamps, accel[:, axis]) for axis in range(3)], axis=-1)
+    gyro_windows = gyro[:n_windows * window_size].reshape((n_windows, window_size, 3))
+    accel_windows = accel_on_gyro[:n_windows * window_size].reshape((n_windows, window_size, 3))
+    static = ((gyro_windows.std(axis=1).max(axis=1) < max_gyro_std) &
+              (accel_windows.std(axis=1).max(axis=1) < max_accel_std))
+    if not np.any(static):
+        return biases
+
+    static_timestamps = gyro_timestamps[:n_windows * window_size].reshape((n_windows, window_size))[static].ravel()
+    static_gyro = gyro_windows[static].reshape((-1, 3))
+    static_accel = accel_windows[static].reshape((-1, 3))
+
+    rig2world_quaternions = matrix_to_quaternion(rig2world_transforms[:, :3, :3])
+    rig2world_rotations = quaternion_to_matrix(
+        interpolate_keyframe_rotations(keyframe_timestamps, rig2world_quaternions, static_timestamps))
+    imu2world_rotations = rig2world_rotations @ imu2rig_rotation
+    expected_accel = np.einsum('nji,j->ni', imu2world_rotations, -GRAVITY_WORLD)
+
+    biases['gyro'] = static_gyro.mean(axis=0)
+    biases['accel'] = (static_accel - expected_accel).mean(axis=0)
+    biases['static_sample_count'] = len(static_timestamps)
+    return biases
+
+
+class ImuPreintegrator:
+    """Rig poses between rig2world keyframes from preintegrated gyroscope and accelerometer samples.
+
+    Between two keyframes, the bias corrected samples are integrated in the rig frame of the first one.
+    Orientation follows the gyroscope and the drift left at the second keyframe is spread linearly over the
+    interval. Position follows the accelerometer, with the keyframe velocity chosen so the second keyframe
+    position is met exactly. Queried poses therefore match the keyframes at their timestamps.
+
+    The lever arm between IMU and rig origin is ignored: the translation error is a few millimeters at most for
+    head motion and stays bounded by the keyframes.
+    """
+
+    def __init__(self, keyframe_timestamps, rig2world_transforms, gyro_timestamps, gyro, accel_timestamps, accel,
+                 imu2rig_rotation=None, gyro_bias=None, accel_bias=None):
+        """
+        Args:
+            keyframe_timestamps: (K) sorted absolute ticks, as in the _rig2world.txt files
+            rig2world_transforms: (K x 4 x 4) column vector transforms
+            gyro_timestamps, gyro: (N) absolute ticks and (N x 3) rad/s, as returned by utils.load_imu_samples
+            accel_timestamps, accel: (M) absolute ticks and (M x 3) m/s^2
+            imu2rig_rotation: 3 x 3 rotation from the IMU to the rig frame, identity by default
+            gyro_bias, accel_bias: (3) in the IMU frame, see estimate_static_biases
+        """
+        if len(keyframe_timestamps) < 2:
+            raise ValueError('At least two rig2world keyframes are needed')
+
+        imu2rig_rotation = np.eye(3) if imu2rig_rotation is None else np.asarray(imu2rig_rotation)
+        gyro_bias = np.zeros(3) if gyro_bias is None else gyro_bias
+        accel_bias = np.zeros(3) if accel_bias is None else accel_bias
+
+        self.keyframe_timestamps = np.asarray(keyframe_timestamps, dtype=np.int64)
+        self.keyframe_positions = rig2world_transforms[:, :3, 3]
+        self.keyframe_quaternions = matrix_to_quaternion(rig2world_transforms[:, :3, :3])
+        self.imu_time_range = (max(gyro_timestamps[0], accel_timestamps[0]), min(gyro_timestamps[-1], accel_timestamps[-1]))
+
+        self._build_nodes(np.asarray(gyro_timestamps, dtype=np.int64))
+        node_seconds = self._seconds(self.node_timestamps)
+        angular_velocity = np.stack([np.interp(node_seconds, self._seconds(gyro_timestamps), gyro[:, axis])
+                                     for axis in range(3)], axis=-1)
+        acceleration = np.stack([np.interp(node_seconds, self._seconds(accel_timestamps), accel[:, axis])
+                                 for axis in range(3)], axis=-1)
+        angular_velocity = (angular_velocity - gyro_bias) @ imu2rig_rotation.T
+        acceleration = (acceleration - accel_bias) @ imu2rig_rotation.T
+
+        self._integrate(angular_velocity, acceleration)
+        self._fit_keyframes()
+
+    def _seconds(self, timestamps):
+        # Relative to the first keyframe so float64 keeps sub-microsecond precision
+        return (np.asarray(timestamps, dtype=np.int64) - self.keyframe_timestamps[0]) / TICKS_PER_SECOND
+
+    def _build_nodes(self, sample_timestamps):
+        """Integration nodes of each keyframe interval: its two keyframes and the IMU samples in between.
+        Nodes of all intervals are stored back to back, so they stay sorted by time."""
+        starts = self.keyframe_timestamps[:-1]
+        ends = self.keyframe_timestamps[1:]
+        first_sample = np.searchsorted(sample_timestamps, starts, side='right')
+        end_sample = np.searchsorted(sample_timestamps, ends, side='left')
+        node_counts = np.maximum(end_sample - first_sample, 0) + 2
+
+        self.node_offsets = np.concatenate(([0], np.cumsum(node_counts)))
+        self.node_segments = np.repeat(np.arange(len(starts)), node_counts)
+        local_index = np.arange(self.node_offsets[-1]) - self.node_offsets[self.node_segments]
+        inner_index = np.clip(first_sample[self.node_segments] + local_index - 1, 0, max(len(sample_timestamps) - 1, 0))
+        inner_timestamps = sample_timestamps[inner_index] if len(sample_timestamps) else starts[self.node_segments]
+        is_last = local_index == node_counts[self.node_segments] - 1
+        self.node_timestamps = np.where(local_index == 0, starts[self.node_segments],
+                                        np.where(is_last, ends[self.node_segments], inner_timestamps))
+        self.node_local_index = local_index
+        self.node_counts = node_counts
+
+    def _integrate(self, angular_velocity, acceleration):
+        """Rotation, velocity and position of every node relative to its interval's first keyframe.
+        Runs one step per node index, for all intervals at once."""
+        n_nodes = len(self.node_timestamps)
+        is_last = self.node_local_index == self.node_counts[self.node_segments] - 1
+        next_node = np.minimum(np.arange(n_nodes) + 1, n_nodes - 1)
+
+        # Midpoint rates between a node and the next one, held constant over the step
+        self.step_angular_velocity = np.where(is_last[:, None], 0.0, 0.5 * (angular_velocity + angular_velocity[next_node]))
+        self.step_acceleration = np.where(is_last[:, None], 0.0, 0.5 * (acceleration + acceleration[next_node]))
+        step_seconds = np.where(is_last, 0.0, (self.node_timestamps[next_node] - self.node_timestamps) / TICKS_PER_SECOND)
+
+        self.delta_rotation = np.zeros((n_nodes, 4))
+        self.delta_rotation[:, 3] = 1
+        self.delta_velocity = np.zeros((n_nodes, 3))
+        self.delta_position = np.zeros((n_nodes, 3))
+
+        for local_index in range(int(self.node_counts.max()) - 1):
+            segments = np.nonzero(self.node_counts > local_index + 1)[0]
+            current = self.node_offsets[segments] + local_index
+            following = current + 1
+
+            dt = step_seconds[current][:, None]
+            rotation = quaternion_to_matrix(self.delta_rotation[current])
+            acceleration_rig = np.einsum('nij,nj->ni', rotation, self.step_acceleration[current])
+
+            step_rotation = rotation_vector_to_quaternion(self.step_angular_velocity[current] * dt)
+            self.delta_rotation[following] = quaternion_multiply(self.delta_rotation[current], step_rotation)
+            self.delta_velocity[following] = self.delta_velocity[current] + acceleration_rig * dt
+            self.delta_position[following] = (self.delta_position[current] + self.delta_velocity[current] * dt
+                                              + 0.5 * acceleration_rig * dt * dt)
+
+    def _fit_keyframes(self):
+        """Rotation drift and start velocity of each interval, so the integration lands on the next keyframe"""
+        last_node = self.node_offsets[1:] - 1
+        durations = np.diff(self.keyframe_timestamps) / TICKS_PER_SECOND
+
+        q_start = self.keyframe_quaternions[:-1]
+        q_integrated_end = quaternion_multiply(q_start, self.delta_rotation[last_node])
+        self.rotation_residual = quaternion_to_rotation_vector(
+            quaternion_multiply(quaternion_conjugate(q_integrated_end), self.keyframe_quaternions[1:]))
+
+        start_rotation = quaternion_to_matrix(q_start)
+        integrated_offset = (np.einsum('nij,nj->ni', start_rotation, self.delta_position[last_node])
+                             + 0.5 * GRAVITY_WORLD * durations[:, None] ** 2)
+        displacement = self.keyframe_positions[1:] - self.keyframe_positions[:-1]
+        self.start_velocity = (displacement - integrated_offset) / np.maximum(durations, 1e-9)[:, None]
+
+    def rig2world_at(self, timestamps):
+        """Rig to world transforms at arbitrary absolute ticks.
+
+        Returns:
+            (N x 4 x 4) column vector transforms and an (N) bool array, False where the timestamp is outside of
+            the keyframes or of the IMU recording. Those are clamped to the nearest keyframe interval.
+        """
+        timestamps = np.atleast_1d(np.asarray(timestamps, dtype=np.int64))
+        valid = ((timestamps >= self.keyframe_timestamps[0]) & (timestamps <= self.keyframe_timestamps[-1]) &
+                 (timestamps >= self.imu_time_range[0]) & (timestamps <= self.imu_time_range[1]))
+        timestamps = np.clip(timestamps, self.keyframe_timestamps[0], self.keyframe_timestamps[-1])
+
+        # Last node at or before each query, never the closing node of an interval
+        node = np.searchsorted(self.node_timestamps, timestamps, side='right') - 1
+        segment = np.clip(self.node_segments[np.clip(node, 0, len(self.node_timestamps) - 1)], 0, len(self.node_counts) - 1)
+        node = np.clip(node, self.node_offsets[segment], self.node_offsets[segment + 1] - 2)
+
+        # Partial step from the node to the query
+        dt = ((timestamps - self.node_timestamps[node]) / TICKS_PER_SECOND)[:, None]
+        node_rotation = quaternion_to_matrix(self.delta_rotation[node])
+        acceleration_rig = np.einsum('nij,nj->ni', node_rotation, self.step_acceleration[node])
+        delta_rotation = quaternion_multiply(self.delta_rotation[node],
+                                             rotation_vector_to_quaternion(self.step_angular_velocity[node] * dt))
+        delta_position = self.delta_position[node] + self.delta_velocity[node] * dt + 0.5 * acceleration_rig * dt * dt
+
+        start = self.keyframe_timestamps[segment]
+        elapsed = ((timestamps - start) / TICKS_PER_SECOND)[:, None]
+        fraction = elapsed / np.maximum(np.diff(self.keyframe_timestamps)[segment] / TICKS_PER_SECOND, 1e-9)[:, None]
+
+        rotation = quaternion_multiply(quaternion_multiply(self.keyframe_quaternions[segment], delta_rotation),
+                                       rotation_vector_to_quaternion(self.rotation_residual[segment] * fraction))
+        position = (self.keyframe_positions[segment] + self.start_velocity[segment] * elapsed
+                    + 0.5 * GRAVITY_WORLD * elapsed ** 2
+                    + np.einsum('nij,nj->ni', quaternion_to_matrix(self.keyframe_quaternions[segment]), delta_position))
+
+        transforms = np.zeros((len(timestamps), 4, 4))
+        transforms[:, :3, :3] = quaternion_to_matrix(rotation)
+        transforms[:, :3, 3] = position
+        transforms[:, 3, 3] = 1
+        return transforms, valid
+
+
+def load_preintegrator(folder, sensor_name, imu2rig_rotation=None):
+    """ImuPreintegrator over a capture's <sensor_name>_rig2world.txt and imu_gyro.bin / imu_accel.bin,
+    with biases estimated from its static intervals. Returns None if a file is missing."""
+    folder = Path(folder)
+    rig2world_path = folder / f'{sensor_name}_rig2world.txt'
+    gyro_path = folder / 'imu_gyro.bin'
+    accel_path = folder / 'imu_accel.bin'
+    if not (rig2world_path.exists() and gyro_path.exists() and accel_path.exists()):
+        return None
+
+    keyframe_timestamps, rig2world_transforms = load_rig2world_keyframes(rig2world_path)
+    gyro = load_imu_samples(gyro_path)
+    accel = load_imu_samples(accel_path)
+    biases = estimate_static_biases(gyro['timestamps'], gyro['values'], accel['timestamps'], accel['values'],
+                                    keyframe_timestamps, rig2world_transforms, imu2rig_rotation)
+    print(f"Estimated biases from {biases['static_sample_count']} static samples: "
+          f"gyro {biases['gyro']} rad/s, accel {biases['accel']} m/s^2")
+
+    return ImuPreintegrator(keyframe_timestamps, rig2world_transforms,
+                            gyro['timestamps'], gyro['values'], accel['timestamps'], accel['values'],
+                            imu2rig_rotation, biases['gyro'], biases['accel'])
+
+
+def densify_rig2world(folder, sensor_name, rate):
+    """Save <sensor_name>_rig2world_<rate>hz.txt, same format as the recorded rig2world file"""
+    preintegrator = load_preintegrator(folder, sensor_name)
+    if preintegrator is None:
+        print(f"Missing rig2world or IMU files for {sensor_name} in {folder}")
+        return
+
+    step = int(TICKS_PER_SECOND / rate)
+    timestamps = np.arange(preintegrator.keyframe_timestamps[0], preintegrator.keyframe_timestamps[-1] + 1, step)
+    transforms, valid = preintegrator.rig2world_at(timestamps)
+
+    output_path = Path(folder) / f'{sensor_name}_rig2world_{rate:g}hz.txt'
+    print(f"Saving {np.count_nonzero(valid)} poses to {output_path}")
+    with open(output_path, 'w') as f:
+        for timestamp, transform in zip(timestamps[valid], transforms[valid]):
+            f.write(f'{timestamp},' + ','.join(f'{v:g}' for v in transform.ravel()) + '\n')
+
+
+class SyntheticTrajectory:
+    """Head-like motion with closed form poses: still for the first still_seconds, then sways of a few
+    centimeters and turns of up to 40 degrees, eased in so velocity and acceleration start at 0"""
+
+    def __init__(self, still_seconds=2.0):
+        self.still_seconds = still_seconds
+
+    def _ease(self, seconds):
+        # 0 while still, then rises to 1 over a second with zero first and second derivatives at the start
+        x = np.clip(seconds - self.still_seconds, 0.0, 1.0)
+        return x ** 3 * (10 - 15 * x + 6 * x ** 2)
+
+    def position(self, seconds):
+        seconds = np.asarray(seconds, dtype=np.float64)
+        ease = self._ease(seconds)[..., None]
+        sway = np.stack([0.05 * np.sin(1.3 * seconds), 0.02 * np.sin(2.1 * seconds + 0.5),
+                         0.04 * np.sin(0.9 * seconds + 1.0)], axis=-1)
+        return np.array([0.3, 1.6, -0.2]) + ease * sway
+
+    def rotation(self, seconds):
+        """(..., 4) x, y, z, w rig to world quaternions"""
+        seconds = np.asarray(seconds, dtype=np.float64)
+        ease = self._ease(seconds)[..., None]
+        turn = np.stack([0.2 * np.sin(1.7 * seconds), 0.7 * np.sin(0.8 * seconds + 0.3),
+                         0.1 * np.sin(2.3 * seconds)], axis=-1)
+        base = rotation_vector_to_quaternion(np.array([0.05, 0.4, 0.0]))
+        return quaternion_multiply(base, rotation_vector_to_quaternion(ease * turn))
+
+    def imu_rates(self, seconds, step=1e-4):
+        """Angular velocity (rad/s) and specific force (m/s^2), in the rig frame, by central differences"""
+        seconds = np.asarray(seconds, dtype=np.float64)
+        q_before, q_after = self.rotation(seconds - step), self.rotation(seconds + step)
+        angular_velocity = quaternion_to_rotation_vector(
+            quaternion_multiply(quaternion_conjugate(q_before), q_after)) / (2 * step)
+        acceleration = (self.position(seconds + step) - 2 * self.position(seconds) + self.position(seconds - step)) / step ** 2
+        world2rig = np.swapaxes(quaternion_to_matrix(self.rotation(seconds)), -1, -2)
+        specific_force = np.einsum('nij,nj->ni', world2rig, acceleration - GRAVITY_WORLD)
+        return angular_velocity, specific_force
+
+    def rig2world(self, seconds):
+        transforms = np.zeros(np.shape(seconds) + (4, 4))
+        transforms[..., :3, :3] = quaternion_to_matrix(self.rotation(seconds))
+        transforms[..., :3, 3] = self.position(seconds)
+        transforms[..., 3, 3] = 1
+        return transforms
+
+
+def save_synthetic_imu(path, sensor, soc_ticks, values, soc_ticks_to_absolute_ticks):
+    """Write samples in the layout of ImuStreamRecorder, timestamped with a clock domain that doesn't drift"""
+    samples = np.zeros(len(soc_ticks), dtype=IMU_SAMPLE_DTYPE)
+    samples['soc_ticks'] = soc_ticks
+    samples['vinyl_hup_ticks'] = soc_ticks * 100
+    samples['values'] = values
+    samples['timestamp'] = soc_ticks + soc_ticks_to_absolute_ticks
+    with open(path, 'wb') as f:
+        f.write(IMU_FILE_MAGIC)
+        f.write(np.array([IMU_FILE_VERSION, IMU_SENSOR_NAMES.index(sensor)], dtype='<u4').tobytes())
+        f.write(np.array([0], dtype='<u8').tobytes())
+        f.write(samples.tobytes())
+
+
+def check_synthetic_trajectory(seconds=20.0, keyframe_rate=5.0, seed=0, max_rotation_error_deg=0.05,
+                               max_position_error_mm=0.5):
+    """Write a recording of SyntheticTrajectory, as the app saves it, and densify it through load_preintegrator
+
+    The IMU is rotated against the rig and samples at device like rates (gyroscope 1 kHz, accelerometer 500 Hz,
+    with jitter), with constant biases and white noise. Keyframes come at keyframe_rate, 5 Hz like Long Throw.
+    The poses at 200 Hz are compared with the trajectory, and with slerp and linear interpolation of the keyframes.
+
+    Returns:
+        True when every pose is valid, the keyframes are met and the errors stay below the maxima
+    """
+    rng = np.random.default_rng(seed)
+    trajectory = SyntheticTrajectory()
+    start_ticks = 132_000_000_000_000_007     # Not a multiple of 16, which float64 parsing would round to
+    soc_ticks_to_absolute_ticks = start_ticks - 3_600 * int(TICKS_PER_SECOND)
+    imu2rig_rotation = quaternion_to_matrix(rotation_vector_to_quaternion(np.array([0.1, -1.2, 3.0])))
+    gyro_bias = np.array([0.004, -0.007, 0.002])
+    accel_bias = np.array([0.03, 0.05, -0.04])
+
+    def imu_ticks(rate):
+        ticks = np.arange(-0.05, seconds + 0.05, 1 / rate) * TICKS_PER_SECOND
+        return np.int64(start_ticks) + np.round(ticks + rng.uniform(-0.1, 0.1, len(ticks)) / rate * TICKS_PER_SECOND).astype(np.int64)
+
+    with tempfile.TemporaryDirectory() as folder:
+        folder = Path(folder)
+        for sensor, rate, bias, noise in (('imu_gyro', 1000.0, gyro_bias, 0.002), ('imu_accel', 500.0, accel_bias, 0.02)):
+            ticks = imu_ticks(rate)
+            angular_velocity, specific_force = trajectory.imu_rates((ticks - start_ticks) / TICKS_PER_SECOND)
+            values = (angular_velocity if sensor == 'imu_gyro' else specific_force) @ imu2rig_rotation
+            values = values + bias + rng.normal(0, noise, values.shape)
+            save_synthetic_imu(folder / f'{sensor}.bin', sensor, ticks - soc_ticks_to_absolute_ticks, values,
+                               soc_ticks_to_absolute_ticks)
+
+        keyframe_ticks = start_ticks + np.arange(0, seconds * TICKS_PER_SECOND + 1, TICKS_PER_SECOND / keyframe_rate).astype(np.int64)
+        keyframes = trajectory.rig2world((keyframe_ticks - start_ticks) / TICKS_PER_SECOND)
+        with open(folder / 'Synthetic_rig2world.txt', 'w') as f:
+            for timestamp, transform in zip(keyframe_ticks, keyframes):
+                f.write(f'{timestamp},' + ','.join(f'{v:.17g}' for v in transform.ravel()) + '\n')
+
+        preintegrator = load_preintegrator(folder, 'Synthetic', imu2rig_rotation)
+
+    query_ticks = np.arange(keyframe_ticks[0], keyframe_ticks[-1] + 1, int(TICKS_PER_SECOND / 200))
+    query_seconds = (query_ticks - start_ticks) / TICKS_PER_SECOND
+    expected = trajectory.rig2world(query_seconds)
+    transforms, valid = preintegrator.rig2world_at(query_ticks)
+
+    def errors(rotations, positions):
+        relative = np.swapaxes(expected[:, :3, :3], -1, -2) @ rotations
+        cosine = np.clip((np.trace(relative, axis1=-2, axis2=-1) - 1) / 2, -1, 1)
+        return np.degrees(np.arccos(cosine)), np.linalg.norm(positions - expected[:, :3, 3], axis=-1) * 1e3
+
+    rotation_errors, position_errors = errors(transforms[:, :3, :3], transforms[:, :3, 3])
+    keyframe_quaternions = matrix_to_quaternion(keyframes[:, :3, :3])
+    slerp = quaternion_to_matrix(interpolate_keyframe_rotations(keyframe_ticks, keyframe_quaternions, query_ticks))
+    lerp = np.stack([np.interp(query_ticks, keyframe_ticks, keyframes[:, axis, 3]) for axis in range(3)], axis=-1)
+    interpolated_rotation_errors, interpolated_position_errors = errors(slerp, lerp)
+
+    at_keyframes = np.isin(query_ticks, keyframe_ticks)
+    keyframe_error = np.abs(transforms[at_keyframes] - expected[at_keyframes]).max()
+
+    print(f'{seconds:g} s at {keyframe_rate:g} Hz keyframes, {len(query_ticks)} poses, {np.count_nonzero(~valid)} invalid')
+    print(f'  IMU:          rotation max {rotation_errors.max():.3f} deg, RMS {np.sqrt(np.mean(rotation_errors ** 2)):.3f} deg, '
+          f'position max {position_errors.max():.2f} mm, RMS {np.sqrt(np.mean(position_errors ** 2)):.2f} mm')
+    print(f'  interpolated: rotation max {interpolated_rotation_errors.max():.3f} deg, '
+          f'RMS {np.sqrt(np.mean(interpolated_rotation_errors ** 2)):.3f} deg, '
+          f'position max {interpolated_position_errors.max():.2f} mm, '
+          f'RMS {np.sqrt(np.mean(interpolated_position_errors ** 2)):.2f} mm')
+    print(f'  keyframes met to {keyframe_error:.1e}')
+    return (np.all(valid) and keyframe_error < 1e-6 and rotation_errors.max() < max_rotation_error_deg
+            and position_errors.max() < max_position_error_mm)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Interpolate rig poses between rig2world samples with the IMU.')
+    parser.add_argument("--recording_path",
+                        help="Path to recording folder")
+    parser.add_argument("--sensor_name", default="Depth Long Throw",
+                        help="Sensor whose rig2world file gives the keyframes")
+    parser.add_argument("--rate", type=float, default=200.0,
+                        help="Output pose rate in Hz")
+    parser.add_argument("--check_synthetic", action='store_true',
+                        help="Check the interpolation on a synthetic recording instead, and exit with 1 if it fails")
+
+    args = parser.parse_args()
+    if args.check_synthetic:
+        raise SystemExit(0 if check_synthetic_trajectory() else 1)
+    if args.recording_path is None:
+        parser.error('--recording_path is required')
+
+    densify_rig2world(Path(args.recording_path), args.sensor_name, args.rate)
@@ -0,0 +1,157 @@
+"""
+ Copyright (c) Microsoft. All rights reserved.
+ This code is licensed under the MIT License (MIT).
+ THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+ ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+ IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+ PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+"""
+import argparse
+import uuid
+from pathlib import Path
+
+import numpy as np
+import open3d as o3d
+
+# See SurfaceMeshStream.h for the file layout
+SURFACES_FILE_MAGIC = b'HLSURFMS'
+SURFACES_FILE_VERSION = 1
+SNORM16_MAX = 2.0 ** 15
+SNORM8_MAX = 2.0 ** 7
+
+record_header_dtype = np.dtype([('id', 'V16'),
+                                ('update_time', '<i8'),
+                                ('transform', '<f4', (16,)),
+                                ('scale', '<f4', (3,)),
+                                ('vertex_count', '<u4'),
+                                ('index_count', '<u4')])
+
+
+def load_surface_records(surfaces_path):
+    """Read every record of a _surfaces.bin file, in the order they were written
+
+    Returns:
+        list of dict with id, update_time, transform (4x4, column vectors: surface to world),
+        positions (Nx3 float, surface space), normals (Nx3 float, surface space), triangles (Mx3 int)
+    """
+    with open(surfaces_path, 'rb') as f:
+        data = f.read()
+
+    if data[:8] != SURFACES_FILE_MAGIC:
+        raise ValueError(f'{surfaces_path} is not a surfaces file')
+    version = np.frombuffer(data, dtype='<u4', count=1, offset=8)[0]
+    if version != SURFACES_FILE_VERSION:
+        raise ValueError(f'Unsupported surfaces file version {version}')
+
+    records = []
+    offset = 16
+    while offset + record_header_dtype.itemsize <= len(data):
+        header = np.frombuffer(data, dtype=record_header_dtype, count=1, offset=offset)[0]
+        offset += record_header_dtype.itemsize
+
+        vertex_count = int(header['vertex_count'])
+        index_count = int(header['index_count'])
+        record_size = vertex_count * 4 * 2 + vertex_count * 4 + index_count * 2
+        if offset + record_size > len(data):
+            # Recording was interrupted mid-record
+            break
+
+        positions = np.frombuffer(data, dtype='<i2', count=vertex_count * 4, offset=offset)
+        offset += vertex_count * 4 * 2
+        normals = np.frombuffer(data, dtype='i1', count=vertex_count * 4, offset=offset)
+        offset += vertex_count * 4
+        indices = np.frombuffer(data, dtype='<u2', count=index_count, offset=offset)
+        offset += index_count * 2
+
+        positions = positions.reshape((-1, 4))[:, :3] / SNORM16_MAX * header['scale']
+        normals = normals.reshape((-1, 4))[:, :3] / SNORM8_MAX
+
+        records.append({
+            'id': uuid.UUID(bytes_le=header['id'].tobytes()),
+            'update_time': int(header['update_time']),
+            # Stored row major for row vectors, transpose to match the other transforms in the converter
+            'transform': header['transform'].reshape((4, 4)).T.astype(np.float64),
+            'positions': positions.astype(np.float64),
+            'normals': normals.astype(np.float64),
+            'triangles': indices.reshape((-1, 3)).astype(np.int32)})
+
+    return records
+
+
+def latest_surfaces(records):
+    """Keep only the last version of each surface"""
+    surfaces = {}
+    for record in records:
+        surfaces[record['id']] = record
+    return list(surfaces.values())
+
+
+def surface_to_world_mesh(surface):
+    transform = surface['transform']
+    homog_positions = np.hstack((surface['positions'], np.ones((len(surface['positions']), 1))))
+    world_positions = (transform @ homog_positions.T).T[:, :3]
+    world_normals = (transform[:3, :3] @ surface['normals'].T).T
+    world_normals /= np.maximum(np.linalg.norm(world_normals, axis=1, keepdims=True), 1e-12)
+
+    mesh = o3d.geometry.TriangleMesh()
+    mesh.vertices = o3d.utility.Vector3dVector(world_positions)
+    mesh.vertex_normals = o3d.utility.Vector3dVector(world_normals)
+    mesh.triangles = o3d.utility.Vector3iVector(surface['triangles'])
+    return mesh
+
+
+class SurfaceMeshes:
+    """World space spatial mapping meshes of a recording, with a ray casting scene for offline queries
+    (gaze hits, occlusion tests, floor height...)"""
+
+    def __init__(self, surfaces_path):
+        self.surfaces = latest_surfaces(load_surface_records(surfaces_path))
+        self.meshes = [surface_to_world_mesh(surface) for surface in self.surfaces]
+
+        self.scene = o3d.t.geometry.RaycastingScene()
+        self.geometry_ids = []
+        for mesh in self.meshes:
+            if len(mesh.triangles) == 0:
+                continue
+            self.geometry_ids.append(
+                self.scene.add_triangles(o3d.t.geometry.TriangleMesh.from_legacy(mesh)))
+
+    def merged_mesh(self):
+        merged = o3d.geometry.TriangleMesh()
+        for mesh in self.meshes:
+            merged += mesh
+        return merged
+
+    def cast_rays(self, origins, directions):
+        """Returns hit distance (inf on miss) and hit normal for each ray"""
+        origins = np.asarray(origins, dtype=np.float32).reshape((-1, 3))
+        directions = np.asarray(directions, dtype=np.float32).reshape((-1, 3))
+        directions = directions / np.linalg.norm(directions, axis=1, keepdims=True)
+        rays = o3d.core.Tensor(np.hstack((origins, directions)), dtype=o3d.core.Dtype.Float32)
+        result = self.scene.cast_rays(rays)
+        return result['t_hit'].numpy(), result['primitive_normals'].numpy()
+
+    def closest_points(self, points):
+        """Returns closest point on the surfaces and its distance for each query point"""
+        points = o3d.core.Tensor(np.asarray(points, dtype=np.float32).reshape((-1, 3)), dtype=o3d.core.Dtype.Float32)
+        closest = self.scene.compute_closest_points(points)['points'].numpy()
+        distances = np.linalg.norm(closest - points.numpy(), axis=1)
+        return closest, distances
+
+
+def save_surfaces(folder):
+    for surfaces_path in sorted(folder.glob('*_surfaces.bin')):
+        surfaces = SurfaceMeshes(surfaces_path)
+        output_path = surfaces_path.with_suffix('.ply')
+        print(f"Saving {len(surfaces.meshes)} surfaces to {output_path}")
+        o3d.io.write_triangle_mesh(str(output_path), surfaces.merged_mesh())
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Save spatial mapping surfaces.')
+    parser.add_argument("--recording_path", required=True,
+                        help="Path to recording folder")
+
+    args = parser.parse_args()
+
+    save_surfaces(Path(args.recording_path))
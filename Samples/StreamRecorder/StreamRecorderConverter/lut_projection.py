@@ -0,0 +1,335 @@
+"""
+ Copyright (c) Microsoft. All rights reserved.
+ This code is licensed under the MIT License (MIT).
+ THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+ ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+ IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+ PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+"""
+import argparse
+import time
+from pathlib import Path
+
+import numpy as np
+
+from utils import camera_model_to_lut, load_sensor_lut
+
+# The _lut.bin files don't store their resolution, but each Research Mode camera has its own pixel count
+LUT_RESOLUTIONS = {320 * 288: (320, 288),   # Depth Long Throw
+                   512 * 512: (512, 512),   # Depth AHaT
+                   640 * 480: (640, 480)}   # VLC
+
+
+def resolution_from_lut(lut):
+    if len(lut) not in LUT_RESOLUTIONS:
+        raise ValueError(f'No Research Mode camera has {len(lut)} pixels')
+    return LUT_RESOLUTIONS[len(lut)]
+
+
+def angular_coordinates(rays):
+    """(N x 2) angle from the optical axis times the unit direction of (x, y): smooth across a fisheye image,
+    and close to proportional to the pixel coordinates"""
+    r = np.hypot(rays[:, 0], rays[:, 1])
+    scale = np.arctan2(r, rays[:, 2]) / np.maximum(r, 1e-30)
+    return np.stack((rays[:, 0] * scale, rays[:, 1] * scale), axis=1)
+
+
+def shifted(values, shift, axis):
+    """values moved by shift entries along axis, NaN where nothing moved in (np.roll would wrap around)"""
+    result = np.full_like(values, np.nan)
+    source = [slice(None)] * values.ndim
+    target = [slice(None)] * values.ndim
+    source[axis] = slice(None, -shift) if shift > 0 else slice(-shift, None)
+    target[axis] = slice(shift, None) if shift > 0 else slice(None, shift)
+    result[tuple(target)] = values[tuple(source)]
+    return result
+
+
+def extrapolate_missing(values, passes):
+    """Fills the NaN entries of a rows x columns x 2 array next to known ones, pass after pass, by linear
+    extrapolation from the two entries before them in each direction"""
+    values = values.copy()
+    for _ in range(passes):
+        missing = np.isnan(values[:, :, 0])
+        total = np.zeros_like(values)
+        count = np.zeros(values.shape[:2] + (1,))
+        for axis in (0, 1):
+            for shift in (1, -1):
+                line = 2 * shifted(values, shift, axis) - shifted(values, 2 * shift, axis)
+                usable = missing & ~np.isnan(line[:, :, 0])
+                total[usable] += line[usable]
+                count[usable] += 1
+        filled = count[:, :, 0] > 0
+        values[filled] = total[filled] / count[filled]
+    return values
+
+
+class LutProjector:
+    """Camera space to image mapping of a Research Mode camera, from its recorded unprojection LUT
+
+    The offline counterpart of MapCameraSpaceToImagePoint. The image point of a ray is where the bilinear
+    interpolation of the LUT gives that ray, found by Newton steps. They start from a grid over the angular
+    coordinates of the rays, which holds the image point of each node and is built once from the LUT. Pixel
+    (0, 0) is the corner of the image; the LUT samples sit at the pixel centers.
+
+    Both interpolations go through tables of bilinear coefficients, one row per cell, so a point costs one
+    gather from each.
+    """
+
+    def __init__(self, lut, width, height, grid_step_pixels=1.0, newton_iterations=1):
+        """
+        Args:
+            lut: (width * height) x 3 unit rays, as load_lut returns them. Rays with z <= 0 are the pixels the
+                sensor couldn't map.
+            grid_step_pixels: spacing of the angular grid, in pixels at the image center
+            newton_iterations: Newton steps per projected point, from the grid's estimate
+        """
+        self.width = width
+        self.height = height
+        self.newton_iterations = newton_iterations
+
+        lut = np.asarray(lut, dtype=np.float64).reshape((height, width, 3))
+        self.valid = lut[:, :, 2] > 0
+        if not self.valid.any():
+            raise ValueError('The LUT has no mapped pixel')
+        angles = angular_coordinates(lut.reshape((-1, 3))).reshape((height, width, 2))
+        angles[~self.valid] = np.nan
+
+        # Angular size of a pixel at the center of the image, where the grid is no coarser than asked
+        cx, cy = width // 2, height // 2
+        pitch = np.nanmedian(np.abs(np.diff(angles[cy - 2:cy + 3, cx - 2:cx + 3, 0], axis=1)))
+        self.grid_step = grid_step_pixels * pitch
+        self.tolerance = 1e-6 * pitch
+
+        # One node of margin on each side, for the rays at the edge of the field of view
+        mapped_angles = angles[self.valid]
+        self.grid_origin = mapped_angles.min(axis=0) - self.grid_step
+        self.grid_size = np.ceil((mapped_angles.max(axis=0) - self.grid_origin) / self.grid_step).astype(int) + 2
+
+        # The cells at the edge of the mapped pixels also have unmapped corners: those are extrapolated, so the
+        # whole area of every mapped pixel can be reached
+        self.lut_cells = self._bilinear_table(extrapolate_missing(angles, 2))
+
+        # Each node starts at the mapped pixel closest to it, nodes without one at the start of a neighbour
+        v, u = np.nonzero(self.valid)
+        nodes = np.rint((mapped_angles - self.grid_origin) / self.grid_step).astype(int)
+        guess = np.full((self.grid_size[1], self.grid_size[0], 2), np.nan)
+        guess[nodes[:, 1], nodes[:, 0]] = np.stack((u + 0.5, v + 0.5), axis=1)
+        for _ in range(int(np.ceil(1.0 / grid_step_pixels)) + 2):
+            for shift, axis in ((1, 0), (-1, 0), (1, 1), (-1, 1)):
+                neighbour = shifted(guess, shift, axis)
+                fill = np.isnan(guess[:, :, 0]) & ~np.isnan(neighbour[:, :, 0])
+                guess[fill] = neighbour[fill]
+
+        # Then moves to the point the LUT maps to the node's ray. Nodes outside the field of view don't converge
+        # and are dropped.
+        node_u, node_v = np.meshgrid(np.arange(self.grid_size[0]), np.arange(self.grid_size[1]))
+        targets = self.grid_origin + self.grid_step * np.stack((node_u.ravel(), node_v.ravel()), axis=1)
+        with np.errstate(invalid='ignore', divide='ignore'):
+            points, error = self._refine(targets, guess.reshape((-1, 2)), 10)
+        points[~(error < self.tolerance)] = np.nan
+
+        # Rays next to the edge of the field of view fall in cells with dropped nodes, which only need a start
+        points = extrapolate_missing(points.reshape((self.grid_size[1], self.grid_size[0], 2)), 2)
+        self.grid_cells = self._bilinear_table(points)
+
+    @staticmethod
+    def _bilinear_table(values):
+        """(rows - 1) * (columns - 1) x 8 coefficients of the bilinear interpolation of a rows x columns x 2
+        array in each cell: value = c0 + a c1 + b c2 + a b c3, two columns per coefficient"""
+        s00 = values[:-1, :-1]
+        s10 = values[:-1, 1:]
+        s01 = values[1:, :-1]
+        s11 = values[1:, 1:]
+        table = np.concatenate((s00, s10 - s00, s01 - s00, s11 - s10 - s01 + s00), axis=2)
+        return np.ascontiguousarray(table.reshape((-1, 8)))
+
+    def _interpolate(self, points):
+        """Angular coordinates at image points and their derivatives along u and v, NaN away from mapped pixels"""
+        px = points[:, 0] - 0.5
+        py = points[:, 1] - 0.5
+
+        # Outside the pixel centers, the border cells are extrapolated, so that Newton steps can cross the edges
+        # of the image. NaN points, from steps that left the mapped pixels, read the first cell and stay NaN.
+        x0 = np.clip(np.floor(px).astype(int), 0, self.width - 2)
+        y0 = np.clip(np.floor(py).astype(int), 0, self.height - 2)
+        a = (px - x0)[:, np.newaxis]
+        b = (py - y0)[:, np.newaxis]
+
+        c = np.take(self.lut_cells, y0 * (self.width - 1) + x0, axis=0)
+        d_du = c[:, 2:4] + b * c[:, 6:8]
+        d_dv = c[:, 4:6] + a * c[:, 6:8]
+        angles = c[:, 0:2] + a * c[:, 2:4] + b * d_dv
+        return angles, d_du, d_dv
+
+    def _refine(self, targets, points, iterations):
+        """Newton steps on the interpolated LUT towards the target angular coordinates
+
+        Returns:
+            the image points and their remaining error
+        """
+        points = points.copy()
+        for _ in range(iterations):
+            angles, d_du, d_dv = self._interpolate(points)
+            error = angles - targets
+            det = d_du[:, 0] * d_dv[:, 1] - d_dv[:, 0] * d_du[:, 1]
+            points[:, 0] -= (d_dv[:, 1] * error[:, 0] - d_dv[:, 0] * error[:, 1]) / det
+            points[:, 1] -= (d_du[:, 0] * error[:, 1] - d_du[:, 1] * error[:, 0]) / det
+
+        angles, _, _ = self._interpolate(points)
+        return points, np.abs(angles - targets).max(axis=1)
+
+    def project(self, points, chunk_size=1 << 16):
+        """Image points of (N x 3) camera space points, (N x 2) with NaN for the points the camera doesn't see
+
+        The points need not be normalized; only their direction counts.
+        """
+        points = np.asarray(points, dtype=np.float64).reshape((-1, 3))
+        image_points = np.empty((len(points), 2))
+        with np.errstate(invalid='ignore', divide='ignore'):
+            for start in range(0, len(points), chunk_size):
+                image_points[start:start + chunk_size] = self._project_chunk(points[start:start + chunk_size])
+        return image_points
+
+    def project_world(self, points, rig2world, rig2cam):
+        """Image points of (N x 3) world points, with the transforms of save_pclouds: rig2world from the
+        _rig2world.txt file of the frame and rig2cam from the _extrinsics.txt file"""
+        world2cam = rig2cam @ np.linalg.inv(rig2world)
+        points = np.asarray(points, dtype=np.float64).reshape((-1, 3))
+        return self.project(points @ world2cam[:3, :3].T + world2cam[:3, 3])
+
+    def _project_chunk(self, points):
+        targets = angular_coordinates(points)
+
+        # Estimate from the grid. Rays outside it, or NaN, read its first cell and get a NaN estimate.
+        g = (targets - self.grid_origin) / self.grid_step
+        g0 = np.floor(g).astype(int)
+        outside = np.any((g0 < 0) | (g0 >= self.grid_size - 1), axis=1)
+        g0[outside] = 0
+        f = g - g0
+        c = np.take(self.grid_cells, g0[:, 1] * (self.grid_size[0] - 1) + g0[:, 0], axis=0)
+        fu = f[:, 0:1]
+        fv = f[:, 1:2]
+        guess = c[:, 0:2] + fu * c[:, 2:4] + fv * (c[:, 4:6] + fu * c[:, 6:8])
+        guess[outside] = np.nan
+
+        # The few points the first steps leave short, next to the edges, get more
+        image_points, error = self._refine(targets, guess, self.newton_iterations)
+        retry = ~(error < self.tolerance) & ~outside
+        if retry.any():
+            image_points[retry], error[retry] = self._refine(targets[retry], image_points[retry], 5)
+
+        # The camera sees the point if the LUT maps the image point back to its ray, inside a mapped pixel
+        u = image_points[:, 0]
+        v = image_points[:, 1]
+        seen = (error < self.tolerance) & (u >= 0) & (u <= self.width) & (v >= 0) & (v <= self.height)
+        pixels = np.minimum(v.astype(int), self.height - 1) * self.width + np.minimum(u.astype(int), self.width - 1)
+        seen[seen] &= self.valid.ravel()[pixels[seen]]
+        image_points[~seen] = np.nan
+        return image_points
+
+
+def load_lut_projector(folder, sensor_name, calibration_store=None, **kwargs):
+    """LutProjector of a sensor in a capture folder, with its LUT found by utils.load_sensor_lut"""
+    lut = load_sensor_lut(folder, sensor_name, calibration_store)
+    width, height = resolution_from_lut(lut)
+    return LutProjector(lut, width, height, **kwargs)
+
+
+def check_lut_projector(sensor_name, lut, rng):
+    """Accuracy and speed of the projector against its LUT: the rays of every mapped pixel must come back to
+    the pixel centers, and the rays interpolated at random points inside the mapped cells to those points
+
+    Returns:
+        the maximum error in pixels
+    """
+    width, height = resolution_from_lut(lut)
+    start = time.perf_counter()
+    projector = LutProjector(lut, width, height)
+    build_seconds = time.perf_counter() - start
+
+    valid = lut[:, 2] > 0
+    v, u = np.divmod(np.nonzero(valid)[0], width)
+    centers = np.stack((u + 0.5, v + 0.5), axis=1)
+
+    # Random points in the cells between four mapped pixel centers, with their rays from the LUT interpolation
+    cells = projector.valid[:-1, :-1] & projector.valid[1:, :-1] & projector.valid[:-1, 1:] & projector.valid[1:, 1:]
+    cell_v, cell_u = np.nonzero(cells)
+    picks = rng.integers(0, len(cell_u), size=len(centers))
+    subpixel = np.stack((cell_u[picks], cell_v[picks]), axis=1) + 0.5 + rng.random((len(picks), 2))
+    angles, _, _ = projector._interpolate(subpixel)
+    theta = np.linalg.norm(angles, axis=1)
+    direction = angles / np.maximum(theta, 1e-30)[:, np.newaxis]
+    subpixel_rays = np.column_stack((direction * np.sin(theta)[:, np.newaxis], np.cos(theta)))
+
+    # Random depths: only the directions should count
+    rays = np.vstack((lut[valid], subpixel_rays)) * rng.uniform(0.1, 10.0, size=(2 * len(centers), 1))
+    expected = np.vstack((centers, subpixel))
+
+    start = time.perf_counter()
+    projected = projector.project(rays)
+    project_seconds = time.perf_counter() - start
+
+    # Behind the camera, nothing can be seen
+    behind = rays * np.array([1, 1, -1])
+    false_hits = np.count_nonzero(~np.isnan(projector.project(behind)[:, 0]))
+
+    missed = np.isnan(projected[:, 0])
+    errors = np.append(np.linalg.norm(projected[~missed] - expected[~missed], axis=1), 0)
+    max_error = errors.max() if missed.sum() == 0 and false_hits == 0 else np.inf
+    print('{}: {}x{}, grid {}x{} built in {:.2f}s, {} points at {:.2f} Mpoints/s, '
+          'max error {:.2e} px, RMS {:.2e} px, {} missed, {} seen behind the camera'.format(
+              sensor_name, width, height, projector.grid_size[0], projector.grid_size[1], build_seconds,
+              len(rays), len(rays) / project_seconds / 1e6, errors.max(), np.sqrt(np.mean(errors ** 2)), missed.sum(),
+              false_hits))
+    return max_error
+
+
+# Kannala-Brandt models close to the Research Mode cameras, for checks without a capture. The Long Throw one, like
+# the device, can't map the image corners.
+SYNTHETIC_CAMERAS = {
+    'VLC LF': dict(width=640, height=480, fx=366.0, fy=365.0, cx=321.3, cy=238.7,
+                   k=[0.021, -0.011, 0.0023, -0.0002], max_theta=1.25),
+    'Depth AHaT': dict(width=512, height=512, fx=216.0, fy=215.5, cx=257.2, cy=254.8,
+                       k=[0.044, -0.018, 0.0031, 0.0], max_theta=1.3),
+    'Depth Long Throw': dict(width=320, height=288, fx=182.0, fy=181.5, cx=161.4, cy=143.2,
+                             k=[0.052, -0.021, 0.0042, 0.0], max_theta=0.95)}
+
+
+def synthetic_lut(sensor_name, rng, residual_pixels=0.3, grid_size=9):
+    """LUT of one of SYNTHETIC_CAMERAS, through utils.camera_model_to_lut, with a grid of random pixel
+    corrections of up to residual_pixels on top of the polynomial like the models the recorder fits"""
+    model = dict(SYNTHETIC_CAMERAS[sensor_name])
+    model['k'] = np.array(model['k'])
+    model['residuals'] = rng.uniform(-residual_pixels, residual_pixels, size=(grid_size, grid_size, 2))
+    return camera_model_to_lut(model)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Check the LUT projection of every Research Mode camera of a capture.')
+    parser.add_argument("--recording_path",
+                        help="Path to recording folder")
+    parser.add_argument("--check_synthetic", action='store_true',
+                        help="Check the projection against synthetic LUTs of the three camera types instead of a capture")
+    parser.add_argument("--max_error", type=float, default=1e-3,
+                        help="Largest error accepted, in pixels")
+    parser.add_argument("--calibration_store", default=None,
+                        help="Folder of the calibration blobs downloaded by recorder_console.py")
+
+    args = parser.parse_args()
+    rng = np.random.default_rng(0)
+    if args.check_synthetic:
+        worst = max(check_lut_projector(name, synthetic_lut(name, rng), rng) for name in SYNTHETIC_CAMERAS)
+        raise SystemExit(0 if worst <= args.max_error else 1)
+
+    if args.recording_path is None:
+        parser.error('--recording_path is required without --check_synthetic')
+    folder = Path(args.recording_path)
+    sensor_names = sorted({path.name[:-len(suffix)]
+                           for suffix in ('_lut.bin', '_calibration.txt') for path in folder.glob('*' + suffix)})
+    if not sensor_names:
+        raise SystemExit(f'No _lut.bin or _calibration.txt file in {args.recording_path}')
+
+    worst = max(check_lut_projector(name, load_sensor_lut(folder, name, args.calibration_store), rng)
+                for name in sensor_names)
+    raise SystemExit(0 if worst <= args.max_error else 1)
@@ -12,6 +12,7 @@ from project_hand_eye_to_pv import project_hand_eye_to_pv
 from utils import check_framerates, extract_tar_file
 from save_pclouds import save_pclouds
 from convert_images import convert_images
+from load_surfaces import save_surfaces
 
 
 def process_all(w_path, project_hand_eye=False):
@@ -36,6 +37,9 @@ def process_all(w_path, project_hand_eye=False):
         if (w_path / "{}.tar".format(sensor_name)).exists():
             # Save point clouds
             save_pclouds(w_path, sensor_name)
+
+    # Export spatial mapping surfaces if recorded
+    save_surfaces(w_path)
     print("")
     check_framerates(w_path)
 
@@ -12,7 +12,7 @@ import numpy as np
 from pathlib import Path
 import ast
 
-from utils import load_head_hand_eye_data
+from utils import find_head_hand_eye_file, load_head_hand_eye_data
 
 
 def process_timestamps(path):
@@ -66,7 +66,8 @@ def get_eye_gaze_point(gaze_data):
 
 def project_hand_eye_to_pv(folder):
     print("")
-    head_hat_stream_path = list(folder.glob('*_eye.csv'))[0]
+    head_hat_stream_path = find_head_hand_eye_file(folder)
+    assert(head_hat_stream_path is not None)
     pv_info_path = list(folder.glob('*pv.txt'))[0]
     pv_paths = sorted(list((folder / 'PV').glob('*png')))
     assert(len(pv_paths))
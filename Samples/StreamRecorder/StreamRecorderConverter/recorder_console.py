@@ -10,15 +10,21 @@ import cmd
 import json
 import tarfile
 import argparse
+import urllib.error
 import urllib.request
 from pathlib import Path
 from urllib.parse import quote
 from process_all import process_all
+from utils import DEFAULT_CALIBRATION_STORE
+
+# LocalState folder of the recorder's calibration cache, next to the recordings
+CALIBRATION_FOLDER = 'calibration'
 
 
 class RecorderShell(cmd.Cmd):
     dev_portal_browser = None
     w_path = None
+    calibration_store = None
 
     # cmd variables
     intro = 'Welcome to the recorder shell.   Type help or ? to list commands.\n'
@@ -26,10 +32,11 @@ class RecorderShell(cmd.Cmd):
 
     ruler = '-'
 
-    def __init__(self, w_path, dev_portal_browser):
+    def __init__(self, w_path, dev_portal_browser, calibration_store):
         super().__init__()
         self.dev_portal_browser = dev_portal_browser
         self.w_path = w_path
+        self.calibration_store = calibration_store
 
     def do_help(self, arg):
         print_help()
@@ -55,6 +62,7 @@ class RecorderShell(cmd.Cmd):
             if recording_idx is not None:
                 self.dev_portal_browser.download_recording(
                     recording_idx, self.w_path)
+                self.dev_portal_browser.download_calibration(self.calibration_store)
         except ValueError:
             print(f"I can't download {arg}")
 
@@ -62,6 +70,7 @@ class RecorderShell(cmd.Cmd):
     def do_download_all(self, arg):
         for recording_idx in range(len(self.dev_portal_browser.recording_names)):
             self.dev_portal_browser.download_recording(recording_idx, self.w_path)
+        self.dev_portal_browser.download_calibration(self.calibration_store)
 
     def do_delete_all(self, arg):
         for _ in range(len(self.dev_portal_browser.recording_names)):
@@ -102,6 +111,9 @@ def parse_args():
     parser.add_argument("--workspace_path", required=True,
                         help="Path to workspace folder used for downloading "
                              "recordings")
+    parser.add_argument("--calibration_store", default=str(DEFAULT_CALIBRATION_STORE),
+                        help="Path to the folder the calibration blobs the recordings "
+                             "reference are downloaded to")
 
     args = parser.parse_args()
 
@@ -147,6 +159,8 @@ class DevicePortalBrowser(object):
 
         self.recording_names = []
         for recording in recordings["Items"]:
+            if recording["Id"] == CALIBRATION_FOLDER:
+                continue
             # Check if the recording contains any file data.
             request_url = "{}/api/filesystem/apps/files?knownfolderid=LocalAppData&packagefullname={}&path={}".format(
                 self.url, self.package_full_name, "\\LocalState\\" + recording["Id"])
@@ -204,6 +218,42 @@ class DevicePortalBrowser(object):
                     self.url, self.package_full_name,
                     recording_name, quote(file["Id"])), str(destination_path))
 
+    def download_calibration(self, calibration_store):
+        """Copy the calibration cache of the device, blobs are named after their hash and never change"""
+        try:
+            response = urllib.request.urlopen(
+                "{}/api/filesystem/apps/files?knownfolderid="
+                "LocalAppData&packagefullname={}&path=\\LocalState\\{}".format(
+                    self.url, self.package_full_name, CALIBRATION_FOLDER))
+        except urllib.error.HTTPError:
+            # Recorded by an older version of the app
+            return
+        devices = json.loads(response.read().decode())
+
+        for device in devices["Items"]:
+            device_path = Path(calibration_store) / device["Id"]
+            device_path.mkdir(parents=True, exist_ok=True)
+            response = urllib.request.urlopen(
+                "{}/api/filesystem/apps/files?knownfolderid="
+                "LocalAppData&packagefullname={}&path=\\LocalState\\{}\\{}".format(
+                    self.url, self.package_full_name, CALIBRATION_FOLDER, device["Id"]))
+            files = json.loads(response.read().decode())
+
+            for file in files["Items"]:
+                if file["Type"] != 32 or not file["Id"].endswith(".bin"):
+                    continue
+
+                destination_path = device_path / file["Id"]
+                if destination_path.exists():
+                    continue
+
+                print("=> Downloading calibration:", file["Id"])
+                urllib.request.urlretrieve(
+                    "{}/api/filesystem/apps/file?knownfolderid=LocalAppData&"
+                    "packagefullname={}&filename=\\LocalState\\{}\\{}\\{}".format(
+                        self.url, self.package_full_name, CALIBRATION_FOLDER,
+                        device["Id"], quote(file["Id"])), str(destination_path))
+
     def delete_recording(self, recording_idx):
         recording_name = self.get_recording_name(recording_idx)
         if recording_name is None:
@@ -270,7 +320,7 @@ def main():
 
     dev_portal_browser.list_recordings()
 
-    rs = RecorderShell(w_path, dev_portal_browser)
+    rs = RecorderShell(w_path, dev_portal_browser, Path(args.calibration_store))
     rs.cmdloop()
 
 
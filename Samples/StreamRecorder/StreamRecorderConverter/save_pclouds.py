@@ -15,7 +15,8 @@ import cv2
 import open3d as o3d
 
 from project_hand_eye_to_pv import load_pv_data, match_timestamp
-from utils import extract_tar_file, load_lut, DEPTH_SCALING_FACTOR, project_on_depth, project_on_pv
+from utils import extract_tar_file, load_sensor_lut, DEPTH_SCALING_FACTOR
+from depth_pv_registration import DepthPvRegistration
 
 
 def save_output_txt_files(folder, shared_dict):
@@ -58,12 +59,11 @@ def save_single_pcloud(shared_dict,
                        folder,
                        pinhole_folder,
                        save_in_cam_space,
-                       lut,
+                       registration,
                        has_pv,
                        focal_lengths,
                        principal_point,
                        rig2world_transforms,
-                       rig2cam,
                        pv_timestamps,
                        pv2world_transforms,
                        discard_no_rgb,
@@ -88,7 +88,8 @@ def save_single_pcloud(shared_dict,
     # load depth img
     img = cv2.imread(str(path), -1)
     height, width = img.shape
-    assert len(lut) == width * height
+    assert registration.pixel_count == width * height, \
+        f'{path.name} is {width}x{height}, the LUT has {registration.pixel_count} pixels'
 
     # Clamp values if requested
     if clamp_min > 0 and clamp_max > 0:
@@ -100,7 +101,7 @@ def save_single_pcloud(shared_dict,
         img[img > clamp_max] = 0
 
     # Get xyz points in camera space
-    points = get_points_in_cam_space(img, lut)
+    points, point_ids = registration.points_in_cam_space(img)
     if save_in_cam_space:
         save_ply(output_path, points, rgb=None)
         # print('Saved %s' % output_path)
@@ -110,7 +111,7 @@ def save_single_pcloud(shared_dict,
             # then put the point clouds in world space
             rig2world = rig2world_transforms[timestamp]
             # print('Transform found for timestamp %s' % timestamp)
-            xyz, cam2world_transform = cam2world(points, rig2cam, rig2world)
+            xyz, cam2world_transform = registration.cam2world(points, rig2world)
 
             rgb = None
             if has_pv:
@@ -122,24 +123,18 @@ def save_single_pcloud(shared_dict,
                 assert Path(rgb_path).exists()
                 pv_img = cv2.imread(rgb_path)
 
-                # Project from depth to pv going via world space
-                rgb, depth = project_on_pv(
-                    xyz, pv_img, pv2world_transforms[target_id], 
-                    focal_lengths[target_id], principal_point)
+                # Project from depth to pv, with the depth to pv transform of the frame pair
+                rgb, _ = registration.project_on_pv(
+                    points, pv_img, rig2world, pv2world_transforms[target_id],
+                    focal_lengths[target_id], principal_point, with_depth=False)
 
                 # Project depth on virtual pinhole camera and save corresponding
                 # rgb image inside <workspace>/pinhole_projection folder
                 if not disable_project_pinhole:
-                    # Create virtual pinhole camera
-                    scale = 1
-                    width = 320 * scale
-                    height = 288 * scale
-                    focal_length = 200 * scale
-                    intrinsic_matrix = np.array([[focal_length, 0, width / 2.],
-                                                 [0, focal_length, height / 2.],
-                                                 [0, 0, 1.]])
-                    rgb_proj, depth = project_on_depth(
-                        points, rgb, intrinsic_matrix, width, height)
+                    # Virtual pinhole camera, its pixel for each depth pixel is computed once
+                    intrinsic_matrix = registration.pinhole_intrinsics
+                    rgb_proj, depth = registration.project_on_pinhole(
+                        point_ids, points, rgb)
 
                     # Save depth image
                     depth_proj_folder = pinhole_folder / 'depth' / f'{pv_ts}.png'
@@ -205,22 +200,6 @@ def load_extrinsics(extrinsics_path):
     return mtx
 
 
-def get_points_in_cam_space(img, lut):
-    img = np.tile(img.flatten().reshape((-1, 1)), (1, 3))
-    points = img * lut
-    remove_ids = np.where(np.sqrt(np.sum(points**2, axis=1)) < 1e-6)[0]
-    points = np.delete(points, remove_ids, axis=0)
-    points /= 1000.
-    return points
-
-
-def cam2world(points, rig2cam, rig2world):
-    homog_points = np.hstack((points, np.ones((points.shape[0], 1))))
-    cam2world_transform = rig2world @ np.linalg.inv(rig2cam)
-    world_points = cam2world_transform @ homog_points.T
-    return world_points.T[:, :3], cam2world_transform
-
-
 def extract_timestamp(path):
     return int(path.split('.')[0])
 
@@ -245,15 +224,14 @@ def save_pclouds(folder,
                  clamp_min=0.,
                  clamp_max=0.,
                  depth_path_suffix='',
-                 disable_project_pinhole=False
+                 disable_project_pinhole=False,
+                 calibration_store=None
                  ):
     print("")
     print("Saving point clouds")
 
-    calib = r'{}_lut.bin'.format(sensor_name)
     extrinsics = r'{}_extrinsics.txt'.format(sensor_name)
     rig2world = r'{}_rig2world.txt'.format(sensor_name)
-    calib_path = folder / calib
     rig2campath = folder / extrinsics
     rig2world_path = folder / rig2world if not save_in_cam_space else ''
 
@@ -274,12 +252,15 @@ def save_pclouds(folder,
     else:
         pv_timestamps = focal_lengths = pv2world_transforms = ox = oy = principal_point = None
 
-    # lookup table to extract xyz from depth
-    lut = load_lut(calib_path)
+    # lookup table to extract xyz from depth, from the capture or the calibration store
+    lut = load_sensor_lut(folder, sensor_name, calibration_store)
 
     # from camera to rig space transformation (fixed)
     rig2cam = load_extrinsics(rig2campath)
 
+    # rays and pinhole pixels of the depth camera, computed once for all the frames
+    registration = DepthPvRegistration(lut, rig2cam)
+
     # from rig to world transformations (one per frame)
     rig2world_transforms = load_rig2world_transforms(
         rig2world_path) if rig2world_path != '' and Path(rig2world_path).exists() else None
@@ -318,12 +299,11 @@ def save_pclouds(folder,
                                folder,
                                pinhole_folder,
                                save_in_cam_space,
-                               lut,
+                               registration,
                                has_pv,
                                focal_lengths,
                                principal_point,
                                rig2world_transforms,
-                               rig2cam,
                                pv_timestamps,
                                pv2world_transforms,
                                discard_no_rgb,
@@ -376,6 +356,10 @@ if __name__ == '__main__':
                         choices=["", "_masked"],
                         help="Specify the suffix for depth img filenames, in order"
                              "to work on postprocessed ones (e.g. masked AHAT)")
+    parser.add_argument("--calibration_store",
+                        default=None,
+                        help="Folder of the calibration blobs downloaded by recorder_console.py, "
+                             "~/.hololens2_calibration by default")
 
     args = parser.parse_args()
     for sensor_name in ["Depth Long Throw", "Depth AHaT"]:
@@ -387,4 +371,5 @@ if __name__ == '__main__':
                          args.clamp_min,
                          args.clamp_max,
                          args.depth_path_suffix,
-                         args.disable_project_pinhole)
+                         args.disable_project_pinhole,
+                         args.calibration_store)
@@ -0,0 +1,103 @@
+"""
+ Copyright (c) Microsoft. All rights reserved.
+ This code is licensed under the MIT License (MIT).
+ THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+ ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+ IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+ PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+"""
+import argparse
+from pathlib import Path
+
+import numpy as np
+
+from utils import find_head_hand_eye_file, load_head_hand_eye_data
+
+# Same epsilon as FilterDoubleExponential on the device
+MIN_JITTER_RADIUS = 0.0001
+
+
+def smooth_joint_trajectories(positions, available=None, smoothing=0.5, correction=0.0,
+                              prediction=0.0, jitter_radius=0.05, max_deviation_radius=0.05):
+    """Holt double exponential smoothing of whole joint trajectories, the offline counterpart of
+    FilterDoubleExponentialBatch (the defaults are the ones TrackedHands uses). Frames are processed
+    in order, all joints of a frame at once.
+
+    Args:
+        positions: (frames, joints, 3) array
+        available: optional (frames,) bool array. Frames where the hand was not tracked leave the
+            filters untouched and give zeros, like the loaders do for the raw positions.
+
+    Returns:
+        (frames, joints, 3) smoothed positions
+    """
+    positions = np.asarray(positions, dtype=np.float64)
+    n_frames, n_joints, _ = positions.shape
+    if available is None:
+        available = np.ones(n_frames, dtype=bool)
+    jitter_radius = max(MIN_JITTER_RADIUS, jitter_radius)
+
+    raw_prev = np.zeros((n_joints, 3))
+    filtered_prev = np.zeros((n_joints, 3))
+    trend_prev = np.zeros((n_joints, 3))
+    frame_count = np.zeros(n_joints, dtype=np.int32)
+
+    smoothed = np.zeros_like(positions)
+    for i_frame in range(n_frames):
+        if not available[i_frame]:
+            continue
+        raw = positions[i_frame]
+
+        # Invalid (all zero) positions restart the filter
+        frame_count[np.all(raw == 0, axis=1)] = 0
+        first = (frame_count == 0)[:, None]
+        second = (frame_count == 1)[:, None]
+
+        jitter_distance = np.linalg.norm(raw - filtered_prev, axis=1, keepdims=True)
+        jitter_weight = jitter_distance / jitter_radius
+        dejittered = np.where(jitter_distance <= jitter_radius,
+                              raw * jitter_weight + filtered_prev * (1 - jitter_weight), raw)
+        steady = dejittered * (1 - smoothing) + (filtered_prev + trend_prev) * smoothing
+
+        filtered = np.where(first, raw, np.where(second, (raw + raw_prev) * 0.5, steady))
+        trend = np.where(first, 0.0, (filtered - filtered_prev) * correction + trend_prev * (1 - correction))
+
+        predicted = filtered + trend * prediction
+        deviation = np.linalg.norm(predicted - raw, axis=1, keepdims=True)
+        deviation_weight = max_deviation_radius / np.maximum(deviation, max_deviation_radius)
+        smoothed[i_frame] = np.where(deviation > max_deviation_radius,
+                                     predicted * deviation_weight + raw * (1 - deviation_weight), predicted)
+
+        raw_prev, filtered_prev, trend_prev = raw, filtered, trend
+        frame_count = np.minimum(frame_count + 1, 2)
+
+    return smoothed
+
+
+def smooth_hands(folder):
+    head_hat_stream_path = find_head_hand_eye_file(folder)
+    if head_hat_stream_path is None:
+        return
+
+    (timestamps, _,
+     left_hand_transs, left_hand_transs_available,
+     right_hand_transs, right_hand_transs_available, _, _) = load_head_hand_eye_data(head_hat_stream_path)
+
+    output_path = head_hat_stream_path.with_name(head_hat_stream_path.stem + '_smoothed_hands.npz')
+    print(f"Saving smoothed hand joints to {output_path}")
+    np.savez(output_path,
+             timestamps=timestamps,
+             left_hand=smooth_joint_trajectories(left_hand_transs, left_hand_transs_available),
+             left_hand_available=left_hand_transs_available,
+             right_hand=smooth_joint_trajectories(right_hand_transs, right_hand_transs_available),
+             right_hand_available=right_hand_transs_available)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Smooth recorded hand joint trajectories.')
+    parser.add_argument("--recording_path", required=True,
+                        help="Path to recording folder")
+
+    args = parser.parse_args()
+
+    smooth_hands(Path(args.recording_path))
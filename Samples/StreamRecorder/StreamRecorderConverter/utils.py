@@ -6,7 +6,10 @@
  IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
  PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
 """
+import hashlib
+import os
 import tarfile
+from pathlib import Path
 
 import numpy as np
 import cv2
@@ -39,6 +42,148 @@ def load_lut(lut_filename):
     return lut
 
 
+CAMERA_MODEL_MAGIC = b'HLCAMMDL'
+CAMERA_MODEL_VERSION = 1
+
+
+def load_camera_model(model_filename):
+    """Read a <sensor>_camera_model.bin file, the fisheye model the recorder fits to the _lut.bin
+
+    Returns:
+        dict with width and height, the Kannala-Brandt parameters fx, fy, cx, cy and k (4), max_theta (radians),
+        residuals (n x n x 2 pixel corrections) and the errors of the fit, max_pixel_error, rms_pixel_error and
+        max_ray_error_degrees
+    """
+    with open(model_filename, 'rb') as f:
+        data = f.read()
+
+    if data[:8] != CAMERA_MODEL_MAGIC:
+        raise ValueError(f'{model_filename} is not a camera model file')
+    version = int(np.frombuffer(data, dtype='<u4', count=1, offset=8)[0])
+    if version != CAMERA_MODEL_VERSION:
+        raise ValueError(f'Unsupported camera model version {version}')
+    width, height = (int(value) for value in np.frombuffer(data, dtype='<u2', count=2, offset=12))
+    grid_size = int(np.frombuffer(data, dtype='<u4', count=1, offset=16)[0])
+    params = np.frombuffer(data, dtype='<f4', count=13, offset=20).astype(np.float64)
+    residuals = np.frombuffer(data, dtype='<i2', count=grid_size * grid_size * 2, offset=72)
+
+    return {'width': width,
+            'height': height,
+            'fx': params[0], 'fy': params[1], 'cx': params[2], 'cy': params[3],
+            'k': params[4:8],
+            'max_theta': params[8],
+            'residuals': residuals.reshape((grid_size, grid_size, 2)) * params[9],
+            'max_pixel_error': params[10],
+            'rms_pixel_error': params[11],
+            'max_ray_error_degrees': params[12]}
+
+
+def camera_model_to_lut(model):
+    """Unit rays through the pixel centers, (width * height) x 3 like load_lut returns them
+
+    Pixels outside the field of view of the model get (0, 0, 0), like the pixels the sensor couldn't map.
+    """
+    width, height = model['width'], model['height']
+    residuals = model['residuals']
+    grid_size = residuals.shape[0]
+    k = model['k']
+
+    def lookup_residuals(u, v):
+        gx = np.clip(u * (grid_size - 1) / width, 0, grid_size - 1)
+        gy = np.clip(v * (grid_size - 1) / height, 0, grid_size - 1)
+        i0 = np.minimum(gx.astype(int), grid_size - 2)
+        j0 = np.minimum(gy.astype(int), grid_size - 2)
+        fx = (gx - i0)[:, np.newaxis]
+        fy = (gy - j0)[:, np.newaxis]
+        top = residuals[j0, i0] * (1 - fx) + residuals[j0, i0 + 1] * fx
+        bottom = residuals[j0 + 1, i0] * (1 - fx) + residuals[j0 + 1, i0 + 1] * fx
+        return top * (1 - fy) + bottom * fy
+
+    def distort(theta):
+        t2 = theta * theta
+        return theta * (1 + t2 * (k[0] + t2 * (k[1] + t2 * (k[2] + t2 * k[3]))))
+
+    u, v = np.meshgrid(np.arange(width) + 0.5, np.arange(height) + 0.5)
+    u = u.ravel()
+    v = v.ravel()
+
+    # The residuals are added after the polynomial, so they are removed first, by fixed point iteration
+    qu, qv = u, v
+    for _ in range(3):
+        correction = lookup_residuals(qu, qv)
+        qu = u - correction[:, 0]
+        qv = v - correction[:, 1]
+
+    mx = (qu - model['cx']) / model['fx']
+    my = (qv - model['cy']) / model['fy']
+    rd = np.hypot(mx, my)
+    theta = rd.copy()
+    for _ in range(10):
+        t2 = theta * theta
+        slope = 1 + t2 * (3 * k[0] + t2 * (5 * k[1] + t2 * (7 * k[2] + t2 * 9 * k[3])))
+        theta = np.clip(theta - (distort(theta) - rd) / np.maximum(slope, 1e-3), 0, np.pi / 2)
+
+    scale = np.sin(theta) / np.maximum(rd, 1e-30)
+    lut = np.stack((mx * scale, my * scale, np.cos(theta)), axis=1)
+    lut[rd > distort(model['max_theta'])] = 0
+    return lut.astype(np.float32)
+
+
+# Where recorder_console.py downloads the calibration cache of each device, in one folder per device id
+DEFAULT_CALIBRATION_STORE = Path(os.environ.get('HOLOLENS2_CALIBRATION_STORE', Path.home() / '.hololens2_calibration'))
+
+
+def load_calibration_reference(reference_filename):
+    """Read a <sensor>_calibration.txt file, the reference of a capture to the calibration cache of the recorder
+
+    Returns:
+        dict with device (id), fingerprint, width, height, and the SHA-256 of the lut and camera_model blobs
+    """
+    reference = {}
+    with open(reference_filename) as f:
+        for line in f:
+            key, _, value = line.strip().partition(',')
+            if key:
+                reference[key] = value
+    for key in ('device', 'width', 'height', 'lut', 'camera_model'):
+        if key not in reference:
+            raise ValueError(f'{reference_filename} has no {key}')
+    reference['width'] = int(reference['width'])
+    reference['height'] = int(reference['height'])
+    return reference
+
+
+def calibration_blob_path(calibration_store, reference, sensor_name, kind):
+    """Path of the 'lut' or 'camera_model' blob of a reference in a calibration store, named like in the cache"""
+    return Path(calibration_store) / reference['device'] / '{}_{}_{}.bin'.format(sensor_name, kind, reference[kind][:16])
+
+
+def load_sensor_lut(folder, sensor_name, calibration_store=None):
+    """LUT of a sensor in a capture folder, (width * height) x 3 like load_lut returns it
+
+    Captures from older versions of the recorder have their own <sensor>_lut.bin. Newer ones reference a blob of
+    the calibration store; when it wasn't downloaded, the LUT is rebuilt from the camera model of the capture.
+    """
+    folder = Path(folder)
+    lut_path = folder / r'{}_lut.bin'.format(sensor_name)
+    if lut_path.exists():
+        return load_lut(lut_path)
+
+    reference_path = folder / r'{}_calibration.txt'.format(sensor_name)
+    if reference_path.exists():
+        reference = load_calibration_reference(reference_path)
+        blob_path = calibration_blob_path(calibration_store or DEFAULT_CALIBRATION_STORE, reference, sensor_name, 'lut')
+        if blob_path.exists():
+            with open(blob_path, 'rb') as f:
+                data = f.read()
+            if hashlib.sha256(data).hexdigest() != reference['lut']:
+                raise ValueError(f'{blob_path} does not match the hash in {reference_path}')
+            return np.frombuffer(data, dtype='f').reshape((-1, 3))
+        print(f'{blob_path.name} is not in the calibration store, using the camera model of {sensor_name}')
+
+    return camera_model_to_lut(load_camera_model(folder / r'{}_camera_model.bin'.format(sensor_name)))
+
+
 def check_framerates(capture_path):
     HundredsOfNsToMilliseconds = 1e-4
     MillisecondsToSeconds = 1e-3
@@ -56,18 +201,140 @@ def check_framerates(capture_path):
             print('Average {} delta: {:.3f}ms, fps: {:.3f}'.format(
                 img_folder, avg_delta, 1/(avg_delta * MillisecondsToSeconds)))
 
-    head_hat_stream_path = capture_path.glob('*eye.csv')
-    try:
-        head_hat_stream_path = next(head_hat_stream_path)
+    head_hat_stream_path = find_head_hand_eye_file(capture_path)
+    if head_hat_stream_path is not None:
         timestamps = load_head_hand_eye_data(str(head_hat_stream_path))[0]
         hh_avg_delta = get_avg_delta(timestamps) * HundredsOfNsToMilliseconds
         print('Average hand/head delta: {:.3f}ms, fps: {:.3f}'.format(
             hh_avg_delta, 1/(hh_avg_delta * MillisecondsToSeconds)))
-    except StopIteration:
-        pass
 
 
-def load_head_hand_eye_data(csv_path):
+def find_head_hand_eye_file(capture_path):
+    """Binary log of current recordings, or the csv written by older versions of the recorder"""
+    for pattern in ('*_head_hand_eye.bin', '*eye.csv'):
+        paths = sorted(capture_path.glob(pattern))
+        if paths:
+            return paths[0]
+    return None
+
+
+# See HeTHaTEyeStream.h for the file layout
+HEAD_HAND_EYE_FILE_MAGIC = b'HLHNDEYE'
+HEAD_HAND_EYE_FILE_VERSION = 1
+HEAD_HAND_EYE_QUANTIZED_FLAG = 1
+LEFT_HAND_PRESENT = 1
+RIGHT_HAND_PRESENT = 2
+EYE_GAZE_PRESENT = 4
+
+
+def quaternion_to_matrix(quaternions):
+    """Rotation matrices (column vectors) of unit quaternions given as (..., 4) x, y, z, w"""
+    x, y, z, w = np.moveaxis(quaternions, -1, 0)
+    matrices = np.empty(quaternions.shape[:-1] + (3, 3))
+    matrices[..., 0, 0] = 1 - 2 * (y * y + z * z)
+    matrices[..., 0, 1] = 2 * (x * y - z * w)
+    matrices[..., 0, 2] = 2 * (x * z + y * w)
+    matrices[..., 1, 0] = 2 * (x * y + z * w)
+    matrices[..., 1, 1] = 1 - 2 * (x * x + z * z)
+    matrices[..., 1, 2] = 2 * (y * z - x * w)
+    matrices[..., 2, 0] = 2 * (x * z - y * w)
+    matrices[..., 2, 1] = 2 * (y * z + x * w)
+    matrices[..., 2, 2] = 1 - 2 * (x * x + y * y)
+    return matrices
+
+
+def poses_to_transforms(poses):
+    """4x4 transforms (column vectors, same as the csv log) of (..., 7) position + quaternion poses"""
+    transforms = np.zeros(poses.shape[:-1] + (4, 4))
+    transforms[..., :3, :3] = quaternion_to_matrix(poses[..., 3:])
+    transforms[..., :3, 3] = poses[..., :3]
+    transforms[..., 3, 3] = 1
+    return transforms
+
+
+def load_head_hand_eye_poses(bin_path):
+    """Read a _head_hand_eye.bin file
+
+    Returns:
+        dict with timestamps, presence flags, head (N x 7), left_hand and right_hand (N x joints x 7) poses
+        as position + quaternion (x, y, z, w), gaze_origin, gaze_direction (N x 3) and gaze_distance (N)
+    """
+    with open(bin_path, 'rb') as f:
+        data = f.read()
+
+    if data[:8] != HEAD_HAND_EYE_FILE_MAGIC:
+        raise ValueError(f'{bin_path} is not a head/hand/eye file')
+    version, flags, joint_count = np.frombuffer(data, dtype='<u4', count=3, offset=8)
+    if version != HEAD_HAND_EYE_FILE_VERSION:
+        raise ValueError(f'Unsupported head/hand/eye file version {version}')
+    origin = np.frombuffer(data, dtype='<f4', count=3, offset=20).astype(np.float64)
+    meters_per_unit = float(np.frombuffer(data, dtype='<f4', count=1, offset=32)[0])
+
+    quantized = bool(flags & HEAD_HAND_EYE_QUANTIZED_FLAG)
+    value_type = '<i2' if quantized else '<f4'
+    frame_dtype = np.dtype([('timestamp', '<i8'),
+                            ('presence', '<u4'),
+                            ('poses', value_type, (1 + 2 * joint_count, 7)),
+                            ('gaze_origin', value_type, (3,)),
+                            ('gaze_direction', value_type, (3,)),
+                            ('gaze_distance', '<f4')])
+    header_size = 36
+    # A trailing partial frame means the recording was interrupted while saving
+    n_frames = (len(data) - header_size) // frame_dtype.itemsize
+    frames = np.frombuffer(data, dtype=frame_dtype, count=n_frames, offset=header_size)
+
+    poses = frames['poses'].astype(np.float64)
+    gaze_origin = frames['gaze_origin'].astype(np.float64)
+    gaze_direction = frames['gaze_direction'].astype(np.float64)
+    if quantized:
+        snorm16_max = 32767.0
+        poses[..., :3] = origin + poses[..., :3] * meters_per_unit
+        poses[..., 3:] /= snorm16_max
+        gaze_origin = origin + gaze_origin * meters_per_unit
+        gaze_direction /= snorm16_max
+    poses[..., 3:] /= np.maximum(np.linalg.norm(poses[..., 3:], axis=-1, keepdims=True), 1e-12)
+
+    return {'timestamps': frames['timestamp'].astype(np.int64),
+            'presence': frames['presence'],
+            'head': poses[:, 0],
+            'left_hand': poses[:, 1:1 + joint_count],
+            'right_hand': poses[:, 1 + joint_count:],
+            'gaze_origin': gaze_origin,
+            'gaze_direction': gaze_direction,
+            'gaze_distance': frames['gaze_distance'].astype(np.float64)}
+
+
+def load_head_hand_eye_bin(bin_path):
+    poses = load_head_hand_eye_poses(bin_path)
+    n_frames = len(poses['timestamps'])
+
+    left_available = (poses['presence'] & LEFT_HAND_PRESENT) != 0
+    right_available = (poses['presence'] & RIGHT_HAND_PRESENT) != 0
+    gaze_available = (poses['presence'] & EYE_GAZE_PRESENT) != 0
+
+    # Match the csv, where absent hands and gaze are written as zeros
+    left_hand_transs = np.where(left_available[:, None, None], poses['left_hand'][..., :3], 0.0)
+    right_hand_transs = np.where(right_available[:, None, None], poses['right_hand'][..., :3], 0.0)
+
+    gaze_data = np.zeros((n_frames, 9))
+    gaze_data[:, :3] = poses['gaze_origin']
+    gaze_data[:, 3] = 1
+    gaze_data[:, 4:7] = poses['gaze_direction']
+    gaze_data[:, 8] = poses['gaze_distance']
+    gaze_data[~gaze_available] = 0
+
+    return (poses['timestamps'].astype(np.float64), poses['head'][:, :3],
+            left_hand_transs, left_available,
+            right_hand_transs, right_available, gaze_data, gaze_available)
+
+
+def load_head_hand_eye_data(path):
+    if str(path).endswith('.bin'):
+        return load_head_hand_eye_bin(path)
+    return load_head_hand_eye_csv(path)
+
+
+def load_head_hand_eye_csv(csv_path):
     joint_count = HandJointIndex.Count.value
 
     data = np.loadtxt(csv_path, delimiter=',')
@@ -115,6 +382,61 @@ def load_head_hand_eye_data(csv_path):
             right_hand_transs, right_hand_transs_available, gaze_data, gaze_available)
 
 
+# See ImuSampleStream.h for the file layout
+IMU_FILE_MAGIC = b'HLIMUSMP'
+IMU_FILE_VERSION = 2
+IMU_SENSOR_NAMES = ('imu_accel', 'imu_gyro', 'imu_mag')
+IMU_SAMPLE_DTYPE = np.dtype([('vinyl_hup_ticks', '<u8'),
+                             ('soc_ticks', '<u8'),
+                             ('values', '<f4', (3,)),
+                             ('temperature', '<f4'),
+                             ('timestamp', '<i8')])
+# Version 1 files have one offset from soc_ticks to absolute ticks in the header, and no timestamp per sample
+IMU_SAMPLE_DTYPE_V1 = np.dtype([('vinyl_hup_ticks', '<u8'),
+                                ('soc_ticks', '<u8'),
+                                ('values', '<f4', (3,)),
+                                ('temperature', '<f4')])
+
+
+def load_imu_samples(bin_path):
+    """Read an imu_accel.bin, imu_gyro.bin or imu_mag.bin file
+
+    Returns:
+        dict with the sensor name, timestamps (N, in the same absolute 100 ns ticks as the camera frames),
+        vinyl_hup_ticks and soc_ticks (N), values (N x 3), temperature (N) and dropped_sample_count
+    """
+    with open(bin_path, 'rb') as f:
+        data = f.read()
+
+    if data[:8] != IMU_FILE_MAGIC:
+        raise ValueError(f'{bin_path} is not an IMU file')
+    version, sensor = np.frombuffer(data, dtype='<u4', count=2, offset=8)
+    if version == IMU_FILE_VERSION:
+        dropped_sample_count = int(np.frombuffer(data, dtype='<u8', count=1, offset=16)[0])
+        header_size, sample_dtype = 24, IMU_SAMPLE_DTYPE
+    elif version == 1:
+        soc_ticks_to_absolute_ticks = int(np.frombuffer(data, dtype='<i8', count=1, offset=16)[0])
+        dropped_sample_count = int(np.frombuffer(data, dtype='<u8', count=1, offset=24)[0])
+        header_size, sample_dtype = 32, IMU_SAMPLE_DTYPE_V1
+    else:
+        raise ValueError(f'Unsupported IMU file version {version}')
+
+    n_samples = (len(data) - header_size) // sample_dtype.itemsize
+    samples = np.frombuffer(data, dtype=sample_dtype, count=n_samples, offset=header_size)
+    if version == IMU_FILE_VERSION:
+        timestamps = samples['timestamp'].astype(np.int64)
+    else:
+        timestamps = samples['soc_ticks'].astype(np.int64) + soc_ticks_to_absolute_ticks
+
+    return {'sensor': IMU_SENSOR_NAMES[sensor],
+            'timestamps': timestamps,
+            'vinyl_hup_ticks': samples['vinyl_hup_ticks'],
+            'soc_ticks': samples['soc_ticks'],
+            'values': samples['values'].astype(np.float64),
+            'temperature': samples['temperature'].astype(np.float64),
+            'dropped_sample_count': dropped_sample_count}
+
+
 def project_on_pv(points, pv_img, pv2world_transform, focal_length, principal_point):
     height, width, _ = pv_img.shape
 
@@ -0,0 +1,314 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Drives SurfaceScheduler, the surface meshing scheduler of SurfaceMapping, with a stand-in surface source: a room
+// scanned in a few waves, whose surfaces take a random time to mesh and get rescanned every few seconds. Reports the
+// time until the surfaces near the head and all the surfaces were published, against the serial loop
+// SurfaceObservationThreadFunction used before (Sleep(50), then one blocking mesh computation per surface, in the
+// order the system lists them). Checks that every surface gets published, that no surface is processed twice at
+// once and that no batch is empty. Exits with 1 when a check fails.
+
+#include "SurfaceScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    struct SourceOptions
+    {
+        size_t surfaceCount = 150;
+        size_t waveCount = 4;                   // The room is discovered in this many waves...
+        double waveSeconds = 0.5;               // ...this far apart
+        double minMeshSeconds = 0.03;           // TryComputeLatestMeshAsync plus the conversion, uniform in between
+        double maxMeshSeconds = 0.12;
+        double rescanSeconds = 3.0;             // Observed surfaces get a new update time this often
+        double pollSeconds = 0.1;               // How often the observation thread lists the surfaces
+        double nearMeters = 2.0;
+        double timeScale = 0.25;                // Multiplies every duration above, to keep runs short
+    };
+
+    struct StandInSurface
+    {
+        unsigned id;
+        float distanceToHead;
+        double meshSeconds;
+        size_t wave;
+    };
+
+    // A 10 x 10 m room around the head, listed in no particular order, like GetObservedSurfaces
+    class StandInSurfaceSource
+    {
+    public:
+        explicit StandInSurfaceSource(const SourceOptions& options) :
+            m_options(options)
+        {
+            std::mt19937 random(5);
+            std::uniform_real_distribution<float> position(-5.0f, 5.0f);
+            std::uniform_real_distribution<double> meshSeconds(options.minMeshSeconds, options.maxMeshSeconds);
+            for (unsigned id = 0; id < options.surfaceCount; id++)
+            {
+                const float x = position(random);
+                const float z = position(random);
+                m_surfaces.push_back({ id, std::sqrt(x * x + z * z), meshSeconds(random) * options.timeScale, id % options.waveCount });
+            }
+            std::shuffle(m_surfaces.begin(), m_surfaces.end(), random);
+        }
+
+        void Start()
+        {
+            m_startTime = Clock::now();
+        }
+
+        double Elapsed() const
+        {
+            return std::chrono::duration<double>(Clock::now() - m_startTime).count() / m_options.timeScale;
+        }
+
+        // Surfaces observed so far, with their update time in 100 ns ticks of unscaled time
+        std::vector<std::pair<StandInSurface, long long>> GetObservedSurfaces() const
+        {
+            const double elapsed = Elapsed();
+            std::vector<std::pair<StandInSurface, long long>> observed;
+            for (const StandInSurface& surface : m_surfaces)
+            {
+                const double observedAt = surface.wave * m_options.waveSeconds;
+                if (elapsed < observedAt)
+                    continue;
+
+                const double rescans = std::floor((elapsed - observedAt) / m_options.rescanSeconds);
+                observed.emplace_back(surface, (long long)((observedAt + rescans * m_options.rescanSeconds) * 1e7));
+            }
+            return observed;
+        }
+
+        const std::vector<StandInSurface>& GetSurfaces() const { return m_surfaces; }
+
+    private:
+        const SourceOptions m_options;
+        std::vector<StandInSurface> m_surfaces;
+        Clock::time_point m_startTime;
+    };
+
+    // When each surface was first published, in unscaled seconds from the start of the scan
+    class CoverageLog
+    {
+    public:
+        CoverageLog(const StandInSurfaceSource& source, float nearMeters) :
+            m_source(source),
+            m_nearMeters(nearMeters),
+            m_firstPublished(source.GetSurfaces().size(), -1.0)
+        {
+        }
+
+        void Published(unsigned id)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_firstPublished[id] < 0.0)
+                m_firstPublished[id] = m_source.Elapsed();
+        }
+
+        bool IsComplete()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return std::none_of(m_firstPublished.begin(), m_firstPublished.end(), [](double t) { return t < 0.0; });
+        }
+
+        // Seconds until every surface within nearMeters (or every surface) was published, negative if one never was
+        double TimeToCoverage(bool nearOnly)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            double last = 0.0;
+            for (const StandInSurface& surface : m_source.GetSurfaces())
+            {
+                if (nearOnly && surface.distanceToHead > m_nearMeters)
+                    continue;
+                if (m_firstPublished[surface.id] < 0.0)
+                    return -1.0;
+                last = (std::max)(last, m_firstPublished[surface.id]);
+            }
+            return last;
+        }
+
+    private:
+        const StandInSurfaceSource& m_source;
+        const float m_nearMeters;
+        std::mutex m_mutex;
+        std::vector<double> m_firstPublished;
+    };
+
+    void SleepScaled(double seconds, const SourceOptions& options)
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds * options.timeScale));
+    }
+
+    struct RunResult
+    {
+        double nearCoverage;
+        double fullCoverage;
+        bool passed;
+    };
+
+    RunResult RunScheduler(const SourceOptions& options, unsigned workerCount, double timeoutSeconds)
+    {
+        StandInSurfaceSource source(options);
+        CoverageLog coverage(source, float(options.nearMeters));
+
+        std::mutex inFlightMutex;
+        std::set<unsigned> inFlight;
+        std::atomic<bool> processedTwiceAtOnce{ false };
+        std::atomic<bool> emptyBatch{ false };
+
+        typedef SurfaceScheduler<unsigned, StandInSurface, unsigned> Scheduler;
+        Scheduler::Settings settings;
+        settings.workerCount = workerCount;
+        settings.publishInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(0.1 * options.timeScale));
+        settings.minimumUpdateInterval = (long long)(options.rescanSeconds * 0.9 * 1e7);
+
+        Scheduler scheduler(
+            [&](const StandInSurface& surface, unsigned& result)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(inFlightMutex);
+                    if (!inFlight.insert(surface.id).second)
+                        processedTwiceAtOnce = true;
+                }
+                std::this_thread::sleep_for(std::chrono::duration<double>(surface.meshSeconds));
+                {
+                    std::lock_guard<std::mutex> lock(inFlightMutex);
+                    inFlight.erase(surface.id);
+                }
+                result = surface.id;
+                return true;
+            },
+            [&](std::vector<unsigned>&& batch)
+            {
+                if (batch.empty())
+                    emptyBatch = true;
+                for (unsigned id : batch)
+                    coverage.Published(id);
+            },
+            settings);
+
+        source.Start();
+        while (!coverage.IsComplete() && source.Elapsed() < timeoutSeconds)
+        {
+            std::vector<Scheduler::Candidate> candidates;
+            for (auto& observed : source.GetObservedSurfaces())
+                candidates.push_back({ observed.first.id, observed.first, observed.first.distanceToHead, observed.second });
+            scheduler.Submit(candidates);
+            SleepScaled(options.pollSeconds, options);
+        }
+
+        const SurfaceSchedulerMetrics metrics = scheduler.GetMetrics();
+        RunResult result = { coverage.TimeToCoverage(true), coverage.TimeToCoverage(false), false };
+        result.passed = result.fullCoverage >= 0.0 && !processedTwiceAtOnce && !emptyBatch && metrics.failedCount == 0;
+        printf("%-22s %12.2f %12.2f %10zu %14.1f  %s%s%s\n", ("scheduler, " + std::to_string(workerCount) + " workers").c_str(),
+            result.nearCoverage, result.fullCoverage, metrics.processedCount, metrics.averageLatency / options.timeScale * 1e3,
+            result.passed ? "ok" : "FAILED", processedTwiceAtOnce ? " (surface processed twice at once)" : "",
+            emptyBatch ? " (empty batch)" : "");
+        return result;
+    }
+
+    // SurfaceObservationThreadFunction before the scheduler
+    RunResult RunSerialLoop(const SourceOptions& options, double timeoutSeconds)
+    {
+        StandInSurfaceSource source(options);
+        CoverageLog coverage(source, float(options.nearMeters));
+        std::vector<long long> processedUpdateTimes(options.surfaceCount, -1);
+        const long long minimumUpdateInterval = (long long)(options.rescanSeconds * 0.9 * 1e7);
+        size_t processedCount = 0;
+
+        source.Start();
+        while (!coverage.IsComplete() && source.Elapsed() < timeoutSeconds)
+        {
+            for (auto& observed : source.GetObservedSurfaces())
+            {
+                const long long previous = processedUpdateTimes[observed.first.id];
+                if (previous >= 0 && observed.second - previous <= minimumUpdateInterval)
+                    continue;
+
+                SleepScaled(0.05, options);
+                std::this_thread::sleep_for(std::chrono::duration<double>(observed.first.meshSeconds));
+                processedUpdateTimes[observed.first.id] = observed.second;
+                coverage.Published(observed.first.id);
+                processedCount++;
+            }
+            SleepScaled(options.pollSeconds, options);
+        }
+
+        RunResult result = { coverage.TimeToCoverage(true), coverage.TimeToCoverage(false), false };
+        result.passed = result.fullCoverage >= 0.0;
+        printf("%-22s %12.2f %12.2f %10zu %14s  %s\n", "serial loop", result.nearCoverage, result.fullCoverage, processedCount, "-",
+            result.passed ? "ok" : "timed out");
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    SourceOptions options;
+    unsigned workerCount = 3;
+    double timeoutSeconds = 120.0;
+    bool runSerial = true;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--surfaces" && i + 1 < argc)
+        {
+            options.surfaceCount = (std::max)(size_t(1), size_t(strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (arg == "--workers" && i + 1 < argc)
+        {
+            workerCount = (std::max)(1u, unsigned(strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (arg == "--time-scale" && i + 1 < argc)
+        {
+            options.timeScale = (std::max)(0.01, atof(argv[++i]));
+        }
+        else if (arg == "--no-serial")
+        {
+            runSerial = false;
+        }
+        else
+        {
+            printf("usage: SurfaceSchedulerTest [--surfaces count] [--workers count] [--time-scale factor] [--no-serial]\n");
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    printf("%zu surfaces in %zu waves, %.0f to %.0f ms to mesh each, times in unscaled seconds\n", options.surfaceCount,
+        options.waveCount, options.minMeshSeconds * 1e3, options.maxMeshSeconds * 1e3);
+    printf("%-22s %12s %12s %10s %14s\n", "run", "near (s)", "all (s)", "meshed", "latency (ms)");
+    const RunResult scheduled = RunScheduler(options, workerCount, timeoutSeconds);
+    if (runSerial)
+    {
+        const RunResult serial = RunSerialLoop(options, timeoutSeconds);
+        if (scheduled.passed && serial.passed)
+        {
+            printf("time to near coverage %.1fx shorter, to full coverage %.1fx shorter\n",
+                serial.nearCoverage / scheduled.nearCoverage, serial.fullCoverage / scheduled.fullCoverage);
+        }
+    }
+    return scheduled.passed ? 0 : 1;
+}